@@ -0,0 +1,384 @@
+#include "AssetPack.h"
+#include "Lz4.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+std::string NormalizePackName(const char* name)
+{
+	while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+	{
+		name += 2 ;
+	}
+
+	std::string result(name) ;
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		char c = result[i] ;
+		if (c == '\\')
+		{
+			result[i] = '/' ;
+		}
+		else if (c >= 'A' && c <= 'Z')
+		{
+			result[i] = c - 'A' + 'a' ;
+		}
+	}
+	return result ;
+}
+
+unsigned long long PackNameHash(const char* name, size_t length)
+{
+	unsigned long long hash = 14695981039346656037ULL ;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= (unsigned char)name[i] ;
+		hash *= 1099511628211ULL ;
+	}
+	return hash ;
+}
+
+unsigned int PackChecksum(const unsigned char* data, size_t size)
+{
+	unsigned int hash = 2166136261U ;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i] ;
+		hash *= 16777619U ;
+	}
+	return hash ;
+}
+
+const char* PackErrorText(PACK_ERROR error)
+{
+	switch (error)
+	{
+	case PACK_OK:			return "no error" ;
+	case PACK_CANNOT_OPEN:	return "cannot open the pack file" ;
+	case PACK_NOT_PACK:		return "not an asset pack of this version" ;
+	case PACK_BAD_INDEX:	return "the pack index is damaged" ;
+	}
+	return "unknown error" ;
+}
+
+Asset::Asset(void)
+	: m_pData(NULL),
+	  m_Size(0)
+{
+}
+
+Asset::~Asset(void)
+{
+}
+
+void Asset::Release()
+{
+	m_File.Close() ;
+	std::vector<unsigned char>().swap(m_Buffer) ;
+	m_pData = NULL ;
+	m_Size = 0 ;
+}
+
+AssetPack::AssetPack(void)
+	: m_pData(NULL),
+	  m_Size(0),
+	  m_pHeader(NULL),
+	  m_pEntries(NULL),
+	  m_pNames(NULL),
+	  m_Error(PACK_OK)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+AssetPack::~AssetPack(void)
+{
+	Close() ;
+}
+
+bool AssetPack::Open(const char* path)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_Error = PACK_CANNOT_OPEN ;
+		return false ;
+	}
+	return Attach(m_File.Data(), m_File.Size()) ;
+}
+
+#ifdef _WIN32
+bool AssetPack::Open(const wchar_t* path)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_Error = PACK_CANNOT_OPEN ;
+		return false ;
+	}
+	return Attach(m_File.Data(), m_File.Size()) ;
+}
+#endif
+
+bool AssetPack::OpenMemory(const unsigned char* data, size_t size)
+{
+	Close() ;
+	return Attach(data, size) ;
+}
+
+bool AssetPack::Attach(const unsigned char* data, size_t size)
+{
+	m_pData = data ;
+	m_Size = size ;
+	m_pHeader = (const PackHeader*)data ;
+
+	if (!Index())
+	{
+		Close() ;
+		return false ;
+	}
+
+	m_Error = PACK_OK ;
+	return true ;
+}
+
+void AssetPack::Close()
+{
+	// Keep the error of a failed open, Close is called on the way out of it
+	PACK_ERROR error = m_Error ;
+
+	m_File.Close() ;
+	m_pData = NULL ;
+	m_Size = 0 ;
+	m_pHeader = NULL ;
+	m_pEntries = NULL ;
+	m_pNames = NULL ;
+
+	m_Error = error ;
+}
+
+// Check every offset in the index once, so lookups and loads can trust it
+bool AssetPack::Index()
+{
+	if (m_Size < sizeof(PackHeader) || m_pHeader->magic != PACK_MAGIC || m_pHeader->version != PACK_VERSION)
+	{
+		m_Error = PACK_NOT_PACK ;
+		return false ;
+	}
+
+	m_Error = PACK_BAD_INDEX ;
+
+	const PackHeader& header = *m_pHeader ;
+	if (header.entryCount > (m_Size - sizeof(PackHeader)) / sizeof(PackEntry))
+	{
+		return false ;
+	}
+	if (header.namesOffset > m_Size || header.namesBytes > m_Size - header.namesOffset)
+	{
+		return false ;
+	}
+	if (header.entryCount > 0 && (header.namesBytes == 0 || m_pData[header.namesOffset + header.namesBytes - 1] != 0))
+	{
+		return false ;
+	}
+
+	m_pEntries = (const PackEntry*)(m_pData + sizeof(PackHeader)) ;
+	m_pNames = (const char*)m_pData + header.namesOffset ;
+
+	for (unsigned int i = 0; i < header.entryCount; ++i)
+	{
+		const PackEntry& entry = m_pEntries[i] ;
+
+		if (entry.nameOffset >= header.namesBytes || entry.nameLength >= header.namesBytes - entry.nameOffset ||
+			m_pNames[entry.nameOffset + entry.nameLength] != 0 || strlen(m_pNames + entry.nameOffset) != entry.nameLength)
+		{
+			return false ;
+		}
+		if (entry.offset > m_Size || entry.packedSize > m_Size - entry.offset)
+		{
+			return false ;
+		}
+
+		switch (entry.compression)
+		{
+		case PACK_STORED:
+			if (entry.size != entry.packedSize)
+			{
+				return false ;
+			}
+			break ;
+
+		case PACK_LZ4:
+			// LZ4 expands at most 255 times, a larger size can only come from a damaged index
+			if (entry.size / 255 > entry.packedSize || entry.size > (size_t)-1)
+			{
+				return false ;
+			}
+			break ;
+
+		default:
+			return false ;
+		}
+
+		if (entry.hash != PackNameHash(m_pNames + entry.nameOffset, entry.nameLength))
+		{
+			return false ;
+		}
+
+		// The binary search in Find needs the order the pack tool wrote
+		if (i > 0)
+		{
+			const PackEntry& previous = m_pEntries[i - 1] ;
+			if (previous.hash > entry.hash ||
+				(previous.hash == entry.hash && strcmp(m_pNames + previous.nameOffset, m_pNames + entry.nameOffset) >= 0))
+			{
+				return false ;
+			}
+		}
+	}
+
+	return true ;
+}
+
+int AssetPack::Find(const char* name) const
+{
+	if (!m_pHeader)
+	{
+		return -1 ;
+	}
+
+	std::string key = NormalizePackName(name) ;
+	unsigned long long hash = PackNameHash(key.c_str(), key.size()) ;
+
+	// First entry with a hash not below the one looked for
+	unsigned int low = 0 ;
+	unsigned int high = m_pHeader->entryCount ;
+	while (low < high)
+	{
+		unsigned int middle = low + (high - low) / 2 ;
+		if (m_pEntries[middle].hash < hash)
+		{
+			low = middle + 1 ;
+		}
+		else
+		{
+			high = middle ;
+		}
+	}
+
+	// Names with the same hash follow each other
+	for (unsigned int i = low; i < m_pHeader->entryCount && m_pEntries[i].hash == hash; ++i)
+	{
+		if (m_pEntries[i].nameLength == key.size() && memcmp(Name(i), key.c_str(), key.size()) == 0)
+		{
+			return (int)i ;
+		}
+	}
+
+	return -1 ;
+}
+
+bool AssetPack::Extract(int index, unsigned char* out) const
+{
+	const PackEntry& entry = m_pEntries[index] ;
+	if (entry.compression == PACK_LZ4)
+	{
+		return Lz4Decompress(EntryData(index), (size_t)entry.packedSize, out, (size_t)entry.size) ;
+	}
+
+	memcpy(out, EntryData(index), (size_t)entry.size) ;
+	return true ;
+}
+
+bool AssetPack::Verify(int index) const
+{
+	const PackEntry& entry = m_pEntries[index] ;
+	if (entry.compression == PACK_STORED)
+	{
+		return PackChecksum(EntryData(index), (size_t)entry.size) == entry.checksum ;
+	}
+
+	// One byte more, so an empty entry still has a buffer to point to
+	std::vector<unsigned char> data((size_t)entry.size + 1) ;
+	return Extract(index, &data[0]) && PackChecksum(&data[0], (size_t)entry.size) == entry.checksum ;
+}
+
+bool AssetPack::LoadEntry(const char* name, Asset& asset)
+{
+	int index = Find(name) ;
+	if (index < 0)
+	{
+		return false ;
+	}
+
+	const PackEntry& entry = m_pEntries[index] ;
+	if (entry.compression == PACK_STORED)
+	{
+		asset.m_pData = EntryData(index) ;
+		asset.m_Size = (size_t)entry.size ;
+		return true ;
+	}
+
+	// One byte more, so an empty entry still has a buffer to point to
+	asset.m_Buffer.resize((size_t)entry.size + 1) ;
+	if (!Extract(index, &asset.m_Buffer[0]))
+	{
+		asset.Release() ;
+		return false ;
+	}
+
+	asset.m_pData = &asset.m_Buffer[0] ;
+	asset.m_Size = (size_t)entry.size ;
+	m_Stats.bytesDecompressed += asset.m_Size ;
+	return true ;
+}
+
+bool AssetPack::Load(const char* name, Asset& asset)
+{
+	asset.Release() ;
+
+	if (LoadEntry(name, asset))
+	{
+		++m_Stats.packLoads ;
+		return true ;
+	}
+
+	if (asset.m_File.Open(name))
+	{
+		asset.m_pData = asset.m_File.Data() ;
+		asset.m_Size = asset.m_File.Size() ;
+		++m_Stats.fileLoads ;
+		return true ;
+	}
+
+	++m_Stats.failed ;
+	return false ;
+}
+
+#ifdef _WIN32
+bool AssetPack::Load(const wchar_t* name, Asset& asset)
+{
+	asset.Release() ;
+
+	// Entry names are UTF-8
+	char utf8[MAX_PATH * 3] ;
+	if (WideCharToMultiByte(CP_UTF8, 0, name, -1, utf8, sizeof(utf8), NULL, NULL) > 0 && LoadEntry(utf8, asset))
+	{
+		++m_Stats.packLoads ;
+		return true ;
+	}
+
+	if (asset.m_File.Open(name))
+	{
+		asset.m_pData = asset.m_File.Data() ;
+		asset.m_Size = asset.m_File.Size() ;
+		++m_Stats.fileLoads ;
+		return true ;
+	}
+
+	++m_Stats.failed ;
+	return false ;
+}
+#endif
@@ -0,0 +1,186 @@
+#ifndef __ASSET_PACK_H__
+#define __ASSET_PACK_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "../Utility/MappedFile.h"
+
+/*
+File layout of an asset pack, all numbers little-endian:
+
+	PackHeader
+	PackEntry[entryCount]		sorted by name hash, then by name
+	names						normalized entry names, each followed by a 0 byte
+	entry data					each entry starts at a multiple of the pack alignment
+
+The header and index come first so opening a pack touches one page for small packs, and
+a lookup is a binary search over the mapped index without building anything in memory.
+*/
+
+#define PACK_MAGIC		0x4B415041	// "APAK"
+#define PACK_VERSION	1
+
+enum PACK_COMPRESSION
+{
+	PACK_STORED,	// the entry bytes are the file, loads point straight into the mapping
+	PACK_LZ4,		// one LZ4 block, decompressed on load
+};
+
+struct PackHeader
+{
+	unsigned int magic ;
+	unsigned int version ;
+	unsigned int entryCount ;
+	unsigned int alignment ;
+	unsigned long long namesOffset ;
+	unsigned int namesBytes ;
+	unsigned int reserved ;
+};
+
+struct PackEntry
+{
+	unsigned long long hash ;		// PackNameHash of the name
+	unsigned long long offset ;		// from the start of the pack
+	unsigned long long packedSize ;	// bytes in the pack
+	unsigned long long size ;		// bytes after decompression
+	unsigned int nameOffset ;		// into the name table
+	unsigned int nameLength ;
+	unsigned int compression ;		// PACK_COMPRESSION
+	unsigned int checksum ;			// PackChecksum of the decompressed bytes
+};
+
+enum PACK_ERROR
+{
+	PACK_OK,
+	PACK_CANNOT_OPEN,
+	PACK_NOT_PACK,			// wrong magic or version
+	PACK_BAD_INDEX,			// the index, a name or an entry lies outside the file, or the index is not sorted
+};
+
+// Lower case, '/' separators, no leading "./", so "Media\Sound\Hit.wav" and "./media/sound/hit.wav" find the same entry
+std::string NormalizePackName(const char* name) ;
+
+// 64 bit FNV-1a of a normalized name
+unsigned long long PackNameHash(const char* name, size_t length) ;
+
+// 32 bit FNV-1a of entry data, checked by AssetPack::Verify
+unsigned int PackChecksum(const unsigned char* data, size_t size) ;
+
+const char* PackErrorText(PACK_ERROR error) ;
+
+class AssetPack ;
+
+/*
+The bytes of one loaded asset.
+
+A stored entry points into the pack's mapping and copies nothing, a compressed entry is
+decompressed into a buffer the asset owns, and an asset that is not in any pack is a
+mapping of the loose file. The data is valid until the asset is released or loaded
+again, and for pack entries until the pack is closed.
+*/
+class Asset
+{
+public:
+	Asset(void);
+	~Asset(void);
+
+	const unsigned char* Data() const { return m_pData ; }
+
+	size_t Size() const { return m_Size ; }
+
+	void Release() ;
+
+private:
+	friend class AssetPack ;
+
+	const unsigned char* m_pData ;
+	size_t m_Size ;
+	std::vector<unsigned char> m_Buffer ;
+	MappedFile m_File ;
+
+	Asset(const Asset&) ;
+	Asset& operator=(const Asset&) ;
+};
+
+struct AssetPackStats
+{
+	int packLoads ;				// assets found in the pack
+	int fileLoads ;				// assets opened as loose files
+	int failed ;				// assets found nowhere
+	size_t bytesDecompressed ;
+};
+
+/*
+Read-only archive of the media files of a demo, built with Common/Tools/PackTool.
+
+The whole pack is one mapping, so loading its assets costs one file open instead of one
+per file, and stored entries are used in place. Load falls back to the loose file when
+the pack is not open or has no entry of that name, so a demo runs the same from its
+source tree and from a packed build.
+*/
+class AssetPack
+{
+public:
+	AssetPack(void);
+	~AssetPack(void);
+
+	bool Open(const char* path) ;
+#ifdef _WIN32
+	bool Open(const wchar_t* path) ;
+#endif
+
+	// Use a pack already in memory, the memory must stay valid until the pack is closed
+	bool OpenMemory(const unsigned char* data, size_t size) ;
+
+	void Close() ;
+
+	bool IsOpen() const { return m_pHeader != NULL ; }
+
+	PACK_ERROR Error() const { return m_Error ; }
+
+	// Index of the entry, -1 if the pack does not have it
+	int Find(const char* name) const ;
+
+	int Count() const { return m_pHeader ? (int)m_pHeader->entryCount : 0 ; }
+
+	const PackEntry& Entry(int index) const { return m_pEntries[index] ; }
+
+	const char* Name(int index) const { return m_pNames + m_pEntries[index].nameOffset ; }
+
+	// The entry bytes as stored, compressed for PACK_LZ4 entries
+	const unsigned char* EntryData(int index) const { return m_pData + (size_t)m_pEntries[index].offset ; }
+
+	// Decompress or copy an entry into out, which has room for Entry(index).size bytes
+	bool Extract(int index, unsigned char* out) const ;
+
+	// Extract the entry and compare its checksum
+	bool Verify(int index) const ;
+
+	// Load from the pack, or from the loose file if the pack does not have the name
+	bool Load(const char* name, Asset& asset) ;
+#ifdef _WIN32
+	bool Load(const wchar_t* name, Asset& asset) ;
+#endif
+
+	const AssetPackStats& Stats() const { return m_Stats ; }
+
+private:
+	bool Attach(const unsigned char* data, size_t size) ;
+	bool Index() ;
+	bool LoadEntry(const char* name, Asset& asset) ;
+
+	MappedFile m_File ;
+	const unsigned char* m_pData ;
+	size_t m_Size ;
+	const PackHeader* m_pHeader ;
+	const PackEntry* m_pEntries ;
+	const char* m_pNames ;
+	PACK_ERROR m_Error ;
+	AssetPackStats m_Stats ;
+
+	AssetPack(const AssetPack&) ;
+	AssetPack& operator=(const AssetPack&) ;
+};
+
+#endif // end __ASSET_PACK_H__
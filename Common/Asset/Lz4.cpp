@@ -0,0 +1,251 @@
+#include "Lz4.h"
+
+#include <string.h>
+
+#define HASH_BITS 12
+#define HASH_SIZE (1 << HASH_BITS)
+
+static const size_t MIN_MATCH = 4 ;
+static const size_t MAX_OFFSET = 65535 ;
+
+// The format ends every block with at least 5 literals, and the last match starts
+// at least 12 bytes before the end, so decoders may copy in 8 byte steps
+static const size_t LAST_LITERALS = 5 ;
+static const size_t MATCH_FIND_LIMIT = 12 ;
+
+static unsigned int Read32(const unsigned char* p)
+{
+	unsigned int value ;
+	memcpy(&value, p, 4) ;
+	return value ;
+}
+
+static unsigned int Hash(unsigned int sequence)
+{
+	return (sequence * 2654435761U) >> (32 - HASH_BITS) ;
+}
+
+// Lengths of 15 and more continue in bytes of 255 after the token
+static unsigned char* WriteLength(unsigned char* out, size_t length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255 ;
+		length -= 255 ;
+	}
+	*out++ = (unsigned char)length ;
+	return out ;
+}
+
+static bool ReadLength(const unsigned char*& in, const unsigned char* end, size_t& length)
+{
+	unsigned int byte ;
+	do
+	{
+		if (in >= end)
+		{
+			return false ;
+		}
+		byte = *in++ ;
+		length += byte ;
+	} while (byte == 255) ;
+	return true ;
+}
+
+static unsigned char* WriteLiterals(unsigned char* out, unsigned char* token, const unsigned char* literals, size_t count)
+{
+	if (count >= 15)
+	{
+		*token = 15 << 4 ;
+		out = WriteLength(out, count - 15) ;
+	}
+	else
+	{
+		*token = (unsigned char)(count << 4) ;
+	}
+
+	// An empty input comes with no literals at all, possibly a null pointer
+	if (count > 0)
+	{
+		memcpy(out, literals, count) ;
+	}
+	return out + count ;
+}
+
+size_t Lz4CompressBound(size_t size)
+{
+	return size + size / 255 + 16 ;
+}
+
+size_t Lz4Compress(const unsigned char* data, size_t size, unsigned char* out)
+{
+	const unsigned char* end = data + size ;
+	const unsigned char* anchor = data ;
+	unsigned char* op = out ;
+
+	if (size > MATCH_FIND_LIMIT)
+	{
+		// Position of the last 4 bytes seen with each hash, offsets from data
+		unsigned int table[HASH_SIZE] ;
+		memset(table, 0, sizeof(table)) ;
+
+		const unsigned char* matchFindLimit = end - MATCH_FIND_LIMIT ;
+		const unsigned char* matchEndLimit = end - LAST_LITERALS ;
+		const unsigned char* ip = data ;
+		unsigned int misses = 0 ;
+
+		while (ip <= matchFindLimit)
+		{
+			unsigned int sequence = Read32(ip) ;
+			unsigned int hash = Hash(sequence) ;
+			const unsigned char* ref = data + table[hash] ;
+			table[hash] = (unsigned int)(ip - data) ;
+
+			if (ref >= ip || (size_t)(ip - ref) > MAX_OFFSET || Read32(ref) != sequence)
+			{
+				// Step faster through data that does not compress
+				ip += 1 + (misses++ >> 6) ;
+				continue ;
+			}
+			misses = 0 ;
+
+			// Take in equal bytes before the match that were emitted as literals
+			while (ip > anchor && ref > data && ip[-1] == ref[-1])
+			{
+				--ip ;
+				--ref ;
+			}
+
+			const unsigned char* matchEnd = ip + MIN_MATCH ;
+			ref += MIN_MATCH ;
+			while (matchEnd < matchEndLimit && *matchEnd == *ref)
+			{
+				++matchEnd ;
+				++ref ;
+			}
+
+			unsigned char* token = op++ ;
+			op = WriteLiterals(op, token, anchor, ip - anchor) ;
+
+			size_t offset = (size_t)(matchEnd - ref) ;
+			*op++ = (unsigned char)offset ;
+			*op++ = (unsigned char)(offset >> 8) ;
+
+			size_t matchLength = (size_t)(matchEnd - ip) - MIN_MATCH ;
+			if (matchLength >= 15)
+			{
+				*token |= 15 ;
+				op = WriteLength(op, matchLength - 15) ;
+			}
+			else
+			{
+				*token |= (unsigned char)matchLength ;
+			}
+
+			ip = matchEnd ;
+			anchor = ip ;
+		}
+	}
+
+	// The rest of the block is one sequence of literals without a match
+	unsigned char* token = op++ ;
+	op = WriteLiterals(op, token, anchor, end - anchor) ;
+
+	return (size_t)(op - out) ;
+}
+
+bool Lz4Decompress(const unsigned char* data, size_t size, unsigned char* out, size_t outSize)
+{
+	const unsigned char* ip = data ;
+	const unsigned char* end = data + size ;
+	unsigned char* op = out ;
+	unsigned char* outEnd = out + outSize ;
+
+	for (;;)
+	{
+		if (ip >= end)
+		{
+			return false ;
+		}
+
+		unsigned int token = *ip++ ;
+
+		size_t length = token >> 4 ;
+		if (length == 15 && !ReadLength(ip, end, length))
+		{
+			return false ;
+		}
+		if (length > (size_t)(end - ip) || length > (size_t)(outEnd - op))
+		{
+			return false ;
+		}
+
+		// Most literal runs are short, one fixed size copy is faster than a memcpy of the exact length
+		if (length <= 16 && end - ip >= 16 && outEnd - op >= 16)
+		{
+			memcpy(op, ip, 16) ;
+		}
+		else
+		{
+			memcpy(op, ip, length) ;
+		}
+		ip += length ;
+		op += length ;
+
+		// Only the last sequence ends after its literals
+		if (ip == end)
+		{
+			return op == outEnd ;
+		}
+
+		if (end - ip < 2)
+		{
+			return false ;
+		}
+		size_t offset = ip[0] | ((size_t)ip[1] << 8) ;
+		ip += 2 ;
+		if (offset == 0 || offset > (size_t)(op - out))
+		{
+			return false ;
+		}
+
+		length = token & 15 ;
+		if (length == 15 && !ReadLength(ip, end, length))
+		{
+			return false ;
+		}
+		length += MIN_MATCH ;
+		if (length > (size_t)(outEnd - op))
+		{
+			return false ;
+		}
+
+		const unsigned char* match = op - offset ;
+		if (offset >= 8 && (size_t)(outEnd - op) >= length + 8)
+		{
+			// Copy in 8 byte steps, the last step may write up to 7 bytes past the match
+			// that the next sequence overwrites
+			for (size_t i = 0; i < length; i += 8)
+			{
+				memcpy(op + i, match + i, 8) ;
+			}
+			op += length ;
+		}
+		else
+		{
+			// A match may overlap the bytes it produces, offset 1 repeats one byte. The bytes
+			// from match to op repeat, so copy them, then twice as many, and so on.
+			unsigned char* matchEnd = op + length ;
+			while (op < matchEnd)
+			{
+				size_t count = (size_t)(op - match) ;
+				if (count > (size_t)(matchEnd - op))
+				{
+					count = (size_t)(matchEnd - op) ;
+				}
+				memcpy(op, match, count) ;
+				op += count ;
+			}
+		}
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+#include <stddef.h>
+
+/*
+LZ4 block compression, the raw block format without the frame header.
+
+Decompression only copies literals and earlier output, so it runs at memory speed and
+is cheap enough to do on every load. The compressor is the greedy single-hash search of
+the reference "fast" mode, blocks it writes can be read by any LZ4 implementation.
+*/
+
+// Largest compressed size of size bytes, the output buffer of Lz4Compress needs this much room
+size_t Lz4CompressBound(size_t size) ;
+
+// Compress size bytes into out, return the compressed size
+size_t Lz4Compress(const unsigned char* data, size_t size, unsigned char* out) ;
+
+// Decompress a block that must expand to exactly outSize bytes.
+// Return false for corrupt input, nothing is read or written outside the two buffers.
+bool Lz4Decompress(const unsigned char* data, size_t size, unsigned char* out, size_t outSize) ;
+
+#endif // end __LZ4_H__
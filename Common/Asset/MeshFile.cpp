@@ -0,0 +1,423 @@
+#include "MeshFile.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const unsigned int NO_VERTEX = 0xffffffff ;
+
+const char* MeshFileErrorText(MESH_FILE_ERROR error)
+{
+	switch (error)
+	{
+	case MESH_FILE_OK:			return "no error" ;
+	case MESH_FILE_CANNOT_OPEN:	return "cannot open the mesh file" ;
+	case MESH_FILE_NOT_MESH:	return "not a mesh file of this version" ;
+	case MESH_FILE_STALE:		return "the mesh file was made from another source" ;
+	case MESH_FILE_BAD_LAYOUT:	return "the mesh file is damaged" ;
+	}
+	return "unknown error" ;
+}
+
+unsigned long long MeshFileKey(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data) ;
+	unsigned long long hash = 14695981039346656037ULL ;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i] ;
+		hash *= 1099511628211ULL ;
+	}
+	return hash ;
+}
+
+MeshFileSource::MeshFileSource(void)
+	: vertices(NULL),
+	  vertexStride(0),
+	  vertexCount(0),
+	  vertexFormat(0),
+	  indices(NULL),
+	  indexSize(0),
+	  indexCount(0),
+	  sourceKey(0),
+	  meshlets(false)
+{
+}
+
+static size_t AlignUp(size_t size)
+{
+	return (size + MESH_FILE_ALIGNMENT - 1) & ~(size_t)(MESH_FILE_ALIGNMENT - 1) ;
+}
+
+static unsigned int SourceIndex(const MeshFileSource& source, size_t i)
+{
+	return source.indexSize == 2 ? ((const unsigned short*)source.indices)[i] : ((const unsigned int*)source.indices)[i] ;
+}
+
+static const float* SourcePosition(const MeshFileSource& source, unsigned int vertex)
+{
+	return (const float*)((const unsigned char*)source.vertices + (size_t)vertex * source.vertexStride) ;
+}
+
+static void CloseMeshlet(const MeshFileSource& source, MeshFileMeshlet& meshlet, const std::vector<unsigned int>& vertices)
+{
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX } ;
+	float high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX } ;
+	for (unsigned int i = meshlet.vertexOffset; i < meshlet.vertexOffset + meshlet.vertexCount; ++i)
+	{
+		const float* p = SourcePosition(source, vertices[i]) ;
+		for (int j = 0; j < 3; ++j)
+		{
+			low[j] = p[j] < low[j] ? p[j] : low[j] ;
+			high[j] = p[j] > high[j] ? p[j] : high[j] ;
+		}
+	}
+
+	float radius = 0.0f ;
+	for (int j = 0; j < 3; ++j)
+	{
+		meshlet.center[j] = (low[j] + high[j]) * 0.5f ;
+	}
+	for (unsigned int i = meshlet.vertexOffset; i < meshlet.vertexOffset + meshlet.vertexCount; ++i)
+	{
+		const float* p = SourcePosition(source, vertices[i]) ;
+		float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2] ;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz) ;
+		radius = distance > radius ? distance : radius ;
+	}
+	meshlet.radius = radius ;
+}
+
+/*
+Meshlets in index order: triangles are added to the current meshlet until one more
+would pass a limit. Index lists ordered for the vertex cache keep neighbours together,
+which is what makes the meshlets small and round.
+*/
+static void BuildMeshlets(const MeshFileSource& source, std::vector<MeshFileMeshlet>& meshlets,
+						  std::vector<unsigned int>& vertices, std::vector<unsigned char>& triangles)
+{
+	std::vector<unsigned int> local(source.vertexCount, NO_VERTEX) ;
+
+	MeshFileMeshlet meshlet ;
+	memset(&meshlet, 0, sizeof(meshlet)) ;
+	for (size_t triangle = 0; triangle < source.indexCount / 3; ++triangle)
+	{
+		unsigned int corners[3] ;
+		unsigned int added = 0 ;
+		for (int j = 0; j < 3; ++j)
+		{
+			corners[j] = SourceIndex(source, triangle * 3 + j) ;
+			bool repeated = (j > 0 && corners[j] == corners[0]) || (j > 1 && corners[j] == corners[1]) ;
+			added += local[corners[j]] == NO_VERTEX && !repeated ? 1 : 0 ;
+		}
+
+		if (meshlet.vertexCount + added > MESHLET_MAX_VERTICES || meshlet.triangleCount == MESHLET_MAX_TRIANGLES)
+		{
+			CloseMeshlet(source, meshlet, vertices) ;
+			meshlets.push_back(meshlet) ;
+			for (unsigned int i = meshlet.vertexOffset; i < meshlet.vertexOffset + meshlet.vertexCount; ++i)
+			{
+				local[vertices[i]] = NO_VERTEX ;
+			}
+			memset(&meshlet, 0, sizeof(meshlet)) ;
+			meshlet.vertexOffset = (unsigned int)vertices.size() ;
+			meshlet.triangleOffset = (unsigned int)(triangles.size() / 3) ;
+		}
+
+		for (int j = 0; j < 3; ++j)
+		{
+			if (local[corners[j]] == NO_VERTEX)
+			{
+				local[corners[j]] = meshlet.vertexCount++ ;
+				vertices.push_back(corners[j]) ;
+			}
+			triangles.push_back((unsigned char)local[corners[j]]) ;
+		}
+		++meshlet.triangleCount ;
+	}
+
+	if (meshlet.triangleCount > 0)
+	{
+		CloseMeshlet(source, meshlet, vertices) ;
+		meshlets.push_back(meshlet) ;
+	}
+}
+
+bool BuildMeshFile(const MeshFileSource& source, std::vector<unsigned char>& out)
+{
+	out.clear() ;
+	if ((source.vertexCount > 0 && !source.vertices) || (source.indexCount > 0 && !source.indices) ||
+		source.vertexStride < 3 * sizeof(float) || source.vertexStride % 4 != 0 ||
+		(source.indexSize != 2 && source.indexSize != 4) || source.indexCount % 3 != 0)
+	{
+		return false ;
+	}
+	for (size_t i = 0; i < source.indexCount; ++i)
+	{
+		if (SourceIndex(source, i) >= source.vertexCount)
+		{
+			return false ;
+		}
+	}
+
+	std::vector<MeshFileMeshlet> meshlets ;
+	std::vector<unsigned int> meshletVertices ;
+	std::vector<unsigned char> meshletTriangles ;
+	if (source.meshlets)
+	{
+		BuildMeshlets(source, meshlets, meshletVertices, meshletTriangles) ;
+	}
+
+	MeshFileHeader header ;
+	memset(&header, 0, sizeof(header)) ;
+	header.magic = MESH_FILE_MAGIC ;
+	header.version = MESH_FILE_VERSION ;
+	header.sourceKey = source.sourceKey ;
+	header.vertexFormat = source.vertexFormat ;
+	header.vertexStride = source.vertexStride ;
+	header.vertexCount = source.vertexCount ;
+	header.indexSize = source.indexSize ;
+	header.indexCount = source.indexCount ;
+	header.meshletCount = (unsigned int)meshlets.size() ;
+	header.meshletVertexCount = (unsigned int)meshletVertices.size() ;
+	header.meshletTriangleCount = (unsigned int)(meshletTriangles.size() / 3) ;
+
+	for (int j = 0; j < 3; ++j)
+	{
+		header.boundsMin[j] = source.vertexCount > 0 ? FLT_MAX : 0.0f ;
+		header.boundsMax[j] = source.vertexCount > 0 ? -FLT_MAX : 0.0f ;
+	}
+	for (unsigned int i = 0; i < source.vertexCount; ++i)
+	{
+		const float* p = SourcePosition(source, i) ;
+		for (int j = 0; j < 3; ++j)
+		{
+			header.boundsMin[j] = p[j] < header.boundsMin[j] ? p[j] : header.boundsMin[j] ;
+			header.boundsMax[j] = p[j] > header.boundsMax[j] ? p[j] : header.boundsMax[j] ;
+		}
+	}
+
+	size_t vertexBytes = (size_t)source.vertexCount * source.vertexStride ;
+	size_t indexBytes = (size_t)source.indexCount * source.indexSize ;
+	size_t offset = AlignUp(sizeof(header)) ;
+	header.vertexOffset = offset ;
+	offset = AlignUp(offset + vertexBytes) ;
+	header.indexOffset = offset ;
+	offset = AlignUp(offset + indexBytes) ;
+	header.meshletOffset = offset ;
+	offset = AlignUp(offset + meshlets.size() * sizeof(MeshFileMeshlet)) ;
+	header.meshletVertexOffset = offset ;
+	offset = AlignUp(offset + meshletVertices.size() * sizeof(unsigned int)) ;
+	header.meshletTriangleOffset = offset ;
+	offset += meshletTriangles.size() ;
+
+	out.resize(offset, 0) ;
+	memcpy(&out[0], &header, sizeof(header)) ;
+	if (vertexBytes > 0)
+	{
+		memcpy(&out[(size_t)header.vertexOffset], source.vertices, vertexBytes) ;
+	}
+	if (indexBytes > 0)
+	{
+		memcpy(&out[(size_t)header.indexOffset], source.indices, indexBytes) ;
+	}
+	if (!meshlets.empty())
+	{
+		memcpy(&out[(size_t)header.meshletOffset], &meshlets[0], meshlets.size() * sizeof(MeshFileMeshlet)) ;
+		memcpy(&out[(size_t)header.meshletVertexOffset], &meshletVertices[0], meshletVertices.size() * sizeof(unsigned int)) ;
+		memcpy(&out[(size_t)header.meshletTriangleOffset], &meshletTriangles[0], meshletTriangles.size()) ;
+	}
+	return true ;
+}
+
+bool WriteMeshFile(const char* path, const MeshFileSource& source)
+{
+	std::vector<unsigned char> data ;
+	if (!BuildMeshFile(source, data))
+	{
+		return false ;
+	}
+
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	bool written = fwrite(&data[0], 1, data.size(), file) == data.size() ;
+	return fclose(file) == 0 && written ;
+}
+
+MeshFile::MeshFile(void)
+	: m_pData(NULL),
+	  m_Size(0),
+	  m_pHeader(NULL),
+	  m_Error(MESH_FILE_OK)
+{
+}
+
+MeshFile::~MeshFile(void)
+{
+	Close() ;
+}
+
+bool MeshFile::Open(const char* path, unsigned long long sourceKey)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_Error = MESH_FILE_CANNOT_OPEN ;
+		return false ;
+	}
+	return Attach(m_File.Data(), m_File.Size(), sourceKey) ;
+}
+
+#ifdef _WIN32
+bool MeshFile::Open(const wchar_t* path, unsigned long long sourceKey)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_Error = MESH_FILE_CANNOT_OPEN ;
+		return false ;
+	}
+	return Attach(m_File.Data(), m_File.Size(), sourceKey) ;
+}
+#endif
+
+bool MeshFile::OpenMemory(const unsigned char* data, size_t size, unsigned long long sourceKey)
+{
+	Close() ;
+	return Attach(data, size, sourceKey) ;
+}
+
+bool MeshFile::Attach(const unsigned char* data, size_t size, unsigned long long sourceKey)
+{
+	m_pData = data ;
+	m_Size = size ;
+	m_pHeader = (const MeshFileHeader*)data ;
+
+	if (m_Size < sizeof(MeshFileHeader) || m_pHeader->magic != MESH_FILE_MAGIC || m_pHeader->version != MESH_FILE_VERSION)
+	{
+		m_Error = MESH_FILE_NOT_MESH ;
+	}
+	else if (m_pHeader->sourceKey != sourceKey)
+	{
+		m_Error = MESH_FILE_STALE ;
+	}
+	else if (!CheckLayout())
+	{
+		m_Error = MESH_FILE_BAD_LAYOUT ;
+	}
+	else
+	{
+		m_Error = MESH_FILE_OK ;
+		return true ;
+	}
+
+	Close() ;
+	return false ;
+}
+
+void MeshFile::Close()
+{
+	// Keep the error of a failed open, Close is called on the way out of it
+	MESH_FILE_ERROR error = m_Error ;
+
+	m_File.Close() ;
+	m_pData = NULL ;
+	m_Size = 0 ;
+	m_pHeader = NULL ;
+
+	m_Error = error ;
+}
+
+// Every stream inside the file and aligned, so the accessors can trust the header
+bool MeshFile::CheckLayout()
+{
+	const MeshFileHeader& header = *m_pHeader ;
+	if (header.vertexStride < 3 * sizeof(float) || header.vertexStride % 4 != 0 ||
+		(header.indexSize != 2 && header.indexSize != 4) || header.indexCount % 3 != 0 ||
+		header.meshletTriangleCount > header.indexCount / 3)
+	{
+		return false ;
+	}
+
+	struct Stream
+	{
+		unsigned long long offset ;
+		unsigned long long bytes ;
+	};
+	Stream streams[5] =
+	{
+		{ header.vertexOffset, (unsigned long long)header.vertexCount * header.vertexStride },
+		{ header.indexOffset, (unsigned long long)header.indexCount * header.indexSize },
+		{ header.meshletOffset, (unsigned long long)header.meshletCount * sizeof(MeshFileMeshlet) },
+		{ header.meshletVertexOffset, (unsigned long long)header.meshletVertexCount * sizeof(unsigned int) },
+		{ header.meshletTriangleOffset, (unsigned long long)header.meshletTriangleCount * 3 },
+	} ;
+	for (int i = 0; i < 5; ++i)
+	{
+		if (streams[i].offset % MESH_FILE_ALIGNMENT != 0 || streams[i].offset < sizeof(MeshFileHeader) ||
+			streams[i].offset > m_Size || streams[i].bytes > m_Size - streams[i].offset)
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+bool MeshFile::Verify() const
+{
+	if (!IsOpen())
+	{
+		return false ;
+	}
+
+	const MeshFileHeader& header = *m_pHeader ;
+	const unsigned short* shorts = (const unsigned short*)Indices() ;
+	const unsigned int* ints = (const unsigned int*)Indices() ;
+	for (unsigned int i = 0; i < header.indexCount; ++i)
+	{
+		unsigned int index = header.indexSize == 2 ? shorts[i] : ints[i] ;
+		if (index >= header.vertexCount)
+		{
+			return false ;
+		}
+	}
+
+	const MeshFileMeshlet* meshlets = Meshlets() ;
+	const unsigned int* vertices = MeshletVertices() ;
+	const unsigned char* triangles = MeshletTriangles() ;
+	for (unsigned int i = 0; i < header.meshletCount; ++i)
+	{
+		const MeshFileMeshlet& meshlet = meshlets[i] ;
+		if (meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES ||
+			meshlet.vertexOffset > header.meshletVertexCount || meshlet.vertexCount > header.meshletVertexCount - meshlet.vertexOffset ||
+			meshlet.triangleOffset > header.meshletTriangleCount || meshlet.triangleCount > header.meshletTriangleCount - meshlet.triangleOffset)
+		{
+			return false ;
+		}
+		for (unsigned int j = 0; j < meshlet.vertexCount; ++j)
+		{
+			if (vertices[meshlet.vertexOffset + j] >= header.vertexCount)
+			{
+				return false ;
+			}
+		}
+		for (unsigned int j = 0; j < meshlet.triangleCount * 3; ++j)
+		{
+			if (triangles[meshlet.triangleOffset * 3 + j] >= meshlet.vertexCount)
+			{
+				return false ;
+			}
+		}
+	}
+	return true ;
+}
@@ -0,0 +1,164 @@
+#ifndef __MESH_FILE_H__
+#define __MESH_FILE_H__
+
+#include <stddef.h>
+#include <vector>
+#include "../Utility/MappedFile.h"
+
+/*
+File layout of a mesh file, all numbers little-endian:
+
+	MeshFileHeader
+	vertices				vertexCount * vertexStride bytes, the position first in every vertex
+	indices					indexCount * indexSize bytes, a triangle list
+	MeshFileMeshlet[meshletCount]
+	meshlet vertices		unsigned int, indices into the vertices
+	meshlet triangles		three bytes per triangle, indices into the meshlet vertices
+
+Every stream starts at a multiple of MESH_FILE_ALIGNMENT, so the vertices and indices
+can be copied into a locked buffer, or read with SIMD loads, straight from the mapping.
+
+The file is a cache for meshes that are generated or converted at startup. The header
+carries a key of whatever the mesh was made from, the generator parameters or the hash
+of a source file, and a file with another key is refused, so the caller builds the mesh
+again and writes a new file.
+*/
+
+#define MESH_FILE_MAGIC			0x4853454D	// "MESH"
+#define MESH_FILE_VERSION		1
+#define MESH_FILE_ALIGNMENT		16
+
+// Meshlet limits, within what mesh shader hardware takes in one group
+#define MESHLET_MAX_VERTICES	64
+#define MESHLET_MAX_TRIANGLES	126
+
+struct MeshFileHeader
+{
+	unsigned int magic ;
+	unsigned int version ;
+	unsigned long long sourceKey ;
+	unsigned int vertexFormat ;		// for the application, the FVF in the D3D9 demos
+	unsigned int vertexStride ;
+	unsigned int vertexCount ;
+	unsigned int indexSize ;		// 2 or 4
+	unsigned int indexCount ;
+	unsigned int meshletCount ;
+	unsigned int meshletVertexCount ;
+	unsigned int meshletTriangleCount ;
+	float boundsMin[3] ;
+	float boundsMax[3] ;
+	unsigned long long vertexOffset ;	// of each stream, from the start of the file
+	unsigned long long indexOffset ;
+	unsigned long long meshletOffset ;
+	unsigned long long meshletVertexOffset ;
+	unsigned long long meshletTriangleOffset ;
+};
+
+// Up to MESHLET_MAX_TRIANGLES triangles over up to MESHLET_MAX_VERTICES vertices
+struct MeshFileMeshlet
+{
+	unsigned int vertexOffset ;		// into the meshlet vertices
+	unsigned int vertexCount ;
+	unsigned int triangleOffset ;	// into the meshlet triangles, in triangles
+	unsigned int triangleCount ;
+	float center[3] ;				// bounding sphere, for culling
+	float radius ;
+};
+
+enum MESH_FILE_ERROR
+{
+	MESH_FILE_OK,
+	MESH_FILE_CANNOT_OPEN,
+	MESH_FILE_NOT_MESH,			// wrong magic or version
+	MESH_FILE_STALE,			// made from something else than the key asks for
+	MESH_FILE_BAD_LAYOUT,		// a stream lies outside the file or is not aligned
+};
+
+const char* MeshFileErrorText(MESH_FILE_ERROR error) ;
+
+// 64 bit FNV-1a, to make a source key from generator parameters or source bytes
+unsigned long long MeshFileKey(const void* data, size_t size) ;
+
+// What WriteMeshFile stores, the vertices and indices are copied
+struct MeshFileSource
+{
+	const void* vertices ;			// three floats of position first in every vertex
+	unsigned int vertexStride ;		// a multiple of 4
+	unsigned int vertexCount ;
+	unsigned int vertexFormat ;
+	const void* indices ;
+	unsigned int indexSize ;		// 2 or 4
+	unsigned int indexCount ;
+	unsigned long long sourceKey ;
+	bool meshlets ;					// split the triangles into meshlets too
+
+	MeshFileSource(void) ;
+};
+
+// Replace the content of out with the file, false if the source is not a valid triangle list
+bool BuildMeshFile(const MeshFileSource& source, std::vector<unsigned char>& out) ;
+
+bool WriteMeshFile(const char* path, const MeshFileSource& source) ;
+
+/*
+A mesh file mapped for reading.
+
+Open checks the header and where the streams lie and does nothing else, no stream is
+read or copied, so opening costs the same for any mesh size and the pointers go straight
+into the mapping. They are valid until the file is closed. Verify reads the indices and
+meshlets once, for files that may have been damaged.
+*/
+class MeshFile
+{
+public:
+	MeshFile(void);
+	~MeshFile(void);
+
+	bool Open(const char* path, unsigned long long sourceKey) ;
+#ifdef _WIN32
+	bool Open(const wchar_t* path, unsigned long long sourceKey) ;
+#endif
+
+	// Use a file already in memory, the memory must stay valid until the file is closed
+	bool OpenMemory(const unsigned char* data, size_t size, unsigned long long sourceKey) ;
+
+	void Close() ;
+
+	bool IsOpen() const { return m_pHeader != NULL ; }
+
+	MESH_FILE_ERROR Error() const { return m_Error ; }
+
+	const MeshFileHeader& Header() const { return *m_pHeader ; }
+
+	const void* Vertices() const { return m_pData + (size_t)m_pHeader->vertexOffset ; }
+
+	size_t VertexBytes() const { return (size_t)m_pHeader->vertexCount * m_pHeader->vertexStride ; }
+
+	const void* Indices() const { return m_pData + (size_t)m_pHeader->indexOffset ; }
+
+	size_t IndexBytes() const { return (size_t)m_pHeader->indexCount * m_pHeader->indexSize ; }
+
+	const MeshFileMeshlet* Meshlets() const { return (const MeshFileMeshlet*)(m_pData + (size_t)m_pHeader->meshletOffset) ; }
+
+	const unsigned int* MeshletVertices() const { return (const unsigned int*)(m_pData + (size_t)m_pHeader->meshletVertexOffset) ; }
+
+	const unsigned char* MeshletTriangles() const { return m_pData + (size_t)m_pHeader->meshletTriangleOffset ; }
+
+	// Every index inside the vertices and every meshlet inside its streams
+	bool Verify() const ;
+
+private:
+	bool Attach(const unsigned char* data, size_t size, unsigned long long sourceKey) ;
+	bool CheckLayout() ;
+
+	MappedFile m_File ;
+	const unsigned char* m_pData ;
+	size_t m_Size ;
+	const MeshFileHeader* m_pHeader ;
+	MESH_FILE_ERROR m_Error ;
+
+	MeshFile(const MeshFile&) ;
+	MeshFile& operator=(const MeshFile&) ;
+};
+
+#endif // end __MESH_FILE_H__
@@ -0,0 +1,216 @@
+#include "PackWriter.h"
+#include "Lz4.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+PackWriter::PackWriter(void)
+	: m_Alignment(16),
+	  m_bCompress(false),
+	  m_pError("no error")
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+PackWriter::~PackWriter(void)
+{
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		delete m_Sources[i] ;
+	}
+}
+
+void PackWriter::SetAlignment(unsigned int alignment)
+{
+	// Round up to a power of two, 8 at least so the index stays aligned
+	m_Alignment = 8 ;
+	while (m_Alignment < alignment)
+	{
+		m_Alignment <<= 1 ;
+	}
+}
+
+bool PackWriter::AddData(const char* name, const void* data, size_t size)
+{
+	std::string key = NormalizePackName(name) ;
+	if (key.empty())
+	{
+		m_pError = "empty entry name" ;
+		return false ;
+	}
+
+	for (size_t i = 0; i < m_Sources.size(); ++i)
+	{
+		if (m_Sources[i]->name == key)
+		{
+			m_pError = "entry name added twice" ;
+			return false ;
+		}
+	}
+
+	Source* source = new Source ;
+	source->name = key ;
+	source->hash = PackNameHash(key.c_str(), key.size()) ;
+	source->data.assign((const unsigned char*)data, (const unsigned char*)data + size) ;
+	m_Sources.push_back(source) ;
+
+	return true ;
+}
+
+bool PackWriter::AddFile(const char* name, const char* path)
+{
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "rb") ;
+#else
+	file = fopen(path, "rb") ;
+#endif
+	if (!file)
+	{
+		m_pError = "cannot open file" ;
+		return false ;
+	}
+
+	std::vector<unsigned char> data ;
+	unsigned char buffer[65536] ;
+	size_t count ;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + count) ;
+	}
+
+	bool failed = ferror(file) != 0 ;
+	fclose(file) ;
+	if (failed)
+	{
+		m_pError = "cannot read file" ;
+		return false ;
+	}
+
+	return AddData(name, data.empty() ? NULL : &data[0], data.size()) ;
+}
+
+bool PackWriter::CompareSources(const Source* a, const Source* b)
+{
+	if (a->hash != b->hash)
+	{
+		return a->hash < b->hash ;
+	}
+	return a->name < b->name ;
+}
+
+void PackWriter::Build(std::vector<unsigned char>& out)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+
+	std::vector<Source*> sources(m_Sources) ;
+	std::sort(sources.begin(), sources.end(), CompareSources) ;
+
+	size_t count = sources.size() ;
+	std::vector<PackEntry> entries(count) ;
+
+	std::string names ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		PackEntry& entry = entries[i] ;
+		memset(&entry, 0, sizeof(entry)) ;
+		entry.hash = sources[i]->hash ;
+		entry.nameOffset = (unsigned int)names.size() ;
+		entry.nameLength = (unsigned int)sources[i]->name.size() ;
+		names += sources[i]->name ;
+		names += '\0' ;
+	}
+
+	PackHeader header ;
+	memset(&header, 0, sizeof(header)) ;
+	header.magic = PACK_MAGIC ;
+	header.version = PACK_VERSION ;
+	header.entryCount = (unsigned int)count ;
+	header.alignment = m_Alignment ;
+	header.namesOffset = sizeof(PackHeader) + count * sizeof(PackEntry) ;
+	header.namesBytes = (unsigned int)names.size() ;
+
+	out.clear() ;
+	out.resize((size_t)header.namesOffset + names.size()) ;
+	if (!names.empty())
+	{
+		memcpy(&out[(size_t)header.namesOffset], names.c_str(), names.size()) ;
+	}
+
+	std::vector<unsigned char> packed ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const std::vector<unsigned char>& data = sources[i]->data ;
+		PackEntry& entry = entries[i] ;
+
+		entry.size = data.size() ;
+		entry.checksum = PackChecksum(data.empty() ? NULL : &data[0], data.size()) ;
+
+		const unsigned char* bytes = data.empty() ? NULL : &data[0] ;
+		size_t bytesSize = data.size() ;
+		entry.compression = PACK_STORED ;
+
+		if (m_bCompress && !data.empty())
+		{
+			packed.resize(Lz4CompressBound(data.size())) ;
+			size_t packedSize = Lz4Compress(&data[0], data.size(), &packed[0]) ;
+			if (packedSize <= data.size() - data.size() / 16)
+			{
+				bytes = &packed[0] ;
+				bytesSize = packedSize ;
+				entry.compression = PACK_LZ4 ;
+				++m_Stats.compressed ;
+			}
+		}
+
+		size_t offset = (out.size() + m_Alignment - 1) & ~(size_t)(m_Alignment - 1) ;
+		out.resize(offset + bytesSize) ;
+		if (bytesSize > 0)
+		{
+			memcpy(&out[offset], bytes, bytesSize) ;
+		}
+
+		entry.offset = offset ;
+		entry.packedSize = bytesSize ;
+
+		++m_Stats.entries ;
+		m_Stats.bytes += data.size() ;
+		m_Stats.packedBytes += bytesSize ;
+	}
+
+	memcpy(&out[0], &header, sizeof(header)) ;
+	if (count > 0)
+	{
+		memcpy(&out[sizeof(PackHeader)], &entries[0], count * sizeof(PackEntry)) ;
+	}
+
+	m_Stats.packSize = out.size() ;
+}
+
+bool PackWriter::Write(const char* path)
+{
+	std::vector<unsigned char> pack ;
+	Build(pack) ;
+
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		m_pError = "cannot create pack file" ;
+		return false ;
+	}
+
+	bool written = fwrite(&pack[0], 1, pack.size(), file) == pack.size() ;
+	if (fclose(file) != 0 || !written)
+	{
+		m_pError = "cannot write pack file" ;
+		return false ;
+	}
+
+	return true ;
+}
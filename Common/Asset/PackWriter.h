@@ -0,0 +1,73 @@
+#ifndef __PACK_WRITER_H__
+#define __PACK_WRITER_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "AssetPack.h"
+
+struct PackWriterStats
+{
+	int entries ;
+	int compressed ;			// entries stored as LZ4
+	size_t bytes ;				// size of all entries before compression
+	size_t packedBytes ;		// size of all entries in the pack
+	size_t packSize ;			// size of the whole pack, with index and padding
+};
+
+/*
+Builds an asset pack, see AssetPack.h for the layout.
+
+Entries are collected in memory and written in one go by Build, which sorts the index,
+aligns every entry and, when compression is on, keeps the LZ4 version of an entry only if
+it saves at least 1/16 of its size, so JPEG and other compressed media stay stored
+and can be used in place.
+*/
+class PackWriter
+{
+public:
+	PackWriter(void);
+	~PackWriter(void);
+
+	// Entry alignment in bytes, a power of two, 16 by default so SIMD loads can use the data in place
+	void SetAlignment(unsigned int alignment) ;
+
+	void SetCompression(bool lz4) { m_bCompress = lz4 ; }
+
+	// Add a copy of data under name, false if the name was added before
+	bool AddData(const char* name, const void* data, size_t size) ;
+
+	// Read a file and add it under name, false if it cannot be read
+	bool AddFile(const char* name, const char* path) ;
+
+	// Replace the content of out with the pack
+	void Build(std::vector<unsigned char>& out) ;
+
+	bool Write(const char* path) ;
+
+	const PackWriterStats& Stats() const { return m_Stats ; }
+
+	// Why the last call failed
+	const char* ErrorText() const { return m_pError ; }
+
+private:
+	struct Source
+	{
+		std::string name ;		// normalized
+		unsigned long long hash ;
+		std::vector<unsigned char> data ;
+	};
+
+	static bool CompareSources(const Source* a, const Source* b) ;
+
+	std::vector<Source*> m_Sources ;
+	unsigned int m_Alignment ;
+	bool m_bCompress ;
+	PackWriterStats m_Stats ;
+	const char* m_pError ;
+
+	PackWriter(const PackWriter&) ;
+	PackWriter& operator=(const PackWriter&) ;
+};
+
+#endif // end __PACK_WRITER_H__
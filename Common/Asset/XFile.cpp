@@ -0,0 +1,1357 @@
+#include "XFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+
+#include "../Math/Matrix.h"
+#include "../Math/MeshOptimizer.h"
+#include "../Utility/MappedFile.h"
+
+// Tokens of the binary format, each a 16 bit number followed by its data
+enum XTOKEN
+{
+	XTOKEN_NAME = 1,			// DWORD length, characters
+	XTOKEN_STRING = 2,			// DWORD length, characters, then a ';' or ',' token
+	XTOKEN_INTEGER = 3,			// DWORD
+	XTOKEN_GUID = 5,			// 16 bytes
+	XTOKEN_INTEGER_LIST = 6,	// DWORD count, DWORDs
+	XTOKEN_FLOAT_LIST = 7,		// DWORD count, floats or doubles as the header says
+	XTOKEN_OBRACE = 10,
+	XTOKEN_CBRACE = 11,
+	XTOKEN_COMMA = 19,
+	XTOKEN_SEMICOLON = 20,
+	XTOKEN_TEMPLATE = 31,
+};
+
+static const unsigned int NONE = 0xffffffff ;
+
+void XMesh::Clear()
+{
+	vertices.clear() ;
+	indices.clear() ;
+	subsets.clear() ;
+	materials.clear() ;
+}
+
+const char* XFileErrorText(XFILE_ERROR error)
+{
+	switch (error)
+	{
+	case XFILE_OK:			return "no error" ;
+	case XFILE_NOT_XFILE:	return "not a .x file" ;
+	case XFILE_UNSUPPORTED:	return "compressed or unknown .x format" ;
+	case XFILE_SYNTAX:		return "syntax error" ;
+	case XFILE_BAD_INDEX:	return "index out of range" ;
+	case XFILE_NO_MESH:		return "no mesh in the file" ;
+	}
+	return "unknown error" ;
+}
+
+unsigned long long XFileHash(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data) ;
+	unsigned long long hash = 14695981039346656037ULL ;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i] ;
+		hash *= 1099511628211ULL ;
+	}
+	return hash ;
+}
+
+/*
+Reads the values of a text or binary file through the same calls, so the parser does
+not know which one it has. Separators, the ',' and ';' between values and their binary
+tokens, are skipped wherever they are, the parser only asks for the next value.
+*/
+class XReader
+{
+public:
+	enum NEXT
+	{
+		NEXT_END,
+		NEXT_NAME,			// an identifier, or the template keyword
+		NEXT_OPEN,
+		NEXT_CLOSE,
+		NEXT_VALUE,			// a number, string or GUID
+	};
+
+	XReader(const unsigned char* data, size_t size, bool binary, bool doubles)
+		: m_p(data), m_End(data + size), m_bBinary(binary), m_bDoubles(doubles),
+		  m_Integers(0), m_Floats(0), m_bFailed(false)
+	{
+	}
+
+	bool Failed() const { return m_bFailed ; }
+
+	size_t Remaining() const { return (size_t)(m_End - m_p) ; }
+
+	NEXT Peek()
+	{
+		if (m_bBinary)
+		{
+			if (m_Integers > 0 || m_Floats > 0)
+			{
+				return NEXT_VALUE ;
+			}
+			SkipSeparatorTokens() ;
+			if (m_End - m_p < 2)
+			{
+				return NEXT_END ;
+			}
+			switch (Token())
+			{
+			case XTOKEN_NAME:
+			case XTOKEN_TEMPLATE:	return NEXT_NAME ;
+			case XTOKEN_OBRACE:		return NEXT_OPEN ;
+			case XTOKEN_CBRACE:		return NEXT_CLOSE ;
+			}
+			return NEXT_VALUE ;
+		}
+
+		SkipSeparators() ;
+		if (m_p == m_End)
+		{
+			return NEXT_END ;
+		}
+		char c = (char)*m_p ;
+		if (c == '{')
+		{
+			return NEXT_OPEN ;
+		}
+		if (c == '}')
+		{
+			return NEXT_CLOSE ;
+		}
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+		{
+			return NEXT_NAME ;
+		}
+		return NEXT_VALUE ;
+	}
+
+	// A name, or anything up to the next delimiter in a text file, where instance names
+	// may start with a digit
+	bool ReadName(std::string& name)
+	{
+		if (m_bBinary)
+		{
+			if (Peek() != NEXT_NAME)
+			{
+				return Fail() ;
+			}
+			if (Token() == XTOKEN_TEMPLATE)
+			{
+				m_p += 2 ;
+				name = "template" ;
+				return true ;
+			}
+			m_p += 2 ;
+			return ReadCounted(name) ;
+		}
+
+		SkipSeparators() ;
+		const unsigned char* start = m_p ;
+		while (m_p < m_End && !IsDelimiter((char)*m_p))
+		{
+			++m_p ;
+		}
+		if (m_p == start)
+		{
+			return Fail() ;
+		}
+		name.assign((const char*)start, m_p - start) ;
+		return true ;
+	}
+
+	bool ReadOpen()
+	{
+		if (Peek() != NEXT_OPEN)
+		{
+			return Fail() ;
+		}
+		m_p += m_bBinary ? 2 : 1 ;
+
+		// The GUID that may follow the brace of an object
+		if (m_bBinary)
+		{
+			if (m_End - m_p >= 18 && Token() == XTOKEN_GUID)
+			{
+				m_p += 18 ;
+			}
+		}
+		else
+		{
+			SkipSeparators() ;
+			if (m_p < m_End && *m_p == '<')
+			{
+				while (m_p < m_End && *m_p != '>')
+				{
+					++m_p ;
+				}
+				m_p += m_p < m_End ? 1 : 0 ;
+			}
+		}
+		return true ;
+	}
+
+	bool ReadClose()
+	{
+		if (Peek() != NEXT_CLOSE)
+		{
+			return Fail() ;
+		}
+		m_p += m_bBinary ? 2 : 1 ;
+		return true ;
+	}
+
+	bool ReadUInt(unsigned int& value)
+	{
+		if (m_bBinary)
+		{
+			if (m_Integers == 0)
+			{
+				SkipSeparatorTokens() ;
+				if (m_End - m_p < 6)
+				{
+					return Fail() ;
+				}
+				int token = Token() ;
+				if (token == XTOKEN_INTEGER)
+				{
+					m_p += 2 ;
+					m_Integers = 1 ;
+				}
+				else if (token == XTOKEN_INTEGER_LIST)
+				{
+					m_p += 2 ;
+					m_Integers = Dword() ;
+					m_p += 4 ;
+					if (m_Integers == 0 || m_Integers > Remaining() / 4)
+					{
+						return Fail() ;
+					}
+				}
+				else
+				{
+					return Fail() ;
+				}
+			}
+			if (m_End - m_p < 4)
+			{
+				return Fail() ;
+			}
+			value = Dword() ;
+			m_p += 4 ;
+			--m_Integers ;
+			return true ;
+		}
+
+		SkipSeparators() ;
+		const unsigned char* start = m_p ;
+		unsigned long long number = 0 ;
+		while (m_p < m_End && *m_p >= '0' && *m_p <= '9' && number <= 0xffffffffULL)
+		{
+			number = number * 10 + (*m_p - '0') ;
+			++m_p ;
+		}
+		if (m_p == start || number > 0xffffffffULL)
+		{
+			return Fail() ;
+		}
+		value = (unsigned int)number ;
+		return true ;
+	}
+
+	bool ReadFloat(float& value)
+	{
+		if (m_bBinary)
+		{
+			size_t size = m_bDoubles ? 8 : 4 ;
+			if (m_Floats == 0)
+			{
+				SkipSeparatorTokens() ;
+				if (m_End - m_p < 6 || Token() != XTOKEN_FLOAT_LIST)
+				{
+					return Fail() ;
+				}
+				m_p += 2 ;
+				m_Floats = Dword() ;
+				m_p += 4 ;
+				if (m_Floats == 0 || m_Floats > Remaining() / size)
+				{
+					return Fail() ;
+				}
+			}
+			if ((size_t)(m_End - m_p) < size)
+			{
+				return Fail() ;
+			}
+			if (m_bDoubles)
+			{
+				double number ;
+				memcpy(&number, m_p, 8) ;
+				value = (float)number ;
+			}
+			else
+			{
+				memcpy(&value, m_p, 4) ;
+			}
+			m_p += size ;
+			--m_Floats ;
+			return true ;
+		}
+
+		SkipSeparators() ;
+		return ParseFloat(value) ;
+	}
+
+	bool ReadString(std::string& value)
+	{
+		if (m_bBinary)
+		{
+			SkipSeparatorTokens() ;
+			if (m_End - m_p < 2 || Token() != XTOKEN_STRING)
+			{
+				return Fail() ;
+			}
+			m_p += 2 ;
+			return ReadCounted(value) ;
+		}
+
+		SkipSeparators() ;
+		if (m_p == m_End || *m_p != '"')
+		{
+			return Fail() ;
+		}
+		const unsigned char* start = ++m_p ;
+		while (m_p < m_End && *m_p != '"')
+		{
+			++m_p ;
+		}
+		if (m_p == m_End)
+		{
+			return Fail() ;
+		}
+		value.assign((const char*)start, m_p - start) ;
+		++m_p ;
+		return true ;
+	}
+
+	// Drop one value, or what is left of a binary list, the parser does not want
+	bool SkipValue()
+	{
+		if (m_bBinary)
+		{
+			if (m_Integers > 0 || m_Floats > 0)
+			{
+				m_p += m_Integers * 4 + m_Floats * (m_bDoubles ? 8 : 4) ;
+				m_Integers = 0 ;
+				m_Floats = 0 ;
+				return true ;
+			}
+			return SkipToken() ;
+		}
+
+		SkipSeparators() ;
+		if (m_p < m_End && *m_p == '"')
+		{
+			std::string value ;
+			return ReadString(value) ;
+		}
+		const unsigned char* start = m_p ;
+		while (m_p < m_End && !IsDelimiter((char)*m_p))
+		{
+			++m_p ;
+		}
+		if (m_p == start)
+		{
+			++m_p ;
+		}
+		return true ;
+	}
+
+	// After the opening brace, skip to past the matching closing one
+	bool SkipObject()
+	{
+		int depth = 1 ;
+		while (depth > 0)
+		{
+			NEXT next = Peek() ;
+			if (next == NEXT_END)
+			{
+				return Fail() ;
+			}
+			if (next == NEXT_OPEN || next == NEXT_CLOSE)
+			{
+				m_p += m_bBinary ? 2 : 1 ;
+				depth += next == NEXT_OPEN ? 1 : -1 ;
+			}
+			else if (!SkipValue())
+			{
+				return false ;
+			}
+		}
+		return true ;
+	}
+
+private:
+	static bool IsDelimiter(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';' ||
+			   c == '{' || c == '}' || c == '<' || c == '"' ;
+	}
+
+	bool Fail()
+	{
+		m_bFailed = true ;
+		return false ;
+	}
+
+	int Token() const
+	{
+		return m_p[0] | (m_p[1] << 8) ;
+	}
+
+	unsigned int Dword() const
+	{
+		return m_p[0] | (m_p[1] << 8) | (m_p[2] << 16) | ((unsigned int)m_p[3] << 24) ;
+	}
+
+	bool ReadCounted(std::string& value)
+	{
+		if (m_End - m_p < 4)
+		{
+			return Fail() ;
+		}
+		unsigned int length = Dword() ;
+		m_p += 4 ;
+		if (length > Remaining())
+		{
+			return Fail() ;
+		}
+		value.assign((const char*)m_p, length) ;
+		m_p += length ;
+		return true ;
+	}
+
+	bool SkipToken()
+	{
+		if (m_End - m_p < 2)
+		{
+			return Fail() ;
+		}
+		int token = Token() ;
+		m_p += 2 ;
+		size_t size = 0 ;
+		switch (token)
+		{
+		case XTOKEN_NAME:
+		case XTOKEN_STRING:
+			if (m_End - m_p < 4)
+			{
+				return Fail() ;
+			}
+			size = 4 + (size_t)Dword() ;
+			break ;
+		case XTOKEN_INTEGER:
+			size = 4 ;
+			break ;
+		case XTOKEN_GUID:
+			size = 16 ;
+			break ;
+		case XTOKEN_INTEGER_LIST:
+		case XTOKEN_FLOAT_LIST:
+			if (m_End - m_p < 4)
+			{
+				return Fail() ;
+			}
+			size = 4 + (size_t)Dword() * (token == XTOKEN_INTEGER_LIST ? 4 : (m_bDoubles ? 8 : 4)) ;
+			break ;
+		}
+		if (size > Remaining())
+		{
+			return Fail() ;
+		}
+		m_p += size ;
+		return true ;
+	}
+
+	void SkipSeparatorTokens()
+	{
+		while (m_End - m_p >= 2 && (Token() == XTOKEN_COMMA || Token() == XTOKEN_SEMICOLON))
+		{
+			m_p += 2 ;
+		}
+	}
+
+	void SkipSeparators()
+	{
+		while (m_p < m_End)
+		{
+			char c = (char)*m_p ;
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ';')
+			{
+				++m_p ;
+			}
+			else if (c == '#' || (c == '/' && m_p + 1 < m_End && m_p[1] == '/'))
+			{
+				while (m_p < m_End && *m_p != '\n')
+				{
+					++m_p ;
+				}
+			}
+			else
+			{
+				break ;
+			}
+		}
+	}
+
+	/*
+	Decimal digits into an integer, then one multiplication or division by an exact power
+	of ten in double, which rounds the numbers exporters write, six decimals or so, the
+	way strtod does, without its locale lookups.
+	*/
+	bool ParseFloat(float& value)
+	{
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 } ;
+
+		const unsigned char* p = m_p ;
+		bool negative = false ;
+		if (p < m_End && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-' ;
+			++p ;
+		}
+
+		unsigned long long mantissa = 0 ;
+		int exponent = 0 ;
+		int digits = 0 ;
+		bool any = false ;
+		for (; p < m_End && *p >= '0' && *p <= '9'; ++p, any = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0') ;
+				digits += mantissa != 0 ? 1 : 0 ;
+			}
+			else
+			{
+				++exponent ;
+			}
+		}
+		if (p < m_End && *p == '.')
+		{
+			for (++p; p < m_End && *p >= '0' && *p <= '9'; ++p, any = true)
+			{
+				if (digits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0') ;
+					digits += mantissa != 0 ? 1 : 0 ;
+					--exponent ;
+				}
+			}
+		}
+		if (!any)
+		{
+			return Fail() ;
+		}
+		if (p < m_End && (*p == 'e' || *p == 'E'))
+		{
+			const unsigned char* e = p + 1 ;
+			bool negativeExponent = false ;
+			if (e < m_End && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-' ;
+				++e ;
+			}
+			int power = 0 ;
+			bool anyExponent = false ;
+			for (; e < m_End && *e >= '0' && *e <= '9'; ++e, anyExponent = true)
+			{
+				power = power < 1000 ? power * 10 + (*e - '0') : power ;
+			}
+			if (anyExponent)
+			{
+				exponent += negativeExponent ? -power : power ;
+				p = e ;
+			}
+		}
+		m_p = p ;
+
+		double number = (double)mantissa ;
+		while (exponent > 22)
+		{
+			number *= 1e22 ;
+			exponent -= 22 ;
+		}
+		while (exponent < -22)
+		{
+			number /= 1e22 ;
+			exponent += 22 ;
+		}
+		number = exponent >= 0 ? number * powers[exponent] : number / powers[-exponent] ;
+		value = (float)(negative ? -number : number) ;
+		return true ;
+	}
+
+	const unsigned char* m_p ;
+	const unsigned char* m_End ;
+	bool m_bBinary ;
+	bool m_bDoubles ;
+	size_t m_Integers ;		// left in the binary list being read
+	size_t m_Floats ;
+	bool m_bFailed ;
+};
+
+/*
+Walks the objects of the file and collects the meshes. Each Mesh is welded into
+position and normal pairs as it is read, so only the merged vertices and triangles are
+kept, and Finish sorts and renumbers them once at the end.
+*/
+class XParser
+{
+public:
+	XParser(XReader& reader) : m_Reader(reader), m_Error(XFILE_OK), m_DefaultMaterial(NONE) {}
+
+	XFILE_ERROR Parse(XMesh& mesh)
+	{
+		if (!ParseObjects(Mat4Identity(), false))
+		{
+			return Error() ;
+		}
+		return Finish(mesh) ;
+	}
+
+private:
+	struct MeshData
+	{
+		std::vector<Vec3> positions ;
+		std::vector<unsigned int> faceSizes ;
+		std::vector<unsigned int> faceCorners ;		// position indices of all faces
+		std::vector<Vec3> normals ;
+		std::vector<unsigned int> normalCorners ;	// normal indices, in the order of faceCorners
+		std::vector<float> uvs ;
+		std::vector<unsigned int> faceMaterials ;
+		std::vector<XMaterial> materials ;
+	};
+
+	XFILE_ERROR Error() const
+	{
+		return m_Error != XFILE_OK ? m_Error : XFILE_SYNTAX ;
+	}
+
+	bool Bad(XFILE_ERROR error)
+	{
+		m_Error = error ;
+		return false ;
+	}
+
+	// Objects up to the end of the file, or up to the brace closing the enclosing one
+	bool ParseObjects(const Mat4& parent, bool nested)
+	{
+		Mat4 world = parent ;
+		for (;;)
+		{
+			XReader::NEXT next = m_Reader.Peek() ;
+			if (next == XReader::NEXT_END)
+			{
+				return !nested || m_Reader.ReadClose() ;
+			}
+			if (next == XReader::NEXT_CLOSE)
+			{
+				return nested && m_Reader.ReadClose() ;
+			}
+			if (next == XReader::NEXT_OPEN)
+			{
+				// A reference to an object, nothing to do with it here
+				if (!m_Reader.ReadOpen() || !m_Reader.SkipObject())
+				{
+					return false ;
+				}
+				continue ;
+			}
+			if (next == XReader::NEXT_VALUE)
+			{
+				if (!m_Reader.SkipValue())
+				{
+					return false ;
+				}
+				continue ;
+			}
+
+			std::string type, name ;
+			if (!ReadObjectStart(type, name))
+			{
+				return false ;
+			}
+
+			bool parsed ;
+			if (type == "template")
+			{
+				parsed = m_Reader.SkipObject() ;
+			}
+			else if (type == "Frame")
+			{
+				parsed = ParseObjects(world, true) ;
+			}
+			else if (type == "FrameTransformMatrix")
+			{
+				Mat4 local ;
+				parsed = ReadFloats(&local.m[0][0], 16) && m_Reader.ReadClose() ;
+				world = local * parent ;
+			}
+			else if (type == "Mesh")
+			{
+				parsed = ParseMesh(world) ;
+			}
+			else if (type == "Material")
+			{
+				XMaterial material ;
+				parsed = ParseMaterial(material) ;
+				m_NamedMaterials[name] = material ;
+			}
+			else
+			{
+				parsed = m_Reader.SkipObject() ;
+			}
+			if (!parsed)
+			{
+				return false ;
+			}
+		}
+	}
+
+	// "Type name {", the name is optional, and a template has its name after the keyword
+	bool ReadObjectStart(std::string& type, std::string& name)
+	{
+		if (!m_Reader.ReadName(type))
+		{
+			return false ;
+		}
+		name.clear() ;
+		if (m_Reader.Peek() != XReader::NEXT_OPEN && !m_Reader.ReadName(name))
+		{
+			return false ;
+		}
+		return m_Reader.ReadOpen() ;
+	}
+
+	bool ReadFloats(float* values, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!m_Reader.ReadFloat(values[i]))
+			{
+				return false ;
+			}
+		}
+		return true ;
+	}
+
+	// A count that the rest of the file has room for, so a damaged one cannot allocate gigabytes
+	bool ReadCount(unsigned int& count)
+	{
+		return m_Reader.ReadUInt(count) && (count <= m_Reader.Remaining() || Bad(XFILE_SYNTAX)) ;
+	}
+
+	bool ReadFaces(std::vector<unsigned int>& sizes, std::vector<unsigned int>& corners, unsigned int limit)
+	{
+		unsigned int faceCount ;
+		if (!ReadCount(faceCount))
+		{
+			return false ;
+		}
+		sizes.resize(faceCount) ;
+		corners.clear() ;
+		corners.reserve(faceCount * 3) ;
+		for (unsigned int i = 0; i < faceCount; ++i)
+		{
+			unsigned int size ;
+			if (!ReadCount(size))
+			{
+				return false ;
+			}
+			if (size < 3)
+			{
+				return Bad(XFILE_BAD_INDEX) ;
+			}
+			sizes[i] = size ;
+			for (unsigned int j = 0; j < size; ++j)
+			{
+				unsigned int corner ;
+				if (!m_Reader.ReadUInt(corner))
+				{
+					return false ;
+				}
+				if (corner >= limit)
+				{
+					return Bad(XFILE_BAD_INDEX) ;
+				}
+				corners.push_back(corner) ;
+			}
+		}
+		return true ;
+	}
+
+	bool ReadVectors(std::vector<Vec3>& vectors)
+	{
+		unsigned int count ;
+		if (!ReadCount(count))
+		{
+			return false ;
+		}
+		vectors.resize(count) ;
+		return count == 0 || ReadFloats(&vectors[0].x, count * 3) ;
+	}
+
+	bool ParseMaterial(XMaterial& material)
+	{
+		material.texture.clear() ;
+		if (!ReadFloats(material.diffuse, 4) || !ReadFloats(&material.power, 1) ||
+			!ReadFloats(material.specular, 3) || !ReadFloats(material.emissive, 3))
+		{
+			return false ;
+		}
+
+		for (;;)
+		{
+			XReader::NEXT next = m_Reader.Peek() ;
+			if (next == XReader::NEXT_CLOSE)
+			{
+				return m_Reader.ReadClose() ;
+			}
+			if (next != XReader::NEXT_NAME)
+			{
+				if (next == XReader::NEXT_END || !m_Reader.SkipValue())
+				{
+					return Bad(XFILE_SYNTAX) ;
+				}
+				continue ;
+			}
+
+			std::string type, name ;
+			if (!ReadObjectStart(type, name))
+			{
+				return false ;
+			}
+			bool parsed = type == "TextureFilename" || type == "TextureFileName"
+						? m_Reader.ReadString(material.texture) && m_Reader.ReadClose()
+						: m_Reader.SkipObject() ;
+			if (!parsed)
+			{
+				return false ;
+			}
+		}
+	}
+
+	bool ParseMaterialList(MeshData& data)
+	{
+		unsigned int materialCount ;
+		unsigned int faceCount ;
+		if (!ReadCount(materialCount) || !ReadCount(faceCount))
+		{
+			return false ;
+		}
+		data.faceMaterials.resize(faceCount) ;
+		for (unsigned int i = 0; i < faceCount; ++i)
+		{
+			if (!m_Reader.ReadUInt(data.faceMaterials[i]))
+			{
+				return false ;
+			}
+			if (data.faceMaterials[i] >= materialCount)
+			{
+				return Bad(XFILE_BAD_INDEX) ;
+			}
+		}
+
+		// The materials, inline or as references to ones named before
+		for (;;)
+		{
+			XReader::NEXT next = m_Reader.Peek() ;
+			if (next == XReader::NEXT_CLOSE)
+			{
+				break ;
+			}
+			if (next == XReader::NEXT_OPEN)
+			{
+				std::string name ;
+				if (!m_Reader.ReadOpen() || !m_Reader.ReadName(name) || !m_Reader.ReadClose())
+				{
+					return false ;
+				}
+				std::map<std::string, XMaterial>::const_iterator found = m_NamedMaterials.find(name) ;
+				data.materials.push_back(found != m_NamedMaterials.end() ? found->second : White()) ;
+				continue ;
+			}
+			if (next != XReader::NEXT_NAME)
+			{
+				if (next == XReader::NEXT_END || !m_Reader.SkipValue())
+				{
+					return Bad(XFILE_SYNTAX) ;
+				}
+				continue ;
+			}
+
+			std::string type, name ;
+			if (!ReadObjectStart(type, name))
+			{
+				return false ;
+			}
+			if (type == "Material")
+			{
+				XMaterial material ;
+				if (!ParseMaterial(material))
+				{
+					return false ;
+				}
+				data.materials.push_back(material) ;
+			}
+			else if (!m_Reader.SkipObject())
+			{
+				return false ;
+			}
+		}
+
+		// Materials the file announced but did not give
+		data.materials.resize(materialCount, White()) ;
+		return m_Reader.ReadClose() ;
+	}
+
+	bool ParseMesh(const Mat4& world)
+	{
+		MeshData data ;
+		if (!ReadVectors(data.positions) ||
+			!ReadFaces(data.faceSizes, data.faceCorners, (unsigned int)data.positions.size()))
+		{
+			return false ;
+		}
+
+		for (;;)
+		{
+			XReader::NEXT next = m_Reader.Peek() ;
+			if (next == XReader::NEXT_CLOSE)
+			{
+				break ;
+			}
+			if (next != XReader::NEXT_NAME)
+			{
+				bool skipped = next == XReader::NEXT_OPEN ? m_Reader.ReadOpen() && m_Reader.SkipObject()
+						     : next != XReader::NEXT_END && m_Reader.SkipValue() ;
+				if (!skipped)
+				{
+					return Bad(XFILE_SYNTAX) ;
+				}
+				continue ;
+			}
+
+			std::string type, name ;
+			if (!ReadObjectStart(type, name))
+			{
+				return false ;
+			}
+
+			bool parsed ;
+			if (type == "MeshNormals")
+			{
+				std::vector<unsigned int> sizes ;
+				parsed = ReadVectors(data.normals) &&
+						 ReadFaces(sizes, data.normalCorners, (unsigned int)data.normals.size()) &&
+						 m_Reader.ReadClose() ;
+				if (parsed && sizes != data.faceSizes)
+				{
+					return Bad(XFILE_BAD_INDEX) ;
+				}
+			}
+			else if (type == "MeshTextureCoords")
+			{
+				unsigned int count ;
+				parsed = ReadCount(count) ;
+				if (parsed)
+				{
+					data.uvs.resize(count * 2) ;
+					parsed = (count == 0 || ReadFloats(&data.uvs[0], count * 2)) && m_Reader.ReadClose() ;
+				}
+			}
+			else if (type == "MeshMaterialList")
+			{
+				parsed = ParseMaterialList(data) ;
+			}
+			else
+			{
+				parsed = m_Reader.SkipObject() ;
+			}
+			if (!parsed)
+			{
+				return false ;
+			}
+		}
+
+		return m_Reader.ReadClose() && AddMesh(data, world) ;
+	}
+
+	static XMaterial White()
+	{
+		XMaterial material ;
+		material.diffuse[0] = material.diffuse[1] = material.diffuse[2] = material.diffuse[3] = 1.0f ;
+		material.power = 0.0f ;
+		material.specular[0] = material.specular[1] = material.specular[2] = 0.0f ;
+		material.emissive[0] = material.emissive[1] = material.emissive[2] = 0.0f ;
+		return material ;
+	}
+
+	bool AddMesh(const MeshData& data, const Mat4& world)
+	{
+		// Normals go through the inverse transpose, which is the matrix itself for the
+		// rotations and translations frames usually have
+		Mat4 normalMatrix ;
+		if (!Mat4Inverse(world, normalMatrix))
+		{
+			normalMatrix = world ;
+		}
+		normalMatrix = Mat4Transpose(normalMatrix) ;
+
+		unsigned int materialBase = (unsigned int)m_Materials.size() ;
+		if (data.materials.empty())
+		{
+			if (m_DefaultMaterial == NONE)
+			{
+				m_DefaultMaterial = materialBase ;
+				m_Materials.push_back(White()) ;
+			}
+			materialBase = m_DefaultMaterial ;
+		}
+		m_Materials.insert(m_Materials.end(), data.materials.begin(), data.materials.end()) ;
+
+		// The first normal a position is used with gets the vertex, other pairs are looked up
+		bool hasNormals = !data.normalCorners.empty() ;
+		bool hasUvs = data.uvs.size() >= data.positions.size() * 2 ;
+		std::vector<unsigned int> firstNormal(data.positions.size(), NONE) ;
+		std::vector<unsigned int> firstVertex(data.positions.size(), NONE) ;
+		std::map<unsigned long long, unsigned int> pairs ;
+
+		size_t corner = 0 ;
+		std::vector<unsigned int> face ;
+		for (size_t f = 0; f < data.faceSizes.size(); ++f)
+		{
+			face.resize(data.faceSizes[f]) ;
+			for (size_t i = 0; i < face.size(); ++i, ++corner)
+			{
+				unsigned int position = data.faceCorners[corner] ;
+				unsigned int normal = hasNormals ? data.normalCorners[corner] : 0 ;
+				unsigned int vertex ;
+				if (firstVertex[position] == NONE)
+				{
+					vertex = AddVertex(data, world, normalMatrix, position, hasNormals ? normal : NONE, hasUvs) ;
+					firstVertex[position] = vertex ;
+					firstNormal[position] = normal ;
+				}
+				else if (firstNormal[position] == normal)
+				{
+					vertex = firstVertex[position] ;
+				}
+				else
+				{
+					unsigned long long key = ((unsigned long long)position << 32) | normal ;
+					std::map<unsigned long long, unsigned int>::iterator found = pairs.find(key) ;
+					if (found == pairs.end())
+					{
+						found = pairs.insert(std::make_pair(key, AddVertex(data, world, normalMatrix, position, normal, hasUvs))).first ;
+					}
+					vertex = found->second ;
+				}
+				face[i] = vertex ;
+			}
+
+			// D3DX gives the faces past the end of the material list the last material
+			unsigned int material = materialBase ;
+			if (!data.faceMaterials.empty())
+			{
+				material += data.faceMaterials[f < data.faceMaterials.size() ? f : data.faceMaterials.size() - 1] ;
+			}
+			for (size_t i = 2; i < face.size(); ++i)
+			{
+				m_Indices.push_back(face[0]) ;
+				m_Indices.push_back(face[i - 1]) ;
+				m_Indices.push_back(face[i]) ;
+				m_TriangleMaterials.push_back(material) ;
+			}
+		}
+		return true ;
+	}
+
+	unsigned int AddVertex(const MeshData& data, const Mat4& world, const Mat4& normalMatrix, unsigned int position, unsigned int normal, bool hasUvs)
+	{
+		XVertex vertex ;
+		Vec3 p = Vec3TransformCoord(data.positions[position], world) ;
+		Vec3 n = normal != NONE ? Vec3Normalize(Vec3TransformNormal(data.normals[normal], normalMatrix)) : Vec3(0.0f, 0.0f, 0.0f) ;
+		vertex.position[0] = p.x ;
+		vertex.position[1] = p.y ;
+		vertex.position[2] = p.z ;
+		vertex.normal[0] = n.x ;
+		vertex.normal[1] = n.y ;
+		vertex.normal[2] = n.z ;
+		vertex.uv[0] = hasUvs ? data.uvs[position * 2] : 0.0f ;
+		vertex.uv[1] = hasUvs ? data.uvs[position * 2 + 1] : 0.0f ;
+		m_Vertices.push_back(vertex) ;
+		return (unsigned int)m_Vertices.size() - 1 ;
+	}
+
+	XFILE_ERROR Finish(XMesh& mesh)
+	{
+		if (m_TriangleMaterials.empty())
+		{
+			return XFILE_NO_MESH ;
+		}
+
+		// Counting sort of the triangles by material, keeping the file order within one
+		size_t materialCount = m_Materials.size() ;
+		std::vector<unsigned int> starts(materialCount + 1, 0) ;
+		for (size_t i = 0; i < m_TriangleMaterials.size(); ++i)
+		{
+			++starts[m_TriangleMaterials[i] + 1] ;
+		}
+		for (size_t i = 1; i <= materialCount; ++i)
+		{
+			starts[i] += starts[i - 1] ;
+		}
+
+		std::vector<unsigned int> order(m_TriangleMaterials.size()) ;
+		std::vector<unsigned int> next(starts.begin(), starts.end() - 1) ;
+		for (size_t i = 0; i < m_TriangleMaterials.size(); ++i)
+		{
+			order[next[m_TriangleMaterials[i]]++] = (unsigned int)i ;
+		}
+
+		// Each subset in the order the vertex cache likes best
+		std::vector<unsigned int> sorted(m_Indices.size()) ;
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			memcpy(&sorted[i * 3], &m_Indices[order[i] * 3], 3 * sizeof(unsigned int)) ;
+		}
+		for (size_t material = 0; material < materialCount; ++material)
+		{
+			unsigned int* first = &sorted[0] + starts[material] * 3 ;
+			OptimizeVertexCacheTipsify(first, first, (starts[material + 1] - starts[material]) * 3, m_Vertices.size()) ;
+		}
+
+		// Number the vertices in the order the sorted triangles reach them
+		mesh.Clear() ;
+		std::vector<unsigned int> remap(m_Vertices.size(), NONE) ;
+		mesh.vertices.reserve(m_Vertices.size()) ;
+		mesh.indices.resize(m_Indices.size()) ;
+		mesh.subsets.resize(materialCount) ;
+		for (size_t material = 0; material < materialCount; ++material)
+		{
+			XSubset& subset = mesh.subsets[material] ;
+			subset.material = (unsigned int)material ;
+			subset.firstIndex = starts[material] * 3 ;
+			subset.indexCount = (starts[material + 1] - starts[material]) * 3 ;
+
+			unsigned int low = NONE, high = 0 ;
+			for (unsigned int i = starts[material]; i < starts[material + 1]; ++i)
+			{
+				for (unsigned int j = 0; j < 3; ++j)
+				{
+					unsigned int vertex = sorted[i * 3 + j] ;
+					if (remap[vertex] == NONE)
+					{
+						remap[vertex] = (unsigned int)mesh.vertices.size() ;
+						mesh.vertices.push_back(m_Vertices[vertex]) ;
+					}
+					unsigned int index = remap[vertex] ;
+					mesh.indices[i * 3 + j] = index ;
+					low = index < low ? index : low ;
+					high = index > high ? index : high ;
+				}
+			}
+			subset.firstVertex = subset.indexCount > 0 ? low : 0 ;
+			subset.vertexCount = subset.indexCount > 0 ? high - low + 1 : 0 ;
+		}
+		mesh.materials.swap(m_Materials) ;
+		return XFILE_OK ;
+	}
+
+	XReader& m_Reader ;
+	XFILE_ERROR m_Error ;
+	std::vector<XVertex> m_Vertices ;
+	std::vector<unsigned int> m_Indices ;
+	std::vector<unsigned int> m_TriangleMaterials ;
+	std::vector<XMaterial> m_Materials ;
+	unsigned int m_DefaultMaterial ;
+	std::map<std::string, XMaterial> m_NamedMaterials ;
+
+	XParser(const XParser&) ;
+	XParser& operator=(const XParser&) ;
+};
+
+XFILE_ERROR ParseXFile(const void* data, size_t size, XMesh& mesh)
+{
+	mesh.Clear() ;
+
+	// "xof 0302txt 0032": magic, version, format, float size
+	const unsigned char* bytes = static_cast<const unsigned char*>(data) ;
+	if (size < 16 || memcmp(bytes, "xof ", 4) != 0)
+	{
+		return XFILE_NOT_XFILE ;
+	}
+	if (memcmp(bytes + 4, "03", 2) != 0)
+	{
+		return XFILE_UNSUPPORTED ;
+	}
+
+	bool binary = memcmp(bytes + 8, "bin ", 4) == 0 ;
+	if (!binary && memcmp(bytes + 8, "txt ", 4) != 0)
+	{
+		return XFILE_UNSUPPORTED ;
+	}
+
+	bool doubles = memcmp(bytes + 12, "0064", 4) == 0 ;
+	if (!doubles && memcmp(bytes + 12, "0032", 4) != 0)
+	{
+		return XFILE_UNSUPPORTED ;
+	}
+
+	XReader reader(bytes + 16, size - 16, binary, doubles) ;
+	XParser parser(reader) ;
+	XFILE_ERROR error = parser.Parse(mesh) ;
+	if (error != XFILE_OK)
+	{
+		mesh.Clear() ;
+	}
+	return error ;
+}
+
+bool WriteXMeshCache(const char* path, const XMesh& mesh, unsigned long long sourceHash)
+{
+	std::vector<XMaterialRecord> records(mesh.materials.size()) ;
+	std::string names ;
+	for (size_t i = 0; i < mesh.materials.size(); ++i)
+	{
+		const XMaterial& material = mesh.materials[i] ;
+		XMaterialRecord& record = records[i] ;
+		memcpy(record.diffuse, material.diffuse, sizeof(record.diffuse)) ;
+		record.power = material.power ;
+		memcpy(record.specular, material.specular, sizeof(record.specular)) ;
+		memcpy(record.emissive, material.emissive, sizeof(record.emissive)) ;
+		record.textureOffset = (unsigned int)names.size() ;
+		record.textureLength = (unsigned int)material.texture.size() ;
+		names += material.texture ;
+		names += '\0' ;
+	}
+
+	XMeshCacheHeader header ;
+	header.magic = XMESH_CACHE_MAGIC ;
+	header.version = XMESH_CACHE_VERSION ;
+	header.sourceHash = sourceHash ;
+	header.vertexCount = (unsigned int)mesh.vertices.size() ;
+	header.indexCount = (unsigned int)mesh.indices.size() ;
+	header.subsetCount = (unsigned int)mesh.subsets.size() ;
+	header.materialCount = (unsigned int)records.size() ;
+	header.namesBytes = (unsigned int)names.size() ;
+	header.reserved = 0 ;
+
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 ;
+	written = written && (mesh.vertices.empty() || fwrite(&mesh.vertices[0], sizeof(XVertex), mesh.vertices.size(), file) == mesh.vertices.size()) ;
+	written = written && (mesh.indices.empty() || fwrite(&mesh.indices[0], sizeof(unsigned int), mesh.indices.size(), file) == mesh.indices.size()) ;
+	written = written && (mesh.subsets.empty() || fwrite(&mesh.subsets[0], sizeof(XSubset), mesh.subsets.size(), file) == mesh.subsets.size()) ;
+	written = written && (records.empty() || fwrite(&records[0], sizeof(XMaterialRecord), records.size(), file) == records.size()) ;
+	written = written && (names.empty() || fwrite(names.data(), 1, names.size(), file) == names.size()) ;
+	return fclose(file) == 0 && written ;
+}
+
+bool ReadXMeshCache(const char* path, unsigned long long sourceHash, XMesh& mesh)
+{
+	mesh.Clear() ;
+
+	MappedFile file ;
+	if (!file.Open(path) || file.Size() < sizeof(XMeshCacheHeader))
+	{
+		return false ;
+	}
+
+	XMeshCacheHeader header ;
+	memcpy(&header, file.Data(), sizeof(header)) ;
+	if (header.magic != XMESH_CACHE_MAGIC || header.version != XMESH_CACHE_VERSION || header.sourceHash != sourceHash)
+	{
+		return false ;
+	}
+
+	unsigned long long expected = sizeof(header) + (unsigned long long)header.vertexCount * sizeof(XVertex) +
+								  (unsigned long long)header.indexCount * sizeof(unsigned int) +
+								  (unsigned long long)header.subsetCount * sizeof(XSubset) +
+								  (unsigned long long)header.materialCount * sizeof(XMaterialRecord) + header.namesBytes ;
+	if (expected != file.Size() || header.indexCount % 3 != 0 || header.subsetCount != header.materialCount)
+	{
+		return false ;
+	}
+
+	const unsigned char* p = file.Data() + sizeof(header) ;
+	mesh.vertices.resize(header.vertexCount) ;
+	mesh.indices.resize(header.indexCount) ;
+	mesh.subsets.resize(header.subsetCount) ;
+	std::vector<XMaterialRecord> records(header.materialCount) ;
+	const size_t sizes[4] = { header.vertexCount * sizeof(XVertex), header.indexCount * sizeof(unsigned int),
+							  header.subsetCount * sizeof(XSubset), header.materialCount * sizeof(XMaterialRecord) } ;
+	void* targets[4] = { mesh.vertices.empty() ? NULL : &mesh.vertices[0], mesh.indices.empty() ? NULL : &mesh.indices[0],
+						 mesh.subsets.empty() ? NULL : &mesh.subsets[0], records.empty() ? NULL : &records[0] } ;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (sizes[i] > 0)
+		{
+			memcpy(targets[i], p, sizes[i]) ;
+			p += sizes[i] ;
+		}
+	}
+	const char* names = (const char*)p ;
+
+	// Everything that indexes something has to stay inside it
+	bool valid = true ;
+	for (size_t i = 0; valid && i < mesh.indices.size(); ++i)
+	{
+		valid = mesh.indices[i] < header.vertexCount ;
+	}
+	for (size_t i = 0; valid && i < mesh.subsets.size(); ++i)
+	{
+		const XSubset& subset = mesh.subsets[i] ;
+		valid = subset.material < header.materialCount &&
+				(unsigned long long)subset.firstIndex + subset.indexCount <= header.indexCount &&
+				(unsigned long long)subset.firstVertex + subset.vertexCount <= header.vertexCount ;
+	}
+	mesh.materials.resize(records.size()) ;
+	for (size_t i = 0; valid && i < records.size(); ++i)
+	{
+		const XMaterialRecord& record = records[i] ;
+		valid = (unsigned long long)record.textureOffset + record.textureLength < header.namesBytes ;
+		if (valid)
+		{
+			XMaterial& material = mesh.materials[i] ;
+			memcpy(material.diffuse, record.diffuse, sizeof(material.diffuse)) ;
+			material.power = record.power ;
+			memcpy(material.specular, record.specular, sizeof(material.specular)) ;
+			memcpy(material.emissive, record.emissive, sizeof(material.emissive)) ;
+			material.texture.assign(names + record.textureOffset, record.textureLength) ;
+		}
+	}
+
+	if (!valid)
+	{
+		mesh.Clear() ;
+	}
+	return valid ;
+}
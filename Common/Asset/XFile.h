@@ -0,0 +1,122 @@
+#ifndef __XFILE_H__
+#define __XFILE_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/*
+Loader for DirectX .x mesh files, text and binary, without D3DX.
+
+ParseXFile reads the file in one pass and keeps only what a static mesh needs: every
+Mesh in the file, moved by the FrameTransformMatrix of the frames around it and merged
+into one, like D3DXLoadMeshFromX does, with its normals, texture coordinates and
+materials. Template definitions, animations and skin data are skipped without being
+interpreted.
+
+The result is ready for a vertex and an index buffer. A vertex is a position, normal
+and texture coordinate triple, the layout of D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1,
+and one is made for every different position and normal pair the faces use. Faces with
+more than three corners are split into fans, the triangles are sorted by material into
+one subset per material and put in vertex cache order within it by Tipsify, and the
+vertices are renumbered in the order the sorted triangles first use them, so drawing
+a subset reads a compact run of the vertex buffer.
+
+Parsing even small files means reading through the template header every time, so the
+result can be written to a cache file next to the .x, which ReadXMeshCache maps and
+copies out. The cache carries XFileHash of the .x it came from and is refused when the
+source changed. Cache layout, all numbers little-endian:
+
+	XMeshCacheHeader
+	XVertex[vertexCount]
+	unsigned int[indexCount]
+	XSubset[subsetCount]
+	XMaterialRecord[materialCount]
+	texture file names, each followed by a 0 byte
+*/
+
+#define XMESH_CACHE_MAGIC		0x48534D58	// "XMSH"
+#define XMESH_CACHE_VERSION		2
+
+struct XVertex
+{
+	float position[3] ;
+	float normal[3] ;
+	float uv[2] ;
+};
+
+struct XMaterial
+{
+	float diffuse[4] ;			// faceColor, rgba
+	float power ;
+	float specular[3] ;
+	float emissive[3] ;
+	std::string texture ;		// TextureFilename, empty if there is none
+};
+
+// The triangles of one material, a range of the index list and of the vertices it uses
+struct XSubset
+{
+	unsigned int material ;
+	unsigned int firstIndex ;
+	unsigned int indexCount ;
+	unsigned int firstVertex ;
+	unsigned int vertexCount ;
+};
+
+struct XMesh
+{
+	std::vector<XVertex> vertices ;
+	std::vector<unsigned int> indices ;		// three per triangle
+	std::vector<XSubset> subsets ;			// in material order
+	std::vector<XMaterial> materials ;		// a white one when the file has none
+
+	void Clear() ;
+};
+
+struct XMeshCacheHeader
+{
+	unsigned int magic ;
+	unsigned int version ;
+	unsigned long long sourceHash ;		// XFileHash of the .x
+	unsigned int vertexCount ;
+	unsigned int indexCount ;
+	unsigned int subsetCount ;
+	unsigned int materialCount ;
+	unsigned int namesBytes ;
+	unsigned int reserved ;
+};
+
+struct XMaterialRecord
+{
+	float diffuse[4] ;
+	float power ;
+	float specular[3] ;
+	float emissive[3] ;
+	unsigned int textureOffset ;	// into the names, the name is empty when textureLength is 0
+	unsigned int textureLength ;
+};
+
+enum XFILE_ERROR
+{
+	XFILE_OK,
+	XFILE_NOT_XFILE,		// no "xof " header
+	XFILE_UNSUPPORTED,		// compressed, or a version or float size the parser does not know
+	XFILE_SYNTAX,			// unbalanced braces, a missing number, the file ends inside an object
+	XFILE_BAD_INDEX,		// a face or material index outside its array
+	XFILE_NO_MESH,			// parsed, but without any triangle
+};
+
+const char* XFileErrorText(XFILE_ERROR error) ;
+
+XFILE_ERROR ParseXFile(const void* data, size_t size, XMesh& mesh) ;
+
+// 64 bit FNV-1a of the file, ties a cache to its source
+unsigned long long XFileHash(const void* data, size_t size) ;
+
+bool WriteXMeshCache(const char* path, const XMesh& mesh, unsigned long long sourceHash) ;
+
+// False if the cache is missing, damaged or was written for other source bytes
+bool ReadXMeshCache(const char* path, unsigned long long sourceHash, XMesh& mesh) ;
+
+#endif // end __XFILE_H__
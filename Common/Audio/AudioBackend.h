@@ -0,0 +1,93 @@
+#ifndef __AUDIO_BACKEND_H__
+#define __AUDIO_BACKEND_H__
+
+#include <stddef.h>
+
+/*
+Interface between the sound code of the demos and whatever produces the sound.
+
+XAudio2Backend plays through XAudio2 on Windows, SoftwareMixer mixes the voices itself
+into 16 bit samples on any platform, NullAudioBackend only keeps track of what would be
+playing and advances a virtual clock, so voice management can be tested and measured on
+any machine without an audio device.
+*/
+
+enum AUDIO_SAMPLE_TYPE
+{
+	AUDIO_PCM,		// signed integer samples, 8 bit samples are unsigned as in WAV files
+	AUDIO_FLOAT,	// 32 bit float samples
+};
+
+// Sample format of a clip, the same fields as a PCM WAVEFORMATEX
+struct AudioFormat
+{
+	AUDIO_SAMPLE_TYPE sampleType ;
+	int sampleRate ;
+	int channels ;
+	int bitsPerSample ;
+
+	int BlockAlign() const { return channels * bitsPerSample / 8 ; }
+
+	bool operator==(const AudioFormat& other) const
+	{
+		return sampleType == other.sampleType && sampleRate == other.sampleRate &&
+			   channels == other.channels && bitsPerSample == other.bitsPerSample ;
+	}
+};
+
+// Interleaved sample data, the memory is owned by the caller and must outlive every voice playing it
+struct AudioClip
+{
+	AudioFormat format ;
+	const unsigned char* data ;
+	size_t bytes ;
+
+	size_t Frames() const { return format.BlockAlign() ? bytes / format.BlockAlign() : 0 ; }
+	double DurationMs() const { return format.sampleRate ? Frames() * 1000.0 / format.sampleRate : 0 ; }
+};
+
+// Left and right gain for pan -1 (left) .. 1 (right), centre plays at full level on both sides
+inline void PanGains(float pan, float& left, float& right)
+{
+	pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan) ;
+	left = pan > 0 ? 1.0f - pan : 1.0f ;
+	right = pan < 0 ? 1.0f + pan : 1.0f ;
+}
+
+// One playing sound, a voice is created for one format and plays clips of that format
+class AudioVoice
+{
+public:
+	virtual ~AudioVoice() {}
+
+	// Play clip from its start, stopping whatever the voice was playing
+	virtual bool Start(const AudioClip& clip, float volume) = 0 ;
+
+	virtual void Stop() = 0 ;
+
+	virtual void SetVolume(float volume) = 0 ;
+
+	// Stereo position, -1 is left, 0 centre, 1 right
+	virtual void SetPan(float pan) = 0 ;
+
+	// Playback speed, 1 is the original pitch, 2 an octave up
+	virtual void SetPitch(float ratio) = 0 ;
+
+	virtual bool IsPlaying() = 0 ;
+};
+
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() {}
+
+	// Create a voice for clips of the given format, NULL on failure
+	virtual AudioVoice* CreateVoice(const AudioFormat& format) = 0 ;
+
+	virtual void DestroyVoice(AudioVoice* voice) = 0 ;
+
+	// Milliseconds on the backend's clock, used for rate limiting
+	virtual double TimeMs() = 0 ;
+};
+
+#endif // end __AUDIO_BACKEND_H__
@@ -0,0 +1,301 @@
+#include "AudioStream.h"
+#include "../Utility/Timer.h"
+
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+// Largest fmt chunk accepted, WAVEFORMATEXTENSIBLE is 40 bytes
+static const unsigned int MAX_FORMAT_BYTES = 1024 ;
+
+static unsigned int ReadU32(const unsigned char* p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24) ;
+}
+
+AudioStream::AudioStream(void)
+	: m_pFile(NULL),
+	  m_DataOffset(0),
+	  m_DataBytes(0),
+	  m_BufferBytes(0),
+	  m_bLoop(false),
+	  m_ReadIndex(0),
+	  m_PlayIndex(0),
+	  m_Ready(0),
+	  m_InUse(0),
+	  m_bEndRead(false),
+	  m_bStop(false)
+{
+	memset(&m_Wave, 0, sizeof(m_Wave)) ;
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+AudioStream::~AudioStream(void)
+{
+	Close() ;
+}
+
+bool AudioStream::Open(const char* path, int bufferCount, int bufferBytes, bool loop)
+{
+	Close() ;
+
+#ifdef _MSC_VER
+	if (fopen_s(&m_pFile, path, "rb") != 0)
+	{
+		m_pFile = NULL ;
+	}
+#else
+	m_pFile = fopen(path, "rb") ;
+#endif
+	if (!m_pFile)
+	{
+		return false ;
+	}
+
+	if (!FindChunks() || bufferCount < 2)
+	{
+		Close() ;
+		return false ;
+	}
+
+	// Whole blocks only, so every buffer can be decoded on its own
+	size_t blockAlign = (size_t)m_Wave.blockAlign ;
+	m_BufferBytes = std::max(blockAlign, (size_t)bufferBytes - (size_t)bufferBytes % blockAlign) ;
+	m_bLoop = loop && m_DataBytes > 0 ;
+
+	m_Buffers.resize(bufferCount) ;
+	for (int i = 0; i < bufferCount; ++i)
+	{
+		m_Buffers[i].data.resize(m_BufferBytes) ;
+		m_Buffers[i].bytes = 0 ;
+		m_Buffers[i].last = false ;
+	}
+
+	m_Thread = std::thread(&AudioStream::ReadLoop, this) ;
+	return true ;
+}
+
+bool AudioStream::FindChunks()
+{
+	unsigned char header[12] ;
+	if (fread(header, sizeof(header), 1, m_pFile) != 1 ||
+		ReadU32(header) != RIFF_FOURCC('R', 'I', 'F', 'F') || ReadU32(header + 8) != RIFF_FOURCC('W', 'A', 'V', 'E'))
+	{
+		return false ;
+	}
+
+	if (fseek(m_pFile, 0, SEEK_END) != 0)
+	{
+		return false ;
+	}
+	long long fileSize = ftell(m_pFile) ;
+
+	// Walk the chunk headers only, seeking over everything but fmt
+	long long offset = 12 ;
+	bool haveData = false ;
+	while (!(haveData && !m_Format.empty()) && offset + 8 <= fileSize)
+	{
+		unsigned char chunk[8] ;
+		if (fseek(m_pFile, (long)offset, SEEK_SET) != 0 || fread(chunk, sizeof(chunk), 1, m_pFile) != 1)
+		{
+			return false ;
+		}
+
+		unsigned int id = ReadU32(chunk) ;
+		unsigned int size = ReadU32(chunk + 4) ;
+
+		if (id == RIFF_FOURCC('f', 'm', 't', ' '))
+		{
+			if (size > MAX_FORMAT_BYTES || offset + 8 + size > fileSize)
+			{
+				return false ;
+			}
+			m_Format.resize(size) ;
+			if (size > 0 && fread(&m_Format[0], size, 1, m_pFile) != 1)
+			{
+				return false ;
+			}
+		}
+		else if (id == RIFF_FOURCC('d', 'a', 't', 'a'))
+		{
+			// A file cut short while recording plays up to its end
+			m_DataOffset = (long)(offset + 8) ;
+			m_DataBytes = (size_t)std::min((long long)size, fileSize - offset - 8) ;
+			haveData = true ;
+		}
+
+		offset += 8 + (long long)size + (size & 1) ;
+	}
+
+	if (!haveData || m_Format.empty() || !ParseWaveFormat(&m_Format[0], (unsigned int)m_Format.size(), m_Wave))
+	{
+		return false ;
+	}
+
+	m_DataBytes -= m_DataBytes % m_Wave.blockAlign ;
+	m_Wave.sampleBytes = (unsigned int)m_DataBytes ;
+	return fseek(m_pFile, m_DataOffset, SEEK_SET) == 0 ;
+}
+
+void AudioStream::Close()
+{
+	if (m_Thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex) ;
+			m_bStop = true ;
+		}
+		m_Changed.notify_all() ;
+		m_Thread.join() ;
+	}
+
+	if (m_pFile)
+	{
+		fclose(m_pFile) ;
+		m_pFile = NULL ;
+	}
+
+	m_Format.clear() ;
+	m_Buffers.clear() ;
+	memset(&m_Wave, 0, sizeof(m_Wave)) ;
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+	m_DataOffset = 0 ;
+	m_DataBytes = 0 ;
+	m_ReadIndex = 0 ;
+	m_PlayIndex = 0 ;
+	m_Ready = 0 ;
+	m_InUse = 0 ;
+	m_bEndRead = false ;
+	m_bStop = false ;
+}
+
+void AudioStream::ReadLoop()
+{
+	int count = (int)m_Buffers.size() ;
+	size_t position = 0 ;
+
+	for (;;)
+	{
+		int index ;
+		{
+			// Wait for a buffer the player has given back
+			std::unique_lock<std::mutex> lock(m_Mutex) ;
+			while (!m_bStop && m_Ready + m_InUse == count)
+			{
+				m_Changed.wait(lock) ;
+			}
+			if (m_bStop)
+			{
+				return ;
+			}
+			index = m_ReadIndex ;
+		}
+
+		// The buffer is neither ready nor in use, the thread owns it until it is published
+		Buffer& buffer = m_Buffers[index] ;
+		size_t want = std::min(m_BufferBytes, m_DataBytes - position) ;
+
+		Timer timer ;
+		size_t got = want > 0 ? fread(&buffer.data[0], 1, want, m_pFile) : 0 ;
+		double ms = timer.ElapsedMs() ;
+
+		position += got ;
+		bool last = false ;
+		if (got < want || position >= m_DataBytes)
+		{
+			if (m_bLoop && got == want && fseek(m_pFile, m_DataOffset, SEEK_SET) == 0)
+			{
+				position = 0 ;
+			}
+			else
+			{
+				last = true ;
+			}
+		}
+
+		buffer.bytes = got - got % m_Wave.blockAlign ;
+		buffer.last = last ;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex) ;
+			m_ReadIndex = (m_ReadIndex + 1) % count ;
+			++m_Ready ;
+			++m_Stats.buffersRead ;
+			m_Stats.bytesRead += got ;
+			m_Stats.maxReadMs = std::max(m_Stats.maxReadMs, ms) ;
+			m_Stats.peakReady = std::max(m_Stats.peakReady, m_Ready) ;
+			m_bEndRead = last ;
+		}
+		m_Changed.notify_all() ;
+
+		if (last)
+		{
+			return ;
+		}
+	}
+}
+
+const unsigned char* AudioStream::Acquire(size_t& bytes, bool& last)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	if (m_Ready == 0)
+	{
+		// Late if the thread had a free buffer to read into, not when the player holds them all
+		if (!m_bEndRead && m_InUse < (int)m_Buffers.size())
+		{
+			++m_Stats.late ;
+		}
+		return NULL ;
+	}
+
+	const Buffer& buffer = m_Buffers[m_PlayIndex] ;
+	bytes = buffer.bytes ;
+	last = buffer.last ;
+
+	m_PlayIndex = (m_PlayIndex + 1) % (int)m_Buffers.size() ;
+	--m_Ready ;
+	++m_InUse ;
+	return &buffer.data[0] ;
+}
+
+void AudioStream::Release()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		if (m_InUse == 0)
+		{
+			return ;
+		}
+		--m_InUse ;
+		++m_Stats.buffersPlayed ;
+	}
+	m_Changed.notify_all() ;
+}
+
+void AudioStream::Underrun()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	++m_Stats.underruns ;
+}
+
+bool AudioStream::WaitReady(int count, int timeoutMs)
+{
+	count = std::min(count, (int)m_Buffers.size()) ;
+
+	std::unique_lock<std::mutex> lock(m_Mutex) ;
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs) ;
+	while (m_Ready < count && !m_bEndRead)
+	{
+		if (m_Changed.wait_until(lock, end) == std::cv_status::timeout)
+		{
+			break ;
+		}
+	}
+	return m_Ready >= count || m_bEndRead ;
+}
+
+AudioStreamStats AudioStream::Stats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	return m_Stats ;
+}
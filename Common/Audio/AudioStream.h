@@ -0,0 +1,102 @@
+#ifndef __AUDIO_STREAM_H__
+#define __AUDIO_STREAM_H__
+
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "WaveFile.h"
+
+struct AudioStreamStats
+{
+	long long bytesRead ;
+	int buffersRead ;
+	int buffersPlayed ;		// buffers given back by the player
+	int late ;				// Acquire found no buffer ready, the player still had audio queued
+	int underruns ;			// the player ran out of audio before the end, reported with Underrun
+	double maxReadMs ;		// slowest single read
+	int peakReady ;			// most buffers read ahead of the player
+};
+
+/*
+Plays a wave file from disk in fixed size pieces instead of loading it whole.
+
+A background thread reads the data chunk into a small ring of buffers. The player takes
+the buffers in order with Acquire, hands them to the voice, and gives each back with
+Release once the voice has finished it, which lets the thread read the next piece into
+it. Memory use is bufferCount * bufferBytes whatever the length of the file.
+
+Only formats that can be cut at any block boundary are streamed, xWMA files need their
+seek table and are refused.
+*/
+class AudioStream
+{
+public:
+	AudioStream(void);
+	~AudioStream(void);
+
+	// Open the file and start reading. bufferBytes is rounded down to whole blocks.
+	// With loop the data wraps around to the start and the stream never ends.
+	bool Open(const char* path, int bufferCount = 4, int bufferBytes = 64 * 1024, bool loop = false) ;
+
+	void Close() ;
+
+	// Format of the samples, the fmt chunk bytes are in Wave().format
+	const WaveData& Wave() const { return m_Wave ; }
+
+	// Next buffer in play order, NULL if it was not read yet or the stream ended.
+	// last is set on the final buffer of the file.
+	const unsigned char* Acquire(size_t& bytes, bool& last) ;
+
+	// Give back the oldest acquired buffer, call once the voice has finished playing it
+	void Release() ;
+
+	// Called by the player when its voice ran dry before the end of the stream
+	void Underrun() ;
+
+	// Wait until count buffers are ready or the file was read to the end, to prime a voice
+	bool WaitReady(int count, int timeoutMs) ;
+
+	size_t MemoryBytes() const { return m_Buffers.size() * m_BufferBytes ; }
+
+	AudioStreamStats Stats() ;
+
+private:
+	struct Buffer
+	{
+		std::vector<unsigned char> data ;
+		size_t bytes ;
+		bool last ;
+	};
+
+	bool FindChunks() ;
+	void ReadLoop() ;
+
+	FILE* m_pFile ;
+	std::vector<unsigned char> m_Format ;	// fmt chunk
+	WaveData m_Wave ;
+	long m_DataOffset ;
+	size_t m_DataBytes ;
+
+	std::vector<Buffer> m_Buffers ;
+	size_t m_BufferBytes ;
+	bool m_bLoop ;
+
+	std::thread m_Thread ;
+	std::mutex m_Mutex ;
+	std::condition_variable m_Changed ;
+	int m_ReadIndex ;		// next buffer the thread fills
+	int m_PlayIndex ;		// next buffer Acquire returns
+	int m_Ready ;			// read, not acquired yet
+	int m_InUse ;			// acquired, not released yet
+	bool m_bEndRead ;		// the last buffer was read
+	bool m_bStop ;
+
+	AudioStreamStats m_Stats ;
+
+	AudioStream(const AudioStream&) ;
+	AudioStream& operator=(const AudioStream&) ;
+};
+
+#endif // end __AUDIO_STREAM_H__
@@ -0,0 +1,183 @@
+#include "NullAudioBackend.h"
+
+#include <string.h>
+#include <algorithm>
+
+class NullAudioBackend::NullVoice : public AudioVoice
+{
+public:
+	NullVoice(NullAudioBackend* backend, const AudioFormat& format)
+		: m_pBackend(backend),
+		  m_Format(format),
+		  m_Position(0),
+		  m_Frames(0),
+		  m_RequestTime(0),
+		  m_Pitch(1.0f),
+		  m_bPending(false),
+		  m_bPlaying(false)
+	{
+	}
+
+	virtual bool Start(const AudioClip& clip, float /*volume*/)
+	{
+		if (!(clip.format == m_Format))
+		{
+			return false ;
+		}
+
+		m_Frames = (double)clip.Frames() ;
+		m_Position = 0 ;
+		m_RequestTime = m_pBackend->TimeMs() ;
+		m_bPending = true ;
+		m_bPlaying = false ;
+		return true ;
+	}
+
+	virtual void Stop()
+	{
+		m_bPending = false ;
+		m_bPlaying = false ;
+	}
+
+	virtual void SetVolume(float /*volume*/)
+	{
+	}
+
+	virtual void SetPan(float /*pan*/)
+	{
+	}
+
+	virtual void SetPitch(float ratio)
+	{
+		m_Pitch = ratio > 0 ? ratio : 1.0f ;
+	}
+
+	virtual bool IsPlaying()
+	{
+		return m_bPending || m_bPlaying ;
+	}
+
+	// Advance by one block of the device, return true if the voice was heard in this block
+	bool Process(int blockFrames, int deviceRate, double blockTimeMs, NullAudioStats& stats)
+	{
+		if (m_bPending)
+		{
+			m_bPending = false ;
+			m_bPlaying = true ;
+
+			double latency = blockTimeMs - m_RequestTime ;
+			++stats.starts ;
+			stats.latencySumMs += latency ;
+			stats.maxLatencyMs = std::max(stats.maxLatencyMs, latency) ;
+		}
+
+		if (!m_bPlaying)
+		{
+			return false ;
+		}
+
+		m_Position += (double)blockFrames * m_Format.sampleRate / deviceRate * m_Pitch ;
+		if (m_Position >= m_Frames)
+		{
+			m_bPlaying = false ;
+		}
+		return true ;
+	}
+
+private:
+	NullAudioBackend* m_pBackend ;
+	AudioFormat m_Format ;
+	double m_Position ;		// in frames of the clip
+	double m_Frames ;
+	double m_RequestTime ;
+	float m_Pitch ;
+	bool m_bPending ;		// started, waiting for the next block
+	bool m_bPlaying ;
+};
+
+NullAudioBackend::NullAudioBackend(int sampleRate, int blockFrames)
+	: m_SampleRate(sampleRate),
+	  m_BlockFrames(blockFrames),
+	  m_TimeMs(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+NullAudioBackend::~NullAudioBackend(void)
+{
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		delete m_Voices[i] ;
+	}
+}
+
+AudioVoice* NullAudioBackend::CreateVoice(const AudioFormat& format)
+{
+	if (format.sampleRate <= 0 || format.channels <= 0 || format.bitsPerSample <= 0)
+	{
+		return NULL ;
+	}
+
+	NullVoice* voice = new NullVoice(this, format) ;
+	m_Voices.push_back(voice) ;
+	return voice ;
+}
+
+void NullAudioBackend::DestroyVoice(AudioVoice* voice)
+{
+	std::vector<NullVoice*>::iterator it = std::find(m_Voices.begin(), m_Voices.end(), voice) ;
+	if (it != m_Voices.end())
+	{
+		delete *it ;
+		m_Voices.erase(it) ;
+	}
+}
+
+void NullAudioBackend::Advance(double ms)
+{
+	double end = m_TimeMs + ms ;
+
+	// Blocks start at multiples of the block length
+	double blockMs = m_BlockFrames * 1000.0 / m_SampleRate ;
+	for (;;)
+	{
+		double nextBlock = (m_Stats.framesRendered / m_BlockFrames + 1) * blockMs ;
+		if (nextBlock > end)
+		{
+			break ;
+		}
+
+		m_TimeMs = nextBlock ;
+		ProcessBlock() ;
+	}
+
+	m_TimeMs = end ;
+}
+
+void NullAudioBackend::ProcessBlock()
+{
+	int audible = 0 ;
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		if (m_Voices[i]->Process(m_BlockFrames, m_SampleRate, m_TimeMs, m_Stats))
+		{
+			++audible ;
+		}
+	}
+
+	m_Stats.framesRendered += m_BlockFrames ;
+	m_Stats.peakPlaying = std::max(m_Stats.peakPlaying, audible) ;
+}
+
+int NullAudioBackend::PlayingVoices() const
+{
+	int playing = 0 ;
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		if (m_Voices[i]->IsPlaying())
+		{
+			++playing ;
+		}
+	}
+	return playing ;
+}
@@ -0,0 +1,55 @@
+#ifndef __NULL_AUDIO_BACKEND_H__
+#define __NULL_AUDIO_BACKEND_H__
+
+#include <vector>
+#include "AudioBackend.h"
+
+struct NullAudioStats
+{
+	int starts ;				// voices that began producing sound
+	double latencySumMs ;		// from Start to the first block that includes the voice
+	double maxLatencyMs ;
+	long long framesRendered ;
+	int peakPlaying ;			// most voices audible in one block
+};
+
+/*
+Backend without an audio device, for tests and benchmarks.
+
+It behaves like a device that processes blockFrames at a time: a voice started between
+two blocks is heard from the next block on, and finishes once its clip length has been
+processed. Nothing happens unless Advance moves the clock forward.
+*/
+class NullAudioBackend : public AudioBackend
+{
+public:
+	explicit NullAudioBackend(int sampleRate = 48000, int blockFrames = 480);
+	virtual ~NullAudioBackend(void);
+
+	virtual AudioVoice* CreateVoice(const AudioFormat& format) ;
+	virtual void DestroyVoice(AudioVoice* voice) ;
+	virtual double TimeMs() { return m_TimeMs ; }
+
+	// Move the clock forward, processing every block that ends before the new time
+	void Advance(double ms) ;
+
+	int PlayingVoices() const ;
+
+	const NullAudioStats& Stats() const { return m_Stats ; }
+
+private:
+	class NullVoice ;
+
+	void ProcessBlock() ;
+
+	std::vector<NullVoice*> m_Voices ;
+	int m_SampleRate ;
+	int m_BlockFrames ;
+	double m_TimeMs ;
+	NullAudioStats m_Stats ;
+
+	NullAudioBackend(const NullAudioBackend&) ;
+	NullAudioBackend& operator=(const NullAudioBackend&) ;
+};
+
+#endif // end __NULL_AUDIO_BACKEND_H__
@@ -0,0 +1,130 @@
+#include "OfflineRender.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+static bool EarlierEvent(const AudioEvent& a, const AudioEvent& b)
+{
+	return a.timeMs < b.timeMs ;
+}
+
+// Parse one line, return false if it has text that is not an event
+static bool ParseLine(const char* line, const char* end, std::vector<AudioEvent>& events)
+{
+	double values[5] = { 0, -1, 1, 0, 1 } ;
+	int count = 0 ;
+
+	const char* p = line ;
+	while (p < end)
+	{
+		if (*p == ' ' || *p == '\t' || *p == '\r')
+		{
+			++p ;
+			continue ;
+		}
+		if (*p == '#')
+		{
+			break ;
+		}
+		if (count == 5)
+		{
+			return false ;
+		}
+
+		char* next = NULL ;
+		values[count] = strtod(p, &next) ;
+		if (next == p || next > end)
+		{
+			return false ;
+		}
+		++count ;
+		p = next ;
+	}
+
+	// Blank or comment line
+	if (count == 0)
+	{
+		return true ;
+	}
+	if (count < 2 || values[0] < 0 || values[1] < 0)
+	{
+		return false ;
+	}
+
+	AudioEvent event ;
+	event.timeMs = values[0] ;
+	event.sound = (int)values[1] ;
+	event.volume = (float)values[2] ;
+	event.pan = (float)values[3] ;
+	event.pitch = (float)values[4] ;
+	events.push_back(event) ;
+	return true ;
+}
+
+bool ParseAudioScript(const char* text, std::vector<AudioEvent>& events, int* errorLine)
+{
+	int lineNumber = 1 ;
+	const char* line = text ;
+	for (;;)
+	{
+		const char* end = line ;
+		while (*end && *end != '\n')
+		{
+			++end ;
+		}
+
+		if (!ParseLine(line, end, events))
+		{
+			if (errorLine)
+			{
+				*errorLine = lineNumber ;
+			}
+			return false ;
+		}
+
+		if (!*end)
+		{
+			break ;
+		}
+		line = end + 1 ;
+		++lineNumber ;
+	}
+
+	return true ;
+}
+
+void RenderAudioEvents(SoftwareMixer& mixer, VoicePool& pool, const std::vector<AudioEvent>& events,
+					   std::vector<short>& out, double maxTailMs)
+{
+	std::vector<AudioEvent> sorted(events) ;
+	std::stable_sort(sorted.begin(), sorted.end(), EarlierEvent) ;
+
+	const int blockFrames = 256 ;
+	int rate = mixer.SampleRate() ;
+	long long rendered = 0 ;
+
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		// Render up to the frame the event falls on, so it starts sample accurate
+		long long frame = (long long)(sorted[i].timeMs * rate / 1000.0 + 0.5) ;
+		if (frame > rendered)
+		{
+			size_t start = out.size() ;
+			out.resize(start + (size_t)(frame - rendered) * 2) ;
+			mixer.Render(&out[start], (int)(frame - rendered)) ;
+			rendered = frame ;
+		}
+
+		pool.Play(sorted[i].sound, sorted[i].volume, sorted[i].pan, sorted[i].pitch) ;
+	}
+
+	long long tailEnd = rendered + (long long)(maxTailMs * rate / 1000.0) ;
+	while (rendered < tailEnd && mixer.PlayingVoices() > 0)
+	{
+		int count = (int)std::min((long long)blockFrames, tailEnd - rendered) ;
+		size_t start = out.size() ;
+		out.resize(start + count * 2) ;
+		mixer.Render(&out[start], count) ;
+		rendered += count ;
+	}
+}
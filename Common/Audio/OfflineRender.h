@@ -0,0 +1,35 @@
+#ifndef __OFFLINE_RENDER_H__
+#define __OFFLINE_RENDER_H__
+
+#include <vector>
+#include "SoftwareMixer.h"
+#include "VoicePool.h"
+
+// One trigger of a sound effect at a point in time
+struct AudioEvent
+{
+	double timeMs ;
+	int sound ;			// sound id in the VoicePool
+	float volume ;
+	float pan ;
+	float pitch ;
+};
+
+/*
+Parse an event script, one event per line:
+	time_ms sound [volume [pan [pitch]]]
+Missing values default to volume 1, pan 0, pitch 1, '#' starts a comment.
+Return false on a malformed line and store its number (from 1) in errorLine.
+*/
+bool ParseAudioScript(const char* text, std::vector<AudioEvent>& events, int* errorLine = NULL) ;
+
+/*
+Play the events through pool, which must have been created on mixer, rendering the mixer
+output as fast as possible instead of in real time. Rendering continues after the last
+event until every voice has finished, at most maxTailMs. The interleaved stereo samples
+are appended to out.
+*/
+void RenderAudioEvents(SoftwareMixer& mixer, VoicePool& pool, const std::vector<AudioEvent>& events,
+					   std::vector<short>& out, double maxTailMs = 10000.0) ;
+
+#endif // end __OFFLINE_RENDER_H__
@@ -0,0 +1,99 @@
+#include "RiffReader.h"
+
+// RIFF is little endian, read byte by byte so the result does not depend on the host
+static unsigned int ReadU32(const unsigned char* p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24) ;
+}
+
+RiffReader::RiffReader(void)
+	: m_FormType(0),
+	  m_bTruncated(false),
+	  m_Error(RIFF_OK)
+{
+}
+
+RiffReader::~RiffReader(void)
+{
+}
+
+bool RiffReader::Parse(const unsigned char* data, size_t size)
+{
+	m_Chunks.clear() ;
+	m_FormType = 0 ;
+	m_bTruncated = false ;
+	m_Error = RIFF_OK ;
+
+	if (!data || size < 12 || ReadU32(data) != RIFF_FOURCC('R', 'I', 'F', 'F'))
+	{
+		m_Error = RIFF_NOT_RIFF ;
+		return false ;
+	}
+
+	m_FormType = ReadU32(data + 8) ;
+
+	// The RIFF size may be larger than the file, the chunks are checked against both
+	size_t riffEnd = (size_t)ReadU32(data + 4) + 8 ;
+	bool fileCut = riffEnd > size ;
+	size_t end = fileCut ? size : riffEnd ;
+
+	size_t offset = 12 ;
+	while (offset + 8 <= end)
+	{
+		if ((int)m_Chunks.size() == MAX_CHUNKS)
+		{
+			m_Error = RIFF_TOO_MANY_CHUNKS ;
+			return false ;
+		}
+
+		RiffChunk chunk ;
+		chunk.id = ReadU32(data + offset) ;
+		chunk.size = ReadU32(data + offset + 4) ;
+		chunk.data = data + offset + 8 ;
+
+		size_t available = end - offset - 8 ;
+		if (chunk.size > available)
+		{
+			// Only a file that ends before its RIFF size says may have a short chunk
+			if (!fileCut)
+			{
+				m_Error = RIFF_BAD_CHUNK ;
+				m_Chunks.clear() ;
+				return false ;
+			}
+			chunk.size = (unsigned int)available ;
+			m_bTruncated = true ;
+		}
+		m_Chunks.push_back(chunk) ;
+
+		// Chunks start on even offsets, an odd sized chunk is followed by a pad byte
+		offset += 8 + (size_t)chunk.size + (chunk.size & 1) ;
+	}
+
+	// Less than a chunk header left at the end is ignored, some writers pad files
+	return true ;
+}
+
+const RiffChunk* RiffReader::Find(unsigned int id) const
+{
+	for (size_t i = 0; i < m_Chunks.size(); ++i)
+	{
+		if (m_Chunks[i].id == id)
+		{
+			return &m_Chunks[i] ;
+		}
+	}
+	return NULL ;
+}
+
+const char* RiffErrorText(RIFF_ERROR error)
+{
+	switch (error)
+	{
+	case RIFF_OK:				return "no error" ;
+	case RIFF_NOT_RIFF:			return "not a RIFF file" ;
+	case RIFF_BAD_CHUNK:		return "chunk larger than the RIFF size" ;
+	case RIFF_TOO_MANY_CHUNKS:	return "too many chunks" ;
+	}
+	return "unknown error" ;
+}
@@ -0,0 +1,71 @@
+#ifndef __RIFF_READER_H__
+#define __RIFF_READER_H__
+
+#include <stddef.h>
+#include <vector>
+
+// Chunk id from its four characters, as stored little-endian in the file
+#define RIFF_FOURCC(a, b, c, d) \
+	((unsigned int)(unsigned char)(a) | ((unsigned int)(unsigned char)(b) << 8) | \
+	 ((unsigned int)(unsigned char)(c) << 16) | ((unsigned int)(unsigned char)(d) << 24))
+
+enum RIFF_ERROR
+{
+	RIFF_OK,
+	RIFF_NOT_RIFF,			// no RIFF header
+	RIFF_BAD_CHUNK,			// a chunk extends past the end given in the RIFF header
+	RIFF_TOO_MANY_CHUNKS,
+};
+
+// One chunk, data points into the buffer that was parsed
+struct RiffChunk
+{
+	unsigned int id ;
+	const unsigned char* data ;
+	unsigned int size ;
+};
+
+/*
+Index of the top level chunks of a RIFF file held in memory.
+
+Parse walks the chunks once, checks every chunk lies inside the RIFF size and the
+buffer and records where its data is, so lookups afterwards do not touch the file. Nothing is
+copied: the chunks point into the parsed buffer, which must outlive the reader.
+A last chunk that claims more bytes than the file has, as written by programs that
+were stopped while recording, is cut to the end of the file and flagged as truncated.
+*/
+class RiffReader
+{
+public:
+	RiffReader(void);
+	~RiffReader(void);
+
+	bool Parse(const unsigned char* data, size_t size) ;
+
+	// Form type after the RIFF header, e.g. WAVE
+	unsigned int FormType() const { return m_FormType ; }
+
+	// First chunk with the id, NULL if there is none
+	const RiffChunk* Find(unsigned int id) const ;
+
+	int ChunkCount() const { return (int)m_Chunks.size() ; }
+	const RiffChunk& Chunk(int index) const { return m_Chunks[index] ; }
+
+	bool Truncated() const { return m_bTruncated ; }
+
+	RIFF_ERROR Error() const { return m_Error ; }
+
+	// Largest number of chunks accepted, protects against files of empty chunks
+	static const int MAX_CHUNKS = 4096 ;
+
+private:
+	std::vector<RiffChunk> m_Chunks ;
+	unsigned int m_FormType ;
+	bool m_bTruncated ;
+	RIFF_ERROR m_Error ;
+};
+
+// Text for an error, for message boxes and logs
+const char* RiffErrorText(RIFF_ERROR error) ;
+
+#endif // end __RIFF_READER_H__
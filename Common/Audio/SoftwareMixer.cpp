@@ -0,0 +1,441 @@
+#include "SoftwareMixer.h"
+#include "../Utility/Simd.h"
+
+#include <string.h>
+#include <algorithm>
+
+// 16 bit samples to float in -1..1
+static void ConvertPCM16(const short* src, float* dst, int count)
+{
+	const float scale = 1.0f / 32768.0f ;
+	int i = 0 ;
+
+#if defined(SIMD_AVX2)
+	const __m256 scale8 = _mm256_set1_ps(scale) ;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(src + i))) ;
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale8)) ;
+	}
+#endif
+
+#if defined(SIMD_SSE2)
+	const __m128 scale4 = _mm_set1_ps(scale) ;
+	for (; i + 8 <= count; i += 8)
+	{
+		// Sign extend by moving each sample to the high half and shifting back
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + i)) ;
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16) ;
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16) ;
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale4)) ;
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale4)) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		dst[i] = src[i] * scale ;
+	}
+}
+
+// Add a stereo block to the mix
+static void MixStereo(float* mix, const float* src, int frames, float left, float right)
+{
+	int count = frames * 2 ;
+	int i = 0 ;
+
+#if defined(SIMD_AVX2)
+	const __m256 gain8 = _mm256_setr_ps(left, right, left, right, left, right, left, right) ;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 m = _mm256_loadu_ps(mix + i) ;
+		_mm256_storeu_ps(mix + i, _mm256_add_ps(m, _mm256_mul_ps(_mm256_loadu_ps(src + i), gain8))) ;
+	}
+#endif
+
+#if defined(SIMD_SSE2)
+	const __m128 gain4 = _mm_setr_ps(left, right, left, right) ;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 m = _mm_loadu_ps(mix + i) ;
+		_mm_storeu_ps(mix + i, _mm_add_ps(m, _mm_mul_ps(_mm_loadu_ps(src + i), gain4))) ;
+	}
+#endif
+
+	for (; i < count; i += 2)
+	{
+		mix[i] += src[i] * left ;
+		mix[i + 1] += src[i + 1] * right ;
+	}
+}
+
+// Add a mono block to both channels of the mix
+static void MixMono(float* mix, const float* src, int frames, float left, float right)
+{
+	int i = 0 ;
+
+#if defined(SIMD_AVX2)
+	const __m256 gain8 = _mm256_setr_ps(left, right, left, right, left, right, left, right) ;
+	for (; i + 8 <= frames; i += 8)
+	{
+		// Duplicate every sample, unpack works per 128 bit lane so the halves are swapped back in place
+		__m256 s = _mm256_loadu_ps(src + i) ;
+		__m256 lo = _mm256_unpacklo_ps(s, s) ;
+		__m256 hi = _mm256_unpackhi_ps(s, s) ;
+		__m256 first = _mm256_permute2f128_ps(lo, hi, 0x20) ;
+		__m256 second = _mm256_permute2f128_ps(lo, hi, 0x31) ;
+		float* m = mix + i * 2 ;
+		_mm256_storeu_ps(m, _mm256_add_ps(_mm256_loadu_ps(m), _mm256_mul_ps(first, gain8))) ;
+		_mm256_storeu_ps(m + 8, _mm256_add_ps(_mm256_loadu_ps(m + 8), _mm256_mul_ps(second, gain8))) ;
+	}
+#endif
+
+#if defined(SIMD_SSE2)
+	const __m128 gain4 = _mm_setr_ps(left, right, left, right) ;
+	for (; i + 4 <= frames; i += 4)
+	{
+		__m128 s = _mm_loadu_ps(src + i) ;
+		float* m = mix + i * 2 ;
+		_mm_storeu_ps(m, _mm_add_ps(_mm_loadu_ps(m), _mm_mul_ps(_mm_unpacklo_ps(s, s), gain4))) ;
+		_mm_storeu_ps(m + 4, _mm_add_ps(_mm_loadu_ps(m + 4), _mm_mul_ps(_mm_unpackhi_ps(s, s), gain4))) ;
+	}
+#endif
+
+	for (; i < frames; ++i)
+	{
+		mix[i * 2] += src[i] * left ;
+		mix[i * 2 + 1] += src[i] * right ;
+	}
+}
+
+// Float mix to 16 bit samples, clipping anything louder than full scale
+static void FloatToPCM16(const float* src, short* dst, int count)
+{
+	int i = 0 ;
+
+#if defined(SIMD_SSE2)
+	const __m128 scale = _mm_set1_ps(32767.0f) ;
+	const __m128 low = _mm_set1_ps(-32768.0f) ;
+	const __m128 high = _mm_set1_ps(32767.0f) ;
+	for (; i + 8 <= count; i += 8)
+	{
+		// Clamp before converting, out of range floats convert to INT_MIN
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), low), high) ;
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), low), high) ;
+		__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)) ;
+		_mm_storeu_si128((__m128i*)(dst + i), packed) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float v = src[i] * 32767.0f ;
+		v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v) ;
+		dst[i] = (short)(v >= 0 ? v + 0.5f : v - 0.5f) ;
+	}
+}
+
+static inline float SampleToFloat(short sample) { return sample * (1.0f / 32768.0f) ; }
+static inline float SampleToFloat(unsigned char sample) { return (sample - 128) * (1.0f / 128.0f) ; }
+static inline float SampleToFloat(float sample) { return sample ; }
+
+// Resample by step with linear interpolation, the last frame holds its value.
+// Return the frames written, less than count when the clip ends.
+template <typename T, int CHANNELS>
+static int Resample(const T* data, size_t frames, double& position, double step, float* dst, int count)
+{
+	int produced = 0 ;
+	for (; produced < count; ++produced)
+	{
+		size_t index = (size_t)position ;
+		if (index >= frames)
+		{
+			break ;
+		}
+
+		size_t next = index + 1 < frames ? index + 1 : index ;
+		float frac = (float)(position - index) ;
+		for (int c = 0; c < CHANNELS; ++c)
+		{
+			float s0 = SampleToFloat(data[index * CHANNELS + c]) ;
+			float s1 = SampleToFloat(data[next * CHANNELS + c]) ;
+			dst[produced * CHANNELS + c] = s0 + (s1 - s0) * frac ;
+		}
+
+		position += step ;
+	}
+	return produced ;
+}
+
+template <typename T>
+static int Resample(const T* data, int channels, size_t frames, double& position, double step, float* dst, int count)
+{
+	return channels == 1 ? Resample<T, 1>(data, frames, position, step, dst, count)
+						 : Resample<T, 2>(data, frames, position, step, dst, count) ;
+}
+
+class SoftwareMixer::SoftwareVoice : public AudioVoice
+{
+public:
+	SoftwareVoice(SoftwareMixer* mixer, const AudioFormat& format)
+		: m_pMixer(mixer),
+		  m_Format(format),
+		  m_pData(NULL),
+		  m_Frames(0),
+		  m_Position(0),
+		  m_Volume(1.0f),
+		  m_Pan(0),
+		  m_Pitch(1.0f),
+		  m_bPlaying(false)
+	{
+	}
+
+	virtual bool Start(const AudioClip& clip, float volume)
+	{
+		if (!(clip.format == m_Format))
+		{
+			return false ;
+		}
+
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		m_pData = clip.data ;
+		m_Frames = clip.Frames() ;
+		m_Position = 0 ;
+		m_Volume = volume ;
+		m_bPlaying = m_Frames > 0 ;
+		return true ;
+	}
+
+	virtual void Stop()
+	{
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		m_bPlaying = false ;
+	}
+
+	virtual void SetVolume(float volume)
+	{
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		m_Volume = volume ;
+	}
+
+	virtual void SetPan(float pan)
+	{
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		m_Pan = pan ;
+	}
+
+	virtual void SetPitch(float ratio)
+	{
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		m_Pitch = ratio > 0 ? ratio : 1.0f ;
+	}
+
+	virtual bool IsPlaying()
+	{
+		std::lock_guard<std::mutex> lock(m_pMixer->m_Mutex) ;
+		return m_bPlaying ;
+	}
+
+	// The functions below are called by the mixer with its mutex held
+
+	bool Active() const { return m_bPlaying ; }
+
+	int Channels() const { return m_Format.channels ; }
+
+	void Gains(float& left, float& right) const
+	{
+		PanGains(m_Pan, left, right) ;
+		left *= m_Volume ;
+		right *= m_Volume ;
+	}
+
+	// Convert up to frames of the clip at the play position to float, resampled to the
+	// output rate. Return the number of frames written, less than asked at the clip end.
+	int Fetch(float* dst, int frames, int outputRate)
+	{
+		int channels = m_Format.channels ;
+		double step = (double)m_Format.sampleRate / outputRate * m_Pitch ;
+		size_t index = (size_t)m_Position ;
+
+		// Same rate and no pitch change, a straight conversion
+		if (step == 1.0 && (double)index == m_Position)
+		{
+			int count = (int)std::min((size_t)frames, m_Frames - index) ;
+			Convert(index * channels, count * channels, dst) ;
+			m_Position += count ;
+			m_bPlaying = index + count < m_Frames ;
+			return count ;
+		}
+
+		int produced ;
+		if (m_Format.sampleType == AUDIO_FLOAT)
+		{
+			produced = Resample((const float*)m_pData, channels, m_Frames, m_Position, step, dst, frames) ;
+		}
+		else if (m_Format.bitsPerSample == 16)
+		{
+			produced = Resample((const short*)m_pData, channels, m_Frames, m_Position, step, dst, frames) ;
+		}
+		else
+		{
+			produced = Resample(m_pData, channels, m_Frames, m_Position, step, dst, frames) ;
+		}
+
+		m_bPlaying = (size_t)m_Position < m_Frames ;
+		return produced ;
+	}
+
+private:
+	void Convert(size_t first, int count, float* dst) const
+	{
+		if (m_Format.sampleType == AUDIO_FLOAT)
+		{
+			memcpy(dst, (const float*)m_pData + first, count * sizeof(float)) ;
+		}
+		else if (m_Format.bitsPerSample == 16)
+		{
+			ConvertPCM16((const short*)m_pData + first, dst, count) ;
+		}
+		else
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				dst[i] = SampleToFloat(m_pData[first + i]) ;
+			}
+		}
+	}
+
+	SoftwareMixer* m_pMixer ;
+	AudioFormat m_Format ;
+	const unsigned char* m_pData ;
+	size_t m_Frames ;
+	double m_Position ;		// in frames of the clip
+	float m_Volume ;
+	float m_Pan ;
+	float m_Pitch ;
+	bool m_bPlaying ;
+};
+
+SoftwareMixer::SoftwareMixer(int sampleRate, int blockFrames)
+	: m_SampleRate(sampleRate),
+	  m_BlockFrames(blockFrames > 0 ? blockFrames : 256)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+	m_Mix.resize(m_BlockFrames * 2) ;
+	m_Scratch.resize(m_BlockFrames * 2) ;
+}
+
+SoftwareMixer::~SoftwareMixer(void)
+{
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		delete m_Voices[i] ;
+	}
+}
+
+AudioVoice* SoftwareMixer::CreateVoice(const AudioFormat& format)
+{
+	bool supported = format.sampleRate > 0 && (format.channels == 1 || format.channels == 2) &&
+		(format.sampleType == AUDIO_FLOAT ? format.bitsPerSample == 32 :
+											(format.bitsPerSample == 8 || format.bitsPerSample == 16)) ;
+	if (!supported)
+	{
+		return NULL ;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	SoftwareVoice* voice = new SoftwareVoice(this, format) ;
+	m_Voices.push_back(voice) ;
+	return voice ;
+}
+
+void SoftwareMixer::DestroyVoice(AudioVoice* voice)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	std::vector<SoftwareVoice*>::iterator it = std::find(m_Voices.begin(), m_Voices.end(), voice) ;
+	if (it != m_Voices.end())
+	{
+		delete *it ;
+		m_Voices.erase(it) ;
+	}
+}
+
+double SoftwareMixer::TimeMs()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	return m_Stats.framesRendered * 1000.0 / m_SampleRate ;
+}
+
+void SoftwareMixer::Render(short* out, int frames)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	while (frames > 0)
+	{
+		int count = std::min(frames, m_BlockFrames) ;
+		MixBlock(out, count) ;
+		out += count * 2 ;
+		frames -= count ;
+	}
+}
+
+void SoftwareMixer::MixBlock(short* out, int frames)
+{
+	float* mix = &m_Mix[0] ;
+	float* scratch = &m_Scratch[0] ;
+	memset(mix, 0, frames * 2 * sizeof(float)) ;
+
+	int mixed = 0 ;
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		SoftwareVoice* voice = m_Voices[i] ;
+		if (!voice->Active())
+		{
+			continue ;
+		}
+
+		int count = voice->Fetch(scratch, frames, m_SampleRate) ;
+		if (count == 0)
+		{
+			continue ;
+		}
+
+		float left, right ;
+		voice->Gains(left, right) ;
+		if (voice->Channels() == 1)
+		{
+			MixMono(mix, scratch, count, left, right) ;
+		}
+		else
+		{
+			MixStereo(mix, scratch, count, left, right) ;
+		}
+
+		++mixed ;
+		m_Stats.voiceFrames += count ;
+	}
+
+	FloatToPCM16(mix, out, frames * 2) ;
+
+	m_Stats.framesRendered += frames ;
+	m_Stats.peakVoices = std::max(m_Stats.peakVoices, mixed) ;
+}
+
+int SoftwareMixer::PlayingVoices()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	int playing = 0 ;
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		if (m_Voices[i]->Active())
+		{
+			++playing ;
+		}
+	}
+	return playing ;
+}
+
+MixerStats SoftwareMixer::Stats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	return m_Stats ;
+}
@@ -0,0 +1,63 @@
+#ifndef __SOFTWARE_MIXER_H__
+#define __SOFTWARE_MIXER_H__
+
+#include <vector>
+#include <mutex>
+#include "AudioBackend.h"
+
+struct MixerStats
+{
+	long long framesRendered ;		// output frames
+	long long voiceFrames ;			// sum of the frames every voice contributed
+	int peakVoices ;				// most voices mixed into one block
+};
+
+/*
+AudioBackend that mixes its voices in software into interleaved 16 bit stereo.
+
+Voices play 8 and 16 bit PCM or float clips with one or two channels at any sample rate,
+with per voice gain, pan and pitch. Samples are accumulated as floats, the sample format
+conversion and the accumulation use SSE2/AVX2 when available, pitch and rate changes
+are resampled with linear interpolation.
+
+Render pulls the next frames, from an audio device callback or from an offline loop; the
+clock the voices see is the number of frames rendered so far. Voices may be started
+from another thread than the one calling Render.
+*/
+class SoftwareMixer : public AudioBackend
+{
+public:
+	explicit SoftwareMixer(int sampleRate = 48000, int blockFrames = 256);
+	virtual ~SoftwareMixer(void);
+
+	virtual AudioVoice* CreateVoice(const AudioFormat& format) ;
+	virtual void DestroyVoice(AudioVoice* voice) ;
+	virtual double TimeMs() ;
+
+	// Mix the next frames into out, frames * 2 samples, left first
+	void Render(short* out, int frames) ;
+
+	int SampleRate() const { return m_SampleRate ; }
+
+	int PlayingVoices() ;
+
+	MixerStats Stats() ;
+
+private:
+	class SoftwareVoice ;
+
+	void MixBlock(short* out, int frames) ;
+
+	std::vector<SoftwareVoice*> m_Voices ;
+	std::vector<float> m_Mix ;			// stereo accumulation buffer, one block
+	std::vector<float> m_Scratch ;		// one voice's block converted to float
+	int m_SampleRate ;
+	int m_BlockFrames ;
+	MixerStats m_Stats ;
+	std::mutex m_Mutex ;
+
+	SoftwareMixer(const SoftwareMixer&) ;
+	SoftwareMixer& operator=(const SoftwareMixer&) ;
+};
+
+#endif // end __SOFTWARE_MIXER_H__
@@ -0,0 +1,219 @@
+#include "VoicePool.h"
+
+#include <string.h>
+
+VoicePool::VoicePool(AudioBackend* backend)
+	: m_pBackend(backend),
+	  m_Policy(STEAL_OLDEST),
+	  m_NextOrder(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+VoicePool::~VoicePool(void)
+{
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		m_pBackend->DestroyVoice(m_Voices[i].voice) ;
+	}
+}
+
+int VoicePool::FindFormat(const AudioFormat& format) const
+{
+	for (size_t i = 0; i < m_Formats.size(); ++i)
+	{
+		if (m_Formats[i] == format)
+		{
+			return (int)i ;
+		}
+	}
+	return -1 ;
+}
+
+bool VoicePool::AddFormat(const AudioFormat& format, int voiceCount)
+{
+	int index = FindFormat(format) ;
+	if (index < 0)
+	{
+		index = (int)m_Formats.size() ;
+		m_Formats.push_back(format) ;
+	}
+
+	for (int i = 0; i < voiceCount; ++i)
+	{
+		AudioVoice* voice = m_pBackend->CreateVoice(format) ;
+		if (!voice)
+		{
+			return false ;
+		}
+
+		Voice slot ;
+		slot.voice = voice ;
+		slot.format = index ;
+		slot.sound = -1 ;
+		slot.order = 0 ;
+		slot.volume = 0 ;
+		m_Voices.push_back(slot) ;
+	}
+
+	return true ;
+}
+
+int VoicePool::AddSound(const AudioClip& clip, float volume, double minIntervalMs, int maxInstances)
+{
+	int format = FindFormat(clip.format) ;
+	if (format < 0)
+	{
+		return -1 ;
+	}
+
+	Sound sound ;
+	sound.clip = clip ;
+	sound.format = format ;
+	sound.volume = volume ;
+	sound.minIntervalMs = minIntervalMs ;
+	sound.maxInstances = maxInstances > 0 ? maxInstances : 1 ;
+	sound.lastTrigger = -1e30 ;
+	m_Sounds.push_back(sound) ;
+
+	return (int)m_Sounds.size() - 1 ;
+}
+
+bool VoicePool::IsBetterVictim(const Voice& candidate, const Voice& current) const
+{
+	if (m_Policy == STEAL_QUIETEST && candidate.volume != current.volume)
+	{
+		return candidate.volume < current.volume ;
+	}
+	return candidate.order < current.order ;
+}
+
+int VoicePool::ChooseVoice(int sound)
+{
+	const Sound& info = m_Sounds[sound] ;
+
+	int free = -1 ;
+	int victim = -1 ;
+	int oldestInstance = -1 ;
+	int instances = 0 ;
+
+	for (int i = 0; i < (int)m_Voices.size(); ++i)
+	{
+		Voice& slot = m_Voices[i] ;
+		if (slot.format != info.format)
+		{
+			continue ;
+		}
+
+		if (!slot.voice->IsPlaying())
+		{
+			if (free < 0)
+			{
+				free = i ;
+			}
+			continue ;
+		}
+
+		if (slot.sound == sound)
+		{
+			++instances ;
+			if (oldestInstance < 0 || slot.order < m_Voices[oldestInstance].order)
+			{
+				oldestInstance = i ;
+			}
+		}
+
+		if (victim < 0 || IsBetterVictim(slot, m_Voices[victim]))
+		{
+			victim = i ;
+		}
+	}
+
+	// Too many copies of this sound, restart the oldest one instead of taking another voice
+	if (instances >= info.maxInstances)
+	{
+		++m_Stats.steals ;
+		return oldestInstance ;
+	}
+
+	if (free >= 0)
+	{
+		return free ;
+	}
+
+	if (victim >= 0)
+	{
+		++m_Stats.steals ;
+	}
+	return victim ;
+}
+
+bool VoicePool::Play(int sound, float volume, float pan, float pitch)
+{
+	if (sound < 0 || sound >= (int)m_Sounds.size())
+	{
+		++m_Stats.failed ;
+		return false ;
+	}
+
+	Sound& info = m_Sounds[sound] ;
+
+	double now = m_pBackend->TimeMs() ;
+	if (now - info.lastTrigger < info.minIntervalMs)
+	{
+		++m_Stats.throttled ;
+		return false ;
+	}
+
+	int index = ChooseVoice(sound) ;
+	if (index < 0)
+	{
+		++m_Stats.failed ;
+		return false ;
+	}
+
+	Voice& slot = m_Voices[index] ;
+	float finalVolume = volume * info.volume ;
+	slot.voice->SetPan(pan) ;
+	slot.voice->SetPitch(pitch) ;
+	if (!slot.voice->Start(info.clip, finalVolume))
+	{
+		++m_Stats.failed ;
+		return false ;
+	}
+
+	slot.sound = sound ;
+	slot.order = m_NextOrder++ ;
+	slot.volume = finalVolume ;
+	info.lastTrigger = now ;
+	++m_Stats.plays ;
+
+	int active = ActiveVoices() ;
+	if (active > m_Stats.peakVoices)
+	{
+		m_Stats.peakVoices = active ;
+	}
+
+	return true ;
+}
+
+void VoicePool::StopAll()
+{
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		m_Voices[i].voice->Stop() ;
+	}
+}
+
+int VoicePool::ActiveVoices()
+{
+	int active = 0 ;
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		if (m_Voices[i].voice->IsPlaying())
+		{
+			++active ;
+		}
+	}
+	return active ;
+}
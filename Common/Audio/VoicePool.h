@@ -0,0 +1,96 @@
+#ifndef __VOICE_POOL_H__
+#define __VOICE_POOL_H__
+
+#include <vector>
+#include "AudioBackend.h"
+
+// Which voice to take over when every voice of a format is busy
+enum STEAL_POLICY
+{
+	STEAL_OLDEST,		// the voice that started first
+	STEAL_QUIETEST,		// the voice with the lowest volume, the oldest of those on a tie
+};
+
+struct VoicePoolStats
+{
+	int plays ;			// sounds started
+	int steals ;		// sounds started by cutting off another one
+	int throttled ;		// triggers dropped by the rate limit
+	int failed ;		// triggers with no voice for the format, or a backend error
+	int peakVoices ;	// most voices playing at the same time
+};
+
+/*
+Polyphonic sound effect player.
+
+All voices are created up front, a fixed number per sample format, so playing a sound
+never creates or destroys anything. A sound can play on several voices at once; when
+all voices are busy, or the sound already plays maxInstances times, one is stolen.
+Triggers closer than minIntervalMs to the previous one of the same sound are dropped,
+so a held key does not fill every voice with copies of the same sound.
+*/
+class VoicePool
+{
+public:
+	explicit VoicePool(AudioBackend* backend);
+	~VoicePool(void);
+
+	// Create voiceCount voices for format, call once per format before playing
+	bool AddFormat(const AudioFormat& format, int voiceCount) ;
+
+	// Register a clip, return its sound id or -1 if no voices exist for its format.
+	// The clip memory must stay valid while the pool exists.
+	int AddSound(const AudioClip& clip, float volume = 1.0f, double minIntervalMs = 30.0, int maxInstances = 4) ;
+
+	// Start a sound, volume is multiplied with the volume the sound was added with.
+	// Return false if the trigger was dropped.
+	bool Play(int sound, float volume = 1.0f, float pan = 0.0f, float pitch = 1.0f) ;
+
+	void StopAll() ;
+
+	void SetStealPolicy(STEAL_POLICY policy) { m_Policy = policy ; }
+
+	// Number of voices playing right now
+	int ActiveVoices() ;
+
+	int VoiceCount() const { return (int)m_Voices.size() ; }
+
+	const VoicePoolStats& Stats() const { return m_Stats ; }
+
+private:
+	struct Voice
+	{
+		AudioVoice* voice ;
+		int format ;			// index into m_Formats
+		int sound ;				// sound playing, -1 if none was started yet
+		unsigned int order ;	// start order, smaller is older
+		float volume ;
+	};
+
+	struct Sound
+	{
+		AudioClip clip ;
+		int format ;
+		float volume ;
+		double minIntervalMs ;
+		int maxInstances ;
+		double lastTrigger ;
+	};
+
+	int FindFormat(const AudioFormat& format) const ;
+	int ChooseVoice(int sound) ;
+	bool IsBetterVictim(const Voice& candidate, const Voice& current) const ;
+
+	AudioBackend* m_pBackend ;
+	std::vector<AudioFormat> m_Formats ;
+	std::vector<Voice> m_Voices ;
+	std::vector<Sound> m_Sounds ;
+	STEAL_POLICY m_Policy ;
+	unsigned int m_NextOrder ;
+	VoicePoolStats m_Stats ;
+
+	VoicePool(const VoicePool&) ;
+	VoicePool& operator=(const VoicePool&) ;
+};
+
+#endif // end __VOICE_POOL_H__
@@ -0,0 +1,160 @@
+#include "WaveFile.h"
+
+#include <string.h>
+
+static unsigned int ReadU16(const unsigned char* p)
+{
+	return (unsigned int)p[0] | ((unsigned int)p[1] << 8) ;
+}
+
+static unsigned int ReadU32(const unsigned char* p)
+{
+	return ReadU16(p) | (ReadU16(p + 2) << 16) ;
+}
+
+bool ParseWave(const RiffReader& riff, WaveData& wave)
+{
+	memset(&wave, 0, sizeof(wave)) ;
+
+	unsigned int form = riff.FormType() ;
+	if (form != RIFF_FOURCC('W', 'A', 'V', 'E') && form != RIFF_FOURCC('X', 'W', 'M', 'A'))
+	{
+		return false ;
+	}
+	wave.xwma = form == RIFF_FOURCC('X', 'W', 'M', 'A') ;
+
+	const RiffChunk* fmt = riff.Find(RIFF_FOURCC('f', 'm', 't', ' ')) ;
+	const RiffChunk* data = riff.Find(RIFF_FOURCC('d', 'a', 't', 'a')) ;
+	if (!fmt || !data)
+	{
+		return false ;
+	}
+
+	wave.samples = data->data ;
+	wave.sampleBytes = data->size ;
+
+	const RiffChunk* dpds = riff.Find(RIFF_FOURCC('d', 'p', 'd', 's')) ;
+	if (dpds)
+	{
+		wave.seekTable = dpds->data ;
+		wave.seekTableSize = dpds->size ;
+	}
+
+	return ParseWaveFormat(fmt->data, fmt->size, wave) ;
+}
+
+bool ParseWaveFormat(const unsigned char* fmt, unsigned int size, WaveData& wave)
+{
+	// WAVEFORMATEX without cbSize is 16 bytes
+	if (size < 16)
+	{
+		return false ;
+	}
+
+	wave.format = fmt ;
+	wave.formatSize = size ;
+	wave.formatTag = ReadU16(fmt) ;
+	wave.channels = (int)ReadU16(fmt + 2) ;
+	wave.sampleRate = (int)ReadU32(fmt + 4) ;
+	wave.blockAlign = (int)ReadU16(fmt + 12) ;
+	wave.bitsPerSample = (int)ReadU16(fmt + 14) ;
+
+	// WAVEFORMATEXTENSIBLE, the format tag is the first two bytes of the SubFormat GUID
+	if (wave.formatTag == WAVE_TAG_EXTENSIBLE)
+	{
+		if (size < 40)
+		{
+			return false ;
+		}
+		wave.formatTag = ReadU16(fmt + 24) ;
+	}
+
+	return wave.channels > 0 && wave.sampleRate > 0 && wave.blockAlign > 0 ;
+}
+
+bool WaveToClip(const WaveData& wave, AudioClip& clip)
+{
+	bool pcm = wave.formatTag == WAVE_TAG_PCM && (wave.bitsPerSample == 8 || wave.bitsPerSample == 16 ||
+												 wave.bitsPerSample == 24 || wave.bitsPerSample == 32) ;
+	bool ieee = wave.formatTag == WAVE_TAG_FLOAT && wave.bitsPerSample == 32 ;
+	if (wave.xwma || (!pcm && !ieee) || wave.blockAlign != wave.channels * wave.bitsPerSample / 8)
+	{
+		return false ;
+	}
+
+	clip.format.sampleType = ieee ? AUDIO_FLOAT : AUDIO_PCM ;
+	clip.format.sampleRate = wave.sampleRate ;
+	clip.format.channels = wave.channels ;
+	clip.format.bitsPerSample = wave.bitsPerSample ;
+	clip.data = wave.samples ;
+
+	// Whole frames only, a truncated file may end in the middle of one
+	clip.bytes = wave.sampleBytes - wave.sampleBytes % wave.blockAlign ;
+	return true ;
+}
+
+WaveFile::WaveFile(void)
+	: m_pError("")
+{
+	memset(&m_Data, 0, sizeof(m_Data)) ;
+}
+
+WaveFile::~WaveFile(void)
+{
+}
+
+bool WaveFile::Open(const char* path)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_pError = "cannot open the file" ;
+		return false ;
+	}
+	return Parse(m_File.Data(), m_File.Size()) ;
+}
+
+#ifdef _WIN32
+bool WaveFile::Open(const wchar_t* path)
+{
+	Close() ;
+	if (!m_File.Open(path))
+	{
+		m_pError = "cannot open the file" ;
+		return false ;
+	}
+	return Parse(m_File.Data(), m_File.Size()) ;
+}
+#endif
+
+bool WaveFile::OpenMemory(const unsigned char* data, size_t size)
+{
+	Close() ;
+	return Parse(data, size) ;
+}
+
+void WaveFile::Close()
+{
+	m_File.Close() ;
+	memset(&m_Data, 0, sizeof(m_Data)) ;
+	m_pError = "" ;
+}
+
+bool WaveFile::Parse(const unsigned char* data, size_t size)
+{
+	if (!m_Riff.Parse(data, size))
+	{
+		m_pError = RiffErrorText(m_Riff.Error()) ;
+		m_File.Close() ;
+		return false ;
+	}
+
+	if (!ParseWave(m_Riff, m_Data))
+	{
+		m_pError = "not a WAVE file or the fmt or data chunk is missing" ;
+		m_File.Close() ;
+		return false ;
+	}
+
+	return true ;
+}
@@ -0,0 +1,84 @@
+#ifndef __WAVE_FILE_H__
+#define __WAVE_FILE_H__
+
+#include "AudioBackend.h"
+#include "RiffReader.h"
+#include "../Utility/MappedFile.h"
+
+// WAVEFORMATEX format tags
+#define WAVE_TAG_PCM		0x0001
+#define WAVE_TAG_FLOAT		0x0003
+#define WAVE_TAG_EXTENSIBLE	0xFFFE
+
+// The chunks of a WAVE or XWMA file, all pointers point into the parsed buffer
+struct WaveData
+{
+	const unsigned char* format ;		// fmt chunk, a WAVEFORMATEX or a larger structure
+	unsigned int formatSize ;
+	const unsigned char* samples ;		// data chunk
+	unsigned int sampleBytes ;
+	const unsigned char* seekTable ;	// dpds chunk of xWMA files, NULL otherwise
+	unsigned int seekTableSize ;
+	unsigned int formatTag ;			// wFormatTag, for WAVE_FORMAT_EXTENSIBLE the tag of the sub format
+	int sampleRate ;
+	int channels ;
+	int bitsPerSample ;
+	int blockAlign ;
+	bool xwma ;
+};
+
+// Find and check the fmt and data chunks, false if the file is not a usable WAVE or XWMA file
+bool ParseWave(const RiffReader& riff, WaveData& wave) ;
+
+// Read the fields of a fmt chunk into wave, for readers that find the chunks themselves
+bool ParseWaveFormat(const unsigned char* fmt, unsigned int size, WaveData& wave) ;
+
+// Describe PCM and float data as a clip, false for compressed formats
+bool WaveToClip(const WaveData& wave, AudioClip& clip) ;
+
+/*
+A wave file mapped into memory.
+
+Open maps the file and parses its chunks once, the sample data is played straight from
+the mapping, so loading a sound costs one mapping and no copy. Clips and pointers taken
+from the file are valid until it is closed.
+*/
+class WaveFile
+{
+public:
+	WaveFile(void);
+	~WaveFile(void);
+
+	bool Open(const char* path) ;
+#ifdef _WIN32
+	bool Open(const wchar_t* path) ;
+#endif
+
+	// Parse a file already in memory, e.g. an asset pack entry, the memory must stay valid until the file is closed
+	bool OpenMemory(const unsigned char* data, size_t size) ;
+
+	void Close() ;
+
+	const WaveData& Data() const { return m_Data ; }
+
+	// The file as a clip, false for compressed formats
+	bool GetClip(AudioClip& clip) const { return WaveToClip(m_Data, clip) ; }
+
+	const RiffReader& Riff() const { return m_Riff ; }
+
+	// Why the last Open failed
+	const char* ErrorText() const { return m_pError ; }
+
+private:
+	bool Parse(const unsigned char* data, size_t size) ;
+
+	MappedFile m_File ;
+	RiffReader m_Riff ;
+	WaveData m_Data ;
+	const char* m_pError ;
+
+	WaveFile(const WaveFile&) ;
+	WaveFile& operator=(const WaveFile&) ;
+};
+
+#endif // end __WAVE_FILE_H__
@@ -0,0 +1,87 @@
+#include "WaveWriter.h"
+
+#include <stdio.h>
+
+// RIFF is little endian, write byte by byte so the result does not depend on the host
+static void PutU16(std::vector<unsigned char>& out, unsigned int value)
+{
+	out.push_back((unsigned char)(value & 0xFF)) ;
+	out.push_back((unsigned char)((value >> 8) & 0xFF)) ;
+}
+
+static void PutU32(std::vector<unsigned char>& out, unsigned int value)
+{
+	PutU16(out, value & 0xFFFF) ;
+	PutU16(out, value >> 16) ;
+}
+
+static void PutTag(std::vector<unsigned char>& out, const char* tag)
+{
+	out.insert(out.end(), tag, tag + 4) ;
+}
+
+bool EncodeWAV(const short* samples, int frames, int channels, int sampleRate, std::vector<unsigned char>& out)
+{
+	if (frames < 0 || channels <= 0 || sampleRate <= 0)
+	{
+		return false ;
+	}
+
+	unsigned int blockAlign = channels * 2 ;
+	unsigned int dataBytes = (unsigned int)frames * blockAlign ;
+
+	PutTag(out, "RIFF") ;
+	PutU32(out, 4 + 8 + 16 + 8 + dataBytes) ;
+	PutTag(out, "WAVE") ;
+
+	// WAVEFORMATEX without cbSize, the PCM layout
+	PutTag(out, "fmt ") ;
+	PutU32(out, 16) ;
+	PutU16(out, 1) ;					// WAVE_FORMAT_PCM
+	PutU16(out, channels) ;
+	PutU32(out, sampleRate) ;
+	PutU32(out, sampleRate * blockAlign) ;
+	PutU16(out, blockAlign) ;
+	PutU16(out, 16) ;
+
+	PutTag(out, "data") ;
+	PutU32(out, dataBytes) ;
+
+	size_t start = out.size() ;
+	out.resize(start + dataBytes) ;
+	unsigned char* dst = out.empty() ? NULL : &out[start] ;
+	for (size_t i = 0; i < (size_t)frames * channels; ++i)
+	{
+		unsigned short value = (unsigned short)samples[i] ;
+		dst[i * 2] = (unsigned char)(value & 0xFF) ;
+		dst[i * 2 + 1] = (unsigned char)(value >> 8) ;
+	}
+
+	return true ;
+}
+
+bool WriteWAV(const char* path, const short* samples, int frames, int channels, int sampleRate)
+{
+	std::vector<unsigned char> file ;
+	if (!EncodeWAV(samples, frames, channels, sampleRate, file))
+	{
+		return false ;
+	}
+
+	FILE* fp = NULL ;
+#ifdef _MSC_VER
+	if (fopen_s(&fp, path, "wb") != 0)
+	{
+		fp = NULL ;
+	}
+#else
+	fp = fopen(path, "wb") ;
+#endif
+	if (!fp)
+	{
+		return false ;
+	}
+
+	bool ok = fwrite(&file[0], 1, file.size(), fp) == file.size() ;
+	return fclose(fp) == 0 && ok ;
+}
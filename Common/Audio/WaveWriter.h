@@ -0,0 +1,12 @@
+#ifndef __WAVE_WRITER_H__
+#define __WAVE_WRITER_H__
+
+#include <vector>
+
+// Encode interleaved 16 bit PCM samples as a WAV file and append it to out
+bool EncodeWAV(const short* samples, int frames, int channels, int sampleRate, std::vector<unsigned char>& out) ;
+
+// Write interleaved 16 bit PCM samples to a WAV file, return false if the file cannot be written
+bool WriteWAV(const char* path, const short* samples, int frames, int channels, int sampleRate) ;
+
+#endif // end __WAVE_WRITER_H__
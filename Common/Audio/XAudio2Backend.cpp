@@ -0,0 +1,205 @@
+#include <Windows.h>
+#include <XAudio2.h>
+#include <algorithm>
+#include "XAudio2Backend.h"
+
+// Fill a WAVEFORMATEX for a PCM or float format
+static void ToWaveFormat(const AudioFormat& format, WAVEFORMATEX& wfx)
+{
+	ZeroMemory(&wfx, sizeof(wfx)) ;
+	wfx.wFormatTag = format.sampleType == AUDIO_FLOAT ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM ;
+	wfx.nChannels = (WORD)format.channels ;
+	wfx.nSamplesPerSec = format.sampleRate ;
+	wfx.wBitsPerSample = (WORD)format.bitsPerSample ;
+	wfx.nBlockAlign = (WORD)format.BlockAlign() ;
+	wfx.nAvgBytesPerSec = format.sampleRate * format.BlockAlign() ;
+}
+
+class XAudio2Backend::XAudio2Voice : public AudioVoice
+{
+public:
+	XAudio2Voice(IXAudio2SourceVoice* voice, const AudioFormat& format, int masterChannels)
+		: m_pVoice(voice),
+		  m_Format(format),
+		  m_MasterChannels(masterChannels)
+	{
+	}
+
+	virtual ~XAudio2Voice()
+	{
+		m_pVoice->DestroyVoice() ;
+	}
+
+	virtual bool Start(const AudioClip& clip, float volume)
+	{
+		if (!(clip.format == m_Format))
+		{
+			return false ;
+		}
+
+		// Drop what the voice was playing, a flushed buffer no longer counts against the
+		// XAUDIO2_MAX_QUEUED_BUFFERS limit once the voice has processed the flush
+		m_pVoice->Stop(0) ;
+		m_pVoice->FlushSourceBuffers() ;
+
+		XAUDIO2_BUFFER buffer ;
+		ZeroMemory(&buffer, sizeof(buffer)) ;
+		buffer.AudioBytes = (UINT32)clip.bytes ;
+		buffer.pAudioData = clip.data ;
+		buffer.Flags = XAUDIO2_END_OF_STREAM ;
+
+		if (FAILED(m_pVoice->SubmitSourceBuffer(&buffer)))
+		{
+			return false ;
+		}
+
+		m_pVoice->SetVolume(volume) ;
+		return SUCCEEDED(m_pVoice->Start(0)) ;
+	}
+
+	virtual void Stop()
+	{
+		m_pVoice->Stop(0) ;
+		m_pVoice->FlushSourceBuffers() ;
+	}
+
+	virtual void SetVolume(float volume)
+	{
+		m_pVoice->SetVolume(volume) ;
+	}
+
+	virtual void SetPan(float pan)
+	{
+		// Only mono and stereo sources on a stereo or larger output are panned
+		if (m_Format.channels > 2 || m_MasterChannels < 2)
+		{
+			return ;
+		}
+
+		float left, right ;
+		PanGains(pan, left, right) ;
+
+		// One row per output channel, one column per source channel
+		float matrix[2 * XAUDIO2_MAX_AUDIO_CHANNELS] = { 0 } ;
+		if (m_Format.channels == 1)
+		{
+			matrix[0] = left ;
+			matrix[1] = right ;
+		}
+		else
+		{
+			matrix[0] = left ;
+			matrix[3] = right ;
+		}
+		m_pVoice->SetOutputMatrix(NULL, m_Format.channels, m_MasterChannels, matrix) ;
+	}
+
+	virtual void SetPitch(float ratio)
+	{
+		// Voices are created with the default maximum ratio
+		ratio = ratio < XAUDIO2_MIN_FREQ_RATIO ? XAUDIO2_MIN_FREQ_RATIO : ratio ;
+		ratio = ratio > XAUDIO2_DEFAULT_FREQ_RATIO ? XAUDIO2_DEFAULT_FREQ_RATIO : ratio ;
+		m_pVoice->SetFrequencyRatio(ratio) ;
+	}
+
+	virtual bool IsPlaying()
+	{
+		XAUDIO2_VOICE_STATE state ;
+		m_pVoice->GetState(&state) ;
+		return state.BuffersQueued > 0 ;
+	}
+
+private:
+	IXAudio2SourceVoice* m_pVoice ;
+	AudioFormat m_Format ;
+	int m_MasterChannels ;
+};
+
+XAudio2Backend::XAudio2Backend(void)
+	: m_pXAudio2(NULL),
+	  m_pMasteringVoice(NULL),
+	  m_MasterChannels(0),
+	  m_bComInitialized(false)
+{
+}
+
+XAudio2Backend::~XAudio2Backend(void)
+{
+	// Source voices must go before the mastering voice and the engine
+	for (size_t i = 0; i < m_Voices.size(); ++i)
+	{
+		delete m_Voices[i] ;
+	}
+	m_Voices.clear() ;
+
+	if (m_pMasteringVoice)
+	{
+		m_pMasteringVoice->DestroyVoice() ;
+		m_pMasteringVoice = NULL ;
+	}
+
+	if (m_pXAudio2)
+	{
+		m_pXAudio2->Release() ;
+		m_pXAudio2 = NULL ;
+	}
+
+	if (m_bComInitialized)
+	{
+		CoUninitialize() ;
+	}
+}
+
+bool XAudio2Backend::Initialize()
+{
+	// XAudio2 2.7 from the DirectX SDK is a COM object
+	m_bComInitialized = SUCCEEDED(CoInitializeEx(NULL, COINIT_MULTITHREADED)) ;
+
+	if (FAILED(XAudio2Create(&m_pXAudio2, 0, XAUDIO2_DEFAULT_PROCESSOR)))
+	{
+		return false ;
+	}
+
+	if (FAILED(m_pXAudio2->CreateMasteringVoice(&m_pMasteringVoice)))
+	{
+		return false ;
+	}
+
+	XAUDIO2_VOICE_DETAILS details ;
+	m_pMasteringVoice->GetVoiceDetails(&details) ;
+	m_MasterChannels = details.InputChannels ;
+
+	m_Clock.Restart() ;
+	return true ;
+}
+
+AudioVoice* XAudio2Backend::CreateVoice(const AudioFormat& format)
+{
+	if (!m_pXAudio2)
+	{
+		return NULL ;
+	}
+
+	WAVEFORMATEX wfx ;
+	ToWaveFormat(format, wfx) ;
+
+	IXAudio2SourceVoice* pSourceVoice = NULL ;
+	if (FAILED(m_pXAudio2->CreateSourceVoice(&pSourceVoice, &wfx)))
+	{
+		return NULL ;
+	}
+
+	XAudio2Voice* voice = new XAudio2Voice(pSourceVoice, format, m_MasterChannels) ;
+	m_Voices.push_back(voice) ;
+	return voice ;
+}
+
+void XAudio2Backend::DestroyVoice(AudioVoice* voice)
+{
+	std::vector<XAudio2Voice*>::iterator it = std::find(m_Voices.begin(), m_Voices.end(), voice) ;
+	if (it != m_Voices.end())
+	{
+		delete *it ;
+		m_Voices.erase(it) ;
+	}
+}
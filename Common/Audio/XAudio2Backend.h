@@ -0,0 +1,46 @@
+#ifndef __XAUDIO2_BACKEND_H__
+#define __XAUDIO2_BACKEND_H__
+
+#include <vector>
+#include "AudioBackend.h"
+#include "../Utility/Timer.h"
+
+struct IXAudio2 ;
+struct IXAudio2MasteringVoice ;
+
+/*
+AudioBackend on top of one XAudio2 engine and mastering voice.
+
+Every AudioVoice is an IXAudio2SourceVoice created up front, Start resubmits the clip
+buffer to it, so nothing is created or destroyed while sounds are playing.
+*/
+class XAudio2Backend : public AudioBackend
+{
+public:
+	XAudio2Backend(void);
+	virtual ~XAudio2Backend(void);
+
+	// Create the engine and the mastering voice
+	bool Initialize() ;
+
+	virtual AudioVoice* CreateVoice(const AudioFormat& format) ;
+	virtual void DestroyVoice(AudioVoice* voice) ;
+	virtual double TimeMs() { return m_Clock.ElapsedMs() ; }
+
+	IXAudio2* Engine() const { return m_pXAudio2 ; }
+
+private:
+	class XAudio2Voice ;
+
+	IXAudio2* m_pXAudio2 ;
+	IXAudio2MasteringVoice* m_pMasteringVoice ;
+	std::vector<XAudio2Voice*> m_Voices ;
+	int m_MasterChannels ;
+	Timer m_Clock ;
+	bool m_bComInitialized ;
+
+	XAudio2Backend(const XAudio2Backend&) ;
+	XAudio2Backend& operator=(const XAudio2Backend&) ;
+};
+
+#endif // end __XAUDIO2_BACKEND_H__
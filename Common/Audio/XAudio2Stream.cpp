@@ -0,0 +1,128 @@
+#include "XAudio2Stream.h"
+
+#include <string.h>
+
+XAudio2StreamVoice::XAudio2StreamVoice(void)
+	: m_pVoice(NULL),
+	  m_pStream(NULL),
+	  m_hBufferEvent(NULL),
+	  m_bEndSubmitted(false),
+	  m_bFinished(false)
+{
+}
+
+XAudio2StreamVoice::~XAudio2StreamVoice(void)
+{
+	Destroy() ;
+}
+
+bool XAudio2StreamVoice::Create(IXAudio2* engine, AudioStream* stream)
+{
+	Destroy() ;
+
+	const WaveData& wave = stream->Wave() ;
+	if (!wave.format)
+	{
+		return false ;
+	}
+
+	// The fmt chunk may be shorter than WAVEFORMATEXTENSIBLE, XAudio2 reads cbSize and beyond
+	WAVEFORMATEXTENSIBLE wfx = {0} ;
+	memcpy(&wfx, wave.format, min(wave.formatSize, (unsigned int)sizeof(wfx))) ;
+
+	if (FAILED(engine->CreateSourceVoice(&m_pVoice, (WAVEFORMATEX*)&wfx, 0, XAUDIO2_DEFAULT_FREQ_RATIO, this)))
+	{
+		m_pVoice = NULL ;
+		return false ;
+	}
+
+	m_hBufferEvent = CreateEvent(NULL, FALSE, FALSE, NULL) ;
+	m_pStream = stream ;
+
+	// Start with as much queued as the I/O thread can read in a short while
+	stream->WaitReady(2, 1000) ;
+	Pump() ;
+	return true ;
+}
+
+void XAudio2StreamVoice::Destroy()
+{
+	// DestroyVoice waits for the audio thread, no callback runs after it returns
+	if (m_pVoice)
+	{
+		m_pVoice->DestroyVoice() ;
+		m_pVoice = NULL ;
+	}
+	if (m_hBufferEvent)
+	{
+		CloseHandle(m_hBufferEvent) ;
+		m_hBufferEvent = NULL ;
+	}
+
+	m_pStream = NULL ;
+	m_bEndSubmitted = false ;
+	m_bFinished = false ;
+}
+
+bool XAudio2StreamVoice::Start()
+{
+	return m_pVoice && SUCCEEDED(m_pVoice->Start(0)) ;
+}
+
+void XAudio2StreamVoice::Pump()
+{
+	while (!m_bEndSubmitted)
+	{
+		size_t bytes = 0 ;
+		bool last = false ;
+		const unsigned char* data = m_pStream->Acquire(bytes, last) ;
+		if (!data)
+		{
+			break ;
+		}
+
+		if (bytes == 0)
+		{
+			// Nothing left to submit, end the stream after what is queued
+			m_pStream->Release() ;
+			m_pVoice->Discontinuity() ;
+			m_bEndSubmitted = true ;
+			break ;
+		}
+
+		XAUDIO2_BUFFER buffer = {0} ;
+		buffer.AudioBytes = (UINT32)bytes ;
+		buffer.pAudioData = data ;
+		buffer.Flags = last ? XAUDIO2_END_OF_STREAM : 0 ;
+		if (FAILED(m_pVoice->SubmitSourceBuffer(&buffer)))
+		{
+			// The buffer stays acquired so the I/O thread cannot overwrite queued audio, play out what is queued
+			m_pVoice->Discontinuity() ;
+			m_bEndSubmitted = true ;
+			break ;
+		}
+
+		m_bEndSubmitted = last ;
+	}
+}
+
+void XAudio2StreamVoice::OnStreamEnd()
+{
+	m_bFinished = true ;
+	SetEvent(m_hBufferEvent) ;
+}
+
+void XAudio2StreamVoice::OnBufferEnd(void* context)
+{
+	m_pStream->Release() ;
+
+	// Ran dry before the end, the voice is silent until Pump submits again
+	XAUDIO2_VOICE_STATE state ;
+	m_pVoice->GetState(&state) ;
+	if (state.BuffersQueued == 0 && !m_bEndSubmitted)
+	{
+		m_pStream->Underrun() ;
+	}
+
+	SetEvent(m_hBufferEvent) ;
+}
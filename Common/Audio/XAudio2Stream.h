@@ -0,0 +1,58 @@
+#ifndef __XAUDIO2_STREAM_H__
+#define __XAUDIO2_STREAM_H__
+
+#include <Windows.h>
+#include <XAudio2.h>
+#include "AudioStream.h"
+
+/*
+Source voice fed from an AudioStream.
+
+Every buffer the stream has read is submitted to the voice, when the voice finishes one
+it is given back to the stream from OnBufferEnd and BufferEvent is signalled. The
+thread that owns the voice waits on the event and calls Pump to submit what the I/O
+thread has read since; XAudio2 callbacks must not block, so they never submit.
+A voice that runs out of buffers before the end of the stream counts an under-run.
+*/
+class XAudio2StreamVoice : public IXAudio2VoiceCallback
+{
+public:
+	XAudio2StreamVoice(void);
+	virtual ~XAudio2StreamVoice(void);
+
+	// Create the voice for the stream's format and queue the first buffers
+	bool Create(IXAudio2* engine, AudioStream* stream) ;
+
+	void Destroy() ;
+
+	bool Start() ;
+
+	// Submit every buffer the stream has ready, call when BufferEvent is signalled
+	void Pump() ;
+
+	HANDLE BufferEvent() const { return m_hBufferEvent ; }
+
+	// The last buffer has been played
+	bool Finished() const { return m_bFinished ; }
+
+	// IXAudio2VoiceCallback
+	STDMETHOD_(void, OnVoiceProcessingPassStart)(UINT32 bytesRequired) {}
+	STDMETHOD_(void, OnVoiceProcessingPassEnd)() {}
+	STDMETHOD_(void, OnStreamEnd)() ;
+	STDMETHOD_(void, OnBufferStart)(void* context) {}
+	STDMETHOD_(void, OnBufferEnd)(void* context) ;
+	STDMETHOD_(void, OnLoopEnd)(void* context) {}
+	STDMETHOD_(void, OnVoiceError)(void* context, HRESULT error) {}
+
+private:
+	IXAudio2SourceVoice* m_pVoice ;
+	AudioStream* m_pStream ;
+	HANDLE m_hBufferEvent ;
+	volatile bool m_bEndSubmitted ;
+	volatile bool m_bFinished ;
+
+	XAudio2StreamVoice(const XAudio2StreamVoice&) ;
+	XAudio2StreamVoice& operator=(const XAudio2StreamVoice&) ;
+};
+
+#endif // end __XAUDIO2_STREAM_H__
@@ -0,0 +1,503 @@
+/*
+Benchmark and self check for the asset pack code in Common/Asset.
+
+Runs on any machine, including Linux:
+	g++ -O2 -I../../Asset AssetBenchmark.cpp ../../Asset/AssetPack.cpp ../../Asset/PackWriter.cpp \
+		../../Asset/Lz4.cpp ../../Utility/MappedFile.cpp -o AssetBenchmark
+
+Writes a set of generated media files into asset_bench/ in the working directory, packs
+them and compares loading every file on its own with loading them from the pack, then
+removes the files again. The files are in the OS cache after they are written, so the
+times show the cost of opening files, not of the disk.
+
+Exits with a non-zero code if LZ4 data does not round trip, the decompressor accepts a
+damaged block, a pack entry cannot be found or differs from its file, or a damaged pack
+index is accepted.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDir(path) _mkdir(path)
+#define RemoveDir(path) _rmdir(path)
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#define MakeDir(path) mkdir(path, 0755)
+#define RemoveDir(path) rmdir(path)
+#endif
+
+#include "Lz4.h"
+#include "AssetPack.h"
+#include "PackWriter.h"
+#include "../../Utility/Timer.h"
+
+static const char* BENCH_DIR = "asset_bench" ;
+
+// Small deterministic random generator, rand() differs between CRTs
+static unsigned int g_Seed = 12345 ;
+static unsigned int NextRandom()
+{
+	g_Seed ^= g_Seed << 13 ;
+	g_Seed ^= g_Seed >> 17 ;
+	g_Seed ^= g_Seed << 5 ;
+	return g_Seed ;
+}
+
+enum CONTENT
+{
+	CONTENT_TEXT,		// like the text .x meshes
+	CONTENT_NOISE,		// like JPEG and other compressed files
+	CONTENT_SOUND,		// like 16 bit wave samples, a slow tone with noise
+	CONTENT_ZEROS,
+	CONTENT_COUNT
+};
+
+static const char* s_ContentNames[CONTENT_COUNT] = { "text", "noise", "sound", "zeros" } ;
+
+static void Generate(CONTENT content, size_t size, std::vector<unsigned char>& out)
+{
+	out.clear() ;
+	switch (content)
+	{
+	case CONTENT_TEXT:
+		while (out.size() < size)
+		{
+			char line[64] ;
+			sprintf(line, "    %d.%06d;%d.%06d;%d.%06d;,\n", NextRandom() % 2, NextRandom() % 1000000,
+				NextRandom() % 2, NextRandom() % 1000000, NextRandom() % 2, NextRandom() % 1000000) ;
+			out.insert(out.end(), line, line + strlen(line)) ;
+		}
+		out.resize(size) ;
+		break ;
+
+	case CONTENT_NOISE:
+		for (size_t i = 0; i < size; ++i)
+		{
+			out.push_back((unsigned char)NextRandom()) ;
+		}
+		break ;
+
+	case CONTENT_SOUND:
+		for (size_t i = 0; i < size; i += 2)
+		{
+			int sample = (int)((i / 2) % 200) * 300 - 30000 + (int)(NextRandom() % 64) ;
+			out.push_back((unsigned char)sample) ;
+			out.push_back((unsigned char)(sample >> 8)) ;
+		}
+		out.resize(size) ;
+		break ;
+
+	default:
+		out.assign(size, 0) ;
+		break ;
+	}
+}
+
+static bool RoundTrip(const std::vector<unsigned char>& data, size_t& packedSize)
+{
+	std::vector<unsigned char> packed(Lz4CompressBound(data.size())) ;
+	std::vector<unsigned char> unpacked(data.size() + 1) ;
+
+	packedSize = Lz4Compress(data.empty() ? NULL : &data[0], data.size(), &packed[0]) ;
+	if (packedSize > packed.size())
+	{
+		return false ;
+	}
+	if (!Lz4Decompress(&packed[0], packedSize, &unpacked[0], data.size()))
+	{
+		return false ;
+	}
+	return data.empty() || memcmp(&data[0], &unpacked[0], data.size()) == 0 ;
+}
+
+// Every size up to 300 bytes and a few large blocks of each content, then damaged blocks
+static bool Lz4Test()
+{
+	bool ok = true ;
+	std::vector<unsigned char> data ;
+	size_t packedSize ;
+
+	for (int content = 0; content < CONTENT_COUNT; ++content)
+	{
+		for (size_t size = 0; size <= 300; ++size)
+		{
+			Generate((CONTENT)content, size, data) ;
+			if (!RoundTrip(data, packedSize))
+			{
+				printf("lz4 round trip failed: %s, %d bytes\n", s_ContentNames[content], (int)size) ;
+				ok = false ;
+			}
+		}
+	}
+
+	printf("%-8s %10s %10s %8s %10s %10s\n", "content", "bytes", "packed", "ratio", "pack MB/s", "unpack MB/s") ;
+	for (int content = 0; content < CONTENT_COUNT; ++content)
+	{
+		const size_t size = 4 << 20 ;
+		Generate((CONTENT)content, size, data) ;
+
+		std::vector<unsigned char> packed(Lz4CompressBound(size)) ;
+		std::vector<unsigned char> unpacked(size) ;
+
+		Timer timer ;
+		packedSize = Lz4Compress(&data[0], size, &packed[0]) ;
+		double packMs = timer.ElapsedMs() ;
+
+		const int repeat = 8 ;
+		timer.Restart() ;
+		bool decoded = true ;
+		for (int i = 0; i < repeat; ++i)
+		{
+			decoded = decoded && Lz4Decompress(&packed[0], packedSize, &unpacked[0], size) ;
+		}
+		double unpackMs = timer.ElapsedMs() / repeat ;
+
+		if (!decoded || memcmp(&data[0], &unpacked[0], size) != 0)
+		{
+			printf("lz4 round trip failed: %s, %d bytes\n", s_ContentNames[content], (int)size) ;
+			ok = false ;
+		}
+
+		printf("%-8s %10d %10d %7.1f%% %10.0f %10.0f\n", s_ContentNames[content], (int)size, (int)packedSize,
+			packedSize * 100.0 / size, size / 1048576.0 / (packMs / 1000.0), size / 1048576.0 / (unpackMs / 1000.0)) ;
+	}
+
+	// Damaged blocks must be rejected or decode to something of the right size, never overrun
+	Generate(CONTENT_TEXT, 20000, data) ;
+	std::vector<unsigned char> packed(Lz4CompressBound(data.size())) ;
+	packedSize = Lz4Compress(&data[0], data.size(), &packed[0]) ;
+	packed.resize(packedSize) ;
+
+	int rejected = 0 ;
+	const int trials = 20000 ;
+	for (int i = 0; i < trials; ++i)
+	{
+		std::vector<unsigned char> damaged(packed) ;
+		if (i % 4 == 0)
+		{
+			damaged.resize(NextRandom() % damaged.size()) ;
+		}
+		else
+		{
+			damaged[NextRandom() % damaged.size()] ^= (unsigned char)(1 + NextRandom() % 255) ;
+		}
+
+		// Guard bytes after the output catch writes past its end
+		std::vector<unsigned char> out(data.size() + 64, 0xCD) ;
+		if (!Lz4Decompress(damaged.empty() ? NULL : &damaged[0], damaged.size(), &out[0], data.size()))
+		{
+			++rejected ;
+		}
+		for (size_t j = data.size(); j < out.size(); ++j)
+		{
+			if (out[j] != 0xCD)
+			{
+				printf("lz4 decompressor wrote past the end of its output\n") ;
+				return false ;
+			}
+		}
+	}
+	printf("damaged blocks: %d of %d rejected, none overran\n\n", rejected, trials) ;
+
+	return ok ;
+}
+
+struct TestFile
+{
+	std::string name ;
+	std::vector<unsigned char> data ;
+};
+
+static bool WriteWholeFile(const std::string& path, const std::vector<unsigned char>& data)
+{
+	FILE* file = fopen(path.c_str(), "wb") ;
+	if (!file)
+	{
+		return false ;
+	}
+	bool written = data.empty() || fwrite(&data[0], 1, data.size(), file) == data.size() ;
+	return fclose(file) == 0 && written ;
+}
+
+static bool ReadWholeFile(const std::string& path, std::vector<unsigned char>& data)
+{
+	FILE* file = fopen(path.c_str(), "rb") ;
+	if (!file)
+	{
+		return false ;
+	}
+	fseek(file, 0, SEEK_END) ;
+	long size = ftell(file) ;
+	fseek(file, 0, SEEK_SET) ;
+	data.resize(size) ;
+	bool read = size == 0 || fread(&data[0], 1, size, file) == (size_t)size ;
+	fclose(file) ;
+	return read ;
+}
+
+// A damaged index or header must be rejected by Open, not crash a later Load
+static bool DamagedPackTest(const std::vector<unsigned char>& pack)
+{
+	const PackHeader* header = (const PackHeader*)&pack[0] ;
+	size_t indexEnd = (size_t)header->namesOffset + header->namesBytes ;
+
+	int accepted = 0 ;
+	int caught = 0 ;
+	const int trials = 5000 ;
+	for (int i = 0; i < trials; ++i)
+	{
+		std::vector<unsigned char> damaged(pack) ;
+		if (i % 8 == 0)
+		{
+			damaged.resize(NextRandom() % indexEnd) ;
+		}
+		else
+		{
+			damaged[NextRandom() % indexEnd] ^= (unsigned char)(1 << (NextRandom() % 8)) ;
+		}
+
+		AssetPack reader ;
+		if (!reader.OpenMemory(damaged.empty() ? NULL : &damaged[0], damaged.size()))
+		{
+			continue ;
+		}
+
+		// Damage the index accepts, a flipped checksum or compression of a stored entry, must
+		// still keep every entry inside the pack; Verify finds the bad entry
+		++accepted ;
+		for (int j = 0; j < reader.Count(); ++j)
+		{
+			const PackEntry& entry = reader.Entry(j) ;
+			if (entry.offset + entry.packedSize > damaged.size())
+			{
+				printf("damaged pack accepted with an entry outside the file\n") ;
+				return false ;
+			}
+			if (!reader.Verify(j))
+			{
+				++caught ;
+			}
+		}
+	}
+
+	printf("damaged packs: %d of %d rejected by Open, %d entries of the others failed Verify\n\n",
+		trials - accepted, trials, caught) ;
+	return true ;
+}
+
+static bool PackTest()
+{
+	bool ok = true ;
+
+	// A demo's worth of media, many small files as in RubikCube and a few larger ones
+	std::vector<TestFile> files ;
+	for (int i = 0; i < 200; ++i)
+	{
+		TestFile file ;
+		char name[64] ;
+		CONTENT content = (CONTENT)(i % 3) ;
+		sprintf(name, "Media/%s/File%03d.dat", s_ContentNames[content], i) ;
+		file.name = name ;
+		Generate(content, 2000 + NextRandom() % (i < 190 ? 16000 : 500000), file.data) ;
+		files.push_back(file) ;
+	}
+
+	MakeDir(BENCH_DIR) ;
+	std::string mediaDir = std::string(BENCH_DIR) + "/Media" ;
+	MakeDir(mediaDir.c_str()) ;
+	for (int content = 0; content < 3; ++content)
+	{
+		MakeDir((mediaDir + "/" + s_ContentNames[content]).c_str()) ;
+	}
+
+	PackWriter writer ;
+	writer.SetCompression(true) ;
+	size_t totalBytes = 0 ;
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		std::string path = std::string(BENCH_DIR) + "/" + files[i].name ;
+		if (!WriteWholeFile(path, files[i].data) || !writer.AddFile(files[i].name.c_str(), path.c_str()))
+		{
+			printf("cannot write %s\n", path.c_str()) ;
+			return false ;
+		}
+		totalBytes += files[i].data.size() ;
+	}
+
+	if (writer.AddFile("media\\TEXT\\file000.dat", "missing"))
+	{
+		printf("pack writer accepted a missing file\n") ;
+		ok = false ;
+	}
+	if (writer.AddData("./Media/text/File000.dat", "x", 1))
+	{
+		printf("pack writer accepted a name twice\n") ;
+		ok = false ;
+	}
+
+	std::string storedPath = std::string(BENCH_DIR) + "/stored.pack" ;
+	std::string packedPath = std::string(BENCH_DIR) + "/lz4.pack" ;
+	writer.SetCompression(false) ;
+	writer.Write(storedPath.c_str()) ;
+	writer.SetCompression(true) ;
+	if (!writer.Write(packedPath.c_str()))
+	{
+		printf("cannot write %s: %s\n", packedPath.c_str(), writer.ErrorText()) ;
+		return false ;
+	}
+	const PackWriterStats& stats = writer.Stats() ;
+	printf("%d files, %.1f MB, %d compressed, lz4 pack %.1f MB\n",
+		stats.entries, stats.bytes / 1048576.0, stats.compressed, stats.packSize / 1048576.0) ;
+
+	// Every file must come back under its own name, spelled any way
+	AssetPack pack ;
+	if (!pack.Open(packedPath.c_str()))
+	{
+		printf("cannot open %s: %s\n", packedPath.c_str(), PackErrorText(pack.Error())) ;
+		return false ;
+	}
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		std::string name = files[i].name ;
+		if (i % 2)
+		{
+			name = "./" + name ;
+			for (size_t j = 0; j < name.size(); ++j)
+			{
+				name[j] = name[j] == '/' ? '\\' : (char)toupper(name[j]) ;
+			}
+		}
+
+		Asset asset ;
+		if (!pack.Load(name.c_str(), asset) || asset.Size() != files[i].data.size() ||
+			memcmp(asset.Data(), &files[i].data[0], asset.Size()) != 0)
+		{
+			printf("pack entry %s differs from its file\n", name.c_str()) ;
+			ok = false ;
+		}
+
+		int index = pack.Find(name.c_str()) ;
+		if (index < 0 || pack.Entry(index).offset % 16 != 0)
+		{
+			printf("pack entry %s not found or not aligned\n", name.c_str()) ;
+			ok = false ;
+		}
+	}
+	if (pack.Find("Media/text/File999.dat") >= 0 || pack.Find("") >= 0)
+	{
+		printf("pack found an entry it does not have\n") ;
+		ok = false ;
+	}
+	if (pack.Stats().packLoads != (int)files.size() || pack.Stats().fileLoads != 0)
+	{
+		printf("pack loaded %d entries from loose files\n", pack.Stats().fileLoads) ;
+		ok = false ;
+	}
+
+	// Names the pack does not have come from loose files
+	Asset loose ;
+	std::string loosePath = std::string(BENCH_DIR) + "/" + files[0].name ;
+	if (!pack.Load(loosePath.c_str(), loose) || loose.Size() != files[0].data.size() || pack.Stats().fileLoads != 1)
+	{
+		printf("loose file fallback failed\n") ;
+		ok = false ;
+	}
+	loose.Release() ;
+
+	// Load everything, the way a demo starts: once as loose files, once from each pack
+	printf("\n%-22s %8s %12s %10s\n", "load all files", "opens", "time ms", "MB/s") ;
+	const int repeat = 20 ;
+	for (int method = 0; method < 3; ++method)
+	{
+		Timer timer ;
+		size_t checksum = 0 ;
+		int opens = 0 ;
+
+		for (int r = 0; r < repeat; ++r)
+		{
+			if (method == 0)
+			{
+				std::vector<unsigned char> data ;
+				for (size_t i = 0; i < files.size(); ++i)
+				{
+					ReadWholeFile(std::string(BENCH_DIR) + "/" + files[i].name, data) ;
+					checksum += data.size() ;
+				}
+				opens = (int)files.size() ;
+			}
+			else
+			{
+				AssetPack reader ;
+				reader.Open(method == 1 ? storedPath.c_str() : packedPath.c_str()) ;
+				Asset asset ;
+				for (size_t i = 0; i < files.size(); ++i)
+				{
+					reader.Load(files[i].name.c_str(), asset) ;
+					checksum += asset.Size() ;
+				}
+				opens = 1 ;
+			}
+		}
+
+		double ms = timer.ElapsedMs() / repeat ;
+		static const char* names[3] = { "loose files, fread", "pack, stored", "pack, lz4" } ;
+		printf("%-22s %8d %12.2f %10.0f\n", names[method], opens, ms, totalBytes / 1048576.0 / (ms / 1000.0)) ;
+
+		if (checksum != totalBytes * repeat)
+		{
+			printf("%s loaded %d bytes instead of %d\n", names[method], (int)(checksum / repeat), (int)totalBytes) ;
+			ok = false ;
+		}
+	}
+
+	// Lookups alone, the index is searched in place
+	{
+		Timer timer ;
+		int found = 0 ;
+		const int lookups = 200000 ;
+		for (int i = 0; i < lookups; ++i)
+		{
+			found += pack.Find(files[i % files.size()].name.c_str()) >= 0 ;
+		}
+		printf("\nlookup: %.0f ns per name\n\n", timer.ElapsedMs() * 1e6 / lookups) ;
+		if (found != lookups)
+		{
+			ok = false ;
+		}
+	}
+
+	std::vector<unsigned char> packBytes ;
+	ReadWholeFile(packedPath, packBytes) ;
+	pack.Close() ;
+	ok = DamagedPackTest(packBytes) && ok ;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		remove((std::string(BENCH_DIR) + "/" + files[i].name).c_str()) ;
+	}
+	remove(storedPath.c_str()) ;
+	remove(packedPath.c_str()) ;
+	for (int content = 0; content < 3; ++content)
+	{
+		RemoveDir((mediaDir + "/" + s_ContentNames[content]).c_str()) ;
+	}
+	RemoveDir(mediaDir.c_str()) ;
+	RemoveDir(BENCH_DIR) ;
+
+	return ok ;
+}
+
+int main()
+{
+	bool ok = Lz4Test() ;
+	ok = PackTest() && ok ;
+
+	printf(ok ? "all checks passed\n" : "CHECKS FAILED\n") ;
+	return ok ? 0 : 1 ;
+}
@@ -0,0 +1,1002 @@
+/*
+Headless benchmark for the sound effect code in Common/Audio.
+
+The voice pool runs on NullAudioBackend and the mixer renders offline, so it needs no
+audio device and runs on any machine, including Linux:
+	g++ -O2 -pthread -I../../Audio AudioBenchmark.cpp ../../Audio/VoicePool.cpp \
+		../../Audio/NullAudioBackend.cpp ../../Audio/SoftwareMixer.cpp \
+		../../Audio/OfflineRender.cpp ../../Audio/WaveWriter.cpp ../../Audio/RiffReader.cpp \
+		../../Audio/WaveFile.cpp ../../Audio/AudioStream.cpp ../../Utility/MappedFile.cpp -o AudioBenchmark
+
+	AudioBenchmark [script.txt]
+
+renders the event script (see OfflineRender.h) with four generated sounds to
+offline_mix.wav, a built-in script is used when none is given.
+
+Exits with a non-zero code if a trigger fails, more voices play than the pool owns, a
+voice starts later than one device block after it was triggered, the mixer output
+differs from a reference mix, the wave parser accepts a chunk outside its file or a
+stream does not deliver the file's samples in order.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+
+#include "VoicePool.h"
+#include "NullAudioBackend.h"
+#include "SoftwareMixer.h"
+#include "OfflineRender.h"
+#include "WaveWriter.h"
+#include "WaveFile.h"
+#include "AudioStream.h"
+#include "../../Utility/Timer.h"
+
+// XAUDIO2_MAX_QUEUED_BUFFERS
+static const int MAX_QUEUED_BUFFERS = 64 ;
+
+// Small deterministic random generator, rand() differs between CRTs
+static unsigned int g_Seed = 12345 ;
+static unsigned int NextRandom()
+{
+	g_Seed ^= g_Seed << 13 ;
+	g_Seed ^= g_Seed >> 17 ;
+	g_Seed ^= g_Seed << 5 ;
+	return g_Seed ;
+}
+
+// Silent clip of the given length, the null backend only looks at the size
+struct TestClip
+{
+	std::vector<unsigned char> data ;
+	AudioClip clip ;
+
+	void Create(int sampleRate, int channels, int frames)
+	{
+		clip.format.sampleType = AUDIO_PCM ;
+		clip.format.sampleRate = sampleRate ;
+		clip.format.channels = channels ;
+		clip.format.bitsPerSample = 16 ;
+		data.assign((size_t)frames * clip.format.BlockAlign(), 0) ;
+		clip.data = &data[0] ;
+		clip.bytes = data.size() ;
+	}
+
+	// Sine tone, the right channel of stereo clips an octave higher
+	void CreateTone(int sampleRate, int channels, int frames, double frequency, double amplitude)
+	{
+		Create(sampleRate, channels, frames) ;
+		short* samples = (short*)&data[0] ;
+		for (int i = 0; i < frames; ++i)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				double phase = 2 * 3.14159265358979 * frequency * (c + 1) * i / sampleRate ;
+				samples[i * channels + c] = (short)floor(sin(phase) * amplitude * 32767 + 0.5) ;
+			}
+		}
+	}
+
+	double Sample(size_t frame, int channel) const
+	{
+		return ((const short*)&data[0])[frame * clip.format.channels + channel] / 32768.0 ;
+	}
+};
+
+// Check the pool and backend statistics after a run, print the result line
+static bool CheckRun(const char* name, VoicePool& pool, NullAudioBackend& backend, double blockMs, double playUs)
+{
+	const VoicePoolStats& stats = pool.Stats() ;
+	const NullAudioStats& audio = backend.Stats() ;
+	double avgLatency = audio.starts ? audio.latencySumMs / audio.starts : 0 ;
+
+	printf("%-14s %7d %7d %9d %6d %6d/%-3d %9.2f %9.2f %9.3f\n", name, stats.plays, stats.steals, stats.throttled,
+		stats.failed, audio.peakPlaying, pool.VoiceCount(), avgLatency, audio.maxLatencyMs, playUs) ;
+
+	bool passed = true ;
+	if (stats.failed != 0)
+	{
+		printf("FAILED: %d triggers found no voice\n", stats.failed) ;
+		passed = false ;
+	}
+	if (stats.peakVoices > pool.VoiceCount() || audio.peakPlaying > pool.VoiceCount())
+	{
+		printf("FAILED: more voices playing than the pool owns\n") ;
+		passed = false ;
+	}
+	if (audio.maxLatencyMs > blockMs + 1e-6)
+	{
+		printf("FAILED: a voice started %.2f ms after its trigger, block is %.2f ms\n", audio.maxLatencyMs, blockMs) ;
+		passed = false ;
+	}
+	return passed ;
+}
+
+/*
+LetterHunter with the shoot key held down: keyboard auto-repeat fires every repeatMs,
+every shot plays the bullet sound and hits a letter half of the time, every 40th hit
+clears the screen. The clips have the length and format of the game's wave files.
+*/
+static bool HeldKeyTest(double repeatMs, double seconds)
+{
+	const int rate = 44100 ;
+	TestClip hitLetter, hitAll, sendBullet ;
+	hitLetter.Create(rate, 1, 1894) ;
+	hitAll.Create(rate, 1, 32943) ;
+	sendBullet.Create(rate, 1, 3497) ;
+
+	// What a single source voice with resubmitted buffers would queue, buffers drain one clip length at a time
+	int queued = 0 ;
+	int maxQueued = 0 ;
+	double overflowMs = -1 ;
+	double headEnd = 0 ;
+	for (double t = 0; t < seconds * 1000; t += repeatMs)
+	{
+		while (queued > 0 && headEnd <= t)
+		{
+			--queued ;
+			headEnd += sendBullet.clip.DurationMs() ;
+		}
+		if (queued == 0)
+		{
+			headEnd = t + sendBullet.clip.DurationMs() ;
+		}
+		++queued ;
+		maxQueued = queued > maxQueued ? queued : maxQueued ;
+		if (queued > MAX_QUEUED_BUFFERS && overflowMs < 0)
+		{
+			overflowMs = t ;
+		}
+	}
+
+	printf("Held key, auto-repeat every %.0f ms for %.0f s\n", repeatMs, seconds) ;
+	if (overflowMs >= 0)
+	{
+		printf("one voice per sound: %d buffers queued, submit fails after %.0f ms\n", maxQueued, overflowMs) ;
+	}
+	else
+	{
+		printf("one voice per sound: %d buffers queued\n", maxQueued) ;
+	}
+
+	printf("%-14s %7s %7s %9s %6s %10s %9s %9s %9s\n", "policy", "plays", "steals", "throttled", "failed",
+		"peak/voices", "avg lat", "max lat", "play us") ;
+
+	bool passed = true ;
+	const STEAL_POLICY policies[] = { STEAL_OLDEST, STEAL_QUIETEST } ;
+	const char* names[] = { "oldest", "quietest" } ;
+
+	for (int p = 0; p < 2; ++p)
+	{
+		NullAudioBackend backend(48000, 480) ;
+		VoicePool pool(&backend) ;
+		pool.SetStealPolicy(policies[p]) ;
+
+		// Same settings as SoundManager
+		pool.AddFormat(hitLetter.clip.format, 8) ;
+		int hitLetterId = pool.AddSound(hitLetter.clip, 1.0f, 20.0, 4) ;
+		int hitAllId = pool.AddSound(hitAll.clip, 1.0f, 250.0, 1) ;
+		int sendBulletId = pool.AddSound(sendBullet.clip, 1.0f, 25.0, 4) ;
+
+		g_Seed = 12345 ;
+		int hits = 0 ;
+		int triggers = 0 ;
+		double playMs = 0 ;
+		Timer timer ;
+
+		for (double t = 0; t < seconds * 1000; t += repeatMs)
+		{
+			backend.Advance(t - backend.TimeMs()) ;
+
+			timer.Restart() ;
+			pool.Play(sendBulletId) ;
+			++triggers ;
+			if (NextRandom() % 2 == 0)
+			{
+				pool.Play(hitLetterId, 0.8f) ;
+				++triggers ;
+				if (++hits % 40 == 0)
+				{
+					pool.Play(hitAllId) ;
+					++triggers ;
+				}
+			}
+			playMs += timer.ElapsedMs() ;
+		}
+		backend.Advance(1000) ;
+
+		passed = CheckRun(names[p], pool, backend, 10.0, playMs * 1000 / triggers) && passed ;
+	}
+
+	printf("\n") ;
+	return passed ;
+}
+
+/*
+Many sounds in two formats triggered at random, far more than the pool can play, so
+most triggers have to steal a voice.
+*/
+static bool StressTest(int soundCount, int voicesPerFormat, double triggersPerMs, double seconds)
+{
+	printf("Stress, %d sounds in 2 formats, %d voices per format, %.1f triggers per ms for %.0f s\n",
+		soundCount, voicesPerFormat, triggersPerMs, seconds) ;
+	printf("%-14s %7s %7s %9s %6s %10s %9s %9s %9s\n", "policy", "plays", "steals", "throttled", "failed",
+		"peak/voices", "avg lat", "max lat", "play us") ;
+
+	std::vector<TestClip> clips(soundCount) ;
+	g_Seed = 54321 ;
+	for (int i = 0; i < soundCount; ++i)
+	{
+		// 50 ms to 1 s
+		int frames = 2205 + NextRandom() % 41895 ;
+		if (i % 2 == 0)
+		{
+			clips[i].Create(44100, 1, frames) ;
+		}
+		else
+		{
+			clips[i].Create(48000, 2, frames) ;
+		}
+	}
+
+	bool passed = true ;
+	const STEAL_POLICY policies[] = { STEAL_OLDEST, STEAL_QUIETEST } ;
+	const char* names[] = { "oldest", "quietest" } ;
+
+	for (int p = 0; p < 2; ++p)
+	{
+		NullAudioBackend backend(48000, 256) ;
+		VoicePool pool(&backend) ;
+		pool.SetStealPolicy(policies[p]) ;
+		pool.AddFormat(clips[0].clip.format, voicesPerFormat) ;
+		pool.AddFormat(clips[1].clip.format, voicesPerFormat) ;
+
+		std::vector<int> ids(soundCount) ;
+		for (int i = 0; i < soundCount; ++i)
+		{
+			ids[i] = pool.AddSound(clips[i].clip, 1.0f, 10.0, 3) ;
+		}
+
+		g_Seed = 777 ;
+		int triggers = 0 ;
+		double playMs = 0 ;
+		Timer timer ;
+
+		double step = 1.0 / triggersPerMs ;
+		for (double t = 0; t < seconds * 1000; t += step)
+		{
+			backend.Advance(t - backend.TimeMs()) ;
+
+			int sound = NextRandom() % soundCount ;
+			float volume = 0.1f + (NextRandom() % 90) / 100.0f ;
+
+			timer.Restart() ;
+			pool.Play(ids[sound], volume) ;
+			playMs += timer.ElapsedMs() ;
+			++triggers ;
+		}
+		backend.Advance(2000) ;
+
+		double blockMs = 256 * 1000.0 / 48000 ;
+		passed = CheckRun(names[p], pool, backend, blockMs, playMs * 1000 / triggers) && passed ;
+	}
+
+	printf("\n") ;
+	return passed ;
+}
+
+// Reference for one voice's contribution to an output frame, linear interpolation as in the mixer
+static double ReferenceSample(const TestClip& clip, double step, int frame, int channel)
+{
+	size_t frames = clip.clip.Frames() ;
+	double position = 0 ;
+	for (int i = 0; i < frame; ++i)
+	{
+		position += step ;
+	}
+
+	size_t index = (size_t)position ;
+	if (index >= frames)
+	{
+		return 0 ;
+	}
+
+	int source = clip.clip.format.channels == 1 ? 0 : channel ;
+	size_t next = index + 1 < frames ? index + 1 : index ;
+	double s0 = clip.Sample(index, source) ;
+	double s1 = clip.Sample(next, source) ;
+	return s0 + (s1 - s0) * (float)(position - index) ;
+}
+
+/*
+Mix a few voices with different gain, pan, pitch and rate and compare every output
+sample with a mix computed in double precision. The SIMD and scalar paths must agree with
+it within one step of 16 bit rounding.
+*/
+static bool MixerReferenceTest()
+{
+	const int rate = 48000 ;
+	TestClip mono, stereo, resampled ;
+	mono.CreateTone(rate, 1, 4801, 440.0, 0.5) ;
+	stereo.CreateTone(rate, 2, 3333, 300.0, 0.4) ;
+	resampled.CreateTone(44100, 1, 2000, 1000.0, 0.3) ;
+
+	SoftwareMixer mixer(rate, 256) ;
+	AudioVoice* a = mixer.CreateVoice(mono.clip.format) ;
+	AudioVoice* b = mixer.CreateVoice(stereo.clip.format) ;
+	AudioVoice* c = mixer.CreateVoice(resampled.clip.format) ;
+
+	a->SetPan(-0.5f) ;
+	a->Start(mono.clip, 0.8f) ;
+	b->SetPan(0.25f) ;
+	b->Start(stereo.clip, 1.0f) ;
+	c->SetPitch(1.5f) ;
+	c->Start(resampled.clip, 0.9f) ;
+
+	const int frames = 6000 ;
+	std::vector<short> out(frames * 2) ;
+	mixer.Render(&out[0], frames) ;
+
+	int maxError = 0 ;
+	for (int i = 0; i < frames; ++i)
+	{
+		for (int ch = 0; ch < 2; ++ch)
+		{
+			float al, ar, bl, br, cl, cr ;
+			PanGains(-0.5f, al, ar) ;
+			PanGains(0.25f, bl, br) ;
+			PanGains(0.0f, cl, cr) ;
+
+			double expected = ReferenceSample(mono, 1.0, i, ch) * 0.8 * (ch ? ar : al) +
+							  ReferenceSample(stereo, 1.0, i, ch) * (ch ? br : bl) +
+							  ReferenceSample(resampled, 44100.0 / rate * 1.5, i, ch) * 0.9 * (ch ? cr : cl) ;
+			double value = floor(expected * 32767 + 0.5) ;
+			value = value < -32768 ? -32768 : (value > 32767 ? 32767 : value) ;
+
+			int error = abs(out[i * 2 + ch] - (int)value) ;
+			maxError = error > maxError ? error : maxError ;
+		}
+	}
+
+	bool passed = maxError <= 1 && !a->IsPlaying() && !b->IsPlaying() && !c->IsPlaying() ;
+	printf("Mixer reference test, 3 voices, %d frames: max error %d, %s\n\n", frames, maxError, passed ? "passed" : "FAILED") ;
+	return passed ;
+}
+
+/*
+Mix voices looping tone clips for the given length of audio. voices/ms is the number of
+milliseconds of voice audio mixed per millisecond of CPU time, the number of voices the
+mixer could play in real time on one core. resampled voices play clips of another rate
+with a pitch change, the others take the straight conversion path.
+*/
+static void BenchmarkMixer(int voiceCount, bool resampled, bool stereo, double seconds)
+{
+	const int rate = 48000 ;
+	TestClip clip ;
+	clip.CreateTone(resampled ? 44100 : rate, stereo ? 2 : 1, rate, 220.0, 0.25) ;
+
+	SoftwareMixer mixer(rate, 256) ;
+	std::vector<AudioVoice*> voices(voiceCount) ;
+	for (int i = 0; i < voiceCount; ++i)
+	{
+		voices[i] = mixer.CreateVoice(clip.clip.format) ;
+		voices[i]->SetPan((i % 9) / 4.0f - 1.0f) ;
+		voices[i]->SetPitch(resampled ? 0.9f + (i % 5) * 0.05f : 1.0f) ;
+		voices[i]->Start(clip.clip, 1.0f / voiceCount) ;
+	}
+
+	const int blockFrames = 256 ;
+	std::vector<short> out(blockFrames * 2) ;
+	int blocks = (int)(seconds * rate / blockFrames) ;
+
+	Timer timer ;
+	for (int b = 0; b < blocks; ++b)
+	{
+		// Restart the voices that reached the end, a device callback would see the same
+		for (int i = 0; i < voiceCount; ++i)
+		{
+			if (!voices[i]->IsPlaying())
+			{
+				voices[i]->Start(clip.clip, 1.0f / voiceCount) ;
+			}
+		}
+		mixer.Render(&out[0], blockFrames) ;
+	}
+	double ms = timer.ElapsedMs() ;
+
+	MixerStats stats = mixer.Stats() ;
+	double audioMs = stats.framesRendered * 1000.0 / rate ;
+	double voiceMs = stats.voiceFrames * 1000.0 / rate ;
+
+	printf("%6d %-10s %-7s %10.1f %10.2f %12.0f %14.2f\n", voiceCount, resampled ? "resampled" : "native",
+		stereo ? "stereo" : "mono", audioMs, ms, voiceMs / ms, ms * 1e6 / stats.voiceFrames) ;
+}
+
+// Default script for the offline render, a bullet burst over a sustained tone
+static const char* g_DefaultScript =
+	"# time_ms sound volume pan pitch\n"
+	"0     3 0.6  0    1\n"
+	"100   0 1.0 -0.8  1\n"
+	"160   0 1.0 -0.4  1.1\n"
+	"220   0 1.0  0    1.2\n"
+	"280   0 1.0  0.4  1.3\n"
+	"340   0 1.0  0.8  1.4\n"
+	"500   1 0.9  0    1\n"
+	"520   2 0.7 -1    0.5\n"
+	"900   1 0.9  0.5  0.75\n"
+	"1200  2 0.7  1    2\n" ;
+
+/*
+Render an event script with four generated sounds to a WAV file, as the game would play
+it, and check the output has the expected length and is not silent.
+*/
+static bool OfflineRenderTest(const std::string& script, const char* path)
+{
+	std::vector<AudioEvent> events ;
+	int errorLine = 0 ;
+	if (!ParseAudioScript(script.c_str(), events, &errorLine))
+	{
+		printf("FAILED: script error in line %d\n", errorLine) ;
+		return false ;
+	}
+
+	const int rate = 48000 ;
+	TestClip clips[4] ;
+	clips[0].CreateTone(44100, 1, 3497, 880.0, 0.2) ;		// send_bullet length
+	clips[1].CreateTone(44100, 1, 1894, 660.0, 0.25) ;		// hit_letter length
+	clips[2].CreateTone(rate, 2, 24000, 330.0, 0.2) ;
+	clips[3].CreateTone(rate, 1, 96000, 110.0, 0.2) ;
+
+	SoftwareMixer mixer(rate, 256) ;
+	VoicePool pool(&mixer) ;
+	pool.AddFormat(clips[0].clip.format, 8) ;
+	pool.AddFormat(clips[2].clip.format, 4) ;
+	pool.AddFormat(clips[3].clip.format, 4) ;
+	for (int i = 0; i < 4; ++i)
+	{
+		pool.AddSound(clips[i].clip, 1.0f, 0.0, 4) ;
+	}
+
+	std::vector<short> samples ;
+	Timer timer ;
+	RenderAudioEvents(mixer, pool, events, samples) ;
+	double ms = timer.ElapsedMs() ;
+
+	int frames = (int)samples.size() / 2 ;
+	int peak = 0 ;
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		peak = abs(samples[i]) > peak ? abs(samples[i]) : peak ;
+	}
+
+	bool written = WriteWAV(path, samples.empty() ? NULL : &samples[0], frames, 2, rate) ;
+
+	double lastEvent = 0 ;
+	for (size_t i = 0; i < events.size(); ++i)
+	{
+		lastEvent = events[i].timeMs > lastEvent ? events[i].timeMs : lastEvent ;
+	}
+
+	printf("Offline render, %d events: %.0f ms of audio in %.2f ms, peak %d, %s\n", (int)events.size(),
+		frames * 1000.0 / rate, ms, peak, path) ;
+
+	bool passed = written && pool.Stats().failed == 0 && frames >= lastEvent * rate / 1000 && mixer.PlayingVoices() == 0 ;
+	if (!events.empty() && peak == 0)
+	{
+		passed = false ;
+	}
+	if (!passed)
+	{
+		printf("FAILED: offline render\n") ;
+	}
+	printf("\n") ;
+	return passed ;
+}
+
+// Wave file loading as PlaySoundFile and LetterHunter did it: every chunk lookup seeks back
+// to the start and reads the headers 4 bytes at a time, the data chunk is copied to the heap
+static bool LegacyFindChunk(FILE* file, unsigned int fourcc, unsigned int& chunkSize, unsigned int& chunkPosition)
+{
+	if (fseek(file, 0, SEEK_SET) != 0)
+	{
+		return false ;
+	}
+
+	unsigned int offset = 0 ;
+	for (;;)
+	{
+		unsigned int type, size, fileType ;
+		if (fread(&type, 4, 1, file) != 1 || fread(&size, 4, 1, file) != 1)
+		{
+			return false ;
+		}
+
+		if (type == RIFF_FOURCC('R', 'I', 'F', 'F'))
+		{
+			size = 4 ;
+			if (fread(&fileType, 4, 1, file) != 1)
+			{
+				return false ;
+			}
+		}
+		else if (fseek(file, size, SEEK_CUR) != 0)
+		{
+			return false ;
+		}
+
+		offset += 8 ;
+		if (type == fourcc)
+		{
+			chunkSize = size ;
+			chunkPosition = offset ;
+			return true ;
+		}
+		offset += size ;
+	}
+}
+
+static unsigned char* LegacyLoadWave(const char* path, unsigned int& dataSize)
+{
+	FILE* file = fopen(path, "rb") ;
+	if (!file)
+	{
+		return NULL ;
+	}
+
+	// Unbuffered, every fread is one ReadFile call as in the old code
+	setvbuf(file, NULL, _IONBF, 0) ;
+
+	unsigned int size, position, fileType ;
+	unsigned char format[40] = { 0 } ;
+	unsigned char* data = NULL ;
+
+	if (LegacyFindChunk(file, RIFF_FOURCC('R', 'I', 'F', 'F'), size, position) &&
+		fseek(file, position, SEEK_SET) == 0 && fread(&fileType, 4, 1, file) == 1 &&
+		LegacyFindChunk(file, RIFF_FOURCC('f', 'm', 't', ' '), size, position) &&
+		fseek(file, position, SEEK_SET) == 0 && fread(format, size < 40 ? size : 40, 1, file) == 1 &&
+		LegacyFindChunk(file, RIFF_FOURCC('d', 'a', 't', 'a'), size, position) &&
+		fseek(file, position, SEEK_SET) == 0)
+	{
+		data = new unsigned char[size] ;
+		dataSize = (unsigned int)fread(data, 1, size, file) ;
+	}
+
+	fclose(file) ;
+	return data ;
+}
+
+// RIFF chunk header for the corpus files
+static void PutChunk(std::vector<unsigned char>& file, const char* id, const unsigned char* data, unsigned int size)
+{
+	file.insert(file.end(), id, id + 4) ;
+	for (int i = 0; i < 4; ++i)
+	{
+		file.push_back((unsigned char)(size >> (i * 8))) ;
+	}
+	file.insert(file.end(), data, data + size) ;
+	if (size & 1)
+	{
+		file.push_back(0) ;
+	}
+}
+
+// Wave file with a LIST chunk in front of the samples, as most editors write them
+static void MakeTaggedWave(const TestClip& clip, std::vector<unsigned char>& file)
+{
+	std::vector<unsigned char> plain ;
+	EncodeWAV((const short*)clip.clip.data, (int)clip.clip.Frames(), clip.clip.format.channels,
+		clip.clip.format.sampleRate, plain) ;
+
+	// RIFF header and fmt chunk are the first 36 bytes, data the rest
+	file.assign(plain.begin(), plain.begin() + 36) ;
+	const char info[] = "INFOISFT\x0e\0\0\0AudioBenchmark" ;
+	PutChunk(file, "LIST", (const unsigned char*)info, sizeof(info) - 1) ;
+	file.insert(file.end(), plain.begin() + 36, plain.end()) ;
+
+	unsigned int riffSize = (unsigned int)file.size() - 8 ;
+	for (int i = 0; i < 4; ++i)
+	{
+		file[4 + i] = (unsigned char)(riffSize >> (i * 8)) ;
+	}
+}
+
+static bool WriteBytes(const char* path, const std::vector<unsigned char>& bytes)
+{
+	FILE* file = fopen(path, "wb") ;
+	if (!file)
+	{
+		return false ;
+	}
+	bool ok = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size() ;
+	return fclose(file) == 0 && ok ;
+}
+
+// Every chunk the reader hands out must lie inside the parsed buffer
+static bool ChunksInside(const RiffReader& riff, const unsigned char* data, size_t size)
+{
+	for (int i = 0; i < riff.ChunkCount(); ++i)
+	{
+		const RiffChunk& chunk = riff.Chunk(i) ;
+		if (chunk.data < data || chunk.data + chunk.size > data + size)
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+/*
+Parse every prefix of a wave file and many copies with random bytes changed. The parser
+may reject them, but must never point outside the buffer.
+*/
+static bool WaveRobustnessTest()
+{
+	TestClip clip ;
+	clip.CreateTone(22050, 1, 300, 440.0, 0.5) ;
+	std::vector<unsigned char> file ;
+	MakeTaggedWave(clip, file) ;
+
+	int accepted = 0 ;
+	int rejected = 0 ;
+	bool passed = true ;
+
+	for (size_t length = 0; length <= file.size(); ++length)
+	{
+		std::vector<unsigned char> prefix(file.begin(), file.begin() + length) ;
+		const unsigned char* data = prefix.empty() ? NULL : &prefix[0] ;
+
+		RiffReader riff ;
+		WaveData wave ;
+		AudioClip parsed ;
+		if (riff.Parse(data, length) && ParseWave(riff, wave) && WaveToClip(wave, parsed))
+		{
+			++accepted ;
+			passed = passed && parsed.data + parsed.bytes <= data + length ;
+		}
+		else
+		{
+			++rejected ;
+		}
+		passed = passed && ChunksInside(riff, data, length) ;
+	}
+
+	g_Seed = 4242 ;
+	for (int i = 0; i < 20000; ++i)
+	{
+		// Damage the headers, where the sizes are
+		std::vector<unsigned char> damaged(file) ;
+		int count = 1 + NextRandom() % 4 ;
+		for (int j = 0; j < count; ++j)
+		{
+			damaged[NextRandom() % 80] = (unsigned char)NextRandom() ;
+		}
+
+		RiffReader riff ;
+		WaveData wave ;
+		AudioClip parsed ;
+		if (riff.Parse(&damaged[0], damaged.size()) && ParseWave(riff, wave) && WaveToClip(wave, parsed))
+		{
+			++accepted ;
+			passed = passed && parsed.data + parsed.bytes <= &damaged[0] + damaged.size() ;
+		}
+		else
+		{
+			++rejected ;
+		}
+		passed = passed && ChunksInside(riff, &damaged[0], damaged.size()) ;
+	}
+
+	printf("Wave parser robustness, truncated and damaged files: %d accepted, %d rejected, %s\n\n",
+		accepted, rejected, passed ? "passed" : "FAILED") ;
+	return passed ;
+}
+
+/*
+Load a corpus of sound effect files with the old chunk by chunk reader and through
+WaveFile. Most files are short effects, some have a LIST chunk before the samples and
+a few are long music clips. "touched" also reads one byte per 4 KB page of the samples,
+the cost the mapping defers to the first playback.
+*/
+static bool BenchmarkWaveParse(int fileCount)
+{
+	std::vector<std::string> paths ;
+	long long totalBytes = 0 ;
+	g_Seed = 999 ;
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		int frames = i % 50 == 0 ? 44100 * 10 : 2000 + NextRandom() % 20000 ;
+		TestClip clip ;
+		clip.Create(44100, 1 + i % 2, frames) ;
+
+		std::vector<unsigned char> file ;
+		if (i % 3 == 0)
+		{
+			MakeTaggedWave(clip, file) ;
+		}
+		else
+		{
+			EncodeWAV((const short*)clip.clip.data, frames, clip.clip.format.channels, 44100, file) ;
+		}
+
+		char path[64] ;
+		sprintf(path, "corpus_%04d.wav", i) ;
+		if (!WriteBytes(path, file))
+		{
+			printf("FAILED: cannot write %s\n", path) ;
+			return false ;
+		}
+		paths.push_back(path) ;
+		totalBytes += file.size() ;
+	}
+
+	printf("Wave loading, %d files, %.1f MB\n", fileCount, totalBytes / 1048576.0) ;
+	printf("%-22s %10s %12s\n", "loader", "total ms", "us per file") ;
+
+	bool passed = true ;
+	unsigned int checksum = 0 ;
+
+	Timer timer ;
+	for (int i = 0; i < fileCount; ++i)
+	{
+		unsigned int size = 0 ;
+		unsigned char* data = LegacyLoadWave(paths[i].c_str(), size) ;
+		passed = passed && data != NULL ;
+		checksum += size ;
+		delete[] data ;
+	}
+	double legacyMs = timer.ElapsedMs() ;
+	printf("%-22s %10.2f %12.2f\n", "seek and read, copy", legacyMs, legacyMs * 1000 / fileCount) ;
+
+	for (int touch = 0; touch < 2; ++touch)
+	{
+		unsigned int mappedChecksum = 0 ;
+		timer.Restart() ;
+		for (int i = 0; i < fileCount; ++i)
+		{
+			WaveFile wave ;
+			AudioClip clip ;
+			if (!wave.Open(paths[i].c_str()) || !wave.GetClip(clip))
+			{
+				passed = false ;
+				continue ;
+			}
+			mappedChecksum += (unsigned int)clip.bytes ;
+
+			if (touch)
+			{
+				unsigned char sum = 0 ;
+				for (size_t b = 0; b < clip.bytes; b += 4096)
+				{
+					sum ^= clip.data[b] ;
+				}
+				mappedChecksum += sum ;
+			}
+		}
+		double ms = timer.ElapsedMs() ;
+		printf("%-22s %10.2f %12.2f\n", touch ? "mapped, touched" : "mapped", ms, ms * 1000 / fileCount) ;
+
+		// The samples are silent, touching them adds nothing to the checksum
+		passed = passed && mappedChecksum == checksum ;
+	}
+
+	for (int i = 0; i < fileCount; ++i)
+	{
+		remove(paths[i].c_str()) ;
+	}
+
+	if (!passed)
+	{
+		printf("FAILED: the loaders do not agree\n") ;
+	}
+	printf("\n") ;
+	return passed ;
+}
+
+// FNV-1a, to check the streamed bytes arrive complete and in order
+static unsigned long long HashBytes(const unsigned char* data, size_t size, unsigned long long hash)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ data[i]) * 1099511628211ULL ;
+	}
+	return hash ;
+}
+
+/*
+Play a stream the way XAudio2StreamVoice does, speed times faster than real time: the
+buffers the I/O thread has read are queued on a simulated voice, which plays them by the
+wall clock and gives each back when it is done. A voice that runs dry before the end of
+the stream counts one under-run per gap.
+*/
+static bool StreamTest(const char* path, unsigned long long expectedHash, size_t expectedBytes,
+					   int bufferCount, int bufferBytes, double speed)
+{
+	AudioStream stream ;
+	if (!stream.Open(path, bufferCount, bufferBytes))
+	{
+		printf("FAILED: cannot stream %s\n", path) ;
+		return false ;
+	}
+
+	const WaveData& wave = stream.Wave() ;
+	double bytesPerMs = wave.sampleRate * wave.blockAlign / 1000.0 ;
+
+	std::deque<size_t> queued ;
+	double headPlayedMs = 0 ;
+	unsigned long long hash = 14695981039346656037ULL ;
+	size_t total = 0 ;
+	bool endSubmitted = false ;
+	bool dry = false ;
+
+	stream.WaitReady(2, 1000) ;
+
+	Timer clock ;
+	double lastMs = 0 ;
+	for (;;)
+	{
+		while (!endSubmitted)
+		{
+			size_t bytes = 0 ;
+			bool last = false ;
+			const unsigned char* data = stream.Acquire(bytes, last) ;
+			if (!data)
+			{
+				break ;
+			}
+			hash = HashBytes(data, bytes, hash) ;
+			total += bytes ;
+			queued.push_back(bytes) ;
+			endSubmitted = last ;
+		}
+
+		if (queued.empty())
+		{
+			if (endSubmitted)
+			{
+				break ;
+			}
+			if (!dry)
+			{
+				stream.Underrun() ;
+				dry = true ;
+			}
+		}
+		else
+		{
+			dry = false ;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1)) ;
+		double now = clock.ElapsedMs() ;
+		double advance = (now - lastMs) * speed ;
+		lastMs = now ;
+
+		while (advance > 0 && !queued.empty())
+		{
+			double left = queued.front() / bytesPerMs - headPlayedMs ;
+			if (advance < left)
+			{
+				headPlayedMs += advance ;
+				break ;
+			}
+
+			advance -= left ;
+			headPlayedMs = 0 ;
+			queued.pop_front() ;
+			stream.Release() ;
+		}
+	}
+	double ms = clock.ElapsedMs() ;
+
+	AudioStreamStats stats = stream.Stats() ;
+	bool passed = hash == expectedHash && total == expectedBytes ;
+
+	printf("%2d x %3d KB %5.0fx %9d KB %8.0f %8d %6d %10d %12.2f %6s\n", bufferCount, bufferBytes / 1024, speed,
+		(int)(stream.MemoryBytes() / 1024), ms, stats.buffersRead, stats.late, stats.underruns, stats.maxReadMs,
+		passed ? "ok" : "FAILED") ;
+	return passed ;
+}
+
+/*
+Stream a long generated track through buffer rings of different size. The large ring
+plays the track with a few hundred KB; the tiny ring cannot keep a voice fed at this
+speed and shows up in the under-run counters.
+*/
+static bool BenchmarkStreaming(double trackSeconds)
+{
+	const int rate = 44100 ;
+	int frames = (int)(trackSeconds * rate) ;
+
+	TestClip track ;
+	track.Create(rate, 2, frames) ;
+	short* samples = (short*)&track.data[0] ;
+	for (int i = 0; i < frames * 2; ++i)
+	{
+		samples[i] = (short)(i * 7 + (i >> 11)) ;
+	}
+
+	std::vector<unsigned char> file ;
+	MakeTaggedWave(track, file) ;
+	const char* path = "stream_track.wav" ;
+	if (!WriteBytes(path, file))
+	{
+		printf("FAILED: cannot write %s\n", path) ;
+		return false ;
+	}
+
+	unsigned long long expected = HashBytes(&track.data[0], track.data.size(), 14695981039346656037ULL) ;
+
+	printf("Streaming a %.0f s stereo track, %.1f MB of samples\n", trackSeconds, track.data.size() / 1048576.0) ;
+	printf("%-11s %6s %12s %8s %8s %6s %10s %12s %6s\n", "buffers", "speed", "memory", "wall ms", "reads",
+		"late", "under-runs", "max read ms", "data") ;
+
+	bool passed = StreamTest(path, expected, track.data.size(), 4, 64 * 1024, 60.0) ;
+	passed = StreamTest(path, expected, track.data.size(), 8, 32 * 1024, 60.0) && passed ;
+	passed = StreamTest(path, expected, track.data.size(), 2, 4 * 1024, 60.0) && passed ;
+
+	remove(path) ;
+	printf("\n") ;
+	return passed ;
+}
+
+static bool ReadTextFile(const char* path, std::string& text)
+{
+	FILE* file = fopen(path, "rb") ;
+	if (!file)
+	{
+		return false ;
+	}
+
+	char buffer[4096] ;
+	size_t read ;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, read) ;
+	}
+	fclose(file) ;
+	return true ;
+}
+
+int main(int argc, char* argv[])
+{
+	bool passed = HeldKeyTest(33.0, 5.0) ;
+	passed = HeldKeyTest(16.0, 5.0) && passed ;
+
+	passed = StressTest(32, 8, 0.5, 10.0) && passed ;
+	passed = StressTest(32, 32, 2.0, 10.0) && passed ;
+
+	passed = MixerReferenceTest() && passed ;
+
+	passed = WaveRobustnessTest() && passed ;
+	passed = BenchmarkWaveParse(500) && passed ;
+	passed = BenchmarkStreaming(180.0) && passed ;
+
+	printf("Software mixer, 48 kHz stereo output in 256 frame blocks\n") ;
+	printf("%6s %-10s %-7s %10s %10s %12s %14s\n", "voices", "rate", "source", "audio ms", "mix ms", "voices/ms", "ns/voice frame") ;
+	BenchmarkMixer(16, false, false, 10.0) ;
+	BenchmarkMixer(64, false, false, 10.0) ;
+	BenchmarkMixer(256, false, false, 5.0) ;
+	BenchmarkMixer(64, false, true, 10.0) ;
+	BenchmarkMixer(64, true, false, 10.0) ;
+	BenchmarkMixer(64, true, true, 10.0) ;
+	printf("\n") ;
+
+	std::string script = g_DefaultScript ;
+	if (argc > 1)
+	{
+		script.clear() ;
+		if (!ReadTextFile(argv[1], script))
+		{
+			printf("FAILED: cannot read %s\n", argv[1]) ;
+			return 1 ;
+		}
+	}
+	passed = OfflineRenderTest(script, "offline_mix.wav") && passed ;
+
+	return passed ? 0 : 1 ;
+}
@@ -0,0 +1,276 @@
+/*
+Benchmark and self check for MeshBvh in Common/Math.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 BvhBenchmark.cpp ../../Math/MeshBvh.cpp -o BvhBenchmark
+
+Builds trees over bumpy spheres from 1k to 1M triangles, the shape of a loaded model
+more than a grid is, and casts rays at them from all around, most hitting, some
+passing by. Checks that the tree finds the hit a TriangleBatch holding every triangle
+finds, that the cache file gives back the same tree and that a cache for another mesh,
+a truncated one and a missing one are refused. Then reports the build time, the cache
+load time and the time per ray for the tree and for testing every triangle. Exits with
+a non-zero code if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../../Math/MeshBvh.h"
+#include "../../Utility/Timer.h"
+
+static const int RAY_COUNT = 2000 ;
+static const int CHECK_RAYS = 300 ;
+static const char* CACHE_PATH = "BvhBenchmark.bvh" ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / (float)RAND_MAX ;
+}
+
+static Vec3 RandomVec3(float range)
+{
+	return Vec3(Random(-range, range), Random(-range, range), Random(-range, range)) ;
+}
+
+static bool Near(float a, float b, float tolerance)
+{
+	return fabsf(a - b) <= tolerance * (1.0f + fabsf(a) + fabsf(b)) ;
+}
+
+struct Mesh
+{
+	std::vector<Vec3> vertices ;
+	std::vector<unsigned int> indices ;
+
+	size_t TriangleCount() const { return indices.size() / 3 ; }
+} ;
+
+// About 2 * slices * stacks triangles, the radius waves between 0.8 and 1.2
+static Mesh MakeMesh(int slices, int stacks)
+{
+	Mesh mesh ;
+	for (int stack = 0; stack <= stacks; ++stack)
+	{
+		float phi = MATH_PI * stack / stacks ;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			float theta = 2.0f * MATH_PI * slice / slices ;
+			float radius = 1.0f + 0.2f * sinf(7.0f * theta) * sinf(5.0f * phi) ;
+			mesh.vertices.push_back(Vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta)) * radius) ;
+		}
+	}
+
+	for (int stack = 0; stack < stacks; ++stack)
+	{
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			unsigned int a = stack * slices + slice ;
+			unsigned int b = stack * slices + (slice + 1) % slices ;
+			unsigned int quad[6] = { a, b, a + slices, b, b + slices, a + slices } ;
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6) ;
+		}
+	}
+	return mesh ;
+}
+
+static std::vector<Ray3> MakeRays()
+{
+	std::vector<Ray3> rays(RAY_COUNT) ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		Vec3 origin = Vec3Normalize(RandomVec3(1.0f)) * 5.0f ;
+		Vec3 target = RandomVec3(1.3f) ;
+		rays[i] = Ray3(origin, Vec3Normalize(target - origin)) ;
+	}
+	return rays ;
+}
+
+// A ray through a shared edge may report either triangle, at the same distance
+static bool SameHit(bool hitA, const RayHit& a, bool hitB, const RayHit& b)
+{
+	if (!hitA || !hitB)
+	{
+		return hitA == hitB ;
+	}
+	return Near(a.t, b.t, 1e-5f) && (a.id != b.id || (Near(a.u, b.u, 1e-4f) && Near(a.v, b.v, 1e-4f))) ;
+}
+
+static int Disagreements(const MeshBvh& bvh, const TriangleBatch& batch, const std::vector<Ray3>& rays, int count)
+{
+	int disagree = 0 ;
+	for (int i = 0; i < count; ++i)
+	{
+		RayHit a, b ;
+		bool hitA = bvh.Intersect(rays[i], a) ;
+		bool hitB = batch.Intersect(rays[i], b) ;
+		disagree += SameHit(hitA, a, hitB, b) ? 0 : 1 ;
+	}
+	return disagree ;
+}
+
+static void CheckSmall(const std::vector<Ray3>& rays)
+{
+	MeshBvh bvh ;
+	RayHit hit ;
+	Check(bvh.IsEmpty() && !bvh.Intersect(rays[0], hit), "an empty tree") ;
+
+	// One triangle, and many on top of each other, where no split separates the centers
+	std::vector<Vec3> vertices ;
+	vertices.push_back(Vec3(-1.0f, -1.0f, 0.0f)) ;
+	vertices.push_back(Vec3(0.0f, 1.0f, 0.0f)) ;
+	vertices.push_back(Vec3(1.0f, -1.0f, 0.0f)) ;
+	std::vector<unsigned short> indices(300) ;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		indices[i] = (unsigned short)(i % 3) ;
+	}
+
+	Ray3 ray(Vec3(0.0f, 0.0f, -5.0f), Vec3(0.0f, 0.0f, 1.0f)) ;
+	bvh.Build(&vertices[0], sizeof(Vec3), &indices[0], 1) ;
+	Check(bvh.Intersect(ray, hit) && hit.id == 0 && Near(hit.t, 5.0f, 1e-6f), "a single triangle") ;
+	Check(!bvh.Intersect(ray, hit, 4.0f), "maxT") ;
+
+	bvh.Build(&vertices[0], sizeof(Vec3), &indices[0], indices.size() / 3) ;
+	Check(bvh.Intersect(ray, hit) && hit.id < 100 && Near(hit.t, 5.0f, 1e-6f), "stacked triangles") ;
+	Check(bvh.Stats().depth < 64, "stacked triangles split by count") ;
+}
+
+static void CheckCache(const Mesh& mesh, const std::vector<Ray3>& rays)
+{
+	remove(CACHE_PATH) ;
+	size_t triangles = mesh.TriangleCount() ;
+
+	MeshBvh built ;
+	built.BuildCached(CACHE_PATH, &mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], triangles) ;
+	Check(!built.Stats().fromCache, "a missing cache is built") ;
+
+	MeshBvh loaded ;
+	loaded.BuildCached(CACHE_PATH, &mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], triangles) ;
+	Check(loaded.Stats().fromCache, "the cache is loaded") ;
+	Check(loaded.Stats().nodes == built.Stats().nodes && loaded.Stats().depth == built.Stats().depth, "the cache keeps the tree") ;
+
+	bool same = true ;
+	for (int i = 0; i < CHECK_RAYS; ++i)
+	{
+		RayHit a, b ;
+		bool hitA = built.Intersect(rays[i], a) ;
+		bool hitB = loaded.Intersect(rays[i], b) ;
+		same = same && hitA == hitB && (!hitA || (a.t == b.t && a.id == b.id)) ;
+	}
+	Check(same, "the loaded tree finds the same hits") ;
+
+	unsigned long long hash = MeshBvh::HashMesh(&mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], sizeof(unsigned int), triangles) ;
+	Check(loaded.Load(CACHE_PATH, hash), "Load with the hash") ;
+	Check(!loaded.Load(CACHE_PATH, hash + 1) && loaded.IsEmpty(), "a cache for another mesh is refused") ;
+
+	// Move one vertex, the cache is rebuilt
+	Mesh moved = mesh ;
+	moved.vertices[moved.indices[0]].x += 0.01f ;
+	MeshBvh rebuilt ;
+	rebuilt.BuildCached(CACHE_PATH, &moved.vertices[0], sizeof(Vec3), &moved.indices[0], triangles) ;
+	Check(!rebuilt.Stats().fromCache, "an edited mesh is rebuilt") ;
+
+	// Cut the file short
+	FILE* file = fopen(CACHE_PATH, "rb") ;
+	std::vector<char> data ;
+	if (file)
+	{
+		char buffer[65536] ;
+		size_t count ;
+		while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			data.insert(data.end(), buffer, buffer + count) ;
+		}
+		fclose(file) ;
+	}
+	file = fopen(CACHE_PATH, "wb") ;
+	if (file)
+	{
+		fwrite(&data[0], 1, data.size() / 2, file) ;
+		fclose(file) ;
+	}
+	hash = MeshBvh::HashMesh(&moved.vertices[0], sizeof(Vec3), &moved.indices[0], sizeof(unsigned int), triangles) ;
+	Check(!loaded.Load(CACHE_PATH, hash), "a truncated cache is refused") ;
+
+	remove(CACHE_PATH) ;
+	Check(!loaded.Load(CACHE_PATH, hash), "a missing cache is refused") ;
+}
+
+static void Measure(int slices, int stacks, const std::vector<Ray3>& rays)
+{
+	Mesh mesh = MakeMesh(slices, stacks) ;
+	size_t triangles = mesh.TriangleCount() ;
+
+	MeshBvh bvh ;
+	bvh.Build(&mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], triangles) ;
+	const MeshBvhStats& stats = bvh.Stats() ;
+
+	unsigned long long hash = MeshBvh::HashMesh(&mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], sizeof(unsigned int), triangles) ;
+	Check(bvh.Save(CACHE_PATH, hash), "Save") ;
+	MeshBvh loaded ;
+	Timer timer ;
+	Check(loaded.Load(CACHE_PATH, hash), "Load") ;
+	double loadMs = timer.ElapsedMs() ;
+	remove(CACHE_PATH) ;
+
+	int hits = 0 ;
+	timer.Restart() ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		RayHit hit ;
+		hits += bvh.Intersect(rays[i], hit) ? 1 : 0 ;
+	}
+	double bvhUs = timer.ElapsedMs() * 1000.0 / RAY_COUNT ;
+	Check(hits > RAY_COUNT / 2 && hits < RAY_COUNT, "a mix of hits and misses") ;
+
+	// Testing every triangle, on fewer rays for the big meshes
+	TriangleBatch batch ;
+	batch.AddIndexed(&mesh.vertices[0], sizeof(Vec3), &mesh.indices[0], triangles) ;
+	int checkRays = triangles > 200000 ? CHECK_RAYS / 10 : CHECK_RAYS ;
+	timer.Restart() ;
+	int disagree = Disagreements(bvh, batch, rays, checkRays) ;
+	double bothUs = timer.ElapsedMs() * 1000.0 / checkRays ;
+	Check(disagree == 0, "the tree finds the hits of testing every triangle") ;
+
+	printf("%9d %7d %6d %5d %10.1f %10.2f %10.2f %12.1f\n", (int)triangles, stats.nodes, stats.leaves, stats.depth,
+		   stats.buildMs, loadMs, bvhUs, bothUs - bvhUs) ;
+}
+
+int main()
+{
+	srand(11) ;
+	std::vector<Ray3> rays = MakeRays() ;
+
+	printf("backend: %d lanes\n", (int)TRIANGLE_PACKET_SIZE) ;
+
+	CheckSmall(rays) ;
+	CheckCache(MakeMesh(64, 32), rays) ;
+
+	printf("\n%9s %7s %6s %5s %10s %10s %10s %12s\n", "triangles", "nodes", "leaves", "depth", "build ms", "load ms", "us/ray", "all us/ray") ;
+	Measure(32, 16, rays) ;
+	Measure(100, 50, rays) ;
+	Measure(320, 160, rays) ;
+	Measure(1000, 500, rays) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,573 @@
+/*
+Headless benchmark for the screen capture pipeline in Common/Capture.
+
+Frames are synthetic BGRA sequences that mimic typical desktop activity, so the
+numbers can be reproduced on any machine, including Linux:
+	g++ -O2 -pthread -I../../Capture CaptureBenchmark.cpp ../../Capture/TileDiff.cpp \
+		../../Capture/TileCodec.cpp ../../Capture/ScreenCodec.cpp ../../Capture/ByteStream.cpp \
+		../../Capture/FrameScaler.cpp ../../Capture/ScreenshotWriter.cpp ../../Utility/ThreadPool.cpp \
+		../../Image/ImageWriter.cpp ../../Image/Deflate.cpp -o CaptureBenchmark
+
+Exits with a non-zero code if the loopback viewer does not rebuild the frames bit-exact
+or a screenshot of a burst is lost.
+*/
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include "TileDiff.h"
+#include "ScreenCodec.h"
+#include "FrameScaler.h"
+#include "ScreenshotWriter.h"
+#include "../../Utility/Timer.h"
+#include "../../Utility/ThreadPool.h"
+
+// Small deterministic random generator, rand() differs between CRTs
+static unsigned int g_Seed = 12345 ;
+static unsigned int NextRandom()
+{
+	g_Seed ^= g_Seed << 13 ;
+	g_Seed ^= g_Seed >> 17 ;
+	g_Seed ^= g_Seed << 5 ;
+	return g_Seed ;
+}
+
+static void FillRect(const FrameView& frame, int left, int top, int width, int height, unsigned int color)
+{
+	for (int y = top; y < top + height && y < frame.height; ++y)
+	{
+		unsigned int* row = (unsigned int*)frame.Row(y) ;
+		for (int x = left; x < left + width && x < frame.width; ++x)
+		{
+			row[x] = color ;
+		}
+	}
+}
+
+// Desktop like background, flat areas and some gradients
+static void FillDesktop(const FrameView& frame)
+{
+	for (int y = 0; y < frame.height; ++y)
+	{
+		unsigned int* row = (unsigned int*)frame.Row(y) ;
+		for (int x = 0; x < frame.width; ++x)
+		{
+			row[x] = 0xFF000000 | ((x / 8) & 0xFF) << 16 | ((y / 8) & 0xFF) << 8 | 0x40 ;
+		}
+	}
+}
+
+enum SCENE
+{
+	SCENE_STATIC,		// nothing changes
+	SCENE_CURSOR,		// a 32x32 cursor moves around
+	SCENE_TYPING,		// a few characters appear in a text window
+	SCENE_VIDEO,		// a 640x360 video plays in a window
+	SCENE_FULL,			// every pixel changes, e.g. full screen game
+	SCENE_COUNT
+};
+
+static const char* g_SceneNames[SCENE_COUNT] = { "static", "cursor", "typing", "video", "full" } ;
+
+// Modify frame to produce frame number 'index' of the scene
+static void Animate(SCENE scene, const FrameView& frame, int index)
+{
+	switch (scene)
+	{
+	case SCENE_STATIC:
+		break ;
+
+	case SCENE_CURSOR:
+		FillRect(frame, (index * 7) % (frame.width - 32), (index * 3) % (frame.height - 32), 32, 32, 0xFFFFFFFF) ;
+		break ;
+
+	case SCENE_TYPING:
+		FillRect(frame, 200 + (index % 80) * 9, 300 + (index / 80 % 20) * 16, 8, 14, 0xFF000000) ;
+		break ;
+
+	case SCENE_VIDEO:
+		for (int y = 200; y < 200 + 360; ++y)
+		{
+			unsigned int* row = (unsigned int*)frame.Row(y) ;
+			for (int x = 400; x < 400 + 640; ++x)
+			{
+				row[x] = 0xFF000000 | (NextRandom() & 0x00FFFFFF) ;
+			}
+		}
+		break ;
+
+	case SCENE_FULL:
+		for (int y = 0; y < frame.height; ++y)
+		{
+			unsigned int* row = (unsigned int*)frame.Row(y) ;
+			for (int x = 0; x < frame.width; ++x)
+			{
+				row[x] += 0x00010101 ;
+			}
+		}
+		break ;
+
+	default:
+		break ;
+	}
+}
+
+static void BenchmarkTileDiff(int width, int height, int frameCount)
+{
+	printf("TileDiff %dx%d, %d frames, %dx%d tiles\n", width, height, frameCount, TileDiff::TILE_SIZE, TileDiff::TILE_SIZE) ;
+	printf("%-8s %10s %10s %12s %10s\n", "scene", "ms/frame", "GB/s", "dirty tiles", "rects") ;
+
+	FrameBuffer frame ;
+	frame.Create(width, height) ;
+
+	std::vector<TileRect> dirtyTiles ;
+	std::vector<TileRect> rects ;
+
+	for (int scene = 0; scene < SCENE_COUNT; ++scene)
+	{
+		FillDesktop(frame.View()) ;
+
+		TileDiff diff ;
+		diff.Reset(width, height) ;
+		diff.Diff(frame.View(), dirtyTiles) ;	// first frame is all dirty, keep it out of the timing
+
+		double totalMs = 0 ;
+		unsigned long long totalBytes = 0 ;
+		unsigned long long totalDirty = 0 ;
+		unsigned long long totalRects = 0 ;
+
+		for (int i = 0; i < frameCount; ++i)
+		{
+			Animate((SCENE)scene, frame.View(), i) ;
+
+			Timer timer ;
+			diff.Diff(frame.View(), dirtyTiles) ;
+			TileDiff::MergeRows(dirtyTiles, rects) ;
+			totalMs += timer.ElapsedMs() ;
+
+			totalBytes += diff.LastBytesCompared() ;
+			totalDirty += dirtyTiles.size() ;
+			totalRects += rects.size() ;
+		}
+
+		printf("%-8s %10.3f %10.2f %8.1f/%-4d %10.1f\n",
+			g_SceneNames[scene],
+			totalMs / frameCount,
+			totalBytes / (totalMs / 1000.0) / 1e9,
+			(double)totalDirty / frameCount, diff.TileCount(),
+			(double)totalRects / frameCount) ;
+	}
+
+	printf("\n") ;
+}
+
+static void BenchmarkEncoder(int width, int height, int frameCount, int fps)
+{
+	printf("ScreenEncoder %dx%d, %d frames, bandwidth at %d fps\n", width, height, frameCount, fps) ;
+	printf("%-8s %10s %10s %12s %8s %10s   %s\n", "scene", "diff ms", "encode ms", "bytes/frame", "ratio", "Mbit/s", "solid/rle/delta/raw tiles") ;
+
+	FrameBuffer frame ;
+	frame.Create(width, height) ;
+
+	std::vector<unsigned char> packet ;
+
+	for (int scene = 0; scene < SCENE_COUNT; ++scene)
+	{
+		FillDesktop(frame.View()) ;
+
+		ScreenEncoder encoder ;
+		encoder.Reset(width, height) ;
+		encoder.Encode(frame.View(), CaptureTimeNow(), packet) ;	// key frame
+		size_t keyFrameBytes = packet.size() ;
+
+		double diffMs = 0 ;
+		double encodeMs = 0 ;
+		unsigned long long packetBytes = 0 ;
+		unsigned long long rawBytes = 0 ;
+		int tiles[4] = { 0 } ;
+
+		for (int i = 0; i < frameCount; ++i)
+		{
+			Animate((SCENE)scene, frame.View(), i) ;
+			encoder.Encode(frame.View(), CaptureTimeNow(), packet) ;
+
+			const EncodeStats& stats = encoder.LastStats() ;
+			diffMs += stats.diffMs ;
+			encodeMs += stats.encodeMs ;
+			packetBytes += stats.packetBytes ;
+			rawBytes += stats.rawBytes ;
+			for (int e = 0; e < 4; ++e)
+			{
+				tiles[e] += stats.tilesByEncoding[e] ;
+			}
+		}
+
+		printf("%-8s %10.3f %10.3f %12.0f %8.1f %10.2f   %d/%d/%d/%d (key frame %u bytes)\n",
+			g_SceneNames[scene],
+			diffMs / frameCount,
+			encodeMs / frameCount,
+			(double)packetBytes / frameCount,
+			packetBytes ? (double)rawBytes / packetBytes : 0.0,
+			(double)packetBytes / frameCount * fps * 8 / 1e6,
+			tiles[TILE_SOLID], tiles[TILE_RLE], tiles[TILE_DELTA_RLE], tiles[TILE_RAW],
+			(unsigned int)keyFrameBytes) ;
+	}
+
+	printf("\n") ;
+}
+
+// Continuous test image on [0, 1) x [0, 1), one quadrant each of zone plate, stripes
+// getting finer, smooth gradient and hard edges. Channels are returned in b, g, r.
+static void TestPattern(double u, double v, double& b, double& g, double& r)
+{
+	if (u < 0.5 && v < 0.5)
+	{
+		double dx = u - 0.25 ;
+		double dy = v - 0.25 ;
+		double zone = 0.5 + 0.5 * cos(2000.0 * (dx * dx + dy * dy)) ;
+		b = g = r = zone ;
+	}
+	else if (v < 0.5)
+	{
+		double x = (u - 0.5) * 2.0 ;
+		double stripe = sin(40.0 * x * x * 3.14159265358979) > 0 ? 1.0 : 0.0 ;
+		b = stripe ;
+		g = stripe ;
+		r = 1.0 - stripe ;
+	}
+	else if (u < 0.5)
+	{
+		b = u * 2.0 ;
+		g = (v - 0.5) * 2.0 ;
+		r = 1.0 - u * 2.0 ;
+	}
+	else
+	{
+		// Checker board rotated a bit so the edges cross pixels at every phase
+		double x = (u - 0.5) * 0.966 + (v - 0.5) * 0.259 ;
+		double y = (v - 0.5) * 0.966 - (u - 0.5) * 0.259 ;
+		bool on = (((int)floor(x * 24.0) + (int)floor(y * 24.0)) & 1) != 0 ;
+		b = on ? 0.9 : 0.1 ;
+		g = on ? 0.2 : 0.8 ;
+		r = on ? 0.6 : 0.3 ;
+	}
+}
+
+// Render the test pattern with samples x samples points averaged over every pixel
+static void RenderPattern(const FrameView& frame, int samples)
+{
+	for (int y = 0; y < frame.height; ++y)
+	{
+		unsigned char* row = frame.Row(y) ;
+		for (int x = 0; x < frame.width; ++x)
+		{
+			double b = 0, g = 0, r = 0 ;
+			for (int sy = 0; sy < samples; ++sy)
+			{
+				for (int sx = 0; sx < samples; ++sx)
+				{
+					double pb, pg, pr ;
+					TestPattern((x + (sx + 0.5) / samples) / frame.width,
+								(y + (sy + 0.5) / samples) / frame.height, pb, pg, pr) ;
+					b += pb ;
+					g += pg ;
+					r += pr ;
+				}
+			}
+
+			double scale = 255.0 / (samples * samples) ;
+			row[x * 4 + 0] = (unsigned char)(b * scale + 0.5) ;
+			row[x * 4 + 1] = (unsigned char)(g * scale + 0.5) ;
+			row[x * 4 + 2] = (unsigned char)(r * scale + 0.5) ;
+			row[x * 4 + 3] = 0xFF ;
+		}
+	}
+}
+
+// Scaling speed with and without the thread pool, and quality as PSNR against the
+// test pattern rendered directly at the destination size
+static void BenchmarkScaler(int srcWidth, int srcHeight, int dstWidth, int dstHeight, int frameCount, ThreadPool& pool)
+{
+	printf("FrameScaler %dx%d -> %dx%d, %d frames, %d threads\n",
+		srcWidth, srcHeight, dstWidth, dstHeight, frameCount, pool.ThreadCount()) ;
+	printf("%-9s %12s %12s %12s %10s\n", "filter", "1 thread ms", "pool ms", "MPix/s", "PSNR dB") ;
+
+	static const char* filterNames[SCALE_FILTER_COUNT] = { "box", "bilinear", "lanczos3" } ;
+
+	FrameBuffer src ;
+	src.Create(srcWidth, srcHeight) ;
+	RenderPattern(src.View(), 2) ;
+
+	FrameBuffer reference ;
+	reference.Create(dstWidth, dstHeight) ;
+	RenderPattern(reference.View(), 8) ;
+
+	FrameBuffer dst ;
+	dst.Create(dstWidth, dstHeight) ;
+
+	for (int filter = 0; filter < SCALE_FILTER_COUNT; ++filter)
+	{
+		FrameScaler scaler ;
+		scaler.Setup(srcWidth, srcHeight, dstWidth, dstHeight, (SCALE_FILTER)filter) ;
+		scaler.Scale(src.View(), dst.View(), NULL) ;
+
+		Timer timer ;
+		for (int i = 0; i < frameCount; ++i)
+		{
+			scaler.Scale(src.View(), dst.View(), NULL) ;
+		}
+		double singleMs = timer.ElapsedMs() / frameCount ;
+
+		timer.Restart() ;
+		for (int i = 0; i < frameCount; ++i)
+		{
+			scaler.Scale(src.View(), dst.View(), &pool) ;
+		}
+		double poolMs = timer.ElapsedMs() / frameCount ;
+
+		printf("%-9s %12.3f %12.3f %12.1f %10.2f\n",
+			filterNames[filter],
+			singleMs,
+			poolMs,
+			(double)srcWidth * srcHeight / (poolMs / 1000.0) / 1e6,
+			ComputePSNR(dst.View(), reference.View())) ;
+	}
+
+	printf("\n") ;
+}
+
+// Encode time and size per format, then a burst of 60 shots taken at 60 fps through the
+// ScreenshotWriter. The capture side must never lose a shot; the time it spends per shot
+// (copy plus waiting for a free buffer) is what a render loop would lose.
+static bool BenchmarkScreenshots(int width, int height, int queueDepth, int encoderThreads)
+{
+	printf("Screenshots %dx%d, burst of 60 shots at 60 fps, %d staging buffers, %d encoder threads\n",
+		width, height, queueDepth, encoderThreads) ;
+	printf("%-6s %10s %12s %14s %14s %8s %8s\n", "format", "encode ms", "bytes", "capture avg ms", "capture max ms", "stalls", "written") ;
+
+	FrameBuffer frame ;
+	frame.Create(width, height) ;
+	FillDesktop(frame.View()) ;
+	for (int i = 0; i < 400; ++i)
+	{
+		Animate(SCENE_TYPING, frame.View(), i) ;
+	}
+
+	bool passed = true ;
+	const int shotCount = 60 ;
+
+	for (int format = 0; format < IMAGE_FORMAT_COUNT; ++format)
+	{
+		FrameView view = frame.View() ;
+		ImageDesc image = { view.pixels, view.width, view.height, view.pitch, false } ;
+		std::vector<unsigned char> file ;
+
+		Timer timer ;
+		EncodeImage((IMAGE_FORMAT)format, image, file) ;
+		double encodeMs = timer.ElapsedMs() ;
+
+		ScreenshotWriter writer ;
+		writer.Start(queueDepth, encoderThreads) ;
+
+		double captureMs = 0 ;
+		double captureMaxMs = 0 ;
+		Timer clock ;
+		for (int i = 0; i < shotCount; ++i)
+		{
+			Animate(SCENE_VIDEO, frame.View(), i) ;
+
+			char path[64] ;
+			sprintf(path, "shot_%02d.%s", i, ImageFormatExtension((IMAGE_FORMAT)format)) ;
+
+			timer.Restart() ;
+			if (!writer.Write(frame.View(), path, (IMAGE_FORMAT)format))
+			{
+				passed = false ;
+			}
+			double ms = timer.ElapsedMs() ;
+			captureMs += ms ;
+			captureMaxMs = ms > captureMaxMs ? ms : captureMaxMs ;
+
+			// Wait for the next frame
+			double next = (i + 1) * 1000.0 / 60 ;
+			double now = clock.ElapsedMs() ;
+			if (now < next)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds((long long)((next - now) * 1000))) ;
+			}
+		}
+
+		writer.Flush() ;
+		ScreenshotStats stats = writer.Stats() ;
+		writer.Stop() ;
+
+		for (int i = 0; i < shotCount; ++i)
+		{
+			char path[64] ;
+			sprintf(path, "shot_%02d.%s", i, ImageFormatExtension((IMAGE_FORMAT)format)) ;
+			remove(path) ;
+		}
+
+		if (stats.written != shotCount || stats.failed != 0)
+		{
+			passed = false ;
+		}
+
+		printf("%-6s %10.2f %12u %14.3f %14.3f %8d %5d/%d\n",
+			ImageFormatExtension((IMAGE_FORMAT)format),
+			encodeMs,
+			(unsigned int)file.size(),
+			captureMs / shotCount,
+			captureMaxMs,
+			stats.stalls,
+			stats.written, shotCount) ;
+	}
+
+	printf("\n") ;
+	return passed ;
+}
+
+// FNV-1a over the visible pixels of a frame
+static unsigned long long HashFrame(const FrameView& frame)
+{
+	unsigned long long hash = 14695981039346656037ULL ;
+	for (int y = 0; y < frame.height; ++y)
+	{
+		const unsigned char* row = frame.Row(y) ;
+		for (int x = 0; x < frame.width * FRAME_BYTES_PER_PIXEL; ++x)
+		{
+			hash = (hash ^ row[x]) * 1099511628211ULL ;
+		}
+	}
+	return hash ;
+}
+
+// Encoder thread writes packets into a pipe, the viewer on this thread decodes them.
+// Every decoded frame must hash the same as the frame that was encoded.
+static bool LoopbackTest(int width, int height, int frameCount)
+{
+	printf("Loopback %dx%d through a pipe, %d frames per scene\n", width, height, frameCount) ;
+
+	PipeStream reader ;
+	PipeStream writer ;
+	if (!PipeStream::CreatePair(reader, writer))
+	{
+		printf("FAILED to create pipe\n") ;
+		return false ;
+	}
+
+	std::mutex hashLock ;
+	std::vector<unsigned long long> sentHashes ;
+	unsigned long long totalBytes = 0 ;
+
+	std::thread encoderThread([&]()
+	{
+		FrameBuffer frame ;
+		frame.Create(width, height) ;
+
+		ScreenEncoder encoder ;
+		std::vector<unsigned char> packet ;
+
+		for (int scene = 0; scene < SCENE_COUNT; ++scene)
+		{
+			FillDesktop(frame.View()) ;
+			encoder.RequestKeyFrame() ;
+
+			for (int i = 0; i <= frameCount; ++i)
+			{
+				if (i > 0)
+				{
+					Animate((SCENE)scene, frame.View(), i) ;
+				}
+
+				if (!encoder.Encode(frame.View(), CaptureTimeNow(), packet))
+				{
+					continue ;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(hashLock) ;
+					sentHashes.push_back(HashFrame(frame.View())) ;
+				}
+
+				totalBytes += packet.size() ;
+				if (!WritePacket(writer, packet))
+				{
+					break ;
+				}
+			}
+		}
+
+		writer.Close() ;
+	}) ;
+
+	ScreenDecoder decoder ;
+	std::vector<unsigned char> packet ;
+	int received = 0 ;
+	int mismatches = 0 ;
+	bool malformed = false ;
+	double latencySum = 0 ;
+	double latencyMax = 0 ;
+
+	Timer timer ;
+	while (ReadPacket(reader, packet))
+	{
+		if (!decoder.Decode(&packet[0], packet.size(), NULL))
+		{
+			malformed = true ;
+			break ;
+		}
+
+		double latency = (CaptureTimeNow() - decoder.LastHeader().captureTime) / 1000.0 ;
+		latencySum += latency ;
+		if (latency > latencyMax) latencyMax = latency ;
+
+		unsigned long long expected ;
+		{
+			std::lock_guard<std::mutex> lock(hashLock) ;
+			expected = sentHashes[received] ;
+		}
+
+		if (HashFrame(decoder.Frame()) != expected)
+		{
+			++mismatches ;
+		}
+		++received ;
+	}
+	double totalMs = timer.ElapsedMs() ;
+
+	reader.Close() ;
+	encoderThread.join() ;
+
+	bool passed = !malformed && mismatches == 0 && received == (int)sentHashes.size() ;
+	printf("%d packets, %.1f MB, %.1f ms total, latency avg %.2f ms max %.2f ms, %d mismatches: %s\n\n",
+		received, totalBytes / 1e6, totalMs,
+		received ? latencySum / received : 0.0, latencyMax, mismatches,
+		passed ? "bit-exact" : "FAILED") ;
+
+	return passed ;
+}
+
+int main()
+{
+	BenchmarkTileDiff(1920, 1080, 200) ;
+	BenchmarkTileDiff(3840, 2160, 100) ;
+
+	BenchmarkEncoder(1920, 1080, 200, 30) ;
+	BenchmarkEncoder(3840, 2160, 100, 30) ;
+
+	ThreadPool pool ;
+	BenchmarkScaler(3840, 2160, 1920, 1080, 20, pool) ;
+	BenchmarkScaler(3840, 2160, 400, 400, 20, pool) ;
+	BenchmarkScaler(1366, 768, 1920, 1080, 20, pool) ;
+
+	bool passed = BenchmarkScreenshots(1920, 1080, 8, 2) ;
+
+	passed = LoopbackTest(1920, 1080, 60) && passed ;
+	passed = LoopbackTest(1366, 768, 60) && passed ;	// partial edge tiles
+
+	return passed ? 0 : 1 ;
+}
@@ -0,0 +1,212 @@
+/*
+Benchmark and self check for the fixed step main loop in Common/Utility.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 GameLoopBenchmark.cpp ../../Utility/GameLoop.cpp -o GameLoopBenchmark
+
+Simulates a thrown ball through a GameLoop at frame times of 60 Hz, 144 Hz, 30 Hz and
+randomly between 1 and 40 ms, and the same ball the way the demos did, a step per
+frame as long as the frame. With fixed steps the ball must land at the same point with
+the same number of updates at every frame rate, Alpha must stay in [0, 1) and add up
+with the updates to the time passed, and a frame of seconds must be cut to
+MAX_FRAME_MS.
+
+Then paces real frames at 100 and 30 frames per second and while inactive, and reports
+the frame rate, the lateness of frames, the idle share the loop measured and the CPU
+time used. Exits
+with a non-zero code if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../Utility/GameLoop.h"
+#include "../../Utility/Timer.h"
+
+static const double SIMULATED_SECONDS = 10.0 ;
+static const double PACED_SECONDS = 1.5 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static long long MsToTicks(double ms)
+{
+	return (long long)(ms * TimerFrequency() / 1000.0 + 0.5) ;
+}
+
+struct Ball
+{
+	double x, y ;
+	double vx, vy ;
+
+	void Throw()
+	{
+		x = 0.0 ;
+		y = 0.0 ;
+		vx = 3.0 ;
+		vy = 20.0 ;
+	}
+
+	// Semi-implicit Euler, the result depends on the step
+	void Update(double dt)
+	{
+		vy -= 9.8 * dt ;
+		x += vx * dt ;
+		y += vy * dt ;
+		if (y < 0.0)
+		{
+			y = -y * 0.8 ;
+			vy = -vy * 0.8 ;
+		}
+	}
+};
+
+// Frame times in ms of a pattern
+static double FrameMs(int pattern, unsigned int& seed)
+{
+	switch (pattern)
+	{
+	case 0: return 1000.0 / 60.0 ;
+	case 1: return 1000.0 / 144.0 ;
+	case 2: return 1000.0 / 30.0 ;
+	default:
+		seed = seed * 1664525u + 1013904223u ;
+		return 1.0 + (seed >> 8) % 3900 / 100.0 ;
+	}
+}
+
+static void CheckFixedStep()
+{
+	static const char* names[] = { "60 Hz", "144 Hz", "30 Hz", "1 to 40 ms" } ;
+
+	printf("%-12s %8s %8s %12s %12s %12s\n", "frame time", "frames", "updates", "fixed x", "fixed y", "per frame y") ;
+
+	Ball reference ;
+	unsigned long long referenceUpdates = 0 ;
+	for (int pattern = 0; pattern < 4; ++pattern)
+	{
+		GameLoop loop(60.0, 0.0) ;
+		Ball fixed ;
+		Ball variable ;
+		fixed.Throw() ;
+		variable.Throw() ;
+
+		// Frames until the fixed steps reach the simulated time
+		unsigned long long updates = (unsigned long long)(SIMULATED_SECONDS / loop.StepSeconds() + 0.5) ;
+		unsigned int seed = 12345 ;
+		long long now = MsToTicks(1000.0) ;
+		long long start = now ;
+		int frames = 0 ;
+		bool alphaInRange = true ;
+		bool timeAddsUp = true ;
+		loop.Advance(now) ;
+		while (loop.UpdateCount() < updates)
+		{
+			double ms = FrameMs(pattern, seed) ;
+			now += MsToTicks(ms) ;
+			int steps = loop.Advance(now) ;
+			for (int i = 0; i < steps && loop.UpdateCount() - steps + i < updates; ++i)
+			{
+				fixed.Update(loop.StepSeconds()) ;
+			}
+			variable.Update(ms / 1000.0) ;
+			++frames ;
+
+			double alpha = loop.Alpha() ;
+			alphaInRange = alphaInRange && alpha >= 0.0 && alpha < 1.0 ;
+			double simulated = (loop.UpdateCount() + alpha) * loop.StepSeconds() * 1000.0 ;
+			timeAddsUp = timeAddsUp && fabs(simulated - TicksToMs(now - start)) < 0.01 ;
+		}
+
+		if (pattern == 0)
+		{
+			reference = fixed ;
+			referenceUpdates = updates ;
+		}
+
+		printf("%-12s %8d %8llu %12.6f %12.6f %12.6f\n", names[pattern], frames, updates, fixed.x, fixed.y, variable.y) ;
+		Check(updates == referenceUpdates && fixed.x == reference.x && fixed.y == reference.y, "same result at every frame rate") ;
+		Check(alphaInRange, "alpha in [0, 1)") ;
+		Check(timeAddsUp, "updates and alpha add up to the time passed") ;
+	}
+
+	// A frame of 2 s only counts as MAX_FRAME_MS
+	GameLoop loop(60.0, 0.0) ;
+	loop.Advance(MsToTicks(1000.0)) ;
+	int steps = loop.Advance(MsToTicks(3000.0)) ;
+	Check(steps > 0 && fabs(steps * loop.StepSeconds() * 1000.0 - GameLoop::MAX_FRAME_MS) < loop.StepSeconds() * 1000.0, "long frame cut") ;
+
+	// Reset drops the time before it, time going back adds nothing
+	loop.Reset() ;
+	loop.Advance(MsToTicks(10000.0)) ;
+	Check(loop.Advance(MsToTicks(9000.0)) == 0 && loop.Advance(MsToTicks(9000.0 + 1000.0 / 60.0 + 0.01)) == 1, "reset and clock going back") ;
+	printf("\n") ;
+}
+
+// Run frames of workMs through the pacing
+static void Pace(const char* name, double frameRate, bool active, double workMs)
+{
+	GameLoop loop(60.0, 60.0) ;
+	loop.SetFrameRate(active ? frameRate : 60.0) ;
+	loop.SetInactiveFrameRate(frameRate) ;
+	loop.SetActive(active) ;
+
+	long long period = MsToTicks(1000.0 / frameRate) ;
+	double maxLateMs = 0.0 ;
+	clock_t cpuStart = clock() ;
+	long long start = TimerTicks() ;
+	long long deadline = start ;
+	int frames = (int)(frameRate * PACED_SECONDS) ;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		loop.BeginFrame() ;
+		long long workEnd = TimerTicks() + MsToTicks(workMs) ;
+		while (TimerTicks() < workEnd)
+		{
+		}
+		loop.WaitForNextFrame() ;
+
+		deadline += period ;
+		double lateMs = TicksToMs(TimerTicks() - deadline) ;
+		maxLateMs = lateMs > maxLateMs ? lateMs : maxLateMs ;
+	}
+	double wallMs = TicksToMs(TimerTicks() - start) ;
+	double cpuMs = (clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC ;
+
+	double measured = frames * 1000.0 / wallMs ;
+	printf("%-18s %8.1f %8.1f %10.2f %8.1f %% %8.1f %%\n", name, frameRate, measured, maxLateMs,
+		   loop.IdlePercent(), 100.0 * cpuMs / wallMs) ;
+
+	// Loose bounds, a loaded machine wakes threads late
+	Check(measured > frameRate * 0.85 && measured < frameRate * 1.05, "paced frame rate") ;
+	Check(fabs(loop.FrameRate() - measured) < frameRate * 0.1, "measured frame rate") ;
+	Check(loop.IdlePercent() > 50.0 && cpuMs < wallMs * 0.8, "sleeps instead of spinning") ;
+}
+
+int main()
+{
+	CheckFixedStep() ;
+
+	printf("%-18s %8s %8s %10s %10s %10s\n", "pacing", "target", "fps", "late ms", "idle", "cpu") ;
+	Pace("100 fps, 2 ms work", 100.0, true, 2.0) ;
+	Pace("30 fps, 5 ms work", 30.0, true, 5.0) ;
+	Pace("inactive 15 fps", 15.0, false, 2.0) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
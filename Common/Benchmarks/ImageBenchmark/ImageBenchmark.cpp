@@ -0,0 +1,687 @@
+/*
+Benchmark and self check for the image cache and the decode pipeline in Common/Image.
+
+Runs on any machine, including Linux:
+	g++ -O2 -std=c++11 -pthread -I../../Image ImageBenchmark.cpp ../../Image/ImageCache.cpp \
+		../../Image/ImageWriter.cpp ../../Image/ImageReader.cpp ../../Image/JpegDecoder.cpp \
+		../../Image/PixelConvert.cpp ../../Image/Resample.cpp ../../Image/Deflate.cpp \
+		../../Image/Inflate.cpp ../../Utility/MappedFile.cpp ../../Utility/ThreadPool.cpp -o ImageBenchmark
+
+Writes a picture as a BMP file into the working directory and draws it for a number of
+frames, once loading it every frame as LetterHunter used to, once through the cache. The
+decoder here maps the file and converts the pixels, WIC does more work per file, so the
+difference in a demo is larger than measured here. A device that only copies the pixels
+stands in for Direct2D.
+
+The pipeline part measures every stage in MB/s of decoded pixels: BMP, PNG, QOI and
+JPEG decoding, colour conversion, premultiplication and scaling on 1 to N threads. The
+JPEGs are the pictures of the Direct2D demos, found relative to this directory.
+
+Exits with a non-zero code if a decoder does not give back the pixels the encoders in
+ImageWriter wrote, the vector conversions differ from the reference formulas, scaling
+depends on the thread count or changes a flat image, or if a cached frame reads the file, a device loss decodes again,
+a failed decode is retried, or the keys of different sizes and formats share an entry.
+A JPEG with an over-subscribed Huffman table must be rejected, and one with garbage in
+its scan must decode without reading or writing out of bounds, best run with
+-fsanitize=address,undefined to see the latter.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "ImageCache.h"
+#include "ImageReader.h"
+#include "ImageWriter.h"
+#include "PixelConvert.h"
+#include "Resample.h"
+#include "../../Utility/MappedFile.h"
+#include "../../Utility/ThreadPool.h"
+#include "../../Utility/Timer.h"
+
+static const char* BENCH_FILE = "image_bench.bmp" ;
+static const int PICTURE_WIDTH = 1024 ;
+static const int PICTURE_HEIGHT = 768 ;
+static const int FRAMES = 120 ;
+
+static const int STAGE_REPEATS = 5 ;
+
+// Pictures to decode, relative to Common/Benchmarks/ImageBenchmark
+static const char* JPEG_FILES[] =
+{
+	"../../../Direct2D/Bitmap/sampleImage.jpg",
+	"../../../DirectX9/Common/Media/autumn.JPG",
+	"../../../DirectX9/Common/Media/chessboard.jpg",
+} ;
+
+static int g_Failures = 0 ;
+
+// Keeps the compiler from dropping the draw loops
+static volatile unsigned int g_Sink = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static unsigned int GetLE32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24) ;
+}
+
+// Reads the 32 bit bottom-up BMP files EncodeBMP writes, scales by nearest pixel
+class BmpDecoder : public ImageDecoder
+{
+public:
+	BmpDecoder() : decodes(0), fileOpens(0) {}
+
+	virtual bool Decode(const ImageKey& key, DecodedImage& image)
+	{
+		++decodes ;
+
+		MappedFile file ;
+		if (!file.Open(key.path.c_str()))
+		{
+			return false ;
+		}
+		++fileOpens ;
+
+		const unsigned char* data = file.Data() ;
+		if (file.Size() < 54 || data[0] != 'B' || data[1] != 'M' || data[28] != 32)
+		{
+			return false ;
+		}
+
+		unsigned int offset = GetLE32(data + 10) ;
+		unsigned int width = GetLE32(data + 18) ;
+		unsigned int height = GetLE32(data + 22) ;
+		if (width == 0 || height == 0 || offset > file.Size() || (file.Size() - offset) / 4 / width < height)
+		{
+			return false ;
+		}
+
+		image.width = key.width ? key.width : width ;
+		image.height = key.height ? key.height : height ;
+		image.pitch = image.width * 4 ;
+		image.format = key.format ;
+		image.pixels.resize((size_t)image.pitch * image.height) ;
+
+		for (unsigned int y = 0; y < image.height; ++y)
+		{
+			unsigned int sy = y * height / image.height ;
+			const unsigned char* src = data + offset + (size_t)(height - 1 - sy) * width * 4 ;
+			unsigned char* dest = &image.pixels[(size_t)y * image.pitch] ;
+
+			for (unsigned int x = 0; x < image.width; ++x)
+			{
+				const unsigned char* s = src + (x * width / image.width) * 4 ;
+				unsigned int a = key.format == PIXEL_BGRX ? 255 : s[3] ;
+				dest[x * 4 + 0] = (unsigned char)(s[0] * a / 255) ;
+				dest[x * 4 + 1] = (unsigned char)(s[1] * a / 255) ;
+				dest[x * 4 + 2] = (unsigned char)(s[2] * a / 255) ;
+				dest[x * 4 + 3] = (unsigned char)a ;
+			}
+		}
+
+		return true ;
+	}
+
+	int decodes ;
+	int fileOpens ;
+};
+
+// Copies the pixels into a "texture", as a driver would
+class CopyDevice : public ImageDevice
+{
+public:
+	CopyDevice() : created(0), live(0) {}
+
+	virtual void* CreateBitmap(const DecodedImage& image)
+	{
+		++created ;
+		++live ;
+		return new std::vector<unsigned char>(image.pixels) ;
+	}
+
+	virtual void ReleaseBitmap(void* bitmap)
+	{
+		--live ;
+		delete static_cast<std::vector<unsigned char>*>(bitmap) ;
+	}
+
+	int created ;
+	int live ;
+};
+
+// Stand-in for drawing, touches one pixel per row so the bitmap is used
+static unsigned int Draw(const void* bitmap, int pitch)
+{
+	const std::vector<unsigned char>& pixels = *static_cast<const std::vector<unsigned char>*>(bitmap) ;
+	unsigned int sum = 0 ;
+	for (size_t i = 0; i < pixels.size(); i += pitch)
+	{
+		sum += pixels[i] ;
+	}
+	return sum ;
+}
+
+static bool WritePicture()
+{
+	std::vector<unsigned char> pixels(PICTURE_WIDTH * PICTURE_HEIGHT * 4) ;
+	for (int y = 0; y < PICTURE_HEIGHT; ++y)
+	{
+		for (int x = 0; x < PICTURE_WIDTH; ++x)
+		{
+			unsigned char* p = &pixels[(y * PICTURE_WIDTH + x) * 4] ;
+			p[0] = (unsigned char)x ;
+			p[1] = (unsigned char)y ;
+			p[2] = (unsigned char)(x ^ y) ;
+			p[3] = (unsigned char)(255 - (x & 63)) ;
+		}
+	}
+
+	ImageDesc desc = { &pixels[0], PICTURE_WIDTH, PICTURE_HEIGHT, PICTURE_WIDTH * 4, true } ;
+	std::vector<unsigned char> file ;
+	if (!EncodeBMP(desc, file))
+	{
+		return false ;
+	}
+
+	FILE* f = fopen(BENCH_FILE, "wb") ;
+	if (!f)
+	{
+		return false ;
+	}
+	bool written = fwrite(&file[0], 1, file.size(), f) == file.size() ;
+	fclose(f) ;
+	return written ;
+}
+
+// Every frame decodes and uploads the picture again
+static double BenchmarkUncached(const ImageKey& key)
+{
+	BmpDecoder decoder ;
+	CopyDevice device ;
+	unsigned int sum = 0 ;
+
+	Timer timer ;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		DecodedImage image ;
+		if (!decoder.Decode(key, image))
+		{
+			return 0 ;
+		}
+		void* bitmap = device.CreateBitmap(image) ;
+		sum += Draw(bitmap, image.pitch) ;
+		device.ReleaseBitmap(bitmap) ;
+	}
+	double ms = timer.ElapsedMs() ;
+
+	g_Sink = sum ;
+
+	printf("%-28s %8.3f ms/frame  %4d file opens\n", "load every frame", ms / FRAMES, decoder.fileOpens) ;
+	return ms ;
+}
+
+static double BenchmarkCached(const ImageKey& key)
+{
+	BmpDecoder decoder ;
+	CopyDevice device ;
+	ImageCache cache(&decoder, &device) ;
+	unsigned int sum = 0 ;
+
+	Timer timer ;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		void* bitmap = cache.Get(key) ;
+		if (!bitmap)
+		{
+			return 0 ;
+		}
+		sum += Draw(bitmap, key.width * 4) ;
+	}
+	double ms = timer.ElapsedMs() ;
+
+	// Steady state, every frame after the first
+	Timer steady ;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		sum += cache.Get(key) != NULL ;
+	}
+	double steadyMs = steady.ElapsedMs() ;
+
+	g_Sink = sum ;
+
+	const ImageCacheStats& stats = cache.Stats() ;
+	printf("%-28s %8.3f ms/frame  %4d file opens\n", "image cache", ms / FRAMES, decoder.fileOpens) ;
+	printf("%-28s %8.3f us/Get    %d hits, %d misses, decode %.2f ms, upload %.2f ms, %u KB held\n", "image cache steady state",
+		   steadyMs * 1000.0 / FRAMES, stats.hits, stats.misses, stats.decodeMs, stats.uploadMs, (unsigned int)(stats.decodedBytes / 1024)) ;
+
+	Check(decoder.fileOpens == 1, "cached frames read the file once") ;
+	Check(stats.misses == 1 && stats.hits == 2 * FRAMES - 1, "one miss, every other Get hits") ;
+	return ms ;
+}
+
+static void TestCacheBehaviour()
+{
+	BmpDecoder decoder ;
+	CopyDevice device ;
+	ImageCache cache(&decoder, &device) ;
+
+	ImageKey original(BENCH_FILE, 0, 0, PIXEL_PBGRA) ;
+	ImageKey small(BENCH_FILE, 256, 192, PIXEL_PBGRA) ;
+	ImageKey opaque(BENCH_FILE, 0, 0, PIXEL_BGRX) ;
+
+	void* first = cache.Get(original) ;
+	Check(first != NULL && cache.Get(original) == first, "the same key returns the same bitmap") ;
+
+	const DecodedImage* image = cache.GetImage(small) ;
+	Check(image && image->width == 256 && image->height == 192, "a target size decodes to that size") ;
+	Check(cache.Get(small) != first, "keys of different sizes are different entries") ;
+
+	const DecodedImage* opaqueImage = cache.GetImage(opaque) ;
+	Check(opaqueImage && opaqueImage->pixels[3] == 255 && opaqueImage->format == PIXEL_BGRX, "BGRX images are opaque") ;
+	Check(decoder.decodes == 3 && cache.Count() == 3, "one decode per key") ;
+
+	// Device loss releases the bitmaps, the next Get uploads the kept pixels
+	cache.DeviceLost() ;
+	Check(device.live == 0, "device loss releases every bitmap") ;
+	Check(cache.Get(original) != NULL && decoder.decodes == 3, "a lost device uploads again without decoding") ;
+	Check(cache.Stats().uploads == 3 && cache.Stats().deviceLosses == 1, "uploads and device losses are counted") ;
+
+	// A missing file is tried once
+	ImageKey missing("image_bench_missing.bmp", 0, 0, PIXEL_PBGRA) ;
+	for (int i = 0; i < 10; ++i)
+	{
+		Check(cache.Get(missing) == NULL, "a missing file has no bitmap") ;
+	}
+	Check(decoder.decodes == 4 && cache.Stats().failed == 1, "a failed decode is not retried") ;
+
+	size_t bytes = cache.Stats().decodedBytes ;
+	cache.Remove(small) ;
+	Check(cache.Stats().decodedBytes == bytes - 256 * 192 * 4 && cache.Count() == 3, "Remove frees the pixels of its key") ;
+
+	cache.Clear() ;
+	Check(device.live == 0 && cache.Count() == 0 && cache.Stats().decodedBytes == 0, "Clear releases everything") ;
+}
+
+//
+// Decode pipeline
+//
+
+// A photo-like picture with smooth gradients, edges and varying alpha
+static void MakePicture(std::vector<unsigned char>& pixels, int width, int height)
+{
+	pixels.resize((size_t)width * height * 4) ;
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			unsigned char* p = &pixels[((size_t)y * width + x) * 4] ;
+			p[0] = (unsigned char)(x * 255 / width) ;
+			p[1] = (unsigned char)(y * 255 / height) ;
+			p[2] = (unsigned char)(((x / 32) ^ (y / 32)) & 1 ? 200 : 40) ;
+			p[3] = (unsigned char)(128 + 127 * sin(x * 0.02) * cos(y * 0.03)) ;
+		}
+	}
+}
+
+static void PrintStage(const char* name, const char* detail, size_t bytes, double ms)
+{
+	printf("%-16s %-34s %8.2f ms %9.1f MB/s\n", name, detail, ms, bytes / (1024.0 * 1024.0) / (ms / 1000.0)) ;
+}
+
+// Decode a file STAGE_REPEATS times, keep the fastest run
+static double TimeDecode(const std::vector<unsigned char>& file, PIXEL_FORMAT format, DecodedImage& image)
+{
+	double best = 1e30 ;
+	for (int i = 0; i < STAGE_REPEATS; ++i)
+	{
+		Timer timer ;
+		if (!DecodeImage(&file[0], file.size(), format, image))
+		{
+			return 0 ;
+		}
+		double ms = timer.ElapsedMs() ;
+		best = ms < best ? ms : best ;
+	}
+	return best ;
+}
+
+static void BenchmarkDecoders()
+{
+	std::vector<unsigned char> pixels ;
+	MakePicture(pixels, PICTURE_WIDTH, PICTURE_HEIGHT) ;
+	size_t bytes = pixels.size() ;
+	size_t count = (size_t)PICTURE_WIDTH * PICTURE_HEIGHT ;
+
+	// What the decoders must return: premultiplied, or opaque for files without alpha
+	std::vector<unsigned char> premultiplied(pixels) ;
+	PremultiplyAlpha(&premultiplied[0], count) ;
+	std::vector<unsigned char> opaque(pixels) ;
+	SetOpaque(&opaque[0], count) ;
+
+	static const char* names[IMAGE_FORMAT_COUNT] = { "BMP decode", "PNG decode", "QOI decode" } ;
+	for (int format = 0; format < IMAGE_FORMAT_COUNT; ++format)
+	{
+		for (int alpha = 1; alpha >= 0; --alpha)
+		{
+			ImageDesc desc = { &pixels[0], PICTURE_WIDTH, PICTURE_HEIGHT, PICTURE_WIDTH * 4, alpha != 0 } ;
+			std::vector<unsigned char> file ;
+			EncodeImage((IMAGE_FORMAT)format, desc, file) ;
+
+			DecodedImage image ;
+			double ms = TimeDecode(file, PIXEL_PBGRA, image) ;
+			char detail[64] ;
+			sprintf(detail, "%s, %u KB file", alpha ? "BGRA" : "BGR", (unsigned int)(file.size() / 1024)) ;
+			PrintStage(names[format], detail, bytes, ms) ;
+
+			const std::vector<unsigned char>& expected = alpha ? premultiplied : opaque ;
+			Check(ms > 0 && image.width == PICTURE_WIDTH && image.height == PICTURE_HEIGHT &&
+				  memcmp(&image.pixels[0], &expected[0], bytes) == 0, "decoding gives back the encoded pixels") ;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(JPEG_FILES) / sizeof(JPEG_FILES[0]); ++i)
+	{
+		MappedFile file ;
+		if (!file.Open(JPEG_FILES[i]))
+		{
+			printf("%-16s %s not found, skipped\n", "JPEG decode", JPEG_FILES[i]) ;
+			continue ;
+		}
+
+		std::vector<unsigned char> data(file.Data(), file.Data() + file.Size()) ;
+		DecodedImage image ;
+		double ms = TimeDecode(data, PIXEL_BGRX, image) ;
+		char detail[64] ;
+		sprintf(detail, "%ux%u %s", image.width, image.height, strrchr(JPEG_FILES[i], '/') + 1) ;
+		PrintStage("JPEG decode", detail, (size_t)image.width * image.height * 4, ms) ;
+		Check(ms > 0 && IsOpaque(&image.pixels[0], (size_t)image.width * image.height), "JPEG files decode to opaque pixels") ;
+	}
+}
+
+// The vector conversions against the formulas they implement
+static void BenchmarkConversions()
+{
+	size_t count = (size_t)PICTURE_WIDTH * PICTURE_HEIGHT ;
+	std::vector<unsigned char> pixels ;
+	MakePicture(pixels, PICTURE_WIDTH, PICTURE_HEIGHT) ;
+	std::vector<unsigned char> work(pixels.size()) ;
+
+	// Premultiply: exact rounding of c * a / 255
+	double best = 1e30 ;
+	for (int i = 0; i < STAGE_REPEATS; ++i)
+	{
+		work = pixels ;
+		Timer timer ;
+		PremultiplyAlpha(&work[0], count) ;
+		double ms = timer.ElapsedMs() ;
+		best = ms < best ? ms : best ;
+	}
+	PrintStage("premultiply", "", pixels.size(), best) ;
+
+	bool exact = true ;
+	for (size_t i = 0; i < pixels.size() && exact; ++i)
+	{
+		unsigned int alpha = pixels[i | 3] ;
+		unsigned int expected = (i & 3) == 3 ? alpha : (unsigned int)floor(pixels[i] * alpha / 255.0 + 0.5) ;
+		exact = work[i] == expected ;
+	}
+	Check(exact, "PremultiplyAlpha rounds c * a / 255 exactly") ;
+
+	// Red and blue swap
+	best = 1e30 ;
+	for (int i = 0; i < STAGE_REPEATS; ++i)
+	{
+		Timer timer ;
+		SwapRedBlue(&pixels[0], &work[0], count) ;
+		double ms = timer.ElapsedMs() ;
+		best = ms < best ? ms : best ;
+	}
+	PrintStage("RGBA to BGRA", "", pixels.size(), best) ;
+	Check(work[0] == pixels[2] && work[2] == pixels[0] && work[count * 4 - 2] == pixels[count * 4 - 4], "SwapRedBlue swaps red and blue") ;
+
+	// YCbCr planes to BGRX, within 1 of the floating point BT.601 formulas
+	std::vector<unsigned char> y(count) ;
+	std::vector<unsigned char> cb(count) ;
+	std::vector<unsigned char> cr(count) ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		y[i] = pixels[i * 4] ;
+		cb[i] = pixels[i * 4 + 1] ;
+		cr[i] = pixels[i * 4 + 2] ;
+	}
+	best = 1e30 ;
+	for (int i = 0; i < STAGE_REPEATS; ++i)
+	{
+		Timer timer ;
+		YCbCrToBGRX(&y[0], &cb[0], &cr[0], &work[0], count) ;
+		double ms = timer.ElapsedMs() ;
+		best = ms < best ? ms : best ;
+	}
+	PrintStage("YCbCr to BGRX", "", work.size(), best) ;
+
+	int maxError = 0 ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		double expected[3] =
+		{
+			y[i] + 1.772 * (cb[i] - 128),
+			y[i] - 0.344136 * (cb[i] - 128) - 0.714136 * (cr[i] - 128),
+			y[i] + 1.402 * (cr[i] - 128),
+		} ;
+		for (int c = 0; c < 3; ++c)
+		{
+			double clamped = expected[c] < 0 ? 0 : (expected[c] > 255 ? 255 : expected[c]) ;
+			int error = (int)fabs(work[i * 4 + c] - floor(clamped + 0.5)) ;
+			maxError = error > maxError ? error : maxError ;
+		}
+	}
+	Check(maxError <= 1, "YCbCrToBGRX is within 1 of the exact conversion") ;
+}
+
+// Damaged copies of a JPEG, which must fail or decode to something, never crash
+static void TestDamagedJpeg()
+{
+	MappedFile file ;
+	if (!file.Open(JPEG_FILES[0]))
+	{
+		printf("%-16s %s not found, skipped\n", "damaged JPEG", JPEG_FILES[0]) ;
+		return ;
+	}
+	std::vector<unsigned char> data(file.Data(), file.Data() + file.Size()) ;
+
+	// Walk the segments up to the scan, an APP segment may hold a thumbnail with markers of its own
+	size_t scan = 0, huffman = 0, quant = 0 ;
+	for (size_t i = 2; i + 4 <= data.size() && data[i] == 0xFF; i += 2 + (data[i + 2] << 8 | data[i + 3]))
+	{
+		if (data[i + 1] == 0xC4 && huffman == 0)
+		{
+			huffman = i ;
+		}
+		if (data[i + 1] == 0xDB && quant == 0)
+		{
+			quant = i ;
+		}
+		if (data[i + 1] == 0xDA)
+		{
+			scan = i + 2 + (data[i + 2] << 8 | data[i + 3]) ;
+			break ;
+		}
+	}
+
+	// All the codes of the first Huffman table at length 1, where only 2 fit
+	if (huffman > 0 && huffman + 21 < data.size())
+	{
+		std::vector<unsigned char> damaged = data ;
+		unsigned char* counts = &damaged[huffman + 5] ;
+		int total = 0 ;
+		for (int k = 0; k < 16; ++k)
+		{
+			total += counts[k] ;
+			counts[k] = 0 ;
+		}
+		counts[0] = (unsigned char)std::min(total, 255) ;
+
+		DecodedImage image ;
+		Check(total > 2 && !DecodeImage(&damaged[0], damaged.size(), PIXEL_BGRX, image), "an over-subscribed Huffman table is rejected") ;
+	}
+	Check(huffman > 0, "the JPEG has a Huffman table") ;
+	Check(scan > 0 && scan < data.size(), "the JPEG has a scan") ;
+
+	// Garbage in the entropy coded data, without making markers, with the largest 8 bit
+	// quantizers gives coefficients far out of the range of real pictures
+	std::vector<unsigned char> coarse = data ;
+	if (quant > 0 && quant + 69 <= coarse.size() && (coarse[quant + 4] >> 4) == 0)
+	{
+		memset(&coarse[quant + 5], 255, 64) ;
+	}
+	unsigned int seed = 12345 ;
+	for (int run = 0; run < 20 && scan > 0 && scan < data.size(); ++run)
+	{
+		std::vector<unsigned char> damaged = coarse ;
+		seed = seed * 1664525u + 1013904223u ;
+		size_t first = scan + (seed >> 8) % (damaged.size() - scan) ;
+		for (size_t at = first; at < first + 4096 && at + 2 < damaged.size(); ++at)
+		{
+			seed = seed * 1664525u + 1013904223u ;
+			damaged[at] = (unsigned char)((seed >> 24) % 0xFF) ;
+		}
+		DecodedImage image ;
+		if (DecodeImage(&damaged[0], damaged.size(), PIXEL_BGRX, image))
+		{
+			g_Sink += image.pixels[0] ;
+		}
+	}
+}
+
+static unsigned int Hash(const DecodedImage& image)
+{
+	unsigned int hash = 2166136261u ;
+	for (size_t i = 0; i < image.pixels.size(); ++i)
+	{
+		hash = (hash ^ image.pixels[i]) * 16777619u ;
+	}
+	return hash ;
+}
+
+static void BenchmarkResize()
+{
+	// Thumbnail of a large photo, what a picture viewer does on load
+	DecodedImage source ;
+	MappedFile file ;
+	if (!file.Open(JPEG_FILES[1]) || !DecodeImage(file.Data(), file.Size(), PIXEL_BGRX, source))
+	{
+		std::vector<unsigned char> pixels ;
+		MakePicture(pixels, 2400, 3400) ;
+		source.Allocate(2400, 3400, PIXEL_PBGRA) ;
+		memcpy(&source.pixels[0], &pixels[0], pixels.size()) ;
+		PremultiplyAlpha(&source.pixels[0], pixels.size() / 4) ;
+	}
+	size_t bytes = source.pixels.size() ;
+
+	static const char* filterNames[] = { "bilinear", "cubic", "lanczos3" } ;
+	unsigned int thumbnailHeight = source.height * 1024 / source.width ;
+	int maxThreads = ThreadPool().ThreadCount() ;
+	for (int filter = RESAMPLE_BILINEAR; filter <= RESAMPLE_LANCZOS3; ++filter)
+	{
+		unsigned int singleHash = 0 ;
+		// 1, 2, 4 ... threads and the number of hardware threads
+		for (int threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads)
+		{
+			ThreadPool pool(threads) ;
+			DecodedImage thumbnail ;
+			double best = 1e30 ;
+			for (int i = 0; i < STAGE_REPEATS; ++i)
+			{
+				Timer timer ;
+				ResizeImage(source, 1024, thumbnailHeight, thumbnail, (RESAMPLE_FILTER)filter, &pool) ;
+				double ms = timer.ElapsedMs() ;
+				best = ms < best ? ms : best ;
+			}
+
+			char detail[64] ;
+			sprintf(detail, "%ux%u %s, %d thread%s", thumbnail.width, thumbnail.height, filterNames[filter], threads, threads > 1 ? "s" : "") ;
+			PrintStage("resize", detail, bytes, best) ;
+
+			unsigned int hash = Hash(thumbnail) ;
+			singleHash = threads == 1 ? hash : singleHash ;
+			Check(hash == singleHash, "scaling gives the same pixels on any number of threads") ;
+
+			if (threads == maxThreads)
+			{
+				break ;
+			}
+		}
+
+		// A flat colour stays exactly the same through every filter, enlarging or shrinking
+		DecodedImage flat ;
+		flat.Allocate(37, 23, PIXEL_PBGRA) ;
+		for (size_t i = 0; i < flat.pixels.size(); i += 4)
+		{
+			flat.pixels[i + 0] = 10 ;
+			flat.pixels[i + 1] = 100 ;
+			flat.pixels[i + 2] = 200 ;
+			flat.pixels[i + 3] = 255 ;
+		}
+		DecodedImage larger ;
+		DecodedImage smaller ;
+		ResizeImage(flat, 101, 70, larger, (RESAMPLE_FILTER)filter) ;
+		ResizeImage(flat, 9, 5, smaller, (RESAMPLE_FILTER)filter) ;
+		bool same = larger.width == 101 && smaller.height == 5 ;
+		for (size_t i = 0; i < larger.pixels.size() && same; ++i)
+		{
+			same = larger.pixels[i] == flat.pixels[i & 3] ;
+		}
+		for (size_t i = 0; i < smaller.pixels.size() && same; ++i)
+		{
+			same = smaller.pixels[i] == flat.pixels[i & 3] ;
+		}
+		Check(same, "scaling keeps a flat colour") ;
+	}
+}
+
+int main()
+{
+	if (!WritePicture())
+	{
+		printf("Cannot write %s\n", BENCH_FILE) ;
+		return 1 ;
+	}
+
+	printf("%dx%d picture, %d frames\n\n", PICTURE_WIDTH, PICTURE_HEIGHT, FRAMES) ;
+
+	ImageKey key(BENCH_FILE, PICTURE_WIDTH, PICTURE_HEIGHT, PIXEL_PBGRA) ;
+	double uncachedMs = BenchmarkUncached(key) ;
+	double cachedMs = BenchmarkCached(key) ;
+	if (cachedMs > 0)
+	{
+		printf("\nspeedup %.1fx\n", uncachedMs / cachedMs) ;
+	}
+
+	TestCacheBehaviour() ;
+
+	remove(BENCH_FILE) ;
+
+	printf("\nDecode pipeline, best of %d runs, MB/s of decoded 32 bit pixels\n\n", STAGE_REPEATS) ;
+	BenchmarkDecoders() ;
+	TestDamagedJpeg() ;
+	BenchmarkConversions() ;
+	BenchmarkResize() ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,331 @@
+/*
+Benchmark and self check for the buffered input in Common/Input.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 -pthread InputBenchmark.cpp ../../Input/InputQueue.cpp ../../Input/InputReplay.cpp -o InputBenchmark
+
+Checks that a tap shorter than a step shows as pressed and released where a snapshot
+of the key state taken once per step misses it, that edges last one step, that
+BeginStep with a time leaves later events queued, the ring wrapping and dropping when
+full and with a writer thread, releasing everything when the focus goes, the mouse
+motion from positions, and that a recorded session saved, loaded and fed back gives
+the same state in every step. Then measures how many events per second go through the
+queue and the state. Exits with a non-zero code if a check fails.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "../../Input/InputQueue.h"
+#include "../../Input/InputReplay.h"
+#include "../../Utility/Timer.h"
+
+static const int KEY_SPACE = 0x39 ;		// DIK_SPACE
+static const int KEY_A = 0x1E ;			// DIK_A
+static const int KEY_W = 0x11 ;			// DIK_W
+
+static const double STEP_MS = 1000.0 / 60.0 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static long long MsToTicks(double ms)
+{
+	return (long long)(ms * TimerFrequency() / 1000.0 + 0.5) ;
+}
+
+static InputEvent MakeEvent(double ms, int type, int code, int x = 0, int y = 0)
+{
+	InputEvent event ;
+	event.ticks = MsToTicks(ms) ;
+	event.type = type ;
+	event.code = code ;
+	event.x = x ;
+	event.y = y ;
+	return event ;
+}
+
+static void CheckTaps()
+{
+	// Down and up 5 ms apart inside one step
+	InputQueue queue ;
+	InputState state ;
+	queue.Push(MakeEvent(3.0, INPUT_KEY_DOWN, KEY_SPACE)) ;
+	queue.Push(MakeEvent(8.0, INPUT_KEY_UP, KEY_SPACE)) ;
+	state.BeginStep(queue) ;
+	Check(state.KeyPressed(KEY_SPACE) && state.KeyReleased(KEY_SPACE), "short tap pressed and released") ;
+	Check(state.PressedCount() == 1 && state.PressedKey(0) == KEY_SPACE, "short tap in the pressed keys") ;
+
+	// Polling the key state once per step only saw the end of it
+	Check(!state.KeyDown(KEY_SPACE), "polling misses the tap") ;
+
+	// Edges last one step, a held key stays down
+	queue.Push(MakeEvent(20.0, INPUT_KEY_DOWN, KEY_W)) ;
+	state.BeginStep(queue) ;
+	Check(!state.KeyPressed(KEY_SPACE) && !state.KeyReleased(KEY_SPACE), "edges cleared next step") ;
+	Check(state.KeyPressed(KEY_W) && state.KeyDown(KEY_W), "held key pressed") ;
+	state.BeginStep(queue) ;
+	Check(!state.KeyPressed(KEY_W) && state.KeyDown(KEY_W), "held key stays down") ;
+	Check(state.PressedCount() == 0, "no keys pressed in a quiet step") ;
+
+	// Two taps of the same key in one step, both counted
+	queue.Push(MakeEvent(40.0, INPUT_KEY_DOWN, KEY_A)) ;
+	queue.Push(MakeEvent(42.0, INPUT_KEY_UP, KEY_A)) ;
+	queue.Push(MakeEvent(44.0, INPUT_KEY_DOWN, KEY_A)) ;
+	state.BeginStep(queue) ;
+	Check(state.PressedCount() == 2 && state.KeyDown(KEY_A), "repeated taps counted") ;
+
+	// Buttons have edges too
+	queue.Push(MakeEvent(50.0, INPUT_BUTTON_DOWN, 0)) ;
+	queue.Push(MakeEvent(51.0, INPUT_BUTTON_UP, 0)) ;
+	state.BeginStep(queue) ;
+	Check(state.ButtonPressed(0) && state.ButtonReleased(0) && !state.ButtonDown(0), "short click") ;
+}
+
+static void CheckStepSplit()
+{
+	// Events after the end of the step wait for the next one
+	InputQueue queue ;
+	InputState state ;
+	queue.Push(MakeEvent(10.0, INPUT_KEY_DOWN, KEY_A)) ;
+	queue.Push(MakeEvent(20.0, INPUT_KEY_UP, KEY_A)) ;
+	state.BeginStep(queue, MsToTicks(STEP_MS)) ;
+	Check(state.KeyPressed(KEY_A) && state.KeyDown(KEY_A), "first step sees the down") ;
+	Check(queue.Count() == 1, "up left in the queue") ;
+	state.BeginStep(queue, MsToTicks(2.0 * STEP_MS)) ;
+	Check(state.KeyReleased(KEY_A) && !state.KeyDown(KEY_A), "second step sees the up") ;
+}
+
+static void CheckRing()
+{
+	InputQueue queue(5) ;
+	Check(queue.Capacity() == 8, "capacity rounded to a power of two") ;
+
+	// Wrap several times, the order must hold
+	InputEvent event ;
+	int next = 0 ;
+	bool ordered = true ;
+	for (int i = 0; i < 100; ++i)
+	{
+		queue.Push(MakeEvent(i, INPUT_KEY_DOWN, i & 0xFF)) ;
+		if (i % 3 != 0)
+		{
+			while (queue.Pop(event))
+			{
+				ordered = ordered && event.code == (next++ & 0xFF) ;
+			}
+		}
+	}
+	while (queue.Pop(event))
+	{
+		ordered = ordered && event.code == (next++ & 0xFF) ;
+	}
+	Check(ordered && next == 100, "ring keeps the order when it wraps") ;
+
+	for (int i = 0; i < 10; ++i)
+	{
+		queue.Push(MakeEvent(i, INPUT_KEY_DOWN, i)) ;
+	}
+	Check(queue.Count() == queue.Capacity() && queue.Dropped() == 2, "full ring drops and counts") ;
+	Check(queue.Peek(event) && event.code == 0, "oldest events kept") ;
+	queue.Clear() ;
+	Check(queue.Count() == 0, "clear empties the ring") ;
+}
+
+static void CheckThreads()
+{
+	// A writer thread like the window thread, the reader like the simulation
+	static const int EVENTS = 200000 ;
+	InputQueue queue(256) ;
+	std::thread writer([&]()
+	{
+		for (int i = 0; i < EVENTS; ++i)
+		{
+			InputEvent event = MakeEvent(0.0, INPUT_MOUSE_MOVE, 0, i, 1) ;
+			while (!queue.Push(event))
+			{
+				std::this_thread::yield() ;
+			}
+		}
+	}) ;
+
+	int received = 0 ;
+	bool ordered = true ;
+	InputEvent event ;
+	while (received < EVENTS)
+	{
+		if (queue.Pop(event))
+		{
+			ordered = ordered && event.x == received ;
+			++received ;
+		}
+		else
+		{
+			std::this_thread::yield() ;
+		}
+	}
+	writer.join() ;
+	Check(ordered && queue.Count() == 0, "events from a writer thread arrive in order") ;
+}
+
+static void CheckReleaseAll()
+{
+	InputQueue queue ;
+	InputState state ;
+	queue.Push(MakeEvent(1.0, INPUT_KEY_DOWN, KEY_W)) ;
+	queue.Push(MakeEvent(1.0, INPUT_KEY_DOWN, KEY_A)) ;
+	queue.Push(MakeEvent(1.0, INPUT_BUTTON_DOWN, 1)) ;
+	state.BeginStep(queue) ;
+
+	queue.Push(MakeEvent(20.0, INPUT_RELEASE_ALL, 0)) ;
+	state.BeginStep(queue) ;
+	Check(!state.KeyDown(KEY_W) && !state.KeyDown(KEY_A) && !state.ButtonDown(1), "focus loss releases everything") ;
+	Check(state.KeyReleased(KEY_W) && state.ButtonReleased(1), "focus loss shows as released") ;
+}
+
+static void CheckMouse()
+{
+	InputQueue queue ;
+	InputState state ;
+	queue.Push(MakeEvent(1.0, INPUT_MOUSE_POSITION, 0, 100, 100)) ;
+	state.BeginStep(queue) ;
+	Check(state.MouseDX() == 0 && state.MouseDY() == 0, "first position is no motion") ;
+
+	queue.Push(MakeEvent(20.0, INPUT_MOUSE_POSITION, 0, 104, 97)) ;
+	queue.Push(MakeEvent(25.0, INPUT_MOUSE_POSITION, 0, 110, 90)) ;
+	queue.Push(MakeEvent(26.0, INPUT_MOUSE_MOVE, 0, 2, 3)) ;
+	queue.Push(MakeEvent(27.0, INPUT_WHEEL, 0, -120)) ;
+	state.BeginStep(queue) ;
+	Check(state.MouseDX() == 12 && state.MouseDY() == -7, "motion adds positions and moves") ;
+	Check(state.MouseX() == 110 && state.MouseY() == 90, "last position kept") ;
+	Check(state.Wheel() == -120, "wheel delta") ;
+
+	state.BeginStep(queue) ;
+	Check(state.MouseDX() == 0 && state.Wheel() == 0, "motion cleared next step") ;
+}
+
+// Everything a step saw, to compare two runs
+static unsigned int StepHash(const InputState& state)
+{
+	unsigned int hash = 2166136261u ;
+	for (int key = 0; key < 256; ++key)
+	{
+		int bits = (state.KeyDown(key) ? 1 : 0) | (state.KeyPressed(key) ? 2 : 0) | (state.KeyReleased(key) ? 4 : 0) ;
+		hash = (hash ^ bits) * 16777619u ;
+	}
+	int values[5] = { state.MouseDX(), state.MouseDY(), state.Wheel(), state.PressedCount(), state.ButtonDown(0) } ;
+	for (int i = 0; i < 5; ++i)
+	{
+		hash = (hash ^ (unsigned int)values[i]) * 16777619u ;
+	}
+	return hash ;
+}
+
+static void CheckReplay()
+{
+	static const int STEPS = 600 ;
+
+	// A random session of keys, clicks and motion, applied step by step while recording
+	srand(7) ;
+	InputQueue queue(4096) ;
+	InputState state ;
+	InputReplay recording ;
+	recording.StartRecording(0) ;
+	state.SetRecorder(&recording) ;
+
+	std::vector<unsigned int> hashes ;
+	double ms = 0.0 ;
+	for (int step = 1; step <= STEPS; ++step)
+	{
+		long long end = MsToTicks(step * STEP_MS) ;
+		while (MsToTicks(ms) <= end)
+		{
+			int r = rand() % 8 ;
+			int type = r < 2 ? INPUT_KEY_DOWN : r < 4 ? INPUT_KEY_UP : r < 5 ? INPUT_BUTTON_DOWN :
+					   r < 6 ? INPUT_BUTTON_UP : INPUT_MOUSE_MOVE ;
+			queue.Push(MakeEvent(ms, type, r < 4 ? 0x10 + rand() % 16 : rand() % 3, rand() % 21 - 10, rand() % 21 - 10)) ;
+			ms += 1.0 + rand() % 12 ;
+		}
+		state.BeginStep(queue, end) ;
+		hashes.push_back(StepHash(state)) ;
+	}
+	state.SetRecorder(NULL) ;
+
+	const char* path = "InputBenchmark.inp" ;
+	InputReplay loaded ;
+	Check(recording.Count() > 1000 && recording.Save(path), "recording saved") ;
+	Check(loaded.Load(path) && loaded.Count() == recording.Count(), "recording loaded") ;
+	remove(path) ;
+
+	// Fed back at another start time, every step must see the same
+	InputQueue replayQueue(4096) ;
+	InputState replayed ;
+	long long start = MsToTicks(12345.0) ;
+	int same = 0 ;
+	for (int step = 1; step <= STEPS; ++step)
+	{
+		long long elapsed = MsToTicks(step * STEP_MS) ;
+		loaded.Feed(replayQueue, start, elapsed) ;
+		replayed.BeginStep(replayQueue, start + elapsed) ;
+		same += StepHash(replayed) == hashes[step - 1] ? 1 : 0 ;
+	}
+	printf("replay: %u events, %d of %d steps identical\n", (unsigned int)loaded.Count(), same, STEPS) ;
+	Check(same == STEPS, "replay gives the same steps") ;
+	Check(!loaded.Feed(replayQueue, start, MsToTicks(STEPS * STEP_MS)), "replay finished") ;
+}
+
+static void MeasureThroughput()
+{
+	static const int ROUNDS = 20000 ;
+	static const int PER_STEP = 64 ;
+
+	InputQueue queue ;
+	InputState state ;
+	unsigned int checksum = 0 ;
+	Timer timer ;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		for (int i = 0; i < PER_STEP; ++i)
+		{
+			int type = (i & 3) == 3 ? INPUT_MOUSE_MOVE : ((i & 1) ? INPUT_KEY_UP : INPUT_KEY_DOWN) ;
+			queue.Push(MakeEvent(0.0, type, (round + i) & 0xFF, 1, -1)) ;
+		}
+		state.BeginStep(queue) ;
+		checksum += state.PressedCount() + state.MouseDX() ;
+	}
+	double ms = timer.ElapsedMs() ;
+	double events = (double)ROUNDS * PER_STEP ;
+	printf("throughput: %.1f M events/s, %.1f ns per event (checksum %u)\n", events / ms / 1000.0, ms * 1e6 / events, checksum) ;
+	Check(queue.Count() == 0, "every event applied") ;
+}
+
+int main()
+{
+	CheckTaps() ;
+	CheckStepSplit() ;
+	CheckRing() ;
+	CheckThreads() ;
+	CheckReleaseAll() ;
+	CheckMouse() ;
+	CheckReplay() ;
+	MeasureThroughput() ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,560 @@
+/*
+Benchmark and self check for the math library in Common/Math.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 MathBenchmark.cpp -o MathBenchmark
+
+D3DX is only there on Windows, so the routines the demos used are transcribed here the
+way D3DX and the old per demo Math.h computed them: D3DXVec3TransformCoord and
+D3DXPlaneDotCoord a point at a time through pointers, and RayRectIntersection building
+two Triangles and calling RayTriangleIntersection with pointers to them.
+
+Checks the matrix, quaternion and plane functions against those references and each
+other, that the array loops give the results of the single point functions, that the
+box plane test agrees with testing the eight corners and that RayTriangle hits what the
+old routine hit. Then reports millions of points transformed, plane distances and ray
+quad tests per second for the old routines and the library. Exits with a non-zero code
+if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../../Math/Geometry.h"
+#include "../../Math/Quaternion.h"
+#include "../../Utility/Timer.h"
+
+static const int POINT_COUNT = 4096 ;
+static const int TRANSFORM_ROUNDS = 2000 ;
+static const int RAY_COUNT = 200000 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / (float)RAND_MAX ;
+}
+
+static Vec3 RandomVec3(float range)
+{
+	return Vec3(Random(-range, range), Random(-range, range), Random(-range, range)) ;
+}
+
+static bool Near(float a, float b, float tolerance)
+{
+	return fabsf(a - b) <= tolerance * (1.0f + fabsf(a) + fabsf(b)) ;
+}
+
+static bool NearVec3(const Vec3& a, const Vec3& b, float tolerance)
+{
+	return Near(a.x, b.x, tolerance) && Near(a.y, b.y, tolerance) && Near(a.z, b.z, tolerance) ;
+}
+
+static bool NearMat4(const Mat4& a, const Mat4& b, float tolerance)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		if (!Near((&a.m[0][0])[i], (&b.m[0][0])[i], tolerance))
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+// The D3DX types and functions as the demos used them
+struct RefVector3
+{
+	float x, y, z ;
+
+	RefVector3() {}
+	RefVector3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+	RefVector3 operator+(const RefVector3& v) const { return RefVector3(x + v.x, y + v.y, z + v.z) ; }
+	RefVector3 operator-(const RefVector3& v) const { return RefVector3(x - v.x, y - v.y, z - v.z) ; }
+} ;
+
+static RefVector3 operator*(float s, const RefVector3& v)
+{
+	return RefVector3(s * v.x, s * v.y, s * v.z) ;
+}
+
+struct RefPlane
+{
+	float a, b, c, d ;
+} ;
+
+static RefVector3* RefVec3TransformCoord(RefVector3* pOut, const RefVector3* pV, const Mat4* pM)
+{
+	const float (*m)[4] = pM->m ;
+	float w = pV->x * m[0][3] + pV->y * m[1][3] + pV->z * m[2][3] + m[3][3] ;
+	RefVector3 r(pV->x * m[0][0] + pV->y * m[1][0] + pV->z * m[2][0] + m[3][0],
+				 pV->x * m[0][1] + pV->y * m[1][1] + pV->z * m[2][1] + m[3][1],
+				 pV->x * m[0][2] + pV->y * m[1][2] + pV->z * m[2][2] + m[3][2]) ;
+	pOut->x = r.x / w ;
+	pOut->y = r.y / w ;
+	pOut->z = r.z / w ;
+	return pOut ;
+}
+
+static float RefPlaneDotCoord(const RefPlane* pP, const RefVector3* pV)
+{
+	return pP->a * pV->x + pP->b * pV->y + pP->c * pV->z + pP->d ;
+}
+
+static RefVector3* RefVec3Cross(RefVector3* pOut, const RefVector3* a, const RefVector3* b)
+{
+	RefVector3 r(a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z, a->x * b->y - a->y * b->x) ;
+	*pOut = r ;
+	return pOut ;
+}
+
+static float RefVec3Dot(const RefVector3* a, const RefVector3* b)
+{
+	return a->x * b->x + a->y * b->y + a->z * b->z ;
+}
+
+struct RefTriangle
+{
+	RefVector3 v1, v2, v3 ;
+
+	RefTriangle(RefVector3 v1, RefVector3 v2, RefVector3 v3) : v1(v1), v2(v2), v3(v3) {}
+} ;
+
+struct RefRect
+{
+	RefVector3 v1, v2, v3, v4 ;
+} ;
+
+struct RefRay
+{
+	RefVector3 origin, direction ;
+} ;
+
+// RayTriangleIntersection of the demo Math.h
+static bool RefRayTriangleIntersection(RefRay* ray, RefTriangle* triangle, RefVector3* hit_point)
+{
+	RefVector3 orig = ray->origin ;
+	RefVector3 dir = ray->direction ;
+	RefVector3 v0 = triangle->v1 ;
+	RefVector3 v1 = triangle->v2 ;
+	RefVector3 v2 = triangle->v3 ;
+
+	RefVector3 E1 = v1 - v0 ;
+	RefVector3 E2 = v2 - v0 ;
+	RefVector3 P ;
+	RefVec3Cross(&P, &dir, &E2) ;
+	float det = RefVec3Dot(&E1, &P) ;
+
+	RefVector3 T ;
+	if (det > 0)
+	{
+		T = orig - v0 ;
+	}
+	else
+	{
+		T = v0 - orig ;
+		det = -det ;
+	}
+	if (det < 0.0001f)
+	{
+		return false ;
+	}
+
+	float u = RefVec3Dot(&T, &P) ;
+	if (u < 0.0f || u > det)
+	{
+		return false ;
+	}
+
+	RefVector3 Q ;
+	RefVec3Cross(&Q, &T, &E1) ;
+	float v = RefVec3Dot(&dir, &Q) ;
+	if (v < 0.0f || u + v > det)
+	{
+		return false ;
+	}
+
+	float t = RefVec3Dot(&E2, &Q) / det ;
+	*hit_point = orig + (t * dir) ;
+	return true ;
+}
+
+// RayRectIntersection of the demo Math.h
+static bool RefRayRectIntersection(RefRay& ray, RefRect& rect, RefVector3& hit_point)
+{
+	RefTriangle t1(rect.v1, rect.v2, rect.v3) ;
+	RefTriangle t2(rect.v1, rect.v3, rect.v4) ;
+	return RefRayTriangleIntersection(&ray, &t1, &hit_point) || RefRayTriangleIntersection(&ray, &t2, &hit_point) ;
+}
+
+static Mat4 RandomWorld()
+{
+	return Mat4Scaling(Random(0.5f, 2.0f), Random(0.5f, 2.0f), Random(0.5f, 2.0f)) *
+		   Mat4RotationAxis(RandomVec3(1.0f), Random(-MATH_PI, MATH_PI)) *
+		   Mat4Translation(Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f)) ;
+}
+
+// World, view and projection, what the vertices go through
+static Mat4 RandomTransform()
+{
+	Mat4 world = RandomWorld() ;
+	Mat4 view = Mat4LookAtLH(Vec3(0.0f, 5.0f, -40.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)) ;
+	return world * view * Mat4PerspectiveFovLH(MATH_PI / 4.0f, 4.0f / 3.0f, 1.0f, 1000.0f) ;
+}
+
+static void CheckMatrices()
+{
+	for (int n = 0; n < 100; ++n)
+	{
+		Mat4 a = RandomTransform() ;
+		Mat4 b = Mat4RotationX(Random(-3.0f, 3.0f)) * Mat4Translation(1.0f, 2.0f, 3.0f) ;
+
+		// Row by column, the plain way
+		Mat4 product = a * b ;
+		Mat4 expected ;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				expected.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j] ;
+			}
+		}
+		Check(NearMat4(product, expected, 1e-6f), "Mat4Multiply") ;
+
+		Mat4 world = RandomWorld() ;
+		Mat4 inverse ;
+		Check(Mat4Inverse(world, inverse) && NearMat4(world * inverse, Mat4Identity(), 1e-5f), "Mat4Inverse") ;
+
+		// The projection loses digits, go back from the screen to the point instead
+		Vec3 point = RandomVec3(10.0f) ;
+		Check(Mat4Inverse(a, inverse) && NearVec3(Vec3TransformCoord(Vec3TransformCoord(point, a), inverse), point, 1e-3f), "Mat4Inverse of a projection") ;
+		Check(NearMat4(Mat4Transpose(Mat4Transpose(a)), a, 0.0f), "Mat4Transpose") ;
+
+		Vec3 axis = RandomVec3(1.0f) ;
+		float angle = Random(-MATH_PI, MATH_PI) ;
+		Quat q = QuatRotationAxis(axis, angle) ;
+		Check(NearMat4(Mat4RotationQuat(q), Mat4RotationAxis(axis, angle), 1e-5f), "quaternion and axis rotation") ;
+
+		Vec3 v = RandomVec3(5.0f) ;
+		Check(NearVec3(Vec3Rotate(v, q), Vec3TransformNormal(v, Mat4RotationQuat(q)), 1e-5f), "Vec3Rotate") ;
+
+		Quat r = QuatRotationAxis(RandomVec3(1.0f), Random(-MATH_PI, MATH_PI)) ;
+		Check(NearMat4(Mat4RotationQuat(QuatMultiply(q, r)), Mat4RotationQuat(q) * Mat4RotationQuat(r), 1e-5f), "QuatMultiply order") ;
+
+		Quat half = QuatSlerp(QuatIdentity(), q, 0.5f) ;
+		Check(NearMat4(Mat4RotationQuat(half), Mat4RotationAxis(axis, angle * 0.5f), 1e-4f), "QuatSlerp") ;
+	}
+
+	Mat4 unused ;
+	Check(!Mat4Inverse(Mat4Scaling(1.0f, 0.0f, 1.0f), unused), "singular matrix") ;
+	Check(NearMat4(Mat4RotationAxis(Vec3(1.0f, 0.0f, 0.0f), 0.7f), Mat4RotationX(0.7f), 1e-6f), "axis rotation about x") ;
+	Check(NearMat4(Mat4RotationAxis(Vec3(0.0f, 1.0f, 0.0f), 0.7f), Mat4RotationY(0.7f), 1e-6f), "axis rotation about y") ;
+	Check(NearMat4(Mat4RotationAxis(Vec3(0.0f, 0.0f, 1.0f), 0.7f), Mat4RotationZ(0.7f), 1e-6f), "axis rotation about z") ;
+
+	// A point in front of the camera ends up in the unit depth range
+	Mat4 viewProjection = Mat4LookAtLH(Vec3(0.0f, 0.0f, -10.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)) *
+						  Mat4PerspectiveFovLH(MATH_PI / 2.0f, 1.0f, 1.0f, 100.0f) ;
+	Vec3 projected = Vec3TransformCoord(Vec3(0.0f, 0.0f, 0.0f), viewProjection) ;
+	Check(Near(projected.x, 0.0f, 1e-6f) && projected.z > 0.0f && projected.z < 1.0f, "look at and perspective") ;
+}
+
+static void CheckArrays(const std::vector<Vec3>& points)
+{
+	Mat4 m = RandomTransform() ;
+	std::vector<Vec3> out(points.size()) ;
+	Vec3TransformCoordArray(&points[0], &out[0], points.size(), m) ;
+
+	bool same = true ;
+	bool asReference = true ;
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		RefVector3 reference ;
+		RefVec3TransformCoord(&reference, (const RefVector3*)&points[i], &m) ;
+		same = same && NearVec3(out[i], Vec3TransformCoord(points[i], m), 1e-6f) ;
+		asReference = asReference && NearVec3(out[i], Vec3(reference.x, reference.y, reference.z), 1e-6f) ;
+	}
+	Check(same, "Vec3TransformCoordArray and Vec3TransformCoord") ;
+	Check(asReference, "Vec3TransformCoordArray and the D3DX formula") ;
+
+	// Odd counts and in place
+	std::vector<Vec3> inPlace(points.begin(), points.begin() + 7) ;
+	Vec3TransformCoordArray(&inPlace[0], &inPlace[0], inPlace.size(), m) ;
+	bool tail = true ;
+	for (size_t i = 0; i < inPlace.size(); ++i)
+	{
+		tail = tail && NearVec3(inPlace[i], out[i], 0.0f) ;
+	}
+	Check(tail, "in place with a tail") ;
+
+	Plane3 plane = PlaneFromPoints(RandomVec3(5.0f), RandomVec3(5.0f), RandomVec3(5.0f)) ;
+	std::vector<float> distances(points.size()) ;
+	PlaneDotCoordArray(plane, &points[0], points.size(), &distances[0]) ;
+	bool dots = true ;
+	for (size_t i = 0; i < points.size(); ++i)
+	{
+		dots = dots && Near(distances[i], RefPlaneDotCoord((const RefPlane*)&plane, (const RefVector3*)&points[i]), 1e-6f) ;
+	}
+	Check(dots, "PlaneDotCoordArray") ;
+	Check(Near(Vec3Length(PlaneNormalize(Plane3(0.0f, 3.0f, 4.0f, 1.0f)).Normal()), 1.0f, 1e-6f), "PlaneNormalize") ;
+
+	Aabb3 box = AabbFromPoints(&points[0], points.size() - 3) ;
+	Vec3 low = points[0], high = points[0] ;
+	for (size_t i = 1; i < points.size() - 3; ++i)
+	{
+		low = Vec3Min(low, points[i]) ;
+		high = Vec3Max(high, points[i]) ;
+	}
+	Check(box.minPoint == low && box.maxPoint == high, "AabbFromPoints") ;
+
+	// The box of a transformed box holds the transformed corners
+	Mat4 affine = Mat4RotationAxis(RandomVec3(1.0f), 1.0f) * Mat4Translation(3.0f, -2.0f, 1.0f) ;
+	Aabb3 moved = AabbTransform(box, affine) ;
+	bool inside = true ;
+	for (int i = 0; i < 8; ++i)
+	{
+		Vec3 corner = Vec3TransformCoord(box.Corner(i), affine) ;
+		inside = inside && corner.x >= moved.minPoint.x - 1e-4f && corner.x <= moved.maxPoint.x + 1e-4f &&
+				 corner.y >= moved.minPoint.y - 1e-4f && corner.y <= moved.maxPoint.y + 1e-4f &&
+				 corner.z >= moved.minPoint.z - 1e-4f && corner.z <= moved.maxPoint.z + 1e-4f ;
+	}
+	Check(inside, "AabbTransform") ;
+}
+
+static void CheckPlaneBox()
+{
+	// The two corner test against all eight corners, what PlaneBoxIntersection did
+	int disagree = 0 ;
+	for (int n = 0; n < 100000; ++n)
+	{
+		Vec3 a = RandomVec3(10.0f) ;
+		Vec3 b = RandomVec3(10.0f) ;
+		Aabb3 box(Vec3Min(a, b), Vec3Max(a, b)) ;
+		Plane3 plane = PlaneFromPointNormal(RandomVec3(10.0f), RandomVec3(1.0f)) ;
+
+		int sides = 0 ;
+		for (int i = 0; i < 8; ++i)
+		{
+			sides += PlaneDotCoord(plane, box.Corner(i)) > 0.0f ? 1 : -1 ;
+		}
+		int expected = sides == 8 ? 1 : (sides == -8 ? -1 : 0) ;
+		disagree += PlaneAabbSide(plane, box) != expected ? 1 : 0 ;
+	}
+
+	// Rounding may put a corner that touches the plane on the other side
+	Check(disagree < 5, "PlaneAabbSide and the eight corners") ;
+
+	float t = 0.0f ;
+	Aabb3 unit(Vec3(-1.0f, -1.0f, -1.0f), Vec3(1.0f, 1.0f, 1.0f)) ;
+	Check(RayAabb(Ray3(Vec3(0.0f, 0.0f, -5.0f), Vec3(0.0f, 0.0f, 1.0f)), unit, t) && Near(t, 4.0f, 1e-6f), "RayAabb hit") ;
+	Check(!RayAabb(Ray3(Vec3(0.0f, 3.0f, -5.0f), Vec3(0.0f, 0.0f, 1.0f)), unit, t), "RayAabb miss") ;
+	Check(!RayAabb(Ray3(Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f, 0.0f, 1.0f)), unit, t), "RayAabb behind") ;
+	Check(RayPlane(Ray3(Vec3(0.0f, 0.0f, -5.0f), Vec3(0.0f, 0.0f, 2.0f)), Plane3(0.0f, 0.0f, 1.0f, 0.0f), t) && Near(t, 2.5f, 1e-6f), "RayPlane") ;
+}
+
+struct Scene
+{
+	std::vector<RefRay> rays ;
+	std::vector<RefRect> rects ;
+} ;
+
+static Scene MakeScene()
+{
+	// Rays from a camera at the quads of a cube like the Rubik cube picking does
+	Scene scene ;
+	scene.rays.resize(RAY_COUNT) ;
+	scene.rects.resize(RAY_COUNT) ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		Vec3 center = RandomVec3(3.0f) ;
+		float size = Random(0.2f, 1.0f) ;
+		RefRect& rect = scene.rects[i] ;
+		rect.v1 = RefVector3(center.x - size, center.y + size, center.z) ;
+		rect.v2 = RefVector3(center.x + size, center.y + size, center.z) ;
+		rect.v3 = RefVector3(center.x + size, center.y - size, center.z) ;
+		rect.v4 = RefVector3(center.x - size, center.y - size, center.z) ;
+
+		Vec3 target = center + RandomVec3(size * 1.5f) ;
+		Vec3 origin(Random(-2.0f, 2.0f), Random(-2.0f, 2.0f), -20.0f) ;
+		Vec3 direction = Vec3Normalize(target - origin) ;
+		scene.rays[i].origin = RefVector3(origin.x, origin.y, origin.z) ;
+		scene.rays[i].direction = RefVector3(direction.x, direction.y, direction.z) ;
+	}
+	return scene ;
+}
+
+static const Vec3& AsVec3(const RefVector3& v)
+{
+	return reinterpret_cast<const Vec3&>(v) ;
+}
+
+static void CheckRays(Scene& scene)
+{
+	int hits = 0 ;
+	int disagree = 0 ;
+	bool points = true ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		RefVector3 reference ;
+		bool old = RefRayRectIntersection(scene.rays[i], scene.rects[i], reference) ;
+
+		const RefRect& rect = scene.rects[i] ;
+		Ray3 ray(AsVec3(scene.rays[i].origin), AsVec3(scene.rays[i].direction)) ;
+		float t = 0.0f ;
+		bool hit = RayQuad(ray, AsVec3(rect.v1), AsVec3(rect.v2), AsVec3(rect.v3), AsVec3(rect.v4), t) ;
+
+		hits += hit ? 1 : 0 ;
+		disagree += hit != old ? 1 : 0 ;
+		if (hit && old)
+		{
+			points = points && NearVec3(ray.Point(t), AsVec3(reference), 1e-4f) ;
+		}
+	}
+	printf("ray quad: %d of %d rays hit, %d disagree with the old routine\n", hits, RAY_COUNT, disagree) ;
+	Check(hits > RAY_COUNT / 4 && hits < RAY_COUNT, "a mix of hits and misses") ;
+
+	// Only rays through an edge may round the other way
+	Check(disagree < RAY_COUNT / 10000 + 2, "RayQuad hits what the old routine hit") ;
+	Check(points, "RayQuad hit points") ;
+
+	// The old routine also hit behind the origin
+	float t, u, v ;
+	Ray3 away(Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f, 0.0f, 1.0f)) ;
+	Check(!RayTriangle(away, Vec3(-1.0f, -1.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(1.0f, -1.0f, 0.0f), t, u, v), "no hits behind the ray") ;
+	Ray3 back(Vec3(0.0f, 0.0f, 5.0f), Vec3(0.0f, 0.0f, -1.0f)) ;
+	Check(RayTriangle(back, Vec3(-1.0f, -1.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(1.0f, -1.0f, 0.0f), t, u, v) && Near(t, 5.0f, 1e-6f), "back faces hit") ;
+}
+
+static volatile float g_Sink ;
+
+static void PrintRate(const char* name, double count, double ms, double baselineMs)
+{
+	printf("%-36s %10.1f %10.2fx\n", name, count / ms / 1000.0, baselineMs / ms) ;
+}
+
+static void Measure(const std::vector<Vec3>& points, Scene& scene)
+{
+	Mat4 m = RandomTransform() ;
+	std::vector<Vec3> out(points.size()) ;
+	std::vector<float> distances(points.size()) ;
+	double transforms = (double)TRANSFORM_ROUNDS * points.size() ;
+
+	printf("\n%-36s %10s %10s\n", "", "M/s", "speedup") ;
+
+	Timer timer ;
+	for (int round = 0; round < TRANSFORM_ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			RefVec3TransformCoord((RefVector3*)&out[i], (const RefVector3*)&points[i], &m) ;
+		}
+		g_Sink = out[round % points.size()].x ;
+	}
+	double baseline = timer.ElapsedMs() ;
+	PrintRate("transform, D3DX formula", transforms, baseline, baseline) ;
+
+	timer.Restart() ;
+	for (int round = 0; round < TRANSFORM_ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			out[i] = Vec3TransformCoord(points[i], m) ;
+		}
+		g_Sink = out[round % points.size()].x ;
+	}
+	PrintRate("transform, Vec3TransformCoord", transforms, timer.ElapsedMs(), baseline) ;
+
+	timer.Restart() ;
+	for (int round = 0; round < TRANSFORM_ROUNDS; ++round)
+	{
+		Vec3TransformCoordArray(&points[0], &out[0], points.size(), m) ;
+		g_Sink = out[round % points.size()].x ;
+	}
+	PrintRate("transform, Vec3TransformCoordArray", transforms, timer.ElapsedMs(), baseline) ;
+
+	Plane3 plane = PlaneFromPoints(Vec3(1.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f)) ;
+	timer.Restart() ;
+	for (int round = 0; round < TRANSFORM_ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			distances[i] = RefPlaneDotCoord((const RefPlane*)&plane, (const RefVector3*)&points[i]) ;
+		}
+		g_Sink = distances[round % points.size()] ;
+	}
+	baseline = timer.ElapsedMs() ;
+	PrintRate("plane dot, D3DX formula", transforms, baseline, baseline) ;
+
+	timer.Restart() ;
+	for (int round = 0; round < TRANSFORM_ROUNDS; ++round)
+	{
+		PlaneDotCoordArray(plane, &points[0], points.size(), &distances[0]) ;
+		g_Sink = distances[round % points.size()] ;
+	}
+	PrintRate("plane dot, PlaneDotCoordArray", transforms, timer.ElapsedMs(), baseline) ;
+
+	int hits = 0 ;
+	timer.Restart() ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		RefVector3 hit ;
+		hits += RefRayRectIntersection(scene.rays[i], scene.rects[i], hit) ? 1 : 0 ;
+	}
+	baseline = timer.ElapsedMs() ;
+	PrintRate("ray quad, old RayRectIntersection", RAY_COUNT, baseline, baseline) ;
+
+	timer.Restart() ;
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		const RefRect& rect = scene.rects[i] ;
+		Ray3 ray(AsVec3(scene.rays[i].origin), AsVec3(scene.rays[i].direction)) ;
+		float t ;
+		hits += RayQuad(ray, AsVec3(rect.v1), AsVec3(rect.v2), AsVec3(rect.v3), AsVec3(rect.v4), t) ? 1 : 0 ;
+	}
+	PrintRate("ray quad, RayQuad", RAY_COUNT, timer.ElapsedMs(), baseline) ;
+	g_Sink = (float)hits ;
+}
+
+int main()
+{
+	srand(11) ;
+	std::vector<Vec3> points(POINT_COUNT) ;
+	for (int i = 0; i < POINT_COUNT; ++i)
+	{
+		points[i] = RandomVec3(20.0f) ;
+	}
+	Scene scene = MakeScene() ;
+
+#if defined(SIMD_SSE2)
+	printf("backend: SSE2\n") ;
+#elif defined(SIMD_NEON)
+	printf("backend: NEON\n") ;
+#else
+	printf("backend: scalar\n") ;
+#endif
+
+	CheckMatrices() ;
+	CheckArrays(points) ;
+	CheckPlaneBox() ;
+	CheckRays(scene) ;
+	Measure(points, scene) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,423 @@
+/*
+Startup benchmark and self check for the mesh files in Common/Asset.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 MeshFileBenchmark.cpp ../../Asset/MeshFile.cpp ../../Asset/XFile.cpp ../../Math/MeshOptimizer.cpp ../../Utility/MappedFile.cpp -o MeshFileBenchmark
+
+Makes the meshes the demos make at startup: the terrain grid of Terrain::GenerateGrids
+at several sizes, a sphere with normals like D3DXCreateSphere, and a piece of the Rubik
+cube parsed from its .x file, found in DirectX9/RubikCube or the directory given as the
+argument. For each one it compares making the mesh and copying it into vertex and index
+buffers with opening its mesh file, and with opening it and filling the same buffers
+straight from the mapping.
+Checks that the file gives back the streams and bounds it was written with, that the
+meshlets hold every triangle once and within their limits, and that stale, cut and
+damaged files are refused. Exits with a non-zero code if a check fails.
+*/
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../../Asset/MeshFile.h"
+#include "../../Asset/XFile.h"
+#include "../../Utility/Timer.h"
+
+static const char* MESH_PATH = "MeshFileBenchmark.mesh" ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+struct Mesh
+{
+	std::vector<float> vertices ;
+	unsigned int stride ;				// in floats
+	std::vector<unsigned int> indices ;
+	unsigned long long key ;
+} ;
+
+// The grid of Terrain::GenerateGrids, centered, each vertex moved to the center
+static void GenerateGrids(int rows, int cols, float dx, float dz, const float center[3], Mesh& mesh)
+{
+	mesh.stride = 3 ;
+	mesh.vertices.resize(rows * cols * 3) ;
+	float xOffset = -(cols - 1) * dx * 0.5f ;
+	float zOffset = (rows - 1) * dz * 0.5f ;
+	for (int i = 0, k = 0; i < rows; ++i)
+	{
+		for (int j = 0; j < cols; ++j, k += 3)
+		{
+			mesh.vertices[k] = j * dx + xOffset + center[0] ;
+			mesh.vertices[k + 1] = center[1] ;
+			mesh.vertices[k + 2] = -i * dz + zOffset + center[2] ;
+		}
+	}
+
+	mesh.indices.resize((rows - 1) * (cols - 1) * 6) ;
+	for (int i = 0, k = 0; i < rows - 1; ++i)
+	{
+		for (int j = 0; j < cols - 1; ++j, k += 6)
+		{
+			mesh.indices[k] = i * cols + j ;
+			mesh.indices[k + 1] = i * cols + j + 1 ;
+			mesh.indices[k + 2] = (i + 1) * cols + j ;
+			mesh.indices[k + 3] = (i + 1) * cols + j ;
+			mesh.indices[k + 4] = i * cols + j + 1 ;
+			mesh.indices[k + 5] = (i + 1) * cols + j + 1 ;
+		}
+	}
+
+	float parameters[6] = { (float)rows, (float)cols, dx, dz, center[0], center[1] } ;
+	mesh.key = MeshFileKey(parameters, sizeof(parameters)) ;
+}
+
+// Position and normal, poles shared like D3DXCreateSphere does
+static void CreateSphere(float radius, int slices, int stacks, Mesh& mesh)
+{
+	mesh.stride = 6 ;
+	mesh.vertices.clear() ;
+	mesh.indices.clear() ;
+	float top[6] = { 0.0f, radius, 0.0f, 0.0f, 1.0f, 0.0f } ;
+	mesh.vertices.insert(mesh.vertices.end(), top, top + 6) ;
+	for (int stack = 1; stack < stacks; ++stack)
+	{
+		float phi = 3.14159265f * stack / stacks ;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			float theta = 6.2831853f * slice / slices ;
+			float n[3] = { sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) } ;
+			float v[6] = { n[0] * radius, n[1] * radius, n[2] * radius, n[0], n[1], n[2] } ;
+			mesh.vertices.insert(mesh.vertices.end(), v, v + 6) ;
+		}
+	}
+	float bottom[6] = { 0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f } ;
+	mesh.vertices.insert(mesh.vertices.end(), bottom, bottom + 6) ;
+
+	unsigned int last = (unsigned int)mesh.vertices.size() / 6 - 1 ;
+	for (int slice = 0; slice < slices; ++slice)
+	{
+		unsigned int next = (slice + 1) % slices ;
+		unsigned int fan[3] = { 0, 1 + next, 1 + (unsigned int)slice } ;
+		mesh.indices.insert(mesh.indices.end(), fan, fan + 3) ;
+		unsigned int base = 1 + (stacks - 2) * slices ;
+		unsigned int cap[3] = { last, base + slice, base + next } ;
+		mesh.indices.insert(mesh.indices.end(), cap, cap + 3) ;
+	}
+	for (int stack = 0; stack < stacks - 2; ++stack)
+	{
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			unsigned int a = 1 + stack * slices + slice ;
+			unsigned int b = 1 + stack * slices + (slice + 1) % slices ;
+			unsigned int quad[6] = { a, b, a + slices, b, b + slices, a + slices } ;
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6) ;
+		}
+	}
+
+	float parameters[3] = { radius, (float)slices, (float)stacks } ;
+	mesh.key = MeshFileKey(parameters, sizeof(parameters)) ;
+}
+
+static MeshFileSource Source(const Mesh& mesh, bool meshlets)
+{
+	MeshFileSource source ;
+	source.vertices = &mesh.vertices[0] ;
+	source.vertexStride = mesh.stride * sizeof(float) ;
+	source.vertexCount = (unsigned int)(mesh.vertices.size() / mesh.stride) ;
+	source.indices = &mesh.indices[0] ;
+	source.indexSize = sizeof(unsigned int) ;
+	source.indexCount = (unsigned int)mesh.indices.size() ;
+	source.sourceKey = mesh.key ;
+	source.meshlets = meshlets ;
+	return source ;
+}
+
+// The meshlets hold every triangle of the index list once, in order
+static bool MeshletsCoverTriangles(const MeshFile& file, const Mesh& mesh)
+{
+	const MeshFileHeader& header = file.Header() ;
+	if (header.meshletTriangleCount * 3 != mesh.indices.size())
+	{
+		return false ;
+	}
+
+	size_t next = 0 ;
+	for (unsigned int i = 0; i < header.meshletCount; ++i)
+	{
+		const MeshFileMeshlet& meshlet = file.Meshlets()[i] ;
+		if (meshlet.triangleOffset * 3 != next || meshlet.vertexCount == 0)
+		{
+			return false ;
+		}
+		for (unsigned int j = 0; j < meshlet.triangleCount * 3; ++j, ++next)
+		{
+			unsigned int local = file.MeshletTriangles()[meshlet.triangleOffset * 3 + j] ;
+			if (file.MeshletVertices()[meshlet.vertexOffset + local] != mesh.indices[next])
+			{
+				return false ;
+			}
+		}
+
+		// Every vertex inside the bounding sphere
+		for (unsigned int j = 0; j < meshlet.vertexCount; ++j)
+		{
+			const float* p = &mesh.vertices[file.MeshletVertices()[meshlet.vertexOffset + j] * mesh.stride] ;
+			float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2] ;
+			if (sqrtf(dx * dx + dy * dy + dz * dz) > meshlet.radius * 1.0001f + 1e-6f)
+			{
+				return false ;
+			}
+		}
+	}
+	return next == mesh.indices.size() ;
+}
+
+static void CheckRoundTrip(const Mesh& mesh)
+{
+	Check(WriteMeshFile(MESH_PATH, Source(mesh, true)), "WriteMeshFile") ;
+
+	MeshFile file ;
+	Check(file.Open(MESH_PATH, mesh.key), "Open") ;
+	if (!file.IsOpen())
+	{
+		return ;
+	}
+
+	const MeshFileHeader& header = file.Header() ;
+	Check(header.vertexCount * mesh.stride == mesh.vertices.size() && header.indexCount == mesh.indices.size(), "counts") ;
+	Check(memcmp(file.Vertices(), &mesh.vertices[0], file.VertexBytes()) == 0, "the vertices") ;
+	Check(memcmp(file.Indices(), &mesh.indices[0], file.IndexBytes()) == 0, "the indices") ;
+	Check(((size_t)file.Vertices() % MESH_FILE_ALIGNMENT) == 0 && ((size_t)file.Indices() % MESH_FILE_ALIGNMENT) == 0, "aligned streams") ;
+
+	float low[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, high[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX } ;
+	for (size_t i = 0; i < mesh.vertices.size(); i += mesh.stride)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			low[j] = std::min(low[j], mesh.vertices[i + j]) ;
+			high[j] = std::max(high[j], mesh.vertices[i + j]) ;
+		}
+	}
+	Check(memcmp(low, header.boundsMin, sizeof(low)) == 0 && memcmp(high, header.boundsMax, sizeof(high)) == 0, "the bounds") ;
+
+	Check(header.meshletCount > 0 && file.Verify(), "Verify") ;
+	Check(MeshletsCoverTriangles(file, mesh), "the meshlets hold every triangle") ;
+	file.Close() ;
+
+	Check(!file.Open(MESH_PATH, mesh.key + 1) && file.Error() == MESH_FILE_STALE, "a file for another source is stale") ;
+	remove(MESH_PATH) ;
+	Check(!file.Open(MESH_PATH, mesh.key) && file.Error() == MESH_FILE_CANNOT_OPEN, "a missing file") ;
+}
+
+static void CheckDamage(const Mesh& mesh)
+{
+	std::vector<unsigned char> data ;
+	Check(BuildMeshFile(Source(mesh, true), data), "BuildMeshFile") ;
+
+	MeshFile file ;
+	Check(file.OpenMemory(&data[0], data.size(), mesh.key), "OpenMemory") ;
+	Check(!file.OpenMemory(&data[0], data.size() - 1, mesh.key) && file.Error() == MESH_FILE_BAD_LAYOUT, "a cut file") ;
+	Check(!file.OpenMemory(&data[0], sizeof(MeshFileHeader) - 1, mesh.key) && file.Error() == MESH_FILE_NOT_MESH, "a cut header") ;
+
+	std::vector<unsigned char> damaged = data ;
+	damaged[0] ^= 1 ;
+	Check(!file.OpenMemory(&damaged[0], damaged.size(), mesh.key) && file.Error() == MESH_FILE_NOT_MESH, "a wrong magic") ;
+
+	damaged = data ;
+	((MeshFileHeader*)&damaged[0])->indexOffset += 4 ;
+	Check(!file.OpenMemory(&damaged[0], damaged.size(), mesh.key) && file.Error() == MESH_FILE_BAD_LAYOUT, "a misaligned stream") ;
+
+	damaged = data ;
+	((MeshFileHeader*)&damaged[0])->vertexCount = 0x7fffffff ;
+	Check(!file.OpenMemory(&damaged[0], damaged.size(), mesh.key), "a stream past the end") ;
+
+	// Open trusts the streams, Verify does not
+	MeshFileHeader header ;
+	memcpy(&header, &data[0], sizeof(header)) ;
+	damaged = data ;
+	memcpy(&damaged[(size_t)header.indexOffset + 8], &header.vertexCount, 4) ;
+	Check(file.OpenMemory(&damaged[0], damaged.size(), mesh.key) && !file.Verify(), "Verify finds a bad index") ;
+
+	damaged = data ;
+	damaged[(size_t)header.meshletTriangleOffset] = MESHLET_MAX_VERTICES ;
+	Check(file.OpenMemory(&damaged[0], damaged.size(), mesh.key) && !file.Verify(), "Verify finds a bad meshlet") ;
+
+	// Sources that are not triangle lists
+	MeshFileSource source = Source(mesh, false) ;
+	source.indexCount -= 1 ;
+	Check(!BuildMeshFile(source, data), "an index count that is not triangles") ;
+	source = Source(mesh, false) ;
+	source.vertexCount -= 1 ;
+	Check(!BuildMeshFile(source, data), "an index past the vertices") ;
+	source = Source(mesh, false) ;
+	source.vertexStride = 8 ;
+	Check(!BuildMeshFile(source, data), "a vertex without a position") ;
+
+	// 16 bit indices
+	std::vector<unsigned short> shorts(mesh.indices.begin(), mesh.indices.end()) ;
+	source = Source(mesh, true) ;
+	source.indices = &shorts[0] ;
+	source.indexSize = 2 ;
+	Check(BuildMeshFile(source, data) && file.OpenMemory(&data[0], data.size(), mesh.key) && file.Verify() &&
+		  memcmp(file.Indices(), &shorts[0], shorts.size() * 2) == 0, "16 bit indices") ;
+}
+
+/*
+Making the mesh against loading it, best of a few runs so the file is in the OS cache,
+which is the case at every start but the first after a build.
+*/
+template <class Generate>
+static void Measure(const char* name, Generate generate)
+{
+	const int repeats = 5 ;
+	Mesh mesh ;
+	generate(mesh) ;
+	std::vector<unsigned char> vertexBuffer(mesh.vertices.size() * sizeof(float)) ;
+	std::vector<unsigned char> indexBuffer(mesh.indices.size() * sizeof(unsigned int)) ;
+
+	// Make the mesh and fill the buffers, what a demo does at every start now
+	double generateMs = DBL_MAX ;
+	for (int i = 0; i < repeats; ++i)
+	{
+		Timer timer ;
+		generate(mesh) ;
+		memcpy(&vertexBuffer[0], &mesh.vertices[0], vertexBuffer.size()) ;
+		memcpy(&indexBuffer[0], &mesh.indices[0], indexBuffer.size()) ;
+		generateMs = std::min(generateMs, timer.ElapsedMs()) ;
+	}
+
+	Timer timer ;
+	bool written = WriteMeshFile(MESH_PATH, Source(mesh, false)) ;
+	double writeMs = timer.ElapsedMs() ;
+	Check(written, "writing the mesh file") ;
+
+	double openMs = DBL_MAX, copyMs = DBL_MAX ;
+	memset(&indexBuffer[0], 0, indexBuffer.size()) ;
+	for (int i = 0; i < repeats; ++i)
+	{
+		MeshFile file ;
+		timer.Restart() ;
+		bool opened = file.Open(MESH_PATH, mesh.key) ;
+		openMs = std::min(openMs, timer.ElapsedMs()) ;
+		Check(opened, "opening the mesh file") ;
+		file.Close() ;
+
+		// Open and fill the buffers, what a demo does instead of generating
+		timer.Restart() ;
+		opened = file.Open(MESH_PATH, mesh.key) ;
+		if (opened)
+		{
+			memcpy(&vertexBuffer[0], file.Vertices(), file.VertexBytes()) ;
+			memcpy(&indexBuffer[0], file.Indices(), file.IndexBytes()) ;
+		}
+		copyMs = std::min(copyMs, timer.ElapsedMs()) ;
+	}
+	remove(MESH_PATH) ;
+	Check(memcmp(&indexBuffer[0], &mesh.indices[0], indexBuffer.size()) == 0, "the loaded indices") ;
+
+	printf("%-22s %9d %9d %10.3f %9.3f %9.4f %10.3f %8.1fx\n", name, (int)(mesh.vertices.size() / mesh.stride),
+		   (int)mesh.indices.size() / 3, generateMs, writeMs, openMs, copyMs, generateMs / copyMs) ;
+}
+
+struct GridGenerator
+{
+	int size ;
+	void operator()(Mesh& mesh) const
+	{
+		float center[3] = { 0.0f, 0.0f, 0.0f } ;
+		GenerateGrids(size, size, 1.0f, 1.0f, center, mesh) ;
+	}
+} ;
+
+struct SphereGenerator
+{
+	int slices ;
+	void operator()(Mesh& mesh) const
+	{
+		CreateSphere(1.0f, slices, slices, mesh) ;
+	}
+} ;
+
+// A mesh converted from a .x file, keyed by the file bytes
+struct XFileGenerator
+{
+	const std::vector<char>* file ;
+	void operator()(Mesh& mesh) const
+	{
+		XMesh parsed ;
+		ParseXFile(&(*file)[0], file->size(), parsed) ;
+		mesh.stride = sizeof(XVertex) / sizeof(float) ;
+		mesh.vertices.assign((const float*)&parsed.vertices[0], (const float*)&parsed.vertices[0] + parsed.vertices.size() * mesh.stride) ;
+		mesh.indices.swap(parsed.indices) ;
+		mesh.key = XFileHash(&(*file)[0], file->size()) ;
+	}
+} ;
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../../../DirectX9/RubikCube" ;
+
+	Mesh mesh ;
+	float center[3] = { 5.0f, -1.0f, 2.0f } ;
+	GenerateGrids(100, 100, 1.0f, 1.0f, center, mesh) ;
+	CheckRoundTrip(mesh) ;
+	CheckDamage(mesh) ;
+	CreateSphere(2.0f, 40, 30, mesh) ;
+	CheckRoundTrip(mesh) ;
+
+	printf("\n%-22s %9s %9s %10s %9s %9s %10s %9s\n", "mesh", "vertices", "triangles", "make ms", "write ms", "open ms", "load ms", "speedup") ;
+	GridGenerator grid = { 100 } ;
+	Measure("grid 100x100", grid) ;
+	grid.size = 512 ;
+	Measure("grid 512x512", grid) ;
+	grid.size = 2048 ;
+	Measure("grid 2048x2048", grid) ;
+	SphereGenerator sphere = { 20 } ;
+	Measure("sphere 20x20", sphere) ;
+	sphere.slices = 500 ;
+	Measure("sphere 500x500", sphere) ;
+
+	std::vector<char> piece ;
+	FILE* file = fopen((directory + "/13.x").c_str(), "rb") ;
+	if (file)
+	{
+		char buffer[65536] ;
+		size_t count ;
+		while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			piece.insert(piece.end(), buffer, buffer + count) ;
+		}
+		fclose(file) ;
+	}
+	if (piece.empty())
+	{
+		printf("%s/13.x not found, pass the directory of the Rubik cube .x files\n", directory.c_str()) ;
+		++g_Failures ;
+	}
+	else
+	{
+		XFileGenerator x = { &piece } ;
+		Measure("Rubik cube piece .x", x) ;
+	}
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,530 @@
+/*
+Vertex cache report and self check for the mesh optimizer in Common/Math.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 MeshOptimizerBenchmark.cpp ../../Math/MeshOptimizer.cpp ../../Asset/XFile.cpp ../../Utility/MappedFile.cpp -o MeshOptimizerBenchmark
+
+Builds the index lists of the demos the way they build them: a QuadTree leaf, the
+terrain grid of Terrain::GenerateGrids, a sphere like D3DXCreateSphere, the control
+point list Utha_Teapot drew, the face strips of the Rubik Cube::InitIndexBuffer as
+lists, and the pieces of the Rubik cube parsed from their .x files, found in
+DirectX9/RubikCube or the directory given as the argument. For each one it prints the
+ACMR, transformed vertices per triangle, of a 16 entry FIFO cache and the ATVR,
+transformed vertices per vertex, before and after each reordering, and the bytes the
+vertex fetch reads per byte of vertices before and after OptimizeVertexFetch.
+
+Checks that every reordering keeps the triangles and their winding, works in place,
+never does worse than the input on the generated meshes, that the vertex fetch order
+keeps every triangle on the same positions, and that degenerate and empty lists and
+unused vertices are handled. Exits with a non-zero code if a check fails.
+*/
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../../Math/MeshOptimizer.h"
+#include "../../Asset/XFile.h"
+#include "../../Utility/Timer.h"
+
+static const unsigned int CACHE_SIZE = 16 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+struct Mesh
+{
+	std::vector<float> vertices ;
+	unsigned int stride ;				// in floats, the position first
+	std::vector<unsigned int> indices ;
+	std::vector<unsigned int> subsets ;	// the first index of each, reordered apart like materials
+
+	size_t VertexCount() const { return vertices.size() / stride ; }
+} ;
+
+// The grid of Terrain::GenerateGrids and of a QuadTree leaf, quads in row order
+static void GenerateGrids(int rows, int cols, Mesh& mesh)
+{
+	mesh.stride = 3 ;
+	mesh.subsets.assign(1, 0) ;
+	mesh.vertices.resize(rows * cols * 3) ;
+	for (int i = 0, k = 0; i < rows; ++i)
+	{
+		for (int j = 0; j < cols; ++j, k += 3)
+		{
+			mesh.vertices[k] = (float)j ;
+			mesh.vertices[k + 1] = 0.0f ;
+			mesh.vertices[k + 2] = -(float)i ;
+		}
+	}
+
+	mesh.indices.resize((rows - 1) * (cols - 1) * 6) ;
+	for (int i = 0, k = 0; i < rows - 1; ++i)
+	{
+		for (int j = 0; j < cols - 1; ++j, k += 6)
+		{
+			mesh.indices[k] = i * cols + j ;
+			mesh.indices[k + 1] = i * cols + j + 1 ;
+			mesh.indices[k + 2] = (i + 1) * cols + j ;
+			mesh.indices[k + 3] = (i + 1) * cols + j ;
+			mesh.indices[k + 4] = i * cols + j + 1 ;
+			mesh.indices[k + 5] = (i + 1) * cols + j + 1 ;
+		}
+	}
+}
+
+// Position and normal, stacks from the top like D3DXCreateSphere
+static void CreateSphere(float radius, int slices, int stacks, Mesh& mesh)
+{
+	mesh.stride = 6 ;
+	mesh.subsets.assign(1, 0) ;
+	mesh.vertices.clear() ;
+	mesh.indices.clear() ;
+	float top[6] = { 0.0f, radius, 0.0f, 0.0f, 1.0f, 0.0f } ;
+	mesh.vertices.insert(mesh.vertices.end(), top, top + 6) ;
+	for (int stack = 1; stack < stacks; ++stack)
+	{
+		float phi = 3.14159265f * stack / stacks ;
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			float theta = 6.2831853f * slice / slices ;
+			float n[3] = { sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) } ;
+			float v[6] = { n[0] * radius, n[1] * radius, n[2] * radius, n[0], n[1], n[2] } ;
+			mesh.vertices.insert(mesh.vertices.end(), v, v + 6) ;
+		}
+	}
+	float bottom[6] = { 0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f } ;
+	mesh.vertices.insert(mesh.vertices.end(), bottom, bottom + 6) ;
+
+	unsigned int last = (unsigned int)mesh.vertices.size() / 6 - 1 ;
+	for (int slice = 0; slice < slices; ++slice)
+	{
+		unsigned int next = (slice + 1) % slices ;
+		unsigned int fan[3] = { 0, 1 + next, 1 + (unsigned int)slice } ;
+		mesh.indices.insert(mesh.indices.end(), fan, fan + 3) ;
+	}
+	for (int stack = 0; stack < stacks - 2; ++stack)
+	{
+		for (int slice = 0; slice < slices; ++slice)
+		{
+			unsigned int a = 1 + stack * slices + slice ;
+			unsigned int b = 1 + stack * slices + (slice + 1) % slices ;
+			unsigned int quad[6] = { a, b, a + slices, b, b + slices, a + slices } ;
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6) ;
+		}
+	}
+	for (int slice = 0; slice < slices; ++slice)
+	{
+		unsigned int base = 1 + (stacks - 2) * slices ;
+		unsigned int cap[3] = { last, base + slice, base + (slice + 1) % slices } ;
+		mesh.indices.insert(mesh.indices.end(), cap, cap + 3) ;
+	}
+}
+
+// The index table Utha_Teapot.cpp had before it tessellated the patches, 16 control
+// points per patch drawn as a triangle list over its 118 vertices.
+// Where the points are does not matter to the cache.
+static void CreateTeapotControlPoints(Mesh& mesh)
+{
+	static const unsigned int table[] =
+	{
+		102, 103, 104, 105,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,
+		 12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,
+		 24,  25,  26,  27,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+		 96,  96,  96,  96,  97,  98,  99, 100, 101, 101, 101, 101,   0,   1,   2,   3,
+		  0,   1,   2,   3, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117,
+		 41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56,
+		 53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  28,  65,  66,  67,
+		 68,  69,  70,  71,  72,  73,  74,  75,  76,  77,  78,  79,  80,  81,  82,  83,
+		 80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93,  94,  95,
+	} ;
+	mesh.stride = 3 ;
+	mesh.subsets.assign(1, 0) ;
+	mesh.vertices.assign(118 * 3, 0.0f) ;
+	mesh.indices.assign(table, table + sizeof(table) / sizeof(table[0])) ;
+}
+
+// The six face strips of Cube::InitIndexBuffer, each { a, b, c, d } as two triangles
+static void CreateCubeFaces(Mesh& mesh)
+{
+	mesh.stride = 3 ;
+	mesh.subsets.assign(1, 0) ;
+	mesh.vertices.assign(24 * 3, 0.0f) ;
+	mesh.indices.clear() ;
+	for (unsigned int face = 0; face < 6; ++face)
+	{
+		unsigned int strip[4] = { face * 4, face * 4 + 1, face * 4 + 3, face * 4 + 2 } ;
+		unsigned int list[6] = { strip[0], strip[1], strip[2], strip[2], strip[1], strip[3] } ;
+		mesh.indices.insert(mesh.indices.end(), list, list + 6) ;
+	}
+}
+
+// The triangles as a sorted list, each rotated to start at its smallest index so the
+// winding is part of the comparison
+static std::vector<unsigned long long> Triangles(const std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned long long> triangles ;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2] ;
+		while (a > b || a > c)
+		{
+			unsigned int t = a ;
+			a = b ;
+			b = c ;
+			c = t ;
+		}
+		triangles.push_back(((unsigned long long)a << 42) | ((unsigned long long)b << 21) | c) ;
+	}
+	std::sort(triangles.begin(), triangles.end()) ;
+	return triangles ;
+}
+
+static bool SameTriangles(const std::vector<unsigned int>& a, const std::vector<unsigned int>& b)
+{
+	return a.size() == b.size() && Triangles(a) == Triangles(b) ;
+}
+
+static VertexCacheStats Analyze(const Mesh& mesh, const std::vector<unsigned int>& indices)
+{
+	return AnalyzeVertexCache(indices.empty() ? NULL : &indices[0], indices.size(), mesh.VertexCount(), CACHE_SIZE) ;
+}
+
+struct Report
+{
+	VertexCacheStats input ;
+	VertexCacheStats forsyth ;
+	VertexCacheStats tipsify ;
+	VertexCacheStats overdraw ;
+	VertexFetchStats fetchBefore ;
+	VertexFetchStats fetchAfter ;
+	double forsythMs ;
+	double tipsifyMs ;
+	double overdrawMs ;
+} ;
+
+enum ORDER
+{
+	ORDER_FORSYTH,
+	ORDER_TIPSIFY,
+	ORDER_OVERDRAW,
+} ;
+
+// Each subset on its own, as the parser and a material split need it
+static void Reorder(ORDER order, const Mesh& mesh, unsigned int* destination, const unsigned int* indices)
+{
+	for (size_t i = 0; i < mesh.subsets.size(); ++i)
+	{
+		size_t first = mesh.subsets[i] ;
+		size_t count = (i + 1 < mesh.subsets.size() ? mesh.subsets[i + 1] : mesh.indices.size()) - first ;
+		switch (order)
+		{
+		case ORDER_FORSYTH:
+			OptimizeVertexCache(destination + first, indices + first, count, mesh.VertexCount()) ;
+			break ;
+		case ORDER_TIPSIFY:
+			OptimizeVertexCacheTipsify(destination + first, indices + first, count, mesh.VertexCount(), CACHE_SIZE) ;
+			break ;
+		case ORDER_OVERDRAW:
+			OptimizeOverdraw(destination + first, indices + first, count, &mesh.vertices[0], mesh.stride * sizeof(float),
+							 mesh.VertexCount(), 1.05f, CACHE_SIZE) ;
+			break ;
+		}
+	}
+}
+
+static Report Optimize(const Mesh& mesh)
+{
+	const int repeats = 3 ;
+	Report report ;
+	report.input = Analyze(mesh, mesh.indices) ;
+
+	size_t indexCount = mesh.indices.size() ;
+	std::vector<unsigned int> forsyth(indexCount), tipsify(indexCount), overdraw(indexCount) ;
+
+	report.forsythMs = report.tipsifyMs = report.overdrawMs = DBL_MAX ;
+	for (int i = 0; i < repeats; ++i)
+	{
+		Timer timer ;
+		Reorder(ORDER_FORSYTH, mesh, &forsyth[0], &mesh.indices[0]) ;
+		report.forsythMs = std::min(report.forsythMs, timer.ElapsedMs()) ;
+
+		timer.Restart() ;
+		Reorder(ORDER_TIPSIFY, mesh, &tipsify[0], &mesh.indices[0]) ;
+		report.tipsifyMs = std::min(report.tipsifyMs, timer.ElapsedMs()) ;
+
+		timer.Restart() ;
+		Reorder(ORDER_OVERDRAW, mesh, &overdraw[0], &tipsify[0]) ;
+		report.overdrawMs = std::min(report.overdrawMs, timer.ElapsedMs()) ;
+	}
+
+	report.forsyth = Analyze(mesh, forsyth) ;
+	report.tipsify = Analyze(mesh, tipsify) ;
+	report.overdraw = Analyze(mesh, overdraw) ;
+	Check(SameTriangles(mesh.indices, forsyth), "OptimizeVertexCache keeps the triangles") ;
+	Check(SameTriangles(mesh.indices, tipsify), "OptimizeVertexCacheTipsify keeps the triangles") ;
+	Check(SameTriangles(mesh.indices, overdraw), "OptimizeOverdraw keeps the triangles") ;
+
+	// In place gives the same order
+	std::vector<unsigned int> inPlace(mesh.indices) ;
+	Reorder(ORDER_FORSYTH, mesh, &inPlace[0], &inPlace[0]) ;
+	Check(inPlace == forsyth, "OptimizeVertexCache in place") ;
+	inPlace = mesh.indices ;
+	Reorder(ORDER_TIPSIFY, mesh, &inPlace[0], &inPlace[0]) ;
+	Check(inPlace == tipsify, "OptimizeVertexCacheTipsify in place") ;
+	inPlace = tipsify ;
+	Reorder(ORDER_OVERDRAW, mesh, &inPlace[0], &inPlace[0]) ;
+	Check(inPlace == overdraw, "OptimizeOverdraw in place") ;
+
+	// Nothing leaves its subset
+	for (size_t i = 0; i < mesh.subsets.size(); ++i)
+	{
+		size_t first = mesh.subsets[i] ;
+		size_t end = i + 1 < mesh.subsets.size() ? mesh.subsets[i + 1] : indexCount ;
+		std::vector<unsigned int> before(mesh.indices.begin() + first, mesh.indices.begin() + end) ;
+		std::vector<unsigned int> after(tipsify.begin() + first, tipsify.begin() + end) ;
+		Check(SameTriangles(before, after), "the triangles stay in their subset") ;
+	}
+
+	// The fetch order, after the cache order as the header asks
+	size_t vertexSize = mesh.stride * sizeof(float) ;
+	size_t vertexCount = mesh.VertexCount() ;
+	report.fetchBefore = AnalyzeVertexFetch(&tipsify[0], indexCount, vertexCount, vertexSize) ;
+	std::vector<unsigned int> fetched(tipsify) ;
+	std::vector<float> vertices(mesh.vertices.size()) ;
+	size_t used = OptimizeVertexFetch(&vertices[0], &fetched[0], indexCount, &mesh.vertices[0], vertexCount, vertexSize) ;
+	report.fetchAfter = AnalyzeVertexFetch(&fetched[0], indexCount, used, vertexSize) ;
+
+	bool samePositions = true ;
+	unsigned int highest = 0 ;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		samePositions = samePositions && fetched[i] < used &&
+						memcmp(&vertices[fetched[i] * mesh.stride], &mesh.vertices[tipsify[i] * mesh.stride], vertexSize) == 0 ;
+		Check(fetched[i] <= highest + 1 || i == 0, "OptimizeVertexFetch numbers in first use order") ;
+		highest = std::max(highest, fetched[i]) ;
+	}
+	Check(samePositions, "OptimizeVertexFetch keeps every corner on its vertex") ;
+	std::vector<unsigned char> referenced(vertexCount, 0) ;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		referenced[mesh.indices[i]] = 1 ;
+	}
+	Check(used == (size_t)std::count(referenced.begin(), referenced.end(), 1), "OptimizeVertexFetch keeps the used vertices") ;
+	VertexCacheStats refetched = AnalyzeVertexCache(&fetched[0], indexCount, used, CACHE_SIZE) ;
+	Check(refetched.transforms == report.tipsify.transforms, "OptimizeVertexFetch leaves the cache misses alone") ;
+	return report ;
+}
+
+static void Print(const char* name, const Mesh& mesh, const Report& report)
+{
+	printf("%-24s %8d %8d %6.3f %6.3f %6.3f %6.3f %6.2f %6.2f %6.2f %6.2f %8.3f %8.3f\n", name,
+		   (int)mesh.VertexCount(), (int)mesh.indices.size() / 3,
+		   report.input.acmr, report.forsyth.acmr, report.tipsify.acmr, report.overdraw.acmr,
+		   report.input.atvr, report.tipsify.atvr, report.fetchBefore.overfetch, report.fetchAfter.overfetch,
+		   report.forsythMs, report.tipsifyMs) ;
+}
+
+// For the meshes the demos generate, which all come in row order
+static void CheckGenerated(const char* name, const Mesh& mesh, float forsythAcmr, float tipsifyAcmr)
+{
+	Report report = Optimize(mesh) ;
+	Print(name, mesh, report) ;
+
+	std::string what = std::string(name) + ": " ;
+	Check(report.forsyth.acmr <= forsythAcmr, (what + "OptimizeVertexCache reaches the expected ACMR").c_str()) ;
+	Check(report.tipsify.acmr <= tipsifyAcmr, (what + "Tipsify reaches the expected ACMR").c_str()) ;
+	Check(report.forsyth.transforms <= report.input.transforms, (what + "OptimizeVertexCache does no worse than the input").c_str()) ;
+	Check(report.tipsify.transforms <= report.input.transforms, (what + "Tipsify does no worse than the input").c_str()) ;
+	Check(report.overdraw.acmr <= report.tipsify.acmr * 1.05f + 0.05f, (what + "OptimizeOverdraw stays near its input").c_str()) ;
+}
+
+// The generated meshes lay their vertices out in rows already, which fetches about as
+// well as the first use order. A converter or a welding pass leaves them scattered.
+static void CheckScatteredVertices()
+{
+	Mesh mesh ;
+	GenerateGrids(100, 100, mesh) ;
+
+	std::vector<unsigned int> shuffle(mesh.VertexCount()) ;
+	for (size_t i = 0; i < shuffle.size(); ++i)
+	{
+		shuffle[i] = (unsigned int)i ;
+	}
+	unsigned int seed = 12345 ;
+	for (size_t i = shuffle.size() - 1; i > 0; --i)
+	{
+		seed = seed * 1664525 + 1013904223 ;
+		std::swap(shuffle[i], shuffle[(seed >> 8) % (i + 1)]) ;
+	}
+
+	Mesh scattered = mesh ;
+	for (size_t v = 0; v < shuffle.size(); ++v)
+	{
+		memcpy(&scattered.vertices[shuffle[v] * 3], &mesh.vertices[v * 3], 3 * sizeof(float)) ;
+	}
+	for (size_t i = 0; i < scattered.indices.size(); ++i)
+	{
+		scattered.indices[i] = shuffle[mesh.indices[i]] ;
+	}
+
+	Report report = Optimize(scattered) ;
+	Print("grid 100x100 scattered", scattered, report) ;
+	Check(report.tipsify.acmr <= 0.66f, "scattered vertices: Tipsify reaches the expected ACMR") ;
+	Check(report.fetchAfter.overfetch * 2.0f <= report.fetchBefore.overfetch, "scattered vertices: OptimizeVertexFetch halves the bytes fetched") ;
+}
+
+static void CheckEdgeCases()
+{
+	// Nothing to do
+	unsigned int none = 7 ;
+	OptimizeVertexCache(&none, &none, 0, 4) ;
+	OptimizeVertexCacheTipsify(&none, &none, 0, 4) ;
+	Check(none == 7, "an empty list is left alone") ;
+	VertexCacheStats stats = AnalyzeVertexCache(&none, 0, 4) ;
+	Check(stats.transforms == 0 && stats.acmr == 0.0f && stats.atvr == 0.0f, "the stats of an empty list") ;
+
+	// A degenerate triangle, a vertex used twice in one triangle, and unused vertices
+	unsigned int degenerate[] = { 5, 5, 5, 1, 2, 1, 1, 2, 3, 3, 2, 6 } ;
+	std::vector<unsigned int> input(degenerate, degenerate + 12), output(12) ;
+	OptimizeVertexCache(&output[0], &input[0], 12, 8) ;
+	Check(SameTriangles(input, output), "OptimizeVertexCache with degenerate triangles") ;
+	OptimizeVertexCacheTipsify(&output[0], &input[0], 12, 8) ;
+	Check(SameTriangles(input, output), "Tipsify with degenerate triangles") ;
+
+	float positions[8 * 3] ;
+	for (int i = 0; i < 8 * 3; ++i)
+	{
+		positions[i] = (float)i ;
+	}
+	float fetched[8 * 3] ;
+	size_t used = OptimizeVertexFetch(fetched, &output[0], 12, positions, 8, 3 * sizeof(float)) ;
+	Check(used == 5, "OptimizeVertexFetch drops the unused vertices") ;
+
+	// Every triangle missing the cache, the worst case
+	unsigned int separate[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 } ;
+	stats = AnalyzeVertexCache(separate, 9, 9) ;
+	Check(stats.acmr == 3.0f && stats.atvr == 1.0f, "the stats of separate triangles") ;
+
+	// A 1 entry cache misses every index but the repeated one
+	unsigned int fan[] = { 0, 1, 2, 2, 1, 3 } ;
+	stats = AnalyzeVertexCache(fan, 6, 4, 1) ;
+	Check(stats.transforms == 5, "the stats of a 1 entry cache") ;
+}
+
+static bool ReadFile(const char* path, std::vector<char>& data)
+{
+	data.clear() ;
+	FILE* file = fopen(path, "rb") ;
+	if (!file)
+	{
+		return false ;
+	}
+
+	char buffer[65536] ;
+	size_t count ;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + count) ;
+	}
+	fclose(file) ;
+	return !data.empty() ;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../../../DirectX9/RubikCube" ;
+
+	CheckEdgeCases() ;
+
+	printf("\n%-24s %8s %8s %6s %6s %6s %6s %6s %6s %6s %6s %8s %8s\n", "", "", "", "ACMR", "", "", "", "ATVR", "", "fetch", "",  "ms", "") ;
+	printf("%-24s %8s %8s %6s %6s %6s %6s %6s %6s %6s %6s %8s %8s\n", "mesh", "vertices", "tris",
+		   "input", "forsyt", "tipsfy", "overdr", "input", "tipsfy", "before", "after", "forsyth", "tipsify") ;
+
+	Mesh mesh ;
+	GenerateGrids(17, 17, mesh) ;
+	CheckGenerated("QuadTree leaf 17x17", mesh, 0.7f, 0.66f) ;
+	GenerateGrids(100, 100, mesh) ;
+	CheckGenerated("terrain grid 100x100", mesh, 0.7f, 0.62f) ;
+	GenerateGrids(512, 512, mesh) ;
+	CheckGenerated("grid 512x512", mesh, 0.7f, 0.62f) ;
+	CreateSphere(1.0f, 40, 30, mesh) ;
+	CheckGenerated("sphere 40x30", mesh, 0.76f, 0.65f) ;
+	CreateSphere(1.0f, 500, 500, mesh) ;
+	CheckGenerated("sphere 500x500", mesh, 0.76f, 0.62f) ;
+	CheckScatteredVertices() ;
+
+	// Already at what their vertex counts allow, reported for completeness
+	CreateTeapotControlPoints(mesh) ;
+	Print("teapot control points", mesh, Optimize(mesh)) ;
+	CreateCubeFaces(mesh) ;
+	Report faces = Optimize(mesh) ;
+	Print("cube face strips", mesh, faces) ;
+	Check(faces.input.acmr == 2.0f && faces.forsyth.acmr == 2.0f, "the cube faces need 4 vertices for 2 triangles") ;
+
+	// ParseXFile orders every subset already, so the optimizers find nothing left to gain.
+	// The subsets of all the pieces go into one mesh and are reordered apart.
+	int pieces = 0 ;
+	Mesh merged ;
+	merged.stride = sizeof(XVertex) / sizeof(float) ;
+	for (int piece = 0; piece < 27; ++piece)
+	{
+		char name[16] ;
+		sprintf(name, "/%d.x", piece) ;
+		std::vector<char> file ;
+		XMesh parsed ;
+		if (!ReadFile((directory + name).c_str(), file) || ParseXFile(&file[0], file.size(), parsed) != XFILE_OK)
+		{
+			continue ;
+		}
+		++pieces ;
+
+		unsigned int base = (unsigned int)merged.VertexCount() ;
+		for (size_t i = 0; i < parsed.subsets.size(); ++i)
+		{
+			if (parsed.subsets[i].indexCount > 0)
+			{
+				merged.subsets.push_back((unsigned int)merged.indices.size() + parsed.subsets[i].firstIndex) ;
+			}
+		}
+		merged.vertices.insert(merged.vertices.end(), (const float*)&parsed.vertices[0],
+							   (const float*)&parsed.vertices[0] + parsed.vertices.size() * merged.stride) ;
+		for (size_t i = 0; i < parsed.indices.size(); ++i)
+		{
+			merged.indices.push_back(parsed.indices[i] + base) ;
+		}
+	}
+
+	if (pieces == 0)
+	{
+		printf("no .x file found in %s, pass the directory of the Rubik cube .x files\n", directory.c_str()) ;
+		++g_Failures ;
+	}
+	else
+	{
+		Report report = Optimize(merged) ;
+		Print("Rubik cube pieces .x", merged, report) ;
+		Check(report.tipsify.transforms >= report.input.transforms * 0.98f, "the parsed pieces are in cache order") ;
+	}
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,306 @@
+/*
+Benchmark and self check for the frame time profiler in Common/Utility.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 -pthread ProfilerBenchmark.cpp ../../Utility/Profiler.cpp ../../Utility/ThreadPool.cpp -o ProfilerBenchmark
+
+Records events with known durations and checks the summaries against them: the
+percentiles of a stage over its frames, the sum of a stage recorded more than once in
+a frame, events of the threads of a ThreadPool, the count of events dropped by a full
+buffer, two profilers used from one thread, and the JSON written for chrome://tracing.
+Then measures what a PROFILE_SCOPE costs, from one thread and from all of the pool.
+
+Exits with a non-zero code if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../../Utility/Profiler.h"
+#include "../../Utility/ThreadPool.h"
+#include "../../Utility/Timer.h"
+
+static const int SCOPES = 1000000 ;
+static const int SCOPES_PER_FRAME = 1000 ;
+static const char* TRACE_FILE = "ProfilerBenchmark.json" ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static bool Near(double a, double b)
+{
+	return fabs(a - b) < 1e-3 ;
+}
+
+// Ticks of the given number of milliseconds
+static long long MsToTicks(double ms)
+{
+	return (long long)(ms * TimerFrequency() / 1000.0 + 0.5) ;
+}
+
+static void CheckPercentiles()
+{
+	// 1 to 100 ms in a scrambled order, a frame each
+	Profiler profiler(240) ;
+	long long start = 0 ;
+	for (int i = 0; i < 100; ++i)
+	{
+		int ms = (i * 37) % 100 + 1 ;
+		profiler.Record("work", start, start + MsToTicks(ms)) ;
+		profiler.EndFrame() ;
+		start += MsToTicks(ms) ;
+	}
+
+	ProfileSummary summary ;
+	Check(profiler.Summary("work", summary), "stage recorded") ;
+	Check(summary.count == 100, "a sample per frame") ;
+	Check(Near(summary.minMs, 1.0) && Near(summary.maxMs, 100.0), "min and max") ;
+	Check(Near(summary.meanMs, 50.5), "mean") ;
+	Check(Near(summary.p50Ms, 50.0) && Near(summary.p99Ms, 99.0), "nearest rank percentiles") ;
+	Check(profiler.Summary("frame", summary) && summary.count == 99, "frame time between EndFrame calls") ;
+	Check(!profiler.Summary("missing", summary) && summary.count == 0, "unknown stage") ;
+
+	// Only the last frames are kept
+	Profiler shortHistory(10) ;
+	for (int i = 1; i <= 30; ++i)
+	{
+		shortHistory.Record("work", 0, MsToTicks(i)) ;
+		shortHistory.EndFrame() ;
+	}
+	Check(shortHistory.Summary("work", summary) && summary.count == 10, "history length") ;
+	Check(Near(summary.minMs, 21.0) && Near(summary.maxMs, 30.0), "oldest frames forgotten") ;
+
+	// Two events of a stage in one frame add up, a frame without the stage adds no sample
+	Profiler sum ;
+	sum.Record("draw", 0, MsToTicks(2)) ;
+	sum.Record("draw", 0, MsToTicks(3)) ;
+	sum.EndFrame() ;
+	sum.EndFrame() ;
+	Check(sum.Summary("draw", summary) && summary.count == 1 && Near(summary.meanMs, 5.0), "stage time summed in a frame") ;
+
+	// The same name at another address is the same stage
+	std::string name = "draw" ;
+	sum.Record(name.c_str(), 0, MsToTicks(1)) ;
+	sum.EndFrame() ;
+	Check(sum.StageCount() == 2 && sum.Summary("draw", summary) && summary.count == 2, "stage found by name") ;
+
+	std::string report = sum.Report() ;
+	Check(report.find("draw") != std::string::npos && report.find("fps") != std::string::npos, "report lists the stages") ;
+}
+
+static void CheckThreads(ThreadPool& pool)
+{
+	static const int TASKS = 64 ;
+	static const int EVENTS = 50 ;
+
+	Profiler profiler(240, 4096) ;
+	for (int frame = 0; frame < 4; ++frame)
+	{
+		pool.ParallelFor(TASKS, [&](int)
+		{
+			for (int i = 0; i < EVENTS; ++i)
+			{
+				profiler.Record("task", 0, MsToTicks(0.01)) ;
+			}
+		}) ;
+		profiler.EndFrame() ;
+	}
+
+	ProfileSummary summary ;
+	Check(profiler.Summary("task", summary) && summary.count == 4, "events of all threads collected") ;
+	Check(Near(summary.minMs, TASKS * EVENTS * 0.01) && Near(summary.maxMs, TASKS * EVENTS * 0.01), "no event lost or counted twice") ;
+	Check(profiler.DroppedEvents() == 0, "nothing dropped") ;
+
+	// A buffer of 16 events, 100 recorded before the frame ends
+	Profiler small(240, 16) ;
+	for (int i = 0; i < 100; ++i)
+	{
+		small.Record("event", 0, MsToTicks(1)) ;
+	}
+	small.EndFrame() ;
+	Check(small.DroppedEvents() == 84, "full buffer drops and counts") ;
+	Check(small.Summary("event", summary) && Near(summary.meanMs, 16.0), "events kept before the buffer filled") ;
+
+	// Once the frame ends the buffer has room again
+	small.Record("event", 0, MsToTicks(1)) ;
+	small.EndFrame() ;
+	Check(small.DroppedEvents() == 84 && small.Summary("event", summary) && summary.count == 2, "buffer reused") ;
+
+	// Two profilers from one thread keep their own buffers
+	Profiler a ;
+	Profiler b ;
+	for (int i = 0; i < 10; ++i)
+	{
+		a.Record("a", 0, MsToTicks(1)) ;
+		b.Record("b", 0, MsToTicks(2)) ;
+	}
+	a.EndFrame() ;
+	b.EndFrame() ;
+	Check(a.StageCount() == 1 && a.Summary("a", summary) && Near(summary.meanMs, 10.0), "first profiler") ;
+	Check(b.StageCount() == 1 && b.Summary("b", summary) && Near(summary.meanMs, 20.0), "second profiler") ;
+}
+
+static void CheckTrace()
+{
+	Profiler profiler ;
+	profiler.Record("before", 0, 1) ;
+	profiler.EndFrame() ;
+
+	profiler.StartTrace() ;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		PROFILE_SCOPE(profiler, "frame work") ;
+		profiler.Record("say \"hi\"\\", TimerTicks(), TimerTicks()) ;
+	}
+	profiler.EndFrame() ;
+	profiler.StopTrace() ;
+	profiler.Record("after", 0, 1) ;
+	profiler.EndFrame() ;
+
+	Check(profiler.WriteChromeTrace(TRACE_FILE), "trace written") ;
+
+	std::string text ;
+	FILE* file = fopen(TRACE_FILE, "rb") ;
+	if (file)
+	{
+		char buffer[4096] ;
+		size_t read ;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			text.append(buffer, read) ;
+		}
+		fclose(file) ;
+	}
+	remove(TRACE_FILE) ;
+
+	int events = 0 ;
+	for (size_t at = text.find("\"ph\":\"X\""); at != std::string::npos; at = text.find("\"ph\":\"X\"", at + 1))
+	{
+		++events ;
+	}
+
+	// Brackets balance outside of strings
+	int depth = 0 ;
+	bool inString = false ;
+	bool balanced = true ;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		char c = text[i] ;
+		if (inString)
+		{
+			if (c == '\\')
+			{
+				++i ;
+			}
+			else if (c == '"')
+			{
+				inString = false ;
+			}
+		}
+		else if (c == '"')
+		{
+			inString = true ;
+		}
+		else if (c == '{' || c == '[')
+		{
+			++depth ;
+		}
+		else if (c == '}' || c == ']')
+		{
+			balanced = balanced && --depth >= 0 ;
+		}
+	}
+
+	Check(text.compare(0, 16, "{\"traceEvents\":[") == 0, "trace object") ;
+	Check(events == 6, "events while tracing only") ;
+	Check(balanced && depth == 0 && !inString, "well formed JSON") ;
+	Check(text.find("\"say \\\"hi\\\"\\\\\"") != std::string::npos, "names escaped") ;
+	Check(text.find("before") == std::string::npos && text.find("after") == std::string::npos, "no events outside the trace") ;
+}
+
+// ns per scope, with EndFrame every SCOPES_PER_FRAME scopes of each thread
+static double MeasureScopes(ThreadPool* pPool)
+{
+	Profiler profiler ;
+	int threads = pPool ? pPool->ThreadCount() : 1 ;
+	int frames = SCOPES / SCOPES_PER_FRAME / threads ;
+
+	Timer timer ;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		std::function<void (int)> task = [&](int)
+		{
+			for (int i = 0; i < SCOPES_PER_FRAME; ++i)
+			{
+				PROFILE_SCOPE(profiler, "scope") ;
+			}
+		} ;
+
+		if (pPool)
+		{
+			pPool->ParallelFor(threads, task) ;
+		}
+		else
+		{
+			task(0) ;
+		}
+		profiler.EndFrame() ;
+	}
+	double ms = timer.ElapsedMs() ;
+
+	ProfileSummary summary ;
+	Check(profiler.Summary("scope", summary) && profiler.DroppedEvents() == 0, "scopes recorded") ;
+	return ms * 1e6 / ((double)frames * threads * SCOPES_PER_FRAME) ;
+}
+
+// Keeps the clock reads of MeasureClock from being optimized away
+static volatile unsigned long long g_Sink = 0 ;
+
+// The cost of reading the clock alone, what every scope does twice
+static double MeasureClock()
+{
+	// Unsigned, the sum of the ticks wraps around
+	unsigned long long total = 0 ;
+	Timer timer ;
+	for (int i = 0; i < SCOPES; ++i)
+	{
+		total += (unsigned long long)TimerTicks() ;
+	}
+	double ms = timer.ElapsedMs() ;
+	g_Sink = total ;
+	return ms * 1e6 / SCOPES ;
+}
+
+int main()
+{
+	ThreadPool pool ;
+
+	CheckPercentiles() ;
+	CheckThreads(pool) ;
+	CheckTrace() ;
+
+	printf("%d threads, %d scopes, EndFrame every %d\n\n", pool.ThreadCount(), SCOPES, SCOPES_PER_FRAME) ;
+	printf("%-24s %10.1f ns\n", "clock read", MeasureClock()) ;
+	printf("%-24s %10.1f ns\n", "scope, one thread", MeasureScopes(NULL)) ;
+	printf("%-24s %10.1f ns\n", "scope, all threads", MeasureScopes(&pool)) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
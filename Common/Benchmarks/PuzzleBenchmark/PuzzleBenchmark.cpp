@@ -0,0 +1,384 @@
+/*
+Benchmark and self check for the puzzle boards and the sliding puzzle solver in
+Common/Puzzle.
+
+Runs on any machine, including Linux:
+	g++ -O2 -std=c++11 -pthread -I../../Puzzle PuzzleBenchmark.cpp ../../Puzzle/PuzzleBoard.cpp \
+		../../Puzzle/PatternDatabase.cpp ../../Puzzle/PuzzleSolver.cpp ../../Utility/MappedFile.cpp \
+		../../Utility/ThreadPool.cpp -o PuzzleBenchmark
+
+Builds the pattern databases of the 3 x 3, 4 x 4 and 5 x 5 boards, or loads them from the
+.pdb files a run before saved into the working directory, and solves a fixed set of
+boards on 1 to N threads. The 4 x 4 boards are the first three of Korf's hundred random
+instances, with shortest solutions of 57, 55 and 59 moves. Random 5 x 5 boards take far
+larger tables than the 4 tile groups built here, the 5 x 5 boards are scrambled by 40
+to 80 random slides instead.
+
+Exits with a non-zero code if a swap board is not solved in the fewest swaps, a shuffle
+gives a solved board or one that cannot be slid home, the parity test disagrees with a
+search of every 3 x 3 board, a solution is longer than the shortest one, does not solve
+the board or depends on the thread count, or the tables change when saved and loaded.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "PuzzleBoard.h"
+#include "PatternDatabase.h"
+#include "PuzzleSolver.h"
+#include "../../Utility/ThreadPool.h"
+#include "../../Utility/Timer.h"
+
+struct Instance
+{
+	int width ;
+	int height ;
+	int moves ;			// shortest solution
+	int tiles[25] ;
+};
+
+static const Instance INSTANCES[] =
+{
+	{ 4, 4, 57, { 14, 13, 15, 7, 11, 12, 9, 5, 6, 0, 2, 1, 4, 8, 10, 3 } },
+	{ 4, 4, 55, { 13, 5, 4, 10, 9, 12, 8, 14, 2, 3, 7, 1, 0, 15, 11, 6 } },
+	{ 4, 4, 59, { 14, 7, 8, 2, 13, 11, 10, 4, 9, 12, 5, 0, 3, 6, 1, 15 } },
+	{ 5, 5, 38, { 5, 1, 2, 4, 9, 6, 7, 8, 3, 14, 10, 11, 17, 19, 13, 16, 18, 12, 24, 23, 15, 21, 20, 22, 0 } },
+	{ 5, 5, 40, { 5, 7, 1, 2, 4, 6, 8, 17, 3, 9, 10, 11, 13, 19, 14, 16, 18, 24, 0, 23, 15, 21, 12, 20, 22 } },
+	{ 5, 5, 46, { 1, 2, 3, 9, 18, 10, 5, 6, 13, 4, 12, 7, 16, 17, 19, 15, 21, 11, 23, 8, 20, 14, 22, 24, 0 } },
+	{ 5, 5, 56, { 0, 7, 1, 9, 2, 5, 11, 8, 17, 4, 6, 18, 13, 3, 14, 10, 21, 24, 19, 22, 16, 15, 12, 23, 20 } },
+} ;
+
+// Boards and the tile groups of their tables
+struct Layout
+{
+	int width ;
+	int height ;
+	int groupSize ;
+	const char* file ;
+};
+
+static const Layout LAYOUTS[] =
+{
+	{ 3, 3, 4, "puzzle33.pdb" },
+	{ 4, 4, 5, "puzzle44.pdb" },
+	{ 5, 5, 4, "puzzle55.pdb" },
+} ;
+
+static const int SHUFFLES = 1000 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static void TestSwapBoards()
+{
+	bool fewest = true ;
+	bool shuffled = true ;
+	std::vector<int> tiles ;
+	for (int count = 2; count <= 100; count += 7)
+	{
+		tiles.resize(count) ;
+		for (unsigned int seed = 0; seed < 20; ++seed)
+		{
+			ShuffleSwapBoard(&tiles[0], count, seed) ;
+			shuffled = shuffled && IsPermutation(&tiles[0], count) && !IsSolved(&tiles[0], count) ;
+
+			// Every hinted swap takes one off the distance
+			int distance = SwapDistance(&tiles[0], count) ;
+			int swaps = 0 ;
+			int first ;
+			int second ;
+			while (NextSwap(&tiles[0], count, first, second))
+			{
+				int temp = tiles[first] ;
+				tiles[first] = tiles[second] ;
+				tiles[second] = temp ;
+				++swaps ;
+				fewest = fewest && SwapDistance(&tiles[0], count) == distance - swaps ;
+			}
+			fewest = fewest && swaps == distance && IsSolved(&tiles[0], count) ;
+		}
+	}
+	Check(shuffled, "swap shuffles are permutations and never solved") ;
+	Check(fewest, "NextSwap solves a board in SwapDistance swaps") ;
+
+	int cycle[5] = { 1, 2, 3, 4, 0 } ;
+	Check(PermutationParity(cycle, 5) == 0 && SwapDistance(cycle, 5) == 4, "a cycle of 5 is 4 swaps") ;
+}
+
+static void TestSlidingShuffles()
+{
+	bool solvable = true ;
+	for (int size = 2; size <= 5; ++size)
+	{
+		int tiles[25] ;
+		for (unsigned int seed = 0; seed < SHUFFLES; ++seed)
+		{
+			ShuffleSlidingBoard(tiles, size, size, seed) ;
+			solvable = solvable && IsSolvableSliding(tiles, size, size) && !IsSolved(tiles, size * size) ;
+		}
+	}
+	Check(solvable, "sliding shuffles can be solved and are not solved") ;
+}
+
+// The place of a 3 x 3 board among all 9! orders of its tiles
+static int Rank(const int* tiles)
+{
+	int rank = 0 ;
+	for (int i = 0; i < 9; ++i)
+	{
+		int smaller = 0 ;
+		for (int j = i + 1; j < 9; ++j)
+		{
+			smaller += tiles[j] < tiles[i] ;
+		}
+		rank = rank * (9 - i) + smaller ;
+	}
+	return rank ;
+}
+
+static void Unrank(int rank, int* tiles)
+{
+	int digits[9] ;
+	for (int i = 8; i >= 0; --i)
+	{
+		digits[i] = rank % (9 - i) ;
+		rank /= 9 - i ;
+	}
+
+	bool used[9] = { false } ;
+	for (int i = 0; i < 9; ++i)
+	{
+		int tile = 0 ;
+		for (int skip = digits[i]; used[tile] || skip > 0; ++tile)
+		{
+			if (!used[tile])
+			{
+				--skip ;
+			}
+		}
+		used[tile] = true ;
+		tiles[i] = tile ;
+	}
+}
+
+// Shortest solutions of every 3 x 3 board by breadth first search from the solved one
+static void SearchAllBoards(std::vector<unsigned char>& distance)
+{
+	distance.assign(362880, 255) ;
+	std::vector<int> queue ;
+	int tiles[9] ;
+	SolvedBoard(tiles, 9) ;
+	distance[Rank(tiles)] = 0 ;
+	queue.push_back(Rank(tiles)) ;
+	for (size_t head = 0; head < queue.size(); ++head)
+	{
+		Unrank(queue[head], tiles) ;
+		for (int cell = 0; cell < 9; ++cell)
+		{
+			int next[9] ;
+			memcpy(next, tiles, sizeof(next)) ;
+			if (SlideTile(next, 3, 3, cell) && distance[Rank(next)] == 255)
+			{
+				distance[Rank(next)] = (unsigned char)(distance[queue[head]] + 1) ;
+				queue.push_back(Rank(next)) ;
+			}
+		}
+	}
+}
+
+static bool Replay(const int* tiles, int width, int height, const std::vector<int>& moves)
+{
+	int board[25] ;
+	memcpy(board, tiles, width * height * sizeof(int)) ;
+	for (size_t i = 0; i < moves.size(); ++i)
+	{
+		if (!SlideTile(board, width, height, moves[i]))
+		{
+			return false ;
+		}
+	}
+	return IsSolved(board, width * height) ;
+}
+
+static void TestSmallBoards(const PatternDatabase& database)
+{
+	std::vector<unsigned char> distance ;
+	SearchAllBoards(distance) ;
+
+	// The parity test against the boards the search reached, and the solver on a sample of
+	// them and on the farthest
+	int tiles[9] ;
+	PuzzleSolver solver(database) ;
+	std::vector<int> moves ;
+	bool parity = true ;
+	bool shortest = true ;
+	int reached = 0 ;
+	int solved = 0 ;
+	for (unsigned int seed = 0; seed < 20000; ++seed)
+	{
+		ShuffleSwapBoard(tiles, 9, seed) ;
+		int moveCount = distance[Rank(tiles)] ;
+		parity = parity && IsSolvableSliding(tiles, 3, 3) == (moveCount != 255) ;
+		if (moveCount != 255)
+		{
+			++reached ;
+			if (seed % 20 == 0)
+			{
+				++solved ;
+				shortest = shortest && solver.Solve(tiles, moves) && (int)moves.size() == moveCount && Replay(tiles, 3, 3, moves) ;
+			}
+		}
+		else
+		{
+			shortest = shortest && !solver.Solve(tiles, moves) ;
+		}
+	}
+
+	int farthest = 0 ;
+	for (size_t rank = 0; rank < distance.size(); ++rank)
+	{
+		if (distance[rank] != 255 && distance[rank] > farthest)
+		{
+			farthest = distance[rank] ;
+		}
+	}
+	for (size_t rank = 0; rank < distance.size(); ++rank)
+	{
+		if (distance[rank] == farthest)
+		{
+			Unrank((int)rank, tiles) ;
+			++solved ;
+			shortest = shortest && solver.Solve(tiles, moves) && (int)moves.size() == farthest && Replay(tiles, 3, 3, moves) ;
+		}
+	}
+
+	printf("3x3: %d of 20000 random boards can be slid home, solved %d, the farthest board is %d moves away\n\n", reached, solved, farthest) ;
+	Check(parity, "the parity test agrees with a search of all 3 x 3 boards") ;
+	Check(shortest, "3 x 3 solutions are the shortest") ;
+	Check(farthest == 31, "no 3 x 3 board is more than 31 moves away") ;
+}
+
+static bool SameTables(const PatternDatabase& a, const PatternDatabase& b)
+{
+	if (a.GroupCount() != b.GroupCount() || a.Width() != b.Width() || a.GroupSize() != b.GroupSize())
+	{
+		return false ;
+	}
+
+	// Every placement of the tiles of each group, spot checked
+	unsigned char cells[25] ;
+	int count = a.Width() * a.Height() ;
+	for (unsigned int seed = 0; seed < 10000; ++seed)
+	{
+		int tiles[25] ;
+		ShuffleSwapBoard(tiles, count, seed) ;
+		for (int cell = 0; cell < count; ++cell)
+		{
+			cells[tiles[cell]] = (unsigned char)cell ;
+		}
+		if (a.Heuristic(cells) != b.Heuristic(cells))
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+static void LoadDatabase(const Layout& layout, PatternDatabase& database, ThreadPool& pool)
+{
+	Timer timer ;
+	if (database.Load(layout.file) && database.Width() == layout.width && database.Height() == layout.height &&
+		database.GroupSize() == layout.groupSize)
+	{
+		printf("%dx%d: loaded %d tables of %d tiles from %s in %.1f ms\n", layout.width, layout.height,
+			   database.GroupCount(), layout.groupSize, layout.file, timer.ElapsedMs()) ;
+		return ;
+	}
+
+	bool built = database.Build(layout.width, layout.height, layout.groupSize, &pool) ;
+	printf("%dx%d: built %d tables of %d tiles in %.1f ms on %d threads\n", layout.width, layout.height,
+		   database.GroupCount(), layout.groupSize, timer.ElapsedMs(), pool.ThreadCount()) ;
+	Check(built, "the pattern database is built") ;
+	Check(database.Save(layout.file), "the pattern database is saved") ;
+
+	PatternDatabase loaded ;
+	Check(loaded.Load(layout.file) && SameTables(database, loaded), "saved tables load back the same") ;
+}
+
+static void SolveInstances(const PatternDatabase& database, int maxThreads)
+{
+	printf("%-6s %6s %8s %14s %12s %10s\n", "board", "moves", "threads", "nodes", "time", "Mnodes/s") ;
+
+	PuzzleSolver solver(database) ;
+	for (size_t i = 0; i < sizeof(INSTANCES) / sizeof(INSTANCES[0]); ++i)
+	{
+		const Instance& instance = INSTANCES[i] ;
+		if (instance.width != database.Width() || instance.height != database.Height())
+		{
+			continue ;
+		}
+
+		std::vector<int> first ;
+		for (int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			ThreadPool pool(threads) ;
+			std::vector<int> moves ;
+			Timer timer ;
+			bool solved = solver.Solve(instance.tiles, moves, threads > 1 ? &pool : NULL) ;
+			double ms = timer.ElapsedMs() ;
+
+			char name[16] ;
+			sprintf(name, "#%d", (int)i + 1) ;
+			printf("%-6s %6d %8d %14llu %9.1f ms %10.1f\n", name, (int)moves.size(), threads, solver.NodeCount(),
+				   ms, ms > 0.0 ? solver.NodeCount() / ms / 1000.0 : 0.0) ;
+
+			Check(solved && (int)moves.size() == instance.moves, "the solution is a shortest one") ;
+			Check(Replay(instance.tiles, instance.width, instance.height, moves), "the solution solves the board") ;
+			if (threads == 1)
+			{
+				first = moves ;
+			}
+			Check(moves == first, "the solution does not depend on the thread count") ;
+		}
+	}
+	printf("\n") ;
+}
+
+int main()
+{
+	TestSwapBoards() ;
+	TestSlidingShuffles() ;
+
+	ThreadPool pool ;
+	for (size_t i = 0; i < sizeof(LAYOUTS) / sizeof(LAYOUTS[0]); ++i)
+	{
+		PatternDatabase database ;
+		LoadDatabase(LAYOUTS[i], database, pool) ;
+		if (database.Width() == 3)
+		{
+			TestSmallBoards(database) ;
+		}
+		else
+		{
+			// Two threads at least, to check the solution does not change
+			SolveInstances(database, pool.ThreadCount() > 2 ? pool.ThreadCount() : 2) ;
+		}
+	}
+
+	if (g_Failures)
+	{
+		printf("%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("All checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,301 @@
+/*
+Benchmark and self check for TriangleBatch in Common/Math.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 RayBenchmark.cpp -o RayBenchmark
+	g++ -std=c++11 -O2 -mavx2 RayBenchmark.cpp -o RayBenchmark
+
+Builds a sphere the way D3DXCreateSphere lays it out, the mesh the picking demo tests,
+with a few hundred loose triangles around it, and casts a screen of rays at it from a
+camera. Checks that TriangleBatch finds the hit a loop of RayTriangle over every
+triangle finds, for one ray at a time and for packets of rays, and then reports
+millions of ray triangle tests per second for the three. Exits with a non-zero code if
+a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "../../Math/TriangleBatch.h"
+#include "../../Utility/Timer.h"
+
+static const int SLICES = 48 ;
+static const int STACKS = 24 ;
+static const int LOOSE_TRIANGLES = 400 ;
+static const int SCREEN_SIZE = 128 ;
+static const int ROUNDS = 4 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / (float)RAND_MAX ;
+}
+
+static Vec3 RandomVec3(float range)
+{
+	return Vec3(Random(-range, range), Random(-range, range), Random(-range, range)) ;
+}
+
+static bool Near(float a, float b, float tolerance)
+{
+	return fabsf(a - b) <= tolerance * (1.0f + fabsf(a) + fabsf(b)) ;
+}
+
+struct Triangle
+{
+	Vec3 v0 ;
+	Vec3 v1 ;
+	Vec3 v2 ;
+} ;
+
+struct Scene
+{
+	std::vector<Vec3> vertices ;
+	std::vector<unsigned short> indices ;
+	std::vector<Triangle> triangles ;	// The same triangles unindexed, for the reference loop
+	std::vector<Ray3> rays ;
+} ;
+
+static Scene MakeScene()
+{
+	Scene scene ;
+
+	// A unit sphere, poles and rings of vertices around the y axis
+	scene.vertices.push_back(Vec3(0.0f, 1.0f, 0.0f)) ;
+	for (int stack = 1; stack < STACKS; ++stack)
+	{
+		float phi = MATH_PI * stack / STACKS ;
+		for (int slice = 0; slice < SLICES; ++slice)
+		{
+			float theta = 2.0f * MATH_PI * slice / SLICES ;
+			scene.vertices.push_back(Vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta))) ;
+		}
+	}
+	scene.vertices.push_back(Vec3(0.0f, -1.0f, 0.0f)) ;
+
+	unsigned short bottom = (unsigned short)(scene.vertices.size() - 1) ;
+	for (int slice = 0; slice < SLICES; ++slice)
+	{
+		unsigned short next = (unsigned short)((slice + 1) % SLICES) ;
+		unsigned short top[3] = { 0, (unsigned short)(1 + next), (unsigned short)(1 + slice) } ;
+		scene.indices.insert(scene.indices.end(), top, top + 3) ;
+
+		for (int stack = 0; stack < STACKS - 2; ++stack)
+		{
+			unsigned short a = (unsigned short)(1 + stack * SLICES + slice) ;
+			unsigned short b = (unsigned short)(1 + stack * SLICES + next) ;
+			unsigned short quad[6] = { a, b, (unsigned short)(a + SLICES), b, (unsigned short)(b + SLICES), (unsigned short)(a + SLICES) } ;
+			scene.indices.insert(scene.indices.end(), quad, quad + 6) ;
+		}
+
+		unsigned short ring = (unsigned short)(1 + (STACKS - 2) * SLICES) ;
+		unsigned short end[3] = { bottom, (unsigned short)(ring + slice), (unsigned short)(ring + next) } ;
+		scene.indices.insert(scene.indices.end(), end, end + 3) ;
+	}
+
+	for (size_t i = 0; i < scene.indices.size(); i += 3)
+	{
+		Triangle triangle = { scene.vertices[scene.indices[i]], scene.vertices[scene.indices[i + 1]], scene.vertices[scene.indices[i + 2]] } ;
+		scene.triangles.push_back(triangle) ;
+	}
+
+	// Loose triangles in front of and around the sphere
+	for (int i = 0; i < LOOSE_TRIANGLES; ++i)
+	{
+		Vec3 center = RandomVec3(2.0f) ;
+		Triangle triangle = { center + RandomVec3(0.3f), center + RandomVec3(0.3f), center + RandomVec3(0.3f) } ;
+		scene.triangles.push_back(triangle) ;
+	}
+
+	// A screen of rays from a camera looking at the origin
+	Vec3 eye(0.3f, 0.5f, -6.0f) ;
+	for (int y = 0; y < SCREEN_SIZE; ++y)
+	{
+		for (int x = 0; x < SCREEN_SIZE; ++x)
+		{
+			Vec3 target(4.0f * x / SCREEN_SIZE - 2.0f, 2.0f - 4.0f * y / SCREEN_SIZE, 0.0f) ;
+			scene.rays.push_back(Ray3(eye, Vec3Normalize(target - eye))) ;
+		}
+	}
+	return scene ;
+}
+
+static TriangleBatch MakeBatch(const Scene& scene)
+{
+	TriangleBatch batch ;
+	size_t sphereTriangles = scene.indices.size() / 3 ;
+	batch.AddIndexed(&scene.vertices[0], sizeof(Vec3), &scene.indices[0], sphereTriangles) ;
+	for (size_t i = sphereTriangles; i < scene.triangles.size(); ++i)
+	{
+		const Triangle& triangle = scene.triangles[i] ;
+		batch.Add(triangle.v0, triangle.v1, triangle.v2, (unsigned int)i) ;
+	}
+	return batch ;
+}
+
+// The nearest hit by testing every triangle, what the demos would otherwise do
+static bool ReferenceIntersect(const std::vector<Triangle>& triangles, const Ray3& ray, RayHit& hit)
+{
+	hit.t = FLT_MAX ;
+	hit.id = TRIANGLE_NONE ;
+	for (size_t i = 0; i < triangles.size(); ++i)
+	{
+		float t, u, v ;
+		if (RayTriangle(ray, triangles[i].v0, triangles[i].v1, triangles[i].v2, t, u, v) && t < hit.t)
+		{
+			hit.t = t ;
+			hit.u = u ;
+			hit.v = v ;
+			hit.id = (unsigned int)i ;
+		}
+	}
+	return hit.id != TRIANGLE_NONE ;
+}
+
+// A hit on another triangle only counts as the same at the same distance, a ray
+// through a shared edge may take either side
+static bool SameHit(const RayHit& a, const RayHit& b)
+{
+	if (a.id == TRIANGLE_NONE || b.id == TRIANGLE_NONE)
+	{
+		return a.id == b.id ;
+	}
+	if (a.id != b.id)
+	{
+		return Near(a.t, b.t, 1e-5f) ;
+	}
+	return Near(a.t, b.t, 1e-5f) && Near(a.u, b.u, 1e-4f) && Near(a.v, b.v, 1e-4f) ;
+}
+
+static void CheckBatch(const Scene& scene, const TriangleBatch& batch)
+{
+	Check(batch.Count() == scene.triangles.size(), "every triangle added") ;
+
+	std::vector<RayHit> packetHits(scene.rays.size()) ;
+	size_t packetHitCount = batch.Intersect(&scene.rays[0], scene.rays.size(), &packetHits[0]) ;
+
+	int hits = 0 ;
+	int single = 0 ;
+	int packets = 0 ;
+	for (size_t i = 0; i < scene.rays.size(); ++i)
+	{
+		RayHit reference ;
+		hits += ReferenceIntersect(scene.triangles, scene.rays[i], reference) ? 1 : 0 ;
+
+		RayHit hit = { FLT_MAX, 0.0f, 0.0f, TRIANGLE_NONE } ;
+		batch.Intersect(scene.rays[i], hit) ;
+		single += SameHit(hit, reference) ? 0 : 1 ;
+		packets += SameHit(packetHits[i], reference) ? 0 : 1 ;
+	}
+	printf("%d of %d rays hit, %d single and %d packet rays disagree with RayTriangle\n",
+		   hits, (int)scene.rays.size(), single, packets) ;
+	Check(hits > (int)scene.rays.size() / 4 && hits < (int)scene.rays.size(), "a mix of hits and misses") ;
+	Check(single == 0, "single rays find the RayTriangle hits") ;
+	Check(packets == 0, "ray packets find the RayTriangle hits") ;
+	Check((int)packetHitCount == hits, "ray packets count their hits") ;
+
+	// maxT cuts off farther hits, the sphere is 5 or more away
+	RayHit hit ;
+	Ray3 center(Vec3(0.0f, 0.0f, -6.0f), Vec3(0.0f, 0.0f, 1.0f)) ;
+	TriangleBatch sphere ;
+	sphere.AddIndexed(&scene.vertices[0], sizeof(Vec3), &scene.indices[0], scene.indices.size() / 3, 100) ;
+	Check(sphere.Intersect(center, hit) && Near(hit.t, 5.0f, 1e-2f) && hit.id >= 100, "hit the near side of the sphere") ;
+	Check(!sphere.Intersect(center, hit, 4.0f), "maxT") ;
+
+	// Tails shorter than a packet, and an empty batch
+	TriangleBatch one ;
+	one.Add(Vec3(-1.0f, -1.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(1.0f, -1.0f, 0.0f), 7) ;
+	Check(one.Intersect(center, hit) && hit.id == 7 && Near(hit.t, 6.0f, 1e-6f), "a single triangle") ;
+	Ray3 three[3] = { center, Ray3(Vec3(5.0f, 0.0f, -6.0f), Vec3(0.0f, 0.0f, 1.0f)), center } ;
+	RayHit threeHits[3] ;
+	Check(one.Intersect(three, 3, threeHits) == 2 && threeHits[1].id == TRIANGLE_NONE && threeHits[2].id == 7, "a short ray packet") ;
+	TriangleBatch empty ;
+	Check(!empty.Intersect(center, hit) && empty.Intersect(three, 3, threeHits) == 0, "an empty batch") ;
+}
+
+static volatile float g_Sink ;
+
+static void PrintRate(const char* name, double count, double ms, double baselineMs)
+{
+	printf("%-36s %10.1f %10.2fx\n", name, count / ms / 1000.0, baselineMs / ms) ;
+}
+
+static void Measure(const Scene& scene, const TriangleBatch& batch)
+{
+	double tests = (double)ROUNDS * scene.rays.size() * scene.triangles.size() ;
+	std::vector<RayHit> hits(scene.rays.size()) ;
+
+	printf("\n%-36s %10s %10s\n", "", "M tests/s", "speedup") ;
+
+	Timer timer ;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < scene.rays.size(); ++i)
+		{
+			ReferenceIntersect(scene.triangles, scene.rays[i], hits[i]) ;
+		}
+		g_Sink = hits[round].t ;
+	}
+	double baseline = timer.ElapsedMs() ;
+	PrintRate("RayTriangle loop", tests, baseline, baseline) ;
+
+	timer.Restart() ;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		for (size_t i = 0; i < scene.rays.size(); ++i)
+		{
+			batch.Intersect(scene.rays[i], hits[i]) ;
+		}
+		g_Sink = hits[round].t ;
+	}
+	PrintRate("TriangleBatch, one ray", tests, timer.ElapsedMs(), baseline) ;
+
+	timer.Restart() ;
+	for (int round = 0; round < ROUNDS; ++round)
+	{
+		batch.Intersect(&scene.rays[0], scene.rays.size(), &hits[0]) ;
+		g_Sink = hits[round].t ;
+	}
+	PrintRate("TriangleBatch, ray packets", tests, timer.ElapsedMs(), baseline) ;
+}
+
+int main()
+{
+	srand(11) ;
+	Scene scene = MakeScene() ;
+	TriangleBatch batch = MakeBatch(scene) ;
+
+#if defined(SIMD_AVX2)
+	printf("backend: AVX2, %d lanes\n", (int)TRIANGLE_PACKET_SIZE) ;
+#elif defined(SIMD_SSE2)
+	printf("backend: SSE2, %d lanes\n", (int)TRIANGLE_PACKET_SIZE) ;
+#elif defined(SIMD_NEON)
+	printf("backend: NEON, %d lanes\n", (int)TRIANGLE_PACKET_SIZE) ;
+#else
+	printf("backend: scalar, %d lanes\n", (int)TRIANGLE_PACKET_SIZE) ;
+#endif
+	printf("%d triangles, %d rays\n", (int)scene.triangles.size(), (int)scene.rays.size()) ;
+
+	CheckBatch(scene, batch) ;
+	Measure(scene, batch) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
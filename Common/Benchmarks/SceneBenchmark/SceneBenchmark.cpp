@@ -0,0 +1,378 @@
+/*
+Benchmark and self check for the dirty region repaint in Common/Scene.
+
+Runs on any machine, including Linux:
+	g++ -O2 -I../../Scene SceneBenchmark.cpp ../../Scene/RetainedScene.cpp -o SceneBenchmark
+
+Plays the changes of the Direct2D demos on a 600 x 600 target: two pieces of a puzzle
+swapped per frame for grids of 4 x 4 to 25 x 25, the three hands of the clock ticking
+and, for a harder case, boxes moving all over the target. Every frame is drawn once as
+the demos used to, clearing and drawing everything, and once through a RetainedScene
+that draws only its dirty region, in a renderer that fills rectangles and thick lines.
+
+Reports the pixels and the time per frame of both. Exits with a non-zero code if a
+frame drawn through the dirty region differs from the full one, the region has more
+than MAX_DIRTY_RECTS rectangles, two of them overlap, or its pixel count is not the
+number of pixels it covers.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "RetainedScene.h"
+#include "../../Utility/Timer.h"
+
+static const int TARGET_SIZE = 600 ;
+static const int FRAMES = 200 ;
+static const unsigned int BACKGROUND = 0xFFFFFFFF ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+// A filled rectangle, or a line of the given width from (x0, y0) to (x1, y1)
+struct Item
+{
+	bool line ;
+	float x0, y0, x1, y1 ;
+	float width ;
+	unsigned int colour ;
+
+	SceneRect Bounds() const
+	{
+		float margin = line ? width / 2 + 1.f : 0.f ;
+		SceneRect bounds = { (x0 < x1 ? x0 : x1) - margin, (y0 < y1 ? y0 : y1) - margin,
+							 (x0 > x1 ? x0 : x1) + margin, (y0 > y1 ? y0 : y1) + margin } ;
+		return bounds ;
+	}
+};
+
+struct Target
+{
+	std::vector<unsigned int> pixels ;
+
+	Target() : pixels(TARGET_SIZE * TARGET_SIZE, 0) {}
+
+	// Draw an item into the pixels of clip, a pixel belongs to a shape when its centre does
+	void Draw(const Item& item, const DirtyRect& clip)
+	{
+		SceneRect b = item.Bounds() ;
+		int left = (int)floor(b.left) > clip.left ? (int)floor(b.left) : clip.left ;
+		int top = (int)floor(b.top) > clip.top ? (int)floor(b.top) : clip.top ;
+		int right = (int)ceil(b.right) < clip.right ? (int)ceil(b.right) : clip.right ;
+		int bottom = (int)ceil(b.bottom) < clip.bottom ? (int)ceil(b.bottom) : clip.bottom ;
+
+		float dx = item.x1 - item.x0 ;
+		float dy = item.y1 - item.y0 ;
+		float length2 = dx * dx + dy * dy ;
+		for (int y = top; y < bottom; ++y)
+		{
+			unsigned int* row = &pixels[y * TARGET_SIZE] ;
+			for (int x = left; x < right; ++x)
+			{
+				float px = x + 0.5f ;
+				float py = y + 0.5f ;
+				if (item.line)
+				{
+					float t = length2 > 0.f ? ((px - item.x0) * dx + (py - item.y0) * dy) / length2 : 0.f ;
+					t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t) ;
+					float ex = item.x0 + t * dx - px ;
+					float ey = item.y0 + t * dy - py ;
+					if (ex * ex + ey * ey > item.width * item.width / 4)
+					{
+						continue ;
+					}
+				}
+				else if (px < b.left || px > b.right || py < b.top || py > b.bottom)
+				{
+					continue ;
+				}
+				row[x] = item.colour ;
+			}
+		}
+	}
+
+	void Clear(const DirtyRect& clip)
+	{
+		for (int y = clip.top; y < clip.bottom; ++y)
+		{
+			for (int x = clip.left; x < clip.right; ++x)
+			{
+				pixels[y * TARGET_SIZE + x] = BACKGROUND ;
+			}
+		}
+	}
+};
+
+// What the demos did: clear everything and draw every item
+static void DrawAll(Target& target, const std::vector<Item>& items)
+{
+	DirtyRect all = { 0, 0, TARGET_SIZE, TARGET_SIZE } ;
+	target.Clear(all) ;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		target.Draw(items[i], all) ;
+	}
+}
+
+// The frame of the demos now: per dirty rectangle clear it and draw the items touching it
+static void DrawDirty(Target& target, const std::vector<Item>& items, RetainedScene& scene)
+{
+	const DirtyRegion& dirty = scene.Dirty() ;
+	for (int r = 0; r < dirty.Count(); ++r)
+	{
+		target.Clear(dirty.Rect(r)) ;
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			if (scene.IsItemDirty((int)i))
+			{
+				target.Draw(items[i], dirty.Rect(r)) ;
+			}
+		}
+	}
+	scene.EndFrame() ;
+}
+
+// The rectangles do not overlap, and the pixel count is what they cover
+static bool IsRegionValid(const DirtyRegion& region)
+{
+	if (region.Count() > MAX_DIRTY_RECTS)
+	{
+		return false ;
+	}
+
+	std::vector<unsigned char> covered(TARGET_SIZE * TARGET_SIZE, 0) ;
+	unsigned int count = 0 ;
+	for (int r = 0; r < region.Count(); ++r)
+	{
+		const DirtyRect& rect = region.Rect(r) ;
+		for (int y = rect.top; y < rect.bottom; ++y)
+		{
+			for (int x = rect.left; x < rect.right; ++x)
+			{
+				if (covered[y * TARGET_SIZE + x]++)
+				{
+					return false ;
+				}
+				++count ;
+			}
+		}
+	}
+	return count == region.PixelCount() ;
+}
+
+// A demo: the items, and a function that changes them for the next frame and returns
+// the items that changed
+typedef void (*Change)(std::vector<Item>& items, int frame, std::vector<int>& changed) ;
+
+static void Run(const char* name, std::vector<Item>& items, Change change)
+{
+	Target full ;
+	Target dirty ;
+	RetainedScene scene ;
+	scene.Reset(TARGET_SIZE, TARGET_SIZE) ;
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		scene.AddItem(items[i].Bounds()) ;
+	}
+
+	double fullMs = 0.0 ;
+	double dirtyMs = 0.0 ;
+	bool same = true ;
+	bool valid = true ;
+	unsigned long long fullPixels = 0 ;
+	std::vector<int> changed ;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		Timer timer ;
+		DrawAll(full, items) ;
+		fullMs += timer.ElapsedMs() ;
+		fullPixels += TARGET_SIZE * TARGET_SIZE ;
+
+		valid = valid && IsRegionValid(scene.Dirty()) ;
+		timer.Restart() ;
+		DrawDirty(dirty, items, scene) ;
+		dirtyMs += timer.ElapsedMs() ;
+		same = same && full.pixels == dirty.pixels ;
+
+		changed.clear() ;
+		change(items, frame, changed) ;
+		for (size_t i = 0; i < changed.size(); ++i)
+		{
+			scene.MoveItem(changed[i], items[changed[i]].Bounds()) ;
+			scene.InvalidateItem(changed[i]) ;
+		}
+	}
+
+	// The first frame draws everything in both
+	printf("%-14s %12.0f %12.0f %9.3f ms %9.3f ms\n", name, (double)fullPixels / FRAMES,
+		   (double)scene.TotalPixels() / scene.FrameCount(), fullMs / FRAMES, dirtyMs / FRAMES) ;
+
+	Check(same, "frames drawn through the dirty region match full frames") ;
+	Check(valid, "dirty rectangles do not overlap, stay below MAX_DIRTY_RECTS and count their pixels") ;
+}
+
+static int g_Grid = 0 ;
+
+static void SwapPieces(std::vector<Item>& items, int frame, std::vector<int>& changed)
+{
+	int cells = g_Grid * g_Grid ;
+	int a = (frame * 7919 + 13) % cells ;
+	int b = (frame * 104729 + 7) % cells ;
+	if (a != b)
+	{
+		unsigned int colour = items[a].colour ;
+		items[a].colour = items[b].colour ;
+		items[b].colour = colour ;
+		changed.push_back(a) ;
+		changed.push_back(b) ;
+	}
+}
+
+static void Puzzle(int grid)
+{
+	g_Grid = grid ;
+	std::vector<Item> items ;
+	int size = TARGET_SIZE / grid ;
+	for (int i = 0; i < grid * grid; ++i)
+	{
+		Item cell = { false, (float)(i % grid * size), (float)(i / grid * size), (float)(i % grid * size + size),
+					  (float)(i / grid * size + size), 0.f, 0xFF000000u | (i * 2654435761u >> 8) } ;
+		items.push_back(cell) ;
+	}
+
+	char name[32] ;
+	sprintf(name, "puzzle %dx%d", grid, grid) ;
+	Run(name, items, SwapPieces) ;
+}
+
+// Rotate the hands about the centre by 6, 0.1 and 1/120 degrees a tick as the clock does
+static void Tick(std::vector<Item>& items, int /*frame*/, std::vector<int>& changed)
+{
+	static const float degrees[3] = { 6.f, 0.1f, 1.f / 120 } ;
+	float centre = TARGET_SIZE / 2.f ;
+	for (int hand = 0; hand < 3; ++hand)
+	{
+		Item& item = items[1 + hand] ;
+		float angle = degrees[hand] * 3.14159265f / 180 ;
+		float c = cosf(angle) ;
+		float s = sinf(angle) ;
+		float x0 = item.x0 - centre, y0 = item.y0 - centre ;
+		float x1 = item.x1 - centre, y1 = item.y1 - centre ;
+		item.x0 = centre + x0 * c - y0 * s ;
+		item.y0 = centre + x0 * s + y0 * c ;
+		item.x1 = centre + x1 * c - y1 * s ;
+		item.y1 = centre + x1 * s + y1 * c ;
+		changed.push_back(1 + hand) ;
+	}
+}
+
+static void Clock()
+{
+	std::vector<Item> items ;
+	Item face = { false, 10.f, 10.f, TARGET_SIZE - 10.f, TARGET_SIZE - 10.f, 0.f, 0xFF228B22u } ;
+	Item second = { true, 300.f, 20.f, 300.f, 395.f, 5.f, 0xFFFF0000u } ;
+	Item minute = { true, 300.f, 90.f, 300.f, 345.f, 10.f, 0xFF000000u } ;
+	Item hour = { true, 300.f, 160.f, 300.f, 325.f, 15.f, 0xFF000000u } ;
+	items.push_back(face) ;
+	items.push_back(second) ;
+	items.push_back(minute) ;
+	items.push_back(hour) ;
+	Run("clock", items, Tick) ;
+}
+
+// Every box hops a few pixels each frame
+static void Wander(std::vector<Item>& items, int frame, std::vector<int>& changed)
+{
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		float dx = (float)((frame * 31 + i * 17) % 11) - 5.f ;
+		float dy = (float)((frame * 13 + i * 29) % 11) - 5.f ;
+		if (items[i].x0 + dx < 0 || items[i].x1 + dx > TARGET_SIZE)
+		{
+			dx = -dx ;
+		}
+		if (items[i].y0 + dy < 0 || items[i].y1 + dy > TARGET_SIZE)
+		{
+			dy = -dy ;
+		}
+		items[i].x0 += dx ;
+		items[i].x1 += dx ;
+		items[i].y0 += dy ;
+		items[i].y1 += dy ;
+		changed.push_back((int)i) ;
+	}
+}
+
+static void Boxes()
+{
+	std::vector<Item> items ;
+	srand(1) ;
+	for (int i = 0; i < 40; ++i)
+	{
+		float x = 10.f + rand() % 540 ;
+		float y = 10.f + rand() % 540 ;
+		Item box = { false, x, y, x + 10.f + rand() % 40, y + 10.f + rand() % 40, 0.f, 0xFF000000u | (i * 2654435761u >> 8) } ;
+		items.push_back(box) ;
+	}
+	Run("40 boxes", items, Wander) ;
+}
+
+static void TestRegion()
+{
+	DirtyRegion region ;
+	region.Reset(100, 100) ;
+
+	SceneRect outside = { -50.f, -50.f, -1.f, -1.f } ;
+	region.Add(outside) ;
+	Check(region.IsEmpty(), "rectangles outside the target are dropped") ;
+
+	SceneRect partial = { 10.25f, 10.75f, 19.5f, 20.f } ;
+	region.Add(partial) ;
+	Check(region.Count() == 1 && region.PixelCount() == 100, "parts of pixels count as whole pixels") ;
+
+	// Two rectangles far apart stay apart, one next to another joins it
+	SceneRect far = { 80.f, 80.f, 90.f, 90.f } ;
+	SceneRect next = { 20.f, 10.f, 30.f, 20.f } ;
+	region.Add(far) ;
+	Check(region.Count() == 2, "distant rectangles are kept apart") ;
+	region.Add(next) ;
+	Check(region.Count() == 2 && region.PixelCount() == 300, "neighbouring rectangles are merged") ;
+
+	SceneRect inside = { 12.f, 12.f, 14.f, 14.f } ;
+	Check(region.Intersects(inside) && !region.Intersects(outside), "Intersects tests the dirty pixels") ;
+
+	region.AddAll() ;
+	Check(region.Count() == 1 && region.PixelCount() == 10000, "AddAll covers the target") ;
+}
+
+int main()
+{
+	TestRegion() ;
+
+	printf("%dx%d target, %d frames\n\n", TARGET_SIZE, TARGET_SIZE, FRAMES) ;
+	printf("%-14s %12s %12s %12s %12s\n", "", "full pixels", "dirty pixels", "full", "dirty") ;
+	Puzzle(4) ;
+	Puzzle(10) ;
+	Puzzle(25) ;
+	Clock() ;
+	Boxes() ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
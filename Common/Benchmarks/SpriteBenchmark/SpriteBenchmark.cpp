@@ -0,0 +1,247 @@
+/*
+Benchmark and self check for SpriteAtlas and SpriteBatch in Common/Image.
+
+Runs on any machine, including Linux:
+	g++ -O2 -I../../Image SpriteBenchmark.cpp ../../Image/SpriteBatch.cpp ../../Image/ImageReader.cpp \
+		../../Image/JpegDecoder.cpp ../../Image/PixelConvert.cpp ../../Image/Inflate.cpp \
+		../../Image/Deflate.cpp -o SpriteBenchmark
+
+Cuts a picture into puzzle grids of 4x4 up to 50x50 pieces and draws them shuffled, once
+the way PuzzlePanel and JigsawPuzzle used to, a bitmap per piece copied out of the
+picture and one draw per piece, once as regions of the picture drawn in one batch. The
+CPU renderer stands in for Direct2D, so the frame times only show the cost per call and
+per bitmap; on a GPU every bitmap switch also ends a batch, which the "switches" column
+counts.
+
+Exits with a non-zero code if the two ways draw different frames or the grid regions do
+not tile the picture.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "SpriteBatch.h"
+#include "../../Utility/Timer.h"
+
+static const int PICTURE_WIDTH = 1024 ;
+static const int PICTURE_HEIGHT = 768 ;
+static const int TARGET_SIZE = 600 ;		// the window of the puzzle demos
+static const int FRAMES = 60 ;
+static const int LOADS = 20 ;
+static const int GRIDS[] = { 4, 10, 25, 50 } ;
+
+static int g_Failures = 0 ;
+
+// Keeps the compiler from dropping the draw loops
+static volatile unsigned int g_Sink = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static void MakePicture(DecodedImage& picture)
+{
+	picture.Allocate(PICTURE_WIDTH, PICTURE_HEIGHT, PIXEL_BGRX) ;
+	for (int y = 0; y < PICTURE_HEIGHT; ++y)
+	{
+		unsigned char* row = picture.Row(y) ;
+		for (int x = 0; x < PICTURE_WIDTH; ++x)
+		{
+			row[x * 4 + 0] = (unsigned char)x ;
+			row[x * 4 + 1] = (unsigned char)y ;
+			row[x * 4 + 2] = (unsigned char)(x ^ y) ;
+			row[x * 4 + 3] = 255 ;
+		}
+	}
+}
+
+// The cell every piece is drawn in, shuffled the same way for both renderers
+static void Shuffle(std::vector<int>& cells, int count)
+{
+	cells.resize(count) ;
+	for (int i = 0; i < count; ++i)
+	{
+		cells[i] = i ;
+	}
+	srand(1) ;
+	for (int i = count - 1; i > 0; --i)
+	{
+		int j = rand() % (i + 1) ;
+		int temp = cells[i] ;
+		cells[i] = cells[j] ;
+		cells[j] = temp ;
+	}
+}
+
+static unsigned int Hash(const DecodedImage& image)
+{
+	unsigned int hash = 2166136261u ;
+	for (size_t i = 0; i < image.pixels.size(); ++i)
+	{
+		hash = (hash ^ image.pixels[i]) * 16777619u ;
+	}
+	return hash ;
+}
+
+// What CreateD2DResource did: one bitmap per piece, the piece copied into it
+static void LoadPieces(const DecodedImage& picture, int grid, std::vector<DecodedImage>& pieces)
+{
+	int pieceWidth = picture.width / grid ;
+	int pieceHeight = picture.height / grid ;
+	pieces.clear() ;
+	pieces.resize(grid * grid) ;
+	for (int i = 0; i < grid * grid; ++i)
+	{
+		DecodedImage& piece = pieces[i] ;
+		piece.Allocate(pieceWidth, pieceHeight, picture.format) ;
+		for (int y = 0; y < pieceHeight; ++y)
+		{
+			const unsigned char* src = picture.Row((i / grid) * pieceHeight + y) + (i % grid) * pieceWidth * 4 ;
+			memcpy(piece.Row(y), src, pieceWidth * 4) ;
+		}
+	}
+}
+
+static Sprite CellSprite(const SpriteRect& source, int cell, int grid)
+{
+	int cellSize = TARGET_SIZE / grid ;
+	Sprite sprite =
+	{
+		source,
+		(float)((cell % grid) * cellSize),
+		(float)((cell / grid) * cellSize),
+		(float)((cell % grid + 1) * cellSize),
+		(float)((cell / grid + 1) * cellSize)
+	} ;
+	return sprite ;
+}
+
+static void BenchmarkGrid(const DecodedImage& picture, int grid)
+{
+	int count = grid * grid ;
+	std::vector<int> cells ;
+	Shuffle(cells, count) ;
+
+	DecodedImage frame ;
+	frame.Allocate(TARGET_SIZE, TARGET_SIZE, PIXEL_BGRX) ;
+
+	// A bitmap per piece
+	std::vector<DecodedImage> pieces ;
+	Timer timer ;
+	for (int i = 0; i < LOADS; ++i)
+	{
+		LoadPieces(picture, grid, pieces) ;
+	}
+	double pieceLoadMs = timer.ElapsedMs() / LOADS ;
+
+	timer.Restart() ;
+	for (int f = 0; f < FRAMES; ++f)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			SpriteRect whole = { 0, 0, (int)pieces[i].width, (int)pieces[i].height } ;
+			Sprite sprite = CellSprite(whole, cells[i], grid) ;
+			DrawSprites(pieces[i], &sprite, 1, frame) ;
+		}
+	}
+	double pieceFrameMs = timer.ElapsedMs() / FRAMES ;
+	unsigned int pieceHash = Hash(frame) ;
+
+	// Regions of one atlas, one batch
+	memset(&frame.pixels[0], 0, frame.pixels.size()) ;
+	SpriteAtlas atlas ;
+	timer.Restart() ;
+	for (int i = 0; i < LOADS; ++i)
+	{
+		atlas.Reset(picture.width, picture.height) ;
+		atlas.AddGrid(grid, grid) ;
+	}
+	double atlasLoadMs = timer.ElapsedMs() / LOADS ;
+
+	SpriteBatch batch ;
+	timer.Restart() ;
+	for (int f = 0; f < FRAMES; ++f)
+	{
+		batch.Begin() ;
+		for (int i = 0; i < count; ++i)
+		{
+			Sprite sprite = CellSprite(atlas.Region(i), cells[i], grid) ;
+			batch.Add(sprite.source, sprite.destLeft, sprite.destTop, sprite.destRight, sprite.destBottom) ;
+		}
+		DrawSprites(picture, batch.Sprites(), batch.Count(), frame) ;
+	}
+	double atlasFrameMs = timer.ElapsedMs() / FRAMES ;
+	unsigned int atlasHash = Hash(frame) ;
+
+	g_Sink = pieceHash ^ atlasHash ;
+
+	char name[32] ;
+	sprintf(name, "%dx%d", grid, grid) ;
+	printf("%-7s %-15s %9.3f ms %9.3f ms %8d %8d\n", name, "bitmap per piece", pieceLoadMs, pieceFrameMs, count + 1, count) ;
+	printf("%-7s %-15s %9.3f ms %9.3f ms %8d %8d\n", "", "atlas", atlasLoadMs, atlasFrameMs, 1, 1) ;
+
+	Check(pieceHash == atlasHash, "the atlas draws the same frame as the piece bitmaps") ;
+	Check(atlas.Count() == count, "a grid has a region per cell") ;
+}
+
+static void TestAtlas()
+{
+	SpriteAtlas atlas ;
+	atlas.Reset(103, 77) ;
+	int first = atlas.AddGrid(4, 3) ;
+	Check(first == 0 && atlas.Count() == 12, "AddGrid adds columns x rows regions") ;
+
+	// Regions are the same size, side by side without gaps or overlap
+	bool tiled = true ;
+	for (int i = 0; i < atlas.Count(); ++i)
+	{
+		const SpriteRect& r = atlas.Region(i) ;
+		tiled = tiled && r.right - r.left == 103 / 4 && r.bottom - r.top == 77 / 3 ;
+		tiled = tiled && r.left == (i % 4) * (103 / 4) && r.top == (i / 4) * (77 / 3) ;
+	}
+	Check(tiled, "grid regions tile the image") ;
+
+	SpriteRect extra = { 1, 2, 3, 4 } ;
+	Check(atlas.Add(extra) == 12 && atlas.AddGrid(2, 2) == 13 && atlas.Count() == 17, "regions are appended") ;
+
+	// Sprites partly outside the target are clipped
+	DecodedImage image ;
+	DecodedImage target ;
+	image.Allocate(8, 8, PIXEL_BGRX) ;
+	target.Allocate(4, 4, PIXEL_BGRX) ;
+	memset(&image.pixels[0], 0xAB, image.pixels.size()) ;
+	SpriteRect all = { 0, 0, 8, 8 } ;
+	Sprite sprite = { all, -6.0f, -6.0f, 10.0f, 10.0f } ;
+	DrawSprites(image, &sprite, 1, target) ;
+	Check(target.pixels[0] == 0xAB && target.pixels[target.pixels.size() - 1] == 0xAB, "sprites are clipped to the target") ;
+}
+
+int main()
+{
+	DecodedImage picture ;
+	MakePicture(picture) ;
+
+	printf("%dx%d picture on a %dx%d target, %d frames\n\n", PICTURE_WIDTH, PICTURE_HEIGHT, TARGET_SIZE, TARGET_SIZE, FRAMES) ;
+	printf("%-7s %-15s %12s %12s %8s %8s\n", "grid", "", "load", "frame", "bitmaps", "switches") ;
+	for (size_t i = 0; i < sizeof(GRIDS) / sizeof(GRIDS[0]); ++i)
+	{
+		BenchmarkGrid(picture, GRIDS[i]) ;
+	}
+
+	TestAtlas() ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,225 @@
+/*
+Throughput and self check for the teapot tessellator in Common/Math.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 -pthread TeapotBenchmark.cpp ../../Math/Teapot.cpp ../../Utility/ThreadPool.cpp -o TeapotBenchmark
+
+Tessellates the 32 patches at levels 4 to 64 and prints the triangles made per ms on
+one thread and on the pool, and the level Utha_Teapot picks at a few distances.
+
+Checks that the triangles stay within the tolerance the level was picked for, that the
+normals are unit length, match the ones evaluated one at a time and agree with the
+winding of the triangles, that the enclosed volume is positive and converges, and that
+the pool writes the same bytes as one thread. Exits with a non-zero code if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "../../Math/Teapot.h"
+#include "../../Utility/ThreadPool.h"
+#include "../../Utility/Timer.h"
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static Vec3 Position(const TeapotVertex& vertex)
+{
+	return Vec3(vertex.position) ;
+}
+
+static Vec3 Normal(const TeapotVertex& vertex)
+{
+	return Vec3(vertex.normal) ;
+}
+
+static double Volume(const std::vector<TeapotVertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	double volume = 0.0 ;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		Vec3 a = Position(vertices[indices[i]]) ;
+		Vec3 b = Position(vertices[indices[i + 1]]) ;
+		Vec3 c = Position(vertices[indices[i + 2]]) ;
+		volume += Vec3Dot(a, Vec3Cross(b, c)) / 6.0 ;
+	}
+	return volume ;
+}
+
+// The distance from the triangles to the surface at the middle of each cell and of its
+// edges, at the same parameters, which is what the level bound is about
+static float MaxDeviation(int level)
+{
+	float deviation = 0.0f ;
+	static const float SAMPLES[][2] = { { 0.5f, 0.0f }, { 0.0f, 0.5f }, { 0.5f, 0.5f }, { 1.0f / 3, 1.0f / 3 }, { 2.0f / 3, 2.0f / 3 } } ;
+	for (int patch = 0; patch < TEAPOT_PATCH_COUNT; ++patch)
+	{
+		Vec3 points[16] ;
+		TeapotPatch(patch, points) ;
+		for (int i = 0; i < level; ++i)
+		{
+			for (int j = 0; j < level; ++j)
+			{
+				Vec3 corners[4], normal ;
+				EvaluateBezierPatch(points, (float)i / level, (float)j / level, corners[0], normal) ;
+				EvaluateBezierPatch(points, (float)(i + 1) / level, (float)j / level, corners[1], normal) ;
+				EvaluateBezierPatch(points, (float)i / level, (float)(j + 1) / level, corners[2], normal) ;
+				EvaluateBezierPatch(points, (float)(i + 1) / level, (float)(j + 1) / level, corners[3], normal) ;
+				for (int k = 0; k < 5; ++k)
+				{
+					// The triangle the sample falls in, the one on the diagonal from b to c
+					float s = SAMPLES[k][0], t = SAMPLES[k][1] ;
+					Vec3 linear = s + t <= 1.0f ? corners[0] + (corners[1] - corners[0]) * s + (corners[2] - corners[0]) * t
+												: corners[3] + (corners[2] - corners[3]) * (1.0f - s) + (corners[1] - corners[3]) * (1.0f - t) ;
+					Vec3 surface ;
+					EvaluateBezierPatch(points, (i + s) / level, (j + t) / level, surface, normal) ;
+					deviation = std::max(deviation, Vec3Length(surface - linear)) ;
+				}
+			}
+		}
+	}
+	return deviation ;
+}
+
+static void CheckLevels()
+{
+	Check(TeapotLevel(0.0f) == BEZIER_MAX_LEVEL, "no tolerance takes the most triangles") ;
+	Check(TeapotLevel(100.0f) == 1, "a tolerance larger than the teapot takes one cell a patch") ;
+
+	printf("%-10s %6s %10s\n", "tolerance", "level", "deviation") ;
+	static const float TOLERANCES[] = { 0.1f, 0.03f, 0.01f, 0.003f, 0.002f } ;
+	int previous = 0 ;
+	for (int i = 0; i < 5; ++i)
+	{
+		int level = TeapotLevel(TOLERANCES[i]) ;
+		float deviation = MaxDeviation(level) ;
+		printf("%-10g %6d %10.6f\n", TOLERANCES[i], level, deviation) ;
+		Check(level < BEZIER_MAX_LEVEL && deviation <= TOLERANCES[i], "the triangles stay within the tolerance") ;
+		Check(level > previous, "a smaller tolerance takes a higher level") ;
+		previous = level ;
+	}
+
+	// Half a pixel in the window of Utha_Teapot
+	printf("\n%-10s %6s\n", "distance", "level") ;
+	previous = BEZIER_MAX_LEVEL + 1 ;
+	for (float distance = 5.0f; distance <= 80.0f; distance *= 2.0f)
+	{
+		int level = TeapotLevel(ScreenTolerance(0.5f, distance, 3.14159265f / 4, 600)) ;
+		printf("%-10g %6d\n", distance, level) ;
+		Check(level <= previous, "a farther teapot takes a lower level") ;
+		previous = level ;
+	}
+	printf("\n") ;
+}
+
+static void CheckMesh(int level, const std::vector<TeapotVertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	Check(vertices.size() == (size_t)TEAPOT_PATCH_COUNT * (level + 1) * (level + 1), "(level + 1)^2 vertices a patch") ;
+	Check(indices.size() == (size_t)TEAPOT_PATCH_COUNT * level * level * 6, "2 level^2 triangles a patch") ;
+
+	int count = level + 1 ;
+	float unitError = 0.0f, referenceDot = 1.0f ;
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		int patch = (int)(v / (count * count)) ;
+		int i = (int)(v % (count * count)) / count ;
+		int j = (int)(v % count) ;
+		Vec3 points[16], position, normal ;
+		TeapotPatch(patch, points) ;
+		EvaluateBezierPatch(points, (float)i / level, (float)j / level, position, normal) ;
+
+		unitError = std::max(unitError, fabsf(Vec3Length(Normal(vertices[v])) - 1.0f)) ;
+		referenceDot = std::min(referenceDot, Vec3Dot(Normal(vertices[v]), normal)) ;
+		if (Vec3Length(Position(vertices[v]) - position) > 1e-5f)
+		{
+			Check(false, "the grid matches the points evaluated one at a time") ;
+			break ;
+		}
+	}
+	Check(unitError < 1e-5f, "the normals are unit length") ;
+	Check(referenceDot > 0.99999f, "the normals match the ones evaluated one at a time") ;
+
+	// The triangles at a collapsed edge have no area and no direction of their own
+	int against = 0 ;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const TeapotVertex& a = vertices[indices[i]] ;
+		const TeapotVertex& b = vertices[indices[i + 1]] ;
+		const TeapotVertex& c = vertices[indices[i + 2]] ;
+		Vec3 face = Vec3Cross(Position(b) - Position(a), Position(c) - Position(a)) ;
+		if (Vec3LengthSq(face) > 1e-12f && Vec3Dot(face, Normal(a) + Normal(b) + Normal(c)) <= 0.0f)
+		{
+			++against ;
+		}
+	}
+	Check(against == 0, "the triangles wind counterclockwise around the normals") ;
+}
+
+// Runs the tessellation until enough time passed, returns the best ms
+static double Measure(int level, std::vector<TeapotVertex>& vertices, std::vector<unsigned int>& indices, ThreadPool* pPool)
+{
+	double best = 1e9, total = 0.0 ;
+	for (int run = 0; run < 3 || (total < 100.0 && run < 1000); ++run)
+	{
+		Timer timer ;
+		TessellateTeapot(level, vertices, indices, pPool) ;
+		double ms = timer.ElapsedMs() ;
+		best = std::min(best, ms) ;
+		total += ms ;
+	}
+	return best ;
+}
+
+int main()
+{
+	CheckLevels() ;
+
+	ThreadPool pool ;
+	printf("%-6s %9s %9s %9s %11s %9s %11s %9s\n", "level", "vertices", "tris", "1 thread", "tris/ms", "pool", "tris/ms", "volume") ;
+
+	double previousVolume = 0.0, previousChange = 0.0 ;
+	for (int level = 4; level <= BEZIER_MAX_LEVEL; level *= 2)
+	{
+		std::vector<TeapotVertex> vertices, pooledVertices ;
+		std::vector<unsigned int> indices, pooledIndices ;
+		double serialMs = Measure(level, vertices, indices, NULL) ;
+		double poolMs = Measure(level, pooledVertices, pooledIndices, &pool) ;
+		double triangles = (double)(indices.size() / 3) ;
+		double volume = Volume(vertices, indices) ;
+		printf("%-6d %9u %9u %9.3f %11.0f %9.3f %11.0f %9.4f\n", level, (unsigned int)vertices.size(), (unsigned int)triangles,
+			   serialMs, triangles / serialMs, poolMs, triangles / poolMs, volume) ;
+
+		Check(pooledVertices.size() == vertices.size() && pooledIndices == indices &&
+			  memcmp(&pooledVertices[0], &vertices[0], vertices.size() * sizeof(TeapotVertex)) == 0,
+			  "the pool writes the same bytes as one thread") ;
+		CheckMesh(level, vertices, indices) ;
+
+		Check(volume > 0.0, "the normals point out") ;
+		// The error falls with the square of the step, a quarter on each doubling
+		double change = fabs(volume - previousVolume) ;
+		if (level >= 16)
+		{
+			Check(change < previousChange * 0.5, "the volume converges") ;
+		}
+		previousVolume = volume ;
+		previousChange = change ;
+	}
+
+	if (g_Failures > 0)
+	{
+		printf("\n%d checks failed\n", g_Failures) ;
+		return 1 ;
+	}
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,680 @@
+/*
+Benchmark and self check for the .x parser in Common/Asset.
+
+Runs on any machine, including Linux:
+	g++ -std=c++11 -O2 XFileBenchmark.cpp ../../Asset/XFile.cpp ../../Math/MeshOptimizer.cpp ../../Utility/MappedFile.cpp -o XFileBenchmark
+
+Parses the 27 pieces of the Rubik cube, from DirectX9/RubikCube or the directory given
+as the argument, and checks that every mesh is complete: indices inside the vertices,
+subsets covering the index list in material order, unit normals. Writes generated
+models as text and as binary .x files, with frames, quads, shared and split normals and
+materials inline and by reference, and checks that both parse to the same mesh. Checks
+that the cache gives back the mesh it was written from and refuses a cache for other
+source bytes or a damaged one, and that cut and scrambled files fail cleanly. Then
+reports the parse and cache load times. Exits with a non-zero code if a check fails.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../../Asset/XFile.h"
+#include "../../Utility/Timer.h"
+
+static const char* CACHE_PATH = "XFileBenchmark.xmesh" ;
+static const int CUBE_PIECES = 27 ;
+
+static int g_Failures = 0 ;
+
+static void Check(bool condition, const char* what)
+{
+	if (!condition)
+	{
+		printf("FAILED: %s\n", what) ;
+		++g_Failures ;
+	}
+}
+
+static bool Near(float a, float b, float tolerance)
+{
+	return fabsf(a - b) <= tolerance * (1.0f + fabsf(a) + fabsf(b)) ;
+}
+
+static bool ReadFile(const std::string& path, std::vector<char>& data)
+{
+	data.clear() ;
+	FILE* file = fopen(path.c_str(), "rb") ;
+	if (!file)
+	{
+		return false ;
+	}
+	char buffer[65536] ;
+	size_t count ;
+	while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + count) ;
+	}
+	fclose(file) ;
+	return true ;
+}
+
+static bool WriteFile(const char* path, const void* data, size_t size)
+{
+	FILE* file = fopen(path, "wb") ;
+	if (!file)
+	{
+		return false ;
+	}
+	bool written = fwrite(data, 1, size, file) == size ;
+	return fclose(file) == 0 && written ;
+}
+
+// Everything a renderer relies on
+static bool IsComplete(const XMesh& mesh)
+{
+	if (mesh.vertices.empty() || mesh.indices.empty() || mesh.indices.size() % 3 != 0 ||
+		mesh.subsets.size() != mesh.materials.size())
+	{
+		return false ;
+	}
+	for (size_t i = 0; i < mesh.indices.size(); ++i)
+	{
+		if (mesh.indices[i] >= mesh.vertices.size())
+		{
+			return false ;
+		}
+	}
+
+	unsigned int next = 0 ;
+	for (size_t i = 0; i < mesh.subsets.size(); ++i)
+	{
+		const XSubset& subset = mesh.subsets[i] ;
+		if (subset.material != i || subset.firstIndex != next || subset.indexCount % 3 != 0)
+		{
+			return false ;
+		}
+		for (unsigned int j = subset.firstIndex; j < subset.firstIndex + subset.indexCount; ++j)
+		{
+			unsigned int index = mesh.indices[j] ;
+			if (index < subset.firstVertex || index >= subset.firstVertex + subset.vertexCount)
+			{
+				return false ;
+			}
+		}
+		next += subset.indexCount ;
+	}
+	return next == mesh.indices.size() ;
+}
+
+static bool HasUnitNormals(const XMesh& mesh)
+{
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		const float* n = mesh.vertices[i].normal ;
+		if (!Near(n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1.0f, 1e-4f))
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+static bool SameMesh(const XMesh& a, const XMesh& b, float tolerance)
+{
+	if (a.vertices.size() != b.vertices.size() || a.indices != b.indices || a.subsets.size() != b.subsets.size() ||
+		a.materials.size() != b.materials.size())
+	{
+		return false ;
+	}
+	for (size_t i = 0; i < a.vertices.size(); ++i)
+	{
+		const float* x = (const float*)&a.vertices[i] ;
+		const float* y = (const float*)&b.vertices[i] ;
+		for (int j = 0; j < 8; ++j)
+		{
+			if (!Near(x[j], y[j], tolerance))
+			{
+				return false ;
+			}
+		}
+	}
+	for (size_t i = 0; i < a.subsets.size(); ++i)
+	{
+		if (memcmp(&a.subsets[i], &b.subsets[i], sizeof(XSubset)) != 0)
+		{
+			return false ;
+		}
+	}
+	for (size_t i = 0; i < a.materials.size(); ++i)
+	{
+		const XMaterial& x = a.materials[i] ;
+		const XMaterial& y = b.materials[i] ;
+		if (!Near(x.diffuse[0], y.diffuse[0], tolerance) || !Near(x.diffuse[3], y.diffuse[3], tolerance) ||
+			!Near(x.power, y.power, tolerance) || !Near(x.emissive[2], y.emissive[2], tolerance) || x.texture != y.texture)
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+/*
+A model as the file holds it, before welding: positions, faces of any size, normals with
+their own faces, a material per face.
+*/
+struct Model
+{
+	float frame[16] ;
+	std::vector<float> positions ;
+	std::vector<unsigned int> faceSizes ;
+	std::vector<unsigned int> faces ;
+	std::vector<float> normals ;
+	std::vector<unsigned int> normalFaces ;
+	std::vector<float> uvs ;
+	std::vector<unsigned int> faceMaterials ;
+} ;
+
+// A torus of quads, smooth, so every position has one normal, in a moved and turned frame
+static Model MakeTorus(int rings, int sides)
+{
+	Model model ;
+	float c = cosf(0.5f), s = sinf(0.5f) ;
+	float frame[16] = { c, s, 0.0f, 0.0f, -s, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 10.0f, -2.0f, 3.0f, 1.0f } ;
+	memcpy(model.frame, frame, sizeof(frame)) ;
+
+	for (int ring = 0; ring < rings; ++ring)
+	{
+		float u = 6.2831853f * ring / rings ;
+		for (int side = 0; side < sides; ++side)
+		{
+			float v = 6.2831853f * side / sides ;
+			float n[3] = { cosf(u) * cosf(v), sinf(u) * cosf(v), sinf(v) } ;
+			model.positions.push_back(cosf(u) * 2.0f + n[0] * 0.5f) ;
+			model.positions.push_back(sinf(u) * 2.0f + n[1] * 0.5f) ;
+			model.positions.push_back(n[2] * 0.5f) ;
+			model.normals.insert(model.normals.end(), n, n + 3) ;
+			model.uvs.push_back((float)ring / rings) ;
+			model.uvs.push_back((float)side / sides) ;
+		}
+	}
+
+	for (int ring = 0; ring < rings; ++ring)
+	{
+		for (int side = 0; side < sides; ++side)
+		{
+			unsigned int a = ring * sides + side ;
+			unsigned int b = ring * sides + (side + 1) % sides ;
+			unsigned int d = ((ring + 1) % rings) * sides + side ;
+			unsigned int e = ((ring + 1) % rings) * sides + (side + 1) % sides ;
+			unsigned int quad[4] = { a, b, e, d } ;
+			model.faceSizes.push_back(4) ;
+			model.faces.insert(model.faces.end(), quad, quad + 4) ;
+			model.normalFaces.insert(model.normalFaces.end(), quad, quad + 4) ;
+			model.faceMaterials.push_back((ring + side) % 2) ;
+		}
+	}
+	return model ;
+}
+
+// A box with a normal per side, so every corner is three vertices
+static Model MakeBox()
+{
+	static const float corners[8][3] = { { -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+										 { -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 } } ;
+	static const float sides[6][3] = { { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { 1, 0, 0 } } ;
+	static const unsigned int quads[6][4] = { { 0, 3, 2, 1 }, { 4, 5, 6, 7 }, { 0, 1, 5, 4 }, { 3, 7, 6, 2 }, { 0, 4, 7, 3 }, { 1, 2, 6, 5 } } ;
+
+	Model model ;
+	float frame[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } ;
+	memcpy(model.frame, frame, sizeof(frame)) ;
+	model.positions.assign(&corners[0][0], &corners[0][0] + 24) ;
+	model.normals.assign(&sides[0][0], &sides[0][0] + 18) ;
+	for (unsigned int i = 0; i < 6; ++i)
+	{
+		model.faceSizes.push_back(4) ;
+		model.faces.insert(model.faces.end(), quads[i], quads[i] + 4) ;
+		for (int j = 0; j < 4; ++j)
+		{
+			model.normalFaces.push_back(i) ;
+		}
+	}
+	return model ;
+}
+
+/*
+Writes a model with the calls of either format, so the text and the binary file hold
+the same objects. The second material is written once at the top and referenced.
+*/
+class Writer
+{
+public:
+	explicit Writer(bool binary) : m_bBinary(binary)
+	{
+		m_Data = binary ? "xof 0302bin 0032" : "xof 0302txt 0032\n" ;
+	}
+
+	const std::string& Data() const { return m_Data ; }
+
+	void Open(const char* type, const char* name)
+	{
+		if (m_bBinary)
+		{
+			Name(type) ;
+			if (name)
+			{
+				Name(name) ;
+			}
+			Token(10) ;
+		}
+		else
+		{
+			m_Data += type ;
+			m_Data += name ? std::string(" ") + name : std::string() ;
+			m_Data += " {\n" ;
+		}
+	}
+
+	void Close()
+	{
+		if (m_bBinary)
+		{
+			Token(11) ;
+		}
+		else
+		{
+			m_Data += "}\n" ;
+		}
+	}
+
+	void Reference(const char* name)
+	{
+		if (m_bBinary)
+		{
+			Token(10) ;
+			Name(name) ;
+			Token(11) ;
+		}
+		else
+		{
+			m_Data += std::string("{ ") + name + " }\n" ;
+		}
+	}
+
+	void Integers(const unsigned int* values, size_t count)
+	{
+		if (m_bBinary)
+		{
+			Token(6) ;
+			Dword((unsigned int)count) ;
+			m_Data.append((const char*)values, count * 4) ;
+		}
+		else
+		{
+			char text[32] ;
+			for (size_t i = 0; i < count; ++i)
+			{
+				sprintf(text, "%u%s", values[i], i + 1 < count ? "," : ";\n") ;
+				m_Data += text ;
+			}
+		}
+	}
+
+	void Floats(const float* values, size_t count)
+	{
+		if (m_bBinary)
+		{
+			Token(7) ;
+			Dword((unsigned int)count) ;
+			m_Data.append((const char*)values, count * 4) ;
+		}
+		else
+		{
+			char text[32] ;
+			for (size_t i = 0; i < count; ++i)
+			{
+				sprintf(text, "%.9g%s", values[i], i + 1 < count ? ";" : ";;\n") ;
+				m_Data += text ;
+			}
+		}
+	}
+
+	void String(const char* value)
+	{
+		if (m_bBinary)
+		{
+			Token(2) ;
+			Dword((unsigned int)strlen(value)) ;
+			m_Data += value ;
+			Token(20) ;
+		}
+		else
+		{
+			m_Data += std::string("\"") + value + "\";\n" ;
+		}
+	}
+
+	void Comment()
+	{
+		if (!m_bBinary)
+		{
+			m_Data += "// exported for the benchmark\n# and a second comment\n" ;
+		}
+	}
+
+private:
+	void Token(int token)
+	{
+		m_Data += (char)(token & 0xff) ;
+		m_Data += (char)(token >> 8) ;
+	}
+
+	void Dword(unsigned int value)
+	{
+		m_Data.append((const char*)&value, 4) ;
+	}
+
+	void Name(const char* name)
+	{
+		Token(1) ;
+		Dword((unsigned int)strlen(name)) ;
+		m_Data += name ;
+	}
+
+	std::string m_Data ;
+	bool m_bBinary ;
+} ;
+
+static void WriteMaterial(Writer& writer, const char* name, float red, const char* texture)
+{
+	float diffuse[4] = { red, 0.5f, 0.25f, 1.0f } ;
+	float power = 8.0f ;
+	float specular[3] = { 0.5f, 0.5f, 0.5f } ;
+	float emissive[3] = { 0.0f, 0.0f, 0.125f } ;
+	writer.Open("Material", name) ;
+	writer.Floats(diffuse, 4) ;
+	writer.Floats(&power, 1) ;
+	writer.Floats(specular, 3) ;
+	writer.Floats(emissive, 3) ;
+	if (texture)
+	{
+		writer.Open("TextureFilename", NULL) ;
+		writer.String(texture) ;
+		writer.Close() ;
+	}
+	writer.Close() ;
+}
+
+static std::string WriteModel(const Model& model, bool binary)
+{
+	Writer writer(binary) ;
+	writer.Comment() ;
+	WriteMaterial(writer, "Shared", 0.75f, NULL) ;
+
+	// An unknown object that has to be skipped
+	writer.Open("AnimationSet", "Idle") ;
+	writer.Integers(&model.faceSizes[0], 1) ;
+	writer.Close() ;
+
+	writer.Open("Frame", "Root") ;
+	writer.Open("FrameTransformMatrix", NULL) ;
+	writer.Floats(model.frame, 16) ;
+	writer.Close() ;
+	writer.Open("Mesh", "Model") ;
+
+	unsigned int count = (unsigned int)model.positions.size() / 3 ;
+	writer.Integers(&count, 1) ;
+	writer.Floats(&model.positions[0], model.positions.size()) ;
+	count = (unsigned int)model.faceSizes.size() ;
+	writer.Integers(&count, 1) ;
+	for (size_t f = 0, corner = 0; f < model.faceSizes.size(); corner += model.faceSizes[f], ++f)
+	{
+		writer.Integers(&model.faceSizes[f], 1) ;
+		writer.Integers(&model.faces[corner], model.faceSizes[f]) ;
+	}
+
+	writer.Open("MeshNormals", NULL) ;
+	count = (unsigned int)model.normals.size() / 3 ;
+	writer.Integers(&count, 1) ;
+	writer.Floats(&model.normals[0], model.normals.size()) ;
+	count = (unsigned int)model.faceSizes.size() ;
+	writer.Integers(&count, 1) ;
+	for (size_t f = 0, corner = 0; f < model.faceSizes.size(); corner += model.faceSizes[f], ++f)
+	{
+		writer.Integers(&model.faceSizes[f], 1) ;
+		writer.Integers(&model.normalFaces[corner], model.faceSizes[f]) ;
+	}
+	writer.Close() ;
+
+	if (!model.uvs.empty())
+	{
+		writer.Open("MeshTextureCoords", NULL) ;
+		count = (unsigned int)model.uvs.size() / 2 ;
+		writer.Integers(&count, 1) ;
+		writer.Floats(&model.uvs[0], model.uvs.size()) ;
+		writer.Close() ;
+	}
+
+	if (!model.faceMaterials.empty())
+	{
+		writer.Open("MeshMaterialList", NULL) ;
+		unsigned int counts[2] = { 2, (unsigned int)model.faceMaterials.size() } ;
+		writer.Integers(counts, 2) ;
+		writer.Integers(&model.faceMaterials[0], model.faceMaterials.size()) ;
+		WriteMaterial(writer, "Inline", 0.25f, "torus.png") ;
+		writer.Reference("Shared") ;
+		writer.Close() ;
+	}
+
+	writer.Close() ;
+	writer.Close() ;
+	return writer.Data() ;
+}
+
+static void CheckModels()
+{
+	// Split normals make a vertex per corner, no materials give the white one
+	Model box = MakeBox() ;
+	XMesh mesh ;
+	std::string text = WriteModel(box, false) ;
+	Check(ParseXFile(text.data(), text.size(), mesh) == XFILE_OK && IsComplete(mesh), "the box parses") ;
+	Check(mesh.vertices.size() == 24 && mesh.indices.size() == 36, "a vertex per box corner and side") ;
+	Check(mesh.materials.size() == 1 && mesh.materials[0].diffuse[0] == 1.0f, "the default material") ;
+	Check(HasUnitNormals(mesh), "box normals") ;
+
+	XMesh binaryMesh ;
+	std::string binary = WriteModel(box, true) ;
+	Check(ParseXFile(binary.data(), binary.size(), binaryMesh) == XFILE_OK && SameMesh(mesh, binaryMesh, 0.0f), "the binary box") ;
+
+	// Smooth normals share vertices, quads make two triangles, the frame moves them
+	Model torus = MakeTorus(24, 12) ;
+	text = WriteModel(torus, false) ;
+	binary = WriteModel(torus, true) ;
+	Check(ParseXFile(text.data(), text.size(), mesh) == XFILE_OK && IsComplete(mesh), "the torus parses") ;
+	Check(mesh.vertices.size() == 24 * 12 && mesh.indices.size() == 24 * 12 * 6, "torus vertices and triangles") ;
+	Check(ParseXFile(binary.data(), binary.size(), binaryMesh) == XFILE_OK && SameMesh(mesh, binaryMesh, 1e-6f), "text and binary agree") ;
+	Check(HasUnitNormals(mesh), "torus normals") ;
+
+	float center[3] = { 0.0f, 0.0f, 0.0f } ;
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			center[j] += mesh.vertices[i].position[j] / mesh.vertices.size() ;
+		}
+	}
+	Check(Near(center[0], 10.0f, 1e-4f) && Near(center[1], -2.0f, 1e-4f) && Near(center[2], 3.0f, 1e-4f), "the frame moves the mesh") ;
+
+	Check(mesh.materials.size() == 2 && mesh.materials[0].texture == "torus.png" && mesh.materials[1].diffuse[0] == 0.75f,
+		  "inline and referenced materials") ;
+	Check(mesh.subsets.size() == 2 && mesh.subsets[0].indexCount == mesh.subsets[1].indexCount, "a subset per material") ;
+}
+
+static void CheckBroken(const std::vector<char>& text, const std::string& binary)
+{
+	XMesh mesh ;
+	Check(ParseXFile("hello", 5, mesh) == XFILE_NOT_XFILE, "not a .x file") ;
+	Check(ParseXFile("xof 0302tzip0032 ", 17, mesh) == XFILE_UNSUPPORTED, "compressed files") ;
+	std::string empty = "xof 0302txt 0032\n" ;
+	Check(ParseXFile(empty.data(), empty.size(), mesh) == XFILE_NO_MESH, "no mesh") ;
+	std::string bad = empty + "Mesh { 3; 0;0;0;, 1;0;0;, 0;1;0;; 1; 3;0,1,7;; }" ;
+	Check(ParseXFile(bad.data(), bad.size(), mesh) == XFILE_BAD_INDEX, "a face past the vertices") ;
+
+	// Every cut of the files, whatever it returns, and a mesh only when complete
+	bool clean = true ;
+	for (size_t size = 0; size < text.size(); size += 7)
+	{
+		XFILE_ERROR error = ParseXFile(&text[0], size, mesh) ;
+		clean = clean && (error == XFILE_OK ? IsComplete(mesh) : mesh.vertices.empty()) ;
+	}
+	for (size_t size = 0; size < binary.size(); size += 3)
+	{
+		XFILE_ERROR error = ParseXFile(binary.data(), size, mesh) ;
+		clean = clean && (error == XFILE_OK ? IsComplete(mesh) : mesh.vertices.empty()) ;
+	}
+	Check(clean, "cut files") ;
+
+	srand(5) ;
+	for (int i = 0; i < 2000; ++i)
+	{
+		std::string scrambled = binary ;
+		for (int j = 0; j < 4; ++j)
+		{
+			scrambled[16 + rand() % (scrambled.size() - 16)] = (char)rand() ;
+		}
+		XFILE_ERROR error = ParseXFile(scrambled.data(), scrambled.size(), mesh) ;
+		clean = clean && (error == XFILE_OK ? IsComplete(mesh) : mesh.vertices.empty()) ;
+	}
+	Check(clean, "scrambled files") ;
+}
+
+static void CheckCache(const XMesh& mesh, unsigned long long hash)
+{
+	Check(WriteXMeshCache(CACHE_PATH, mesh, hash), "WriteXMeshCache") ;
+	XMesh loaded ;
+	Check(ReadXMeshCache(CACHE_PATH, hash, loaded) && SameMesh(mesh, loaded, 0.0f), "the cache keeps the mesh") ;
+	Check(!ReadXMeshCache(CACHE_PATH, hash + 1, loaded) && loaded.vertices.empty(), "a cache for other source bytes is refused") ;
+
+	std::vector<char> data ;
+	ReadFile(CACHE_PATH, data) ;
+	WriteFile(CACHE_PATH, &data[0], data.size() - 1) ;
+	Check(!ReadXMeshCache(CACHE_PATH, hash, loaded), "a truncated cache is refused") ;
+
+	// An index past the vertices, right after the header and the vertex array
+	unsigned int bad = 0xffffff ;
+	memcpy(&data[sizeof(XMeshCacheHeader) + mesh.vertices.size() * sizeof(XVertex)], &bad, 4) ;
+	WriteFile(CACHE_PATH, &data[0], data.size()) ;
+	Check(!ReadXMeshCache(CACHE_PATH, hash, loaded), "a damaged cache is refused") ;
+
+	remove(CACHE_PATH) ;
+	Check(!ReadXMeshCache(CACHE_PATH, hash, loaded), "a missing cache is refused") ;
+}
+
+// The pieces of the cube, parsed and loaded from the cache, milliseconds per piece
+static bool MeasureCube(const std::string& directory, std::vector<char>& firstPiece)
+{
+	std::vector<std::vector<char> > files(CUBE_PIECES) ;
+	size_t bytes = 0 ;
+	for (int i = 0; i < CUBE_PIECES; ++i)
+	{
+		char name[16] ;
+		sprintf(name, "%d.x", i) ;
+		if (!ReadFile(directory + "/" + name, files[i]) || files[i].empty())
+		{
+			printf("%s/%s not found, pass the directory of the Rubik cube .x files\n", directory.c_str(), name) ;
+			return false ;
+		}
+		bytes += files[i].size() ;
+	}
+	firstPiece = files[0] ;
+
+	std::vector<XMesh> meshes(CUBE_PIECES) ;
+	bool complete = true ;
+	size_t vertices = 0, triangles = 0 ;
+	Timer timer ;
+	for (int i = 0; i < CUBE_PIECES; ++i)
+	{
+		complete = ParseXFile(&files[i][0], files[i].size(), meshes[i]) == XFILE_OK && complete ;
+	}
+	double parseMs = timer.ElapsedMs() ;
+	for (int i = 0; i < CUBE_PIECES; ++i)
+	{
+		complete = complete && IsComplete(meshes[i]) && HasUnitNormals(meshes[i]) ;
+		vertices += meshes[i].vertices.size() ;
+		triangles += meshes[i].indices.size() / 3 ;
+	}
+	Check(complete, "the cube pieces parse") ;
+	CheckCache(meshes[0], XFileHash(&files[0][0], files[0].size())) ;
+
+	unsigned long long hash = XFileHash(&files[13][0], files[13].size()) ;
+	WriteXMeshCache(CACHE_PATH, meshes[13], hash) ;
+	XMesh loaded ;
+	const int repeats = 200 ;
+	timer.Restart() ;
+	for (int i = 0; i < repeats; ++i)
+	{
+		complete = ReadXMeshCache(CACHE_PATH, hash, loaded) && complete ;
+	}
+	double cacheMs = timer.ElapsedMs() / repeats ;
+	remove(CACHE_PATH) ;
+	Check(complete, "the cache loads") ;
+
+	printf("cube: %d files, %d KB, %d vertices, %d triangles\n", CUBE_PIECES, (int)(bytes / 1024), (int)vertices, (int)triangles) ;
+	printf("  parse %.3f ms per file, %.2f ms for all, %.0f MB/s\n", parseMs / CUBE_PIECES, parseMs, bytes / 1048576.0 / (parseMs / 1000.0)) ;
+	printf("  cache load %.3f ms per file\n", cacheMs) ;
+	return true ;
+}
+
+static void MeasureLarge(int rings, int sides)
+{
+	Model model = MakeTorus(rings, sides) ;
+	std::string text = WriteModel(model, false) ;
+	std::string binary = WriteModel(model, true) ;
+
+	XMesh mesh ;
+	Timer timer ;
+	Check(ParseXFile(text.data(), text.size(), mesh) == XFILE_OK, "a large text file") ;
+	double textMs = timer.ElapsedMs() ;
+	timer.Restart() ;
+	Check(ParseXFile(binary.data(), binary.size(), mesh) == XFILE_OK, "a large binary file") ;
+	double binaryMs = timer.ElapsedMs() ;
+
+	Check(WriteXMeshCache(CACHE_PATH, mesh, 1), "a large cache") ;
+	XMesh loaded ;
+	timer.Restart() ;
+	Check(ReadXMeshCache(CACHE_PATH, 1, loaded), "a large cache loads") ;
+	double cacheMs = timer.ElapsedMs() ;
+	remove(CACHE_PATH) ;
+
+	printf("%9d %9d %8.1f %10.1f %8.1f %10.1f %9.2f\n", (int)mesh.indices.size() / 3, (int)mesh.vertices.size(),
+		   text.size() / 1048576.0, textMs, binary.size() / 1048576.0, binaryMs, cacheMs) ;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string directory = argc > 1 ? argv[1] : "../../../DirectX9/RubikCube" ;
+
+	CheckModels() ;
+
+	std::vector<char> piece ;
+	if (!MeasureCube(directory, piece))
+	{
+		return 1 ;
+	}
+	CheckBroken(piece, WriteModel(MakeTorus(6, 4), true)) ;
+
+	printf("\n%9s %9s %8s %10s %8s %10s %9s\n", "triangles", "vertices", "text MB", "text ms", "bin MB", "bin ms", "cache ms") ;
+	MeasureLarge(100, 50) ;
+	MeasureLarge(500, 100) ;
+	MeasureLarge(1000, 500) ;
+
+	if (g_Failures)
+	{
+		printf("\n%d checks FAILED\n", g_Failures) ;
+		return 1 ;
+	}
+
+	printf("\nAll checks passed\n") ;
+	return 0 ;
+}
@@ -0,0 +1,292 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#define INVALID_FD INVALID_SOCKET
+#define CLOSE_SOCKET closesocket
+#define NO_PIPE NULL
+#else
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#define INVALID_FD (-1)
+#define CLOSE_SOCKET close
+#define NO_PIPE (-1)
+#endif
+
+// Report a closed connection as an error instead of raising SIGPIPE
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "ByteStream.h"
+
+//
+// PipeStream
+//
+
+PipeStream::PipeStream(void) : m_hPipe(NO_PIPE)
+{
+}
+
+PipeStream::~PipeStream(void)
+{
+	Close() ;
+}
+
+bool PipeStream::CreatePair(PipeStream& reader, PipeStream& writer)
+{
+	reader.Close() ;
+	writer.Close() ;
+
+#ifdef _WIN32
+	// Big pipe buffer so a whole key frame fits without the writer blocking
+	HANDLE hRead = NULL ;
+	HANDLE hWrite = NULL ;
+	if (!CreatePipe(&hRead, &hWrite, NULL, 1 << 20))
+	{
+		return false ;
+	}
+
+	reader.m_hPipe = hRead ;
+	writer.m_hPipe = hWrite ;
+	return true ;
+#else
+	int fds[2] ;
+	if (pipe(fds) != 0)
+	{
+		return false ;
+	}
+
+	reader.m_hPipe = fds[0] ;
+	writer.m_hPipe = fds[1] ;
+	return true ;
+#endif
+}
+
+bool PipeStream::Write(const void* data, size_t size)
+{
+	const char* p = (const char*)data ;
+	while (size > 0)
+	{
+#ifdef _WIN32
+		DWORD written = 0 ;
+		if (!WriteFile(m_hPipe, p, (DWORD)size, &written, NULL))
+		{
+			return false ;
+		}
+#else
+		ssize_t written = write(m_hPipe, p, size) ;
+		if (written < 0 && errno == EINTR)
+		{
+			continue ;
+		}
+		if (written <= 0)
+		{
+			return false ;
+		}
+#endif
+		p += written ;
+		size -= written ;
+	}
+
+	return true ;
+}
+
+bool PipeStream::Read(void* data, size_t size)
+{
+	char* p = (char*)data ;
+	while (size > 0)
+	{
+#ifdef _WIN32
+		DWORD read = 0 ;
+		if (!ReadFile(m_hPipe, p, (DWORD)size, &read, NULL) || read == 0)
+		{
+			return false ;
+		}
+#else
+		ssize_t read = ::read(m_hPipe, p, size) ;
+		if (read < 0 && errno == EINTR)
+		{
+			continue ;
+		}
+		if (read <= 0)
+		{
+			return false ;
+		}
+#endif
+		p += read ;
+		size -= read ;
+	}
+
+	return true ;
+}
+
+void PipeStream::Close()
+{
+	if (m_hPipe != NO_PIPE)
+	{
+#ifdef _WIN32
+		CloseHandle(m_hPipe) ;
+#else
+		close(m_hPipe) ;
+#endif
+		m_hPipe = NO_PIPE ;
+	}
+}
+
+//
+// SocketStream
+//
+
+// WSAStartup once per process
+static bool InitSockets()
+{
+#ifdef _WIN32
+	static bool initialized = false ;
+	if (!initialized)
+	{
+		WSADATA wsaData ;
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		{
+			return false ;
+		}
+		initialized = true ;
+	}
+#endif
+	return true ;
+}
+
+SocketStream::SocketStream(void) : m_Socket(INVALID_FD)
+{
+}
+
+SocketStream::~SocketStream(void)
+{
+	Close() ;
+}
+
+bool SocketStream::Connect(const char* host, unsigned short port)
+{
+	Close() ;
+	if (!InitSockets())
+	{
+		return false ;
+	}
+
+	addrinfo hints ;
+	memset(&hints, 0, sizeof(hints)) ;
+	hints.ai_family = AF_INET ;
+	hints.ai_socktype = SOCK_STREAM ;
+
+	char service[16] ;
+	sprintf(service, "%u", (unsigned int)port) ;
+
+	addrinfo* result = NULL ;
+	if (getaddrinfo(host, service, &hints, &result) != 0)
+	{
+		return false ;
+	}
+
+	m_Socket = (SocketHandle)socket(result->ai_family, result->ai_socktype, result->ai_protocol) ;
+	if (m_Socket != INVALID_FD && connect(m_Socket, result->ai_addr, (int)result->ai_addrlen) != 0)
+	{
+		Close() ;
+	}
+	freeaddrinfo(result) ;
+
+	if (m_Socket == INVALID_FD)
+	{
+		return false ;
+	}
+
+	// Frames are sent as soon as they are encoded, don't let Nagle hold them back
+	int noDelay = 1 ;
+	setsockopt(m_Socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay)) ;
+	return true ;
+}
+
+bool SocketStream::Accept(unsigned short port)
+{
+	Close() ;
+	if (!InitSockets())
+	{
+		return false ;
+	}
+
+	SocketStream listener ;
+	listener.m_Socket = (SocketHandle)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP) ;
+	if (listener.m_Socket == INVALID_FD)
+	{
+		return false ;
+	}
+
+	int reuse = 1 ;
+	setsockopt(listener.m_Socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse)) ;
+
+	sockaddr_in address ;
+	memset(&address, 0, sizeof(address)) ;
+	address.sin_family = AF_INET ;
+	address.sin_addr.s_addr = htonl(INADDR_ANY) ;
+	address.sin_port = htons(port) ;
+
+	if (bind(listener.m_Socket, (sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listener.m_Socket, 1) != 0)
+	{
+		return false ;
+	}
+
+	m_Socket = (SocketHandle)accept(listener.m_Socket, NULL, NULL) ;
+	return m_Socket != INVALID_FD ;
+}
+
+bool SocketStream::Write(const void* data, size_t size)
+{
+	const char* p = (const char*)data ;
+	while (size > 0)
+	{
+		int chunk = size > (1 << 30) ? (1 << 30) : (int)size ;
+		int sent = (int)send(m_Socket, p, chunk, MSG_NOSIGNAL) ;
+		if (sent <= 0)
+		{
+			return false ;
+		}
+		p += sent ;
+		size -= sent ;
+	}
+
+	return true ;
+}
+
+bool SocketStream::Read(void* data, size_t size)
+{
+	char* p = (char*)data ;
+	while (size > 0)
+	{
+		int chunk = size > (1 << 30) ? (1 << 30) : (int)size ;
+		int received = (int)recv(m_Socket, p, chunk, 0) ;
+		if (received <= 0)
+		{
+			return false ;
+		}
+		p += received ;
+		size -= received ;
+	}
+
+	return true ;
+}
+
+void SocketStream::Close()
+{
+	if (m_Socket != INVALID_FD)
+	{
+		CLOSE_SOCKET(m_Socket) ;
+		m_Socket = INVALID_FD ;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef __BYTE_STREAM_H__
+#define __BYTE_STREAM_H__
+
+#include <stddef.h>
+
+// Keep the platform headers out of here, winsock2.h must come before windows.h
+#ifdef _WIN32
+typedef void* PipeHandle ;		// HANDLE
+typedef size_t SocketHandle ;	// SOCKET
+#else
+typedef int PipeHandle ;
+typedef int SocketHandle ;
+#endif
+
+// A blocking, ordered byte transport between the screen share encoder and a viewer
+class ByteStream
+{
+public:
+	virtual ~ByteStream() {}
+
+	// Write all size bytes, return false if the other end went away
+	virtual bool Write(const void* data, size_t size) = 0 ;
+
+	// Read exactly size bytes, return false on end of stream or error
+	virtual bool Read(void* data, size_t size) = 0 ;
+
+	virtual void Close() = 0 ;
+};
+
+// One end of an anonymous pipe, CreatePipe on Windows and pipe() elsewhere
+class PipeStream : public ByteStream
+{
+public:
+	PipeStream(void);
+	virtual ~PipeStream(void);
+
+	// Create a pipe, bytes written to writer come out of reader
+	static bool CreatePair(PipeStream& reader, PipeStream& writer) ;
+
+	virtual bool Write(const void* data, size_t size) ;
+	virtual bool Read(void* data, size_t size) ;
+	virtual void Close() ;
+
+private:
+	PipeHandle m_hPipe ;
+
+	PipeStream(const PipeStream&) ;
+	PipeStream& operator=(const PipeStream&) ;
+};
+
+// A connected TCP socket
+class SocketStream : public ByteStream
+{
+public:
+	SocketStream(void);
+	virtual ~SocketStream(void);
+
+	// Connect to a viewer listening on host:port
+	bool Connect(const char* host, unsigned short port) ;
+
+	// Wait for one encoder to connect on port
+	bool Accept(unsigned short port) ;
+
+	virtual bool Write(const void* data, size_t size) ;
+	virtual bool Read(void* data, size_t size) ;
+	virtual void Close() ;
+
+private:
+	SocketHandle m_Socket ;
+
+	SocketStream(const SocketStream&) ;
+	SocketStream& operator=(const SocketStream&) ;
+};
+
+#endif // end __BYTE_STREAM_H__
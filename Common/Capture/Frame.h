@@ -0,0 +1,103 @@
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+// 32 bit BGRA pixels, the layout of a D3DFMT_A8R8G8B8 surface and of a 32 bit top-down DIB
+#define FRAME_BYTES_PER_PIXEL 4
+
+// A view of a BGRA image in memory, does not own the pixels.
+// pitch is the number of bytes between two rows, may be larger than width * 4
+struct FrameView
+{
+	unsigned char* pixels ;
+	int width ;
+	int height ;
+	int pitch ;
+
+	FrameView() : pixels(NULL), width(0), height(0), pitch(0) {}
+
+	FrameView(unsigned char* p, int w, int h, int rowPitch)
+		: pixels(p), width(w), height(h), pitch(rowPitch) {}
+
+	unsigned char* Row(int y) const { return pixels + y * pitch ; }
+};
+
+// A BGRA image that owns its pixels, rows are 16 byte aligned for SSE loads
+class FrameBuffer
+{
+public:
+	FrameBuffer() : m_pMemory(NULL), m_Width(0), m_Height(0), m_Pitch(0) {}
+	~FrameBuffer() { Release() ; }
+
+	// Allocate a width x height frame, the content is zero filled
+	bool Create(int width, int height)
+	{
+		if (width == m_Width && height == m_Height && m_pMemory)
+		{
+			memset(Pixels(), 0, (size_t)m_Pitch * m_Height) ;
+			return true ;
+		}
+
+		Release() ;
+
+		int pitch = (width * FRAME_BYTES_PER_PIXEL + 15) & ~15 ;
+		size_t size = (size_t)pitch * height ;
+		m_pMemory = (unsigned char*)malloc(size + 15) ;
+		if (!m_pMemory)
+		{
+			return false ;
+		}
+
+		m_Width = width ;
+		m_Height = height ;
+		m_Pitch = pitch ;
+		memset(Pixels(), 0, size) ;
+		return true ;
+	}
+
+	void Release()
+	{
+		if (m_pMemory)
+		{
+			free(m_pMemory) ;
+			m_pMemory = NULL ;
+		}
+		m_Width = m_Height = m_Pitch = 0 ;
+	}
+
+	unsigned char* Pixels() const
+	{
+		return (unsigned char*)(((size_t)m_pMemory + 15) & ~(size_t)15) ;
+	}
+
+	FrameView View() const { return FrameView(Pixels(), m_Width, m_Height, m_Pitch) ; }
+
+	int Width() const { return m_Width ; }
+	int Height() const { return m_Height ; }
+	int Pitch() const { return m_Pitch ; }
+
+private:
+	unsigned char* m_pMemory ;	// unaligned block returned by malloc
+	int m_Width ;
+	int m_Height ;
+	int m_Pitch ;
+
+	FrameBuffer(const FrameBuffer&) ;
+	FrameBuffer& operator=(const FrameBuffer&) ;
+};
+
+// Copy a width x height block of pixels between two frames
+inline void CopyFrameRect(const FrameView& dest, int destX, int destY,
+						  const FrameView& src, int srcX, int srcY, int width, int height)
+{
+	size_t rowBytes = (size_t)width * FRAME_BYTES_PER_PIXEL ;
+	for (int y = 0; y < height; ++y)
+	{
+		memcpy(dest.Row(destY + y) + destX * FRAME_BYTES_PER_PIXEL,
+			src.Row(srcY + y) + srcX * FRAME_BYTES_PER_PIXEL, rowBytes) ;
+	}
+}
+
+#endif // end __FRAME_H__
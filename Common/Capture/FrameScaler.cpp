@@ -0,0 +1,373 @@
+#include "FrameScaler.h"
+#include "../Utility/Simd.h"
+#include "../Utility/ThreadPool.h"
+
+#include <math.h>
+
+// Fixed point precision of the filter weights
+#define WEIGHT_BITS 14
+#define WEIGHT_ONE (1 << WEIGHT_BITS)
+
+// Rows handed to one thread at a time
+static const int BAND_ROWS = 16 ;
+
+static const double PI = 3.14159265358979323846 ;
+
+static double Sinc(double x)
+{
+	if (fabs(x) < 1e-8)
+	{
+		return 1.0 ;
+	}
+	x *= PI ;
+	return sin(x) / x ;
+}
+
+// Filter kernel and its radius in source pixels at scale 1
+static double FilterSupport(SCALE_FILTER filter)
+{
+	switch (filter)
+	{
+	case SCALE_BOX:		 return 0.5 ;
+	case SCALE_BILINEAR: return 1.0 ;
+	default:			 return 3.0 ;
+	}
+}
+
+static double FilterWeight(SCALE_FILTER filter, double x)
+{
+	switch (filter)
+	{
+	case SCALE_BOX:
+		return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0 ;
+
+	case SCALE_BILINEAR:
+		x = fabs(x) ;
+		return x < 1.0 ? 1.0 - x : 0.0 ;
+
+	default:
+		return fabs(x) < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0 ;
+	}
+}
+
+// Two 16 bit weights in one 32 bit lane, the layout pmaddwd expects
+static int PackWeights(short w0, short w1)
+{
+	return (int)((unsigned int)(unsigned short)w0 | ((unsigned int)(unsigned short)w1 << 16)) ;
+}
+
+static unsigned char ClampByte(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value)) ;
+}
+
+FrameScaler::FrameScaler(void)
+	: m_SrcWidth(0),
+	  m_SrcHeight(0),
+	  m_DstWidth(0),
+	  m_DstHeight(0),
+	  m_Filter(SCALE_BILINEAR)
+{
+	m_Horizontal.taps = 0 ;
+	m_Vertical.taps = 0 ;
+}
+
+FrameScaler::~FrameScaler(void)
+{
+}
+
+void FrameScaler::BuildTaps(int srcSize, int dstSize, SCALE_FILTER filter, FilterTaps& out)
+{
+	double scale = (double)srcSize / dstSize ;
+	double filterScale = scale > 1.0 ? scale : 1.0 ;	// widen the kernel when shrinking
+	double support = FilterSupport(filter) * filterScale ;
+
+	// Footprint of every destination pixel, pixels past the edges count as the edge pixel
+	std::vector<int> firsts(dstSize) ;
+	std::vector< std::vector<double> > footprints(dstSize) ;
+	int taps = 1 ;
+
+	for (int i = 0; i < dstSize; ++i)
+	{
+		double center = (i + 0.5) * scale ;
+		int left = (int)floor(center - support) ;
+		int right = (int)ceil(center + support) ;
+		int first = left < 0 ? 0 : left ;
+		int last = right > srcSize - 1 ? srcSize - 1 : right ;
+
+		std::vector<double>& weights = footprints[i] ;
+		weights.assign(last - first + 1, 0.0) ;
+
+		double total = 0 ;
+		for (int x = left; x <= right; ++x)
+		{
+			double w = FilterWeight(filter, (x + 0.5 - center) / filterScale) ;
+			int clamped = x < 0 ? 0 : (x >= srcSize ? srcSize - 1 : x) ;
+			weights[clamped - first] += w ;
+			total += w ;
+		}
+
+		for (size_t k = 0; k < weights.size(); ++k)
+		{
+			weights[k] /= total ;
+		}
+
+		// Trim zero weights at both ends
+		size_t begin = 0 ;
+		size_t end = weights.size() ;
+		while (end - begin > 1 && weights[begin] == 0.0) ++begin ;
+		while (end - begin > 1 && weights[end - 1] == 0.0) --end ;
+		weights = std::vector<double>(weights.begin() + begin, weights.begin() + end) ;
+
+		firsts[i] = first + (int)begin ;
+		if ((int)weights.size() > taps)
+		{
+			taps = (int)weights.size() ;
+		}
+	}
+
+	out.taps = taps ;
+	out.start.resize(dstSize) ;
+	out.weights.assign((size_t)dstSize * taps, 0) ;
+
+	for (int i = 0; i < dstSize; ++i)
+	{
+		const std::vector<double>& weights = footprints[i] ;
+		int first = firsts[i] ;
+
+		// Keep the whole footprint inside the source, padding goes on the side with room
+		int start = first ;
+		if (start + taps > srcSize)
+		{
+			start = srcSize - taps ;
+		}
+		out.start[i] = start ;
+
+		// Fixed point weights, the rounding error goes to the largest weight so they sum to one
+		short* w = &out.weights[(size_t)i * taps] ;
+		int sum = 0 ;
+		int largest = first - start ;
+		for (size_t k = 0; k < weights.size(); ++k)
+		{
+			int index = first - start + (int)k ;
+			w[index] = (short)floor(weights[k] * WEIGHT_ONE + 0.5) ;
+			sum += w[index] ;
+			if (w[index] > w[largest])
+			{
+				largest = index ;
+			}
+		}
+		w[largest] = (short)(w[largest] + WEIGHT_ONE - sum) ;
+	}
+}
+
+bool FrameScaler::Setup(int srcWidth, int srcHeight, int dstWidth, int dstHeight, SCALE_FILTER filter)
+{
+	if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0)
+	{
+		return false ;
+	}
+
+	if (srcWidth == m_SrcWidth && srcHeight == m_SrcHeight &&
+		dstWidth == m_DstWidth && dstHeight == m_DstHeight && filter == m_Filter)
+	{
+		return true ;
+	}
+
+	m_SrcWidth = srcWidth ;
+	m_SrcHeight = srcHeight ;
+	m_DstWidth = dstWidth ;
+	m_DstHeight = dstHeight ;
+	m_Filter = filter ;
+
+	BuildTaps(srcWidth, dstWidth, filter, m_Horizontal) ;
+	BuildTaps(srcHeight, dstHeight, filter, m_Vertical) ;
+
+	return m_Intermediate.Create(dstWidth, srcHeight) ;
+}
+
+void FrameScaler::HorizontalRows(const FrameView& src, int firstRow, int lastRow)
+{
+	FrameView temp = m_Intermediate.View() ;
+	const int taps = m_Horizontal.taps ;
+
+	for (int y = firstRow; y < lastRow; ++y)
+	{
+		const unsigned char* in = src.Row(y) ;
+		unsigned char* out = temp.Row(y) ;
+
+		for (int x = 0; x < m_DstWidth; ++x)
+		{
+			const unsigned char* p = in + m_Horizontal.start[x] * FRAME_BYTES_PER_PIXEL ;
+			const short* w = &m_Horizontal.weights[(size_t)x * taps] ;
+
+#if defined(SIMD_SSE2)
+			// Two source pixels per step: interleave them to b0 b1 g0 g1 r0 r1 a0 a1 and
+			// multiply-add with w0 w1, giving one 32 bit sum per channel
+			__m128i zero = _mm_setzero_si128() ;
+			__m128i sum = _mm_set1_epi32(1 << (WEIGHT_BITS - 1)) ;
+			int k = 0 ;
+			for (; k + 2 <= taps; k += 2)
+			{
+				__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + k * 4)), zero) ;
+				__m128i pair = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8)) ;
+				__m128i weight = _mm_set1_epi32(PackWeights(w[k], w[k + 1])) ;
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, weight)) ;
+			}
+			if (k < taps)
+			{
+				int pixel ;
+				memcpy(&pixel, p + k * 4, sizeof(pixel)) ;
+				__m128i pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero) ;
+				__m128i pair = _mm_unpacklo_epi16(pixels, zero) ;
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pair, _mm_set1_epi32(PackWeights(w[k], 0)))) ;
+			}
+			sum = _mm_srai_epi32(sum, WEIGHT_BITS) ;
+			sum = _mm_packs_epi32(sum, sum) ;
+			int result = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum)) ;
+			memcpy(out + x * 4, &result, sizeof(result)) ;
+#else
+			int b = 1 << (WEIGHT_BITS - 1) ;
+			int g = b, r = b, a = b ;
+			for (int k = 0; k < taps; ++k)
+			{
+				b += p[k * 4 + 0] * w[k] ;
+				g += p[k * 4 + 1] * w[k] ;
+				r += p[k * 4 + 2] * w[k] ;
+				a += p[k * 4 + 3] * w[k] ;
+			}
+			out[x * 4 + 0] = ClampByte(b >> WEIGHT_BITS) ;
+			out[x * 4 + 1] = ClampByte(g >> WEIGHT_BITS) ;
+			out[x * 4 + 2] = ClampByte(r >> WEIGHT_BITS) ;
+			out[x * 4 + 3] = ClampByte(a >> WEIGHT_BITS) ;
+#endif
+		}
+	}
+}
+
+void FrameScaler::VerticalRows(const FrameView& dst, int firstRow, int lastRow)
+{
+	FrameView temp = m_Intermediate.View() ;
+	const int taps = m_Vertical.taps ;
+	const int rowBytes = m_DstWidth * FRAME_BYTES_PER_PIXEL ;
+
+	for (int y = firstRow; y < lastRow; ++y)
+	{
+		const int start = m_Vertical.start[y] ;
+		const short* w = &m_Vertical.weights[(size_t)y * taps] ;
+		unsigned char* out = dst.Row(y) ;
+		int x = 0 ;
+
+#if defined(SIMD_SSE2)
+		// 4 pixels (16 channels) at a time, two source rows per multiply-add
+		__m128i zero = _mm_setzero_si128() ;
+		for (; x + 16 <= rowBytes; x += 16)
+		{
+			__m128i round = _mm_set1_epi32(1 << (WEIGHT_BITS - 1)) ;
+			__m128i s0 = round, s1 = round, s2 = round, s3 = round ;
+
+			for (int k = 0; k < taps; k += 2)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(temp.Row(start + k) + x)) ;
+				__m128i b = zero ;
+				short w1 = 0 ;
+				if (k + 1 < taps)
+				{
+					b = _mm_loadu_si128((const __m128i*)(temp.Row(start + k + 1) + x)) ;
+					w1 = w[k + 1] ;
+				}
+				__m128i weight = _mm_set1_epi32(PackWeights(w[k], w1)) ;
+
+				__m128i aLo = _mm_unpacklo_epi8(a, zero) ;
+				__m128i bLo = _mm_unpacklo_epi8(b, zero) ;
+				__m128i aHi = _mm_unpackhi_epi8(a, zero) ;
+				__m128i bHi = _mm_unpackhi_epi8(b, zero) ;
+
+				s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi16(aLo, bLo), weight)) ;
+				s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi16(aLo, bLo), weight)) ;
+				s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi16(aHi, bHi), weight)) ;
+				s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi16(aHi, bHi), weight)) ;
+			}
+
+			__m128i lo = _mm_packs_epi32(_mm_srai_epi32(s0, WEIGHT_BITS), _mm_srai_epi32(s1, WEIGHT_BITS)) ;
+			__m128i hi = _mm_packs_epi32(_mm_srai_epi32(s2, WEIGHT_BITS), _mm_srai_epi32(s3, WEIGHT_BITS)) ;
+			_mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(lo, hi)) ;
+		}
+#endif
+
+		for (; x < rowBytes; ++x)
+		{
+			int sum = 1 << (WEIGHT_BITS - 1) ;
+			for (int k = 0; k < taps; ++k)
+			{
+				sum += temp.Row(start + k)[x] * w[k] ;
+			}
+			out[x] = ClampByte(sum >> WEIGHT_BITS) ;
+		}
+	}
+}
+
+void FrameScaler::Scale(const FrameView& src, const FrameView& dst, ThreadPool* pool)
+{
+	if (src.width != m_SrcWidth || src.height != m_SrcHeight ||
+		dst.width != m_DstWidth || dst.height != m_DstHeight)
+	{
+		return ;
+	}
+
+	int srcBands = (m_SrcHeight + BAND_ROWS - 1) / BAND_ROWS ;
+	int dstBands = (m_DstHeight + BAND_ROWS - 1) / BAND_ROWS ;
+
+	if (!pool)
+	{
+		HorizontalRows(src, 0, m_SrcHeight) ;
+		VerticalRows(dst, 0, m_DstHeight) ;
+		return ;
+	}
+
+	// The vertical pass reads rows from neighbouring bands, so the passes can not overlap
+	pool->ParallelFor(srcBands, [&](int band)
+	{
+		int first = band * BAND_ROWS ;
+		int last = first + BAND_ROWS < m_SrcHeight ? first + BAND_ROWS : m_SrcHeight ;
+		HorizontalRows(src, first, last) ;
+	}) ;
+
+	pool->ParallelFor(dstBands, [&](int band)
+	{
+		int first = band * BAND_ROWS ;
+		int last = first + BAND_ROWS < m_DstHeight ? first + BAND_ROWS : m_DstHeight ;
+		VerticalRows(dst, first, last) ;
+	}) ;
+}
+
+double ComputePSNR(const FrameView& a, const FrameView& b)
+{
+	if (a.width != b.width || a.height != b.height || a.width == 0 || a.height == 0)
+	{
+		return 0 ;
+	}
+
+	double squaredError = 0 ;
+	for (int y = 0; y < a.height; ++y)
+	{
+		const unsigned char* pa = a.Row(y) ;
+		const unsigned char* pb = b.Row(y) ;
+		for (int x = 0; x < a.width; ++x)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				int d = pa[x * 4 + c] - pb[x * 4 + c] ;
+				squaredError += d * d ;
+			}
+		}
+	}
+
+	if (squaredError == 0)
+	{
+		return 99.0 ;
+	}
+
+	double mse = squaredError / ((double)a.width * a.height * 3) ;
+	return 10.0 * log10(255.0 * 255.0 / mse) ;
+}
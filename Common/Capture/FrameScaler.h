@@ -0,0 +1,69 @@
+#ifndef __FRAME_SCALER_H__
+#define __FRAME_SCALER_H__
+
+#include <vector>
+#include "Frame.h"
+
+class ThreadPool ;
+
+enum SCALE_FILTER
+{
+	SCALE_BOX,			// average of the source pixels under the destination pixel, fastest
+	SCALE_BILINEAR,		// triangle filter, widened when shrinking so it does not alias
+	SCALE_LANCZOS3,		// windowed sinc, sharpest
+	SCALE_FILTER_COUNT
+};
+
+/*
+Resample a BGRA frame to another size on the CPU.
+
+The filter is separable: a horizontal pass turns every source row into a row of the
+destination width, then a vertical pass blends those rows into the destination rows.
+Weights are computed once in Setup as 14 bit fixed point, both passes run with SSE2
+(pmaddwd on interleaved pixel pairs) and are split into bands of rows across a ThreadPool.
+*/
+class FrameScaler
+{
+public:
+	FrameScaler(void);
+	~FrameScaler(void);
+
+	// Compute the filter weights, does nothing if the sizes and filter did not change
+	bool Setup(int srcWidth, int srcHeight, int dstWidth, int dstHeight, SCALE_FILTER filter) ;
+
+	// Scale src into dst, their sizes must match the last Setup.
+	// pool may be NULL to run on the calling thread only.
+	void Scale(const FrameView& src, const FrameView& dst, ThreadPool* pool) ;
+
+	SCALE_FILTER Filter() const { return m_Filter ; }
+
+private:
+	// Weights of one pass, each destination pixel blends 'taps' source pixels from 'start'
+	struct FilterTaps
+	{
+		std::vector<int> start ;
+		std::vector<short> weights ;	// taps per destination pixel, zero padded
+		int taps ;
+	};
+
+	static void BuildTaps(int srcSize, int dstSize, SCALE_FILTER filter, FilterTaps& out) ;
+
+	void HorizontalRows(const FrameView& src, int firstRow, int lastRow) ;
+	void VerticalRows(const FrameView& dst, int firstRow, int lastRow) ;
+
+	int m_SrcWidth ;
+	int m_SrcHeight ;
+	int m_DstWidth ;
+	int m_DstHeight ;
+	SCALE_FILTER m_Filter ;
+
+	FilterTaps m_Horizontal ;
+	FilterTaps m_Vertical ;
+	FrameBuffer m_Intermediate ;	// dstWidth x srcHeight, output of the horizontal pass
+};
+
+// Peak signal to noise ratio over the B, G and R channels, in dB.
+// Identical frames return 99.
+double ComputePSNR(const FrameView& a, const FrameView& b) ;
+
+#endif // end __FRAME_SCALER_H__
@@ -0,0 +1,237 @@
+#include "ScreenCodec.h"
+#include "../Utility/Timer.h"
+
+// The structures go over the wire as they are, make sure no compiler pads them
+static_assert(sizeof(FrameHeader) == 32, "FrameHeader must be 32 bytes") ;
+static_assert(sizeof(TileHeader) == 12, "TileHeader must be 12 bytes") ;
+
+// Largest packet a reader accepts, a key frame of a 8K screen with raw tiles fits
+static const unsigned int MAX_PACKET_SIZE = 256 * 1024 * 1024 ;
+
+long long CaptureTimeNow()
+{
+	long long ticks = TimerTicks() ;
+	long long frequency = TimerFrequency() ;
+	return (ticks / frequency) * 1000000 + (ticks % frequency) * 1000000 / frequency ;
+}
+
+//
+// ScreenEncoder
+//
+
+ScreenEncoder::ScreenEncoder(void) : m_FrameIndex(0), m_bKeyFrame(true)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+ScreenEncoder::~ScreenEncoder(void)
+{
+}
+
+bool ScreenEncoder::Reset(int width, int height)
+{
+	m_FrameIndex = 0 ;
+	m_bKeyFrame = true ;
+	return m_Diff.Reset(width, height) ;
+}
+
+bool ScreenEncoder::Encode(const FrameView& frame, long long captureTime, std::vector<unsigned char>& packet)
+{
+	packet.clear() ;
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+
+	if (frame.width != m_Diff.Previous().width || frame.height != m_Diff.Previous().height)
+	{
+		Reset(frame.width, frame.height) ;
+	}
+
+	// Find the dirty tiles, the previous frame is kept until they are encoded since it is the delta reference
+	Timer timer ;
+	bool keyFrame = m_bKeyFrame ;
+	if (keyFrame)
+	{
+		m_Diff.Reset(frame.width, frame.height) ;
+	}
+	m_Diff.Diff(frame, m_Tiles, false) ;
+	m_Stats.diffMs = timer.ElapsedMs() ;
+
+	if (m_Tiles.empty())
+	{
+		return false ;
+	}
+
+	timer.Restart() ;
+
+	FrameHeader header ;
+	memset(&header, 0, sizeof(header)) ;
+	header.magic = SCREEN_STREAM_MAGIC ;
+	header.frameIndex = m_FrameIndex++ ;
+	header.captureTime = captureTime ;
+	header.width = (unsigned short)frame.width ;
+	header.height = (unsigned short)frame.height ;
+	header.tileSize = TileDiff::TILE_SIZE ;
+	header.flags = keyFrame ? SCREEN_FRAME_KEY : 0 ;
+	header.tileCount = (unsigned int)m_Tiles.size() ;
+
+	packet.resize(sizeof(FrameHeader)) ;
+
+	FrameView reference = m_Diff.Previous() ;
+	for (size_t i = 0; i < m_Tiles.size(); ++i)
+	{
+		const TileRect& tile = m_Tiles[i] ;
+
+		// Reserve the tile header, fill it once the size is known
+		size_t headerPos = packet.size() ;
+		packet.resize(headerPos + sizeof(TileHeader)) ;
+
+		TILE_ENCODING encoding = m_Codec.Encode(frame, tile, keyFrame ? NULL : &reference, packet) ;
+
+		TileHeader tileHeader ;
+		tileHeader.tileX = (unsigned short)(tile.left / TileDiff::TILE_SIZE) ;
+		tileHeader.tileY = (unsigned short)(tile.top / TileDiff::TILE_SIZE) ;
+		tileHeader.encoding = (unsigned char)encoding ;
+		tileHeader.reserved = 0 ;
+		tileHeader.pad = 0 ;
+		tileHeader.size = (unsigned int)(packet.size() - headerPos - sizeof(TileHeader)) ;
+		memcpy(&packet[headerPos], &tileHeader, sizeof(tileHeader)) ;
+
+		m_Stats.tilesByEncoding[encoding]++ ;
+		m_Stats.rawBytes += (size_t)(tile.right - tile.left) * (tile.bottom - tile.top) * FRAME_BYTES_PER_PIXEL ;
+	}
+
+	header.payloadSize = (unsigned int)(packet.size() - sizeof(FrameHeader)) ;
+	memcpy(&packet[0], &header, sizeof(header)) ;
+
+	// The viewer now has these tiles
+	m_Diff.Update(frame, m_Tiles) ;
+	m_bKeyFrame = false ;
+
+	m_Stats.dirtyTiles = (int)m_Tiles.size() ;
+	m_Stats.packetBytes = packet.size() ;
+	m_Stats.encodeMs = timer.ElapsedMs() ;
+
+	return true ;
+}
+
+//
+// ScreenDecoder
+//
+
+ScreenDecoder::ScreenDecoder(void) : m_bHasKeyFrame(false)
+{
+	memset(&m_Header, 0, sizeof(m_Header)) ;
+}
+
+ScreenDecoder::~ScreenDecoder(void)
+{
+}
+
+bool ScreenDecoder::Decode(const unsigned char* packet, size_t size, std::vector<TileRect>* updatedTiles)
+{
+	if (updatedTiles)
+	{
+		updatedTiles->clear() ;
+	}
+
+	if (size < sizeof(FrameHeader))
+	{
+		return false ;
+	}
+
+	FrameHeader header ;
+	memcpy(&header, packet, sizeof(header)) ;
+	if (header.magic != SCREEN_STREAM_MAGIC || header.tileSize == 0 ||
+		header.payloadSize != size - sizeof(FrameHeader))
+	{
+		return false ;
+	}
+
+	if (header.flags & SCREEN_FRAME_KEY)
+	{
+		if (!m_Frame.Create(header.width, header.height))
+		{
+			return false ;
+		}
+		m_bHasKeyFrame = true ;
+	}
+	else if (!m_bHasKeyFrame || header.width != m_Frame.Width() || header.height != m_Frame.Height())
+	{
+		return false ;
+	}
+
+	m_Header = header ;
+
+	FrameView frame = m_Frame.View() ;
+	const unsigned char* p = packet + sizeof(FrameHeader) ;
+	const unsigned char* end = packet + size ;
+
+	for (unsigned int i = 0; i < header.tileCount; ++i)
+	{
+		if ((size_t)(end - p) < sizeof(TileHeader))
+		{
+			return false ;
+		}
+
+		TileHeader tileHeader ;
+		memcpy(&tileHeader, p, sizeof(tileHeader)) ;
+		p += sizeof(TileHeader) ;
+
+		if ((size_t)(end - p) < tileHeader.size)
+		{
+			return false ;
+		}
+
+		TileRect tile ;
+		tile.left = tileHeader.tileX * header.tileSize ;
+		tile.top = tileHeader.tileY * header.tileSize ;
+		tile.right = tile.left + header.tileSize < frame.width ? tile.left + header.tileSize : frame.width ;
+		tile.bottom = tile.top + header.tileSize < frame.height ? tile.top + header.tileSize : frame.height ;
+
+		if (!TileCodec::Decode((TILE_ENCODING)tileHeader.encoding, p, tileHeader.size, frame, tile))
+		{
+			return false ;
+		}
+
+		if (updatedTiles)
+		{
+			updatedTiles->push_back(tile) ;
+		}
+
+		p += tileHeader.size ;
+	}
+
+	return p == end ;
+}
+
+//
+// Stream framing
+//
+
+bool WritePacket(ByteStream& stream, const std::vector<unsigned char>& packet)
+{
+	if (packet.empty())
+	{
+		return true ;
+	}
+
+	return stream.Write(&packet[0], packet.size()) ;
+}
+
+bool ReadPacket(ByteStream& stream, std::vector<unsigned char>& packet)
+{
+	FrameHeader header ;
+	if (!stream.Read(&header, sizeof(header)))
+	{
+		return false ;
+	}
+
+	if (header.magic != SCREEN_STREAM_MAGIC || header.payloadSize > MAX_PACKET_SIZE)
+	{
+		return false ;
+	}
+
+	packet.resize(sizeof(header) + header.payloadSize) ;
+	memcpy(&packet[0], &header, sizeof(header)) ;
+
+	return header.payloadSize == 0 || stream.Read(&packet[sizeof(header)], header.payloadSize) ;
+}
@@ -0,0 +1,119 @@
+#ifndef __SCREEN_CODEC_H__
+#define __SCREEN_CODEC_H__
+
+#include <vector>
+#include "Frame.h"
+#include "TileDiff.h"
+#include "TileCodec.h"
+#include "ByteStream.h"
+
+/*
+Screen share stream format, all fields little-endian.
+
+Every frame is one packet:
+	FrameHeader
+	tileCount x (TileHeader + TileHeader.size bytes of tile data)
+
+A key frame carries every tile without delta coding, so a viewer can start from it.
+Other frames only carry the tiles that changed since the previous frame.
+*/
+
+#define SCREEN_STREAM_MAGIC 0x31465353	// "SSF1"
+
+enum SCREEN_FRAME_FLAGS
+{
+	SCREEN_FRAME_KEY = 0x1,		// all tiles present, no delta against older frames
+};
+
+struct FrameHeader
+{
+	unsigned int magic ;
+	unsigned int frameIndex ;
+	long long captureTime ;		// microseconds, sender's monotonic clock
+	unsigned short width ;
+	unsigned short height ;
+	unsigned short tileSize ;
+	unsigned short flags ;
+	unsigned int tileCount ;
+	unsigned int payloadSize ;	// bytes following this header
+};
+
+struct TileHeader
+{
+	unsigned short tileX ;		// tile column
+	unsigned short tileY ;		// tile row
+	unsigned char encoding ;	// TILE_ENCODING
+	unsigned char reserved ;
+	unsigned short pad ;
+	unsigned int size ;			// bytes of tile data following this header
+};
+
+// Per frame numbers reported by the encoder
+struct EncodeStats
+{
+	int dirtyTiles ;
+	int tilesByEncoding[4] ;	// indexed by TILE_ENCODING
+	size_t rawBytes ;			// size of the dirty tiles uncompressed
+	size_t packetBytes ;		// size of the packet, header included
+	double diffMs ;
+	double encodeMs ;
+};
+
+// Turns captured frames into packets
+class ScreenEncoder
+{
+public:
+	ScreenEncoder(void);
+	~ScreenEncoder(void);
+
+	// Start a new stream, the next frame is a key frame
+	bool Reset(int width, int height) ;
+
+	// Ask for a key frame, e.g. when a viewer joins
+	void RequestKeyFrame() { m_bKeyFrame = true ; }
+
+	// Encode frame into packet, return false if nothing changed (packet is left empty).
+	// captureTime is in microseconds, see CaptureTimeNow.
+	bool Encode(const FrameView& frame, long long captureTime, std::vector<unsigned char>& packet) ;
+
+	const EncodeStats& LastStats() const { return m_Stats ; }
+
+private:
+	TileDiff m_Diff ;					// also holds the frame the viewer has
+	TileCodec m_Codec ;
+	std::vector<TileRect> m_Tiles ;
+	unsigned int m_FrameIndex ;
+	bool m_bKeyFrame ;
+	EncodeStats m_Stats ;
+};
+
+// Rebuilds frames from packets
+class ScreenDecoder
+{
+public:
+	ScreenDecoder(void);
+	~ScreenDecoder(void);
+
+	// Apply one packet, updatedTiles (optional) receives the rectangles that changed.
+	// Return false if the packet is malformed or a delta frame arrives before a key frame.
+	bool Decode(const unsigned char* packet, size_t size, std::vector<TileRect>* updatedTiles) ;
+
+	FrameView Frame() const { return m_Frame.View() ; }
+	const FrameHeader& LastHeader() const { return m_Header ; }
+
+private:
+	FrameBuffer m_Frame ;
+	FrameHeader m_Header ;
+	bool m_bHasKeyFrame ;
+};
+
+// Microseconds on the monotonic clock used for the captureTime field
+long long CaptureTimeNow() ;
+
+// Send one packet
+bool WritePacket(ByteStream& stream, const std::vector<unsigned char>& packet) ;
+
+// Receive one packet, return false when the stream ended or the header is invalid
+bool ReadPacket(ByteStream& stream, std::vector<unsigned char>& packet) ;
+
+#endif // end __SCREEN_CODEC_H__
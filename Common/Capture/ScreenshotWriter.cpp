@@ -0,0 +1,259 @@
+#include "ScreenshotWriter.h"
+#include "../Utility/Timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+static bool WriteFileBytes(const std::string& path, const std::vector<unsigned char>& data)
+{
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path.c_str(), "wb") != 0)
+	{
+		file = NULL ;
+	}
+#else
+	file = fopen(path.c_str(), "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	bool ok = fwrite(&data[0], 1, data.size(), file) == data.size() ;
+	return fclose(file) == 0 && ok ;
+}
+
+ScreenshotWriter::ScreenshotWriter(void)
+	: m_bRunning(false),
+	  m_bStop(false),
+	  m_Encoding(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+ScreenshotWriter::~ScreenshotWriter(void)
+{
+	Stop() ;
+}
+
+bool ScreenshotWriter::Start(int queueDepth, int encoderThreads)
+{
+	if (m_bRunning || queueDepth <= 0 || encoderThreads <= 0)
+	{
+		return false ;
+	}
+
+	// Buffers are allocated on first use, Acquire sizes them to the frame
+	for (int i = 0; i < queueDepth; ++i)
+	{
+		m_Buffers.push_back(new FrameBuffer) ;
+	}
+	m_Free = m_Buffers ;
+
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+	m_bStop = false ;
+	m_bRunning = true ;
+	for (int i = 0; i < encoderThreads; ++i)
+	{
+		m_Threads.push_back(std::thread(&ScreenshotWriter::EncoderLoop, this)) ;
+	}
+
+	return true ;
+}
+
+void ScreenshotWriter::Stop()
+{
+	if (!m_bRunning)
+	{
+		return ;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		m_bStop = true ;
+	}
+	m_JobReady.notify_all() ;
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+	{
+		m_Threads[i].join() ;
+	}
+	m_Threads.clear() ;
+
+	// Wake callers waiting for a buffer, Acquire returns NULL once stopped
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		m_bRunning = false ;
+	}
+	m_BufferFree.notify_all() ;
+	m_Idle.notify_all() ;
+
+	for (size_t i = 0; i < m_Buffers.size(); ++i)
+	{
+		delete m_Buffers[i] ;
+	}
+	m_Buffers.clear() ;
+	m_Free.clear() ;
+}
+
+FrameBuffer* ScreenshotWriter::Acquire(int width, int height, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex) ;
+	if (!m_bRunning || m_bStop)
+	{
+		return NULL ;
+	}
+
+	if (m_Free.empty())
+	{
+		// Back-pressure: every buffer is waiting to be encoded
+		Timer timer ;
+		++m_Stats.stalls ;
+
+		if (timeoutMs < 0)
+		{
+			m_BufferFree.wait(lock, [this]() { return !m_Free.empty() || m_bStop ; }) ;
+		}
+		else
+		{
+			m_BufferFree.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+				[this]() { return !m_Free.empty() || m_bStop ; }) ;
+		}
+
+		m_Stats.stallMs += timer.ElapsedMs() ;
+		if (m_Free.empty() || m_bStop)
+		{
+			return NULL ;
+		}
+	}
+
+	FrameBuffer* buffer = m_Free.back() ;
+	m_Free.pop_back() ;
+	lock.unlock() ;
+
+	// Reallocate only when the size changed, the old content is overwritten by the caller anyway
+	if (buffer->Width() != width || buffer->Height() != height)
+	{
+		if (!buffer->Create(width, height))
+		{
+			Cancel(buffer) ;
+			return NULL ;
+		}
+	}
+
+	return buffer ;
+}
+
+void ScreenshotWriter::Submit(FrameBuffer* buffer, const std::string& path, IMAGE_FORMAT format)
+{
+	Job job ;
+	job.buffer = buffer ;
+	job.path = path ;
+	job.format = format ;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		m_Queue.push_back(job) ;
+
+		int pending = (int)m_Queue.size() + m_Encoding ;
+		if (pending > m_Stats.maxPending)
+		{
+			m_Stats.maxPending = pending ;
+		}
+	}
+	m_JobReady.notify_one() ;
+}
+
+void ScreenshotWriter::Cancel(FrameBuffer* buffer)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		m_Free.push_back(buffer) ;
+	}
+	m_BufferFree.notify_one() ;
+}
+
+bool ScreenshotWriter::Write(const FrameView& frame, const std::string& path, IMAGE_FORMAT format, int timeoutMs)
+{
+	FrameBuffer* buffer = Acquire(frame.width, frame.height, timeoutMs) ;
+	if (!buffer)
+	{
+		return false ;
+	}
+
+	CopyFrameRect(buffer->View(), 0, 0, frame, 0, 0, frame.width, frame.height) ;
+	Submit(buffer, path, format) ;
+	return true ;
+}
+
+void ScreenshotWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex) ;
+	m_Idle.wait(lock, [this]() { return !m_bRunning || (m_Queue.empty() && m_Encoding == 0) ; }) ;
+}
+
+ScreenshotStats ScreenshotWriter::Stats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	ScreenshotStats stats = m_Stats ;
+	stats.pending = (int)m_Queue.size() + m_Encoding ;
+	return stats ;
+}
+
+void ScreenshotWriter::EncoderLoop()
+{
+	std::vector<unsigned char> file ;
+
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex) ;
+		m_JobReady.wait(lock, [this]() { return !m_Queue.empty() || m_bStop ; }) ;
+
+		// Stopping still writes everything that was queued
+		if (m_Queue.empty())
+		{
+			m_Idle.notify_all() ;
+			return ;
+		}
+
+		Job job = m_Queue.front() ;
+		m_Queue.pop_front() ;
+		++m_Encoding ;
+		lock.unlock() ;
+
+		FrameView view = job.buffer->View() ;
+		ImageDesc image = { view.pixels, view.width, view.height, view.pitch, false } ;
+
+		file.clear() ;
+		Timer timer ;
+		bool ok = EncodeImage(job.format, image, file) ;
+		double encodeMs = timer.ElapsedMs() ;
+
+		// The pixels are no longer needed, let the capture side reuse the buffer while the file is written
+		Cancel(job.buffer) ;
+
+		timer.Restart() ;
+		ok = ok && WriteFileBytes(job.path, file) ;
+		double writeMs = timer.ElapsedMs() ;
+
+		lock.lock() ;
+		--m_Encoding ;
+		m_Stats.encodeMs += encodeMs ;
+		m_Stats.writeMs += writeMs ;
+		if (ok)
+		{
+			++m_Stats.written ;
+			m_Stats.bytesWritten += file.size() ;
+		}
+		else
+		{
+			++m_Stats.failed ;
+		}
+
+		if (m_Queue.empty() && m_Encoding == 0)
+		{
+			m_Idle.notify_all() ;
+		}
+	}
+}
@@ -0,0 +1,95 @@
+#ifndef __SCREENSHOT_WRITER_H__
+#define __SCREENSHOT_WRITER_H__
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Frame.h"
+#include "../Image/ImageWriter.h"
+
+// Counters since Start
+struct ScreenshotStats
+{
+	int written ;			// files written successfully
+	int failed ;			// encode or file errors
+	int pending ;			// shots queued or being encoded right now
+	int maxPending ;		// deepest the queue got
+	int stalls ;			// Acquire calls that had to wait for a free buffer
+	double stallMs ;		// total time spent waiting in Acquire
+	double encodeMs ;		// total time spent encoding
+	double writeMs ;		// total time spent writing files
+	size_t bytesWritten ;
+};
+
+/*
+Save screenshots without stalling the render thread.
+
+The caller copies a frame into one of a fixed set of staging buffers and queues it,
+background threads encode the queued buffers and write the files. The number of
+buffers bounds the memory used; when they are all queued Acquire waits for an encoder
+to free one, so a burst of shots slows down capture instead of dropping shots.
+*/
+class ScreenshotWriter
+{
+public:
+	ScreenshotWriter(void);
+	~ScreenshotWriter(void);
+
+	// Start encoderThreads encoder threads with queueDepth staging buffers
+	bool Start(int queueDepth = 8, int encoderThreads = 1) ;
+
+	// Write what is still queued, then stop the encoder threads
+	void Stop() ;
+
+	// Get a staging buffer of the given size to copy a frame into.
+	// Waits up to timeoutMs for a free buffer, -1 waits as long as it takes.
+	// Return NULL on timeout or if the writer is not started.
+	FrameBuffer* Acquire(int width, int height, int timeoutMs = -1) ;
+
+	// Queue a buffer from Acquire to be saved as path, the writer owns it again after this
+	void Submit(FrameBuffer* buffer, const std::string& path, IMAGE_FORMAT format) ;
+
+	// Give back a buffer from Acquire without saving it
+	void Cancel(FrameBuffer* buffer) ;
+
+	// Acquire, copy frame and Submit in one call
+	bool Write(const FrameView& frame, const std::string& path, IMAGE_FORMAT format, int timeoutMs = -1) ;
+
+	// Wait until every queued shot was written
+	void Flush() ;
+
+	ScreenshotStats Stats() ;
+
+private:
+	struct Job
+	{
+		FrameBuffer* buffer ;
+		std::string path ;
+		IMAGE_FORMAT format ;
+	};
+
+	void EncoderLoop() ;
+
+	std::vector<FrameBuffer*> m_Buffers ;	// all staging buffers
+	std::vector<FrameBuffer*> m_Free ;		// buffers not acquired or queued
+	std::deque<Job> m_Queue ;
+
+	std::mutex m_Mutex ;
+	std::condition_variable m_BufferFree ;
+	std::condition_variable m_JobReady ;
+	std::condition_variable m_Idle ;
+	std::vector<std::thread> m_Threads ;
+	bool m_bRunning ;
+	bool m_bStop ;
+	int m_Encoding ;						// jobs taken off the queue and not finished yet
+
+	ScreenshotStats m_Stats ;
+
+	ScreenshotWriter(const ScreenshotWriter&) ;
+	ScreenshotWriter& operator=(const ScreenshotWriter&) ;
+};
+
+#endif // end __SCREENSHOT_WRITER_H__
@@ -0,0 +1,219 @@
+#include "TileCodec.h"
+
+// Longest run or literal block one header byte can describe
+static const int MAX_PACKET = 128 ;
+
+// Gather the pixels of a tile into a packed array
+static void GatherTile(const FrameView& frame, const TileRect& tile, unsigned int* pixels)
+{
+	int width = tile.right - tile.left ;
+	for (int y = tile.top; y < tile.bottom; ++y)
+	{
+		memcpy(pixels, frame.Row(y) + tile.left * FRAME_BYTES_PER_PIXEL, width * FRAME_BYTES_PER_PIXEL) ;
+		pixels += width ;
+	}
+}
+
+static void AppendPixels(std::vector<unsigned char>& out, const unsigned int* pixels, int count)
+{
+	const unsigned char* bytes = (const unsigned char*)pixels ;
+	out.insert(out.end(), bytes, bytes + count * FRAME_BYTES_PER_PIXEL) ;
+}
+
+TileCodec::TileCodec(void)
+{
+	m_Pixels.resize(TileDiff::TILE_SIZE * TileDiff::TILE_SIZE) ;
+	m_Delta.resize(TileDiff::TILE_SIZE * TileDiff::TILE_SIZE) ;
+}
+
+TileCodec::~TileCodec(void)
+{
+}
+
+void TileCodec::EncodeRLE(const unsigned int* pixels, int count, std::vector<unsigned char>& out)
+{
+	int i = 0 ;
+	while (i < count)
+	{
+		// Length of the run starting at i
+		int run = 1 ;
+		while (i + run < count && run < MAX_PACKET && pixels[i + run] == pixels[i])
+		{
+			++run ;
+		}
+
+		if (run >= 2)
+		{
+			out.push_back((unsigned char)(0x80 | (run - 1))) ;
+			AppendPixels(out, pixels + i, 1) ;
+			i += run ;
+			continue ;
+		}
+
+		// Literal block, stops where the next run of two equal pixels starts
+		int literal = 1 ;
+		while (i + literal < count && literal < MAX_PACKET)
+		{
+			int j = i + literal ;
+			if (j + 1 < count && pixels[j + 1] == pixels[j])
+			{
+				break ;
+			}
+			++literal ;
+		}
+
+		out.push_back((unsigned char)(literal - 1)) ;
+		AppendPixels(out, pixels + i, literal) ;
+		i += literal ;
+	}
+}
+
+TILE_ENCODING TileCodec::Encode(const FrameView& frame, const TileRect& tile, const FrameView* reference,
+								std::vector<unsigned char>& out)
+{
+	int count = (tile.right - tile.left) * (tile.bottom - tile.top) ;
+	unsigned int* pixels = &m_Pixels[0] ;
+	GatherTile(frame, tile, pixels) ;
+
+	// Solid color
+	bool solid = true ;
+	for (int i = 1; i < count; ++i)
+	{
+		if (pixels[i] != pixels[0])
+		{
+			solid = false ;
+			break ;
+		}
+	}
+
+	if (solid)
+	{
+		AppendPixels(out, pixels, 1) ;
+		return TILE_SOLID ;
+	}
+
+	m_Rle.clear() ;
+	EncodeRLE(pixels, count, m_Rle) ;
+
+	m_DeltaRle.clear() ;
+	if (reference)
+	{
+		unsigned int* delta = &m_Delta[0] ;
+		GatherTile(*reference, tile, delta) ;
+		for (int i = 0; i < count; ++i)
+		{
+			delta[i] ^= pixels[i] ;
+		}
+		EncodeRLE(delta, count, m_DeltaRle) ;
+	}
+
+	size_t rawSize = (size_t)count * FRAME_BYTES_PER_PIXEL ;
+	size_t rleSize = m_Rle.size() ;
+	size_t deltaSize = reference ? m_DeltaRle.size() : rawSize + 1 ;
+
+	if (deltaSize < rleSize && deltaSize < rawSize)
+	{
+		out.insert(out.end(), m_DeltaRle.begin(), m_DeltaRle.end()) ;
+		return TILE_DELTA_RLE ;
+	}
+
+	if (rleSize < rawSize)
+	{
+		out.insert(out.end(), m_Rle.begin(), m_Rle.end()) ;
+		return TILE_RLE ;
+	}
+
+	AppendPixels(out, pixels, count) ;
+	return TILE_RAW ;
+}
+
+bool TileCodec::Decode(TILE_ENCODING encoding, const unsigned char* data, size_t size,
+					   const FrameView& frame, const TileRect& tile)
+{
+	int width = tile.right - tile.left ;
+	int count = width * (tile.bottom - tile.top) ;
+	if (tile.left < 0 || tile.top < 0 || tile.right > frame.width || tile.bottom > frame.height || count <= 0)
+	{
+		return false ;
+	}
+
+	switch (encoding)
+	{
+	case TILE_RAW:
+		{
+			if (size != (size_t)count * FRAME_BYTES_PER_PIXEL)
+			{
+				return false ;
+			}
+
+			FrameView src((unsigned char*)data, width, tile.bottom - tile.top, width * FRAME_BYTES_PER_PIXEL) ;
+			CopyFrameRect(frame, tile.left, tile.top, src, 0, 0, width, tile.bottom - tile.top) ;
+			return true ;
+		}
+
+	case TILE_SOLID:
+		{
+			if (size != FRAME_BYTES_PER_PIXEL)
+			{
+				return false ;
+			}
+
+			unsigned int color ;
+			memcpy(&color, data, sizeof(color)) ;
+			for (int y = tile.top; y < tile.bottom; ++y)
+			{
+				unsigned int* row = (unsigned int*)frame.Row(y) + tile.left ;
+				for (int x = 0; x < width; ++x)
+				{
+					row[x] = color ;
+				}
+			}
+			return true ;
+		}
+
+	case TILE_RLE:
+	case TILE_DELTA_RLE:
+		{
+			bool delta = encoding == TILE_DELTA_RLE ;
+			const unsigned char* end = data + size ;
+			int x = 0 ;
+			int y = tile.top ;
+			int decoded = 0 ;
+
+			while (data < end)
+			{
+				unsigned char header = *data++ ;
+				int length = (header & 0x7F) + 1 ;
+				bool run = (header & 0x80) != 0 ;
+				size_t bytes = run ? FRAME_BYTES_PER_PIXEL : (size_t)length * FRAME_BYTES_PER_PIXEL ;
+				if ((size_t)(end - data) < bytes || decoded + length > count)
+				{
+					return false ;
+				}
+
+				for (int i = 0; i < length; ++i)
+				{
+					unsigned int value ;
+					memcpy(&value, data + (run ? 0 : i * FRAME_BYTES_PER_PIXEL), sizeof(value)) ;
+
+					unsigned int* pixel = (unsigned int*)frame.Row(y) + tile.left + x ;
+					*pixel = delta ? (*pixel ^ value) : value ;
+
+					if (++x == width)
+					{
+						x = 0 ;
+						++y ;
+					}
+				}
+
+				data += bytes ;
+				decoded += length ;
+			}
+
+			return decoded == count ;
+		}
+
+	default:
+		return false ;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef __TILE_CODEC_H__
+#define __TILE_CODEC_H__
+
+#include <vector>
+#include "Frame.h"
+#include "TileDiff.h"
+
+/*
+Lossless compression of a single tile, cheap enough to run on every dirty tile of every frame.
+
+Pixels are coded row after row as 32 bit values with a PackBits style run-length code:
+a header byte with the high bit set is followed by one pixel repeated (header & 0x7F) + 1 times,
+a header byte with the high bit clear is followed by (header + 1) literal pixels.
+
+The delta mode codes the XOR of the tile with the same tile of the reference frame, so a tile
+where only a few pixels changed becomes long runs of zero. The encoder tries each mode and keeps
+the smallest, raw pixels are the fall back for noise-like content.
+*/
+enum TILE_ENCODING
+{
+	TILE_RAW		= 0,	// width * height * 4 bytes of BGRA
+	TILE_SOLID		= 1,	// one BGRA value fills the tile
+	TILE_RLE		= 2,	// run-length coded pixels
+	TILE_DELTA_RLE	= 3,	// run-length coded XOR against the reference tile
+};
+
+class TileCodec
+{
+public:
+	TileCodec(void);
+	~TileCodec(void);
+
+	// Append the compressed tile to out and return the encoding used.
+	// reference is the frame the decoder holds, NULL to encode without delta (e.g. key frames).
+	TILE_ENCODING Encode(const FrameView& frame, const TileRect& tile, const FrameView* reference,
+		std::vector<unsigned char>& out) ;
+
+	// Decode a tile into frame, for TILE_DELTA_RLE frame must hold the reference content of the tile.
+	// Return false if the data is corrupted.
+	static bool Decode(TILE_ENCODING encoding, const unsigned char* data, size_t size,
+		const FrameView& frame, const TileRect& tile) ;
+
+private:
+	// Run-length code count pixels and append them to out
+	static void EncodeRLE(const unsigned int* pixels, int count, std::vector<unsigned char>& out) ;
+
+	std::vector<unsigned int> m_Pixels ;		// tile pixels, packed
+	std::vector<unsigned int> m_Delta ;			// tile XOR reference
+	std::vector<unsigned char> m_Rle ;			// scratch for RLE output
+	std::vector<unsigned char> m_DeltaRle ;		// scratch for delta RLE output
+};
+
+#endif // end __TILE_CODEC_H__
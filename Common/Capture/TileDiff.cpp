@@ -0,0 +1,162 @@
+#include "TileDiff.h"
+#include "../Utility/Simd.h"
+
+// Return true if the two rows hold the same bytes
+static bool RowEqual(const unsigned char* a, const unsigned char* b, int bytes)
+{
+	int i = 0 ;
+
+#if defined(SIMD_AVX2)
+	for (; i + 64 <= bytes; i += 64)
+	{
+		__m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i)) ;
+		__m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 32)) ;
+		__m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i)) ;
+		__m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 32)) ;
+		__m256i diff = _mm256_or_si256(_mm256_xor_si256(a0, b0), _mm256_xor_si256(a1, b1)) ;
+		if (!_mm256_testz_si256(diff, diff))
+		{
+			return false ;
+		}
+	}
+#endif
+
+#if defined(SIMD_SSE2)
+	for (; i + 64 <= bytes; i += 64)
+	{
+		__m128i e0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i)),      _mm_loadu_si128((const __m128i*)(b + i))) ;
+		__m128i e1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i + 16)), _mm_loadu_si128((const __m128i*)(b + i + 16))) ;
+		__m128i e2 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i + 32)), _mm_loadu_si128((const __m128i*)(b + i + 32))) ;
+		__m128i e3 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i + 48)), _mm_loadu_si128((const __m128i*)(b + i + 48))) ;
+		__m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3)) ;
+		if (_mm_movemask_epi8(all) != 0xFFFF)
+		{
+			return false ;
+		}
+	}
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i e = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i))) ;
+		if (_mm_movemask_epi8(e) != 0xFFFF)
+		{
+			return false ;
+		}
+	}
+#endif
+
+	return memcmp(a + i, b + i, bytes - i) == 0 ;
+}
+
+TileDiff::TileDiff(void)
+	: m_TilesX(0),
+	  m_TilesY(0),
+	  m_bFullDirty(true),
+	  m_LastDirtyCount(0),
+	  m_LastBytesCompared(0)
+{
+}
+
+TileDiff::~TileDiff(void)
+{
+}
+
+bool TileDiff::Reset(int width, int height)
+{
+	m_TilesX = (width + TILE_SIZE - 1) / TILE_SIZE ;
+	m_TilesY = (height + TILE_SIZE - 1) / TILE_SIZE ;
+	m_bFullDirty = true ;
+	return m_Previous.Create(width, height) ;
+}
+
+bool TileDiff::TileEqual(const FrameView& frame, const TileRect& tile, unsigned long long& bytesCompared) const
+{
+	FrameView previous = m_Previous.View() ;
+	int rowBytes = (tile.right - tile.left) * FRAME_BYTES_PER_PIXEL ;
+	int offset = tile.left * FRAME_BYTES_PER_PIXEL ;
+
+	for (int y = tile.top; y < tile.bottom; ++y)
+	{
+		bytesCompared += rowBytes ;
+		if (!RowEqual(frame.Row(y) + offset, previous.Row(y) + offset, rowBytes))
+		{
+			return false ;
+		}
+	}
+
+	return true ;
+}
+
+int TileDiff::Diff(const FrameView& frame, std::vector<TileRect>& dirtyTiles, bool updatePrevious)
+{
+	dirtyTiles.clear() ;
+
+	if (frame.width != m_Previous.Width() || frame.height != m_Previous.Height())
+	{
+		Reset(frame.width, frame.height) ;
+	}
+
+	unsigned long long bytesCompared = 0 ;
+
+	for (int ty = 0; ty < m_TilesY; ++ty)
+	{
+		for (int tx = 0; tx < m_TilesX; ++tx)
+		{
+			TileRect tile ;
+			tile.left = tx * TILE_SIZE ;
+			tile.top = ty * TILE_SIZE ;
+			tile.right = tile.left + TILE_SIZE < frame.width ? tile.left + TILE_SIZE : frame.width ;
+			tile.bottom = tile.top + TILE_SIZE < frame.height ? tile.top + TILE_SIZE : frame.height ;
+
+			if (!m_bFullDirty && TileEqual(frame, tile, bytesCompared))
+			{
+				continue ;
+			}
+
+			dirtyTiles.push_back(tile) ;
+		}
+	}
+
+	// Remember the new content for the next frame
+	if (updatePrevious)
+	{
+		Update(frame, dirtyTiles) ;
+	}
+
+	m_bFullDirty = false ;
+	m_LastDirtyCount = (int)dirtyTiles.size() ;
+	m_LastBytesCompared = bytesCompared ;
+
+	return m_LastDirtyCount ;
+}
+
+void TileDiff::Update(const FrameView& frame, const std::vector<TileRect>& tiles)
+{
+	FrameView previous = m_Previous.View() ;
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		const TileRect& tile = tiles[i] ;
+		CopyFrameRect(previous, tile.left, tile.top, frame, tile.left, tile.top,
+			tile.right - tile.left, tile.bottom - tile.top) ;
+	}
+}
+
+void TileDiff::MergeRows(const std::vector<TileRect>& tiles, std::vector<TileRect>& rects)
+{
+	rects.clear() ;
+
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		const TileRect& tile = tiles[i] ;
+		if (!rects.empty())
+		{
+			TileRect& last = rects.back() ;
+			if (last.top == tile.top && last.right == tile.left)
+			{
+				last.right = tile.right ;
+				continue ;
+			}
+		}
+
+		rects.push_back(tile) ;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef __TILE_DIFF_H__
+#define __TILE_DIFF_H__
+
+#include <vector>
+#include "Frame.h"
+
+// A rectangle in pixels, right and bottom are exclusive like a Win32 RECT
+struct TileRect
+{
+	int left ;
+	int top ;
+	int right ;
+	int bottom ;
+};
+
+/*
+Find the parts of the screen that changed since the last frame.
+
+The frame is divided into TILE_SIZE x TILE_SIZE tiles (edge tiles may be smaller), each tile
+is compared with the same tile of the previous frame using SSE2 (or AVX2 when the compiler
+targets it), the compare stops at the first different row. Only the tiles that changed are
+copied into the previous frame, so an idle desktop costs one read of the frame and no writes.
+
+Works on plain BGRA buffers, so it runs the same on a locked D3D surface, a DIB section or
+a synthetic frame in a benchmark.
+*/
+class TileDiff
+{
+public:
+	static const int TILE_SIZE = 64 ;
+
+	TileDiff(void);
+	~TileDiff(void);
+
+	// Set frame size, the next Diff reports every tile as dirty
+	bool Reset(int width, int height) ;
+
+	// Compare frame with the previous one, fill dirtyTiles with the changed tiles
+	// in row-major order and return the number of them.
+	// With updatePrevious false the previous frame is left alone, so a caller can still
+	// read the old content of the dirty tiles (e.g. to delta encode them) and call Update later.
+	int Diff(const FrameView& frame, std::vector<TileRect>& dirtyTiles, bool updatePrevious = true) ;
+
+	// Copy the given tiles of frame into the previous frame
+	void Update(const FrameView& frame, const std::vector<TileRect>& tiles) ;
+
+	// Merge horizontally adjacent dirty tiles of the same tile row into one rectangle,
+	// cuts down the number of blits/UpdateSurface calls downstream
+	static void MergeRows(const std::vector<TileRect>& tiles, std::vector<TileRect>& rects) ;
+
+	// Previous frame as seen by the diff
+	FrameView Previous() const { return m_Previous.View() ; }
+
+	int TilesX() const { return m_TilesX ; }
+	int TilesY() const { return m_TilesY ; }
+	int TileCount() const { return m_TilesX * m_TilesY ; }
+
+	// Statistics of the last Diff call
+	int LastDirtyCount() const { return m_LastDirtyCount ; }
+	unsigned long long LastBytesCompared() const { return m_LastBytesCompared ; }
+
+private:
+	bool TileEqual(const FrameView& frame, const TileRect& tile, unsigned long long& bytesCompared) const ;
+
+	FrameBuffer m_Previous ;	// copy of the last frame
+	int m_TilesX ;
+	int m_TilesY ;
+	bool m_bFullDirty ;			// no previous frame yet, everything is dirty
+
+	int m_LastDirtyCount ;
+	unsigned long long m_LastBytesCompared ;
+};
+
+#endif // end __TILE_DIFF_H__
@@ -0,0 +1,215 @@
+#include "D2DImageCache.h"
+#include "AssetPack.h"
+
+#include <wincodec.h>
+
+#define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
+
+WicImageDecoder::WicImageDecoder(void)
+	: m_pWICFactory(NULL),
+	  m_pAssets(NULL),
+	  m_bComInitialized(false)
+{
+}
+
+WicImageDecoder::~WicImageDecoder(void)
+{
+	SAFE_RELEASE(m_pWICFactory) ;
+
+	if (m_bComInitialized)
+	{
+		CoUninitialize() ;
+	}
+}
+
+bool WicImageDecoder::Decode(const ImageKey& key, DecodedImage& image)
+{
+	if (!m_pWICFactory)
+	{
+		// The factory is a COM object, a thread that already uses COM keeps its apartment
+		m_bComInitialized = SUCCEEDED(CoInitializeEx(NULL, COINIT_APARTMENTTHREADED)) ;
+
+		HRESULT hr = CoCreateInstance(
+			CLSID_WICImagingFactory1,
+			NULL,
+			CLSCTX_INPROC_SERVER,
+			IID_IWICImagingFactory,
+			reinterpret_cast<void **>(&m_pWICFactory)
+			) ;
+		if (FAILED(hr))
+		{
+			return false ;
+		}
+	}
+
+	// Decode from memory, the file is either an entry of the pack or mapped on its own
+	AssetPack noPack ;
+	AssetPack* pAssets = m_pAssets ? m_pAssets : &noPack ;
+	Asset asset ;
+	if (!pAssets->Load(key.path.c_str(), asset))
+	{
+		return false ;
+	}
+
+	IWICStream* pStream = NULL ;
+	IWICBitmapDecoder* pDecoder = NULL ;
+	IWICBitmapFrameDecode* pSource = NULL ;
+	IWICBitmapScaler* pScaler = NULL ;
+	IWICFormatConverter* pConverter = NULL ;
+	IWICBitmapSource* pScaled = NULL ;
+
+	HRESULT hr = m_pWICFactory->CreateStream(&pStream) ;
+	if (SUCCEEDED(hr))
+	{
+		hr = pStream->InitializeFromMemory((BYTE*)asset.Data(), (DWORD)asset.Size()) ;
+	}
+	if (SUCCEEDED(hr))
+	{
+		hr = m_pWICFactory->CreateDecoderFromStream(pStream, NULL, WICDecodeMetadataCacheOnLoad, &pDecoder) ;
+	}
+	if (SUCCEEDED(hr))
+	{
+		hr = pDecoder->GetFrame(0, &pSource) ;
+	}
+
+	UINT width = 0 ;
+	UINT height = 0 ;
+	if (SUCCEEDED(hr))
+	{
+		hr = pSource->GetSize(&width, &height) ;
+	}
+	if (SUCCEEDED(hr))
+	{
+		pScaled = pSource ;
+
+		UINT destWidth ;
+		UINT destHeight ;
+		ScaledSize(width, height, key.width, key.height, destWidth, destHeight) ;
+
+		if (destWidth != width || destHeight != height)
+		{
+			hr = m_pWICFactory->CreateBitmapScaler(&pScaler) ;
+			if (SUCCEEDED(hr))
+			{
+				hr = pScaler->Initialize(pSource, destWidth, destHeight, WICBitmapInterpolationModeCubic) ;
+			}
+			pScaled = pScaler ;
+			width = destWidth ;
+			height = destHeight ;
+		}
+	}
+	if (SUCCEEDED(hr))
+	{
+		hr = m_pWICFactory->CreateFormatConverter(&pConverter) ;
+	}
+	if (SUCCEEDED(hr))
+	{
+		// 32bppPBGRA is DXGI_FORMAT_B8G8R8A8_UNORM with premultiplied alpha, 32bppBGR the same without alpha
+		WICPixelFormatGUID format = key.format == PIXEL_BGRX ? GUID_WICPixelFormat32bppBGR : GUID_WICPixelFormat32bppPBGRA ;
+		hr = pConverter->Initialize(pScaled, format, WICBitmapDitherTypeNone, NULL, 0.f, WICBitmapPaletteTypeMedianCut) ;
+	}
+	if (SUCCEEDED(hr) && (width == 0 || height == 0 || width > 0x7FFFFFFF / 4 / height))
+	{
+		hr = E_INVALIDARG ;
+	}
+	if (SUCCEEDED(hr))
+	{
+		image.width = width ;
+		image.height = height ;
+		image.pitch = width * 4 ;
+		image.format = key.format ;
+		image.pixels.resize((size_t)image.pitch * height) ;
+
+		// Decoding happens here, the objects before only describe the steps
+		hr = pConverter->CopyPixels(NULL, image.pitch, (UINT)image.pixels.size(), &image.pixels[0]) ;
+	}
+
+	SAFE_RELEASE(pConverter) ;
+	SAFE_RELEASE(pScaler) ;
+	SAFE_RELEASE(pSource) ;
+	SAFE_RELEASE(pDecoder) ;
+	SAFE_RELEASE(pStream) ;
+
+	return SUCCEEDED(hr) ;
+}
+
+HRESULT CreateD2DBitmap(ID2D1RenderTarget* pRenderTarget, const DecodedImage& image, ID2D1Bitmap** ppBitmap)
+{
+	D2D1_ALPHA_MODE alphaMode = image.format == PIXEL_BGRX ? D2D1_ALPHA_MODE_IGNORE : D2D1_ALPHA_MODE_PREMULTIPLIED ;
+	D2D1_BITMAP_PROPERTIES properties = D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, alphaMode)) ;
+
+	return pRenderTarget->CreateBitmap(
+		D2D1::SizeU(image.width, image.height),
+		&image.pixels[0],
+		image.pitch,
+		properties,
+		ppBitmap
+		) ;
+}
+
+void* D2DImageDevice::CreateBitmap(const DecodedImage& image)
+{
+	if (!m_pRenderTarget)
+	{
+		return NULL ;
+	}
+
+	ID2D1Bitmap* pBitmap = NULL ;
+	HRESULT hr = CreateD2DBitmap(m_pRenderTarget, image, &pBitmap) ;
+
+	return SUCCEEDED(hr) ? pBitmap : NULL ;
+}
+
+void D2DImageDevice::ReleaseBitmap(void* bitmap)
+{
+	static_cast<ID2D1Bitmap*>(bitmap)->Release() ;
+}
+
+D2DImageCache::D2DImageCache(void)
+	: m_Cache(&m_Loader, &m_Device)
+{
+	m_Loader.SetFallback(&m_Wic) ;
+}
+
+D2DImageCache::~D2DImageCache(void)
+{
+	m_Cache.Clear() ;
+}
+
+void D2DImageCache::SetAssets(AssetPack* pAssets)
+{
+	m_Loader.SetAssets(pAssets) ;
+	m_Wic.SetAssets(pAssets) ;
+}
+
+void D2DImageCache::SetRenderTarget(ID2D1RenderTarget* pRenderTarget)
+{
+	// Bitmaps can only be drawn on the target that created them
+	if (pRenderTarget != m_Device.RenderTarget())
+	{
+		if (m_Device.RenderTarget())
+		{
+			m_Cache.DeviceLost() ;
+		}
+		m_Device.SetRenderTarget(pRenderTarget) ;
+	}
+}
+
+void D2DImageCache::DeviceLost()
+{
+	if (m_Device.RenderTarget())
+	{
+		m_Cache.DeviceLost() ;
+	}
+	m_Device.SetRenderTarget(NULL) ;
+}
+
+ID2D1Bitmap* D2DImageCache::Get(const ImageKey& key)
+{
+	if (!m_Device.RenderTarget())
+	{
+		return NULL ;
+	}
+
+	return static_cast<ID2D1Bitmap*>(m_Cache.Get(key)) ;
+}
@@ -0,0 +1,98 @@
+#ifndef __D2D_IMAGE_CACHE_H__
+#define __D2D_IMAGE_CACHE_H__
+
+#include <d2d1.h>
+#include "ImageCache.h"
+#include "ImageLoader.h"
+
+struct IWICImagingFactory ;
+class AssetPack ;
+
+// Direct2D bitmap of decoded pixels, premultiplied or with the alpha ignored as the format says
+HRESULT CreateD2DBitmap(ID2D1RenderTarget* pRenderTarget, const DecodedImage& image, ID2D1Bitmap** ppBitmap) ;
+
+/*
+ImageDecoder on top of WIC. The file is loaded through an AssetPack, so it comes from the
+pack of the demo when it has one and from the loose file otherwise, then WIC decodes,
+scales and converts it in memory. D2DImageCache only uses it for the files ImageLoader
+cannot decode.
+*/
+class WicImageDecoder : public ImageDecoder
+{
+public:
+	WicImageDecoder(void);
+	virtual ~WicImageDecoder(void);
+
+	// Pack to load the files from, NULL loads loose files only. The pack must outlive the decoder.
+	void SetAssets(AssetPack* pAssets) { m_pAssets = pAssets ; }
+
+	virtual bool Decode(const ImageKey& key, DecodedImage& image) ;
+
+private:
+	IWICImagingFactory* m_pWICFactory ;
+	AssetPack* m_pAssets ;
+	bool m_bComInitialized ;
+
+	WicImageDecoder(const WicImageDecoder&) ;
+	WicImageDecoder& operator=(const WicImageDecoder&) ;
+};
+
+// ImageDevice that creates ID2D1Bitmaps on one render target
+class D2DImageDevice : public ImageDevice
+{
+public:
+	D2DImageDevice(void) : m_pRenderTarget(NULL) {}
+
+	void SetRenderTarget(ID2D1RenderTarget* pRenderTarget) { m_pRenderTarget = pRenderTarget ; }
+
+	ID2D1RenderTarget* RenderTarget() const { return m_pRenderTarget ; }
+
+	virtual void* CreateBitmap(const DecodedImage& image) ;
+	virtual void ReleaseBitmap(void* bitmap) ;
+
+private:
+	ID2D1RenderTarget* m_pRenderTarget ;
+};
+
+/*
+Image cache of a Direct2D demo: decodes with ImageLoader, or WIC for the formats it does
+not know, and uploads to the render target.
+
+Call SetRenderTarget whenever the render target is (re)created and DeviceLost before it
+is released, e.g. when EndDraw returns D2DERR_RECREATE_TARGET. The bitmaps returned by
+Get belong to the cache, they are valid until the next DeviceLost or SetRenderTarget
+with another target.
+*/
+class D2DImageCache
+{
+public:
+	D2DImageCache(void);
+	~D2DImageCache(void);
+
+	void SetAssets(AssetPack* pAssets) ;
+
+	void SetRenderTarget(ID2D1RenderTarget* pRenderTarget) ;
+
+	void DeviceLost() ;
+
+	// Bitmap of the image on the current render target, NULL if it cannot be loaded or there is no target
+	ID2D1Bitmap* Get(const ImageKey& key) ;
+
+	// Decoded pixels, for code that cuts an image into parts on the CPU
+	const DecodedImage* GetImage(const ImageKey& key) { return m_Cache.GetImage(key) ; }
+
+	void Clear() { m_Cache.Clear() ; }
+
+	const ImageCacheStats& Stats() const { return m_Cache.Stats() ; }
+
+private:
+	ImageLoader m_Loader ;
+	WicImageDecoder m_Wic ;
+	D2DImageDevice m_Device ;
+	ImageCache m_Cache ;	// declared last, it releases its bitmaps through m_Device
+
+	D2DImageCache(const D2DImageCache&) ;
+	D2DImageCache& operator=(const D2DImageCache&) ;
+};
+
+#endif // end __D2D_IMAGE_CACHE_H__
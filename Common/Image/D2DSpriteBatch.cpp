@@ -0,0 +1,25 @@
+#include "D2DSpriteBatch.h"
+
+void DrawSpriteBatch(
+	ID2D1RenderTarget* pRenderTarget,
+	ID2D1Bitmap* pAtlas,
+	const SpriteBatch& batch,
+	float opacity,
+	D2D1_BITMAP_INTERPOLATION_MODE interpolation
+	)
+{
+	const Sprite* sprites = batch.Sprites() ;
+	for (int i = 0; i < batch.Count(); ++i)
+	{
+		const Sprite& sprite = sprites[i] ;
+		D2D1_RECT_F source = D2D1::RectF(
+			(float)sprite.source.left,
+			(float)sprite.source.top,
+			(float)sprite.source.right,
+			(float)sprite.source.bottom
+			) ;
+		D2D1_RECT_F dest = D2D1::RectF(sprite.destLeft, sprite.destTop, sprite.destRight, sprite.destBottom) ;
+
+		pRenderTarget->DrawBitmap(pAtlas, &dest, opacity, interpolation, &source) ;
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef __D2D_SPRITE_BATCH_H__
+#define __D2D_SPRITE_BATCH_H__
+
+#include <d2d1.h>
+#include "SpriteBatch.h"
+
+/*
+Draw a SpriteBatch of one atlas bitmap on a Direct2D render target.
+
+Every sprite is a DrawBitmap of the same bitmap with a source rectangle. Direct2D queues
+the primitives of a BeginDraw/EndDraw pair and merges consecutive bitmap draws that
+share a bitmap and settings into one batch, so a frame of N pieces costs one texture
+and a few draw calls instead of N bitmaps and N texture switches.
+
+Source rectangles are in pixels, which matches the DIPs of bitmaps created at 96 DPI as
+CreateD2DBitmap does. Linear interpolation may blend in the outermost pixel of a
+neighbouring region when a sprite is scaled, atlases that need exact edges leave a gap
+between their regions.
+*/
+void DrawSpriteBatch(
+	ID2D1RenderTarget* pRenderTarget,
+	ID2D1Bitmap* pAtlas,
+	const SpriteBatch& batch,
+	float opacity = 1.0f,
+	D2D1_BITMAP_INTERPOLATION_MODE interpolation = D2D1_BITMAP_INTERPOLATION_MODE_LINEAR
+	) ;
+
+#endif // end __D2D_SPRITE_BATCH_H__
@@ -0,0 +1,360 @@
+#include "Deflate.h"
+
+// Matches are searched in the previous 32 KB
+#define WINDOW_SIZE 32768
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+
+static const int MIN_MATCH = 3 ;
+static const int MAX_MATCH = 258 ;
+static const int MAX_INSERT = 32 ;
+static const size_t MAX_STORED_BLOCK = 65535 ;
+
+static const unsigned short s_LengthBase[29] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+} ;
+
+static const unsigned char s_LengthExtra[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+} ;
+
+static const unsigned short s_DistanceBase[30] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+} ;
+
+static const unsigned char s_DistanceExtra[30] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+} ;
+
+// Longest hash chain followed per position, by compression level
+static const int s_MaxChain[10] = { 0, 4, 8, 16, 16, 32, 32, 64, 128, 256 } ;
+
+// Lookup tables built once when the program starts
+struct DeflateTables
+{
+	unsigned short literalCode[288] ;	// fixed Huffman codes, bit reversed for the LSB first bit writer
+	unsigned char literalBits[288] ;
+	unsigned char distanceCode[30] ;
+	unsigned char lengthSymbol[MAX_MATCH + 1] ;	// match length to index into s_LengthBase
+	unsigned char distanceSymbol[512] ;			// see DistanceSymbol
+	unsigned int crc[256] ;
+
+	DeflateTables()
+	{
+		for (int i = 0; i < 288; ++i)
+		{
+			int code, bits ;
+			if (i < 144)	  { code = 0x30 + i ;		  bits = 8 ; }
+			else if (i < 256) { code = 0x190 + i - 144 ; bits = 9 ; }
+			else if (i < 280) { code = i - 256 ;		  bits = 7 ; }
+			else			  { code = 0xC0 + i - 280 ;	  bits = 8 ; }
+
+			literalCode[i] = (unsigned short)Reverse(code, bits) ;
+			literalBits[i] = (unsigned char)bits ;
+		}
+
+		for (int i = 0; i < 30; ++i)
+		{
+			distanceCode[i] = (unsigned char)Reverse(i, 5) ;
+		}
+
+		for (int symbol = 0; symbol < 29; ++symbol)
+		{
+			int count = 1 << s_LengthExtra[symbol] ;
+			for (int i = 0; i < count && s_LengthBase[symbol] + i <= MAX_MATCH; ++i)
+			{
+				lengthSymbol[s_LengthBase[symbol] + i] = (unsigned char)symbol ;
+			}
+		}
+
+		for (int symbol = 0; symbol < 30; ++symbol)
+		{
+			int count = 1 << s_DistanceExtra[symbol] ;
+			for (int i = 0; i < count; ++i)
+			{
+				int d = s_DistanceBase[symbol] + i - 1 ;
+				if (d < 256)
+				{
+					distanceSymbol[d] = (unsigned char)symbol ;
+				}
+				else
+				{
+					distanceSymbol[256 + (d >> 7)] = (unsigned char)symbol ;
+				}
+			}
+		}
+
+		for (unsigned int n = 0; n < 256; ++n)
+		{
+			unsigned int c = n ;
+			for (int k = 0; k < 8; ++k)
+			{
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1 ;
+			}
+			crc[n] = c ;
+		}
+	}
+
+	static int Reverse(int code, int bits)
+	{
+		int result = 0 ;
+		for (int i = 0; i < bits; ++i)
+		{
+			result = (result << 1) | ((code >> i) & 1) ;
+		}
+		return result ;
+	}
+
+	int DistanceSymbol(int distance) const
+	{
+		int d = distance - 1 ;
+		return d < 256 ? distanceSymbol[d] : distanceSymbol[256 + (d >> 7)] ;
+	}
+};
+
+static const DeflateTables s_Tables ;
+
+// Writes bit fields least significant bit first, as deflate wants them
+class BitWriter
+{
+public:
+	explicit BitWriter(std::vector<unsigned char>& out)
+		: m_Out(out),
+		  m_Bits(0),
+		  m_Count(0)
+	{
+	}
+
+	void Put(unsigned int value, int bits)
+	{
+		m_Bits |= value << m_Count ;
+		m_Count += bits ;
+		while (m_Count >= 8)
+		{
+			m_Out.push_back((unsigned char)m_Bits) ;
+			m_Bits >>= 8 ;
+			m_Count -= 8 ;
+		}
+	}
+
+	void Flush()
+	{
+		if (m_Count > 0)
+		{
+			m_Out.push_back((unsigned char)m_Bits) ;
+		}
+		m_Bits = 0 ;
+		m_Count = 0 ;
+	}
+
+private:
+	std::vector<unsigned char>& m_Out ;
+	unsigned int m_Bits ;
+	int m_Count ;
+};
+
+static void PutLiteral(BitWriter& writer, int value)
+{
+	writer.Put(s_Tables.literalCode[value], s_Tables.literalBits[value]) ;
+}
+
+static void PutMatch(BitWriter& writer, int length, int distance)
+{
+	int symbol = s_Tables.lengthSymbol[length] ;
+	PutLiteral(writer, 257 + symbol) ;
+	writer.Put(length - s_LengthBase[symbol], s_LengthExtra[symbol]) ;
+
+	symbol = s_Tables.DistanceSymbol(distance) ;
+	writer.Put(s_Tables.distanceCode[symbol], 5) ;
+	writer.Put(distance - s_DistanceBase[symbol], s_DistanceExtra[symbol]) ;
+}
+
+static unsigned int Hash(const unsigned char* p)
+{
+	return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1) ;
+}
+
+// One final block coded with the fixed Huffman tables
+static void CompressFixed(const unsigned char* data, size_t size, std::vector<unsigned char>& out, int maxChain)
+{
+	std::vector<int> head(HASH_SIZE, -1) ;
+	std::vector<int> prev(WINDOW_SIZE, -1) ;
+
+	BitWriter writer(out) ;
+	writer.Put(1, 1) ;	// BFINAL
+	writer.Put(1, 2) ;	// BTYPE fixed Huffman
+
+	size_t pos = 0 ;
+	while (pos < size)
+	{
+		int bestLength = 0 ;
+		int bestDistance = 0 ;
+
+		if (pos + MIN_MATCH <= size)
+		{
+			int maxLength = size - pos < (size_t)MAX_MATCH ? (int)(size - pos) : MAX_MATCH ;
+			const unsigned char* current = data + pos ;
+			unsigned int hash = Hash(current) ;
+
+			int candidate = head[hash] ;
+			for (int chain = maxChain; candidate >= 0 && chain > 0; --chain)
+			{
+				int distance = (int)pos - candidate ;
+				if (distance > WINDOW_SIZE)
+				{
+					break ;
+				}
+
+				// Check the byte that would make the match longer first
+				const unsigned char* match = data + candidate ;
+				if (match[bestLength] == current[bestLength])
+				{
+					int length = 0 ;
+					while (length < maxLength && match[length] == current[length])
+					{
+						++length ;
+					}
+
+					if (length > bestLength)
+					{
+						bestLength = length ;
+						bestDistance = distance ;
+						if (length == maxLength)
+						{
+							break ;
+						}
+					}
+				}
+
+				// Slots are reused every 32 KB, a link to a newer position ends the chain
+				int next = prev[candidate & WINDOW_MASK] ;
+				if (next >= candidate)
+				{
+					break ;
+				}
+				candidate = next ;
+			}
+
+			prev[pos & WINDOW_MASK] = head[hash] ;
+			head[hash] = (int)pos ;
+		}
+
+		if (bestLength >= MIN_MATCH)
+		{
+			PutMatch(writer, bestLength, bestDistance) ;
+
+			// Keep the skipped positions of short matches in the chains. Long matches are
+			// runs in flat areas, their positions would only fill the chains with copies.
+			size_t end = pos + bestLength ;
+			if (bestLength <= MAX_INSERT)
+			{
+				for (++pos; pos < end && pos + MIN_MATCH <= size; ++pos)
+				{
+					unsigned int hash = Hash(data + pos) ;
+					prev[pos & WINDOW_MASK] = head[hash] ;
+					head[hash] = (int)pos ;
+				}
+			}
+			pos = end ;
+		}
+		else
+		{
+			PutLiteral(writer, data[pos]) ;
+			++pos ;
+		}
+	}
+
+	PutLiteral(writer, 256) ;	// end of block
+	writer.Flush() ;
+}
+
+static void CompressStored(const unsigned char* data, size_t size, std::vector<unsigned char>& out)
+{
+	size_t pos = 0 ;
+	do
+	{
+		size_t length = size - pos < MAX_STORED_BLOCK ? size - pos : MAX_STORED_BLOCK ;
+		bool final = pos + length == size ;
+
+		out.push_back(final ? 1 : 0) ;	// BFINAL, BTYPE stored, padded to the byte
+		out.push_back((unsigned char)length) ;
+		out.push_back((unsigned char)(length >> 8)) ;
+		out.push_back((unsigned char)~length) ;
+		out.push_back((unsigned char)(~length >> 8)) ;
+		out.insert(out.end(), data + pos, data + pos + length) ;
+
+		pos += length ;
+	} while (pos < size) ;
+}
+
+void ZlibCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& out, int level)
+{
+	if (level < 0) level = 0 ;
+	if (level > 9) level = 9 ;
+
+	// CMF: deflate with 32 KB window, FLG: level hint, FCHECK makes the pair a multiple of 31
+	static const unsigned char levelFlags[4] = { 0x01, 0x5E, 0x9C, 0xDA } ;
+	out.push_back(0x78) ;
+	out.push_back(levelFlags[level <= 1 ? 0 : (level <= 5 ? 1 : (level <= 7 ? 2 : 3))]) ;
+
+	size_t start = out.size() ;
+	if (level > 0)
+	{
+		CompressFixed(data, size, out, s_MaxChain[level]) ;
+	}
+
+	// Stored blocks cost 5 bytes per 64 KB, use them when the data did not compress
+	size_t storedSize = size + 5 * (size / MAX_STORED_BLOCK + 1) ;
+	if (level == 0 || out.size() - start > storedSize)
+	{
+		out.resize(start) ;
+		CompressStored(data, size, out) ;
+	}
+
+	unsigned int adler = Adler32(data, size) ;
+	out.push_back((unsigned char)(adler >> 24)) ;
+	out.push_back((unsigned char)(adler >> 16)) ;
+	out.push_back((unsigned char)(adler >> 8)) ;
+	out.push_back((unsigned char)adler) ;
+}
+
+unsigned int Crc32(const unsigned char* data, size_t size, unsigned int crc)
+{
+	crc = ~crc ;
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = s_Tables.crc[(crc ^ data[i]) & 0xFF] ^ (crc >> 8) ;
+	}
+	return ~crc ;
+}
+
+unsigned int Adler32(const unsigned char* data, size_t size, unsigned int adler)
+{
+	// 5552 bytes is the most that can be summed before the 32 bit sums may overflow
+	unsigned int a = adler & 0xFFFF ;
+	unsigned int b = adler >> 16 ;
+
+	while (size > 0)
+	{
+		size_t block = size < 5552 ? size : 5552 ;
+		size -= block ;
+		while (block--)
+		{
+			a += *data++ ;
+			b += a ;
+		}
+		a %= 65521 ;
+		b %= 65521 ;
+	}
+
+	return (b << 16) | a ;
+}
@@ -0,0 +1,23 @@
+#ifndef __DEFLATE_H__
+#define __DEFLATE_H__
+
+#include <stddef.h>
+#include <vector>
+
+/*
+zlib stream compression (RFC 1950/1951), enough for writing PNG files without a
+dependency on zlib itself.
+
+The compressor finds matches with hash chains over a 32 KB window and codes them with
+the fixed Huffman tables, data that does not compress is stored as is.
+*/
+
+// Compress data and append a complete zlib stream to out.
+// level 1 is fastest, 9 searches longest chains.
+void ZlibCompress(const unsigned char* data, size_t size, std::vector<unsigned char>& out, int level = 6) ;
+
+// Checksums used by zlib and PNG, pass the previous value to continue over several buffers
+unsigned int Crc32(const unsigned char* data, size_t size, unsigned int crc = 0) ;
+unsigned int Adler32(const unsigned char* data, size_t size, unsigned int adler = 1) ;
+
+#endif // end __DEFLATE_H__
@@ -0,0 +1,157 @@
+#include "ImageCache.h"
+#include "../Utility/Timer.h"
+
+#include <string.h>
+
+void ScaledSize(unsigned int width, unsigned int height, unsigned int keyWidth, unsigned int keyHeight,
+				unsigned int& destWidth, unsigned int& destHeight)
+{
+	destWidth = keyWidth ;
+	destHeight = keyHeight ;
+
+	// A size of 0 follows the other side, so the aspect ratio stays
+	if (keyWidth == 0 && keyHeight == 0)
+	{
+		destWidth = width ;
+		destHeight = height ;
+	}
+	else if (keyWidth == 0)
+	{
+		destWidth = (unsigned int)((double)keyHeight * width / height + 0.5) ;
+	}
+	else if (keyHeight == 0)
+	{
+		destHeight = (unsigned int)((double)keyWidth * height / width + 0.5) ;
+	}
+
+	destWidth = destWidth ? destWidth : 1 ;
+	destHeight = destHeight ? destHeight : 1 ;
+}
+
+ImageCache::ImageCache(ImageDecoder* pDecoder, ImageDevice* pDevice)
+	: m_pDecoder(pDecoder),
+	  m_pDevice(pDevice)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+ImageCache::~ImageCache(void)
+{
+	Clear() ;
+}
+
+ImageCache::Entry* ImageCache::Find(const ImageKey& key)
+{
+	EntryMap::iterator it = m_Entries.find(key) ;
+	if (it != m_Entries.end())
+	{
+		++m_Stats.hits ;
+		return it->second ;
+	}
+
+	++m_Stats.misses ;
+
+	Entry* pEntry = new Entry ;
+	pEntry->bitmap = NULL ;
+
+	Timer timer ;
+	pEntry->decoded = m_pDecoder->Decode(key, pEntry->image) ;
+	m_Stats.decodeMs += timer.ElapsedMs() ;
+
+	if (pEntry->decoded)
+	{
+		m_Stats.decodedBytes += pEntry->image.pixels.size() ;
+	}
+	else
+	{
+		// Keep the failure, so the file is not read again on every call
+		pEntry->image = DecodedImage() ;
+		++m_Stats.failed ;
+	}
+
+	m_Entries[key] = pEntry ;
+	return pEntry ;
+}
+
+void* ImageCache::Get(const ImageKey& key)
+{
+	Entry* pEntry = Find(key) ;
+	if (!pEntry->decoded)
+	{
+		return NULL ;
+	}
+
+	if (!pEntry->bitmap)
+	{
+		Timer timer ;
+		pEntry->bitmap = m_pDevice->CreateBitmap(pEntry->image) ;
+		m_Stats.uploadMs += timer.ElapsedMs() ;
+		if (pEntry->bitmap)
+		{
+			++m_Stats.uploads ;
+		}
+	}
+
+	return pEntry->bitmap ;
+}
+
+const DecodedImage* ImageCache::GetImage(const ImageKey& key)
+{
+	Entry* pEntry = Find(key) ;
+	return pEntry->decoded ? &pEntry->image : NULL ;
+}
+
+void ImageCache::DeviceLost()
+{
+	for (EntryMap::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+	{
+		if (it->second->bitmap)
+		{
+			m_pDevice->ReleaseBitmap(it->second->bitmap) ;
+			it->second->bitmap = NULL ;
+		}
+	}
+
+	++m_Stats.deviceLosses ;
+}
+
+void ImageCache::Remove(const ImageKey& key)
+{
+	EntryMap::iterator it = m_Entries.find(key) ;
+	if (it == m_Entries.end())
+	{
+		return ;
+	}
+
+	Entry* pEntry = it->second ;
+	if (pEntry->bitmap)
+	{
+		m_pDevice->ReleaseBitmap(pEntry->bitmap) ;
+	}
+	m_Stats.decodedBytes -= pEntry->image.pixels.size() ;
+	delete pEntry ;
+	m_Entries.erase(it) ;
+}
+
+void ImageCache::Clear()
+{
+	for (EntryMap::iterator it = m_Entries.begin(); it != m_Entries.end(); ++it)
+	{
+		if (it->second->bitmap)
+		{
+			m_pDevice->ReleaseBitmap(it->second->bitmap) ;
+		}
+		delete it->second ;
+	}
+
+	m_Entries.clear() ;
+	m_Stats.decodedBytes = 0 ;
+}
+
+void ImageCache::ResetStats()
+{
+	// The pixel memory is a state of the cache, not a counter
+	size_t decodedBytes = m_Stats.decodedBytes ;
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+	m_Stats.decodedBytes = decodedBytes ;
+}
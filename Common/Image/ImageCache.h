@@ -0,0 +1,138 @@
+#ifndef __IMAGE_CACHE_H__
+#define __IMAGE_CACHE_H__
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "ImageReader.h"
+
+/*
+Cache of decoded images and the device bitmaps made from them.
+
+An image is decoded once per key and its pixels are kept, the device bitmap is created
+from those pixels the first time it is asked for. When the device is lost only the
+bitmaps are released, the next Get uploads the kept pixels again without touching the
+file. Images that fail to decode are remembered as well, so a missing file costs one
+attempt and not one per frame.
+
+ImageDecoder reads and decodes the files, ImageDevice turns pixels into bitmaps of the
+graphics API. Both are interfaces, so the cache runs headless with a generated decoder
+and a device that only counts.
+*/
+
+// What to load. width and height 0 keep the size of the file, one of them 0 keeps the aspect ratio.
+struct ImageKey
+{
+	std::string path ;
+	unsigned int width ;
+	unsigned int height ;
+	PIXEL_FORMAT format ;
+
+	ImageKey() : width(0), height(0), format(PIXEL_PBGRA) {}
+	ImageKey(const char* p, unsigned int w, unsigned int h, PIXEL_FORMAT f) : path(p), width(w), height(h), format(f) {}
+
+	bool operator<(const ImageKey& other) const
+	{
+		if (width != other.width)
+		{
+			return width < other.width ;
+		}
+		if (height != other.height)
+		{
+			return height < other.height ;
+		}
+		if (format != other.format)
+		{
+			return format < other.format ;
+		}
+		return path < other.path ;
+	}
+};
+
+// Size to load an image of width x height at for a key, the size of the image if both key sizes are 0
+void ScaledSize(unsigned int width, unsigned int height, unsigned int keyWidth, unsigned int keyHeight,
+				unsigned int& destWidth, unsigned int& destHeight) ;
+
+class ImageDecoder
+{
+public:
+	virtual ~ImageDecoder() {}
+
+	// Read key.path and decode it to the size and format of the key, false if the file is missing or broken
+	virtual bool Decode(const ImageKey& key, DecodedImage& image) = 0 ;
+};
+
+class ImageDevice
+{
+public:
+	virtual ~ImageDevice() {}
+
+	// Create a bitmap of the device from the pixels, NULL on failure
+	virtual void* CreateBitmap(const DecodedImage& image) = 0 ;
+
+	virtual void ReleaseBitmap(void* bitmap) = 0 ;
+};
+
+struct ImageCacheStats
+{
+	int hits ;				// Get calls answered from the cache
+	int misses ;			// Get calls that had to decode
+	int failed ;			// decodes that failed
+	int uploads ;			// device bitmaps created, after a device loss without decoding again
+	int deviceLosses ;
+	double decodeMs ;		// time spent in the decoder
+	double uploadMs ;		// time spent creating device bitmaps
+	size_t decodedBytes ;	// pixel memory held by the cache
+};
+
+class ImageCache
+{
+public:
+	// The decoder and the device must outlive the cache
+	ImageCache(ImageDecoder* pDecoder, ImageDevice* pDevice);
+	~ImageCache(void);
+
+	// Device bitmap of the image, NULL if it cannot be decoded or uploaded
+	void* Get(const ImageKey& key) ;
+
+	// Decoded pixels of the image without a device bitmap, NULL if it cannot be decoded
+	const DecodedImage* GetImage(const ImageKey& key) ;
+
+	// Release the bitmaps of a lost device and keep the pixels, call before the device is released
+	void DeviceLost() ;
+
+	// Forget one image, e.g. when its file changed
+	void Remove(const ImageKey& key) ;
+
+	// Release every bitmap and image
+	void Clear() ;
+
+	int Count() const { return (int)m_Entries.size() ; }
+
+	const ImageCacheStats& Stats() const { return m_Stats ; }
+
+	void ResetStats() ;
+
+private:
+	struct Entry
+	{
+		DecodedImage image ;
+		void* bitmap ;
+		bool decoded ;		// false if the decode failed
+	};
+
+	typedef std::map<ImageKey, Entry*> EntryMap ;
+
+	Entry* Find(const ImageKey& key) ;
+
+	ImageDecoder* m_pDecoder ;
+	ImageDevice* m_pDevice ;
+	EntryMap m_Entries ;
+	ImageCacheStats m_Stats ;
+
+	ImageCache(const ImageCache&) ;
+	ImageCache& operator=(const ImageCache&) ;
+};
+
+#endif // end __IMAGE_CACHE_H__
@@ -0,0 +1,61 @@
+#include "ImageLoader.h"
+#include "../Asset/AssetPack.h"
+#include "../Utility/ThreadPool.h"
+
+ImageLoader::ImageLoader(void)
+	: m_pAssets(NULL),
+	  m_pFallback(NULL),
+	  m_pPool(NULL),
+	  m_Filter(RESAMPLE_CUBIC)
+{
+}
+
+ImageLoader::~ImageLoader(void)
+{
+	delete m_pPool ;
+}
+
+bool ImageLoader::Decode(const ImageKey& key, DecodedImage& image)
+{
+	AssetPack noPack ;
+	AssetPack* pAssets = m_pAssets ? m_pAssets : &noPack ;
+	Asset asset ;
+	if (!pAssets->Load(key.path.c_str(), asset))
+	{
+		return false ;
+	}
+
+	if (DecodeData(asset.Data(), asset.Size(), key.width, key.height, key.format, image))
+	{
+		return true ;
+	}
+
+	// The fallback reads the file again, that only happens for formats that are rare in the demos
+	asset.Release() ;
+	return m_pFallback && m_pFallback->Decode(key, image) ;
+}
+
+bool ImageLoader::DecodeData(const unsigned char* data, size_t size, unsigned int width, unsigned int height,
+							 PIXEL_FORMAT format, DecodedImage& image)
+{
+	DecodedImage decoded ;
+	if (!DecodeImage(data, size, format, decoded))
+	{
+		return false ;
+	}
+
+	unsigned int destWidth ;
+	unsigned int destHeight ;
+	ScaledSize(decoded.width, decoded.height, width, height, destWidth, destHeight) ;
+	if (destWidth == decoded.width && destHeight == decoded.height)
+	{
+		image.Swap(decoded) ;
+		return true ;
+	}
+
+	if (!m_pPool)
+	{
+		m_pPool = new ThreadPool() ;
+	}
+	return ResizeImage(decoded, destWidth, destHeight, image, m_Filter, m_pPool) ;
+}
@@ -0,0 +1,48 @@
+#ifndef __IMAGE_LOADER_H__
+#define __IMAGE_LOADER_H__
+
+#include "ImageCache.h"
+#include "Resample.h"
+
+class AssetPack ;
+class ThreadPool ;
+
+/*
+Portable ImageDecoder: loads the file through an AssetPack, decodes it with the decoders
+of ImageReader and scales it with ResizeImage, which runs on a thread pool created the
+first time an image is scaled.
+
+Files the portable decoders do not handle, such as progressive JPEGs, go to the fallback
+decoder if one is set, WIC in the Direct2D demos.
+*/
+class ImageLoader : public ImageDecoder
+{
+public:
+	ImageLoader(void);
+	virtual ~ImageLoader(void);
+
+	// Pack to load the files from, NULL loads loose files only. The pack must outlive the loader.
+	void SetAssets(AssetPack* pAssets) { m_pAssets = pAssets ; }
+
+	// Decoder for the files DecodeImage rejects, NULL for none. It must outlive the loader.
+	void SetFallback(ImageDecoder* pFallback) { m_pFallback = pFallback ; }
+
+	void SetFilter(RESAMPLE_FILTER filter) { m_Filter = filter ; }
+
+	virtual bool Decode(const ImageKey& key, DecodedImage& image) ;
+
+	// Decode a file already in memory, e.g. a resource, and scale it like Decode does for a key
+	bool DecodeData(const unsigned char* data, size_t size, unsigned int width, unsigned int height,
+					PIXEL_FORMAT format, DecodedImage& image) ;
+
+private:
+	AssetPack* m_pAssets ;
+	ImageDecoder* m_pFallback ;
+	ThreadPool* m_pPool ;
+	RESAMPLE_FILTER m_Filter ;
+
+	ImageLoader(const ImageLoader&) ;
+	ImageLoader& operator=(const ImageLoader&) ;
+};
+
+#endif // end __IMAGE_LOADER_H__
@@ -0,0 +1,795 @@
+#include "ImageReader.h"
+#include "Inflate.h"
+#include "PixelConvert.h"
+
+#include <string.h>
+#include <algorithm>
+
+static unsigned int GetLE16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) ;
+}
+
+static unsigned int GetLE32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24) ;
+}
+
+static unsigned int GetBE32(const unsigned char* p)
+{
+	return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3] ;
+}
+
+bool DecodedImage::Allocate(unsigned int w, unsigned int h, PIXEL_FORMAT f)
+{
+	if (w == 0 || h == 0 || (size_t)w * 4 > MAX_IMAGE_BYTES / h)
+	{
+		return false ;
+	}
+
+	width = w ;
+	height = h ;
+	pitch = w * 4 ;
+	format = f ;
+	pixels.resize((size_t)pitch * h) ;
+	return true ;
+}
+
+void DecodedImage::Swap(DecodedImage& other)
+{
+	std::swap(width, other.width) ;
+	std::swap(height, other.height) ;
+	std::swap(pitch, other.pitch) ;
+	std::swap(format, other.format) ;
+	pixels.swap(other.pixels) ;
+}
+
+// Straight alpha B, G, R, A to the requested format
+static void FinishAlpha(DecodedImage& image, bool hasAlpha)
+{
+	if (!hasAlpha)
+	{
+		return ;
+	}
+
+	size_t count = (size_t)image.width * image.height ;
+	if (image.format == PIXEL_BGRX)
+	{
+		SetOpaque(&image.pixels[0], count) ;
+	}
+	else
+	{
+		PremultiplyAlpha(&image.pixels[0], count) ;
+	}
+}
+
+bool DecodeImage(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image)
+{
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+	{
+		return DecodeBMP(data, size, format, image) ;
+	}
+	if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0)
+	{
+		return DecodePNG(data, size, format, image) ;
+	}
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+	{
+		return DecodeJPEG(data, size, format, image) ;
+	}
+	if (size >= 4 && memcmp(data, "qoif", 4) == 0)
+	{
+		return DecodeQOI(data, size, format, image) ;
+	}
+	return false ;
+}
+
+//
+// BMP
+//
+
+// Shift and width of one channel of a bit field mask, to scale the channel to 8 bits
+struct BitField
+{
+	unsigned int mask ;
+	int shift ;
+	int bits ;
+
+	void Set(unsigned int m)
+	{
+		mask = m ;
+		shift = 0 ;
+		bits = 0 ;
+		if (m)
+		{
+			while (!(m & 1))
+			{
+				m >>= 1 ;
+				++shift ;
+			}
+			while (m & 1)
+			{
+				m >>= 1 ;
+				++bits ;
+			}
+		}
+	}
+
+	unsigned char Extract(unsigned int value) const
+	{
+		if (bits == 0)
+		{
+			return 255 ;
+		}
+
+		// Scale to 8 bits, short fields repeat their bits so 5 bit 31 becomes 255
+		unsigned int v = (value & mask) >> shift ;
+		if (bits >= 8)
+		{
+			return (unsigned char)(v >> (bits - 8)) ;
+		}
+		unsigned int result = v << (8 - bits) ;
+		for (int filled = bits; filled < 8; filled *= 2)
+		{
+			result |= result >> filled ;
+		}
+		return (unsigned char)result ;
+	}
+};
+
+bool DecodeBMP(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image)
+{
+	if (size < 26 || data[0] != 'B' || data[1] != 'M')
+	{
+		return false ;
+	}
+
+	unsigned int offset = GetLE32(data + 10) ;
+	unsigned int headerSize = GetLE32(data + 14) ;
+	const unsigned char* header = data + 14 ;
+	if (headerSize > size - 14 || (headerSize != 12 && headerSize < 40))
+	{
+		return false ;
+	}
+
+	int width ;
+	int height ;
+	unsigned int bitCount ;
+	unsigned int compression = 0 ;
+	unsigned int colorsUsed = 0 ;
+	int paletteEntrySize = 4 ;
+	if (headerSize == 12)
+	{
+		// OS/2 BITMAPCOREHEADER
+		width = (int)GetLE16(header + 4) ;
+		height = (int)(short)GetLE16(header + 6) ;
+		bitCount = GetLE16(header + 10) ;
+		paletteEntrySize = 3 ;
+	}
+	else
+	{
+		width = (int)GetLE32(header + 4) ;
+		height = (int)GetLE32(header + 8) ;
+		bitCount = GetLE16(header + 14) ;
+		compression = GetLE32(header + 16) ;
+		colorsUsed = GetLE32(header + 32) ;
+	}
+
+	// Positive height means the rows are stored bottom-up
+	bool bottomUp = height > 0 ;
+	if (height < 0)
+	{
+		height = -height ;
+	}
+	if (width <= 0 || height <= 0 || !image.Allocate(width, height, format))
+	{
+		return false ;
+	}
+
+	// BI_RGB and BI_BITFIELDS (3) or BI_ALPHABITFIELDS (6), RLE compression is left to WIC
+	BitField fields[4] ;
+	bool hasAlpha = false ;
+	bool useFields = false ;
+	if (compression == 3 || compression == 6)
+	{
+		if (bitCount != 16 && bitCount != 32)
+		{
+			return false ;
+		}
+
+		// The masks are part of the V4 and V5 headers, after the info header otherwise
+		int maskCount = compression == 6 || headerSize >= 56 ? 4 : 3 ;
+		if (headerSize + 14 + maskCount * 4 > size)
+		{
+			return false ;
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			fields[i].Set(i < maskCount ? GetLE32(header + 40 + i * 4) : 0) ;
+		}
+		hasAlpha = fields[3].mask != 0 ;
+		useFields = true ;
+	}
+	else if (compression != 0)
+	{
+		return false ;
+	}
+	else if (bitCount == 16)
+	{
+		// 5 bits per channel
+		fields[0].Set(0x7C00) ;
+		fields[1].Set(0x03E0) ;
+		fields[2].Set(0x001F) ;
+		fields[3].Set(0) ;
+		useFields = true ;
+	}
+
+	// Palette of up to 256 B, G, R entries
+	unsigned char palette[256][4] ;
+	memset(palette, 0, sizeof(palette)) ;
+	if (bitCount <= 8)
+	{
+		if (bitCount != 1 && bitCount != 4 && bitCount != 8)
+		{
+			return false ;
+		}
+
+		unsigned int entries = colorsUsed ? colorsUsed : 1u << bitCount ;
+		if (entries > 256)
+		{
+			entries = 256 ;
+		}
+		const unsigned char* entry = header + headerSize ;
+		if ((size_t)(entry - data) + entries * paletteEntrySize > size)
+		{
+			return false ;
+		}
+		for (unsigned int i = 0; i < entries; ++i)
+		{
+			palette[i][0] = entry[0] ;
+			palette[i][1] = entry[1] ;
+			palette[i][2] = entry[2] ;
+			palette[i][3] = 255 ;
+			entry += paletteEntrySize ;
+		}
+	}
+	else if (bitCount != 16 && bitCount != 24 && bitCount != 32)
+	{
+		return false ;
+	}
+
+	size_t rowSize = (((size_t)width * bitCount + 31) / 32) * 4 ;
+	if (offset > size || (size - offset) / rowSize < (size_t)height)
+	{
+		return false ;
+	}
+
+	// 32 bit BI_RGB files may have alpha, if every alpha byte is 0 it is unused
+	bool plain32 = bitCount == 32 && (!useFields ||
+		(fields[0].mask == 0xFF0000 && fields[1].mask == 0xFF00 && fields[2].mask == 0xFF && (fields[3].mask == 0xFF000000 || fields[3].mask == 0))) ;
+	bool anyAlpha = false ;
+
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char* src = data + offset + rowSize * (bottomUp ? height - 1 - y : y) ;
+		unsigned char* dest = image.Row(y) ;
+
+		if (plain32)
+		{
+			memcpy(dest, src, (size_t)width * 4) ;
+			if (!useFields && !anyAlpha)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					anyAlpha = anyAlpha || src[x * 4 + 3] != 0 ;
+				}
+			}
+		}
+		else if (bitCount == 24)
+		{
+			ExpandRGB(src, dest, width, false) ;
+		}
+		else if (useFields)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				unsigned int value = bitCount == 16 ? GetLE16(src + x * 2) : GetLE32(src + x * 4) ;
+				dest[x * 4 + 0] = fields[2].Extract(value) ;
+				dest[x * 4 + 1] = fields[1].Extract(value) ;
+				dest[x * 4 + 2] = fields[0].Extract(value) ;
+				dest[x * 4 + 3] = fields[3].Extract(value) ;
+			}
+		}
+		else
+		{
+			// 1, 4 or 8 bit palette indices, the first pixel in the high bits
+			int perByte = 8 / bitCount ;
+			unsigned int mask = (1u << bitCount) - 1 ;
+			for (int x = 0; x < width; ++x)
+			{
+				int shift = (perByte - 1 - x % perByte) * bitCount ;
+				unsigned int index = (src[x / perByte] >> shift) & mask ;
+				memcpy(dest + x * 4, palette[index], 4) ;
+			}
+		}
+	}
+
+	if (plain32)
+	{
+		hasAlpha = useFields ? fields[3].mask != 0 : anyAlpha ;
+		if (!hasAlpha)
+		{
+			SetOpaque(&image.pixels[0], (size_t)width * height) ;
+		}
+	}
+
+	FinishAlpha(image, hasAlpha) ;
+	return true ;
+}
+
+//
+// PNG
+//
+
+enum PNG_COLOR
+{
+	PNG_GRAY = 0,
+	PNG_RGB = 2,
+	PNG_PALETTE = 3,
+	PNG_GRAY_ALPHA = 4,
+	PNG_RGBA = 6,
+};
+
+struct PngInfo
+{
+	unsigned int width ;
+	unsigned int height ;
+	int depth ;
+	int color ;
+	int channels ;
+	bool interlaced ;
+
+	unsigned char palette[256][4] ;		// B, G, R, A
+	bool hasKey ;						// tRNS colour key for grey and RGB
+	unsigned int key[3] ;
+
+	size_t RowBytes(unsigned int w) const { return ((size_t)w * channels * depth + 7) / 8 ; }
+
+	int FilterStride() const { int bytes = channels * depth / 8 ; return bytes ? bytes : 1 ; }
+};
+
+static unsigned char Paeth(int a, int b, int c)
+{
+	int p = a + b - c ;
+	int pa = p > a ? p - a : a - p ;
+	int pb = p > b ? p - b : b - p ;
+	int pc = p > c ? p - c : c - p ;
+	if (pa <= pb && pa <= pc)
+	{
+		return (unsigned char)a ;
+	}
+	return (unsigned char)(pb <= pc ? b : c) ;
+}
+
+// Undo the filter of one row in place, previous is NULL for the first row of a pass
+static bool Unfilter(unsigned char* row, const unsigned char* previous, size_t length, int stride, int filter)
+{
+	switch (filter)
+	{
+	case 0:
+		break ;
+
+	case 1:	// Sub
+		for (size_t i = stride; i < length; ++i)
+		{
+			row[i] = (unsigned char)(row[i] + row[i - stride]) ;
+		}
+		break ;
+
+	case 2:	// Up
+		if (previous)
+		{
+			for (size_t i = 0; i < length; ++i)
+			{
+				row[i] = (unsigned char)(row[i] + previous[i]) ;
+			}
+		}
+		break ;
+
+	case 3:	// Average
+		for (size_t i = 0; i < length; ++i)
+		{
+			int left = i >= (size_t)stride ? row[i - stride] : 0 ;
+			int up = previous ? previous[i] : 0 ;
+			row[i] = (unsigned char)(row[i] + ((left + up) >> 1)) ;
+		}
+		break ;
+
+	case 4:	// Paeth
+		for (size_t i = 0; i < length; ++i)
+		{
+			int left = i >= (size_t)stride ? row[i - stride] : 0 ;
+			int up = previous ? previous[i] : 0 ;
+			int upLeft = previous && i >= (size_t)stride ? previous[i - stride] : 0 ;
+			row[i] = (unsigned char)(row[i] + Paeth(left, up, upLeft)) ;
+		}
+		break ;
+
+	default:
+		return false ;
+	}
+	return true ;
+}
+
+// Sample x of a row with any bit depth, 16 bit samples are big endian
+static unsigned int GetSample(const unsigned char* row, size_t index, int depth)
+{
+	switch (depth)
+	{
+	case 16: return (row[index * 2] << 8) | row[index * 2 + 1] ;
+	case 8:	 return row[index] ;
+	default:
+		{
+			int perByte = 8 / depth ;
+			int shift = (perByte - 1 - (int)(index % perByte)) * depth ;
+			return (row[index / perByte] >> shift) & ((1 << depth) - 1) ;
+		}
+	}
+}
+
+// Convert one unfiltered row of width pixels to straight alpha B, G, R, A
+static void ConvertPngRow(const PngInfo& info, const unsigned char* src, unsigned char* dest, unsigned int width)
+{
+	if (info.depth == 8 && !info.hasKey)
+	{
+		switch (info.color)
+		{
+		case PNG_RGBA:		 SwapRedBlue(src, dest, width) ;	  return ;
+		case PNG_RGB:		 ExpandRGB(src, dest, width, true) ; return ;
+		case PNG_GRAY:		 ExpandGray(src, dest, width) ;	  return ;
+		case PNG_GRAY_ALPHA: ExpandGrayAlpha(src, dest, width) ; return ;
+		case PNG_PALETTE:
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				memcpy(dest + x * 4, info.palette[src[x]], 4) ;
+			}
+			return ;
+		}
+	}
+
+	// Other depths and colour keys, one sample at a time
+	int maxValue = (1 << info.depth) - 1 ;
+	for (unsigned int x = 0; x < width; ++x)
+	{
+		unsigned char* pixel = dest + x * 4 ;
+		size_t first = (size_t)x * info.channels ;
+
+		if (info.color == PNG_PALETTE)
+		{
+			memcpy(pixel, info.palette[GetSample(src, x, info.depth)], 4) ;
+			continue ;
+		}
+
+		unsigned int samples[4] = { 0, 0, 0, 0 } ;
+		for (int c = 0; c < info.channels; ++c)
+		{
+			samples[c] = GetSample(src, first + c, info.depth) ;
+		}
+
+		bool keyed = info.hasKey ;
+		int colorChannels = info.color == PNG_RGB || info.color == PNG_RGBA ? 3 : 1 ;
+		for (int c = 0; c < colorChannels && keyed; ++c)
+		{
+			keyed = samples[c] == info.key[c] ;
+		}
+
+		unsigned char value[4] ;
+		for (int c = 0; c < info.channels; ++c)
+		{
+			value[c] = (unsigned char)((samples[c] * 255 + maxValue / 2) / maxValue) ;
+		}
+
+		if (colorChannels == 3)
+		{
+			pixel[0] = value[2] ;
+			pixel[1] = value[1] ;
+			pixel[2] = value[0] ;
+		}
+		else
+		{
+			pixel[0] = pixel[1] = pixel[2] = value[0] ;
+		}
+		pixel[3] = info.channels == 2 || info.channels == 4 ? value[info.channels - 1] : 255 ;
+		if (keyed)
+		{
+			pixel[3] = 0 ;
+		}
+	}
+}
+
+bool DecodePNG(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image)
+{
+	if (size < 8 || memcmp(data, "\x89PNG\r\n\x1A\n", 8) != 0)
+	{
+		return false ;
+	}
+
+	PngInfo info ;
+	memset(&info, 0, sizeof(info)) ;
+	for (int i = 0; i < 256; ++i)
+	{
+		info.palette[i][3] = 255 ;
+	}
+
+	// The image data may be split over several IDAT chunks, collect them. The zlib
+	// checksum covers the image data, the chunk CRCs are not checked.
+	std::vector<unsigned char> compressed ;
+	bool hasHeader = false ;
+	bool hasTransparency = false ;
+	size_t position = 8 ;
+	for (;;)
+	{
+		if (size - position < 12)
+		{
+			return false ;
+		}
+
+		unsigned int length = GetBE32(data + position) ;
+		const unsigned char* type = data + position + 4 ;
+		const unsigned char* chunk = data + position + 8 ;
+		if (length > size - position - 12)
+		{
+			return false ;
+		}
+		position += 12 + length ;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+			{
+				return false ;
+			}
+			info.width = GetBE32(chunk) ;
+			info.height = GetBE32(chunk + 4) ;
+			info.depth = chunk[8] ;
+			info.color = chunk[9] ;
+			info.interlaced = chunk[12] == 1 ;
+
+			static const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 } ;
+			info.channels = info.color <= 6 ? channels[info.color] : 0 ;
+			bool validDepth = info.depth == 8 || (info.depth == 16 && info.color != PNG_PALETTE) ||
+				((info.depth == 1 || info.depth == 2 || info.depth == 4) && (info.color == PNG_GRAY || info.color == PNG_PALETTE)) ;
+			if (info.channels == 0 || !validDepth || chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1 ||
+				info.width > 0x7FFFFFFF || info.height > 0x7FFFFFFF || !image.Allocate(info.width, info.height, format))
+			{
+				return false ;
+			}
+			hasHeader = true ;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			for (unsigned int i = 0; i < length / 3 && i < 256; ++i)
+			{
+				info.palette[i][0] = chunk[i * 3 + 2] ;
+				info.palette[i][1] = chunk[i * 3 + 1] ;
+				info.palette[i][2] = chunk[i * 3 + 0] ;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			// Alpha of the palette entries, or the one colour that is transparent
+			if (info.color == PNG_PALETTE)
+			{
+				for (unsigned int i = 0; i < length && i < 256; ++i)
+				{
+					info.palette[i][3] = chunk[i] ;
+				}
+				hasTransparency = true ;
+			}
+			else if ((info.color == PNG_GRAY && length >= 2) || (info.color == PNG_RGB && length >= 6))
+			{
+				for (int c = 0; c < (info.color == PNG_RGB ? 3 : 1); ++c)
+				{
+					info.key[c] = (chunk[c * 2] << 8) | chunk[c * 2 + 1] ;
+				}
+				info.hasKey = true ;
+				hasTransparency = true ;
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length) ;
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break ;
+		}
+		else if (!(type[0] & 0x20))
+		{
+			return false ;	// unknown critical chunk
+		}
+	}
+
+	if (!hasHeader || compressed.empty())
+	{
+		return false ;
+	}
+
+	// Interlaced images are 7 passes over every 8x8 block, each stored like a small image
+	static const int passX[7] = { 0, 4, 0, 2, 0, 1, 0 } ;
+	static const int passY[7] = { 0, 0, 4, 0, 2, 0, 1 } ;
+	static const int stepX[7] = { 8, 8, 4, 4, 2, 2, 1 } ;
+	static const int stepY[7] = { 8, 8, 8, 4, 4, 2, 2 } ;
+	int passes = info.interlaced ? 7 : 1 ;
+
+	unsigned int passWidth[7] ;
+	unsigned int passHeight[7] ;
+	size_t rawSize = 0 ;
+	for (int p = 0; p < passes; ++p)
+	{
+		if (info.interlaced)
+		{
+			passWidth[p] = info.width > (unsigned int)passX[p] ? (info.width - passX[p] + stepX[p] - 1) / stepX[p] : 0 ;
+			passHeight[p] = info.height > (unsigned int)passY[p] ? (info.height - passY[p] + stepY[p] - 1) / stepY[p] : 0 ;
+		}
+		else
+		{
+			passWidth[p] = info.width ;
+			passHeight[p] = info.height ;
+		}
+		if (passWidth[p] && passHeight[p])
+		{
+			rawSize += (info.RowBytes(passWidth[p]) + 1) * passHeight[p] ;
+		}
+	}
+
+	std::vector<unsigned char> raw(rawSize) ;
+	if (!ZlibDecompress(&compressed[0], compressed.size(), &raw[0], rawSize))
+	{
+		return false ;
+	}
+
+	std::vector<unsigned char> passRow(info.interlaced ? (size_t)info.width * 4 : 0) ;
+	unsigned char* rows = &raw[0] ;
+	for (int p = 0; p < passes; ++p)
+	{
+		if (!passWidth[p] || !passHeight[p])
+		{
+			continue ;
+		}
+
+		size_t rowBytes = info.RowBytes(passWidth[p]) ;
+		const unsigned char* previous = NULL ;
+		for (unsigned int y = 0; y < passHeight[p]; ++y)
+		{
+			unsigned char* row = rows + 1 ;
+			if (!Unfilter(row, previous, rowBytes, info.FilterStride(), rows[0]))
+			{
+				return false ;
+			}
+
+			if (info.interlaced)
+			{
+				ConvertPngRow(info, row, &passRow[0], passWidth[p]) ;
+				unsigned char* dest = image.Row(passY[p] + y * stepY[p]) ;
+				for (unsigned int x = 0; x < passWidth[p]; ++x)
+				{
+					memcpy(dest + (passX[p] + x * stepX[p]) * 4, &passRow[x * 4], 4) ;
+				}
+			}
+			else
+			{
+				ConvertPngRow(info, row, image.Row(y), info.width) ;
+			}
+
+			previous = row ;
+			rows += rowBytes + 1 ;
+		}
+	}
+
+	FinishAlpha(image, hasTransparency || info.color == PNG_GRAY_ALPHA || info.color == PNG_RGBA) ;
+	return true ;
+}
+
+//
+// QOI
+//
+
+bool DecodeQOI(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image)
+{
+	if (size < 14 + 8 || memcmp(data, "qoif", 4) != 0)
+	{
+		return false ;
+	}
+
+	unsigned int width = GetBE32(data + 4) ;
+	unsigned int height = GetBE32(data + 8) ;
+	int channels = data[12] ;
+	if ((channels != 3 && channels != 4) || !image.Allocate(width, height, format))
+	{
+		return false ;
+	}
+
+	// Pixels are R, G, B, A as in the file, swapped to B, G, R, A when written
+	unsigned char index[64][4] ;
+	memset(index, 0, sizeof(index)) ;
+	unsigned char pixel[4] = { 0, 0, 0, 255 } ;
+	const unsigned char* p = data + 14 ;
+	const unsigned char* end = data + size - 8 ;	// the end marker
+	int run = 0 ;
+
+	unsigned char* dest = &image.pixels[0] ;
+	size_t count = (size_t)width * height ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (run > 0)
+		{
+			--run ;
+		}
+		else
+		{
+			if (p >= end)
+			{
+				return false ;
+			}
+
+			int op = *p++ ;
+			if (op == 0xFE)
+			{
+				if (end - p < 3)
+				{
+					return false ;
+				}
+				pixel[0] = p[0] ;
+				pixel[1] = p[1] ;
+				pixel[2] = p[2] ;
+				p += 3 ;
+			}
+			else if (op == 0xFF)
+			{
+				if (end - p < 4)
+				{
+					return false ;
+				}
+				memcpy(pixel, p, 4) ;
+				p += 4 ;
+			}
+			else if ((op & 0xC0) == 0x00)
+			{
+				memcpy(pixel, index[op], 4) ;
+			}
+			else if ((op & 0xC0) == 0x40)
+			{
+				pixel[0] = (unsigned char)(pixel[0] + ((op >> 4) & 3) - 2) ;
+				pixel[1] = (unsigned char)(pixel[1] + ((op >> 2) & 3) - 2) ;
+				pixel[2] = (unsigned char)(pixel[2] + (op & 3) - 2) ;
+			}
+			else if ((op & 0xC0) == 0x80)
+			{
+				if (p >= end)
+				{
+					return false ;
+				}
+				int dg = (op & 0x3F) - 32 ;
+				int next = *p++ ;
+				pixel[0] = (unsigned char)(pixel[0] + dg - 8 + ((next >> 4) & 15)) ;
+				pixel[1] = (unsigned char)(pixel[1] + dg) ;
+				pixel[2] = (unsigned char)(pixel[2] + dg - 8 + (next & 15)) ;
+			}
+			else
+			{
+				run = op & 0x3F ;
+			}
+
+			memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4) ;
+		}
+
+		dest[i * 4 + 0] = pixel[2] ;
+		dest[i * 4 + 1] = pixel[1] ;
+		dest[i * 4 + 2] = pixel[0] ;
+		dest[i * 4 + 3] = pixel[3] ;
+	}
+
+	FinishAlpha(image, channels == 4) ;
+	return true ;
+}
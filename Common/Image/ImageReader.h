@@ -0,0 +1,58 @@
+#ifndef __IMAGE_READER_H__
+#define __IMAGE_READER_H__
+
+#include <stddef.h>
+#include <vector>
+
+/*
+Decode image files in memory into 32 bit BGRA pixels, the layout Direct2D and Direct3D
+textures use, so a decoded image is uploaded without another conversion.
+
+Supports BMP (1, 4, 8, 24 and 32 bit, uncompressed or bit fields), PNG (every colour type
+and bit depth, interlaced or not), baseline JPEG (grey or YCbCr, any chroma subsampling)
+and QOI. Progressive and arithmetic coded JPEGs are not supported, DecodeImage returns
+false for them like for any unknown format, so callers can hand those to WIC.
+
+The decoders are plain C++ without platform headers, colour conversion and
+premultiplication use SSE2 where it is available.
+*/
+
+enum PIXEL_FORMAT
+{
+	PIXEL_PBGRA,	// 32 bit B, G, R, A with premultiplied alpha, DXGI_FORMAT_B8G8R8A8_UNORM premultiplied
+	PIXEL_BGRX,		// 32 bit B, G, R, the fourth byte is 255, for opaque pictures such as JPEGs
+};
+
+// Decoded pixels, rows are pitch bytes apart, top row first
+struct DecodedImage
+{
+	unsigned int width ;
+	unsigned int height ;
+	unsigned int pitch ;
+	PIXEL_FORMAT format ;
+	std::vector<unsigned char> pixels ;
+
+	DecodedImage() : width(0), height(0), pitch(0), format(PIXEL_PBGRA) {}
+
+	// Allocate the pixels, false if the image would be larger than MAX_IMAGE_BYTES
+	bool Allocate(unsigned int w, unsigned int h, PIXEL_FORMAT f) ;
+
+	// Exchange the pixels and sizes without copying
+	void Swap(DecodedImage& other) ;
+
+	unsigned char* Row(unsigned int y) { return &pixels[(size_t)y * pitch] ; }
+	const unsigned char* Row(unsigned int y) const { return &pixels[(size_t)y * pitch] ; }
+};
+
+// Largest image the decoders allocate, 512 MB or 134 million pixels
+static const size_t MAX_IMAGE_BYTES = (size_t)1 << 29 ;
+
+// Decode any supported file, the format is found from the first bytes
+bool DecodeImage(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image) ;
+
+bool DecodeBMP(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image) ;
+bool DecodePNG(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image) ;
+bool DecodeJPEG(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image) ;
+bool DecodeQOI(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image) ;
+
+#endif // end __IMAGE_READER_H__
@@ -0,0 +1,333 @@
+#include "ImageWriter.h"
+#include "Deflate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void PutLE16(std::vector<unsigned char>& out, unsigned int value)
+{
+	out.push_back((unsigned char)value) ;
+	out.push_back((unsigned char)(value >> 8)) ;
+}
+
+static void PutLE32(std::vector<unsigned char>& out, unsigned int value)
+{
+	PutLE16(out, value & 0xFFFF) ;
+	PutLE16(out, value >> 16) ;
+}
+
+static void PutBE32(std::vector<unsigned char>& out, unsigned int value)
+{
+	out.push_back((unsigned char)(value >> 24)) ;
+	out.push_back((unsigned char)(value >> 16)) ;
+	out.push_back((unsigned char)(value >> 8)) ;
+	out.push_back((unsigned char)value) ;
+}
+
+static bool IsValid(const ImageDesc& image)
+{
+	return image.pixels && image.width > 0 && image.height > 0 && image.pitch >= image.width * 4 &&
+		   image.width <= 0x7FFFFFFF / 4 / image.height ;
+}
+
+bool EncodeBMP(const ImageDesc& image, std::vector<unsigned char>& out)
+{
+	if (!IsValid(image))
+	{
+		return false ;
+	}
+
+	int bytesPerPixel = image.alpha ? 4 : 3 ;
+	unsigned int rowSize = (image.width * bytesPerPixel + 3) & ~3 ;	// rows are DWORD aligned
+	unsigned int imageSize = rowSize * image.height ;
+	unsigned int headerSize = 14 + 40 ;
+
+	// BITMAPFILEHEADER
+	out.push_back('B') ;
+	out.push_back('M') ;
+	PutLE32(out, headerSize + imageSize) ;
+	PutLE32(out, 0) ;
+	PutLE32(out, headerSize) ;
+
+	// BITMAPINFOHEADER, positive height means bottom-up rows
+	PutLE32(out, 40) ;
+	PutLE32(out, image.width) ;
+	PutLE32(out, image.height) ;
+	PutLE16(out, 1) ;
+	PutLE16(out, bytesPerPixel * 8) ;
+	PutLE32(out, 0) ;	// BI_RGB
+	PutLE32(out, imageSize) ;
+	PutLE32(out, 2835) ;	// 72 dpi
+	PutLE32(out, 2835) ;
+	PutLE32(out, 0) ;
+	PutLE32(out, 0) ;
+
+	size_t start = out.size() ;
+	out.resize(start + imageSize, 0) ;
+
+	for (int y = 0; y < image.height; ++y)
+	{
+		const unsigned char* src = image.pixels + (size_t)(image.height - 1 - y) * image.pitch ;
+		unsigned char* dest = &out[start + (size_t)y * rowSize] ;
+
+		if (image.alpha)
+		{
+			memcpy(dest, src, image.width * 4) ;
+		}
+		else
+		{
+			for (int x = 0; x < image.width; ++x)
+			{
+				dest[x * 3 + 0] = src[x * 4 + 0] ;
+				dest[x * 3 + 1] = src[x * 4 + 1] ;
+				dest[x * 3 + 2] = src[x * 4 + 2] ;
+			}
+		}
+	}
+
+	return true ;
+}
+
+static void PutChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size)
+{
+	PutBE32(out, (unsigned int)size) ;
+	size_t start = out.size() ;
+	out.insert(out.end(), type, type + 4) ;
+	if (size > 0)
+	{
+		out.insert(out.end(), data, data + size) ;
+	}
+	PutBE32(out, Crc32(&out[start], size + 4)) ;
+}
+
+static int Paeth(int a, int b, int c)
+{
+	int p = a + b - c ;
+	int pa = abs(p - a) ;
+	int pb = abs(p - b) ;
+	int pc = abs(p - c) ;
+	if (pa <= pb && pa <= pc) return a ;
+	if (pb <= pc) return b ;
+	return c ;
+}
+
+// Apply PNG filter type 'filter' to row, prior is the unfiltered previous row (zeros for the first).
+// Return the sum of the absolute values of the filtered bytes.
+static unsigned int FilterRow(int filter, const unsigned char* row, const unsigned char* prior, int size, int bpp, unsigned char* out)
+{
+	int i = 0 ;
+	switch (filter)
+	{
+	case 0:
+		memcpy(out, row, size) ;
+		break ;
+
+	case 1:
+		for (; i < bpp; ++i) out[i] = row[i] ;
+		for (; i < size; ++i) out[i] = (unsigned char)(row[i] - row[i - bpp]) ;
+		break ;
+
+	case 2:
+		for (; i < size; ++i) out[i] = (unsigned char)(row[i] - prior[i]) ;
+		break ;
+
+	case 3:
+		for (; i < bpp; ++i) out[i] = (unsigned char)(row[i] - (prior[i] >> 1)) ;
+		for (; i < size; ++i) out[i] = (unsigned char)(row[i] - ((row[i - bpp] + prior[i]) >> 1)) ;
+		break ;
+
+	default:
+		for (; i < bpp; ++i) out[i] = (unsigned char)(row[i] - prior[i]) ;
+		for (; i < size; ++i) out[i] = (unsigned char)(row[i] - Paeth(row[i - bpp], prior[i], prior[i - bpp])) ;
+		break ;
+	}
+
+	unsigned int cost = 0 ;
+	for (i = 0; i < size; ++i)
+	{
+		cost += abs((signed char)out[i]) ;
+	}
+	return cost ;
+}
+
+bool EncodePNG(const ImageDesc& image, std::vector<unsigned char>& out, int level)
+{
+	if (!IsValid(image))
+	{
+		return false ;
+	}
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' } ;
+	out.insert(out.end(), signature, signature + 8) ;
+
+	std::vector<unsigned char> header ;
+	PutBE32(header, image.width) ;
+	PutBE32(header, image.height) ;
+	header.push_back(8) ;						// bit depth
+	header.push_back(image.alpha ? 6 : 2) ;		// color type RGBA or RGB
+	header.push_back(0) ;						// deflate
+	header.push_back(0) ;						// adaptive filtering
+	header.push_back(0) ;						// no interlace
+	PutChunk(out, "IHDR", &header[0], header.size()) ;
+
+	// Filter every row with each of the 5 filters and keep the one with the smallest sum of
+	// absolute values, the usual heuristic that makes the data easier to compress
+	int bpp = image.alpha ? 4 : 3 ;
+	int rowSize = image.width * bpp ;
+	std::vector<unsigned char> filtered((size_t)(rowSize + 1) * image.height) ;
+	std::vector<unsigned char> current(rowSize) ;
+	std::vector<unsigned char> prior(rowSize, 0) ;
+	std::vector<unsigned char> candidate(rowSize) ;
+
+	for (int y = 0; y < image.height; ++y)
+	{
+		const unsigned char* src = image.pixels + (size_t)y * image.pitch ;
+		for (int x = 0; x < image.width; ++x)
+		{
+			current[x * bpp + 0] = src[x * 4 + 2] ;
+			current[x * bpp + 1] = src[x * 4 + 1] ;
+			current[x * bpp + 2] = src[x * 4 + 0] ;
+			if (image.alpha)
+			{
+				current[x * bpp + 3] = src[x * 4 + 3] ;
+			}
+		}
+
+		unsigned char* dest = &filtered[(size_t)y * (rowSize + 1)] ;
+		unsigned int bestCost = 0xFFFFFFFF ;
+		for (int filter = 0; filter < 5; ++filter)
+		{
+			unsigned int cost = FilterRow(filter, &current[0], &prior[0], rowSize, bpp, &candidate[0]) ;
+			if (cost < bestCost)
+			{
+				bestCost = cost ;
+				dest[0] = (unsigned char)filter ;
+				memcpy(dest + 1, &candidate[0], rowSize) ;
+			}
+		}
+
+		current.swap(prior) ;
+	}
+
+	std::vector<unsigned char> compressed ;
+	ZlibCompress(&filtered[0], filtered.size(), compressed, level) ;
+	PutChunk(out, "IDAT", &compressed[0], compressed.size()) ;
+	PutChunk(out, "IEND", NULL, 0) ;
+
+	return true ;
+}
+
+bool EncodeQOI(const ImageDesc& image, std::vector<unsigned char>& out)
+{
+	if (!IsValid(image))
+	{
+		return false ;
+	}
+
+	out.push_back('q') ;
+	out.push_back('o') ;
+	out.push_back('i') ;
+	out.push_back('f') ;
+	PutBE32(out, image.width) ;
+	PutBE32(out, image.height) ;
+	out.push_back(image.alpha ? 4 : 3) ;
+	out.push_back(0) ;	// sRGB with linear alpha
+
+	// Pixels are kept as R, G, B, A packed in that byte order
+	unsigned char index[64][4] ;
+	memset(index, 0, sizeof(index)) ;
+	unsigned char previous[4] = { 0, 0, 0, 255 } ;
+	int run = 0 ;
+
+	for (int y = 0; y < image.height; ++y)
+	{
+		const unsigned char* src = image.pixels + (size_t)y * image.pitch ;
+		bool lastRow = y == image.height - 1 ;
+
+		for (int x = 0; x < image.width; ++x)
+		{
+			unsigned char pixel[4] = { src[x * 4 + 2], src[x * 4 + 1], src[x * 4 + 0],
+									   image.alpha ? src[x * 4 + 3] : (unsigned char)255 } ;
+
+			if (memcmp(pixel, previous, 4) == 0)
+			{
+				++run ;
+				if (run == 62 || (lastRow && x == image.width - 1))
+				{
+					out.push_back((unsigned char)(0xC0 | (run - 1))) ;	// QOI_OP_RUN
+					run = 0 ;
+				}
+				continue ;
+			}
+
+			if (run > 0)
+			{
+				out.push_back((unsigned char)(0xC0 | (run - 1))) ;
+				run = 0 ;
+			}
+
+			int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64 ;
+			if (memcmp(index[hash], pixel, 4) == 0)
+			{
+				out.push_back((unsigned char)hash) ;	// QOI_OP_INDEX
+			}
+			else
+			{
+				memcpy(index[hash], pixel, 4) ;
+
+				if (pixel[3] == previous[3])
+				{
+					signed char dr = (signed char)(pixel[0] - previous[0]) ;
+					signed char dg = (signed char)(pixel[1] - previous[1]) ;
+					signed char db = (signed char)(pixel[2] - previous[2]) ;
+					signed char drg = (signed char)(dr - dg) ;
+					signed char dbg = (signed char)(db - dg) ;
+
+					if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					{
+						out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2))) ;	// QOI_OP_DIFF
+					}
+					else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+					{
+						out.push_back((unsigned char)(0x80 | (dg + 32))) ;	// QOI_OP_LUMA
+						out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8))) ;
+					}
+					else
+					{
+						out.push_back(0xFE) ;	// QOI_OP_RGB
+						out.insert(out.end(), pixel, pixel + 3) ;
+					}
+				}
+				else
+				{
+					out.push_back(0xFF) ;	// QOI_OP_RGBA
+					out.insert(out.end(), pixel, pixel + 4) ;
+				}
+			}
+
+			memcpy(previous, pixel, 4) ;
+		}
+	}
+
+	static const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 } ;
+	out.insert(out.end(), padding, padding + 8) ;
+
+	return true ;
+}
+
+bool EncodeImage(IMAGE_FORMAT format, const ImageDesc& image, std::vector<unsigned char>& out)
+{
+	switch (format)
+	{
+	case IMAGE_BMP: return EncodeBMP(image, out) ;
+	case IMAGE_PNG: return EncodePNG(image, out) ;
+	case IMAGE_QOI: return EncodeQOI(image, out) ;
+	default:		return false ;
+	}
+}
+
+const char* ImageFormatExtension(IMAGE_FORMAT format)
+{
+	static const char* extensions[IMAGE_FORMAT_COUNT] = { "bmp", "png", "qoi" } ;
+	return format >= 0 && format < IMAGE_FORMAT_COUNT ? extensions[format] : "" ;
+}
@@ -0,0 +1,41 @@
+#ifndef __IMAGE_WRITER_H__
+#define __IMAGE_WRITER_H__
+
+#include <vector>
+
+/*
+Encode 32 bit BGRA pixels into image files in memory.
+
+The encoders only see a pixel pointer and a pitch, so they run the same on a locked
+D3D surface, a DIB section or a plain buffer in a headless test.
+*/
+
+enum IMAGE_FORMAT
+{
+	IMAGE_BMP,		// uncompressed, fastest to write
+	IMAGE_PNG,		// lossless deflate, smallest for desktop content
+	IMAGE_QOI,		// lossless, "Quite OK Image" format, close to PNG size at a fraction of the time
+	IMAGE_FORMAT_COUNT
+};
+
+// Description of the source pixels, rows are pitch bytes apart, top row first
+struct ImageDesc
+{
+	const unsigned char* pixels ;	// B, G, R, A bytes per pixel
+	int width ;
+	int height ;
+	int pitch ;
+	bool alpha ;					// false writes RGB only, e.g. for screenshots whose alpha is undefined
+};
+
+// Encode the image and append the file content to out, return false for invalid sizes
+bool EncodeImage(IMAGE_FORMAT format, const ImageDesc& image, std::vector<unsigned char>& out) ;
+
+bool EncodeBMP(const ImageDesc& image, std::vector<unsigned char>& out) ;
+bool EncodePNG(const ImageDesc& image, std::vector<unsigned char>& out, int level = 6) ;
+bool EncodeQOI(const ImageDesc& image, std::vector<unsigned char>& out) ;
+
+// File extension without the dot, e.g. "png"
+const char* ImageFormatExtension(IMAGE_FORMAT format) ;
+
+#endif // end __IMAGE_WRITER_H__
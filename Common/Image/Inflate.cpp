@@ -0,0 +1,466 @@
+#include "Inflate.h"
+#include "Deflate.h"
+
+#include <string.h>
+
+// Codes of up to FAST_BITS bits are decoded with one lookup
+#define FAST_BITS 10
+#define FAST_SIZE (1 << FAST_BITS)
+
+static const unsigned short s_LengthBase[29] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+} ;
+
+static const unsigned char s_LengthExtra[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+} ;
+
+static const unsigned short s_DistanceBase[30] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+} ;
+
+static const unsigned char s_DistanceExtra[30] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+} ;
+
+// Order in which the code length code lengths are stored
+static const unsigned char s_CodeLengthOrder[19] =
+{
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+} ;
+
+static unsigned int Reverse(unsigned int code, int bits)
+{
+	unsigned int result = 0 ;
+	for (int i = 0; i < bits; ++i)
+	{
+		result = (result << 1) | (code & 1) ;
+		code >>= 1 ;
+	}
+	return result ;
+}
+
+/*
+Canonical Huffman code. Deflate sends codes starting with their first bit, so the
+lookup table is indexed by the next FAST_BITS input bits as they come, longer codes are
+bit reversed and compared with the largest code of each length.
+*/
+struct Huffman
+{
+	unsigned short fast[FAST_SIZE] ;	// (length << 9) | symbol, 0 if the code is longer
+	unsigned int maxCode[17] ;			// first code of the next length, left aligned to 16 bits
+	unsigned short firstCode[16] ;
+	unsigned short firstSymbol[16] ;
+	unsigned char lengths[288] ;		// by canonical order
+	unsigned short symbols[288] ;
+
+	bool Build(const unsigned char* codeLengths, int count)
+	{
+		int counts[16] = { 0 } ;
+		for (int i = 0; i < count; ++i)
+		{
+			++counts[codeLengths[i]] ;
+		}
+		counts[0] = 0 ;
+
+		memset(fast, 0, sizeof(fast)) ;
+
+		int nextCode[16] ;
+		int code = 0 ;
+		int symbol = 0 ;
+		for (int length = 1; length < 16; ++length)
+		{
+			nextCode[length] = code ;
+			firstCode[length] = (unsigned short)code ;
+			firstSymbol[length] = (unsigned short)symbol ;
+			code += counts[length] ;
+			if (counts[length] && code - 1 >= (1 << length))
+			{
+				return false ;	// more codes than fit into length bits
+			}
+			maxCode[length] = code << (16 - length) ;
+			code <<= 1 ;
+			symbol += counts[length] ;
+		}
+		maxCode[16] = 0x10000 ;
+
+		for (int i = 0; i < count; ++i)
+		{
+			int length = codeLengths[i] ;
+			if (length == 0)
+			{
+				continue ;
+			}
+
+			int index = nextCode[length] - firstCode[length] + firstSymbol[length] ;
+			lengths[index] = (unsigned char)length ;
+			symbols[index] = (unsigned short)i ;
+
+			if (length <= FAST_BITS)
+			{
+				for (unsigned int j = Reverse(nextCode[length], length); j < FAST_SIZE; j += 1 << length)
+				{
+					fast[j] = (unsigned short)((length << 9) | i) ;
+				}
+			}
+			++nextCode[length] ;
+		}
+
+		return true ;
+	}
+};
+
+// Least significant bit first reader, reads zeros after the end and counts them
+class BitReader
+{
+public:
+	BitReader(const unsigned char* data, size_t size)
+		: m_pData(data), m_pEnd(data + size), m_Bits(0), m_Count(0), m_Padding(0)
+	{
+	}
+
+	void Refill()
+	{
+		while (m_Count <= 56)
+		{
+			unsigned long long byte = 0 ;
+			if (m_pData < m_pEnd)
+			{
+				byte = *m_pData++ ;
+			}
+			else
+			{
+				++m_Padding ;
+			}
+			m_Bits |= byte << m_Count ;
+			m_Count += 8 ;
+		}
+	}
+
+	unsigned int Peek(int count)
+	{
+		if (m_Count < count)
+		{
+			Refill() ;
+		}
+		return (unsigned int)(m_Bits & ((1ULL << count) - 1)) ;
+	}
+
+	void Skip(int count)
+	{
+		m_Bits >>= count ;
+		m_Count -= count ;
+	}
+
+	unsigned int Read(int count)
+	{
+		unsigned int value = Peek(count) ;
+		Skip(count) ;
+		return value ;
+	}
+
+	// False once more bits were used than the data has
+	bool IsValid() const
+	{
+		return m_Padding * 8 <= m_Count ;
+	}
+
+	// Drop the bits up to the next byte, then continue reading bytes from memory
+	void AlignToByte()
+	{
+		Skip(m_Count & 7) ;
+	}
+
+	// Position of the next whole byte after AlignToByte
+	const unsigned char* BytePosition() const
+	{
+		return m_pData - (m_Count / 8 - m_Padding) ;
+	}
+
+	const unsigned char* End() const { return m_pEnd ; }
+
+	// Continue at a byte position, after stored data was copied directly
+	void Seek(const unsigned char* position)
+	{
+		m_pData = position ;
+		m_Bits = 0 ;
+		m_Count = 0 ;
+		m_Padding = 0 ;
+	}
+
+	int Decode(const Huffman& huffman)
+	{
+		unsigned int bits = Peek(16) ;
+		int entry = huffman.fast[bits & (FAST_SIZE - 1)] ;
+		if (entry)
+		{
+			Skip(entry >> 9) ;
+			return entry & 511 ;
+		}
+
+		// Longer codes, compare the code read so far with the largest code of each length
+		unsigned int code = Reverse(bits, 16) ;
+		int length = FAST_BITS + 1 ;
+		while (code >= huffman.maxCode[length])
+		{
+			++length ;
+		}
+		if (length >= 16)
+		{
+			return -1 ;
+		}
+
+		int index = (code >> (16 - length)) - huffman.firstCode[length] + huffman.firstSymbol[length] ;
+		if (index >= 288 || huffman.lengths[index] != length)
+		{
+			return -1 ;
+		}
+
+		Skip(length) ;
+		return huffman.symbols[index] ;
+	}
+
+private:
+	const unsigned char* m_pData ;
+	const unsigned char* m_pEnd ;
+	unsigned long long m_Bits ;
+	int m_Count ;
+	int m_Padding ;
+};
+
+// The codes of fixed Huffman blocks, built when the program starts
+struct FixedCodes
+{
+	Huffman literals ;
+	Huffman distances ;
+
+	FixedCodes()
+	{
+		unsigned char lengths[288] ;
+		memset(lengths, 8, 144) ;
+		memset(lengths + 144, 9, 112) ;
+		memset(lengths + 256, 7, 24) ;
+		memset(lengths + 280, 8, 8) ;
+		literals.Build(lengths, 288) ;
+
+		memset(lengths, 5, 30) ;
+		distances.Build(lengths, 30) ;
+	}
+};
+
+static const FixedCodes s_Fixed ;
+
+static bool ReadDynamicTables(BitReader& reader, Huffman& literals, Huffman& distances)
+{
+	int literalCount = reader.Read(5) + 257 ;
+	int distanceCount = reader.Read(5) + 1 ;
+	int codeLengthCount = reader.Read(4) + 4 ;
+
+	unsigned char codeLengthLengths[19] = { 0 } ;
+	for (int i = 0; i < codeLengthCount; ++i)
+	{
+		codeLengthLengths[s_CodeLengthOrder[i]] = (unsigned char)reader.Read(3) ;
+	}
+
+	Huffman codeLengths ;
+	if (!codeLengths.Build(codeLengthLengths, 19))
+	{
+		return false ;
+	}
+
+	// Literal and distance code lengths are one sequence, repeats may cross from one to the other
+	unsigned char lengths[288 + 32] ;
+	int total = literalCount + distanceCount ;
+	int count = 0 ;
+	while (count < total)
+	{
+		int symbol = reader.Decode(codeLengths) ;
+		if (symbol < 0 || !reader.IsValid())
+		{
+			return false ;
+		}
+
+		if (symbol < 16)
+		{
+			lengths[count++] = (unsigned char)symbol ;
+			continue ;
+		}
+
+		int repeat ;
+		unsigned char value = 0 ;
+		if (symbol == 16)
+		{
+			if (count == 0)
+			{
+				return false ;
+			}
+			repeat = 3 + reader.Read(2) ;
+			value = lengths[count - 1] ;
+		}
+		else if (symbol == 17)
+		{
+			repeat = 3 + reader.Read(3) ;
+		}
+		else
+		{
+			repeat = 11 + reader.Read(7) ;
+		}
+
+		if (repeat > total - count)
+		{
+			return false ;
+		}
+		memset(lengths + count, value, repeat) ;
+		count += repeat ;
+	}
+
+	return literals.Build(lengths, literalCount) && distances.Build(lengths + literalCount, distanceCount) ;
+}
+
+static bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances,
+						 unsigned char* out, unsigned char*& op, unsigned char* outEnd)
+{
+	for (;;)
+	{
+		int symbol = reader.Decode(literals) ;
+		if (symbol < 256)
+		{
+			if (symbol < 0 || op == outEnd)
+			{
+				return false ;
+			}
+			*op++ = (unsigned char)symbol ;
+			continue ;
+		}
+
+		if (symbol == 256)
+		{
+			return reader.IsValid() ;
+		}
+
+		symbol -= 257 ;
+		if (symbol >= 29)
+		{
+			return false ;
+		}
+		size_t length = s_LengthBase[symbol] + reader.Read(s_LengthExtra[symbol]) ;
+
+		symbol = reader.Decode(distances) ;
+		if (symbol < 0 || symbol >= 30)
+		{
+			return false ;
+		}
+		size_t distance = s_DistanceBase[symbol] + reader.Read(s_DistanceExtra[symbol]) ;
+
+		if (distance > (size_t)(op - out) || length > (size_t)(outEnd - op) || !reader.IsValid())
+		{
+			return false ;
+		}
+
+		const unsigned char* match = op - distance ;
+		if (distance >= length)
+		{
+			memcpy(op, match, length) ;
+			op += length ;
+		}
+		else
+		{
+			// The match overlaps the bytes it produces, e.g. a run of one repeated byte
+			for (size_t i = 0; i < length; ++i)
+			{
+				*op++ = match[i] ;
+			}
+		}
+	}
+}
+
+static bool Inflate(BitReader& reader, unsigned char* out, size_t outSize)
+{
+	unsigned char* op = out ;
+	unsigned char* outEnd = out + outSize ;
+
+	bool last = false ;
+	while (!last)
+	{
+		last = reader.Read(1) != 0 ;
+		int type = reader.Read(2) ;
+
+		if (type == 0)
+		{
+			// Stored block, LEN and NLEN then the bytes
+			reader.AlignToByte() ;
+			const unsigned char* p = reader.BytePosition() ;
+			if (reader.End() - p < 4)
+			{
+				return false ;
+			}
+			size_t length = p[0] | (p[1] << 8) ;
+			size_t check = p[2] | (p[3] << 8) ;
+			p += 4 ;
+			if (length != (~check & 0xFFFF) || length > (size_t)(reader.End() - p) || length > (size_t)(outEnd - op))
+			{
+				return false ;
+			}
+			memcpy(op, p, length) ;
+			op += length ;
+			reader.Seek(p + length) ;
+		}
+		else if (type == 1)
+		{
+			if (!InflateBlock(reader, s_Fixed.literals, s_Fixed.distances, out, op, outEnd))
+			{
+				return false ;
+			}
+		}
+		else if (type == 2)
+		{
+			Huffman literals ;
+			Huffman distances ;
+			if (!ReadDynamicTables(reader, literals, distances) ||
+				!InflateBlock(reader, literals, distances, out, op, outEnd))
+			{
+				return false ;
+			}
+		}
+		else
+		{
+			return false ;
+		}
+	}
+
+	return op == outEnd && reader.IsValid() ;
+}
+
+bool ZlibDecompress(const unsigned char* data, size_t size, unsigned char* out, size_t outSize)
+{
+	// CMF and FLG: deflate, at most 32 KB window, no preset dictionary, check bits
+	if (size < 6 || (data[0] & 0x0F) != 8 || (data[0] >> 4) > 7 || (data[1] & 0x20) ||
+		((data[0] << 8) | data[1]) % 31 != 0)
+	{
+		return false ;
+	}
+
+	BitReader reader(data + 2, size - 2) ;
+	if (!Inflate(reader, out, outSize))
+	{
+		return false ;
+	}
+
+	reader.AlignToByte() ;
+	const unsigned char* p = reader.BytePosition() ;
+	if (reader.End() - p < 4)
+	{
+		return false ;
+	}
+
+	unsigned int adler = ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3] ;
+	return adler == Adler32(out, outSize) ;
+}
@@ -0,0 +1,19 @@
+#ifndef __INFLATE_H__
+#define __INFLATE_H__
+
+#include <stddef.h>
+
+/*
+zlib stream decompression (RFC 1950/1951), the reading side of Deflate.h for PNG files.
+
+Handles stored, fixed and dynamic Huffman blocks, so it reads what any PNG writer
+produces. Codes up to 10 bits, which are nearly all of them, are decoded with one table
+lookup.
+*/
+
+// Decompress a zlib stream that must expand to exactly outSize bytes, e.g. the
+// concatenated IDAT chunks of a PNG. Return false for corrupt data or a wrong checksum,
+// nothing is read or written outside the two buffers.
+bool ZlibDecompress(const unsigned char* data, size_t size, unsigned char* out, size_t outSize) ;
+
+#endif // end __INFLATE_H__
@@ -0,0 +1,832 @@
+#include "ImageReader.h"
+#include "PixelConvert.h"
+
+#include <string.h>
+#include <algorithm>
+
+/*
+Baseline JPEG decoder: Huffman coded 8 bit DCT (SOF0 and SOF1) with one or three
+components, any sampling factors, restart intervals and non-interleaved scans.
+
+Blocks are decoded into one plane per component, rounded up to whole MCUs. The chroma
+planes are then upsampled row by row, with the triangle filter libjpeg calls "fancy
+upsampling" for the usual 2x factors, and converted to BGR by YCbCrToBGRX.
+*/
+
+// Position of each coefficient of the zigzag order in the 8x8 block
+static const unsigned char s_Zigzag[64] =
+{
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+} ;
+
+static const int FAST_BITS = 9 ;
+
+struct HuffmanTable
+{
+	unsigned char fastLength[1 << FAST_BITS] ;	// code length of the codes that fit FAST_BITS, 0 otherwise
+	unsigned char fastSymbol[1 << FAST_BITS] ;
+	unsigned int maxCode[18] ;					// largest code of each length, left aligned to 16 bits
+	int delta[17] ;								// symbol index minus code for each length
+	unsigned char symbols[256] ;
+	bool defined ;
+
+	bool Build(const unsigned char* counts, const unsigned char* values, int total)
+	{
+		memcpy(symbols, values, total) ;
+		memset(fastLength, 0, sizeof(fastLength)) ;
+
+		unsigned int code = 0 ;
+		int index = 0 ;
+		for (int length = 1; length <= 16; ++length)
+		{
+			delta[length] = index - (int)code ;
+			for (int i = 0; i < counts[length - 1]; ++i, ++index, ++code)
+			{
+				// More codes than the length allows, checked before they index the fast table
+				if (code >= (1u << length))
+				{
+					return false ;
+				}
+				if (length <= FAST_BITS)
+				{
+					int first = code << (FAST_BITS - length) ;
+					int last = (code + 1) << (FAST_BITS - length) ;
+					for (int j = first; j < last; ++j)
+					{
+						fastLength[j] = (unsigned char)length ;
+						fastSymbol[j] = values[index] ;
+					}
+				}
+			}
+			maxCode[length] = code << (16 - length) ;
+			code <<= 1 ;
+		}
+		maxCode[17] = 0xFFFFFFFF ;
+		defined = true ;
+		return true ;
+	}
+};
+
+// Reads the entropy coded data, skipping the 0 after each stuffed 0xFF. At a marker it
+// stops and returns zero bits, the marker is left for the caller.
+class BitReader
+{
+public:
+	BitReader(const unsigned char* p, const unsigned char* end) : m_p(p), m_pEnd(end), m_Bits(0), m_Count(0) {}
+
+	const unsigned char* Position(void) const { return m_p ; }
+
+	void Reset(const unsigned char* p)
+	{
+		m_p = p ;
+		m_Bits = 0 ;
+		m_Count = 0 ;
+	}
+
+	void Fill(void)
+	{
+		while (m_Count <= 24)
+		{
+			unsigned int byte = 0 ;
+			if (m_p < m_pEnd && *m_p != 0xFF)
+			{
+				byte = *m_p++ ;
+			}
+			else if (m_pEnd - m_p >= 2 && m_p[1] == 0)
+			{
+				byte = 0xFF ;
+				m_p += 2 ;
+			}
+			m_Bits |= byte << (24 - m_Count) ;
+			m_Count += 8 ;
+		}
+	}
+
+	unsigned int Peek(int count)
+	{
+		if (m_Count < count)
+		{
+			Fill() ;
+		}
+		return m_Bits >> (32 - count) ;
+	}
+
+	void Skip(int count)
+	{
+		m_Bits <<= count ;
+		m_Count -= count ;
+	}
+
+	unsigned int Get(int count)
+	{
+		unsigned int value = Peek(count) ;
+		Skip(count) ;
+		return value ;
+	}
+
+	// A value of count bits in the JPEG magnitude coding
+	int Receive(int count)
+	{
+		if (count == 0)
+		{
+			return 0 ;
+		}
+		int value = (int)Get(count) ;
+		return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value ;
+	}
+
+	int Decode(const HuffmanTable& table)
+	{
+		unsigned int peek = Peek(16) ;
+		int fast = peek >> (16 - FAST_BITS) ;
+		if (table.fastLength[fast])
+		{
+			Skip(table.fastLength[fast]) ;
+			return table.fastSymbol[fast] ;
+		}
+
+		int length = FAST_BITS + 1 ;
+		while (peek >= table.maxCode[length])
+		{
+			++length ;
+		}
+		if (length > 16)
+		{
+			return -1 ;
+		}
+		Skip(length) ;
+		return table.symbols[(peek >> (16 - length)) + table.delta[length]] ;
+	}
+
+private:
+	const unsigned char* m_p ;
+	const unsigned char* m_pEnd ;
+	unsigned int m_Bits ;
+	int m_Count ;
+};
+
+struct JpegComponent
+{
+	int id ;
+	int h ;
+	int v ;
+	int quant ;
+	int dcTable ;
+	int acTable ;
+	int dcPrediction ;
+
+	// Plane of decoded samples, whole MCUs
+	int planeWidth ;
+	int planeHeight ;
+	std::vector<unsigned char> plane ;
+
+	// Size of the component itself, for non-interleaved scans
+	int blocksX ;
+	int blocksY ;
+};
+
+static unsigned char ClampSample(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value)) ;
+}
+
+// Fixed point factors times 4096 of the libjpeg islow IDCT
+static const int FIX_0_298631336 = 1223 ;
+static const int FIX_0_390180644 = 1598 ;
+static const int FIX_0_541196100 = 2217 ;
+static const int FIX_0_765366865 = 3135 ;
+static const int FIX_0_899976223 = 3686 ;
+static const int FIX_1_175875602 = 4816 ;
+static const int FIX_1_501321110 = 6149 ;
+static const int FIX_1_847759065 = 7568 ;
+static const int FIX_1_961570560 = 8035 ;
+static const int FIX_2_053119869 = 8410 ;
+static const int FIX_2_562915447 = 10498 ;
+static const int FIX_3_072711026 = 12586 ;
+
+// One dimensional 8 point IDCT of s[0], s[step], ..., the results plus bias shifted right.
+// The sums are unsigned so a damaged stream wraps around instead of overflowing, the bits
+// are the same as with int wherever int does not overflow.
+static void Idct8(const int* s, int step, int bias, int shift, int* out)
+{
+	unsigned int p1 = ((unsigned int)s[2 * step] + s[6 * step]) * FIX_0_541196100 ;
+	unsigned int t2 = p1 - (unsigned int)s[6 * step] * FIX_1_847759065 ;
+	unsigned int t3 = p1 + (unsigned int)s[2 * step] * FIX_0_765366865 ;
+	unsigned int t0 = ((unsigned int)s[0] + s[4 * step]) * 4096 ;
+	unsigned int t1 = ((unsigned int)s[0] - s[4 * step]) * 4096 ;
+
+	unsigned int x0 = t0 + t3 + bias ;
+	unsigned int x3 = t0 - t3 + bias ;
+	unsigned int x1 = t1 + t2 + bias ;
+	unsigned int x2 = t1 - t2 + bias ;
+
+	t0 = s[7 * step] ;
+	t1 = s[5 * step] ;
+	t2 = s[3 * step] ;
+	t3 = s[1 * step] ;
+	unsigned int p3 = t0 + t2 ;
+	unsigned int p4 = t1 + t3 ;
+	p1 = t0 + t3 ;
+	unsigned int p2 = t1 + t2 ;
+	unsigned int p5 = (p3 + p4) * FIX_1_175875602 ;
+	t0 *= FIX_0_298631336 ;
+	t1 *= FIX_2_053119869 ;
+	t2 *= FIX_3_072711026 ;
+	t3 *= FIX_1_501321110 ;
+	p1 = p5 - p1 * FIX_0_899976223 ;
+	p2 = p5 - p2 * FIX_2_562915447 ;
+	p3 *= (unsigned int)-FIX_1_961570560 ;
+	p4 *= (unsigned int)-FIX_0_390180644 ;
+	t3 += p1 + p4 ;
+	t2 += p2 + p3 ;
+	t1 += p2 + p4 ;
+	t0 += p1 + p3 ;
+
+	out[0] = (int)(x0 + t3) >> shift ;
+	out[7] = (int)(x0 - t3) >> shift ;
+	out[1] = (int)(x1 + t2) >> shift ;
+	out[6] = (int)(x1 - t2) >> shift ;
+	out[2] = (int)(x2 + t1) >> shift ;
+	out[5] = (int)(x2 - t1) >> shift ;
+	out[3] = (int)(x3 + t0) >> shift ;
+	out[4] = (int)(x3 - t0) >> shift ;
+}
+
+// Dequantized coefficients to 8x8 samples
+static void InverseDct(const int* coefficients, unsigned char* dest, int pitch)
+{
+	// Columns, with 2 extra bits of precision
+	int temp[64] ;
+	for (int x = 0; x < 8; ++x)
+	{
+		const int* column = coefficients + x ;
+		if (column[8] == 0 && column[16] == 0 && column[24] == 0 && column[32] == 0 &&
+			column[40] == 0 && column[48] == 0 && column[56] == 0)
+		{
+			int dc = column[0] * 4 ;
+			for (int y = 0; y < 8; ++y)
+			{
+				temp[y * 8 + x] = dc ;
+			}
+			continue ;
+		}
+
+		int out[8] ;
+		Idct8(column, 8, 512, 10, out) ;
+		for (int y = 0; y < 8; ++y)
+		{
+			temp[y * 8 + x] = out[y] ;
+		}
+	}
+
+	// Rows, removing the 3 bits of scale and the 2 extra bits and adding 128
+	for (int y = 0; y < 8; ++y)
+	{
+		int out[8] ;
+		Idct8(temp + y * 8, 1, 65536 + (128 << 17), 17, out) ;
+		for (int x = 0; x < 8; ++x)
+		{
+			dest[x] = ClampSample(out[x]) ;
+		}
+		dest += pitch ;
+	}
+}
+
+// A coefficient times its quantizer, saturated to 16 bits. Valid streams stay within 12
+// bits, a damaged one would otherwise overflow the IDCT.
+static int Dequantize(int value, int quant)
+{
+	long long product = (long long)value * quant ;
+	return product < -32768 ? -32768 : product > 32767 ? 32767 : (int)product ;
+}
+
+class JpegDecoder
+{
+public:
+	JpegDecoder(const unsigned char* data, size_t size)
+		: m_pData(data), m_pEnd(data + size), m_Width(0), m_Height(0), m_ComponentCount(0),
+		  m_MaxH(1), m_MaxV(1), m_McusX(0), m_McusY(0), m_RestartInterval(0), m_AdobeTransform(-1)
+	{
+		memset(m_Quant, 0, sizeof(m_Quant)) ;
+		memset(m_Dc, 0, sizeof(m_Dc)) ;
+		memset(m_Ac, 0, sizeof(m_Ac)) ;
+	}
+
+	bool Decode(PIXEL_FORMAT format, DecodedImage& image)
+	{
+		const unsigned char* p = m_pData + 2 ;
+		bool hasFrame = false ;
+		bool hasScan = false ;
+
+		for (;;)
+		{
+			// Markers may be preceded by any number of 0xFF fill bytes
+			while (p < m_pEnd && *p != 0xFF)
+			{
+				++p ;
+			}
+			while (p < m_pEnd && *p == 0xFF)
+			{
+				++p ;
+			}
+			if (p >= m_pEnd)
+			{
+				return false ;
+			}
+
+			int marker = *p++ ;
+			if (marker == 0xD9)		// EOI
+			{
+				break ;
+			}
+			if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+			{
+				continue ;			// stray restart markers carry no length
+			}
+			if (m_pEnd - p < 2)
+			{
+				return false ;
+			}
+
+			int length = (p[0] << 8) | p[1] ;
+			if (length < 2 || length > m_pEnd - p)
+			{
+				return false ;
+			}
+			const unsigned char* segment = p + 2 ;
+			int segmentLength = length - 2 ;
+			p += length ;
+
+			switch (marker)
+			{
+			case 0xC0:	// baseline
+			case 0xC1:	// extended sequential, Huffman
+				if (hasFrame || !ReadFrame(segment, segmentLength))
+				{
+					return false ;
+				}
+				hasFrame = true ;
+				break ;
+
+			case 0xC4:
+				if (!ReadHuffmanTables(segment, segmentLength))
+				{
+					return false ;
+				}
+				break ;
+
+			case 0xDB:
+				if (!ReadQuantTables(segment, segmentLength))
+				{
+					return false ;
+				}
+				break ;
+
+			case 0xDD:
+				if (segmentLength < 2)
+				{
+					return false ;
+				}
+				m_RestartInterval = (segment[0] << 8) | segment[1] ;
+				break ;
+
+			case 0xEE:	// APP14, Adobe tells whether three components are YCbCr or RGB
+				if (segmentLength >= 12 && memcmp(segment, "Adobe", 5) == 0)
+				{
+					m_AdobeTransform = segment[11] ;
+				}
+				break ;
+
+			case 0xDA:
+				if (!hasFrame || !ReadScan(segment, segmentLength, p))
+				{
+					return false ;
+				}
+				hasScan = true ;
+				break ;
+
+			default:
+				// Progressive, lossless, arithmetic coded and hierarchical frames
+				if ((marker >= 0xC2 && marker <= 0xCF) || marker == 0xDE)
+				{
+					return false ;
+				}
+				break ;		// APPn, COM and others are skipped
+			}
+		}
+
+		return hasScan && Output(format, image) ;
+	}
+
+private:
+	bool ReadFrame(const unsigned char* s, int length)
+	{
+		if (length < 6 || s[0] != 8)
+		{
+			return false ;		// 12 bit samples
+		}
+
+		m_Height = (s[1] << 8) | s[2] ;
+		m_Width = (s[3] << 8) | s[4] ;
+		m_ComponentCount = s[5] ;
+		if (m_Width == 0 || m_Height == 0 || (m_ComponentCount != 1 && m_ComponentCount != 3) ||
+			length < 6 + m_ComponentCount * 3)
+		{
+			return false ;	// a height given by a DNL marker and CMYK are not supported
+		}
+
+		for (int i = 0; i < m_ComponentCount; ++i)
+		{
+			JpegComponent& c = m_Components[i] ;
+			const unsigned char* d = s + 6 + i * 3 ;
+			c.id = d[0] ;
+			c.h = d[1] >> 4 ;
+			c.v = d[1] & 15 ;
+			c.quant = d[2] ;
+			if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.quant > 3)
+			{
+				return false ;
+			}
+			m_MaxH = c.h > m_MaxH ? c.h : m_MaxH ;
+			m_MaxV = c.v > m_MaxV ? c.v : m_MaxV ;
+		}
+
+		m_McusX = (m_Width + m_MaxH * 8 - 1) / (m_MaxH * 8) ;
+		m_McusY = (m_Height + m_MaxV * 8 - 1) / (m_MaxV * 8) ;
+		if ((size_t)m_McusX * m_MaxH * 8 * m_McusY * m_MaxV * 8 > MAX_IMAGE_BYTES / 4)
+		{
+			return false ;
+		}
+
+		for (int i = 0; i < m_ComponentCount; ++i)
+		{
+			JpegComponent& c = m_Components[i] ;
+			if (m_MaxH % c.h || m_MaxV % c.v)
+			{
+				return false ;	// upsampling by fractions
+			}
+			c.planeWidth = m_McusX * c.h * 8 ;
+			c.planeHeight = m_McusY * c.v * 8 ;
+			c.plane.assign((size_t)c.planeWidth * c.planeHeight, 0) ;
+			c.blocksX = ((m_Width * c.h + m_MaxH - 1) / m_MaxH + 7) / 8 ;
+			c.blocksY = ((m_Height * c.v + m_MaxV - 1) / m_MaxV + 7) / 8 ;
+		}
+		return true ;
+	}
+
+	bool ReadHuffmanTables(const unsigned char* s, int length)
+	{
+		while (length >= 17)
+		{
+			int tableClass = s[0] >> 4 ;
+			int index = s[0] & 15 ;
+			if (tableClass > 1 || index > 3)
+			{
+				return false ;
+			}
+
+			int total = 0 ;
+			for (int i = 0; i < 16; ++i)
+			{
+				total += s[1 + i] ;
+			}
+			if (total > 256 || length < 17 + total)
+			{
+				return false ;
+			}
+
+			HuffmanTable& table = tableClass ? m_Ac[index] : m_Dc[index] ;
+			if (!table.Build(s + 1, s + 17, total))
+			{
+				return false ;
+			}
+			s += 17 + total ;
+			length -= 17 + total ;
+		}
+		return length == 0 ;
+	}
+
+	bool ReadQuantTables(const unsigned char* s, int length)
+	{
+		while (length > 0)
+		{
+			int precision = s[0] >> 4 ;
+			int index = s[0] & 15 ;
+			int tableSize = precision ? 129 : 65 ;
+			if (precision > 1 || index > 3 || length < tableSize)
+			{
+				return false ;
+			}
+			for (int i = 0; i < 64; ++i)
+			{
+				m_Quant[index][i] = precision ? (s[1 + i * 2] << 8) | s[2 + i * 2] : s[1 + i] ;
+			}
+			s += tableSize ;
+			length -= tableSize ;
+		}
+		return true ;
+	}
+
+	// Decode the entropy coded data after the SOS header, p is moved past it
+	bool ReadScan(const unsigned char* s, int length, const unsigned char*& p)
+	{
+		int count = length > 0 ? s[0] : 0 ;
+		if (count < 1 || count > m_ComponentCount || length < 4 + count * 2)
+		{
+			return false ;
+		}
+
+		JpegComponent* scan[4] ;
+		for (int i = 0; i < count; ++i)
+		{
+			scan[i] = NULL ;
+			for (int j = 0; j < m_ComponentCount; ++j)
+			{
+				if (m_Components[j].id == s[1 + i * 2])
+				{
+					scan[i] = &m_Components[j] ;
+				}
+			}
+			if (!scan[i])
+			{
+				return false ;
+			}
+			scan[i]->dcTable = s[2 + i * 2] >> 4 ;
+			scan[i]->acTable = s[2 + i * 2] & 15 ;
+			scan[i]->dcPrediction = 0 ;
+			if (scan[i]->dcTable > 3 || scan[i]->acTable > 3 ||
+				!m_Dc[scan[i]->dcTable].defined || !m_Ac[scan[i]->acTable].defined)
+			{
+				return false ;
+			}
+		}
+
+		// Spectral selection and successive approximation must be the whole block in baseline
+		const unsigned char* tail = s + 1 + count * 2 ;
+		if (tail[0] != 0 || tail[1] != 63 || tail[2] != 0)
+		{
+			return false ;
+		}
+
+		// A single component scan covers the blocks of the component, not whole MCUs
+		int unitsX = count == 1 ? scan[0]->blocksX : m_McusX ;
+		int unitsY = count == 1 ? scan[0]->blocksY : m_McusY ;
+
+		BitReader bits(p, m_pEnd) ;
+		int restartsLeft = m_RestartInterval ;
+		for (int my = 0; my < unitsY; ++my)
+		{
+			for (int mx = 0; mx < unitsX; ++mx)
+			{
+				if (m_RestartInterval && restartsLeft-- == 0)
+				{
+					if (!Restart(bits, count, scan))
+					{
+						return false ;
+					}
+					restartsLeft = m_RestartInterval - 1 ;
+				}
+
+				if (count == 1)
+				{
+					if (!DecodeBlock(bits, *scan[0], mx, my))
+					{
+						return false ;
+					}
+					continue ;
+				}
+
+				for (int i = 0; i < count; ++i)
+				{
+					JpegComponent& c = *scan[i] ;
+					for (int by = 0; by < c.v; ++by)
+					{
+						for (int bx = 0; bx < c.h; ++bx)
+						{
+							if (!DecodeBlock(bits, c, mx * c.h + bx, my * c.v + by))
+							{
+								return false ;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		p = bits.Position() ;
+		return true ;
+	}
+
+	// Skip to the RSTn marker that follows every restart interval and start over
+	bool Restart(BitReader& bits, int count, JpegComponent** scan)
+	{
+		const unsigned char* p = bits.Position() ;
+		while (m_pEnd - p >= 2 && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7))
+		{
+			if (p[0] == 0xFF && p[1] != 0 && p[1] != 0xFF)
+			{
+				return false ;	// some other marker, the data is truncated
+			}
+			++p ;
+		}
+		if (m_pEnd - p < 2)
+		{
+			return false ;
+		}
+
+		bits.Reset(p + 2) ;
+		for (int i = 0; i < count; ++i)
+		{
+			scan[i]->dcPrediction = 0 ;
+		}
+		return true ;
+	}
+
+	bool DecodeBlock(BitReader& bits, JpegComponent& c, int bx, int by)
+	{
+		int coefficients[64] ;
+		memset(coefficients, 0, sizeof(coefficients)) ;
+		const int* quant = m_Quant[c.quant] ;
+
+		int size = bits.Decode(m_Dc[c.dcTable]) ;
+		if (size < 0 || size > 11)
+		{
+			return false ;
+		}
+		// Kept to 16 bits so a damaged stream cannot overflow the prediction over many blocks
+		c.dcPrediction = std::max(-32768, std::min(c.dcPrediction + bits.Receive(size), 32767)) ;
+		coefficients[0] = Dequantize(c.dcPrediction, quant[0]) ;
+
+		const HuffmanTable& ac = m_Ac[c.acTable] ;
+		for (int k = 1; k < 64;)
+		{
+			int symbol = bits.Decode(ac) ;
+			if (symbol < 0)
+			{
+				return false ;
+			}
+
+			int run = symbol >> 4 ;
+			size = symbol & 15 ;
+			if (size == 0)
+			{
+				if (run != 15)
+				{
+					break ;		// end of block
+				}
+				k += 16 ;
+				continue ;
+			}
+
+			k += run ;
+			if (k > 63)
+			{
+				return false ;
+			}
+			coefficients[s_Zigzag[k]] = Dequantize(bits.Receive(size), quant[k]) ;
+			++k ;
+		}
+
+		InverseDct(coefficients, &c.plane[(size_t)by * 8 * c.planeWidth + bx * 8], c.planeWidth) ;
+		return true ;
+	}
+
+	// Row y of component c at full resolution. Factors of 2 use the triangle filter,
+	// 3 of 4 parts the nearer sample and 1 part the other, others repeat the samples.
+	void UpsampleRow(const JpegComponent& c, int y, unsigned char* dest, int* column) const
+	{
+		int scaleX = m_MaxH / c.h ;
+		int scaleY = m_MaxV / c.v ;
+		int width = (m_Width + scaleX - 1) / scaleX ;
+		int height = (m_Height + scaleY - 1) / scaleY ;
+
+		if (scaleX == 1 && scaleY == 1)
+		{
+			memcpy(dest, &c.plane[(size_t)y * c.planeWidth], m_Width) ;
+			return ;
+		}
+
+		// Vertical pass into column, 4 times the sample value
+		int sy = y / scaleY ;
+		const unsigned char* nearRow = &c.plane[(size_t)sy * c.planeWidth] ;
+		if (scaleY == 2)
+		{
+			int other = y & 1 ? sy + 1 : sy - 1 ;
+			other = other < 0 ? 0 : (other >= height ? height - 1 : other) ;
+			const unsigned char* farRow = &c.plane[(size_t)other * c.planeWidth] ;
+			for (int x = 0; x < width; ++x)
+			{
+				column[x] = nearRow[x] * 3 + farRow[x] ;
+			}
+		}
+		else
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				column[x] = nearRow[x] * 4 ;
+			}
+		}
+
+		if (scaleX == 2)
+		{
+			for (int x = 0; x < m_Width; ++x)
+			{
+				int sx = x >> 1 ;
+				int other = x & 1 ? (sx + 1 < width ? sx + 1 : sx) : (sx > 0 ? sx - 1 : 0) ;
+				dest[x] = (unsigned char)((column[sx] * 3 + column[other] + 8) >> 4) ;
+			}
+		}
+		else
+		{
+			for (int x = 0; x < m_Width; ++x)
+			{
+				dest[x] = (unsigned char)((column[x / scaleX] + 2) >> 2) ;
+			}
+		}
+	}
+
+	bool Output(PIXEL_FORMAT format, DecodedImage& image)
+	{
+		if (!image.Allocate(m_Width, m_Height, format))
+		{
+			return false ;
+		}
+
+		if (m_ComponentCount == 1)
+		{
+			const JpegComponent& c = m_Components[0] ;
+			for (int y = 0; y < m_Height; ++y)
+			{
+				ExpandGray(&c.plane[(size_t)y * c.planeWidth], image.Row(y), m_Width) ;
+			}
+			return true ;
+		}
+
+		// Three components are YCbCr unless the Adobe marker or the component ids say RGB
+		bool rgb = m_AdobeTransform == 0 ||
+			(m_AdobeTransform < 0 && m_Components[0].id == 'R' && m_Components[1].id == 'G' && m_Components[2].id == 'B') ;
+
+		std::vector<unsigned char> rows((size_t)m_Width * 3) ;
+		std::vector<int> column(m_Width + 1) ;
+		unsigned char* channel[3] = { &rows[0], &rows[m_Width], &rows[m_Width * 2] } ;
+		for (int y = 0; y < m_Height; ++y)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				UpsampleRow(m_Components[i], y, channel[i], &column[0]) ;
+			}
+
+			unsigned char* dest = image.Row(y) ;
+			if (rgb)
+			{
+				for (int x = 0; x < m_Width; ++x)
+				{
+					dest[x * 4 + 0] = channel[2][x] ;
+					dest[x * 4 + 1] = channel[1][x] ;
+					dest[x * 4 + 2] = channel[0][x] ;
+					dest[x * 4 + 3] = 255 ;
+				}
+			}
+			else
+			{
+				YCbCrToBGRX(channel[0], channel[1], channel[2], dest, m_Width) ;
+			}
+		}
+		return true ;
+	}
+
+	const unsigned char* m_pData ;
+	const unsigned char* m_pEnd ;
+
+	int m_Width ;
+	int m_Height ;
+	int m_ComponentCount ;
+	JpegComponent m_Components[3] ;
+	int m_MaxH ;
+	int m_MaxV ;
+	int m_McusX ;
+	int m_McusY ;
+
+	int m_Quant[4][64] ;		// in zigzag order
+	HuffmanTable m_Dc[4] ;
+	HuffmanTable m_Ac[4] ;
+	int m_RestartInterval ;
+	int m_AdobeTransform ;		// -1 without an Adobe marker
+
+	JpegDecoder(const JpegDecoder&) ;
+	JpegDecoder& operator=(const JpegDecoder&) ;
+};
+
+bool DecodeJPEG(const unsigned char* data, size_t size, PIXEL_FORMAT format, DecodedImage& image)
+{
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+	{
+		return false ;
+	}
+
+	JpegDecoder decoder(data, size) ;
+	return decoder.Decode(format, image) ;
+}
@@ -0,0 +1,248 @@
+#include "PixelConvert.h"
+#include "../Utility/Simd.h"
+
+#include <string.h>
+
+// YCbCr to RGB factors times 4096, the products are kept in quarter units for rounding
+static const int CR_TO_R = 5743 ;	// 1.402
+static const int CB_TO_G = 1410 ;	// 0.344136
+static const int CR_TO_G = 2925 ;	// 0.714136
+static const int CB_TO_B = 7258 ;	// 1.772
+
+static unsigned char Clamp(int value)
+{
+	return (unsigned char)(value < 0 ? 0 : (value > 255 ? 255 : value)) ;
+}
+
+// The high half of a 16 x 16 bit product, what _mm_mulhi_epi16 computes
+static int MulHigh(int a, int b)
+{
+	return (a * b) >> 16 ;
+}
+
+// c * a / 255 rounded, exact for all bytes
+static unsigned char Premultiply(unsigned int c, unsigned int a)
+{
+	unsigned int t = c * a + 128 ;
+	return (unsigned char)((t + (t >> 8)) >> 8) ;
+}
+
+void SwapRedBlue(const unsigned char* src, unsigned char* dest, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i greenAlpha = _mm_set1_epi32((int)0xFF00FF00) ;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 4)) ;
+		__m128i redBlue = _mm_andnot_si128(greenAlpha, pixels) ;
+		redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16)) ;
+		_mm_storeu_si128((__m128i*)(dest + i * 4), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), redBlue)) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		unsigned char red = src[i * 4 + 0] ;
+		dest[i * 4 + 0] = src[i * 4 + 2] ;
+		dest[i * 4 + 1] = src[i * 4 + 1] ;
+		dest[i * 4 + 2] = red ;
+		dest[i * 4 + 3] = src[i * 4 + 3] ;
+	}
+}
+
+void ExpandRGB(const unsigned char* src, unsigned char* dest, size_t count, bool swapRedBlue)
+{
+	int first = swapRedBlue ? 2 : 0 ;
+	int last = 2 - first ;
+	for (size_t i = 0; i < count; ++i)
+	{
+		dest[0] = src[first] ;
+		dest[1] = src[1] ;
+		dest[2] = src[last] ;
+		dest[3] = 255 ;
+		src += 3 ;
+		dest += 4 ;
+	}
+}
+
+void ExpandGray(const unsigned char* src, unsigned char* dest, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i opaque = _mm_set1_epi8((char)0xFF) ;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i gray = _mm_loadu_si128((const __m128i*)(src + i)) ;
+		__m128i grayGrayLow = _mm_unpacklo_epi8(gray, gray) ;
+		__m128i grayGrayHigh = _mm_unpackhi_epi8(gray, gray) ;
+		__m128i grayAlphaLow = _mm_unpacklo_epi8(gray, opaque) ;
+		__m128i grayAlphaHigh = _mm_unpackhi_epi8(gray, opaque) ;
+
+		__m128i* out = (__m128i*)(dest + i * 4) ;
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(grayGrayLow, grayAlphaLow)) ;
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayGrayLow, grayAlphaLow)) ;
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(grayGrayHigh, grayAlphaHigh)) ;
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(grayGrayHigh, grayAlphaHigh)) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		dest[i * 4 + 0] = src[i] ;
+		dest[i * 4 + 1] = src[i] ;
+		dest[i * 4 + 2] = src[i] ;
+		dest[i * 4 + 3] = 255 ;
+	}
+}
+
+void ExpandGrayAlpha(const unsigned char* src, unsigned char* dest, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dest[i * 4 + 0] = src[i * 2] ;
+		dest[i * 4 + 1] = src[i * 2] ;
+		dest[i * 4 + 2] = src[i * 2] ;
+		dest[i * 4 + 3] = src[i * 2 + 1] ;
+	}
+}
+
+void YCbCrToBGRX(const unsigned char* y, const unsigned char* cb, const unsigned char* cr, unsigned char* dest, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128() ;
+	const __m128i center = _mm_set1_epi16(128) ;
+	const __m128i round = _mm_set1_epi16(2) ;
+	const __m128i opaque = _mm_set1_epi8((char)0xFF) ;
+	const __m128i crToR = _mm_set1_epi16(CR_TO_R) ;
+	const __m128i cbToG = _mm_set1_epi16(CB_TO_G) ;
+	const __m128i crToG = _mm_set1_epi16(CR_TO_G) ;
+	const __m128i cbToB = _mm_set1_epi16(CB_TO_B) ;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		// Chroma centred on 0 and times 64, so the high half of the product is in quarter units
+		__m128i luma = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + i)), zero), 2) ;
+		__m128i blue = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cb + i)), zero), center), 6) ;
+		__m128i red = _mm_slli_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cr + i)), zero), center), 6) ;
+
+		__m128i r = _mm_add_epi16(luma, _mm_mulhi_epi16(red, crToR)) ;
+		__m128i g = _mm_sub_epi16(_mm_sub_epi16(luma, _mm_mulhi_epi16(blue, cbToG)), _mm_mulhi_epi16(red, crToG)) ;
+		__m128i b = _mm_add_epi16(luma, _mm_mulhi_epi16(blue, cbToB)) ;
+
+		r = _mm_srai_epi16(_mm_add_epi16(r, round), 2) ;
+		g = _mm_srai_epi16(_mm_add_epi16(g, round), 2) ;
+		b = _mm_srai_epi16(_mm_add_epi16(b, round), 2) ;
+
+		// Saturate to bytes, then interleave to B, G, R, 255
+		__m128i blueGreen = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g)) ;
+		__m128i redAlpha = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), opaque) ;
+
+		__m128i* out = (__m128i*)(dest + i * 4) ;
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(blueGreen, redAlpha)) ;
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(blueGreen, redAlpha)) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		int luma = y[i] << 2 ;
+		int blue = (cb[i] - 128) * 64 ;
+		int red = (cr[i] - 128) * 64 ;
+
+		dest[i * 4 + 0] = Clamp((luma + MulHigh(blue, CB_TO_B) + 2) >> 2) ;
+		dest[i * 4 + 1] = Clamp((luma - MulHigh(blue, CB_TO_G) - MulHigh(red, CR_TO_G) + 2) >> 2) ;
+		dest[i * 4 + 2] = Clamp((luma + MulHigh(red, CR_TO_R) + 2) >> 2) ;
+		dest[i * 4 + 3] = 255 ;
+	}
+}
+
+void PremultiplyAlpha(unsigned char* pixels, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128() ;
+	const __m128i half = _mm_set1_epi16(128) ;
+	const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000) ;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i p = _mm_loadu_si128((const __m128i*)(pixels + i * 4)) ;
+
+		// Two pixels per register as 16 bit values, the alpha of each pixel copied to its four lanes
+		__m128i low = _mm_unpacklo_epi8(p, zero) ;
+		__m128i high = _mm_unpackhi_epi8(p, zero) ;
+		__m128i lowAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, 0xFF), 0xFF) ;
+		__m128i highAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, 0xFF), 0xFF) ;
+
+		// (t + (t >> 8)) >> 8 with t = c * a + 128 divides by 255 with rounding
+		low = _mm_add_epi16(_mm_mullo_epi16(low, lowAlpha), half) ;
+		high = _mm_add_epi16(_mm_mullo_epi16(high, highAlpha), half) ;
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8) ;
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8) ;
+
+		__m128i result = _mm_packus_epi16(low, high) ;
+		result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, p)) ;
+		_mm_storeu_si128((__m128i*)(pixels + i * 4), result) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		unsigned char* p = pixels + i * 4 ;
+		p[0] = Premultiply(p[0], p[3]) ;
+		p[1] = Premultiply(p[1], p[3]) ;
+		p[2] = Premultiply(p[2], p[3]) ;
+	}
+}
+
+void SetOpaque(unsigned char* pixels, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000) ;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i* p = (__m128i*)(pixels + i * 4) ;
+		_mm_storeu_si128(p, _mm_or_si128(_mm_loadu_si128(p), alphaMask)) ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		pixels[i * 4 + 3] = 255 ;
+	}
+}
+
+bool IsOpaque(const unsigned char* pixels, size_t count)
+{
+	size_t i = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000) ;
+	__m128i all = alphaMask ;
+	for (; i + 4 <= count; i += 4)
+	{
+		all = _mm_and_si128(all, _mm_loadu_si128((const __m128i*)(pixels + i * 4))) ;
+	}
+	if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(all, alphaMask), alphaMask)) != 0xFFFF)
+	{
+		return false ;
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		if (pixels[i * 4 + 3] != 255)
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
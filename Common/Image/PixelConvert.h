@@ -0,0 +1,38 @@
+#ifndef __PIXEL_CONVERT_H__
+#define __PIXEL_CONVERT_H__
+
+#include <stddef.h>
+
+/*
+Conversions of pixel rows into 32 bit BGRA, used by the decoders in ImageReader.
+
+Every function has an SSE2 path and a scalar path with the same arithmetic, so the
+output does not depend on the instruction set. count is in pixels, src and dest may be
+the same row only where noted.
+*/
+
+// R, G, B, A to B, G, R, A and back, src may be dest
+void SwapRedBlue(const unsigned char* src, unsigned char* dest, size_t count) ;
+
+// 24 bit R, G, B (swapRedBlue true) or B, G, R (false) to B, G, R, 255
+void ExpandRGB(const unsigned char* src, unsigned char* dest, size_t count, bool swapRedBlue) ;
+
+// 8 bit grey to B, G, R, 255
+void ExpandGray(const unsigned char* src, unsigned char* dest, size_t count) ;
+
+// 8 bit grey and alpha pairs to B, G, R, A
+void ExpandGrayAlpha(const unsigned char* src, unsigned char* dest, size_t count) ;
+
+// Full range JPEG YCbCr (ITU-R BT.601) of three planes to B, G, R, 255
+void YCbCrToBGRX(const unsigned char* y, const unsigned char* cb, const unsigned char* cr, unsigned char* dest, size_t count) ;
+
+// Multiply B, G and R by A / 255 with rounding, in place
+void PremultiplyAlpha(unsigned char* pixels, size_t count) ;
+
+// Set every alpha byte to 255, in place
+void SetOpaque(unsigned char* pixels, size_t count) ;
+
+// True if every alpha byte is 255
+bool IsOpaque(const unsigned char* pixels, size_t count) ;
+
+#endif // end __PIXEL_CONVERT_H__
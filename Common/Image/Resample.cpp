@@ -0,0 +1,323 @@
+#include "Resample.h"
+#include "../Utility/Simd.h"
+#include "../Utility/ThreadPool.h"
+
+#include <math.h>
+#include <string.h>
+
+static const int WEIGHT_BITS = 14 ;
+static const int WEIGHT_ONE = 1 << WEIGHT_BITS ;
+
+// Rows per task, small enough to balance the threads, large enough to amortize the hand out
+static const int BAND_ROWS = 32 ;
+
+static const double PI = 3.14159265358979323846 ;
+
+static double Sinc(double x)
+{
+	if (x == 0.0)
+	{
+		return 1.0 ;
+	}
+	x *= PI ;
+	return sin(x) / x ;
+}
+
+static double FilterSupport(RESAMPLE_FILTER filter)
+{
+	switch (filter)
+	{
+	case RESAMPLE_BILINEAR: return 1.0 ;
+	case RESAMPLE_CUBIC:	return 2.0 ;
+	default:				return 3.0 ;
+	}
+}
+
+static double FilterWeight(RESAMPLE_FILTER filter, double x)
+{
+	x = fabs(x) ;
+	switch (filter)
+	{
+	case RESAMPLE_BILINEAR:
+		return x < 1.0 ? 1.0 - x : 0.0 ;
+
+	case RESAMPLE_CUBIC:
+		// Keys cubic with a = -0.5
+		if (x < 1.0)
+		{
+			return (1.5 * x - 2.5) * x * x + 1.0 ;
+		}
+		if (x < 2.0)
+		{
+			return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0 ;
+		}
+		return 0.0 ;
+
+	default:
+		return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0 ;
+	}
+}
+
+/*
+The source pixels and weights of every target pixel along one axis. Taps are stored in
+pairs for _mm_madd_epi16, an odd tap count is padded with a zero weight that reads the
+last tap again.
+*/
+struct Contributions
+{
+	std::vector<int> start ;		// first source pixel
+	std::vector<int> count ;		// number of source pixels
+	std::vector<short> weights ;	// stride taps per target pixel, even
+	int stride ;
+
+	void Compute(unsigned int srcSize, unsigned int destSize, RESAMPLE_FILTER filter)
+	{
+		double scale = (double)destSize / srcSize ;
+		double filterScale = scale < 1.0 ? scale : 1.0 ;
+		double support = FilterSupport(filter) / filterScale ;
+
+		stride = ((int)ceil(support) * 2 + 2) & ~1 ;
+		start.resize(destSize) ;
+		count.resize(destSize) ;
+		weights.assign((size_t)destSize * stride, 0) ;
+
+		std::vector<double> w(stride) ;
+		for (unsigned int i = 0; i < destSize; ++i)
+		{
+			double center = (i + 0.5) / scale ;
+			int first = (int)floor(center - support + 0.5) ;
+			int last = (int)floor(center + support + 0.5) ;
+			if (first < 0)
+			{
+				first = 0 ;
+			}
+			if (last > (int)srcSize)
+			{
+				last = (int)srcSize ;
+			}
+			if (last - first > stride)
+			{
+				last = first + stride ;
+			}
+
+			double total = 0.0 ;
+			int n = last - first ;
+			for (int k = 0; k < n; ++k)
+			{
+				w[k] = FilterWeight(filter, (first + k + 0.5 - center) * filterScale) ;
+				total += w[k] ;
+			}
+
+			// Fixed point weights that add up to exactly one, the rounding error goes to the largest
+			short* fixed = &weights[(size_t)i * stride] ;
+			int sum = 0 ;
+			int largest = 0 ;
+			for (int k = 0; k < n; ++k)
+			{
+				fixed[k] = (short)floor(w[k] / total * WEIGHT_ONE + 0.5) ;
+				sum += fixed[k] ;
+				if (fixed[k] > fixed[largest])
+				{
+					largest = k ;
+				}
+			}
+			fixed[largest] = (short)(fixed[largest] + WEIGHT_ONE - sum) ;
+
+			start[i] = first ;
+			count[i] = n ;
+		}
+	}
+};
+
+// Round a weighted sum, clamp it to a byte and colour to alpha
+static void StorePixel(const int* sum, unsigned char* dest)
+{
+	int value[4] ;
+	for (int c = 0; c < 4; ++c)
+	{
+		int v = sum[c] >> WEIGHT_BITS ;
+		value[c] = v < 0 ? 0 : (v > 255 ? 255 : v) ;
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		dest[c] = (unsigned char)(value[c] < value[3] ? value[c] : value[3]) ;
+	}
+	dest[3] = (unsigned char)value[3] ;
+}
+
+#ifdef SIMD_SSE2
+// The same as StorePixel for the sums of two pixels
+static __m128i PackPixels(__m128i sum0, __m128i sum1)
+{
+	__m128i values = _mm_packs_epi32(_mm_srai_epi32(sum0, WEIGHT_BITS), _mm_srai_epi32(sum1, WEIGHT_BITS)) ;
+	values = _mm_max_epi16(_mm_min_epi16(values, _mm_set1_epi16(255)), _mm_setzero_si128()) ;
+	__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(values, 0xFF), 0xFF) ;
+	values = _mm_min_epi16(values, alpha) ;
+	return _mm_packus_epi16(values, values) ;
+}
+
+// Two taps of weights as the pairs _mm_madd_epi16 multiplies with interleaved pixels
+static __m128i WeightPair(const short* weights)
+{
+	return _mm_set1_epi32((int)((unsigned short)weights[0] | ((unsigned int)(unsigned short)weights[1] << 16))) ;
+}
+#endif
+
+static void ResizeRow(const unsigned char* src, unsigned char* dest, unsigned int width, const Contributions& x)
+{
+	for (unsigned int i = 0; i < width; ++i)
+	{
+		const unsigned char* pixels = src + x.start[i] * 4 ;
+		const short* weights = &x.weights[(size_t)i * x.stride] ;
+		int n = x.count[i] ;
+
+#ifdef SIMD_SSE2
+		const __m128i zero = _mm_setzero_si128() ;
+		__m128i sum = _mm_set1_epi32(1 << (WEIGHT_BITS - 1)) ;
+		for (int k = 0; k < n; k += 2)
+		{
+			int next = k + 1 < n ? k + 1 : k ;
+			__m128i p0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(pixels + k * 4)), zero) ;
+			__m128i p1 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)(pixels + next * 4)), zero) ;
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(p0, p1), WeightPair(weights + k))) ;
+		}
+		*(int*)(dest + i * 4) = _mm_cvtsi128_si32(PackPixels(sum, sum)) ;
+#else
+		int sum[4] = { 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1) } ;
+		for (int k = 0; k < n; ++k)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				sum[c] += weights[k] * pixels[k * 4 + c] ;
+			}
+		}
+		StorePixel(sum, dest + i * 4) ;
+#endif
+	}
+}
+
+static void ResizeColumn(const DecodedImage& src, unsigned int row, unsigned char* dest, const Contributions& y)
+{
+	const short* weights = &y.weights[(size_t)row * y.stride] ;
+	int first = y.start[row] ;
+	int n = y.count[row] ;
+	unsigned int x = 0 ;
+
+#ifdef SIMD_SSE2
+	const __m128i zero = _mm_setzero_si128() ;
+	for (; x + 2 <= src.width; x += 2)
+	{
+		__m128i sum0 = _mm_set1_epi32(1 << (WEIGHT_BITS - 1)) ;
+		__m128i sum1 = sum0 ;
+		for (int k = 0; k < n; k += 2)
+		{
+			int next = k + 1 < n ? k + 1 : k ;
+			__m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src.Row(first + k) + x * 4)), zero) ;
+			__m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src.Row(first + next) + x * 4)), zero) ;
+			__m128i w = WeightPair(weights + k) ;
+			sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w)) ;
+			sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w)) ;
+		}
+		_mm_storel_epi64((__m128i*)(dest + x * 4), PackPixels(sum0, sum1)) ;
+	}
+#endif
+
+	for (; x < src.width; ++x)
+	{
+		int sum[4] = { 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1), 1 << (WEIGHT_BITS - 1) } ;
+		for (int k = 0; k < n; ++k)
+		{
+			const unsigned char* pixel = src.Row(first + k) + x * 4 ;
+			for (int c = 0; c < 4; ++c)
+			{
+				sum[c] += weights[k] * pixel[c] ;
+			}
+		}
+		StorePixel(sum, dest + x * 4) ;
+	}
+}
+
+// Call task for bands of BAND_ROWS rows, on the pool when there is one
+static void ForEachBand(unsigned int rows, ThreadPool* pPool, const std::function<void (unsigned int, unsigned int)>& task)
+{
+	int bands = (int)((rows + BAND_ROWS - 1) / BAND_ROWS) ;
+	std::function<void (int)> band = [&](int i)
+	{
+		unsigned int first = i * BAND_ROWS ;
+		unsigned int last = first + BAND_ROWS < rows ? first + BAND_ROWS : rows ;
+		task(first, last) ;
+	} ;
+
+	if (pPool)
+	{
+		pPool->ParallelFor(bands, band) ;
+	}
+	else
+	{
+		for (int i = 0; i < bands; ++i)
+		{
+			band(i) ;
+		}
+	}
+}
+
+bool ResizeImage(const DecodedImage& src, unsigned int width, unsigned int height, DecodedImage& dest,
+				 RESAMPLE_FILTER filter, ThreadPool* pPool)
+{
+	if (src.width == 0 || src.height == 0 || width == 0 || height == 0 || &src == &dest)
+	{
+		return false ;
+	}
+
+	// Horizontal pass into an image of the target width, skipped when the width stays
+	DecodedImage wide ;
+	const DecodedImage* pWide = &src ;
+	if (width != src.width)
+	{
+		if (!wide.Allocate(width, src.height, src.format))
+		{
+			return false ;
+		}
+
+		Contributions x ;
+		x.Compute(src.width, width, filter) ;
+		ForEachBand(src.height, pPool, [&](unsigned int first, unsigned int last)
+		{
+			for (unsigned int row = first; row < last; ++row)
+			{
+				ResizeRow(src.Row(row), wide.Row(row), width, x) ;
+			}
+		}) ;
+		pWide = &wide ;
+	}
+
+	if (height == src.height)
+	{
+		if (pWide == &wide)
+		{
+			dest.Swap(wide) ;
+		}
+		else
+		{
+			dest = src ;
+		}
+		return true ;
+	}
+
+	if (!dest.Allocate(width, height, src.format))
+	{
+		return false ;
+	}
+
+	Contributions y ;
+	y.Compute(src.height, height, filter) ;
+	ForEachBand(height, pPool, [&](unsigned int first, unsigned int last)
+	{
+		for (unsigned int row = first; row < last; ++row)
+		{
+			ResizeColumn(*pWide, row, dest.Row(row), y) ;
+		}
+	}) ;
+
+	return true ;
+}
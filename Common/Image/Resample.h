@@ -0,0 +1,33 @@
+#ifndef __RESAMPLE_H__
+#define __RESAMPLE_H__
+
+#include "ImageReader.h"
+
+class ThreadPool ;
+
+/*
+Scale 32 bit BGRA images with a separable filter.
+
+Rows are filtered horizontally into a temporary image, then columns vertically, with
+14 bit fixed point weights. When shrinking, the filter widens with the scale factor, so
+every source pixel contributes and fine detail averages out instead of aliasing. The
+pixels are expected premultiplied (or opaque), colour is clamped to alpha after the
+negative lobes of the cubic and Lanczos filters.
+
+Both passes are split into bands of rows that run on the threads of a ThreadPool, the
+inner loops use SSE2. The result does not depend on the number of threads.
+*/
+
+enum RESAMPLE_FILTER
+{
+	RESAMPLE_BILINEAR,	// triangle, 2 taps when enlarging
+	RESAMPLE_CUBIC,		// Catmull-Rom, 4 taps, what WICBitmapInterpolationModeCubic uses
+	RESAMPLE_LANCZOS3,	// windowed sinc, 6 taps, sharpest when shrinking photos
+};
+
+// Scale src to width x height into dest, which must not be src. pPool may be NULL to run
+// on the calling thread. Return false for an empty source or target size.
+bool ResizeImage(const DecodedImage& src, unsigned int width, unsigned int height, DecodedImage& dest,
+				 RESAMPLE_FILTER filter = RESAMPLE_LANCZOS3, ThreadPool* pPool = NULL) ;
+
+#endif // end __RESAMPLE_H__
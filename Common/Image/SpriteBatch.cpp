@@ -0,0 +1,94 @@
+#include "SpriteBatch.h"
+
+#include <math.h>
+#include <string.h>
+
+void SpriteAtlas::Reset(int width, int height)
+{
+	m_Width = width ;
+	m_Height = height ;
+	m_Regions.clear() ;
+}
+
+int SpriteAtlas::Add(const SpriteRect& rect)
+{
+	m_Regions.push_back(rect) ;
+	return (int)m_Regions.size() - 1 ;
+}
+
+int SpriteAtlas::AddGrid(int columns, int rows)
+{
+	int first = (int)m_Regions.size() ;
+	if (columns <= 0 || rows <= 0)
+	{
+		return first ;
+	}
+
+	int pieceWidth = m_Width / columns ;
+	int pieceHeight = m_Height / rows ;
+	m_Regions.reserve(m_Regions.size() + columns * rows) ;
+	for (int i = 0; i < columns * rows; ++i)
+	{
+		SpriteRect rect =
+		{
+			(i % columns) * pieceWidth,
+			(i / columns) * pieceHeight,
+			(i % columns + 1) * pieceWidth,
+			(i / columns + 1) * pieceHeight
+		} ;
+		m_Regions.push_back(rect) ;
+	}
+	return first ;
+}
+
+static int RoundToPixel(float value)
+{
+	return (int)floor(value + 0.5f) ;
+}
+
+void DrawSprites(const DecodedImage& atlas, const Sprite* sprites, int count, DecodedImage& target)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const Sprite& sprite = sprites[i] ;
+		int left = RoundToPixel(sprite.destLeft) ;
+		int top = RoundToPixel(sprite.destTop) ;
+		int right = RoundToPixel(sprite.destRight) ;
+		int bottom = RoundToPixel(sprite.destBottom) ;
+		int sourceWidth = sprite.source.right - sprite.source.left ;
+		int sourceHeight = sprite.source.bottom - sprite.source.top ;
+		if (right <= left || bottom <= top || sourceWidth <= 0 || sourceHeight <= 0)
+		{
+			continue ;
+		}
+
+		// Source position of each target pixel in 16.16 fixed point, sampled at pixel centres
+		int stepX = (int)(((long long)sourceWidth << 16) / (right - left)) ;
+		int stepY = (int)(((long long)sourceHeight << 16) / (bottom - top)) ;
+
+		int firstX = left < 0 ? 0 : left ;
+		int firstY = top < 0 ? 0 : top ;
+		int lastX = right > (int)target.width ? (int)target.width : right ;
+		int lastY = bottom > (int)target.height ? (int)target.height : bottom ;
+
+		for (int y = firstY; y < lastY; ++y)
+		{
+			int sy = sprite.source.top + (int)(((long long)(y - top) * stepY + stepY / 2) >> 16) ;
+			const unsigned int* src = (const unsigned int*)atlas.Row(sy) + sprite.source.left ;
+			unsigned int* dest = (unsigned int*)target.Row(y) ;
+
+			// Same size, copy the row
+			if (stepX == 0x10000)
+			{
+				memcpy(dest + firstX, src + (firstX - left), (lastX - firstX) * 4) ;
+				continue ;
+			}
+
+			int sx = (firstX - left) * stepX + stepX / 2 ;
+			for (int x = firstX; x < lastX; ++x, sx += stepX)
+			{
+				dest[x] = src[sx >> 16] ;
+			}
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef __SPRITE_BATCH_H__
+#define __SPRITE_BATCH_H__
+
+#include <vector>
+#include "ImageReader.h"
+
+/*
+Sprites as rectangles of one atlas image.
+
+A SpriteAtlas only describes regions of an image that is uploaded once, e.g. the pieces of
+a puzzle picture, so cutting a picture into 2500 pieces creates no bitmaps and copies no
+pixels. A SpriteBatch collects the sprites of a frame, each a region and the rectangle to
+draw it to, and a backend draws them all from the one bitmap: D2DSpriteBatch for
+Direct2D, DrawSprites below on the CPU for headless tests.
+*/
+
+struct SpriteRect
+{
+	int left ;
+	int top ;
+	int right ;
+	int bottom ;
+};
+
+struct Sprite
+{
+	SpriteRect source ;		// region of the atlas, in pixels
+	float destLeft ;		// target rectangle, in pixels of the render target
+	float destTop ;
+	float destRight ;
+	float destBottom ;
+};
+
+class SpriteAtlas
+{
+public:
+	SpriteAtlas(void) : m_Width(0), m_Height(0) {}
+
+	// Forget the regions and describe an atlas image of width x height
+	void Reset(int width, int height) ;
+
+	// Add a region, return its index
+	int Add(const SpriteRect& rect) ;
+
+	// Cut the image into columns x rows regions of equal size, left to right then top to
+	// bottom, the pixels left over at the right and bottom edges are not used. Return the
+	// index of the first region.
+	int AddGrid(int columns, int rows) ;
+
+	int Width() const { return m_Width ; }
+
+	int Height() const { return m_Height ; }
+
+	int Count() const { return (int)m_Regions.size() ; }
+
+	const SpriteRect& Region(int index) const { return m_Regions[index] ; }
+
+private:
+	int m_Width ;
+	int m_Height ;
+	std::vector<SpriteRect> m_Regions ;
+};
+
+class SpriteBatch
+{
+public:
+	// Start a new frame, the sprites of the last frame are dropped but their memory is kept
+	void Begin() { m_Sprites.clear() ; }
+
+	void Add(const SpriteRect& source, float left, float top, float right, float bottom)
+	{
+		Sprite sprite = { source, left, top, right, bottom } ;
+		m_Sprites.push_back(sprite) ;
+	}
+
+	int Count() const { return (int)m_Sprites.size() ; }
+
+	const Sprite* Sprites() const { return m_Sprites.empty() ? NULL : &m_Sprites[0] ; }
+
+private:
+	std::vector<Sprite> m_Sprites ;
+};
+
+// Draw sprites of the atlas into target on the CPU, nearest pixel sampling, no blending.
+// Target rectangles are rounded to whole pixels and clipped to the target.
+void DrawSprites(const DecodedImage& atlas, const Sprite* sprites, int count, DecodedImage& target) ;
+
+#endif // end __SPRITE_BATCH_H__
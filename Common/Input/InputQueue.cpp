@@ -0,0 +1,226 @@
+#include "InputQueue.h"
+#include "InputReplay.h"
+
+#include <string.h>
+
+InputQueue::InputQueue(unsigned int capacity)
+	: m_Head(0),
+	  m_Tail(0),
+	  m_Dropped(0)
+{
+	unsigned int size = 1 ;
+	while (size < capacity)
+	{
+		size <<= 1 ;
+	}
+	m_Events.resize(size) ;
+	m_Mask = size - 1 ;
+}
+
+InputQueue::~InputQueue(void)
+{
+}
+
+bool InputQueue::Push(const InputEvent& event)
+{
+	unsigned int head = m_Head.load(std::memory_order_relaxed) ;
+	if (head - m_Tail.load(std::memory_order_acquire) > m_Mask)
+	{
+		m_Dropped.fetch_add(1, std::memory_order_relaxed) ;
+		return false ;
+	}
+
+	m_Events[head & m_Mask] = event ;
+	m_Head.store(head + 1, std::memory_order_release) ;
+	return true ;
+}
+
+bool InputQueue::Peek(InputEvent& event) const
+{
+	unsigned int tail = m_Tail.load(std::memory_order_relaxed) ;
+	if (tail == m_Head.load(std::memory_order_acquire))
+	{
+		return false ;
+	}
+
+	event = m_Events[tail & m_Mask] ;
+	return true ;
+}
+
+bool InputQueue::Pop(InputEvent& event)
+{
+	if (!Peek(event))
+	{
+		return false ;
+	}
+
+	m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release) ;
+	return true ;
+}
+
+void InputQueue::Clear()
+{
+	m_Tail.store(m_Head.load(std::memory_order_acquire), std::memory_order_release) ;
+}
+
+unsigned int InputQueue::Count() const
+{
+	return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire) ;
+}
+
+InputState::InputState(void)
+	: m_pRecorder(NULL)
+{
+	memset(m_Keys, 0, sizeof(m_Keys)) ;
+	memset(m_Buttons, 0, sizeof(m_Buttons)) ;
+	m_ChangedCount = 0 ;
+	m_PressedCount = 0 ;
+	m_MouseDX = 0 ;
+	m_MouseDY = 0 ;
+	m_Wheel = 0 ;
+	m_MouseX = 0 ;
+	m_MouseY = 0 ;
+	m_bHasPosition = false ;
+}
+
+InputState::~InputState(void)
+{
+}
+
+void InputState::ClearEdges()
+{
+	// Only the keys that changed, not all 256 every step
+	for (int i = 0; i < m_ChangedCount; ++i)
+	{
+		int index = m_Changed[i] ;
+		unsigned char& state = index < 256 ? m_Keys[index] : m_Buttons[index - 256] ;
+		state &= KEY_DOWN ;
+	}
+	m_ChangedCount = 0 ;
+	m_PressedCount = 0 ;
+	m_MouseDX = 0 ;
+	m_MouseDY = 0 ;
+	m_Wheel = 0 ;
+}
+
+void InputState::BeginStep(InputQueue& queue)
+{
+	ClearEdges() ;
+
+	InputEvent event ;
+	while (queue.Pop(event))
+	{
+		Apply(event) ;
+	}
+}
+
+void InputState::BeginStep(InputQueue& queue, long long untilTicks)
+{
+	ClearEdges() ;
+
+	InputEvent event ;
+	while (queue.Peek(event) && event.ticks <= untilTicks)
+	{
+		queue.Pop(event) ;
+		Apply(event) ;
+	}
+}
+
+void InputState::Apply(const InputEvent& event)
+{
+	if (m_pRecorder)
+	{
+		m_pRecorder->Record(event) ;
+	}
+
+	unsigned char* pState = NULL ;
+	int index = 0 ;
+	switch (event.type)
+	{
+	case INPUT_KEY_DOWN:
+	case INPUT_KEY_UP:
+		index = event.code & 0xFF ;
+		pState = &m_Keys[index] ;
+		break ;
+
+	case INPUT_BUTTON_DOWN:
+	case INPUT_BUTTON_UP:
+		index = 256 + (event.code & 7) ;
+		pState = &m_Buttons[event.code & 7] ;
+		break ;
+
+	case INPUT_MOUSE_MOVE:
+		m_MouseDX += event.x ;
+		m_MouseDY += event.y ;
+		return ;
+
+	case INPUT_MOUSE_POSITION:
+		if (m_bHasPosition)
+		{
+			m_MouseDX += event.x - m_MouseX ;
+			m_MouseDY += event.y - m_MouseY ;
+		}
+		m_MouseX = event.x ;
+		m_MouseY = event.y ;
+		m_bHasPosition = true ;
+		return ;
+
+	case INPUT_WHEEL:
+		m_Wheel += event.x ;
+		return ;
+
+	case INPUT_RELEASE_ALL:
+		Clear() ;
+		return ;
+
+	default:
+		return ;
+	}
+
+	unsigned char before = *pState ;
+	if (event.type == INPUT_KEY_DOWN || event.type == INPUT_BUTTON_DOWN)
+	{
+		// Auto repeat sends more downs, each one is a press for typing
+		*pState |= KEY_DOWN | KEY_PRESSED ;
+		if (event.type == INPUT_KEY_DOWN && m_PressedCount < MAX_PRESSED_KEYS)
+		{
+			m_PressedKeys[m_PressedCount++] = index ;
+		}
+	}
+	else if (*pState & KEY_DOWN)
+	{
+		*pState = (unsigned char)((*pState & ~KEY_DOWN) | KEY_RELEASED) ;
+	}
+
+	// Remember the first edge of the step for ClearEdges
+	if ((before & (KEY_PRESSED | KEY_RELEASED)) == 0 && (*pState & (KEY_PRESSED | KEY_RELEASED)) != 0)
+	{
+		m_Changed[m_ChangedCount++] = (short)index ;
+	}
+}
+
+void InputState::Clear()
+{
+	// The up events follow from the one that caused them, they are not recorded
+	InputReplay* pRecorder = m_pRecorder ;
+	m_pRecorder = NULL ;
+
+	for (int i = 0; i < 256; ++i)
+	{
+		if (m_Keys[i] & KEY_DOWN)
+		{
+			InputEvent event = { 0, INPUT_KEY_UP, i, 0, 0 } ;
+			Apply(event) ;
+		}
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		if (m_Buttons[i] & KEY_DOWN)
+		{
+			InputEvent event = { 0, INPUT_BUTTON_UP, i, 0, 0 } ;
+			Apply(event) ;
+		}
+	}
+
+	m_pRecorder = pRecorder ;
+}
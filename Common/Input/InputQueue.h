@@ -0,0 +1,143 @@
+#ifndef __INPUT_QUEUE_H__
+#define __INPUT_QUEUE_H__
+
+#include <vector>
+#include <atomic>
+
+/*
+Buffered input for the fixed step simulation.
+
+The sources of input, DirectInput in buffered mode, window messages or a replay, turn
+what happened into InputEvents with the time it happened and push them into an
+InputQueue, a ring with one writer and one reader that needs no lock, so the writer
+can be the window thread while the simulation runs on another. At the start of every
+step the simulation hands the queue to InputState, which applies the events in order
+and remembers which keys and buttons went down or up during the step. A tap shorter
+than a step still shows as pressed and released, where polling the device state once
+per frame missed it.
+
+Keys are DirectInput scan codes (DIK_*), what the demos test for, buttons 0 to 7 are
+the mouse buttons in the order of DIMOUSESTATE2.
+*/
+
+enum INPUT_EVENT_TYPE
+{
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP,
+	INPUT_BUTTON_DOWN,
+	INPUT_BUTTON_UP,
+	INPUT_MOUSE_MOVE,		// x, y relative motion
+	INPUT_MOUSE_POSITION,	// x, y position in the client area
+	INPUT_WHEEL,			// x wheel delta, 120 per notch
+	INPUT_RELEASE_ALL,		// the window lost the focus, every key and button goes up
+};
+
+struct InputEvent
+{
+	long long ticks ;		// when it happened, in ticks of Timer.h
+	int type ;				// INPUT_EVENT_TYPE
+	int code ;				// key or button
+	int x ;
+	int y ;
+};
+
+class InputQueue
+{
+public:
+	// capacity is rounded up to a power of two
+	explicit InputQueue(unsigned int capacity = 1024);
+	~InputQueue(void);
+
+	// Writer side, false and counted as dropped when the queue is full
+	bool Push(const InputEvent& event) ;
+
+	// Reader side, false when the queue is empty
+	bool Peek(InputEvent& event) const ;
+	bool Pop(InputEvent& event) ;
+	void Clear() ;
+
+	unsigned int Count() const ;
+	unsigned int Capacity() const { return m_Mask + 1 ; }
+	unsigned int Dropped() const { return m_Dropped.load() ; }
+
+private:
+	std::vector<InputEvent> m_Events ;
+	unsigned int m_Mask ;
+	std::atomic<unsigned int> m_Head ;		// next event to write
+	std::atomic<unsigned int> m_Tail ;		// next event to read
+	std::atomic<unsigned int> m_Dropped ;
+
+	InputQueue(const InputQueue&) ;
+	InputQueue& operator=(const InputQueue&) ;
+};
+
+class InputReplay ;
+
+// The keys, buttons and mouse of one simulation step
+class InputState
+{
+public:
+	InputState(void);
+	~InputState(void);
+
+	// Start a step: forget the edges of the last one and apply the events of the queue
+	// that happened up to untilTicks, later ones stay queued for the next step
+	void BeginStep(InputQueue& queue) ;
+	void BeginStep(InputQueue& queue, long long untilTicks) ;
+
+	// Apply one event to the current step
+	void Apply(const InputEvent& event) ;
+
+	// Release every key and button, what INPUT_RELEASE_ALL does. When the window loses
+	// the focus the up events go elsewhere.
+	void Clear() ;
+
+	bool KeyDown(int key) const { return (m_Keys[key & 0xFF] & KEY_DOWN) != 0 ; }
+	bool KeyPressed(int key) const { return (m_Keys[key & 0xFF] & KEY_PRESSED) != 0 ; }
+	bool KeyReleased(int key) const { return (m_Keys[key & 0xFF] & KEY_RELEASED) != 0 ; }
+
+	// The keys pressed in this step in the order they were pressed, repeats included
+	int PressedCount() const { return m_PressedCount ; }
+	int PressedKey(int index) const { return m_PressedKeys[index] ; }
+
+	bool ButtonDown(int button) const { return (m_Buttons[button & 7] & KEY_DOWN) != 0 ; }
+	bool ButtonPressed(int button) const { return (m_Buttons[button & 7] & KEY_PRESSED) != 0 ; }
+	bool ButtonReleased(int button) const { return (m_Buttons[button & 7] & KEY_RELEASED) != 0 ; }
+
+	// Motion and wheel of this step, the position is the last one seen
+	int MouseDX() const { return m_MouseDX ; }
+	int MouseDY() const { return m_MouseDY ; }
+	int Wheel() const { return m_Wheel ; }
+	int MouseX() const { return m_MouseX ; }
+	int MouseY() const { return m_MouseY ; }
+
+	// Add every event applied to pRecorder, NULL to stop
+	void SetRecorder(InputReplay* pRecorder) { m_pRecorder = pRecorder ; }
+
+	static const int MAX_PRESSED_KEYS = 32 ;
+
+private:
+	static const unsigned char KEY_DOWN = 1 ;
+	static const unsigned char KEY_PRESSED = 2 ;
+	static const unsigned char KEY_RELEASED = 4 ;
+
+	void ClearEdges() ;
+
+	unsigned char m_Keys[256] ;
+	unsigned char m_Buttons[8] ;
+	short m_Changed[256 + 8] ;				// keys, then buttons at 256, with edges to clear
+	int m_ChangedCount ;
+	int m_PressedKeys[MAX_PRESSED_KEYS] ;
+	int m_PressedCount ;
+
+	int m_MouseDX ;
+	int m_MouseDY ;
+	int m_Wheel ;
+	int m_MouseX ;
+	int m_MouseY ;
+	bool m_bHasPosition ;
+
+	InputReplay* m_pRecorder ;
+};
+
+#endif // end __INPUT_QUEUE_H__
@@ -0,0 +1,170 @@
+#include "InputReplay.h"
+#include "../Utility/Timer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char REPLAY_TAG[4] = { 'I', 'N', 'P', '1' } ;
+static const int RECORD_SIZE = 24 ;		// microseconds 8, type, code, x, y 4 each
+
+static void PutU32(unsigned char* out, unsigned int value)
+{
+	out[0] = (unsigned char)value ;
+	out[1] = (unsigned char)(value >> 8) ;
+	out[2] = (unsigned char)(value >> 16) ;
+	out[3] = (unsigned char)(value >> 24) ;
+}
+
+static unsigned int GetU32(const unsigned char* in)
+{
+	return in[0] | (in[1] << 8) | (in[2] << 16) | ((unsigned int)in[3] << 24) ;
+}
+
+static long long TicksToMicroseconds(long long ticks)
+{
+	return (long long)(TicksToMs(ticks) * 1000.0 + (ticks < 0 ? -0.5 : 0.5)) ;
+}
+
+static long long MicrosecondsToTicks(long long us)
+{
+	return (long long)(us * (double)TimerFrequency() / 1000000.0 + (us < 0 ? -0.5 : 0.5)) ;
+}
+
+InputReplay::InputReplay(void)
+	: m_StartTicks(0),
+	  m_bStarted(false),
+	  m_Next(0)
+{
+}
+
+InputReplay::~InputReplay(void)
+{
+}
+
+void InputReplay::StartRecording(long long startTicks)
+{
+	Clear() ;
+	m_StartTicks = startTicks ;
+	m_bStarted = true ;
+}
+
+void InputReplay::Record(const InputEvent& event)
+{
+	if (!m_bStarted)
+	{
+		m_StartTicks = event.ticks ;
+		m_bStarted = true ;
+	}
+
+	InputEvent relative = event ;
+	relative.ticks -= m_StartTicks ;
+	m_Events.push_back(relative) ;
+}
+
+void InputReplay::Add(double ms, int type, int code, int x, int y)
+{
+	InputEvent event = { (long long)(ms * TimerFrequency() / 1000.0 + 0.5), type, code, x, y } ;
+	m_Events.push_back(event) ;
+	m_bStarted = true ;
+}
+
+void InputReplay::Clear()
+{
+	m_Events.clear() ;
+	m_StartTicks = 0 ;
+	m_bStarted = false ;
+	m_Next = 0 ;
+}
+
+bool InputReplay::Feed(InputQueue& queue, long long startTicks, long long elapsedTicks)
+{
+	while (m_Next < m_Events.size() && m_Events[m_Next].ticks <= elapsedTicks)
+	{
+		InputEvent event = m_Events[m_Next] ;
+		event.ticks += startTicks ;
+		if (!queue.Push(event))
+		{
+			// Full, the rest goes in with the next call
+			return true ;
+		}
+		++m_Next ;
+	}
+	return m_Next < m_Events.size() ;
+}
+
+bool InputReplay::Save(const char* path) const
+{
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	unsigned char header[8] ;
+	memcpy(header, REPLAY_TAG, 4) ;
+	PutU32(header + 4, (unsigned int)m_Events.size()) ;
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1 ;
+
+	for (size_t i = 0; i < m_Events.size() && ok; ++i)
+	{
+		const InputEvent& event = m_Events[i] ;
+		unsigned long long us = (unsigned long long)TicksToMicroseconds(event.ticks) ;
+		unsigned char record[RECORD_SIZE] ;
+		PutU32(record + 0, (unsigned int)us) ;
+		PutU32(record + 4, (unsigned int)(us >> 32)) ;
+		PutU32(record + 8, (unsigned int)event.type) ;
+		PutU32(record + 12, (unsigned int)event.code) ;
+		PutU32(record + 16, (unsigned int)event.x) ;
+		PutU32(record + 20, (unsigned int)event.y) ;
+		ok = fwrite(record, sizeof(record), 1, file) == 1 ;
+	}
+
+	return fclose(file) == 0 && ok ;
+}
+
+bool InputReplay::Load(const char* path)
+{
+	Clear() ;
+
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "rb") ;
+#else
+	file = fopen(path, "rb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	unsigned char header[8] ;
+	bool ok = fread(header, sizeof(header), 1, file) == 1 && memcmp(header, REPLAY_TAG, 4) == 0 ;
+	unsigned int count = ok ? GetU32(header + 4) : 0 ;
+
+	for (unsigned int i = 0; i < count && ok; ++i)
+	{
+		unsigned char record[RECORD_SIZE] ;
+		ok = fread(record, sizeof(record), 1, file) == 1 ;
+		if (ok)
+		{
+			long long us = (long long)(GetU32(record) | ((unsigned long long)GetU32(record + 4) << 32)) ;
+			InputEvent event = { MicrosecondsToTicks(us), (int)GetU32(record + 8), (int)GetU32(record + 12),
+								 (int)GetU32(record + 16), (int)GetU32(record + 20) } ;
+			m_Events.push_back(event) ;
+		}
+	}
+	fclose(file) ;
+
+	if (!ok)
+	{
+		Clear() ;
+		return false ;
+	}
+	m_bStarted = true ;
+	return true ;
+}
@@ -0,0 +1,56 @@
+#ifndef __INPUT_REPLAY_H__
+#define __INPUT_REPLAY_H__
+
+#include <stddef.h>
+#include <vector>
+
+#include "InputQueue.h"
+
+/*
+A recording of input events for replays and headless benchmarks.
+
+Set it as the recorder of an InputState to keep every event the simulation applied, or
+build one with Add. Times are kept relative to the start of the recording, so Feed can
+push the events into a queue as they come due in another run, and a scenario plays the
+same way at any frame rate when the simulation uses fixed steps.
+
+Save writes "INP1", the event count and the events with times in microseconds, all
+little endian, so a recording made on one machine replays on another.
+*/
+class InputReplay
+{
+public:
+	InputReplay(void);
+	~InputReplay(void);
+
+	// Start a new recording, times are relative to startTicks
+	void StartRecording(long long startTicks) ;
+
+	// Add an event at its own time, the first event starts the recording if nothing did
+	void Record(const InputEvent& event) ;
+
+	// Add an event at ms after the start, to write scenarios by hand
+	void Add(double ms, int type, int code, int x = 0, int y = 0) ;
+
+	void Clear() ;
+	size_t Count() const { return m_Events.size() ; }
+
+	// Event times are ticks since the start of the recording
+	const InputEvent& Event(size_t index) const { return m_Events[index] ; }
+
+	// Push the events due at elapsedTicks after the start of the replay, stamped with
+	// startTicks + their time. False once every event was pushed.
+	bool Feed(InputQueue& queue, long long startTicks, long long elapsedTicks) ;
+	void Rewind() { m_Next = 0 ; }
+
+	bool Save(const char* path) const ;
+	bool Load(const char* path) ;
+
+private:
+	std::vector<InputEvent> m_Events ;
+	long long m_StartTicks ;
+	bool m_bStarted ;
+	size_t m_Next ;				// next event to feed
+};
+
+#endif // end __INPUT_REPLAY_H__
@@ -0,0 +1,151 @@
+#include "InputSource.h"
+#include "../Utility/Timer.h"
+
+// Changes read per GetDeviceData call
+static const DWORD READ_BATCH = 64 ;
+
+// Ticks of an event stamped msTime by GetTickCount, DirectInput and window messages use it
+static long long EventTicks(DWORD msTime)
+{
+	DWORD age = GetTickCount() - msTime ;
+	return TimerTicks() - (long long)age * TimerFrequency() / 1000 ;
+}
+
+HRESULT EnableBufferedInput(LPDIRECTINPUTDEVICE8 pDevice, DWORD bufferSize)
+{
+	DIPROPDWORD property ;
+	property.diph.dwSize = sizeof(DIPROPDWORD) ;
+	property.diph.dwHeaderSize = sizeof(DIPROPHEADER) ;
+	property.diph.dwObj = 0 ;
+	property.diph.dwHow = DIPH_DEVICE ;
+	property.dwData = bufferSize ;
+	return pDevice->SetProperty(DIPROP_BUFFERSIZE, &property.diph) ;
+}
+
+// Read the buffer of a device in batches, call push for every change
+template <class PUSH>
+static HRESULT ReadDeviceEvents(LPDIRECTINPUTDEVICE8 pDevice, InputQueue& queue, PUSH push)
+{
+	HRESULT result = DI_OK ;
+	for (;;)
+	{
+		DIDEVICEOBJECTDATA data[READ_BATCH] ;
+		DWORD count = READ_BATCH ;
+		HRESULT hr = pDevice->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), data, &count, 0) ;
+		if (hr == DIERR_INPUTLOST || hr == DIERR_NOTACQUIRED)
+		{
+			// The up events of the keys held are lost with the rest
+			InputEvent event = { TimerTicks(), INPUT_RELEASE_ALL, 0, 0, 0 } ;
+			queue.Push(event) ;
+			pDevice->Acquire() ;
+			return DIERR_INPUTLOST ;
+		}
+		if (FAILED(hr))
+		{
+			return hr ;
+		}
+		if (hr == DI_BUFFEROVERFLOW)
+		{
+			result = DI_BUFFEROVERFLOW ;
+		}
+
+		for (DWORD i = 0; i < count; ++i)
+		{
+			push(data[i]) ;
+		}
+		if (count < READ_BATCH)
+		{
+			return result ;
+		}
+	}
+}
+
+HRESULT ReadKeyboardEvents(LPDIRECTINPUTDEVICE8 pKeyboard, InputQueue& queue)
+{
+	return ReadDeviceEvents(pKeyboard, queue, [&](const DIDEVICEOBJECTDATA& data)
+	{
+		InputEvent event = { EventTicks(data.dwTimeStamp), (data.dwData & 0x80) ? INPUT_KEY_DOWN : INPUT_KEY_UP,
+							 (int)data.dwOfs, 0, 0 } ;
+		queue.Push(event) ;
+	}) ;
+}
+
+HRESULT ReadMouseEvents(LPDIRECTINPUTDEVICE8 pMouse, InputQueue& queue)
+{
+	return ReadDeviceEvents(pMouse, queue, [&](const DIDEVICEOBJECTDATA& data)
+	{
+		InputEvent event = { EventTicks(data.dwTimeStamp), INPUT_MOUSE_MOVE, 0, 0, 0 } ;
+		if (data.dwOfs == DIMOFS_X)
+		{
+			event.x = (int)data.dwData ;
+		}
+		else if (data.dwOfs == DIMOFS_Y)
+		{
+			event.y = (int)data.dwData ;
+		}
+		else if (data.dwOfs == DIMOFS_Z)
+		{
+			event.type = INPUT_WHEEL ;
+			event.x = (int)data.dwData ;
+		}
+		else if (data.dwOfs >= DIMOFS_BUTTON0 && data.dwOfs <= DIMOFS_BUTTON7)
+		{
+			event.type = (data.dwData & 0x80) ? INPUT_BUTTON_DOWN : INPUT_BUTTON_UP ;
+			event.code = (int)(data.dwOfs - DIMOFS_BUTTON0) ;
+		}
+		else
+		{
+			return ;
+		}
+		queue.Push(event) ;
+	}) ;
+}
+
+bool PushWindowMessage(InputQueue& queue, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	InputEvent event = { EventTicks(GetMessageTime()), 0, 0, 0, 0 } ;
+	switch (message)
+	{
+	case WM_KEYDOWN:
+	case WM_SYSKEYDOWN:
+	case WM_KEYUP:
+	case WM_SYSKEYUP:
+		// The scan code, with 0x80 for the extended keys as in DIK_RIGHT and friends
+		event.type = (message == WM_KEYDOWN || message == WM_SYSKEYDOWN) ? INPUT_KEY_DOWN : INPUT_KEY_UP ;
+		event.code = (int)((lParam >> 16) & 0xFF) | ((lParam & (1 << 24)) ? 0x80 : 0) ;
+		break ;
+
+	case WM_LBUTTONDOWN:	event.type = INPUT_BUTTON_DOWN ; event.code = 0 ; break ;
+	case WM_LBUTTONUP:		event.type = INPUT_BUTTON_UP ;	 event.code = 0 ; break ;
+	case WM_RBUTTONDOWN:	event.type = INPUT_BUTTON_DOWN ; event.code = 1 ; break ;
+	case WM_RBUTTONUP:		event.type = INPUT_BUTTON_UP ;	 event.code = 1 ; break ;
+	case WM_MBUTTONDOWN:	event.type = INPUT_BUTTON_DOWN ; event.code = 2 ; break ;
+	case WM_MBUTTONUP:		event.type = INPUT_BUTTON_UP ;	 event.code = 2 ; break ;
+
+	case WM_XBUTTONDOWN:
+	case WM_XBUTTONUP:
+		event.type = message == WM_XBUTTONDOWN ? INPUT_BUTTON_DOWN : INPUT_BUTTON_UP ;
+		event.code = HIWORD(wParam) == XBUTTON1 ? 3 : 4 ;
+		break ;
+
+	case WM_MOUSEMOVE:
+		event.type = INPUT_MOUSE_POSITION ;
+		event.x = (short)LOWORD(lParam) ;
+		event.y = (short)HIWORD(lParam) ;
+		break ;
+
+	case WM_MOUSEWHEEL:
+		event.type = INPUT_WHEEL ;
+		event.x = (short)HIWORD(wParam) ;
+		break ;
+
+	case WM_KILLFOCUS:
+		event.type = INPUT_RELEASE_ALL ;
+		break ;
+
+	default:
+		return false ;
+	}
+
+	return queue.Push(event) ;
+}
@@ -0,0 +1,35 @@
+#ifndef __INPUT_SOURCE_H__
+#define __INPUT_SOURCE_H__
+
+#include <windows.h>
+#include <dinput.h>
+
+#include "InputQueue.h"
+
+/*
+Windows sources of InputEvents.
+
+DirectInput devices in buffered mode keep every change with a time stamp until it is
+read, up to the buffer size, instead of the state at the moment GetDeviceState is
+called. Enable it with EnableBufferedInput after SetDataFormat and before Acquire, then
+read the changes into a queue once per step. A device that lost its input is acquired
+again and the read returns DIERR_INPUTLOST; the changes in between are gone, so it
+pushes an INPUT_RELEASE_ALL.
+
+PushWindowMessage turns keyboard and mouse messages into events for a window that
+takes its input from WndProc, with the scan code as the key so the DIK_ codes apply.
+*/
+
+static const DWORD DIRECTINPUT_BUFFER_SIZE = 256 ;
+
+HRESULT EnableBufferedInput(LPDIRECTINPUTDEVICE8 pDevice, DWORD bufferSize = DIRECTINPUT_BUFFER_SIZE) ;
+
+// Push the buffered changes of a keyboard (c_dfDIKeyboard) or mouse (c_dfDIMouse2).
+// DI_BUFFEROVERFLOW when the buffer was full and changes were lost.
+HRESULT ReadKeyboardEvents(LPDIRECTINPUTDEVICE8 pKeyboard, InputQueue& queue) ;
+HRESULT ReadMouseEvents(LPDIRECTINPUTDEVICE8 pMouse, InputQueue& queue) ;
+
+// Push the event of a message, false if it is not about input
+bool PushWindowMessage(InputQueue& queue, UINT message, WPARAM wParam, LPARAM lParam) ;
+
+#endif // end __INPUT_SOURCE_H__
@@ -0,0 +1,317 @@
+#ifndef __FLOAT4_H__
+#define __FLOAT4_H__
+
+#include <math.h>
+
+#include "../Utility/Simd.h"
+
+/*
+Four floats in one register, the backend of the math library.
+
+An __m128 with SSE2, a float32x4_t with NEON and a plain struct otherwise, all used
+through the same inline functions, so Vector.h, Matrix.h and Geometry.h are written
+once. The scalar path does the same operations in the same order, the results only
+differ where the compiler contracts a multiply and an add into one instruction.
+*/
+
+#if defined(SIMD_SSE2)
+typedef __m128 Float4 ;
+#elif defined(SIMD_NEON)
+typedef float32x4_t Float4 ;
+#else
+struct Float4
+{
+	float v[4] ;
+} ;
+#endif
+
+inline Float4 Float4Set(float x, float y, float z, float w)
+{
+#if defined(SIMD_SSE2)
+	return _mm_setr_ps(x, y, z, w) ;
+#elif defined(SIMD_NEON)
+	float values[4] = { x, y, z, w } ;
+	return vld1q_f32(values) ;
+#else
+	Float4 r = { { x, y, z, w } } ;
+	return r ;
+#endif
+}
+
+inline Float4 Float4Splat(float value)
+{
+#if defined(SIMD_SSE2)
+	return _mm_set1_ps(value) ;
+#elif defined(SIMD_NEON)
+	return vdupq_n_f32(value) ;
+#else
+	return Float4Set(value, value, value, value) ;
+#endif
+}
+
+inline Float4 Float4Zero()
+{
+	return Float4Splat(0.0f) ;
+}
+
+// p needs no alignment
+inline Float4 Float4Load(const float* p)
+{
+#if defined(SIMD_SSE2)
+	return _mm_loadu_ps(p) ;
+#elif defined(SIMD_NEON)
+	return vld1q_f32(p) ;
+#else
+	return Float4Set(p[0], p[1], p[2], p[3]) ;
+#endif
+}
+
+inline void Float4Store(float* p, Float4 a)
+{
+#if defined(SIMD_SSE2)
+	_mm_storeu_ps(p, a) ;
+#elif defined(SIMD_NEON)
+	vst1q_f32(p, a) ;
+#else
+	p[0] = a.v[0] ;
+	p[1] = a.v[1] ;
+	p[2] = a.v[2] ;
+	p[3] = a.v[3] ;
+#endif
+}
+
+inline Float4 Float4Add(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_add_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vaddq_f32(a, b) ;
+#else
+	return Float4Set(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]) ;
+#endif
+}
+
+inline Float4 Float4Sub(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_sub_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vsubq_f32(a, b) ;
+#else
+	return Float4Set(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]) ;
+#endif
+}
+
+inline Float4 Float4Mul(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_mul_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vmulq_f32(a, b) ;
+#else
+	return Float4Set(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]) ;
+#endif
+}
+
+inline Float4 Float4Div(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_div_ps(a, b) ;
+#elif defined(SIMD_NEON) && defined(__aarch64__)
+	return vdivq_f32(a, b) ;
+#else
+	float x[4], y[4] ;
+	Float4Store(x, a) ;
+	Float4Store(y, b) ;
+	return Float4Set(x[0] / y[0], x[1] / y[1], x[2] / y[2], x[3] / y[3]) ;
+#endif
+}
+
+inline Float4 Float4Sqrt(Float4 a)
+{
+#if defined(SIMD_SSE2)
+	return _mm_sqrt_ps(a) ;
+#elif defined(SIMD_NEON) && defined(__aarch64__)
+	return vsqrtq_f32(a) ;
+#else
+	float x[4] ;
+	Float4Store(x, a) ;
+	return Float4Set(sqrtf(x[0]), sqrtf(x[1]), sqrtf(x[2]), sqrtf(x[3])) ;
+#endif
+}
+
+// a * b + c, as a multiply then an add so the result is the same on every backend
+inline Float4 Float4MulAdd(Float4 a, Float4 b, Float4 c)
+{
+	return Float4Add(Float4Mul(a, b), c) ;
+}
+
+inline Float4 Float4Min(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_min_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vminq_f32(a, b) ;
+#else
+	return Float4Set(a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+					 a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]) ;
+#endif
+}
+
+inline Float4 Float4Max(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_max_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vmaxq_f32(a, b) ;
+#else
+	return Float4Set(a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+					 a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]) ;
+#endif
+}
+
+/*
+Comparisons give a mask per lane to combine with Float4And and to pick lanes with
+Float4Select. What a mask holds depends on the backend, only these functions read it.
+*/
+inline Float4 Float4Less(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_cmplt_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vreinterpretq_f32_u32(vcltq_f32(a, b)) ;
+#else
+	return Float4Set(a.v[0] < b.v[0] ? 1.0f : 0.0f, a.v[1] < b.v[1] ? 1.0f : 0.0f,
+					 a.v[2] < b.v[2] ? 1.0f : 0.0f, a.v[3] < b.v[3] ? 1.0f : 0.0f) ;
+#endif
+}
+
+inline Float4 Float4LessEqual(Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_cmple_ps(a, b) ;
+#elif defined(SIMD_NEON)
+	return vreinterpretq_f32_u32(vcleq_f32(a, b)) ;
+#else
+	return Float4Set(a.v[0] <= b.v[0] ? 1.0f : 0.0f, a.v[1] <= b.v[1] ? 1.0f : 0.0f,
+					 a.v[2] <= b.v[2] ? 1.0f : 0.0f, a.v[3] <= b.v[3] ? 1.0f : 0.0f) ;
+#endif
+}
+
+inline Float4 Float4And(Float4 mask1, Float4 mask2)
+{
+#if defined(SIMD_SSE2)
+	return _mm_and_ps(mask1, mask2) ;
+#elif defined(SIMD_NEON)
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(mask1), vreinterpretq_u32_f32(mask2))) ;
+#else
+	return Float4Mul(mask1, mask2) ;
+#endif
+}
+
+// a where the mask is set, b elsewhere
+inline Float4 Float4Select(Float4 mask, Float4 a, Float4 b)
+{
+#if defined(SIMD_SSE2)
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)) ;
+#elif defined(SIMD_NEON)
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b) ;
+#else
+	return Float4Set(mask.v[0] != 0.0f ? a.v[0] : b.v[0], mask.v[1] != 0.0f ? a.v[1] : b.v[1],
+					 mask.v[2] != 0.0f ? a.v[2] : b.v[2], mask.v[3] != 0.0f ? a.v[3] : b.v[3]) ;
+#endif
+}
+
+// Bit i is set when lane i of the mask is
+inline int Float4MoveMask(Float4 mask)
+{
+#if defined(SIMD_SSE2)
+	return _mm_movemask_ps(mask) ;
+#elif defined(SIMD_NEON)
+	uint32x4_t bits = vshrq_n_u32(vreinterpretq_u32_f32(mask), 31) ;
+	return (int)(vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1) << 1) |
+				 (vgetq_lane_u32(bits, 2) << 2) | (vgetq_lane_u32(bits, 3) << 3)) ;
+#else
+	return (mask.v[0] != 0.0f ? 1 : 0) | (mask.v[1] != 0.0f ? 2 : 0) | (mask.v[2] != 0.0f ? 4 : 0) | (mask.v[3] != 0.0f ? 8 : 0) ;
+#endif
+}
+
+inline float Float4X(Float4 a)
+{
+#if defined(SIMD_SSE2)
+	return _mm_cvtss_f32(a) ;
+#elif defined(SIMD_NEON)
+	return vgetq_lane_f32(a, 0) ;
+#else
+	return a.v[0] ;
+#endif
+}
+
+// Sum of the four lanes
+inline float Float4Sum(Float4 a)
+{
+#if defined(SIMD_SSE2)
+	__m128 pairs = _mm_add_ps(a, _mm_movehl_ps(a, a)) ;
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1))) ;
+#else
+	float x[4] ;
+	Float4Store(x, a) ;
+	return (x[0] + x[2]) + (x[1] + x[3]) ;
+#endif
+}
+
+/*
+Convert four packed 3 float vectors (x0 y0 z0 x1 y1 z1 ...) to one register per
+component and back, for the loops over vertex arrays. p needs no alignment.
+*/
+inline void Float4LoadXYZ(const float* p, Float4& x, Float4& y, Float4& z)
+{
+#if defined(SIMD_SSE2)
+	__m128 a0 = _mm_loadu_ps(p) ;		// x0 y0 z0 x1
+	__m128 a1 = _mm_loadu_ps(p + 4) ;	// y1 z1 x2 y2
+	__m128 a2 = _mm_loadu_ps(p + 8) ;	// z2 x3 y3 z3
+	x = _mm_shuffle_ps(a0, _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0)) ;
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(a1, a2, _MM_SHUFFLE(2, 2, 3, 3)),
+					   _MM_SHUFFLE(2, 0, 2, 0)) ;
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 1, 2, 2)), a2, _MM_SHUFFLE(3, 0, 2, 0)) ;
+#elif defined(SIMD_NEON)
+	float32x4x3_t v = vld3q_f32(p) ;
+	x = v.val[0] ;
+	y = v.val[1] ;
+	z = v.val[2] ;
+#else
+	x = Float4Set(p[0], p[3], p[6], p[9]) ;
+	y = Float4Set(p[1], p[4], p[7], p[10]) ;
+	z = Float4Set(p[2], p[5], p[8], p[11]) ;
+#endif
+}
+
+inline void Float4StoreXYZ(float* p, Float4 x, Float4 y, Float4 z)
+{
+#if defined(SIMD_SSE2)
+	__m128 b0 = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)),
+							   _MM_SHUFFLE(2, 0, 2, 0)) ;
+	__m128 b1 = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),
+							   _MM_SHUFFLE(2, 0, 2, 0)) ;
+	__m128 b2 = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),
+							   _MM_SHUFFLE(2, 0, 2, 0)) ;
+	_mm_storeu_ps(p, b0) ;
+	_mm_storeu_ps(p + 4, b1) ;
+	_mm_storeu_ps(p + 8, b2) ;
+#elif defined(SIMD_NEON)
+	float32x4x3_t v ;
+	v.val[0] = x ;
+	v.val[1] = y ;
+	v.val[2] = z ;
+	vst3q_f32(p, v) ;
+#else
+	for (int i = 0; i < 4; ++i)
+	{
+		p[i * 3 + 0] = x.v[i] ;
+		p[i * 3 + 1] = y.v[i] ;
+		p[i * 3 + 2] = z.v[i] ;
+	}
+#endif
+}
+
+#endif // end __FLOAT4_H__
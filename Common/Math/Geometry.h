@@ -0,0 +1,308 @@
+#ifndef __GEOMETRY_H__
+#define __GEOMETRY_H__
+
+#include <float.h>
+
+#include "Matrix.h"
+
+/*
+Planes, rays and axis aligned boxes, and the tests between them that picking and
+culling need.
+
+Plane3 is a, b, c, d like D3DXPLANE, the points p with a*x + b*y + c*z + d = 0, the
+normal points to the front. Everything is passed by reference and nothing is built on
+the way: RayTriangle takes the three corners, so a quad is two calls on its corners
+instead of two Triangle temporaries.
+*/
+
+struct Plane3
+{
+	float a ;
+	float b ;
+	float c ;
+	float d ;
+
+	Plane3() {}
+	Plane3(float a, float b, float c, float d) : a(a), b(b), c(c), d(d) {}
+
+	Vec3 Normal() const { return Vec3(a, b, c) ; }
+} ;
+
+struct Ray3
+{
+	Vec3 origin ;
+	Vec3 direction ;
+
+	Ray3() {}
+	Ray3(const Vec3& origin, const Vec3& direction) : origin(origin), direction(direction) {}
+
+	Vec3 Point(float t) const { return origin + direction * t ; }
+} ;
+
+struct Aabb3
+{
+	Vec3 minPoint ;
+	Vec3 maxPoint ;
+
+	Aabb3() {}
+	Aabb3(const Vec3& minPoint, const Vec3& maxPoint) : minPoint(minPoint), maxPoint(maxPoint) {}
+
+	Vec3 Center() const { return (minPoint + maxPoint) * 0.5f ; }
+	Vec3 Extent() const { return (maxPoint - minPoint) * 0.5f ; }
+
+	// Corner i has the max x when bit 0 is set, max y for bit 1, max z for bit 2
+	Vec3 Corner(int i) const
+	{
+		return Vec3((i & 1) ? maxPoint.x : minPoint.x, (i & 2) ? maxPoint.y : minPoint.y, (i & 4) ? maxPoint.z : minPoint.z) ;
+	}
+} ;
+
+inline Plane3 PlaneFromPointNormal(const Vec3& point, const Vec3& normal)
+{
+	return Plane3(normal.x, normal.y, normal.z, -Vec3Dot(point, normal)) ;
+}
+
+// The plane through three points, the front is where p0, p1, p2 run clockwise
+inline Plane3 PlaneFromPoints(const Vec3& p0, const Vec3& p1, const Vec3& p2)
+{
+	return PlaneFromPointNormal(p0, Vec3Normalize(Vec3Cross(p1 - p0, p2 - p0))) ;
+}
+
+inline Plane3 PlaneNormalize(const Plane3& plane)
+{
+	float length = Vec3Length(plane.Normal()) ;
+	if (length <= 0.0f)
+	{
+		return plane ;
+	}
+	float inv = 1.0f / length ;
+	return Plane3(plane.a * inv, plane.b * inv, plane.c * inv, plane.d * inv) ;
+}
+
+// Signed distance of a point, scaled by the length of the normal
+inline float PlaneDotCoord(const Plane3& plane, const Vec3& p)
+{
+	return plane.a * p.x + plane.b * p.y + plane.c * p.z + plane.d ;
+}
+
+inline float PlaneDotNormal(const Plane3& plane, const Vec3& v)
+{
+	return plane.a * v.x + plane.b * v.y + plane.c * v.z ;
+}
+
+// PlaneDotCoord of count points into distances
+inline void PlaneDotCoordArray(const Plane3& plane, const Vec3* points, size_t count, float* distances)
+{
+	size_t i = 0 ;
+
+	Float4 a = Float4Splat(plane.a) ;
+	Float4 b = Float4Splat(plane.b) ;
+	Float4 c = Float4Splat(plane.c) ;
+	Float4 d = Float4Splat(plane.d) ;
+	for (; i + 4 <= count; i += 4)
+	{
+		Float4 x, y, z ;
+		Float4LoadXYZ(&points[i].x, x, y, z) ;
+		Float4 sum = Float4Mul(a, x) ;
+		sum = Float4MulAdd(b, y, sum) ;
+		sum = Float4MulAdd(c, z, sum) ;
+		Float4Store(distances + i, Float4Add(sum, d)) ;
+	}
+
+	for (; i < count; ++i)
+	{
+		distances[i] = PlaneDotCoord(plane, points[i]) ;
+	}
+}
+
+// 1 when the box is in front of the plane, -1 behind it, 0 when the plane cuts it
+inline int PlaneAabbSide(const Plane3& plane, const Aabb3& box)
+{
+	// Only the corners farthest along and against the normal matter
+	Vec3 center = box.Center() ;
+	Vec3 extent = box.Extent() ;
+	float distance = PlaneDotCoord(plane, center) ;
+	float radius = extent.x * fabsf(plane.a) + extent.y * fabsf(plane.b) + extent.z * fabsf(plane.c) ;
+	if (distance - radius > 0.0f)
+	{
+		return 1 ;
+	}
+	if (distance + radius <= 0.0f)
+	{
+		return -1 ;
+	}
+	return 0 ;
+}
+
+// The box around count points, an empty box (minPoint > maxPoint) for none
+inline Aabb3 AabbFromPoints(const Vec3* points, size_t count)
+{
+	Aabb3 box(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX)) ;
+	size_t i = 0 ;
+
+	if (count >= 4)
+	{
+		Float4 minX = Float4Splat(FLT_MAX), minY = minX, minZ = minX ;
+		Float4 maxX = Float4Splat(-FLT_MAX), maxY = maxX, maxZ = maxX ;
+		for (; i + 4 <= count; i += 4)
+		{
+			Float4 x, y, z ;
+			Float4LoadXYZ(&points[i].x, x, y, z) ;
+			minX = Float4Min(minX, x) ;
+			minY = Float4Min(minY, y) ;
+			minZ = Float4Min(minZ, z) ;
+			maxX = Float4Max(maxX, x) ;
+			maxY = Float4Max(maxY, y) ;
+			maxZ = Float4Max(maxZ, z) ;
+		}
+
+		Vec3 lanes[4] ;
+		Float4StoreXYZ(&lanes[0].x, minX, minY, minZ) ;
+		for (int k = 0; k < 4; ++k)
+		{
+			box.minPoint = Vec3Min(box.minPoint, lanes[k]) ;
+		}
+		Float4StoreXYZ(&lanes[0].x, maxX, maxY, maxZ) ;
+		for (int k = 0; k < 4; ++k)
+		{
+			box.maxPoint = Vec3Max(box.maxPoint, lanes[k]) ;
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		box.minPoint = Vec3Min(box.minPoint, points[i]) ;
+		box.maxPoint = Vec3Max(box.maxPoint, points[i]) ;
+	}
+	return box ;
+}
+
+// The box around the transformed box, without transforming the eight corners
+inline Aabb3 AabbTransform(const Aabb3& box, const Mat4& m)
+{
+	Vec3 center = Vec3TransformCoord(box.Center(), m) ;
+	Vec3 extent = box.Extent() ;
+	Vec3 radius(fabsf(m.m[0][0]) * extent.x + fabsf(m.m[1][0]) * extent.y + fabsf(m.m[2][0]) * extent.z,
+				fabsf(m.m[0][1]) * extent.x + fabsf(m.m[1][1]) * extent.y + fabsf(m.m[2][1]) * extent.z,
+				fabsf(m.m[0][2]) * extent.x + fabsf(m.m[1][2]) * extent.y + fabsf(m.m[2][2]) * extent.z) ;
+	return Aabb3(center - radius, center + radius) ;
+}
+
+/*
+Moller-Trumbore, both sides of the triangle hit. On a hit t is the distance along the
+ray in units of its direction, t >= 0, and the point is (1 - u - v) * v0 + u * v1 +
+v * v2.
+*/
+inline bool RayTriangle(const Ray3& ray, const Vec3& v0, const Vec3& v1, const Vec3& v2, float& t, float& u, float& v)
+{
+	Vec3 edge1 = v1 - v0 ;
+	Vec3 edge2 = v2 - v0 ;
+	Vec3 p = Vec3Cross(ray.direction, edge2) ;
+	float determinant = Vec3Dot(edge1, p) ;
+
+	// Keep the determinant positive, so the tests below compare without dividing and
+	// only a hit pays for the division
+	Vec3 s = ray.origin - v0 ;
+	if (determinant < 0.0f)
+	{
+		determinant = -determinant ;
+		s = -s ;
+	}
+
+	// Parallel to the plane of the triangle
+	if (determinant < MATH_EPSILON * MATH_EPSILON)
+	{
+		return false ;
+	}
+
+	float hitU = Vec3Dot(s, p) ;
+	if (hitU < 0.0f || hitU > determinant)
+	{
+		return false ;
+	}
+
+	Vec3 q = Vec3Cross(s, edge1) ;
+	float hitV = Vec3Dot(ray.direction, q) ;
+	if (hitV < 0.0f || hitU + hitV > determinant)
+	{
+		return false ;
+	}
+
+	float hitT = Vec3Dot(edge2, q) ;
+	if (hitT < 0.0f)
+	{
+		return false ;
+	}
+
+	float inv = 1.0f / determinant ;
+	t = hitT * inv ;
+	u = hitU * inv ;
+	v = hitV * inv ;
+	return true ;
+}
+
+// A quad given by its corners in order around it, as the triangles v0 v1 v2 and v0 v2 v3
+inline bool RayQuad(const Ray3& ray, const Vec3& v0, const Vec3& v1, const Vec3& v2, const Vec3& v3, float& t)
+{
+	float u, v ;
+	return RayTriangle(ray, v0, v1, v2, t, u, v) || RayTriangle(ray, v0, v2, v3, t, u, v) ;
+}
+
+// Slab test, tNear is where the ray enters the box, 0 when it starts inside
+inline bool RayAabb(const Ray3& ray, const Aabb3& box, float& tNear)
+{
+	float nearest = 0.0f ;
+	float farthest = FLT_MAX ;
+	const float* origin = &ray.origin.x ;
+	const float* direction = &ray.direction.x ;
+	const float* low = &box.minPoint.x ;
+	const float* high = &box.maxPoint.x ;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (fabsf(direction[i]) < MATH_EPSILON * MATH_EPSILON)
+		{
+			if (origin[i] < low[i] || origin[i] > high[i])
+			{
+				return false ;
+			}
+			continue ;
+		}
+
+		float inv = 1.0f / direction[i] ;
+		float t0 = (low[i] - origin[i]) * inv ;
+		float t1 = (high[i] - origin[i]) * inv ;
+		if (t0 > t1)
+		{
+			float swap = t0 ;
+			t0 = t1 ;
+			t1 = swap ;
+		}
+		nearest = t0 > nearest ? t0 : nearest ;
+		farthest = t1 < farthest ? t1 : farthest ;
+		if (nearest > farthest)
+		{
+			return false ;
+		}
+	}
+	tNear = nearest ;
+	return true ;
+}
+
+// False when the ray runs parallel to the plane or away from it
+inline bool RayPlane(const Ray3& ray, const Plane3& plane, float& t)
+{
+	float along = PlaneDotNormal(plane, ray.direction) ;
+	if (fabsf(along) < MATH_EPSILON * MATH_EPSILON)
+	{
+		return false ;
+	}
+	float hit = -PlaneDotCoord(plane, ray.origin) / along ;
+	if (hit < 0.0f)
+	{
+		return false ;
+	}
+	t = hit ;
+	return true ;
+}
+
+#endif // end __GEOMETRY_H__
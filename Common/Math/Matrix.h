@@ -0,0 +1,263 @@
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include "Vector.h"
+
+/*
+4 x 4 float matrix with the conventions of D3DX: row major, vectors are rows that
+multiply from the left (v * M), the translation is in the last row and the view and
+projection matrices are left handed. A Mat4 has the layout of D3DXMATRIX and
+XMFLOAT4X4 and can be handed to SetTransform or a constant buffer as it is.
+
+Products are computed a row at a time with Float4. Vec3TransformCoordArray transforms
+four points per iteration with one register per component, the loop to use for
+vertex buffers and bounding boxes instead of calling Vec3TransformCoord per point.
+*/
+struct Mat4
+{
+	float m[4][4] ;
+
+	Mat4() {}
+	explicit Mat4(const float* p) { memcpy(m, p, sizeof(m)) ; }
+	Mat4(float m00, float m01, float m02, float m03,
+		 float m10, float m11, float m12, float m13,
+		 float m20, float m21, float m22, float m23,
+		 float m30, float m31, float m32, float m33)
+	{
+		m[0][0] = m00 ; m[0][1] = m01 ; m[0][2] = m02 ; m[0][3] = m03 ;
+		m[1][0] = m10 ; m[1][1] = m11 ; m[1][2] = m12 ; m[1][3] = m13 ;
+		m[2][0] = m20 ; m[2][1] = m21 ; m[2][2] = m22 ; m[2][3] = m23 ;
+		m[3][0] = m30 ; m[3][1] = m31 ; m[3][2] = m32 ; m[3][3] = m33 ;
+	}
+
+	Float4 Row(int i) const { return Float4Load(m[i]) ; }
+} ;
+
+inline Mat4 Mat4Identity()
+{
+	return Mat4(1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+// a then b, D3DXMatrixMultiply(&r, &a, &b)
+inline Mat4 Mat4Multiply(const Mat4& a, const Mat4& b)
+{
+	Float4 b0 = b.Row(0) ;
+	Float4 b1 = b.Row(1) ;
+	Float4 b2 = b.Row(2) ;
+	Float4 b3 = b.Row(3) ;
+
+	Mat4 r ;
+	for (int i = 0; i < 4; ++i)
+	{
+		Float4 row = Float4Mul(Float4Splat(a.m[i][0]), b0) ;
+		row = Float4MulAdd(Float4Splat(a.m[i][1]), b1, row) ;
+		row = Float4MulAdd(Float4Splat(a.m[i][2]), b2, row) ;
+		row = Float4MulAdd(Float4Splat(a.m[i][3]), b3, row) ;
+		Float4Store(r.m[i], row) ;
+	}
+	return r ;
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	return Mat4Multiply(a, b) ;
+}
+
+inline Mat4 Mat4Transpose(const Mat4& a)
+{
+	return Mat4(a.m[0][0], a.m[1][0], a.m[2][0], a.m[3][0],
+				a.m[0][1], a.m[1][1], a.m[2][1], a.m[3][1],
+				a.m[0][2], a.m[1][2], a.m[2][2], a.m[3][2],
+				a.m[0][3], a.m[1][3], a.m[2][3], a.m[3][3]) ;
+}
+
+// Return false and leave result alone when a has no inverse
+inline bool Mat4Inverse(const Mat4& a, Mat4& result)
+{
+	const float* m = &a.m[0][0] ;
+	float inv[16] ;
+
+	// Cofactors of the transposed matrix
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10] ;
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10] ;
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9] ;
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9] ;
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10] ;
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10] ;
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9] ;
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9] ;
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6] ;
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6] ;
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5] ;
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5] ;
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6] ;
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6] ;
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5] ;
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5] ;
+
+	float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12] ;
+	if (determinant == 0.0f)
+	{
+		return false ;
+	}
+
+	Float4 scale = Float4Splat(1.0f / determinant) ;
+	for (int i = 0; i < 4; ++i)
+	{
+		Float4Store(result.m[i], Float4Mul(Float4Load(inv + i * 4), scale)) ;
+	}
+	return true ;
+}
+
+inline Mat4 Mat4Translation(float x, float y, float z)
+{
+	return Mat4(1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				x, y, z, 1.0f) ;
+}
+
+inline Mat4 Mat4Scaling(float x, float y, float z)
+{
+	return Mat4(x, 0.0f, 0.0f, 0.0f,
+				0.0f, y, 0.0f, 0.0f,
+				0.0f, 0.0f, z, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+inline Mat4 Mat4RotationX(float angle)
+{
+	float c = cosf(angle) ;
+	float s = sinf(angle) ;
+	return Mat4(1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, c, s, 0.0f,
+				0.0f, -s, c, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+inline Mat4 Mat4RotationY(float angle)
+{
+	float c = cosf(angle) ;
+	float s = sinf(angle) ;
+	return Mat4(c, 0.0f, -s, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				s, 0.0f, c, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+inline Mat4 Mat4RotationZ(float angle)
+{
+	float c = cosf(angle) ;
+	float s = sinf(angle) ;
+	return Mat4(c, s, 0.0f, 0.0f,
+				-s, c, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+// Rotation by angle around axis, clockwise looking along the axis like D3DXMatrixRotationAxis
+inline Mat4 Mat4RotationAxis(const Vec3& axis, float angle)
+{
+	Vec3 n = Vec3Normalize(axis) ;
+	float c = cosf(angle) ;
+	float s = sinf(angle) ;
+	float t = 1.0f - c ;
+	return Mat4(t * n.x * n.x + c, t * n.x * n.y + s * n.z, t * n.x * n.z - s * n.y, 0.0f,
+				t * n.x * n.y - s * n.z, t * n.y * n.y + c, t * n.y * n.z + s * n.x, 0.0f,
+				t * n.x * n.z + s * n.y, t * n.y * n.z - s * n.x, t * n.z * n.z + c, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+inline Mat4 Mat4LookAtLH(const Vec3& eye, const Vec3& at, const Vec3& up)
+{
+	Vec3 zAxis = Vec3Normalize(at - eye) ;
+	Vec3 xAxis = Vec3Normalize(Vec3Cross(up, zAxis)) ;
+	Vec3 yAxis = Vec3Cross(zAxis, xAxis) ;
+	return Mat4(xAxis.x, yAxis.x, zAxis.x, 0.0f,
+				xAxis.y, yAxis.y, zAxis.y, 0.0f,
+				xAxis.z, yAxis.z, zAxis.z, 0.0f,
+				-Vec3Dot(xAxis, eye), -Vec3Dot(yAxis, eye), -Vec3Dot(zAxis, eye), 1.0f) ;
+}
+
+inline Mat4 Mat4PerspectiveFovLH(float fovY, float aspect, float zNear, float zFar)
+{
+	float yScale = 1.0f / tanf(fovY * 0.5f) ;
+	float xScale = yScale / aspect ;
+	float depth = zFar / (zFar - zNear) ;
+	return Mat4(xScale, 0.0f, 0.0f, 0.0f,
+				0.0f, yScale, 0.0f, 0.0f,
+				0.0f, 0.0f, depth, 1.0f,
+				0.0f, 0.0f, -zNear * depth, 0.0f) ;
+}
+
+// (v, 1) * m divided by w
+inline Vec3 Vec3TransformCoord(const Vec3& v, const Mat4& m)
+{
+	float x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0] ;
+	float y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1] ;
+	float z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2] ;
+	float w = v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + m.m[3][3] ;
+	return Vec3(x / w, y / w, z / w) ;
+}
+
+// (v, 0) * m, for directions
+inline Vec3 Vec3TransformNormal(const Vec3& v, const Mat4& m)
+{
+	return Vec3(v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+				v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+				v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2]) ;
+}
+
+inline Vec4 Vec4Transform(const Vec4& v, const Mat4& m)
+{
+	Float4 r = Float4Mul(Float4Splat(v.x), m.Row(0)) ;
+	r = Float4MulAdd(Float4Splat(v.y), m.Row(1), r) ;
+	r = Float4MulAdd(Float4Splat(v.z), m.Row(2), r) ;
+	r = Float4MulAdd(Float4Splat(v.w), m.Row(3), r) ;
+	return Vec4(r) ;
+}
+
+// Vec3TransformCoord for count points, out may be in
+inline void Vec3TransformCoordArray(const Vec3* in, Vec3* out, size_t count, const Mat4& m)
+{
+	size_t i = 0 ;
+
+	// Column c of the matrix spread over four registers, one per row
+	Float4 columns[4][4] ;
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			columns[c][r] = Float4Splat(m.m[r][c]) ;
+		}
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		Float4 x, y, z ;
+		Float4LoadXYZ(&in[i].x, x, y, z) ;
+
+		Float4 result[4] ;
+		for (int c = 0; c < 4; ++c)
+		{
+			Float4 sum = Float4Mul(x, columns[c][0]) ;
+			sum = Float4MulAdd(y, columns[c][1], sum) ;
+			sum = Float4MulAdd(z, columns[c][2], sum) ;
+			result[c] = Float4Add(sum, columns[c][3]) ;
+		}
+		Float4StoreXYZ(&out[i].x, Float4Div(result[0], result[3]), Float4Div(result[1], result[3]), Float4Div(result[2], result[3])) ;
+	}
+
+	for (; i < count; ++i)
+	{
+		out[i] = Vec3TransformCoord(in[i], m) ;
+	}
+}
+
+#endif // end __MATRIX_H__
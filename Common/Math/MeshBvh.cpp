@@ -0,0 +1,506 @@
+#include "MeshBvh.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "../Utility/Timer.h"
+
+static const int BIN_COUNT = 16 ;
+
+// The cost of visiting a node, in packets tested
+static const float TRAVERSAL_COST = 1.0f ;
+
+// Below this depth the heuristic picks the splits, then they halve the triangles, which
+// keeps the depth under the size of the traversal stack for any triangle count
+static const int HEURISTIC_DEPTH = 32 ;
+static const int STACK_SIZE = 64 ;
+
+// A leaf the heuristic keeps whole, bigger ones are split whatever it costs
+static const float MAX_LEAF_PACKETS = 16.0f ;
+
+static const size_t PACKET_FLOATS = 9 * TRIANGLE_PACKET_SIZE ;
+
+static const char CACHE_MAGIC[4] = { 'B', 'V', 'H', '1' } ;
+static const unsigned int CACHE_VERSION = 1 ;
+
+struct CacheHeader
+{
+	char magic[4] ;
+	unsigned int version ;
+	unsigned long long meshHash ;
+	unsigned int packetSize ;
+	unsigned int triangles ;
+	unsigned int nodes ;
+	unsigned int packets ;
+	unsigned int leaves ;
+	unsigned int depth ;
+};
+
+static Aabb3 EmptyBox()
+{
+	return Aabb3(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX)) ;
+}
+
+static void GrowBox(Aabb3& box, const Aabb3& other)
+{
+	box.minPoint = Vec3Min(box.minPoint, other.minPoint) ;
+	box.maxPoint = Vec3Max(box.maxPoint, other.maxPoint) ;
+}
+
+// Half the surface area, the factor does not change which split is cheapest
+static float HalfArea(const Aabb3& box)
+{
+	Vec3 size = box.maxPoint - box.minPoint ;
+	return size.x * size.y + size.y * size.z + size.z * size.x ;
+}
+
+static float PacketCount(size_t triangles)
+{
+	return (float)((triangles + TRIANGLE_PACKET_SIZE - 1) / TRIANGLE_PACKET_SIZE) ;
+}
+
+static FILE* OpenFile(const char* path, const char* mode)
+{
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, mode) ;
+#else
+	file = fopen(path, mode) ;
+#endif
+	return file ;
+}
+
+MeshBvh::MeshBvh(void)
+{
+	Clear() ;
+}
+
+MeshBvh::~MeshBvh(void)
+{
+}
+
+void MeshBvh::Clear()
+{
+	m_Nodes.clear() ;
+	m_Packets.clear() ;
+	m_Ids.clear() ;
+	memset(&m_Stats, 0, sizeof(m_Stats)) ;
+}
+
+void MeshBvh::Build(const void* vertices, size_t stride, const unsigned short* indices, size_t triangleCount)
+{
+	BuildIndexed(vertices, stride, indices, triangleCount) ;
+}
+
+void MeshBvh::Build(const void* vertices, size_t stride, const unsigned int* indices, size_t triangleCount)
+{
+	BuildIndexed(vertices, stride, indices, triangleCount) ;
+}
+
+void MeshBvh::BuildCached(const char* cachePath, const void* vertices, size_t stride, const unsigned short* indices, size_t triangleCount)
+{
+	BuildCachedIndexed(cachePath, vertices, stride, indices, triangleCount) ;
+}
+
+void MeshBvh::BuildCached(const char* cachePath, const void* vertices, size_t stride, const unsigned int* indices, size_t triangleCount)
+{
+	BuildCachedIndexed(cachePath, vertices, stride, indices, triangleCount) ;
+}
+
+template <class Index>
+void MeshBvh::BuildIndexed(const void* vertices, size_t stride, const Index* indices, size_t triangleCount)
+{
+	Timer timer ;
+	Clear() ;
+	if (triangleCount == 0)
+	{
+		return ;
+	}
+
+	const char* base = static_cast<const char*>(vertices) ;
+	std::vector<BuildTriangle> triangles(triangleCount) ;
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		BuildTriangle& triangle = triangles[i] ;
+		triangle.v0 = Vec3(reinterpret_cast<const float*>(base + indices[i * 3] * stride)) ;
+		triangle.v1 = Vec3(reinterpret_cast<const float*>(base + indices[i * 3 + 1] * stride)) ;
+		triangle.v2 = Vec3(reinterpret_cast<const float*>(base + indices[i * 3 + 2] * stride)) ;
+		triangle.bounds.minPoint = Vec3Min(triangle.v0, Vec3Min(triangle.v1, triangle.v2)) ;
+		triangle.bounds.maxPoint = Vec3Max(triangle.v0, Vec3Max(triangle.v1, triangle.v2)) ;
+		triangle.center = triangle.bounds.Center() ;
+		triangle.id = (unsigned int)i ;
+	}
+
+	m_Nodes.reserve(triangleCount / TRIANGLE_PACKET_SIZE * 2 + 1) ;
+	m_Packets.reserve((triangleCount / TRIANGLE_PACKET_SIZE + 1) * PACKET_FLOATS) ;
+	BuildNode(triangles, 0, triangleCount, 1) ;
+
+	m_Stats.triangles = (int)triangleCount ;
+	m_Stats.nodes = (int)m_Nodes.size() ;
+	m_Stats.buildMs = timer.ElapsedMs() ;
+}
+
+int MeshBvh::BuildNode(std::vector<BuildTriangle>& triangles, size_t begin, size_t end, int depth)
+{
+	int index = (int)m_Nodes.size() ;
+	m_Nodes.push_back(Node()) ;
+	m_Stats.depth = depth > m_Stats.depth ? depth : m_Stats.depth ;
+
+	Aabb3 bounds = EmptyBox() ;
+	Aabb3 centers = EmptyBox() ;
+	for (size_t i = begin; i < end; ++i)
+	{
+		GrowBox(bounds, triangles[i].bounds) ;
+		GrowBox(centers, Aabb3(triangles[i].center, triangles[i].center)) ;
+	}
+	m_Nodes[index].bounds = bounds ;
+
+	size_t count = end - begin ;
+	if (count <= TRIANGLE_PACKET_SIZE)
+	{
+		AddLeaf(m_Nodes[index], triangles, begin, end) ;
+		return index ;
+	}
+
+	Vec3 size = centers.maxPoint - centers.minPoint ;
+	int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2) ;
+	float low = (&centers.minPoint.x)[axis] ;
+	float extent = (&size.x)[axis] ;
+
+	size_t middle = begin ;
+	if (extent > 0.0f && depth < HEURISTIC_DEPTH)
+	{
+		// Sort the triangles into bins by their centers and try a split between every two
+		struct Bin
+		{
+			Aabb3 bounds ;
+			size_t count ;
+		};
+		Bin bins[BIN_COUNT] ;
+		for (int i = 0; i < BIN_COUNT; ++i)
+		{
+			bins[i].bounds = EmptyBox() ;
+			bins[i].count = 0 ;
+		}
+
+		float scale = BIN_COUNT / extent ;
+		for (size_t i = begin; i < end; ++i)
+		{
+			int bin = (int)(((&triangles[i].center.x)[axis] - low) * scale) ;
+			bin = bin < BIN_COUNT ? bin : BIN_COUNT - 1 ;
+			GrowBox(bins[bin].bounds, triangles[i].bounds) ;
+			++bins[bin].count ;
+		}
+
+		// Left of split i are bins 0 to i
+		float leftArea[BIN_COUNT - 1] ;
+		size_t leftCount[BIN_COUNT - 1] ;
+		Aabb3 box = EmptyBox() ;
+		size_t sum = 0 ;
+		for (int i = 0; i < BIN_COUNT - 1; ++i)
+		{
+			GrowBox(box, bins[i].bounds) ;
+			sum += bins[i].count ;
+			leftArea[i] = sum > 0 ? HalfArea(box) : 0.0f ;
+			leftCount[i] = sum ;
+		}
+
+		int split = -1 ;
+		float splitCost = FLT_MAX ;
+		box = EmptyBox() ;
+		sum = 0 ;
+		for (int i = BIN_COUNT - 1; i > 0; --i)
+		{
+			GrowBox(box, bins[i].bounds) ;
+			sum += bins[i].count ;
+			if (sum == 0 || leftCount[i - 1] == 0)
+			{
+				continue ;
+			}
+			float cost = leftArea[i - 1] * PacketCount(leftCount[i - 1]) + HalfArea(box) * PacketCount(sum) ;
+			if (cost < splitCost)
+			{
+				splitCost = cost ;
+				split = i - 1 ;
+			}
+		}
+
+		// Costs relative to the area of this node, testing all its triangles against splitting
+		float area = HalfArea(bounds) ;
+		if (split < 0 || (PacketCount(count) <= MAX_LEAF_PACKETS && area * PacketCount(count) <= area * TRAVERSAL_COST + splitCost))
+		{
+			AddLeaf(m_Nodes[index], triangles, begin, end) ;
+			return index ;
+		}
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			int bin = (int)(((&triangles[i].center.x)[axis] - low) * scale) ;
+			bin = bin < BIN_COUNT ? bin : BIN_COUNT - 1 ;
+			if (bin <= split)
+			{
+				std::swap(triangles[i], triangles[middle]) ;
+				++middle ;
+			}
+		}
+	}
+
+	// Centers on top of each other or too deep for the heuristic, split the count in half
+	if (middle == begin || middle == end)
+	{
+		middle = begin + count / 2 ;
+		if (extent > 0.0f)
+		{
+			struct CenterLess
+			{
+				int axis ;
+				bool operator()(const BuildTriangle& a, const BuildTriangle& b) const
+				{
+					return (&a.center.x)[axis] < (&b.center.x)[axis] ;
+				}
+			} less = { axis } ;
+			std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end, less) ;
+		}
+	}
+
+	BuildNode(triangles, begin, middle, depth + 1) ;
+	int right = BuildNode(triangles, middle, end, depth + 1) ;
+
+	Node& node = m_Nodes[index] ;
+	node.offset = (unsigned int)right ;
+	node.packets = 0 ;
+	node.axis = (unsigned short)axis ;
+	return index ;
+}
+
+void MeshBvh::AddLeaf(Node& node, const std::vector<BuildTriangle>& triangles, size_t begin, size_t end)
+{
+	size_t firstPacket = m_Packets.size() / PACKET_FLOATS ;
+	size_t packets = (end - begin + TRIANGLE_PACKET_SIZE - 1) / TRIANGLE_PACKET_SIZE ;
+	node.offset = (unsigned int)firstPacket ;
+	node.packets = (unsigned short)packets ;
+	node.axis = 0 ;
+
+	m_Packets.resize(m_Packets.size() + packets * PACKET_FLOATS, 0.0f) ;
+	m_Ids.resize(m_Ids.size() + packets * TRIANGLE_PACKET_SIZE, TRIANGLE_NONE) ;
+	for (size_t i = begin; i < end; ++i)
+	{
+		size_t lane = firstPacket * TRIANGLE_PACKET_SIZE + (i - begin) ;
+		const BuildTriangle& triangle = triangles[i] ;
+		TrianglePacketSet(&m_Packets[lane / TRIANGLE_PACKET_SIZE * PACKET_FLOATS], lane % TRIANGLE_PACKET_SIZE,
+						  triangle.v0, triangle.v1, triangle.v2) ;
+		m_Ids[lane] = triangle.id ;
+	}
+	++m_Stats.leaves ;
+}
+
+bool MeshBvh::Intersect(const Ray3& ray, RayHit& hit, float maxT) const
+{
+	if (m_Nodes.empty())
+	{
+		return false ;
+	}
+
+	// A zero component gives a huge inverse instead of an infinite one, so a ray in the
+	// plane of a slab gives no 0 * infinity
+	const float* origin = &ray.origin.x ;
+	const float* direction = &ray.direction.x ;
+	float inverse[3] ;
+	for (int i = 0; i < 3; ++i)
+	{
+		inverse[i] = direction[i] != 0.0f ? 1.0f / direction[i] : FLT_MAX ;
+	}
+
+	TriangleLanesRay<TriangleLanes> lanes(ray) ;
+	float bestT = maxT ;
+	float bestU = 0.0f, bestV = 0.0f ;
+	size_t best = m_Ids.size() ;
+
+	int stack[STACK_SIZE] ;
+	int stackSize = 0 ;
+	int index = 0 ;
+	for (;;)
+	{
+		const Node& node = m_Nodes[index] ;
+
+		// Slab test, limited to the nearest hit so far
+		float nearest = 0.0f ;
+		float farthest = bestT ;
+		const float* low = &node.bounds.minPoint.x ;
+		const float* high = &node.bounds.maxPoint.x ;
+		for (int i = 0; i < 3; ++i)
+		{
+			float t0 = (low[i] - origin[i]) * inverse[i] ;
+			float t1 = (high[i] - origin[i]) * inverse[i] ;
+			nearest = std::max(nearest, std::min(t0, t1)) ;
+			farthest = std::min(farthest, std::max(t0, t1)) ;
+		}
+
+		if (nearest <= farthest)
+		{
+			if (node.packets > 0)
+			{
+				size_t lane = 0 ;
+				if (TrianglePacketsIntersect(&m_Packets[node.offset * PACKET_FLOATS], node.packets, lanes, bestT, bestU, bestV, lane))
+				{
+					best = node.offset * TRIANGLE_PACKET_SIZE + lane ;
+				}
+			}
+			else
+			{
+				int nearChild = index + 1 ;
+				int farChild = (int)node.offset ;
+				if (direction[node.axis] < 0.0f)
+				{
+					std::swap(nearChild, farChild) ;
+				}
+				stack[stackSize++] = farChild ;
+				index = nearChild ;
+				continue ;
+			}
+		}
+
+		if (stackSize == 0)
+		{
+			break ;
+		}
+		index = stack[--stackSize] ;
+	}
+
+	if (best == m_Ids.size())
+	{
+		return false ;
+	}
+	hit.t = bestT ;
+	hit.u = bestU ;
+	hit.v = bestV ;
+	hit.id = m_Ids[best] ;
+	return true ;
+}
+
+unsigned long long MeshBvh::HashMesh(const void* vertices, size_t stride, const void* indices, size_t indexSize, size_t triangleCount)
+{
+	// FNV-1a over the corner positions in index order, what the tree is built from
+	const char* base = static_cast<const char*>(vertices) ;
+	unsigned long long hash = 14695981039346656037ULL ;
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		size_t vertex = indexSize == 2 ? static_cast<const unsigned short*>(indices)[i] : static_cast<const unsigned int*>(indices)[i] ;
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(base + vertex * stride) ;
+		for (size_t j = 0; j < 3 * sizeof(float); ++j)
+		{
+			hash = (hash ^ bytes[j]) * 1099511628211ULL ;
+		}
+	}
+	return hash ^ triangleCount ;
+}
+
+template <class Index>
+void MeshBvh::BuildCachedIndexed(const char* cachePath, const void* vertices, size_t stride, const Index* indices, size_t triangleCount)
+{
+	Timer timer ;
+	unsigned long long hash = HashMesh(vertices, stride, indices, sizeof(Index), triangleCount) ;
+	if (Load(cachePath, hash))
+	{
+		m_Stats.buildMs = timer.ElapsedMs() ;
+		return ;
+	}
+
+	BuildIndexed(vertices, stride, indices, triangleCount) ;
+	Save(cachePath, hash) ;
+}
+
+bool MeshBvh::Save(const char* path, unsigned long long meshHash) const
+{
+	FILE* file = OpenFile(path, "wb") ;
+	if (!file)
+	{
+		return false ;
+	}
+
+	CacheHeader header ;
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic)) ;
+	header.version = CACHE_VERSION ;
+	header.meshHash = meshHash ;
+	header.packetSize = (unsigned int)TRIANGLE_PACKET_SIZE ;
+	header.triangles = (unsigned int)m_Stats.triangles ;
+	header.nodes = (unsigned int)m_Nodes.size() ;
+	header.packets = (unsigned int)(m_Packets.size() / PACKET_FLOATS) ;
+	header.leaves = (unsigned int)m_Stats.leaves ;
+	header.depth = (unsigned int)m_Stats.depth ;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 ;
+	if (written && !m_Nodes.empty())
+	{
+		written = fwrite(&m_Nodes[0], sizeof(Node), m_Nodes.size(), file) == m_Nodes.size() &&
+				  fwrite(&m_Packets[0], sizeof(float), m_Packets.size(), file) == m_Packets.size() &&
+				  fwrite(&m_Ids[0], sizeof(unsigned int), m_Ids.size(), file) == m_Ids.size() ;
+	}
+	return fclose(file) == 0 && written ;
+}
+
+bool MeshBvh::Load(const char* path, unsigned long long meshHash)
+{
+	Clear() ;
+	FILE* file = OpenFile(path, "rb") ;
+	if (!file)
+	{
+		return false ;
+	}
+
+	CacheHeader header ;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+				 memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+				 header.version == CACHE_VERSION &&
+				 header.meshHash == meshHash &&
+				 header.packetSize == TRIANGLE_PACKET_SIZE &&
+				 header.packets <= header.triangles &&
+				 header.nodes <= header.packets * 2 ;
+
+	// The sizes come from the file, check them against its length before allocating
+	long expected = (long)(sizeof(header) + header.nodes * sizeof(Node) + header.packets * (PACKET_FLOATS * sizeof(float) + TRIANGLE_PACKET_SIZE * sizeof(unsigned int))) ;
+	valid = valid && fseek(file, 0, SEEK_END) == 0 && ftell(file) == expected && fseek(file, sizeof(header), SEEK_SET) == 0 ;
+	if (valid && header.nodes > 0)
+	{
+		m_Nodes.resize(header.nodes) ;
+		m_Packets.resize(header.packets * PACKET_FLOATS) ;
+		m_Ids.resize(header.packets * TRIANGLE_PACKET_SIZE) ;
+		valid = fread(&m_Nodes[0], sizeof(Node), m_Nodes.size(), file) == m_Nodes.size() &&
+				fread(&m_Packets[0], sizeof(float), m_Packets.size(), file) == m_Packets.size() &&
+				fread(&m_Ids[0], sizeof(unsigned int), m_Ids.size(), file) == m_Ids.size() ;
+	}
+	fclose(file) ;
+
+	// The traversal trusts the links and the depth, a damaged file must not send it out
+	// of the arrays or the stack. Children come after their parent, so one pass sees
+	// the depth of a node before its children.
+	std::vector<int> depths(m_Nodes.size(), 1) ;
+	for (size_t i = 0; valid && i < m_Nodes.size(); ++i)
+	{
+		const Node& node = m_Nodes[i] ;
+		if (node.packets > 0)
+		{
+			valid = node.offset + node.packets <= header.packets ;
+			continue ;
+		}
+		valid = node.offset > i + 1 && node.offset < m_Nodes.size() && node.axis < 3 && depths[i] < STACK_SIZE ;
+		if (valid)
+		{
+			depths[i + 1] = depths[i] + 1 ;
+			depths[node.offset] = depths[i] + 1 ;
+		}
+	}
+	if (!valid)
+	{
+		Clear() ;
+		return false ;
+	}
+
+	m_Stats.triangles = (int)header.triangles ;
+	m_Stats.nodes = (int)header.nodes ;
+	m_Stats.leaves = (int)header.leaves ;
+	m_Stats.depth = (int)header.depth ;
+	m_Stats.fromCache = true ;
+	return true ;
+}
@@ -0,0 +1,107 @@
+#ifndef __MESH_BVH_H__
+#define __MESH_BVH_H__
+
+#include <vector>
+
+#include "TriangleBatch.h"
+
+struct MeshBvhStats
+{
+	int triangles ;
+	int nodes ;
+	int leaves ;
+	int depth ;				// the longest path from the root to a leaf
+	double buildMs ;		// build or cache load time
+	bool fromCache ;
+};
+
+/*
+Bounding volume hierarchy over the triangles of one mesh, for picking the exact
+triangle under a ray.
+
+Build splits the triangles with the surface area heuristic, evaluated on 16 bins along
+the longest axis of the triangle centers, and stops when a node holds no more than one
+triangle packet or when splitting costs more than testing all its triangles. The nodes
+are stored flat in depth first order: the left child follows its parent, the parent
+keeps the index of the right one. Every leaf starts a new TriangleBatch packet, so a
+leaf is tested with the packet kernel and usually in one go.
+
+Intersect walks the tree near child first and skips boxes that start beyond the nearest
+hit so far. Hits are those of RayTriangle, with the id the triangle had in the index
+list.
+
+Building a million triangles takes a good fraction of a second, so BuildCached keeps
+the tree in a file next to the mesh, tagged with a hash of the vertices and indices it
+was built from, and rebuilds only when the mesh or the packet size changed.
+*/
+class MeshBvh
+{
+public:
+	MeshBvh(void);
+	~MeshBvh(void);
+
+	void Clear() ;
+
+	// An indexed triangle list as TriangleBatch::AddIndexed takes it
+	void Build(const void* vertices, size_t stride, const unsigned short* indices, size_t triangleCount) ;
+	void Build(const void* vertices, size_t stride, const unsigned int* indices, size_t triangleCount) ;
+
+	// Load the tree from cachePath if it was built from the same mesh, otherwise build it and
+	// write the cache. A cache that cannot be written is not an error, the tree is built anyway.
+	void BuildCached(const char* cachePath, const void* vertices, size_t stride, const unsigned short* indices, size_t triangleCount) ;
+	void BuildCached(const char* cachePath, const void* vertices, size_t stride, const unsigned int* indices, size_t triangleCount) ;
+
+	// Write the tree with the HashMesh of the mesh it was built from
+	bool Save(const char* path, unsigned long long meshHash) const ;
+
+	// False and an empty tree when the file is missing, damaged or for another mesh
+	bool Load(const char* path, unsigned long long meshHash) ;
+
+	// The nearest hit with t below maxT
+	bool Intersect(const Ray3& ray, RayHit& hit, float maxT = FLT_MAX) const ;
+
+	bool IsEmpty() const { return m_Nodes.empty() ; }
+
+	const Aabb3& Bounds() const { return m_Nodes[0].bounds ; }
+
+	const MeshBvhStats& Stats() const { return m_Stats ; }
+
+	// Identifies the mesh a cache was built from
+	static unsigned long long HashMesh(const void* vertices, size_t stride, const void* indices, size_t indexSize, size_t triangleCount) ;
+
+private:
+	struct Node
+	{
+		Aabb3 bounds ;
+		unsigned int offset ;		// right child, or first packet of a leaf
+		unsigned short packets ;	// 0 for an inner node
+		unsigned short axis ;		// split axis, for the near child first order
+	};
+
+	struct BuildTriangle
+	{
+		Vec3 v0, v1, v2 ;
+		Vec3 center ;
+		Aabb3 bounds ;
+		unsigned int id ;
+	};
+
+	template <class Index>
+	void BuildIndexed(const void* vertices, size_t stride, const Index* indices, size_t triangleCount) ;
+
+	template <class Index>
+	void BuildCachedIndexed(const char* cachePath, const void* vertices, size_t stride, const Index* indices, size_t triangleCount) ;
+
+	int BuildNode(std::vector<BuildTriangle>& triangles, size_t begin, size_t end, int depth) ;
+	void AddLeaf(Node& node, const std::vector<BuildTriangle>& triangles, size_t begin, size_t end) ;
+
+	std::vector<Node> m_Nodes ;
+	std::vector<float> m_Packets ;		// TRIANGLE_PACKET_SIZE triangles each, as in TriangleBatch
+	std::vector<unsigned int> m_Ids ;	// one per lane, unused lanes hold TRIANGLE_NONE
+	MeshBvhStats m_Stats ;
+
+	MeshBvh(const MeshBvh&) ;
+	MeshBvh& operator=(const MeshBvh&) ;
+};
+
+#endif // end __MESH_BVH_H__
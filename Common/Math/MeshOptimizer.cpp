@@ -0,0 +1,554 @@
+#include "MeshOptimizer.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "Vector.h"
+
+static const unsigned int NONE = 0xFFFFFFFF ;
+
+// Forsyth's constants, the valence table covers what a vertex has in a sane mesh
+static const float CACHE_DECAY_POWER = 1.5f ;
+static const float LAST_TRIANGLE_SCORE = 0.75f ;
+static const float VALENCE_BOOST_SCALE = 2.0f ;
+static const float VALENCE_BOOST_POWER = 0.5f ;
+static const unsigned int VALENCE_SCORES = 32 ;
+
+// The vertex fetch model, a FIFO of cache lines behind the post transform cache
+static const unsigned int FETCH_LINE_SIZE = 64 ;
+static const unsigned int FETCH_CACHE_LINES = 64 ;
+static const unsigned int FETCH_VERTEX_CACHE = 16 ;
+
+// The triangles around every vertex, those of vertex v start at triangles[offsets[v]]
+struct Adjacency
+{
+	std::vector<unsigned int> counts ;
+	std::vector<unsigned int> offsets ;
+	std::vector<unsigned int> triangles ;
+};
+
+static void BuildAdjacency(Adjacency& adjacency, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	adjacency.counts.assign(vertexCount, 0) ;
+	adjacency.offsets.resize(vertexCount) ;
+	adjacency.triangles.resize(indexCount) ;
+
+	for (size_t i = 0; i < indexCount; ++i)
+		adjacency.counts[indices[i]]++ ;
+
+	unsigned int offset = 0 ;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacency.offsets[v] = offset ;
+		offset += adjacency.counts[v] ;
+	}
+
+	// The offsets serve as write cursors, then go back to the start of each list
+	for (size_t i = 0; i < indexCount; ++i)
+		adjacency.triangles[adjacency.offsets[indices[i]]++] = (unsigned int)(i / 3) ;
+
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacency.offsets[v] -= adjacency.counts[v] ;
+}
+
+// Copy the input aside when it is also the output
+static const unsigned int* Source(std::vector<unsigned int>& copy, unsigned int* destination, const unsigned int* indices, size_t indexCount)
+{
+	if (destination != indices || indexCount == 0)
+		return indices ;
+
+	copy.assign(indices, indices + indexCount) ;
+	return &copy[0] ;
+}
+
+struct ForsythScores
+{
+	float cache[VERTEX_CACHE_SIZE] ;
+	float valence[VALENCE_SCORES] ;
+
+	ForsythScores()
+	{
+		for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i)
+		{
+			// The last triangle's vertices get a fixed score, so its neighbours are not
+			// favoured over the triangles sharing an older edge
+			if (i < 3)
+				cache[i] = LAST_TRIANGLE_SCORE ;
+			else
+				cache[i] = powf(1.0f - (float)(i - 3) / (VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER) ;
+		}
+
+		// Vertices with few triangles left come first, so no lonely triangle stays behind
+		valence[0] = 0.0f ;
+		for (unsigned int i = 1; i < VALENCE_SCORES; ++i)
+			valence[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER) ;
+	}
+
+	float Vertex(int cachePosition, unsigned int liveTriangles) const
+	{
+		float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f ;
+		return score + valence[std::min(liveTriangles, VALENCE_SCORES - 1)] ;
+	}
+};
+
+void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	std::vector<unsigned int> copy ;
+	indices = Source(copy, destination, indices, indexCount) ;
+
+	size_t triangleCount = indexCount / 3 ;
+	if (triangleCount == 0)
+		return ;
+
+	const ForsythScores scores ;
+
+	Adjacency adjacency ;
+	BuildAdjacency(adjacency, indices, indexCount, vertexCount) ;
+
+	// The triangles not emitted yet are the first live[v] of each vertex's list
+	std::vector<unsigned int> live(adjacency.counts) ;
+	std::vector<int> cachePosition(vertexCount, -1) ;
+	std::vector<float> vertexScore(vertexCount) ;
+	std::vector<unsigned char> emitted(triangleCount, 0) ;
+
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = scores.Vertex(-1, live[v]) ;
+
+	unsigned int best = 0 ;
+	float bestScore = -1.0f ;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const unsigned int* triangle = indices + t * 3 ;
+		float score = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]] ;
+		if (score > bestScore)
+		{
+			bestScore = score ;
+			best = (unsigned int)t ;
+		}
+	}
+
+	unsigned int cache[VERTEX_CACHE_SIZE + 3] ;
+	unsigned int cacheCount = 0 ;
+	size_t deadEndCursor = 0 ;
+	unsigned int* out = destination ;
+
+	while (best != NONE)
+	{
+		const unsigned int* triangle = indices + best * 3 ;
+		out[0] = triangle[0] ;
+		out[1] = triangle[1] ;
+		out[2] = triangle[2] ;
+		out += 3 ;
+		emitted[best] = 1 ;
+
+		// The triangle's vertices move to the front, the rest shifts back
+		unsigned int newCache[VERTEX_CACHE_SIZE + 3] ;
+		unsigned int newCount = 0 ;
+		for (int k = 0; k < 3; ++k)
+		{
+			bool listed = false ;
+			for (unsigned int i = 0; i < newCount; ++i)
+				listed = listed || newCache[i] == triangle[k] ;
+			if (!listed)
+				newCache[newCount++] = triangle[k] ;
+		}
+
+		for (unsigned int i = 0; i < cacheCount; ++i)
+		{
+			unsigned int v = cache[i] ;
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v ;
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned int v = triangle[k] ;
+			unsigned int* list = &adjacency.triangles[adjacency.offsets[v]] ;
+			unsigned int count = live[v] ;
+			for (unsigned int i = 0; i < count; ++i)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[count - 1] ;
+					break ;
+				}
+			}
+			live[v] = count - 1 ;
+		}
+
+		// Vertices pushed out of the cache lose their cache score too
+		for (unsigned int i = 0; i < newCount; ++i)
+		{
+			unsigned int v = newCache[i] ;
+			cachePosition[v] = i < VERTEX_CACHE_SIZE ? (int)i : -1 ;
+			vertexScore[v] = scores.Vertex(cachePosition[v], live[v]) ;
+		}
+
+		// Only the triangles around those vertices changed score, the best of them is next
+		best = NONE ;
+		bestScore = -1.0f ;
+		for (unsigned int i = 0; i < newCount; ++i)
+		{
+			unsigned int v = newCache[i] ;
+			const unsigned int* list = &adjacency.triangles[0] + adjacency.offsets[v] ;
+			for (unsigned int j = 0; j < live[v]; ++j)
+			{
+				const unsigned int* other = indices + list[j] * 3 ;
+				float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]] ;
+				if (score > bestScore)
+				{
+					bestScore = score ;
+					best = list[j] ;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, (unsigned int)VERTEX_CACHE_SIZE) ;
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int)) ;
+
+		// Nothing left around the cache, go on with the next triangle in input order
+		if (best == NONE)
+		{
+			while (deadEndCursor < triangleCount && emitted[deadEndCursor])
+				++deadEndCursor ;
+			if (deadEndCursor < triangleCount)
+				best = (unsigned int)deadEndCursor ;
+		}
+	}
+}
+
+void OptimizeVertexCacheTipsify(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	std::vector<unsigned int> copy ;
+	indices = Source(copy, destination, indices, indexCount) ;
+
+	size_t triangleCount = indexCount / 3 ;
+	if (triangleCount == 0)
+		return ;
+
+	Adjacency adjacency ;
+	BuildAdjacency(adjacency, indices, indexCount, vertexCount) ;
+
+	std::vector<unsigned int> live(adjacency.counts) ;
+	std::vector<unsigned int> timestamp(vertexCount, 0) ;
+	std::vector<unsigned char> emitted(triangleCount, 0) ;
+	std::vector<unsigned int> deadEnds ;
+	std::vector<unsigned int> candidates ;
+
+	// A vertex is in the cache while time - timestamp <= cacheSize, none is at the start
+	unsigned int time = cacheSize + 1 ;
+	unsigned int cursor = 0 ;
+	unsigned int* out = destination ;
+
+	while (cursor < vertexCount && live[cursor] == 0)
+		++cursor ;
+	unsigned int fan = cursor < vertexCount ? cursor : NONE ;
+
+	while (fan != NONE)
+	{
+		// Emit every triangle left around the fanning vertex
+		candidates.clear() ;
+		const unsigned int* list = &adjacency.triangles[0] + adjacency.offsets[fan] ;
+		for (unsigned int i = 0; i < adjacency.counts[fan]; ++i)
+		{
+			unsigned int t = list[i] ;
+			if (emitted[t])
+				continue ;
+			emitted[t] = 1 ;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned int v = indices[t * 3 + k] ;
+				*out++ = v ;
+				deadEnds.push_back(v) ;
+				candidates.push_back(v) ;
+				live[v]-- ;
+				if (time - timestamp[v] > cacheSize)
+					timestamp[v] = time++ ;
+			}
+		}
+
+		// The next fan is around the oldest vertex that is still in the cache once its own
+		// triangles are emitted, or around the newest one when none would be
+		fan = NONE ;
+		int bestPriority = -1 ;
+		for (size_t i = 0; i < candidates.size(); ++i)
+		{
+			unsigned int v = candidates[i] ;
+			if (live[v] == 0)
+				continue ;
+
+			int priority = 0 ;
+			if (time - timestamp[v] + 2 * live[v] <= cacheSize)
+				priority = (int)(time - timestamp[v]) ;
+			if (priority > bestPriority)
+			{
+				bestPriority = priority ;
+				fan = v ;
+			}
+		}
+
+		// A dead end, back to a recent vertex with triangles left, or to the next one in order
+		while (fan == NONE && !deadEnds.empty())
+		{
+			unsigned int v = deadEnds.back() ;
+			deadEnds.pop_back() ;
+			if (live[v] > 0)
+				fan = v ;
+		}
+
+		if (fan == NONE)
+		{
+			while (cursor < vertexCount && live[cursor] == 0)
+				++cursor ;
+			if (cursor < vertexCount)
+				fan = cursor ;
+		}
+	}
+}
+
+// Cache misses of one triangle, the FIFO kept as timestamps like in Tipsify
+static unsigned int TriangleMisses(const unsigned int* triangle, std::vector<unsigned int>& timestamp, unsigned int& time, unsigned int cacheSize)
+{
+	unsigned int misses = 0 ;
+	for (int k = 0; k < 3; ++k)
+	{
+		unsigned int v = triangle[k] ;
+		if (time - timestamp[v] > cacheSize)
+		{
+			timestamp[v] = time++ ;
+			misses++ ;
+		}
+	}
+	return misses ;
+}
+
+struct OverdrawCluster
+{
+	unsigned int first ;		// triangle
+	unsigned int count ;
+	float sortKey ;
+
+	bool operator<(const OverdrawCluster& other) const { return sortKey > other.sortKey ; }
+};
+
+void OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+					  const float* positions, size_t positionStride, size_t vertexCount,
+					  float threshold, unsigned int cacheSize)
+{
+	std::vector<unsigned int> copy ;
+	indices = Source(copy, destination, indices, indexCount) ;
+
+	size_t triangleCount = indexCount / 3 ;
+	if (triangleCount == 0)
+		return ;
+
+	std::vector<unsigned int> timestamp(vertexCount, 0) ;
+	unsigned int time = cacheSize + 1 ;
+
+	// Hard boundaries where a triangle misses all three vertices, the order jumps there
+	std::vector<unsigned int> hard ;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (TriangleMisses(indices + t * 3, timestamp, time, cacheSize) == 3)
+			hard.push_back((unsigned int)t) ;
+	}
+	hard.push_back((unsigned int)triangleCount) ;
+
+	// Soft boundaries inside those, as soon as the run has paid for its cache misses.
+	// Moving the time ahead by more than the cache size empties the cache.
+	std::vector<OverdrawCluster> clusters ;
+	for (size_t h = 0; h + 1 < hard.size(); ++h)
+	{
+		unsigned int start = hard[h] ;
+		unsigned int end = hard[h + 1] ;
+
+		OverdrawCluster cluster ;
+		cluster.first = start ;
+		cluster.sortKey = 0.0f ;
+
+		if (threshold <= 1.0f)
+		{
+			cluster.count = end - start ;
+			clusters.push_back(cluster) ;
+			continue ;
+		}
+
+		time += cacheSize + 1 ;
+		unsigned int misses = 0 ;
+		for (unsigned int t = start; t < end; ++t)
+			misses += TriangleMisses(indices + t * 3, timestamp, time, cacheSize) ;
+		float limit = threshold * (float)misses / (float)(end - start) ;
+
+		time += cacheSize + 1 ;
+		misses = 0 ;
+		for (unsigned int t = start; t < end; ++t)
+		{
+			misses += TriangleMisses(indices + t * 3, timestamp, time, cacheSize) ;
+			if (t + 1 < end && (float)misses <= limit * (float)(t + 1 - cluster.first))
+			{
+				cluster.count = t + 1 - cluster.first ;
+				clusters.push_back(cluster) ;
+				cluster.first = t + 1 ;
+				time += cacheSize + 1 ;
+				misses = 0 ;
+			}
+		}
+		cluster.count = end - cluster.first ;
+		clusters.push_back(cluster) ;
+	}
+
+	// Area weighted centroid and normal of every cluster and of the whole mesh
+	std::vector<Vec3> centroids(clusters.size()) ;
+	std::vector<Vec3> normals(clusters.size()) ;
+	Vec3 meshCentroid(0.0f, 0.0f, 0.0f) ;
+	float meshArea = 0.0f ;
+	const unsigned char* base = (const unsigned char*)positions ;
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		Vec3 centroid(0.0f, 0.0f, 0.0f) ;
+		Vec3 normal(0.0f, 0.0f, 0.0f) ;
+		float area = 0.0f ;
+
+		for (unsigned int t = clusters[c].first; t < clusters[c].first + clusters[c].count; ++t)
+		{
+			const unsigned int* triangle = indices + t * 3 ;
+			Vec3 a((const float*)(base + triangle[0] * positionStride)) ;
+			Vec3 b((const float*)(base + triangle[1] * positionStride)) ;
+			Vec3 c3((const float*)(base + triangle[2] * positionStride)) ;
+
+			Vec3 cross = Vec3Cross(b - a, c3 - a) ;
+			float twiceArea = Vec3Length(cross) ;
+			centroid += (a + b + c3) * (twiceArea / 3.0f) ;
+			normal += cross ;
+			area += twiceArea ;
+		}
+
+		meshCentroid += centroid ;
+		meshArea += area ;
+		centroids[c] = area > 0.0f ? centroid / area : centroid ;
+		normals[c] = Vec3Normalize(normal) ;
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea ;
+
+	// How far out a cluster lies along its own normal
+	for (size_t c = 0; c < clusters.size(); ++c)
+		clusters[c].sortKey = Vec3Dot(centroids[c] - meshCentroid, normals[c]) ;
+
+	std::stable_sort(clusters.begin(), clusters.end()) ;
+
+	unsigned int* out = destination ;
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		memcpy(out, indices + clusters[c].first * 3, clusters[c].count * 3 * sizeof(unsigned int)) ;
+		out += clusters[c].count * 3 ;
+	}
+}
+
+size_t OptimizeVertexFetch(void* destination, unsigned int* indices, size_t indexCount,
+						   const void* vertices, size_t vertexCount, size_t vertexSize)
+{
+	std::vector<unsigned int> remap(vertexCount, NONE) ;
+	unsigned char* out = (unsigned char*)destination ;
+	const unsigned char* in = (const unsigned char*)vertices ;
+	unsigned int next = 0 ;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i] ;
+		if (remap[v] == NONE)
+		{
+			memcpy(out + next * vertexSize, in + v * vertexSize, vertexSize) ;
+			remap[v] = next++ ;
+		}
+		indices[i] = remap[v] ;
+	}
+
+	return next ;
+}
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats ;
+	stats.transforms = 0 ;
+	stats.acmr = 0.0f ;
+	stats.atvr = 0.0f ;
+
+	std::vector<unsigned int> timestamp(vertexCount, 0) ;
+	std::vector<unsigned char> used(vertexCount, 0) ;
+	unsigned int time = cacheSize + 1 ;
+	unsigned int usedCount = 0 ;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i] ;
+		if (time - timestamp[v] > cacheSize)
+		{
+			timestamp[v] = time++ ;
+			stats.transforms++ ;
+		}
+		if (!used[v])
+		{
+			used[v] = 1 ;
+			usedCount++ ;
+		}
+	}
+
+	if (indexCount >= 3)
+		stats.acmr = (float)stats.transforms / (float)(indexCount / 3) ;
+	if (usedCount > 0)
+		stats.atvr = (float)stats.transforms / (float)usedCount ;
+	return stats ;
+}
+
+VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize)
+{
+	VertexFetchStats stats ;
+	stats.bytesFetched = 0 ;
+	stats.overfetch = 0.0f ;
+
+	if (vertexCount == 0 || vertexSize == 0)
+		return stats ;
+
+	// The lines a vertex covers are fetched on a post transform cache miss
+	std::vector<unsigned int> timestamp(vertexCount, 0) ;
+	std::vector<unsigned char> used(vertexCount, 0) ;
+	std::vector<unsigned int> lineTimestamp((vertexCount * vertexSize + FETCH_LINE_SIZE - 1) / FETCH_LINE_SIZE, 0) ;
+	unsigned int time = FETCH_VERTEX_CACHE + 1 ;
+	unsigned int lineTime = FETCH_CACHE_LINES + 1 ;
+	unsigned int usedCount = 0 ;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		unsigned int v = indices[i] ;
+		if (!used[v])
+		{
+			used[v] = 1 ;
+			usedCount++ ;
+		}
+
+		if (time - timestamp[v] <= FETCH_VERTEX_CACHE)
+			continue ;
+		timestamp[v] = time++ ;
+
+		size_t firstLine = v * vertexSize / FETCH_LINE_SIZE ;
+		size_t lastLine = ((v + 1) * vertexSize - 1) / FETCH_LINE_SIZE ;
+		for (size_t line = firstLine; line <= lastLine; ++line)
+		{
+			if (lineTime - lineTimestamp[line] > FETCH_CACHE_LINES)
+			{
+				lineTimestamp[line] = lineTime++ ;
+				stats.bytesFetched += FETCH_LINE_SIZE ;
+			}
+		}
+	}
+
+	if (usedCount > 0)
+		stats.overfetch = (float)stats.bytesFetched / (float)(usedCount * vertexSize) ;
+	return stats ;
+}
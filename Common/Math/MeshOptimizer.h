@@ -0,0 +1,70 @@
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__
+
+#include <stddef.h>
+
+/*
+Reordering of indexed triangle lists for the vertex pipeline.
+
+Every function takes a triangle list of 32 bit indices and writes the result to
+destination, which may be the input itself. The triangles stay the same, only their
+order changes, and OptimizeVertexFetch renumbers the vertices.
+
+OptimizeVertexCache orders the triangles with Forsyth's linear speed scoring over a 32
+entry LRU cache. It assumes nothing about the cache of the hardware and does about as
+well on any size.
+
+OptimizeVertexCacheTipsify is Sander's Tipsify for a FIFO cache of cacheSize entries.
+It runs several times faster and, for the 16 entries the demos' hardware has, gets
+closer to the 0.5 transforms per triangle a large grid allows. It leaves the triangles
+in fans around one vertex after another, which OptimizeOverdraw splits into clusters.
+
+OptimizeOverdraw takes the output of one of the two above and sorts clusters of
+triangles so that those facing away from the middle of the mesh, the ones most likely
+to hide the rest, are drawn first. A cluster ends where the cache would have to be
+refilled anyway, or, when threshold is above 1, where the transforms so far stay within
+threshold times those of the whole run, so the cache efficiency lost is bounded.
+
+OptimizeVertexFetch copies the vertices in the order the indices first use them, so the
+vertex fetch walks memory forward, and drops the vertices no triangle uses. Call it last,
+after the triangles have their final order. Vertices generated row by row are already
+close to that order, it pays off on meshes whose vertices come scattered.
+
+AnalyzeVertexCache and AnalyzeVertexFetch replay the indices through a model of the
+post transform cache and of the memory fetching the vertices, for reports and tests.
+*/
+
+#define VERTEX_CACHE_SIZE		32
+
+struct VertexCacheStats
+{
+	unsigned int transforms ;	// cache misses, the vertices the vertex shader runs on
+	float acmr ;				// transforms per triangle, 0.5 at best on a large grid, 3 at worst
+	float atvr ;				// transforms per vertex used, 1 at best
+};
+
+struct VertexFetchStats
+{
+	unsigned int bytesFetched ;	// in 64 byte lines
+	float overfetch ;			// bytes fetched per byte of vertices used, 1 at best
+};
+
+void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount) ;
+
+void OptimizeVertexCacheTipsify(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16) ;
+
+// positions points at three floats every positionStride bytes
+void OptimizeOverdraw(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+					  const float* positions, size_t positionStride, size_t vertexCount,
+					  float threshold = 1.05f, unsigned int cacheSize = 16) ;
+
+// Returns the count of vertices written to destination, which must not overlap vertices
+size_t OptimizeVertexFetch(void* destination, unsigned int* indices, size_t indexCount,
+						   const void* vertices, size_t vertexCount, size_t vertexSize) ;
+
+// A FIFO cache of cacheSize entries, as on most hardware
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16) ;
+
+VertexFetchStats AnalyzeVertexFetch(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t vertexSize) ;
+
+#endif // end __MESH_OPTIMIZER_H__
@@ -0,0 +1,109 @@
+#ifndef __QUATERNION_H__
+#define __QUATERNION_H__
+
+#include "Matrix.h"
+
+/*
+Rotation quaternion with the layout and conventions of D3DXQUATERNION: x, y, z is the
+vector part, QuatMultiply(a, b) rotates by a then by b, and Mat4RotationQuat builds the
+matrix D3DXMatrixRotationQuaternion does, so the arc ball code can move over unchanged.
+*/
+struct Quat
+{
+	float x ;
+	float y ;
+	float z ;
+	float w ;
+
+	Quat() {}
+	Quat(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+} ;
+
+inline Quat QuatIdentity()
+{
+	return Quat(0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+inline Quat QuatRotationAxis(const Vec3& axis, float angle)
+{
+	Vec3 n = Vec3Normalize(axis) * sinf(angle * 0.5f) ;
+	return Quat(n.x, n.y, n.z, cosf(angle * 0.5f)) ;
+}
+
+inline float QuatDot(const Quat& a, const Quat& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w ;
+}
+
+inline Quat QuatConjugate(const Quat& q)
+{
+	return Quat(-q.x, -q.y, -q.z, q.w) ;
+}
+
+inline Quat QuatNormalize(const Quat& q)
+{
+	float length = sqrtf(QuatDot(q, q)) ;
+	if (length <= 0.0f)
+	{
+		return QuatIdentity() ;
+	}
+	float inv = 1.0f / length ;
+	return Quat(q.x * inv, q.y * inv, q.z * inv, q.w * inv) ;
+}
+
+// Rotate by a, then by b
+inline Quat QuatMultiply(const Quat& a, const Quat& b)
+{
+	return Quat(b.w * a.x + b.x * a.w + b.y * a.z - b.z * a.y,
+				b.w * a.y - b.x * a.z + b.y * a.w + b.z * a.x,
+				b.w * a.z + b.x * a.y - b.y * a.x + b.z * a.w,
+				b.w * a.w - b.x * a.x - b.y * a.y - b.z * a.z) ;
+}
+
+// Spherical interpolation along the shorter arc
+inline Quat QuatSlerp(const Quat& a, const Quat& b, float t)
+{
+	float cosAngle = QuatDot(a, b) ;
+	float sign = 1.0f ;
+	if (cosAngle < 0.0f)
+	{
+		cosAngle = -cosAngle ;
+		sign = -1.0f ;
+	}
+
+	float fromWeight = 1.0f - t ;
+	float toWeight = t ;
+	if (cosAngle < 1.0f - MATH_EPSILON)
+	{
+		float angle = acosf(cosAngle) ;
+		float inv = 1.0f / sinf(angle) ;
+		fromWeight = sinf(fromWeight * angle) * inv ;
+		toWeight = sinf(toWeight * angle) * inv ;
+	}
+	toWeight *= sign ;
+
+	return Quat(a.x * fromWeight + b.x * toWeight, a.y * fromWeight + b.y * toWeight,
+				a.z * fromWeight + b.z * toWeight, a.w * fromWeight + b.w * toWeight) ;
+}
+
+// q must be normalized
+inline Mat4 Mat4RotationQuat(const Quat& q)
+{
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z ;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z ;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z ;
+	return Mat4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+				2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+				2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f) ;
+}
+
+// The same as Vec3TransformNormal(v, Mat4RotationQuat(q)) without building the matrix
+inline Vec3 Vec3Rotate(const Vec3& v, const Quat& q)
+{
+	Vec3 u(q.x, q.y, q.z) ;
+	Vec3 t = Vec3Cross(u, v) * 2.0f ;
+	return v + t * q.w + Vec3Cross(u, t) ;
+}
+
+#endif // end __QUATERNION_H__
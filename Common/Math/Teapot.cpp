@@ -0,0 +1,409 @@
+#include "Teapot.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "Float4.h"
+#include "../Utility/ThreadPool.h"
+
+// Below this squared length the cross product of the derivatives is not a direction
+static const float DEGENERATE_NORMAL = 1e-10f ;
+
+// How far inside the patch a degenerate point takes its normal
+static const float NORMAL_NUDGE = 1e-3f ;
+
+/*
+The points of the teapot on the wiki page Utha_Teapot is made from, one quarter of the
+round parts and one half of the handle and the spout, with y <= 0. The last 9 close the
+bottom, which that page leaves out, with the points of Newell's original data set.
+*/
+static const float TEAPOT_POINTS[][3] =
+{
+	{      0.2f,      0.0f,      2.7f }, {      0.2f,   -0.112f,      2.7f },
+	{    0.112f,     -0.2f,      2.7f }, {      0.0f,     -0.2f,      2.7f },
+	{   1.3375f,      0.0f,  2.53125f }, {   1.3375f,   -0.749f,  2.53125f },
+	{    0.749f,  -1.3375f,  2.53125f }, {      0.0f,  -1.3375f,  2.53125f },
+	{   1.4375f,      0.0f,  2.53125f }, {   1.4375f,   -0.805f,  2.53125f },
+	{    0.805f,  -1.4375f,  2.53125f }, {      0.0f,  -1.4375f,  2.53125f },
+	{      1.5f,      0.0f,      2.4f }, {      1.5f,    -0.84f,      2.4f },
+	{     0.84f,     -1.5f,      2.4f }, {      0.0f,     -1.5f,      2.4f },
+	{     1.75f,      0.0f,    1.875f }, {     1.75f,    -0.98f,    1.875f },
+	{     0.98f,    -1.75f,    1.875f }, {      0.0f,    -1.75f,    1.875f },
+	{      2.0f,      0.0f,     1.35f }, {      2.0f,    -1.12f,     1.35f },
+	{     1.12f,     -2.0f,     1.35f }, {      0.0f,     -2.0f,     1.35f },
+	{      2.0f,      0.0f,      0.9f }, {      2.0f,    -1.12f,      0.9f },
+	{     1.12f,     -2.0f,      0.9f }, {      0.0f,     -2.0f,      0.9f },
+	{     -2.0f,      0.0f,      0.9f }, {      2.0f,      0.0f,     0.45f },
+	{      2.0f,    -1.12f,     0.45f }, {     1.12f,     -2.0f,     0.45f },
+	{      0.0f,     -2.0f,     0.45f }, {      1.5f,      0.0f,    0.225f },
+	{      1.5f,    -0.84f,    0.225f }, {     0.84f,     -1.5f,    0.225f },
+	{      0.0f,     -1.5f,    0.225f }, {      1.5f,      0.0f,     0.15f },
+	{      1.5f,    -0.84f,     0.15f }, {     0.84f,     -1.5f,     0.15f },
+	{      0.0f,     -1.5f,     0.15f }, {     -1.6f,      0.0f,    2.025f },
+	{     -1.6f,     -0.3f,    2.025f }, {     -1.5f,     -0.3f,     2.25f },
+	{     -1.5f,      0.0f,     2.25f }, {     -2.3f,      0.0f,    2.025f },
+	{     -2.3f,     -0.3f,    2.025f }, {     -2.5f,     -0.3f,     2.25f },
+	{     -2.5f,      0.0f,     2.25f }, {     -2.7f,      0.0f,    2.025f },
+	{     -2.7f,     -0.3f,    2.025f }, {     -3.0f,     -0.3f,     2.25f },
+	{     -3.0f,      0.0f,     2.25f }, {     -2.7f,      0.0f,      1.8f },
+	{     -2.7f,     -0.3f,      1.8f }, {     -3.0f,     -0.3f,      1.8f },
+	{     -3.0f,      0.0f,      1.8f }, {     -2.7f,      0.0f,    1.575f },
+	{     -2.7f,     -0.3f,    1.575f }, {     -3.0f,     -0.3f,     1.35f },
+	{     -3.0f,      0.0f,     1.35f }, {     -2.5f,      0.0f,    1.125f },
+	{     -2.5f,     -0.3f,    1.125f }, {    -2.65f,     -0.3f,   0.9375f },
+	{    -2.65f,      0.0f,   0.9375f }, {     -2.0f,     -0.3f,      0.9f },
+	{     -1.9f,     -0.3f,      0.6f }, {     -1.9f,      0.0f,      0.6f },
+	{      1.7f,      0.0f,    1.425f }, {      1.7f,    -0.66f,    1.425f },
+	{      1.7f,    -0.66f,      0.6f }, {      1.7f,      0.0f,      0.6f },
+	{      2.6f,      0.0f,    1.425f }, {      2.6f,    -0.66f,    1.425f },
+	{      3.1f,    -0.66f,    0.825f }, {      3.1f,      0.0f,    0.825f },
+	{      2.3f,      0.0f,      2.1f }, {      2.3f,    -0.25f,      2.1f },
+	{      2.4f,    -0.25f,    2.025f }, {      2.4f,      0.0f,    2.025f },
+	{      2.7f,      0.0f,      2.4f }, {      2.7f,    -0.25f,      2.4f },
+	{      3.3f,    -0.25f,      2.4f }, {      3.3f,      0.0f,      2.4f },
+	{      2.8f,      0.0f,    2.475f }, {      2.8f,    -0.25f,    2.475f },
+	{    3.525f,    -0.25f,  2.49375f }, {    3.525f,      0.0f,  2.49375f },
+	{      2.9f,      0.0f,    2.475f }, {      2.9f,    -0.15f,    2.475f },
+	{     3.45f,    -0.15f,   2.5125f }, {     3.45f,      0.0f,   2.5125f },
+	{      2.8f,      0.0f,      2.4f }, {      2.8f,    -0.15f,      2.4f },
+	{      3.2f,    -0.15f,      2.4f }, {      3.2f,      0.0f,      2.4f },
+	{      0.0f,      0.0f,     3.15f }, {      0.8f,      0.0f,     3.15f },
+	{      0.8f,    -0.45f,     3.15f }, {     0.45f,     -0.8f,     3.15f },
+	{      0.0f,     -0.8f,     3.15f }, {      0.0f,      0.0f,     2.85f },
+	{      1.4f,      0.0f,      2.4f }, {      1.4f,   -0.784f,      2.4f },
+	{    0.784f,     -1.4f,      2.4f }, {      0.0f,     -1.4f,      2.4f },
+	{      0.4f,      0.0f,     2.55f }, {      0.4f,   -0.224f,     2.55f },
+	{    0.224f,     -0.4f,     2.55f }, {      0.0f,     -0.4f,     2.55f },
+	{      1.3f,      0.0f,     2.55f }, {      1.3f,   -0.728f,     2.55f },
+	{    0.728f,     -1.3f,     2.55f }, {      0.0f,     -1.3f,     2.55f },
+	{      1.3f,      0.0f,      2.4f }, {      1.3f,   -0.728f,      2.4f },
+	{    0.728f,     -1.3f,      2.4f }, {      0.0f,     -1.3f,      2.4f },
+	{      0.0f,      0.0f,      0.0f }, {    1.425f,      0.0f,      0.0f },
+	{    1.425f,   -0.798f,      0.0f }, {    0.798f,   -1.425f,      0.0f },
+	{      0.0f,   -1.425f,      0.0f }, {      1.5f,      0.0f,    0.075f },
+	{      1.5f,    -0.84f,    0.075f }, {     0.84f,     -1.5f,    0.075f },
+	{      0.0f,     -1.5f,    0.075f },
+} ;
+
+enum TEAPOT_PART
+{
+	PART_RIM,
+	PART_BODY_TOP,
+	PART_BODY_BOTTOM,
+	PART_LID_TOP,
+	PART_LID_BOTTOM,
+	PART_HANDLE_TOP,
+	PART_HANDLE_BOTTOM,
+	PART_SPOUT_BODY,
+	PART_SPOUT_TIP,
+	PART_BOTTOM,
+	PART_COUNT,
+} ;
+
+static const unsigned char TEAPOT_PARTS[PART_COUNT][16] =
+{
+	{ 102, 103, 104, 105,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15 },
+	{  12,  13,  14,  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27 },
+	{  24,  25,  26,  27,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40 },
+	{  96,  96,  96,  96,  97,  98,  99, 100, 101, 101, 101, 101,   0,   1,   2,   3 },
+	{   0,   1,   2,   3, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117 },
+	{  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,  54,  55,  56 },
+	{  53,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  28,  65,  66,  67 },
+	{  68,  69,  70,  71,  72,  73,  74,  75,  76,  77,  78,  79,  80,  81,  82,  83 },
+	{  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91,  92,  93,  94,  95 },
+	{ 118, 118, 118, 118, 119, 120, 121, 122, 123, 124, 125, 126,  37,  38,  39,  40 },
+} ;
+
+// The parts from the wiki page turn their normals in, the bottom turns them out
+static const bool PART_TURNED_IN[PART_COUNT] = { true, true, true, true, true, true, true, true, true, false } ;
+
+// Mirrored into the four quarters, the first 24 patches, and into both halves, the last 8
+static const TEAPOT_PART ROUND_PARTS[] = { PART_RIM, PART_BODY_TOP, PART_BODY_BOTTOM, PART_LID_TOP, PART_LID_BOTTOM, PART_BOTTOM } ;
+static const TEAPOT_PART SIDE_PARTS[] = { PART_HANDLE_TOP, PART_HANDLE_BOTTOM, PART_SPOUT_BODY, PART_SPOUT_TIP } ;
+
+// Bernstein weights of the cubic and their derivatives at t
+static void CubicBasis(float t, float weights[4], float derivatives[4])
+{
+	float s = 1.0f - t ;
+	weights[0] = s * s * s ;
+	weights[1] = 3.0f * t * s * s ;
+	weights[2] = 3.0f * t * t * s ;
+	weights[3] = t * t * t ;
+	derivatives[0] = -3.0f * s * s ;
+	derivatives[1] = 3.0f * s * s - 6.0f * t * s ;
+	derivatives[2] = 6.0f * t * s - 3.0f * t * t ;
+	derivatives[3] = 3.0f * t * t ;
+}
+
+BezierBasis::BezierBasis(int level)
+{
+	this->level = std::max(1, std::min(level, BEZIER_MAX_LEVEL)) ;
+	stride = (this->level + 4) & ~3 ;
+	weights.resize(4 * stride) ;
+	derivatives.resize(4 * stride) ;
+
+	// The steps past the last one only fill the last group of four, they are not stored
+	for (int k = 0; k < stride; ++k)
+	{
+		float b[4], d[4] ;
+		CubicBasis((float)k / this->level, b, d) ;
+		for (int j = 0; j < 4; ++j)
+		{
+			weights[j * stride + k] = b[j] ;
+			derivatives[j * stride + k] = d[j] ;
+		}
+	}
+}
+
+// The position and the derivatives along u and v
+static void EvaluateDerivatives(const Vec3 points[16], float u, float v, Vec3& position, Vec3& du, Vec3& dv)
+{
+	float bu[4], du4[4], bv[4], dv4[4] ;
+	CubicBasis(u, bu, du4) ;
+	CubicBasis(v, bv, dv4) ;
+
+	position = Vec3(0.0f, 0.0f, 0.0f) ;
+	du = Vec3(0.0f, 0.0f, 0.0f) ;
+	dv = Vec3(0.0f, 0.0f, 0.0f) ;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			const Vec3& p = points[i * 4 + j] ;
+			position += p * (bu[i] * bv[j]) ;
+			du += p * (du4[i] * bv[j]) ;
+			dv += p * (bu[i] * dv4[j]) ;
+		}
+	}
+}
+
+void EvaluateBezierPatch(const Vec3 points[16], float u, float v, Vec3& position, Vec3& normal)
+{
+	Vec3 du, dv ;
+	EvaluateDerivatives(points, u, v, position, du, dv) ;
+	normal = Vec3Cross(du, dv) ;
+
+	// A collapsed edge, the normal of the patch just inside it
+	if (Vec3LengthSq(normal) <= DEGENERATE_NORMAL)
+	{
+		Vec3 inside ;
+		EvaluateDerivatives(points, u < 0.5f ? u + NORMAL_NUDGE : u - NORMAL_NUDGE,
+							v < 0.5f ? v + NORMAL_NUDGE : v - NORMAL_NUDGE, inside, du, dv) ;
+		normal = Vec3Cross(du, dv) ;
+	}
+	normal = Vec3Normalize(normal) ;
+}
+
+void TessellateBezierPatch(const Vec3 points[16], const BezierBasis& basis, TeapotVertex* vertices,
+						   unsigned int* indices, unsigned int firstVertex)
+{
+	int level = basis.level ;
+	int count = level + 1 ;
+	int stride = basis.stride ;
+	const Float4 degenerate = Float4Splat(DEGENERATE_NORMAL) ;
+	const Float4 one = Float4Splat(1.0f) ;
+
+	for (int i = 0; i <= level; ++i)
+	{
+		// The four columns of control points reduced to one point each at this u, the
+		// rest is a cubic along v
+		Float4 cx[4], cy[4], cz[4], ux[4], uy[4], uz[4] ;
+		for (int j = 0; j < 4; ++j)
+		{
+			Vec3 c(0.0f, 0.0f, 0.0f), d(0.0f, 0.0f, 0.0f) ;
+			for (int k = 0; k < 4; ++k)
+			{
+				c += points[k * 4 + j] * basis.weights[k * stride + i] ;
+				d += points[k * 4 + j] * basis.derivatives[k * stride + i] ;
+			}
+			cx[j] = Float4Splat(c.x) ;
+			cy[j] = Float4Splat(c.y) ;
+			cz[j] = Float4Splat(c.z) ;
+			ux[j] = Float4Splat(d.x) ;
+			uy[j] = Float4Splat(d.y) ;
+			uz[j] = Float4Splat(d.z) ;
+		}
+
+		TeapotVertex* row = vertices + i * count ;
+		for (int j = 0; j < count; j += 4)
+		{
+			Float4 px = Float4Zero(), py = Float4Zero(), pz = Float4Zero() ;
+			Float4 dux = Float4Zero(), duy = Float4Zero(), duz = Float4Zero() ;
+			Float4 dvx = Float4Zero(), dvy = Float4Zero(), dvz = Float4Zero() ;
+			for (int k = 0; k < 4; ++k)
+			{
+				Float4 b = Float4Load(&basis.weights[k * stride + j]) ;
+				Float4 d = Float4Load(&basis.derivatives[k * stride + j]) ;
+				px = Float4MulAdd(cx[k], b, px) ;
+				py = Float4MulAdd(cy[k], b, py) ;
+				pz = Float4MulAdd(cz[k], b, pz) ;
+				dux = Float4MulAdd(ux[k], b, dux) ;
+				duy = Float4MulAdd(uy[k], b, duy) ;
+				duz = Float4MulAdd(uz[k], b, duz) ;
+				dvx = Float4MulAdd(cx[k], d, dvx) ;
+				dvy = Float4MulAdd(cy[k], d, dvy) ;
+				dvz = Float4MulAdd(cz[k], d, dvz) ;
+			}
+
+			Float4 nx = Float4Sub(Float4Mul(duy, dvz), Float4Mul(duz, dvy)) ;
+			Float4 ny = Float4Sub(Float4Mul(duz, dvx), Float4Mul(dux, dvz)) ;
+			Float4 nz = Float4Sub(Float4Mul(dux, dvy), Float4Mul(duy, dvx)) ;
+			Float4 lengthSq = Float4Add(Float4Add(Float4Mul(nx, nx), Float4Mul(ny, ny)), Float4Mul(nz, nz)) ;
+			int valid = Float4MoveMask(Float4Less(degenerate, lengthSq)) ;
+			Float4 scale = Float4Div(one, Float4Sqrt(Float4Max(lengthSq, degenerate))) ;
+
+			float position[3][4], normal[3][4] ;
+			Float4Store(position[0], px) ;
+			Float4Store(position[1], py) ;
+			Float4Store(position[2], pz) ;
+			Float4Store(normal[0], Float4Mul(nx, scale)) ;
+			Float4Store(normal[1], Float4Mul(ny, scale)) ;
+			Float4Store(normal[2], Float4Mul(nz, scale)) ;
+
+			int lanes = std::min(4, count - j) ;
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				TeapotVertex& vertex = row[j + lane] ;
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					vertex.position[axis] = position[axis][lane] ;
+					vertex.normal[axis] = normal[axis][lane] ;
+				}
+
+				if (!(valid & (1 << lane)))
+				{
+					Vec3 p, n ;
+					EvaluateBezierPatch(points, (float)i / level, (float)(j + lane) / level, p, n) ;
+					vertex.normal[0] = n.x ;
+					vertex.normal[1] = n.y ;
+					vertex.normal[2] = n.z ;
+				}
+			}
+		}
+	}
+
+	// Two triangles per cell, counterclockwise around du x dv
+	for (int i = 0; i < level; ++i)
+	{
+		for (int j = 0; j < level; ++j)
+		{
+			unsigned int a = firstVertex + i * count + j ;
+			unsigned int b = a + count ;
+			indices[0] = a ;
+			indices[1] = b ;
+			indices[2] = a + 1 ;
+			indices[3] = a + 1 ;
+			indices[4] = b ;
+			indices[5] = b + 1 ;
+			indices += 6 ;
+		}
+	}
+}
+
+int BezierPatchLevel(const Vec3 points[16], float tolerance)
+{
+	// The largest second differences along u, along v and across
+	float uu = 0.0f, vv = 0.0f, uv = 0.0f ;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			const Vec3& p = points[i * 4 + j] ;
+			if (i < 2)
+				uu = std::max(uu, Vec3Length(points[(i + 2) * 4 + j] - points[(i + 1) * 4 + j] * 2.0f + p)) ;
+			if (j < 2)
+				vv = std::max(vv, Vec3Length(points[i * 4 + j + 2] - points[i * 4 + j + 1] * 2.0f + p)) ;
+			if (i < 3 && j < 3)
+				uv = std::max(uv, Vec3Length(points[(i + 1) * 4 + j + 1] - points[(i + 1) * 4 + j] - points[i * 4 + j + 1] + p)) ;
+		}
+	}
+
+	// Filip, Magedson and Markot: the triangles of a grid of step h are within
+	// h^2 / 8 * (Muu + 2 Muv + Mvv) of the patch, and for a cubic the second derivatives
+	// are bounded by 6 uu, 9 uv and 6 vv
+	float bound = (6.0f * uu + 18.0f * uv + 6.0f * vv) / 8.0f ;
+	if (bound <= 0.0f)
+		return 1 ;
+	if (tolerance <= 0.0f)
+		return BEZIER_MAX_LEVEL ;
+
+	int level = (int)ceilf(sqrtf(bound / tolerance)) ;
+	return std::max(1, std::min(level, BEZIER_MAX_LEVEL)) ;
+}
+
+void TeapotPatch(int patch, Vec3 points[16])
+{
+	TEAPOT_PART part ;
+	float mirrorX = 1.0f, mirrorY = 1.0f ;
+	if (patch < 24)
+	{
+		part = ROUND_PARTS[patch / 4] ;
+		mirrorX = (patch & 1) ? -1.0f : 1.0f ;
+		mirrorY = (patch & 2) ? -1.0f : 1.0f ;
+	}
+	else
+	{
+		part = SIDE_PARTS[(patch - 24) / 2] ;
+		mirrorY = (patch & 1) ? -1.0f : 1.0f ;
+	}
+
+	// A mirror turns the normals over, and so does reading the columns backwards
+	bool reverse = PART_TURNED_IN[part] != (mirrorX * mirrorY < 0.0f) ;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			const float* p = TEAPOT_POINTS[TEAPOT_PARTS[part][i * 4 + (reverse ? 3 - j : j)]] ;
+			points[i * 4 + j] = Vec3(p[0] * mirrorX, p[1] * mirrorY, p[2]) ;
+		}
+	}
+}
+
+int TeapotLevel(float tolerance)
+{
+	int level = 1 ;
+	for (int patch = 0; patch < TEAPOT_PATCH_COUNT; ++patch)
+	{
+		Vec3 points[16] ;
+		TeapotPatch(patch, points) ;
+		level = std::max(level, BezierPatchLevel(points, tolerance)) ;
+	}
+	return level ;
+}
+
+float ScreenTolerance(float pixels, float distance, float fovY, int viewportHeight)
+{
+	return pixels * 2.0f * distance * tanf(fovY * 0.5f) / (float)std::max(viewportHeight, 1) ;
+}
+
+void TessellateTeapot(int level, std::vector<TeapotVertex>& vertices, std::vector<unsigned int>& indices, ThreadPool* pPool)
+{
+	BezierBasis basis(level) ;
+	level = basis.level ;
+	size_t patchVertices = (size_t)(level + 1) * (level + 1) ;
+	size_t patchIndices = (size_t)level * level * 6 ;
+	vertices.resize(TEAPOT_PATCH_COUNT * patchVertices) ;
+	indices.resize(TEAPOT_PATCH_COUNT * patchIndices) ;
+
+	TeapotVertex* pVertices = &vertices[0] ;
+	unsigned int* pIndices = &indices[0] ;
+	auto task = [&](int patch)
+	{
+		Vec3 points[16] ;
+		TeapotPatch(patch, points) ;
+		TessellateBezierPatch(points, basis, pVertices + patch * patchVertices, pIndices + patch * patchIndices,
+							  (unsigned int)(patch * patchVertices)) ;
+	} ;
+
+	if (pPool)
+	{
+		pPool->ParallelFor(TEAPOT_PATCH_COUNT, task) ;
+	}
+	else
+	{
+		for (int patch = 0; patch < TEAPOT_PATCH_COUNT; ++patch)
+		{
+			task(patch) ;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef __TEAPOT_H__
+#define __TEAPOT_H__
+
+#include <stddef.h>
+#include <vector>
+
+#include "Vector.h"
+
+class ThreadPool ;
+
+/*
+Tessellation of bicubic Bezier patches, and Newell's teapot as 32 of them.
+
+TessellateBezierPatch evaluates a patch on a grid of (level + 1) x (level + 1) points
+and makes two triangles per cell. The Bernstein weights of the grid are computed once
+in a BezierBasis and the points are evaluated four at a time along v with Float4, the
+position and both partial derivatives together, so the normal is the exact normal of
+the surface and not an average of the triangles around the point. Where the patch
+collapses to a point, as at the top of the lid and the middle of the bottom, the
+derivatives vanish and the normal is taken a little inside the patch instead.
+
+Triangles wind counterclockwise around the normal in a right handed frame, which is
+clockwise seen from outside once the D3D9 demos read the points as left handed, so
+they are front faces with the default culling.
+
+The teapot is in its original frame: z up, the bottom on z = 0, the spout along +x.
+Every patch has its own vertices, (level + 1)^2 of them, and TessellateTeapot fills
+each patch's range of the arrays on its own, across the threads of the pool when one is
+given. The output is the same with or without it.
+
+BezierPatchLevel bounds how far the triangles of a level are from the surface, from the
+second differences of the control points, and returns the lowest level within the
+tolerance. TeapotLevel does the same for all patches at once, so the patches keep one
+level and the edges they share match without cracks.
+*/
+
+#define TEAPOT_PATCH_COUNT		32
+#define BEZIER_MAX_LEVEL		64
+
+struct TeapotVertex
+{
+	float position[3] ;
+	float normal[3] ;			// unit length
+} ;
+
+// The Bernstein weights and their derivatives at the level + 1 steps of a patch side
+struct BezierBasis
+{
+	int level ;
+	int stride ;							// level + 1 rounded up to 4, the length of each row
+	std::vector<float> weights ;			// 4 rows of stride
+	std::vector<float> derivatives ;
+
+	explicit BezierBasis(int level) ;
+} ;
+
+// Writes (level + 1)^2 vertices and level^2 * 6 indices, numbered from firstVertex.
+// points is row by row, u along the rows and v along the columns.
+void TessellateBezierPatch(const Vec3 points[16], const BezierBasis& basis, TeapotVertex* vertices,
+						   unsigned int* indices, unsigned int firstVertex) ;
+
+// The position and the unit normal at one point, the reference for the grid above
+void EvaluateBezierPatch(const Vec3 points[16], float u, float v, Vec3& position, Vec3& normal) ;
+
+// The lowest level whose triangles stay within tolerance of the patch, up to BEZIER_MAX_LEVEL
+int BezierPatchLevel(const Vec3 points[16], float tolerance) ;
+
+// The 16 control points of a teapot patch, oriented so the normals point out
+void TeapotPatch(int patch, Vec3 points[16]) ;
+
+int TeapotLevel(float tolerance) ;
+
+// The size in object units of the given pixels, at a distance from the camera
+float ScreenTolerance(float pixels, float distance, float fovY, int viewportHeight) ;
+
+void TessellateTeapot(int level, std::vector<TeapotVertex>& vertices, std::vector<unsigned int>& indices,
+					  ThreadPool* pPool = NULL) ;
+
+#endif // end __TEAPOT_H__
@@ -0,0 +1,399 @@
+#ifndef __TRIANGLEBATCH_H__
+#define __TRIANGLEBATCH_H__
+
+#include <float.h>
+#include <vector>
+
+#include "Geometry.h"
+
+/*
+A set of triangles laid out for testing rays against many of them at once.
+
+The triangles are kept in packets of TRIANGLE_PACKET_SIZE, 8 when the build targets
+AVX2 and 4 otherwise, each packet holding the first corner and the two edges of its
+triangles as nine arrays of floats, one component of one vector per array. The
+intersection is the Moller-Trumbore test of RayTriangle done on a whole packet with
+one instruction per step, so it reports the same hits: both sides, t >= 0, and the
+nearest one, the first added on a tie. Unused lanes of the last packet are degenerate
+triangles, which the determinant test rejects.
+
+Intersect with many rays puts a packet of rays in the lanes instead and walks the
+triangles one at a time, the way to go for bundles of coherent rays like a screen tile
+or a cursor sampled with some spread.
+
+Each triangle carries an id the caller chooses, the face number when picking, and a
+hit reports it with t, u and v as RayTriangle gives them.
+*/
+
+#if defined(SIMD_AVX2)
+static const size_t TRIANGLE_PACKET_SIZE = 8 ;
+#else
+static const size_t TRIANGLE_PACKET_SIZE = 4 ;
+#endif
+
+static const unsigned int TRIANGLE_NONE = 0xffffffff ;
+
+struct RayHit
+{
+	float t ;
+	float u ;
+	float v ;
+	unsigned int id ;	// TRIANGLE_NONE on a miss
+} ;
+
+// The kernels are written once over these, Float4 lanes or AVX lanes
+struct TriangleLanes4
+{
+	typedef Float4 Type ;
+	enum { COUNT = 4 } ;
+
+	static Type Load(const float* p) { return Float4Load(p) ; }
+	static void Store(float* p, Type a) { Float4Store(p, a) ; }
+	static Type Splat(float value) { return Float4Splat(value) ; }
+	static Type Add(Type a, Type b) { return Float4Add(a, b) ; }
+	static Type Sub(Type a, Type b) { return Float4Sub(a, b) ; }
+	static Type Mul(Type a, Type b) { return Float4Mul(a, b) ; }
+	static Type Less(Type a, Type b) { return Float4Less(a, b) ; }
+	static Type LessEqual(Type a, Type b) { return Float4LessEqual(a, b) ; }
+	static Type And(Type mask1, Type mask2) { return Float4And(mask1, mask2) ; }
+	static Type Select(Type mask, Type a, Type b) { return Float4Select(mask, a, b) ; }
+	static int MoveMask(Type mask) { return Float4MoveMask(mask) ; }
+} ;
+
+#if defined(SIMD_AVX2)
+struct TriangleLanes8
+{
+	typedef __m256 Type ;
+	enum { COUNT = 8 } ;
+
+	static Type Load(const float* p) { return _mm256_loadu_ps(p) ; }
+	static void Store(float* p, Type a) { _mm256_storeu_ps(p, a) ; }
+	static Type Splat(float value) { return _mm256_set1_ps(value) ; }
+	static Type Add(Type a, Type b) { return _mm256_add_ps(a, b) ; }
+	static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b) ; }
+	static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b) ; }
+	static Type Less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ) ; }
+	static Type LessEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ) ; }
+	static Type And(Type mask1, Type mask2) { return _mm256_and_ps(mask1, mask2) ; }
+	static Type Select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask) ; }
+	static int MoveMask(Type mask) { return _mm256_movemask_ps(mask) ; }
+} ;
+typedef TriangleLanes8 TriangleLanes ;
+#else
+typedef TriangleLanes4 TriangleLanes ;
+#endif
+
+/*
+The Moller-Trumbore steps on lanes, each lane a ray and triangle pair. Returns the
+mask of the lanes that hit nearer than limit, with the undivided t, u, v and the
+determinant to divide them by. As in RayTriangle the determinant is made positive and
+the comparisons are done before dividing.
+*/
+template <class L>
+inline typename L::Type TriangleLanesHit(typename L::Type ox, typename L::Type oy, typename L::Type oz,
+										 typename L::Type dx, typename L::Type dy, typename L::Type dz,
+										 typename L::Type v0x, typename L::Type v0y, typename L::Type v0z,
+										 typename L::Type e1x, typename L::Type e1y, typename L::Type e1z,
+										 typename L::Type e2x, typename L::Type e2y, typename L::Type e2z,
+										 typename L::Type limit,
+										 typename L::Type& t, typename L::Type& u, typename L::Type& v,
+										 typename L::Type& determinant)
+{
+	typedef typename L::Type T ;
+	T zero = L::Splat(0.0f) ;
+
+	// p = direction x edge2
+	T px = L::Sub(L::Mul(dy, e2z), L::Mul(dz, e2y)) ;
+	T py = L::Sub(L::Mul(dz, e2x), L::Mul(dx, e2z)) ;
+	T pz = L::Sub(L::Mul(dx, e2y), L::Mul(dy, e2x)) ;
+	T det = L::Add(L::Add(L::Mul(e1x, px), L::Mul(e1y, py)), L::Mul(e1z, pz)) ;
+
+	// Flipping s flips u, v and t with it, what the branch in RayTriangle does
+	T sign = L::Select(L::Less(det, zero), L::Splat(-1.0f), L::Splat(1.0f)) ;
+	determinant = L::Mul(det, sign) ;
+	T sx = L::Mul(L::Sub(ox, v0x), sign) ;
+	T sy = L::Mul(L::Sub(oy, v0y), sign) ;
+	T sz = L::Mul(L::Sub(oz, v0z), sign) ;
+
+	u = L::Add(L::Add(L::Mul(sx, px), L::Mul(sy, py)), L::Mul(sz, pz)) ;
+
+	// q = s x edge1
+	T qx = L::Sub(L::Mul(sy, e1z), L::Mul(sz, e1y)) ;
+	T qy = L::Sub(L::Mul(sz, e1x), L::Mul(sx, e1z)) ;
+	T qz = L::Sub(L::Mul(sx, e1y), L::Mul(sy, e1x)) ;
+	v = L::Add(L::Add(L::Mul(dx, qx), L::Mul(dy, qy)), L::Mul(dz, qz)) ;
+	t = L::Add(L::Add(L::Mul(e2x, qx), L::Mul(e2y, qy)), L::Mul(e2z, qz)) ;
+
+	T mask = L::LessEqual(L::Splat(MATH_EPSILON * MATH_EPSILON), determinant) ;
+	mask = L::And(mask, L::LessEqual(zero, u)) ;
+	mask = L::And(mask, L::LessEqual(zero, v)) ;
+	mask = L::And(mask, L::LessEqual(L::Add(u, v), determinant)) ;
+	mask = L::And(mask, L::LessEqual(zero, t)) ;
+	return L::And(mask, L::LessEqual(t, L::Mul(limit, determinant))) ;
+}
+
+// One ray in every lane
+template <class L>
+struct TriangleLanesRay
+{
+	typename L::Type ox, oy, oz ;
+	typename L::Type dx, dy, dz ;
+
+	explicit TriangleLanesRay(const Ray3& ray)
+		: ox(L::Splat(ray.origin.x)), oy(L::Splat(ray.origin.y)), oz(L::Splat(ray.origin.z)),
+		  dx(L::Splat(ray.direction.x)), dy(L::Splat(ray.direction.y)), dz(L::Splat(ray.direction.z))
+	{
+	}
+} ;
+
+/*
+Test the ray against packetCount packets of L::COUNT triangles from packets. A hit
+nearer than bestT replaces the best one, best is then the triangle counted from the
+first of the packets. Returns true when one did.
+*/
+template <class L>
+inline bool TrianglePacketsIntersect(const float* packets, size_t packetCount, const TriangleLanesRay<L>& ray,
+									 float& bestT, float& bestU, float& bestV, size_t& best)
+{
+	typedef typename L::Type T ;
+	bool found = false ;
+	for (size_t i = 0; i < packetCount; ++i)
+	{
+		const float* p = packets + i * 9 * L::COUNT ;
+		T t, u, v, det ;
+		T mask = TriangleLanesHit<L>(ray.ox, ray.oy, ray.oz, ray.dx, ray.dy, ray.dz,
+									 L::Load(p), L::Load(p + L::COUNT), L::Load(p + 2 * L::COUNT),
+									 L::Load(p + 3 * L::COUNT), L::Load(p + 4 * L::COUNT), L::Load(p + 5 * L::COUNT),
+									 L::Load(p + 6 * L::COUNT), L::Load(p + 7 * L::COUNT), L::Load(p + 8 * L::COUNT),
+									 L::Splat(bestT), t, u, v, det) ;
+
+		// Most packets miss, the rest divide only the lanes that hit
+		int bits = L::MoveMask(mask) ;
+		if (bits == 0)
+		{
+			continue ;
+		}
+
+		float laneT[L::COUNT], laneU[L::COUNT], laneV[L::COUNT], laneDet[L::COUNT] ;
+		L::Store(laneT, t) ;
+		L::Store(laneU, u) ;
+		L::Store(laneV, v) ;
+		L::Store(laneDet, det) ;
+		for (int lane = 0; bits != 0; ++lane, bits >>= 1)
+		{
+			if ((bits & 1) == 0)
+			{
+				continue ;
+			}
+			float inv = 1.0f / laneDet[lane] ;
+			float hitT = laneT[lane] * inv ;
+			if (hitT < bestT)
+			{
+				bestT = hitT ;
+				bestU = laneU[lane] * inv ;
+				bestV = laneV[lane] * inv ;
+				best = i * L::COUNT + lane ;
+				found = true ;
+			}
+		}
+	}
+	return found ;
+}
+
+// Write a triangle into a lane of a packet of TRIANGLE_PACKET_SIZE
+inline void TrianglePacketSet(float* packet, size_t lane, const Vec3& v0, const Vec3& v1, const Vec3& v2)
+{
+	Vec3 edge1 = v1 - v0 ;
+	Vec3 edge2 = v2 - v0 ;
+	const float values[9] = { v0.x, v0.y, v0.z, edge1.x, edge1.y, edge1.z, edge2.x, edge2.y, edge2.z } ;
+	for (size_t i = 0; i < 9; ++i)
+	{
+		packet[i * TRIANGLE_PACKET_SIZE + lane] = values[i] ;
+	}
+}
+
+class TriangleBatch
+{
+public:
+	TriangleBatch() : m_Count(0) {}
+
+	void Clear()
+	{
+		m_Packets.clear() ;
+		m_Ids.clear() ;
+		m_Count = 0 ;
+	}
+
+	void Reserve(size_t triangleCount)
+	{
+		size_t packetCount = (triangleCount + TRIANGLE_PACKET_SIZE - 1) / TRIANGLE_PACKET_SIZE ;
+		m_Packets.reserve(packetCount * PACKET_FLOATS) ;
+		m_Ids.reserve(triangleCount) ;
+	}
+
+	size_t Count() const { return m_Count ; }
+
+	void Add(const Vec3& v0, const Vec3& v1, const Vec3& v2, unsigned int id)
+	{
+		size_t lane = m_Count % TRIANGLE_PACKET_SIZE ;
+		if (lane == 0)
+		{
+			m_Packets.resize(m_Packets.size() + PACKET_FLOATS, 0.0f) ;
+		}
+
+		TrianglePacketSet(&m_Packets[m_Packets.size() - PACKET_FLOATS], lane, v0, v1, v2) ;
+		m_Ids.push_back(id) ;
+		++m_Count ;
+	}
+
+	/*
+	Add an indexed triangle list straight from locked vertex and index buffers. The
+	position is the first three floats of each vertex, stride is the vertex size in
+	bytes, and triangle i gets the id firstId + i.
+	*/
+	void AddIndexed(const void* vertices, size_t stride, const unsigned short* indices, size_t triangleCount, unsigned int firstId = 0)
+	{
+		AddIndexedTriangles(vertices, stride, indices, triangleCount, firstId) ;
+	}
+
+	void AddIndexed(const void* vertices, size_t stride, const unsigned int* indices, size_t triangleCount, unsigned int firstId = 0)
+	{
+		AddIndexedTriangles(vertices, stride, indices, triangleCount, firstId) ;
+	}
+
+	// The nearest hit with t below maxT
+	bool Intersect(const Ray3& ray, RayHit& hit, float maxT = FLT_MAX) const
+	{
+		float bestT = maxT ;
+		float bestU = 0.0f, bestV = 0.0f ;
+		size_t best = 0 ;
+		if (m_Count == 0 || !TrianglePacketsIntersect(&m_Packets[0], m_Packets.size() / PACKET_FLOATS,
+													  TriangleLanesRay<TriangleLanes>(ray), bestT, bestU, bestV, best))
+		{
+			return false ;
+		}
+
+		hit.t = bestT ;
+		hit.u = bestU ;
+		hit.v = bestV ;
+		hit.id = m_Ids[best] ;
+		return true ;
+	}
+
+	// One hit per ray, rays are done TRIANGLE_PACKET_SIZE at a time. Returns how many hit.
+	size_t Intersect(const Ray3* rays, size_t rayCount, RayHit* hits) const
+	{
+		size_t hitCount = 0 ;
+		for (size_t i = 0; i < rayCount; i += TRIANGLE_PACKET_SIZE)
+		{
+			size_t count = rayCount - i < TRIANGLE_PACKET_SIZE ? rayCount - i : TRIANGLE_PACKET_SIZE ;
+			hitCount += IntersectRays<TriangleLanes>(rays + i, count, hits + i) ;
+		}
+		return hitCount ;
+	}
+
+private:
+	enum { PACKET_FLOATS = 9 * TRIANGLE_PACKET_SIZE } ;
+
+	template <class Index>
+	void AddIndexedTriangles(const void* vertices, size_t stride, const Index* indices, size_t triangleCount, unsigned int firstId)
+	{
+		const char* base = static_cast<const char*>(vertices) ;
+		Reserve(m_Count + triangleCount) ;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			Vec3 v0(reinterpret_cast<const float*>(base + indices[i * 3] * stride)) ;
+			Vec3 v1(reinterpret_cast<const float*>(base + indices[i * 3 + 1] * stride)) ;
+			Vec3 v2(reinterpret_cast<const float*>(base + indices[i * 3 + 2] * stride)) ;
+			Add(v0, v1, v2, firstId + (unsigned int)i) ;
+		}
+	}
+
+	template <class L>
+	size_t IntersectRays(const Ray3* rays, size_t count, RayHit* hits) const
+	{
+		typedef typename L::Type T ;
+
+		// Transpose the rays into lanes, the missing ones repeat the last ray
+		float o[3][L::COUNT], d[3][L::COUNT] ;
+		float bestT[L::COUNT], bestU[L::COUNT], bestV[L::COUNT] ;
+		size_t best[L::COUNT] ;
+		for (size_t lane = 0; lane < L::COUNT; ++lane)
+		{
+			const Ray3& ray = rays[lane < count ? lane : count - 1] ;
+			o[0][lane] = ray.origin.x ; o[1][lane] = ray.origin.y ; o[2][lane] = ray.origin.z ;
+			d[0][lane] = ray.direction.x ; d[1][lane] = ray.direction.y ; d[2][lane] = ray.direction.z ;
+			bestT[lane] = FLT_MAX ;
+			best[lane] = m_Count ;
+		}
+		T ox = L::Load(o[0]), oy = L::Load(o[1]), oz = L::Load(o[2]) ;
+		T dx = L::Load(d[0]), dy = L::Load(d[1]), dz = L::Load(d[2]) ;
+		T limit = L::Load(bestT) ;
+
+		for (size_t i = 0; i < m_Count; ++i)
+		{
+			const float* p = &m_Packets[i / TRIANGLE_PACKET_SIZE * PACKET_FLOATS + i % TRIANGLE_PACKET_SIZE] ;
+			T t, u, v, det ;
+			T mask = TriangleLanesHit<L>(ox, oy, oz, dx, dy, dz,
+										 L::Splat(p[0]), L::Splat(p[TRIANGLE_PACKET_SIZE]), L::Splat(p[2 * TRIANGLE_PACKET_SIZE]),
+										 L::Splat(p[3 * TRIANGLE_PACKET_SIZE]), L::Splat(p[4 * TRIANGLE_PACKET_SIZE]), L::Splat(p[5 * TRIANGLE_PACKET_SIZE]),
+										 L::Splat(p[6 * TRIANGLE_PACKET_SIZE]), L::Splat(p[7 * TRIANGLE_PACKET_SIZE]), L::Splat(p[8 * TRIANGLE_PACKET_SIZE]),
+										 limit, t, u, v, det) ;
+
+			int bits = L::MoveMask(mask) ;
+			if (bits == 0)
+			{
+				continue ;
+			}
+
+			float laneT[L::COUNT], laneU[L::COUNT], laneV[L::COUNT], laneDet[L::COUNT] ;
+			L::Store(laneT, t) ;
+			L::Store(laneU, u) ;
+			L::Store(laneV, v) ;
+			L::Store(laneDet, det) ;
+			for (int lane = 0; bits != 0; ++lane, bits >>= 1)
+			{
+				if ((bits & 1) == 0)
+				{
+					continue ;
+				}
+				float inv = 1.0f / laneDet[lane] ;
+				float hitT = laneT[lane] * inv ;
+				if (hitT < bestT[lane])
+				{
+					bestT[lane] = hitT ;
+					bestU[lane] = laneU[lane] * inv ;
+					bestV[lane] = laneV[lane] * inv ;
+					best[lane] = i ;
+				}
+			}
+			limit = L::Load(bestT) ;
+		}
+
+		size_t hitCount = 0 ;
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			RayHit& hit = hits[lane] ;
+			if (best[lane] == m_Count)
+			{
+				hit.t = FLT_MAX ;
+				hit.u = 0.0f ;
+				hit.v = 0.0f ;
+				hit.id = TRIANGLE_NONE ;
+				continue ;
+			}
+			hit.t = bestT[lane] ;
+			hit.u = bestU[lane] ;
+			hit.v = bestV[lane] ;
+			hit.id = m_Ids[best[lane]] ;
+			++hitCount ;
+		}
+		return hitCount ;
+	}
+
+	std::vector<float> m_Packets ;		// PACKET_FLOATS per packet: v0, edge1, edge2 as x, y, z arrays
+	std::vector<unsigned int> m_Ids ;
+	size_t m_Count ;
+} ;
+
+#endif // end __TRIANGLEBATCH_H__
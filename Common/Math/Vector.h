@@ -0,0 +1,129 @@
+#ifndef __VECTOR_H__
+#define __VECTOR_H__
+
+#include <math.h>
+
+#include "Float4.h"
+
+/*
+3 and 4 component float vectors.
+
+The layouts are those of D3DXVECTOR3/D3DXVECTOR4 and XMFLOAT3/XMFLOAT4, so vertex
+and constant buffers keep their format. Like the D3DX types the default constructor
+leaves the vector uninitialised. Vec3 is computed with scalar code, three lanes do not
+pay for the shuffles, Vec4 goes through Float4. The loops over arrays of Vec3 in
+Matrix.h and Geometry.h load four of them at a time into Float4s instead.
+
+The functions are named like their D3DX counterparts, Vec3Dot for D3DXVec3Dot, and
+take and return values rather than pointers.
+*/
+
+static const float MATH_EPSILON = 0.00001f ;
+static const float MATH_PI = 3.14159265358979323846f ;
+
+struct Vec3
+{
+	float x ;
+	float y ;
+	float z ;
+
+	Vec3() {}
+	Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+	explicit Vec3(const float* p) : x(p[0]), y(p[1]), z(p[2]) {}
+
+	Vec3& operator+=(const Vec3& v) { x += v.x ; y += v.y ; z += v.z ; return *this ; }
+	Vec3& operator-=(const Vec3& v) { x -= v.x ; y -= v.y ; z -= v.z ; return *this ; }
+	Vec3& operator*=(float s) { x *= s ; y *= s ; z *= s ; return *this ; }
+	Vec3& operator/=(float s) { float inv = 1.0f / s ; x *= inv ; y *= inv ; z *= inv ; return *this ; }
+} ;
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return Vec3(a.x + b.x, a.y + b.y, a.z + b.z) ; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return Vec3(a.x - b.x, a.y - b.y, a.z - b.z) ; }
+inline Vec3 operator-(const Vec3& a) { return Vec3(-a.x, -a.y, -a.z) ; }
+inline Vec3 operator*(const Vec3& a, float s) { return Vec3(a.x * s, a.y * s, a.z * s) ; }
+inline Vec3 operator*(float s, const Vec3& a) { return Vec3(a.x * s, a.y * s, a.z * s) ; }
+inline Vec3 operator/(const Vec3& a, float s) { float inv = 1.0f / s ; return Vec3(a.x * inv, a.y * inv, a.z * inv) ; }
+inline bool operator==(const Vec3& a, const Vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z ; }
+inline bool operator!=(const Vec3& a, const Vec3& b) { return !(a == b) ; }
+
+inline float Vec3Dot(const Vec3& a, const Vec3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z ;
+}
+
+inline Vec3 Vec3Cross(const Vec3& a, const Vec3& b)
+{
+	return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x) ;
+}
+
+inline float Vec3LengthSq(const Vec3& a)
+{
+	return Vec3Dot(a, a) ;
+}
+
+inline float Vec3Length(const Vec3& a)
+{
+	return sqrtf(Vec3Dot(a, a)) ;
+}
+
+inline float Vec3DistanceSq(const Vec3& a, const Vec3& b)
+{
+	return Vec3LengthSq(a - b) ;
+}
+
+// A zero vector stays zero, what D3DXVec3Normalize does
+inline Vec3 Vec3Normalize(const Vec3& a)
+{
+	float length = Vec3Length(a) ;
+	return length > 0.0f ? a * (1.0f / length) : Vec3(0.0f, 0.0f, 0.0f) ;
+}
+
+inline Vec3 Vec3Lerp(const Vec3& a, const Vec3& b, float s)
+{
+	return a + (b - a) * s ;
+}
+
+inline Vec3 Vec3Min(const Vec3& a, const Vec3& b)
+{
+	return Vec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z) ;
+}
+
+inline Vec3 Vec3Max(const Vec3& a, const Vec3& b)
+{
+	return Vec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z) ;
+}
+
+struct Vec4
+{
+	float x ;
+	float y ;
+	float z ;
+	float w ;
+
+	Vec4() {}
+	Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+	explicit Vec4(const float* p) : x(p[0]), y(p[1]), z(p[2]), w(p[3]) {}
+	explicit Vec4(Float4 v) { Float4Store(&x, v) ; }
+
+	Float4 Load() const { return Float4Load(&x) ; }
+	Vec3 XYZ() const { return Vec3(x, y, z) ; }
+} ;
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return Vec4(Float4Add(a.Load(), b.Load())) ; }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return Vec4(Float4Sub(a.Load(), b.Load())) ; }
+inline Vec4 operator*(const Vec4& a, float s) { return Vec4(Float4Mul(a.Load(), Float4Splat(s))) ; }
+inline Vec4 operator*(float s, const Vec4& a) { return a * s ; }
+
+inline float Vec4Dot(const Vec4& a, const Vec4& b)
+{
+	return Float4Sum(Float4Mul(a.Load(), b.Load())) ;
+}
+
+inline Vec4 Vec4Lerp(const Vec4& a, const Vec4& b, float s)
+{
+	Float4 from = a.Load() ;
+	return Vec4(Float4MulAdd(Float4Sub(b.Load(), from), Float4Splat(s), from)) ;
+}
+
+#endif // end __VECTOR_H__
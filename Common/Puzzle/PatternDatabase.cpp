@@ -0,0 +1,280 @@
+#include "PatternDatabase.h"
+#include "../Utility/ThreadPool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+
+static const unsigned int PDB_MAGIC = 0x31424450 ;	// "PDB1"
+static const unsigned int HEADER_SIZE = 16 ;			// magic, width, height, group size
+
+// The search of a group keeps a byte for every placement of its tiles and the blank
+static const unsigned int MAX_SEARCH_STATES = 1 << 26 ;
+
+static const unsigned char UNREACHED = 255 ;
+
+PatternDatabase::PatternDatabase(void)
+	: m_Width(0),
+	  m_Height(0),
+	  m_GroupSize(0)
+{
+}
+
+PatternDatabase::~PatternDatabase(void)
+{
+}
+
+void PatternDatabase::Clear()
+{
+	m_Width = 0 ;
+	m_Height = 0 ;
+	m_GroupSize = 0 ;
+	m_Weights.clear() ;
+	m_TableSizes.clear() ;
+	m_Tables.clear() ;
+	m_Built.clear() ;
+	m_File.Close() ;
+}
+
+bool PatternDatabase::SetLayout(int width, int height, int groupSize)
+{
+	if (width < 2 || height < 2 || width > 5 || height > 5 || groupSize < 1)
+	{
+		return false ;
+	}
+
+	unsigned int count = (unsigned int)(width * height) ;
+	int tileCount = (int)count - 1 ;
+	m_Weights.assign(count, 0) ;
+	for (int first = 1; first <= tileCount; first += groupSize)
+	{
+		unsigned int size = 1 ;
+		for (int tile = first; tile < first + groupSize && tile <= tileCount; ++tile)
+		{
+			m_Weights[tile] = size ;
+			if (size > MAX_SEARCH_STATES / count / count)
+			{
+				return false ;
+			}
+			size *= count ;
+		}
+		m_TableSizes.push_back(size) ;
+	}
+
+	m_Width = width ;
+	m_Height = height ;
+	m_GroupSize = groupSize ;
+	return true ;
+}
+
+bool PatternDatabase::Build(int width, int height, int groupSize, ThreadPool* pPool)
+{
+	Clear() ;
+	if (!SetLayout(width, height, groupSize))
+	{
+		Clear() ;
+		return false ;
+	}
+
+	int groupCount = (int)m_TableSizes.size() ;
+	m_Built.resize(groupCount) ;
+	if (pPool)
+	{
+		pPool->ParallelFor(groupCount, [this](int group) { BuildGroup(group) ; }) ;
+	}
+	else
+	{
+		for (int group = 0; group < groupCount; ++group)
+		{
+			BuildGroup(group) ;
+		}
+	}
+
+	for (int group = 0; group < groupCount; ++group)
+	{
+		m_Tables.push_back(&m_Built[group][0]) ;
+	}
+	return true ;
+}
+
+void PatternDatabase::BuildGroup(int group)
+{
+	unsigned int count = (unsigned int)(m_Width * m_Height) ;
+	int first = group * m_GroupSize + 1 ;
+	int last = first + m_GroupSize < (int)count ? first + m_GroupSize : (int)count ;
+	int tiles = last - first ;
+	unsigned int tableSize = m_TableSizes[group] ;
+
+	// A state is the table index times the cell count plus the cell of the blank
+	std::vector<unsigned char> distance((size_t)tableSize * count, UNREACHED) ;
+	std::deque<unsigned int> queue ;
+
+	unsigned int solved = 0 ;
+	for (int tile = first; tile < last; ++tile)
+	{
+		solved += tile * m_Weights[tile] ;
+	}
+	distance[(size_t)solved * count] = 0 ;
+	queue.push_back(solved * count) ;
+
+	int cells[8] ;
+	while (!queue.empty())
+	{
+		unsigned int state = queue.front() ;
+		queue.pop_front() ;
+
+		unsigned int index = state / count ;
+		int blank = (int)(state % count) ;
+		int moves = distance[state] ;
+
+		unsigned int rest = index ;
+		for (int i = 0; i < tiles; ++i)
+		{
+			cells[i] = (int)(rest % count) ;
+			rest /= count ;
+		}
+
+		int x = blank % m_Width ;
+		int y = blank / m_Width ;
+		int neighbours[4] = { x > 0 ? blank - 1 : -1, x + 1 < m_Width ? blank + 1 : -1,
+							  y > 0 ? blank - m_Width : -1, y + 1 < m_Height ? blank + m_Width : -1 } ;
+
+		for (int n = 0; n < 4; ++n)
+		{
+			int cell = neighbours[n] ;
+			if (cell < 0)
+			{
+				continue ;
+			}
+
+			// The blank swaps with a tile of the group for one move, with any other tile for free
+			unsigned int next = index ;
+			int cost = 0 ;
+			for (int i = 0; i < tiles; ++i)
+			{
+				if (cells[i] == cell)
+				{
+					next = index - cell * m_Weights[first + i] + blank * m_Weights[first + i] ;
+					cost = 1 ;
+					break ;
+				}
+			}
+
+			unsigned int nextState = next * count + cell ;
+			if (distance[nextState] > moves + cost)
+			{
+				distance[nextState] = (unsigned char)(moves + cost) ;
+				if (cost)
+				{
+					queue.push_back(nextState) ;
+				}
+				else
+				{
+					queue.push_front(nextState) ;
+				}
+			}
+		}
+	}
+
+	// The blank can be anywhere, keep the best of its cells
+	std::vector<unsigned char>& table = m_Built[group] ;
+	table.assign(tableSize, UNREACHED) ;
+	for (unsigned int index = 0; index < tableSize; ++index)
+	{
+		const unsigned char* d = &distance[(size_t)index * count] ;
+		for (unsigned int blank = 0; blank < count; ++blank)
+		{
+			if (d[blank] < table[index])
+			{
+				table[index] = d[blank] ;
+			}
+		}
+	}
+}
+
+bool PatternDatabase::Save(const char* path) const
+{
+	if (m_Tables.empty())
+	{
+		return false ;
+	}
+
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	unsigned int header[4] = { PDB_MAGIC, (unsigned int)m_Width, (unsigned int)m_Height, (unsigned int)m_GroupSize } ;
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1 ;
+	for (size_t i = 0; ok && i < m_Tables.size(); ++i)
+	{
+		ok = fwrite(m_Tables[i], 1, m_TableSizes[i], file) == m_TableSizes[i] ;
+	}
+	return fclose(file) == 0 && ok ;
+}
+
+bool PatternDatabase::Load(const char* path)
+{
+	Clear() ;
+	if (!m_File.Open(path) || m_File.Size() < HEADER_SIZE)
+	{
+		Clear() ;
+		return false ;
+	}
+
+	unsigned int header[4] ;
+	memcpy(header, m_File.Data(), sizeof(header)) ;
+	if (header[0] != PDB_MAGIC || !SetLayout((int)header[1], (int)header[2], (int)header[3]))
+	{
+		Clear() ;
+		return false ;
+	}
+
+	size_t size = HEADER_SIZE ;
+	for (size_t i = 0; i < m_TableSizes.size(); ++i)
+	{
+		size += m_TableSizes[i] ;
+	}
+	if (m_File.Size() != size)
+	{
+		Clear() ;
+		return false ;
+	}
+
+	// The tables point into the mapping, which stays open until Clear
+	const unsigned char* table = m_File.Data() + HEADER_SIZE ;
+	for (size_t i = 0; i < m_TableSizes.size(); ++i)
+	{
+		m_Tables.push_back(table) ;
+		table += m_TableSizes[i] ;
+	}
+	return true ;
+}
+
+unsigned int PatternDatabase::Index(int group, const unsigned char* cellOfTile) const
+{
+	int first = group * m_GroupSize + 1 ;
+	int last = first + m_GroupSize < (int)m_Weights.size() ? first + m_GroupSize : (int)m_Weights.size() ;
+	unsigned int index = 0 ;
+	for (int tile = first; tile < last; ++tile)
+	{
+		index += cellOfTile[tile] * m_Weights[tile] ;
+	}
+	return index ;
+}
+
+int PatternDatabase::Heuristic(const unsigned char* cellOfTile) const
+{
+	int moves = 0 ;
+	for (int group = 0; group < (int)m_Tables.size(); ++group)
+	{
+		moves += Lookup(group, Index(group, cellOfTile)) ;
+	}
+	return moves ;
+}
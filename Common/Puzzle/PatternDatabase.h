@@ -0,0 +1,85 @@
+#ifndef __PATTERN_DATABASE_H__
+#define __PATTERN_DATABASE_H__
+
+#include "../Utility/MappedFile.h"
+
+#include <vector>
+
+class ThreadPool ;
+
+/*
+Disjoint additive pattern databases for sliding puzzles up to 5 x 5.
+
+The tiles other than the blank are split into groups of groupSize, in the order of their
+numbers. For every placement of a group's tiles a table holds the fewest moves of those
+tiles that bring them home, with the other tiles treated as interchangeable and their
+moves free. No move is counted in two groups, so the sum over the groups never
+overestimates the moves left and IDA* stays optimal with it.
+
+A table is indexed by the cells of its tiles as digits of base cell count, sparse but
+quick to update when one tile moves: the index changes by the distance of the move times
+the weight of the tile. The tables are built with a 0-1 breadth first search from the
+solved board over the tile cells and the blank cell, one group per thread of the pool.
+
+Building the 5-5-5 tables of the 4 x 4 board takes seconds, Save writes them to a file
+that Load maps back into memory without copying.
+*/
+class PatternDatabase
+{
+public:
+	PatternDatabase(void);
+	~PatternDatabase(void);
+
+	// Build the tables for a width x height board, false when a table would not fit in memory
+	bool Build(int width, int height, int groupSize, ThreadPool* pPool = NULL) ;
+
+	bool Save(const char* path) const ;
+
+	// Map tables saved before, false if the file is missing or not a pattern database
+	bool Load(const char* path) ;
+
+	void Clear() ;
+
+	bool IsEmpty() const { return m_Tables.empty() ; }
+
+	int Width() const { return m_Width ; }
+
+	int Height() const { return m_Height ; }
+
+	int GroupSize() const { return m_GroupSize ; }
+
+	int GroupCount() const { return (int)m_Tables.size() ; }
+
+	// The group of a tile other than the blank
+	int GroupOf(int tile) const { return (tile - 1) / m_GroupSize ; }
+
+	// What the index of its group changes by per cell a tile moves
+	unsigned int TileWeight(int tile) const { return m_Weights[tile] ; }
+
+	// The table index of a group with its tiles in the cells cellOfTile[tile]
+	unsigned int Index(int group, const unsigned char* cellOfTile) const ;
+
+	// The moves the tiles of a group need at least
+	int Lookup(int group, unsigned int index) const { return m_Tables[group][index] ; }
+
+	// The sum over the groups, a lower bound of the moves that solve the board
+	int Heuristic(const unsigned char* cellOfTile) const ;
+
+private:
+	bool SetLayout(int width, int height, int groupSize) ;
+	void BuildGroup(int group) ;
+
+	int m_Width ;
+	int m_Height ;
+	int m_GroupSize ;
+	std::vector<unsigned int> m_Weights ;		// per tile, cell count to the power of its place in the group
+	std::vector<unsigned int> m_TableSizes ;	// per group
+	std::vector<const unsigned char*> m_Tables ;	// per group, in m_Built or m_File
+	std::vector<std::vector<unsigned char> > m_Built ;
+	MappedFile m_File ;
+
+	PatternDatabase(const PatternDatabase&) ;
+	PatternDatabase& operator=(const PatternDatabase&) ;
+};
+
+#endif // end __PATTERN_DATABASE_H__
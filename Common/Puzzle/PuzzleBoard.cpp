@@ -0,0 +1,194 @@
+#include "PuzzleBoard.h"
+
+#include <stdlib.h>
+#include <vector>
+
+// xorshift32, rand() differs between the C runtimes
+static unsigned int NextRandom(unsigned int& state)
+{
+	state ^= state << 13 ;
+	state ^= state >> 17 ;
+	state ^= state << 5 ;
+	return state ;
+}
+
+// Fisher-Yates, every permutation equally likely
+static void Shuffle(int* tiles, int count, unsigned int seed)
+{
+	unsigned int state = seed * 2654435761u + 1 ;
+	if (state == 0)
+	{
+		state = 1 ;
+	}
+
+	SolvedBoard(tiles, count) ;
+	for (int i = count - 1; i > 0; --i)
+	{
+		int j = (int)(NextRandom(state) % (unsigned int)(i + 1)) ;
+		int temp = tiles[i] ;
+		tiles[i] = tiles[j] ;
+		tiles[j] = temp ;
+	}
+}
+
+static int CycleCount(const int* tiles, int count)
+{
+	std::vector<bool> visited(count, false) ;
+	int cycles = 0 ;
+	for (int i = 0; i < count; ++i)
+	{
+		if (!visited[i])
+		{
+			++cycles ;
+			for (int j = i; !visited[j]; j = tiles[j])
+			{
+				visited[j] = true ;
+			}
+		}
+	}
+	return cycles ;
+}
+
+void SolvedBoard(int* tiles, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		tiles[i] = i ;
+	}
+}
+
+bool IsSolved(const int* tiles, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (tiles[i] != i)
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+bool IsPermutation(const int* tiles, int count)
+{
+	std::vector<bool> seen(count, false) ;
+	for (int i = 0; i < count; ++i)
+	{
+		if (tiles[i] < 0 || tiles[i] >= count || seen[tiles[i]])
+		{
+			return false ;
+		}
+		seen[tiles[i]] = true ;
+	}
+	return true ;
+}
+
+int PermutationParity(const int* tiles, int count)
+{
+	// A cycle of n tiles is n - 1 swaps
+	return (count - CycleCount(tiles, count)) & 1 ;
+}
+
+int SwapDistance(const int* tiles, int count)
+{
+	return count - CycleCount(tiles, count) ;
+}
+
+bool NextSwap(const int* tiles, int count, int& first, int& second)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		if (tiles[i] != i)
+		{
+			// Bring tile i home from the cell it is in, that shortens its cycle by one
+			for (int j = i + 1; j < count; ++j)
+			{
+				if (tiles[j] == i)
+				{
+					first = i ;
+					second = j ;
+					return true ;
+				}
+			}
+		}
+	}
+	return false ;
+}
+
+void ShuffleSwapBoard(int* tiles, int count, unsigned int seed)
+{
+	Shuffle(tiles, count, seed) ;
+	if (count >= 2 && IsSolved(tiles, count))
+	{
+		tiles[0] = 1 ;
+		tiles[1] = 0 ;
+	}
+}
+
+bool IsSolvableSliding(const int* tiles, int width, int height)
+{
+	int count = width * height ;
+	if (!IsPermutation(tiles, count))
+	{
+		return false ;
+	}
+
+	int blank = 0 ;
+	while (tiles[blank] != 0)
+	{
+		++blank ;
+	}
+	int blankDistance = blank % width + blank / width ;
+	return PermutationParity(tiles, count) == (blankDistance & 1) ;
+}
+
+void ShuffleSlidingBoard(int* tiles, int width, int height, unsigned int seed)
+{
+	int count = width * height ;
+	Shuffle(tiles, count, seed) ;
+	if (count < 4)
+	{
+		return ;
+	}
+
+	// Swapping two tiles other than the blank flips the parity, and pairs the boards that
+	// cannot be solved one to one with those that can
+	if (!IsSolvableSliding(tiles, width, height))
+	{
+		int first = tiles[0] == 0 ? 1 : 0 ;
+		int second = tiles[count - 1] == 0 ? count - 2 : count - 1 ;
+		int temp = tiles[first] ;
+		tiles[first] = tiles[second] ;
+		tiles[second] = temp ;
+	}
+
+	if (IsSolved(tiles, count))
+	{
+		// One slide away from home
+		SlideTile(tiles, width, height, 1) ;
+	}
+}
+
+bool SlideTile(int* tiles, int width, int height, int cell)
+{
+	int count = width * height ;
+	if (cell < 0 || cell >= count)
+	{
+		return false ;
+	}
+
+	int x = cell % width ;
+	int y = cell / width ;
+	int neighbours[4] = { x > 0 ? cell - 1 : -1, x + 1 < width ? cell + 1 : -1,
+						  y > 0 ? cell - width : -1, y + 1 < height ? cell + width : -1 } ;
+	for (int i = 0; i < 4; ++i)
+	{
+		if (neighbours[i] >= 0 && tiles[neighbours[i]] == 0)
+		{
+			tiles[neighbours[i]] = tiles[cell] ;
+			tiles[cell] = 0 ;
+			return true ;
+		}
+	}
+	return false ;
+}
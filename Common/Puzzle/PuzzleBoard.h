@@ -0,0 +1,53 @@
+#ifndef __PUZZLE_BOARD_H__
+#define __PUZZLE_BOARD_H__
+
+/*
+Boards of the puzzle demos as permutations, without any drawing.
+
+A board of count cells holds the tiles 0 to count - 1, tiles[cell] is the tile in the
+cell, and it is solved when every tile is in the cell of its number. Two kinds of puzzle
+use it:
+
+PuzzlePanel swaps any two pieces. Every board can be solved, and the fewest swaps are
+count minus the number of cycles of the permutation, each swap that puts a tile home
+is one of them.
+
+A sliding puzzle moves tile 0, the blank, into a neighbouring cell. Every move is a
+swap with the blank, so it changes the parity of the permutation and of the distance
+of the blank from its home cell together, and only the boards where the two parities
+are equal can be solved. Shuffling the tiles at random hits the other half as often.
+
+The shuffles take a seed and produce the same boards on every platform.
+*/
+
+// Set the tiles of a solved board
+void SolvedBoard(int* tiles, int count) ;
+
+bool IsSolved(const int* tiles, int count) ;
+
+// Whether every tile from 0 to count - 1 is on the board exactly once
+bool IsPermutation(const int* tiles, int count) ;
+
+// 0 when the permutation is even, 1 when it is odd
+int PermutationParity(const int* tiles, int count) ;
+
+// The fewest swaps of two tiles that solve the board
+int SwapDistance(const int* tiles, int count) ;
+
+// The cells of a swap that puts at least one tile home, false when the board is solved
+bool NextSwap(const int* tiles, int count, int& first, int& second) ;
+
+// A random board that is not solved, unless there are fewer than two cells
+void ShuffleSwapBoard(int* tiles, int count, unsigned int seed) ;
+
+// Whether the blank can slide the tiles of a width x height board home
+bool IsSolvableSliding(const int* tiles, int width, int height) ;
+
+// A random board that can be solved by sliding and is not solved, for boards of 2 x 2
+// and larger. All of them are equally likely.
+void ShuffleSlidingBoard(int* tiles, int width, int height, unsigned int seed) ;
+
+// Slide the tile in cell into the blank, false when the cell is not next to the blank
+bool SlideTile(int* tiles, int width, int height, int cell) ;
+
+#endif // end __PUZZLE_BOARD_H__
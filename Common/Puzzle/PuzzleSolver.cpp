@@ -0,0 +1,285 @@
+#include "PuzzleSolver.h"
+#include "PuzzleBoard.h"
+#include "../Utility/ThreadPool.h"
+
+#include <limits.h>
+#include <functional>
+
+// Moves expanded before the search is split into subtrees, a few hundred of them on 4 x 4
+static const int SPLIT_DEPTH = 8 ;
+
+// No 5 x 5 board needs more than 205 moves, a bound above this means there is no solution
+static const int MAX_MOVES = 255 ;
+
+static const int MAX_CELLS = 25 ;
+static const int MAX_GROUPS = MAX_CELLS - 1 ;
+
+/*
+The board of one depth first search with the table index and heuristic of every group.
+*/
+class PuzzleSearch
+{
+public:
+	PuzzleSearch(PuzzleSolver& solver, const int* tiles, int bound, int subtree)
+		: m_Solver(solver),
+		  m_Database(solver.m_Database),
+		  m_Bound(bound),
+		  m_NextBound(INT_MAX),
+		  m_Subtree(subtree),
+		  m_SplitDepth(-1),
+		  m_pFrontier(NULL),
+		  m_Nodes(0)
+	{
+		int count = m_Database.Width() * m_Database.Height() ;
+		for (int cell = 0; cell < count; ++cell)
+		{
+			m_Tiles[cell] = (unsigned char)tiles[cell] ;
+			m_CellOfTile[tiles[cell]] = (unsigned char)cell ;
+		}
+		m_Blank = m_CellOfTile[0] ;
+
+		m_Heuristic = 0 ;
+		for (int group = 0; group < m_Database.GroupCount(); ++group)
+		{
+			m_Index[group] = m_Database.Index(group, m_CellOfTile) ;
+			m_GroupMoves[group] = m_Database.Lookup(group, m_Index[group]) ;
+			m_Heuristic += m_GroupMoves[group] ;
+		}
+	}
+
+	// Stop at splitDepth moves and add the moves so far to frontier instead
+	void SetSplit(int splitDepth, std::vector<std::vector<int> >* pFrontier)
+	{
+		m_SplitDepth = splitDepth ;
+		m_pFrontier = pFrontier ;
+	}
+
+	// Move the blank to cell, next to it
+	void Move(int cell)
+	{
+		int tile = m_Tiles[cell] ;
+		int group = m_Database.GroupOf(tile) ;
+		unsigned int weight = m_Database.TileWeight(tile) ;
+		m_Index[group] = m_Index[group] + m_Blank * weight - cell * weight ;
+
+		int moves = m_Database.Lookup(group, m_Index[group]) ;
+		m_Heuristic += moves - m_GroupMoves[group] ;
+		m_GroupMoves[group] = moves ;
+
+		m_Tiles[m_Blank] = (unsigned char)tile ;
+		m_CellOfTile[tile] = (unsigned char)m_Blank ;
+		m_Tiles[cell] = 0 ;
+		m_Blank = cell ;
+	}
+
+	// Search below the board, previous is the cell the blank came from. True when the
+	// board was solved, with the moves in m_Path.
+	bool Run(int previous)
+	{
+		++m_Nodes ;
+
+		int depth = (int)m_Path.size() ;
+		int estimate = depth + m_Heuristic ;
+		if (estimate > m_Bound)
+		{
+			if (estimate < m_NextBound)
+			{
+				m_NextBound = estimate ;
+			}
+			return false ;
+		}
+
+		// No group has a tile away from home
+		if (m_Heuristic == 0)
+		{
+			return true ;
+		}
+
+		if (depth == m_SplitDepth)
+		{
+			m_pFrontier->push_back(m_Path) ;
+			return false ;
+		}
+
+		if (m_Solver.m_Best.load(std::memory_order_relaxed) < m_Subtree)
+		{
+			return false ;
+		}
+
+		const int* neighbours = &m_Solver.m_Neighbours[m_Blank * 4] ;
+		for (int i = 0; i < 4; ++i)
+		{
+			int cell = neighbours[i] ;
+			if (cell < 0 || cell == previous)
+			{
+				continue ;
+			}
+
+			int blank = m_Blank ;
+			Move(cell) ;
+			m_Path.push_back(cell) ;
+			if (Run(blank))
+			{
+				return true ;
+			}
+			m_Path.pop_back() ;
+			Move(blank) ;
+		}
+		return false ;
+	}
+
+	// Replay moves from the board the search started with
+	void Replay(const std::vector<int>& moves)
+	{
+		for (size_t i = 0; i < moves.size(); ++i)
+		{
+			Move(moves[i]) ;
+			m_Path.push_back(moves[i]) ;
+		}
+	}
+
+	const std::vector<int>& Path() const { return m_Path ; }
+
+	int Heuristic() const { return m_Heuristic ; }
+
+	int NextBound() const { return m_NextBound ; }
+
+	unsigned long long Nodes() const { return m_Nodes ; }
+
+private:
+	PuzzleSolver& m_Solver ;
+	const PatternDatabase& m_Database ;
+	unsigned char m_Tiles[MAX_CELLS] ;
+	unsigned char m_CellOfTile[MAX_CELLS] ;
+	int m_Blank ;
+	unsigned int m_Index[MAX_GROUPS] ;
+	int m_GroupMoves[MAX_GROUPS] ;
+	int m_Heuristic ;
+	int m_Bound ;
+	int m_NextBound ;
+	int m_Subtree ;
+	int m_SplitDepth ;
+	std::vector<std::vector<int> >* m_pFrontier ;
+	std::vector<int> m_Path ;
+	unsigned long long m_Nodes ;
+
+	PuzzleSearch(const PuzzleSearch&) ;
+	PuzzleSearch& operator=(const PuzzleSearch&) ;
+};
+
+PuzzleSolver::PuzzleSolver(const PatternDatabase& database)
+	: m_Database(database),
+	  m_Best(INT_MAX),
+	  m_Nodes(0)
+{
+	int width = database.Width() ;
+	int height = database.Height() ;
+	m_Neighbours.assign(width * height * 4, -1) ;
+	for (int cell = 0; cell < width * height; ++cell)
+	{
+		int x = cell % width ;
+		int y = cell / width ;
+		int* neighbours = &m_Neighbours[cell * 4] ;
+		neighbours[0] = y > 0 ? cell - width : -1 ;
+		neighbours[1] = x > 0 ? cell - 1 : -1 ;
+		neighbours[2] = x + 1 < width ? cell + 1 : -1 ;
+		neighbours[3] = y + 1 < height ? cell + width : -1 ;
+	}
+}
+
+PuzzleSolver::~PuzzleSolver(void)
+{
+}
+
+bool PuzzleSolver::Solve(const int* tiles, std::vector<int>& moves, ThreadPool* pPool)
+{
+	moves.clear() ;
+	m_Nodes = 0 ;
+
+	int width = m_Database.Width() ;
+	int height = m_Database.Height() ;
+	if (m_Database.IsEmpty() || !IsSolvableSliding(tiles, width, height))
+	{
+		return false ;
+	}
+
+	int blank = 0 ;
+	while (tiles[blank] != 0)
+	{
+		++blank ;
+	}
+
+	int bound = PuzzleSearch(*this, tiles, 0, 0).Heuristic() ;
+	while (bound <= MAX_MOVES)
+	{
+		// The first moves on this thread, down to the roots of the subtrees
+		std::vector<std::vector<int> > frontier ;
+		PuzzleSearch root(*this, tiles, bound, 0) ;
+		root.SetSplit(SPLIT_DEPTH, &frontier) ;
+		m_Best = INT_MAX ;
+		bool solved = root.Run(-1) ;
+		m_Nodes += root.Nodes() ;
+		if (solved)
+		{
+			moves = root.Path() ;
+			return true ;
+		}
+
+		int subtrees = (int)frontier.size() ;
+		std::vector<std::vector<int> > solutions(subtrees) ;
+		std::vector<int> nextBounds(subtrees, INT_MAX) ;
+		std::vector<unsigned long long> nodes(subtrees, 0) ;
+		std::function<void (int)> task = [&](int i)
+		{
+			if (m_Best.load() < i)
+			{
+				return ;
+			}
+
+			const std::vector<int>& start = frontier[i] ;
+			PuzzleSearch search(*this, tiles, bound, i) ;
+			search.Replay(start) ;
+			if (search.Run(start.size() >= 2 ? start[start.size() - 2] : blank))
+			{
+				solutions[i] = search.Path() ;
+				int best = m_Best.load() ;
+				while (i < best && !m_Best.compare_exchange_weak(best, i))
+				{
+				}
+			}
+			nextBounds[i] = search.NextBound() ;
+			nodes[i] = search.Nodes() ;
+		} ;
+
+		if (pPool)
+		{
+			pPool->ParallelFor(subtrees, task) ;
+		}
+		else
+		{
+			for (int i = 0; i < subtrees; ++i)
+			{
+				task(i) ;
+			}
+		}
+
+		int nextBound = root.NextBound() ;
+		for (int i = 0; i < subtrees; ++i)
+		{
+			m_Nodes += nodes[i] ;
+			if (nextBounds[i] < nextBound)
+			{
+				nextBound = nextBounds[i] ;
+			}
+		}
+
+		int best = m_Best.load() ;
+		if (best != INT_MAX)
+		{
+			moves = solutions[best] ;
+			return true ;
+		}
+		bound = nextBound ;
+	}
+	return false ;
+}
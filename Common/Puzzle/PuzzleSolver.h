@@ -0,0 +1,51 @@
+#ifndef __PUZZLE_SOLVER_H__
+#define __PUZZLE_SOLVER_H__
+
+#include "PatternDatabase.h"
+
+#include <vector>
+#include <atomic>
+
+class ThreadPool ;
+
+/*
+Shortest solutions of sliding puzzles with IDA* and a PatternDatabase.
+
+Every iteration searches depth first for the boards whose moves so far plus the heuristic
+stay within a bound, and raises the bound to the smallest sum that went over it. The
+heuristic never overestimates, so the first solution found is a shortest one. The blank
+never moves straight back, and a move only looks up the table of the group whose tile
+moved.
+
+Each iteration expands the first moves on the calling thread and hands the subtrees below
+them to the threads of a ThreadPool. The subtrees are numbered in the order the serial
+search visits them, and a subtree is given up when one with a lower number has found a
+solution, so the solution is the same for any number of threads.
+*/
+class PuzzleSolver
+{
+public:
+	explicit PuzzleSolver(const PatternDatabase& database);
+	~PuzzleSolver(void);
+
+	// Solve a board of the size of the database. moves gets the cells the blank moves to,
+	// which are the cells of the tiles that slide, in order. Return false for a board that
+	// cannot be solved.
+	bool Solve(const int* tiles, std::vector<int>& moves, ThreadPool* pPool = NULL) ;
+
+	// Boards the last Solve looked at
+	unsigned long long NodeCount() const { return m_Nodes ; }
+
+private:
+	friend class PuzzleSearch ;
+
+	const PatternDatabase& m_Database ;
+	std::vector<int> m_Neighbours ;		// 4 per cell, -1 past the board
+	std::atomic<int> m_Best ;			// lowest subtree with a solution in this iteration
+	unsigned long long m_Nodes ;
+
+	PuzzleSolver(const PuzzleSolver&) ;
+	PuzzleSolver& operator=(const PuzzleSolver&) ;
+};
+
+#endif // end __PUZZLE_SOLVER_H__
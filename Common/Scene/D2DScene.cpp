@@ -0,0 +1,63 @@
+#include "D2DScene.h"
+
+#include <stdio.h>
+#include <vector>
+
+void AddUpdateRegion(HWND hWnd, RetainedScene& scene)
+{
+	HRGN region = CreateRectRgn(0, 0, 0, 0) ;
+	if (!region)
+	{
+		scene.InvalidateAll() ;
+		return ;
+	}
+
+	// The rectangles of the region rather than its bounds, which would join distant changes
+	if (GetUpdateRgn(hWnd, region, FALSE) > NULLREGION)
+	{
+		DWORD size = GetRegionData(region, 0, NULL) ;
+		std::vector<char> buffer(size > sizeof(RGNDATAHEADER) ? size : sizeof(RGNDATAHEADER)) ;
+		RGNDATA* pData = (RGNDATA*)&buffer[0] ;
+		if (size && GetRegionData(region, size, pData) == size)
+		{
+			const RECT* rects = (const RECT*)pData->Buffer ;
+			for (DWORD i = 0; i < pData->rdh.nCount; ++i)
+			{
+				SceneRect rect = { (float)rects[i].left, (float)rects[i].top, (float)rects[i].right, (float)rects[i].bottom } ;
+				scene.Invalidate(rect) ;
+			}
+		}
+		else
+		{
+			scene.InvalidateAll() ;
+		}
+	}
+
+	DeleteObject(region) ;
+}
+
+void InvalidateDirtyRegion(HWND hWnd, const RetainedScene& scene)
+{
+	const DirtyRegion& dirty = scene.Dirty() ;
+	for (int i = 0; i < dirty.Count(); ++i)
+	{
+		const DirtyRect& rect = dirty.Rect(i) ;
+		RECT windowRect = { rect.left, rect.top, rect.right, rect.bottom } ;
+		InvalidateRect(hWnd, &windowRect, FALSE) ;
+	}
+}
+
+void PushDirtyClip(ID2D1RenderTarget* pRenderTarget, const DirtyRect& rect)
+{
+	pRenderTarget->PushAxisAlignedClip(
+		D2D1::RectF((float)rect.left, (float)rect.top, (float)rect.right, (float)rect.bottom),
+		D2D1_ANTIALIAS_MODE_ALIASED
+		) ;
+}
+
+void ShowDrawnPixels(HWND hWnd, const char* caption, const RetainedScene& scene)
+{
+	char title[256] ;
+	_snprintf_s(title, sizeof(title), _TRUNCATE, "%s - %u pixels drawn", caption, scene.LastFramePixels()) ;
+	SetWindowTextA(hWnd, title) ;
+}
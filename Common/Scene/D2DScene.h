@@ -0,0 +1,35 @@
+#ifndef __D2D_SCENE_H__
+#define __D2D_SCENE_H__
+
+#include <windows.h>
+#include <d2d1.h>
+#include "RetainedScene.h"
+
+/*
+Repaint the dirty region of a RetainedScene in a window drawn with Direct2D.
+
+The window's update region goes into the scene in WM_PAINT, so parts that were covered
+are drawn again along with the scene's own changes, and the changes are invalidated as
+their rectangles instead of the whole client area. A frame then pushes a clip for every
+dirty rectangle, clears it and draws the items that touch it.
+
+An HwndRenderTarget keeps its pixels from one frame to the next only when it was created
+with D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS, which this needs, and loses them on Resize, after
+which the whole scene is dirty. EndDraw still presents the whole target, only Direct3D 11
+swap chains can present part of one, so the saving is in the drawing. Coordinates are in
+pixels, which are DIPs at 96 DPI.
+*/
+
+// Add the parts of the window Windows asks to paint, call before drawing in WM_PAINT
+void AddUpdateRegion(HWND hWnd, RetainedScene& scene) ;
+
+// Have Windows send WM_PAINT for the dirty region
+void InvalidateDirtyRegion(HWND hWnd, const RetainedScene& scene) ;
+
+// Clip drawing to a rectangle of the dirty region, undo with PopAxisAlignedClip
+void PushDirtyClip(ID2D1RenderTarget* pRenderTarget, const DirtyRect& rect) ;
+
+// Show the pixels the last frame drew after caption in the title bar
+void ShowDrawnPixels(HWND hWnd, const char* caption, const RetainedScene& scene) ;
+
+#endif // end __D2D_SCENE_H__
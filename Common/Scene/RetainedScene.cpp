@@ -0,0 +1,218 @@
+#include "RetainedScene.h"
+
+#include <math.h>
+
+static long long Area(const DirtyRect& rect)
+{
+	return (long long)(rect.right - rect.left) * (rect.bottom - rect.top) ;
+}
+
+static DirtyRect Union(const DirtyRect& a, const DirtyRect& b)
+{
+	DirtyRect rect =
+	{
+		a.left < b.left ? a.left : b.left,
+		a.top < b.top ? a.top : b.top,
+		a.right > b.right ? a.right : b.right,
+		a.bottom > b.bottom ? a.bottom : b.bottom
+	} ;
+	return rect ;
+}
+
+static bool Overlaps(const DirtyRect& a, const DirtyRect& b)
+{
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom ;
+}
+
+// Pixels a merge draws that neither rectangle needs, the two do not overlap
+static long long Waste(const DirtyRect& a, const DirtyRect& b)
+{
+	return Area(Union(a, b)) - Area(a) - Area(b) ;
+}
+
+// Overlapping rectangles are always merged, the others when the union is at most a third larger
+static bool ShouldMerge(const DirtyRect& a, const DirtyRect& b)
+{
+	return Overlaps(a, b) || Waste(a, b) * 3 <= Area(a) + Area(b) ;
+}
+
+// The pixels rect touches, clipped to width x height
+static DirtyRect PixelRect(const SceneRect& rect, int width, int height)
+{
+	DirtyRect pixels =
+	{
+		(int)floor(rect.left),
+		(int)floor(rect.top),
+		(int)ceil(rect.right),
+		(int)ceil(rect.bottom)
+	} ;
+	pixels.left = pixels.left < 0 ? 0 : pixels.left ;
+	pixels.top = pixels.top < 0 ? 0 : pixels.top ;
+	pixels.right = pixels.right > width ? width : pixels.right ;
+	pixels.bottom = pixels.bottom > height ? height : pixels.bottom ;
+	return pixels ;
+}
+
+DirtyRegion::DirtyRegion(void)
+	: m_Width(0),
+	  m_Height(0)
+{
+}
+
+DirtyRegion::~DirtyRegion(void)
+{
+}
+
+void DirtyRegion::Reset(int width, int height)
+{
+	m_Width = width > 0 ? width : 0 ;
+	m_Height = height > 0 ? height : 0 ;
+	m_Rects.clear() ;
+}
+
+void DirtyRegion::Add(const SceneRect& rect)
+{
+	DirtyRect pixels = PixelRect(rect, m_Width, m_Height) ;
+	if (pixels.left < pixels.right && pixels.top < pixels.bottom)
+	{
+		Insert(pixels) ;
+	}
+}
+
+void DirtyRegion::AddAll()
+{
+	m_Rects.clear() ;
+	if (m_Width > 0 && m_Height > 0)
+	{
+		DirtyRect all = { 0, 0, m_Width, m_Height } ;
+		m_Rects.push_back(all) ;
+	}
+}
+
+void DirtyRegion::Insert(DirtyRect rect)
+{
+	// Grow the rectangle by every one it should merge with, a grown one may reach more
+	bool merged = true ;
+	while (merged)
+	{
+		merged = false ;
+		for (size_t i = 0; i < m_Rects.size(); ++i)
+		{
+			if (ShouldMerge(m_Rects[i], rect))
+			{
+				rect = Union(m_Rects[i], rect) ;
+				m_Rects.erase(m_Rects.begin() + i) ;
+				merged = true ;
+				break ;
+			}
+		}
+	}
+	m_Rects.push_back(rect) ;
+
+	if ((int)m_Rects.size() > MAX_DIRTY_RECTS)
+	{
+		size_t first = 0 ;
+		size_t second = 1 ;
+		long long least = -1 ;
+		for (size_t i = 0; i < m_Rects.size(); ++i)
+		{
+			for (size_t j = i + 1; j < m_Rects.size(); ++j)
+			{
+				long long waste = Waste(m_Rects[i], m_Rects[j]) ;
+				if (least < 0 || waste < least)
+				{
+					least = waste ;
+					first = i ;
+					second = j ;
+				}
+			}
+		}
+
+		DirtyRect pair = Union(m_Rects[first], m_Rects[second]) ;
+		m_Rects.erase(m_Rects.begin() + second) ;
+		m_Rects.erase(m_Rects.begin() + first) ;
+		Insert(pair) ;
+	}
+}
+
+bool DirtyRegion::Intersects(const SceneRect& rect) const
+{
+	DirtyRect pixels = PixelRect(rect, m_Width, m_Height) ;
+	for (size_t i = 0; i < m_Rects.size(); ++i)
+	{
+		if (Overlaps(m_Rects[i], pixels))
+		{
+			return true ;
+		}
+	}
+	return false ;
+}
+
+unsigned int DirtyRegion::PixelCount() const
+{
+	long long count = 0 ;
+	for (size_t i = 0; i < m_Rects.size(); ++i)
+	{
+		count += Area(m_Rects[i]) ;
+	}
+	return (unsigned int)count ;
+}
+
+RetainedScene::RetainedScene(void)
+	: m_LastFramePixels(0),
+	  m_TotalPixels(0),
+	  m_FrameCount(0)
+{
+}
+
+RetainedScene::~RetainedScene(void)
+{
+}
+
+void RetainedScene::Reset(int width, int height)
+{
+	m_Items.clear() ;
+	m_Dirty.Reset(width, height) ;
+	m_Dirty.AddAll() ;
+}
+
+int RetainedScene::AddItem(const SceneRect& bounds)
+{
+	m_Items.push_back(bounds) ;
+	m_Dirty.Add(bounds) ;
+	return (int)m_Items.size() - 1 ;
+}
+
+void RetainedScene::MoveItem(int item, const SceneRect& bounds)
+{
+	SceneRect& old = m_Items[item] ;
+	if (old.left != bounds.left || old.top != bounds.top || old.right != bounds.right || old.bottom != bounds.bottom)
+	{
+		m_Dirty.Add(old) ;
+		m_Dirty.Add(bounds) ;
+		old = bounds ;
+	}
+}
+
+void RetainedScene::InvalidateItem(int item)
+{
+	m_Dirty.Add(m_Items[item]) ;
+}
+
+void RetainedScene::Invalidate(const SceneRect& rect)
+{
+	m_Dirty.Add(rect) ;
+}
+
+void RetainedScene::InvalidateAll()
+{
+	m_Dirty.AddAll() ;
+}
+
+void RetainedScene::EndFrame()
+{
+	m_LastFramePixels = m_Dirty.PixelCount() ;
+	m_TotalPixels += m_LastFramePixels ;
+	++m_FrameCount ;
+	m_Dirty.Clear() ;
+}
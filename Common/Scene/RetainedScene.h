@@ -0,0 +1,134 @@
+#ifndef __RETAINED_SCENE_H__
+#define __RETAINED_SCENE_H__
+
+#include <vector>
+
+/*
+What changed in a retained scene since the last frame, for repainting only that.
+
+The demos used to clear and draw the whole window on every WM_PAINT, while a move in
+PuzzlePanel changes two pieces and a tick of the clock moves three thin hands. A scene
+keeps the bounds of its items; moving or changing an item marks its old and new bounds
+dirty, and the frame clips to the dirty rectangles and draws only the items that touch
+them. The render target keeps its pixels between frames, so everything outside the
+dirty rectangles is still right.
+
+DirtyRegion keeps the rectangles apart from each other in whole pixels. A rectangle
+that overlaps another, or fills most of the union with it, is merged into it, and the
+number of rectangles stays below MAX_DIRTY_RECTS by merging the pair that wastes the
+fewest pixels. The region does not know about Direct2D, so it can be checked on any
+machine.
+*/
+
+// Rectangle in pixels with edges between pixels, right and bottom excluded
+struct DirtyRect
+{
+	int left ;
+	int top ;
+	int right ;
+	int bottom ;
+};
+
+// Bounds of an item in the coordinates it is drawn in, may cover parts of pixels
+struct SceneRect
+{
+	float left ;
+	float top ;
+	float right ;
+	float bottom ;
+};
+
+static const int MAX_DIRTY_RECTS = 8 ;
+
+class DirtyRegion
+{
+public:
+	DirtyRegion(void);
+	~DirtyRegion(void);
+
+	// Set the size of the target and clear the region
+	void Reset(int width, int height) ;
+
+	void Clear() { m_Rects.clear() ; }
+
+	// Add the pixels rect touches, clipped to the target
+	void Add(const SceneRect& rect) ;
+
+	void AddAll() ;
+
+	bool IsEmpty() const { return m_Rects.empty() ; }
+
+	int Count() const { return (int)m_Rects.size() ; }
+
+	const DirtyRect& Rect(int index) const { return m_Rects[index] ; }
+
+	// Whether rect touches a pixel of the region
+	bool Intersects(const SceneRect& rect) const ;
+
+	// Pixels in the region, every pixel once
+	unsigned int PixelCount() const ;
+
+	int Width() const { return m_Width ; }
+
+	int Height() const { return m_Height ; }
+
+private:
+	void Insert(DirtyRect rect) ;
+
+	int m_Width ;
+	int m_Height ;
+	std::vector<DirtyRect> m_Rects ;
+};
+
+class RetainedScene
+{
+public:
+	RetainedScene(void);
+	~RetainedScene(void);
+
+	// Remove the items and size the target, the whole target is dirty
+	void Reset(int width, int height) ;
+
+	// Add an item, its bounds are dirty. Return its number.
+	int AddItem(const SceneRect& bounds) ;
+
+	int ItemCount() const { return (int)m_Items.size() ; }
+
+	const SceneRect& Bounds(int item) const { return m_Items[item] ; }
+
+	// Move an item, its old and new bounds are dirty when they differ
+	void MoveItem(int item, const SceneRect& bounds) ;
+
+	// The item looks different in the same bounds
+	void InvalidateItem(int item) ;
+
+	// Pixels to draw again, as for a part of the window that was covered
+	void Invalidate(const SceneRect& rect) ;
+
+	void InvalidateAll() ;
+
+	bool NeedsDraw() const { return !m_Dirty.IsEmpty() ; }
+
+	const DirtyRegion& Dirty() const { return m_Dirty ; }
+
+	// Whether an item has to be drawn in this frame
+	bool IsItemDirty(int item) const { return m_Dirty.Intersects(m_Items[item]) ; }
+
+	// Call when the dirty region was drawn, counts its pixels and clears it
+	void EndFrame() ;
+
+	unsigned int LastFramePixels() const { return m_LastFramePixels ; }
+
+	unsigned long long TotalPixels() const { return m_TotalPixels ; }
+
+	unsigned int FrameCount() const { return m_FrameCount ; }
+
+private:
+	std::vector<SceneRect> m_Items ;
+	DirtyRegion m_Dirty ;
+	unsigned int m_LastFramePixels ;
+	unsigned long long m_TotalPixels ;
+	unsigned int m_FrameCount ;
+};
+
+#endif // end __RETAINED_SCENE_H__
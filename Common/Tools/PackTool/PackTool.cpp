@@ -0,0 +1,276 @@
+/*
+Build and inspect asset packs (Common/Asset/AssetPack.h).
+
+	PackTool create <out.pack> [-lz4] [-align N] [-C dir] <input>...
+	PackTool list <in.pack>
+	PackTool verify <in.pack>
+
+An input is a file or a directory, added with its path relative to the -C directory as
+the entry name, or name=path to add a file from anywhere under another name. The packs
+the demos look for, built from the repository root:
+
+	PackTool create Direct2D/PuzzlePanel/PuzzlePanel.pack -C Direct2D/PuzzlePanel picture.jpg
+	PackTool create Direct2D/JigsawPuzzle/JigsawPuzzle.pack -C Direct2D/JigsawPuzzle picture.jpg
+	PackTool create DirectX9/RubikCube/RubikCube.pack -lz4 -C DirectX9/RubikCube 0.x 1.x 2.x 3.x 4.x 5.x
+		6.x 7.x 8.x 9.x 10.x 11.x 12.x 13.x 14.x 15.x 16.x 17.x 18.x 19.x 20.x 21.x 22.x 23.x 24.x 25.x 26.x
+	PackTool create DirectWrite/LetterHunter/LetterHunter.pack -lz4 -C DirectWrite/LetterHunter Media
+		Media/Font/timesbd.ttf=C:/Windows/Fonts/timesbd.ttf Media/Font/ariblk.ttf=C:/Windows/Fonts/ariblk.ttf
+
+Builds on Linux as well:
+	g++ -O2 -I../../Asset PackTool.cpp ../../Asset/AssetPack.cpp ../../Asset/PackWriter.cpp \
+		../../Asset/Lz4.cpp ../../Utility/MappedFile.cpp -o PackTool
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "AssetPack.h"
+#include "PackWriter.h"
+
+static std::string JoinPath(const std::string& dir, const std::string& name)
+{
+	if (dir.empty() || dir == ".")
+	{
+		return name ;
+	}
+	return dir + "/" + name ;
+}
+
+// Names of the files and directories in dir, without "." and ".."
+static bool ListDirectory(const std::string& dir, std::vector<std::string>& files, std::vector<std::string>& dirs)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA data ;
+	HANDLE find = FindFirstFileA((dir + "/*").c_str(), &data) ;
+	if (find == INVALID_HANDLE_VALUE)
+	{
+		return false ;
+	}
+
+	do
+	{
+		if (strcmp(data.cFileName, ".") == 0 || strcmp(data.cFileName, "..") == 0)
+		{
+			continue ;
+		}
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			dirs.push_back(data.cFileName) ;
+		}
+		else
+		{
+			files.push_back(data.cFileName) ;
+		}
+	} while (FindNextFileA(find, &data)) ;
+
+	FindClose(find) ;
+	return true ;
+#else
+	DIR* handle = opendir(dir.c_str()) ;
+	if (!handle)
+	{
+		return false ;
+	}
+
+	while (dirent* entry = readdir(handle))
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+		{
+			continue ;
+		}
+
+		struct stat info ;
+		if (stat(JoinPath(dir, entry->d_name).c_str(), &info) != 0)
+		{
+			continue ;
+		}
+		if (S_ISDIR(info.st_mode))
+		{
+			dirs.push_back(entry->d_name) ;
+		}
+		else
+		{
+			files.push_back(entry->d_name) ;
+		}
+	}
+
+	closedir(handle) ;
+	return true ;
+#endif
+}
+
+static bool IsDirectory(const std::string& path)
+{
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(path.c_str()) ;
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) ;
+#else
+	struct stat info ;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode) ;
+#endif
+}
+
+// Add a file, or every file below a directory, name is relative to the base directory
+static bool AddInput(PackWriter& writer, const std::string& base, const std::string& name)
+{
+	std::string path = JoinPath(base, name) ;
+	if (!IsDirectory(path))
+	{
+		if (!writer.AddFile(name.c_str(), path.c_str()))
+		{
+			printf("%s: %s\n", path.c_str(), writer.ErrorText()) ;
+			return false ;
+		}
+		return true ;
+	}
+
+	std::vector<std::string> files ;
+	std::vector<std::string> dirs ;
+	if (!ListDirectory(path, files, dirs))
+	{
+		printf("%s: cannot list directory\n", path.c_str()) ;
+		return false ;
+	}
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		if (!AddInput(writer, base, name + "/" + files[i]))
+		{
+			return false ;
+		}
+	}
+	for (size_t i = 0; i < dirs.size(); ++i)
+	{
+		if (!AddInput(writer, base, name + "/" + dirs[i]))
+		{
+			return false ;
+		}
+	}
+	return true ;
+}
+
+static int Create(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("missing pack file name\n") ;
+		return 1 ;
+	}
+
+	const char* packPath = argv[2] ;
+	std::string base ;
+	PackWriter writer ;
+
+	for (int i = 3; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-lz4") == 0)
+		{
+			writer.SetCompression(true) ;
+		}
+		else if (strcmp(argv[i], "-align") == 0 && i + 1 < argc)
+		{
+			writer.SetAlignment((unsigned int)atoi(argv[++i])) ;
+		}
+		else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+		{
+			base = argv[++i] ;
+		}
+		else if (const char* equals = strchr(argv[i], '='))
+		{
+			std::string name(argv[i], equals - argv[i]) ;
+			if (!writer.AddFile(name.c_str(), equals + 1))
+			{
+				printf("%s: %s\n", equals + 1, writer.ErrorText()) ;
+				return 1 ;
+			}
+		}
+		else if (!AddInput(writer, base, argv[i]))
+		{
+			return 1 ;
+		}
+	}
+
+	if (!writer.Write(packPath))
+	{
+		printf("%s: %s\n", packPath, writer.ErrorText()) ;
+		return 1 ;
+	}
+
+	const PackWriterStats& stats = writer.Stats() ;
+	printf("%s: %d entries, %d compressed, %.1f KB of files in %.1f KB\n",
+		packPath, stats.entries, stats.compressed, stats.bytes / 1024.0, stats.packSize / 1024.0) ;
+	return 0 ;
+}
+
+static int Inspect(int argc, char* argv[], bool verify)
+{
+	if (argc < 3)
+	{
+		printf("missing pack file name\n") ;
+		return 1 ;
+	}
+
+	AssetPack pack ;
+	if (!pack.Open(argv[2]))
+	{
+		printf("%s: %s\n", argv[2], PackErrorText(pack.Error())) ;
+		return 1 ;
+	}
+
+	int bad = 0 ;
+	for (int i = 0; i < pack.Count(); ++i)
+	{
+		const PackEntry& entry = pack.Entry(i) ;
+		if (verify)
+		{
+			bool ok = pack.Verify(i) ;
+			if (!ok)
+			{
+				++bad ;
+			}
+			printf("%-6s %s\n", ok ? "ok" : "BAD", pack.Name(i)) ;
+		}
+		else
+		{
+			printf("%10llu %10llu %-4s %s\n", entry.size, entry.packedSize,
+				entry.compression == PACK_LZ4 ? "lz4" : "", pack.Name(i)) ;
+		}
+	}
+
+	if (verify)
+	{
+		printf("%d entries, %d damaged\n", pack.Count(), bad) ;
+	}
+	return bad ? 1 : 0 ;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc >= 2 && strcmp(argv[1], "create") == 0)
+	{
+		return Create(argc, argv) ;
+	}
+	if (argc >= 2 && strcmp(argv[1], "list") == 0)
+	{
+		return Inspect(argc, argv, false) ;
+	}
+	if (argc >= 2 && strcmp(argv[1], "verify") == 0)
+	{
+		return Inspect(argc, argv, true) ;
+	}
+
+	printf("usage:\n") ;
+	printf("  PackTool create <out.pack> [-lz4] [-align N] [-C dir] <file | dir | name=path>...\n") ;
+	printf("  PackTool list <in.pack>\n") ;
+	printf("  PackTool verify <in.pack>\n") ;
+	return 1 ;
+}
@@ -0,0 +1,264 @@
+#include "GameLoop.h"
+#include "Timer.h"
+
+#include <thread>
+
+#ifdef _WIN32
+#include <MMSystem.h>
+#pragma comment(lib, "winmm.lib")
+
+// Windows 10 1803 and later, the SDK of VS2012 does not know it
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// How early a wait returns to spin the rest, more than the timer may wake up late
+static const double HIGH_RESOLUTION_SPIN_MS = 0.5 ;
+static const double SPIN_MS = 2.0 ;
+#else
+#include <time.h>
+
+static const double SPIN_MS = 0.1 ;
+#endif
+
+static const double DEFAULT_INACTIVE_FRAME_RATE = 15.0 ;
+
+static long long RateToTicks(double rate)
+{
+	return rate > 0.0 ? (long long)(TimerFrequency() / rate + 0.5) : 0 ;
+}
+
+static long long MsToTicks(double ms)
+{
+	return (long long)(ms * TimerFrequency() / 1000.0 + 0.5) ;
+}
+
+GameLoop::GameLoop(double updateRate, double frameRate)
+	: m_StepSeconds(1.0 / (updateRate > 0.0 ? updateRate : 60.0)),
+	  m_StepTicks(RateToTicks(updateRate > 0.0 ? updateRate : 60.0)),
+	  m_FrameTicks(RateToTicks(frameRate)),
+	  m_InactiveFrameTicks(RateToTicks(DEFAULT_INACTIVE_FRAME_RATE)),
+	  m_bActive(true),
+	  m_UpdateCount(0),
+	  m_FrameCount(0),
+	  m_IdlePercent(0.0),
+	  m_MeasuredFrameRate(0.0)
+{
+#ifdef _WIN32
+	m_hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS) ;
+	m_bHighResolution = m_hTimer != NULL ;
+	if (!m_hTimer)
+	{
+		// A normal timer wakes up on the ticks of the timer period, 15.6 ms unless lowered
+		m_hTimer = CreateWaitableTimer(NULL, FALSE, NULL) ;
+		timeBeginPeriod(1) ;
+	}
+	m_ExitCode = 0 ;
+#endif
+
+	Reset() ;
+}
+
+GameLoop::~GameLoop(void)
+{
+#ifdef _WIN32
+	if (m_hTimer)
+	{
+		CloseHandle(m_hTimer) ;
+	}
+	if (!m_bHighResolution)
+	{
+		timeEndPeriod(1) ;
+	}
+#endif
+}
+
+void GameLoop::SetFrameRate(double frameRate)
+{
+	m_FrameTicks = RateToTicks(frameRate) ;
+}
+
+void GameLoop::SetInactiveFrameRate(double frameRate)
+{
+	m_InactiveFrameTicks = RateToTicks(frameRate) ;
+}
+
+void GameLoop::SetActive(bool active)
+{
+	m_bActive = active ;
+}
+
+void GameLoop::Reset()
+{
+	m_bStarted = false ;
+	m_LastTicks = 0 ;
+	m_Accumulator = 0 ;
+	m_NextFrame = 0 ;
+	m_StatsStart = 0 ;
+	m_IdleTicks = 0 ;
+	m_StatsFrames = 0 ;
+}
+
+int GameLoop::Advance(long long now)
+{
+	if (!m_bStarted)
+	{
+		m_bStarted = true ;
+		m_LastTicks = now ;
+		m_NextFrame = now ;
+		m_StatsStart = now ;
+	}
+
+	long long elapsed = now - m_LastTicks ;
+	long long maxElapsed = MsToTicks(MAX_FRAME_MS) ;
+	m_LastTicks = now ;
+	m_Accumulator += elapsed < maxElapsed ? (elapsed > 0 ? elapsed : 0) : maxElapsed ;
+
+	int steps = (int)(m_Accumulator / m_StepTicks) ;
+	m_Accumulator -= steps * m_StepTicks ;
+	m_UpdateCount += steps ;
+
+	++m_FrameCount ;
+	++m_StatsFrames ;
+	if (now - m_StatsStart >= MsToTicks(STATS_WINDOW_MS))
+	{
+		double ms = TicksToMs(now - m_StatsStart) ;
+		m_IdlePercent = 100.0 * TicksToMs(m_IdleTicks) / ms ;
+		m_MeasuredFrameRate = m_StatsFrames * 1000.0 / ms ;
+		m_StatsStart = now ;
+		m_IdleTicks = 0 ;
+		m_StatsFrames = 0 ;
+	}
+
+	return steps ;
+}
+
+int GameLoop::BeginFrame()
+{
+	return Advance(TimerTicks()) ;
+}
+
+void GameLoop::WaitForNextFrame()
+{
+	WaitForFrame(false) ;
+}
+
+bool GameLoop::WaitForFrame(bool pump)
+{
+	long long period = m_bActive ? m_FrameTicks : m_InactiveFrameTicks ;
+	if (period == 0)
+	{
+		return true ;
+	}
+
+	// More than a frame late, start again from now instead of hurrying to catch up
+	long long now = TimerTicks() ;
+	m_NextFrame += period ;
+	if (now - m_NextFrame > period)
+	{
+		m_NextFrame = now ;
+	}
+
+	return WaitUntil(m_NextFrame, pump) ;
+}
+
+bool GameLoop::WaitUntil(long long deadline, bool pump)
+{
+#ifdef _WIN32
+	long long spinTicks = MsToTicks(m_bHighResolution ? HIGH_RESOLUTION_SPIN_MS : SPIN_MS) ;
+#else
+	long long spinTicks = MsToTicks(SPIN_MS) ;
+	(void)pump ;		// no message queue to pump outside Windows
+#endif
+
+	for (;;)
+	{
+		long long now = TimerTicks() ;
+		long long remaining = deadline - now ;
+		if (remaining <= 0)
+		{
+			return true ;
+		}
+
+		if (remaining <= spinTicks)
+		{
+			std::this_thread::yield() ;
+			continue ;
+		}
+
+#ifdef _WIN32
+		// Relative due time in 100 ns units
+		LARGE_INTEGER due ;
+		due.QuadPart = -(long long)(TicksToMs(remaining - spinTicks) * 10000.0) ;
+		DWORD result = WAIT_TIMEOUT ;
+		DWORD messageResult = WAIT_OBJECT_0 ;
+		if (m_hTimer && SetWaitableTimer(m_hTimer, &due, 0, NULL, NULL, FALSE))
+		{
+			messageResult = WAIT_OBJECT_0 + 1 ;
+			result = pump ? MsgWaitForMultipleObjectsEx(1, &m_hTimer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE)
+						  : WaitForSingleObject(m_hTimer, INFINITE) ;
+		}
+		else if (pump)
+		{
+			result = MsgWaitForMultipleObjectsEx(0, NULL, (DWORD)TicksToMs(remaining - spinTicks), QS_ALLINPUT, MWMO_INPUTAVAILABLE) ;
+		}
+		else
+		{
+			Sleep((DWORD)TicksToMs(remaining - spinTicks)) ;
+		}
+		m_IdleTicks += TimerTicks() - now ;
+
+		if (pump && result == messageResult && !PumpMessages())
+		{
+			return false ;
+		}
+#else
+		long long wake = deadline - spinTicks ;
+		timespec ts ;
+		ts.tv_sec = (time_t)(wake / 1000000000LL) ;
+		ts.tv_nsec = (long)(wake % 1000000000LL) ;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ;
+		m_IdleTicks += TimerTicks() - now ;
+#endif
+	}
+}
+
+#ifdef _WIN32
+bool GameLoop::PumpMessages()
+{
+	MSG msg ;
+	while (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE))
+	{
+		if (msg.message == WM_QUIT)
+		{
+			m_ExitCode = (int)msg.wParam ;
+			return false ;
+		}
+		TranslateMessage(&msg) ;
+		DispatchMessage(&msg) ;
+	}
+	return true ;
+}
+
+int GameLoop::Run(const std::function<void (double stepSeconds)>& update, const std::function<void (double alpha)>& render)
+{
+	Reset() ;
+
+	while (PumpMessages())
+	{
+		int steps = BeginFrame() ;
+		for (int i = 0; i < steps; ++i)
+		{
+			update(m_StepSeconds) ;
+		}
+		render(Alpha()) ;
+
+		if (!WaitForFrame(true))
+		{
+			break ;
+		}
+	}
+
+	return m_ExitCode ;
+}
+#endif
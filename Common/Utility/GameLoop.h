@@ -0,0 +1,118 @@
+#ifndef __GAME_LOOP_H__
+#define __GAME_LOOP_H__
+
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/*
+Main loop with a fixed simulation step and a paced frame rate.
+
+Advance adds the time since the last frame to an accumulator and returns how many
+updates of StepSeconds are due, so the simulation sees the same step at any frame
+rate. What is left over, less than a step, is Alpha: draw the state that far between
+the previous and the current update to hide the steps. A frame longer than
+MAX_FRAME_MS only counts as MAX_FRAME_MS, after a breakpoint or a dragged window the
+simulation slows down instead of running hundreds of updates to catch up.
+
+WaitForNextFrame sleeps until the next frame is due instead of spinning, on Windows in
+a high resolution waitable timer where the system has one (Windows 10 1803), else in
+a normal one with the timer period lowered to 1 ms; only the last fraction of a ms is
+spun. Run is the message loop of the demos on top of this: it waits in
+MsgWaitForMultipleObjects, so input is handled while the loop sleeps.
+
+IdlePercent and FrameRate are measured over windows of STATS_WINDOW_MS. Without a
+window system Run is missing, the rest runs on Linux for the benchmarks.
+*/
+
+class GameLoop
+{
+public:
+	// updateRate fixed updates per second, frameRate frames per second, 0 for no limit
+	explicit GameLoop(double updateRate = 60.0, double frameRate = 60.0);
+	~GameLoop(void);
+
+	void SetFrameRate(double frameRate) ;
+
+	// The frame rate while the window is inactive or minimized, 15 by default
+	void SetInactiveFrameRate(double frameRate) ;
+
+	// Switch between the two frame rates, from WM_ACTIVATE and WM_SIZE
+	void SetActive(bool active) ;
+	bool IsActive() const { return m_bActive ; }
+
+	// Updates due at time now, in ticks of Timer.h. BeginFrame uses the current time.
+	int Advance(long long now) ;
+	int BeginFrame() ;
+
+	// Seconds simulated by one update
+	double StepSeconds() const { return m_StepSeconds ; }
+
+	// Fraction of a step between the last update and the time of the frame, in [0, 1)
+	double Alpha() const { return (double)m_Accumulator / m_StepTicks ; }
+
+	// Sleep until the next frame is due, return at once without a frame rate limit
+	void WaitForNextFrame() ;
+
+	// Start again from now, the time before, a pause say, is not simulated
+	void Reset() ;
+
+	unsigned long long UpdateCount() const { return m_UpdateCount ; }
+	unsigned long long FrameCount() const { return m_FrameCount ; }
+
+	// Share of the time spent sleeping in WaitForNextFrame, and frames per second
+	double IdlePercent() const { return m_IdlePercent ; }
+	double FrameRate() const { return m_MeasuredFrameRate ; }
+
+#ifdef _WIN32
+	// Pump the messages of the calling thread, call update for every step due and render
+	// once per frame with Alpha, until WM_QUIT. Return the exit code of WM_QUIT.
+	int Run(const std::function<void (double stepSeconds)>& update, const std::function<void (double alpha)>& render) ;
+#endif
+
+	static const int MAX_FRAME_MS = 250 ;
+	static const int STATS_WINDOW_MS = 1000 ;
+
+private:
+	// Wait for the next frame or until deadline, with pump handle messages while waiting.
+	// False when WM_QUIT was seen.
+	bool WaitForFrame(bool pump) ;
+	bool WaitUntil(long long deadline, bool pump) ;
+
+#ifdef _WIN32
+	bool PumpMessages() ;
+#endif
+
+	double m_StepSeconds ;
+	long long m_StepTicks ;
+	long long m_FrameTicks ;			// 0 without a limit
+	long long m_InactiveFrameTicks ;
+	bool m_bActive ;
+
+	bool m_bStarted ;					// Advance was called since the last Reset
+	long long m_LastTicks ;				// time of the last Advance
+	long long m_Accumulator ;			// ticks not simulated yet
+	long long m_NextFrame ;				// when the next frame is due
+
+	unsigned long long m_UpdateCount ;
+	unsigned long long m_FrameCount ;
+
+	long long m_StatsStart ;
+	long long m_IdleTicks ;				// slept in the current stats window
+	unsigned int m_StatsFrames ;
+	double m_IdlePercent ;
+	double m_MeasuredFrameRate ;
+
+#ifdef _WIN32
+	HANDLE m_hTimer ;
+	bool m_bHighResolution ;			// the timer needs no lowered timer period
+	int m_ExitCode ;					// of WM_QUIT when the pump saw it
+#endif
+
+	GameLoop(const GameLoop&) ;
+	GameLoop& operator=(const GameLoop&) ;
+};
+
+#endif // end __GAME_LOOP_H__
@@ -0,0 +1,152 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile(void)
+	: m_pData(NULL),
+	  m_Size(0),
+	  m_bOpen(false)
+#ifdef _WIN32
+	  , m_hMapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile(void)
+{
+	Close() ;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close() ;
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) ;
+	return Map(file) ;
+}
+
+bool MappedFile::Open(const wchar_t* path)
+{
+	Close() ;
+	HANDLE file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL) ;
+	return Map(file) ;
+}
+
+bool MappedFile::Map(void* file)
+{
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false ;
+	}
+
+	LARGE_INTEGER size ;
+	if (!GetFileSizeEx(file, &size) || (unsigned long long)size.QuadPart > (size_t)-1)
+	{
+		CloseHandle(file) ;
+		return false ;
+	}
+
+	// A mapping of an empty file cannot be created
+	if (size.QuadPart == 0)
+	{
+		CloseHandle(file) ;
+		m_bOpen = true ;
+		return true ;
+	}
+
+	// The mapping keeps the file open, the handle is not needed any more
+	m_hMapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL) ;
+	CloseHandle(file) ;
+	if (!m_hMapping)
+	{
+		return false ;
+	}
+
+	m_pData = (const unsigned char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0) ;
+	if (!m_pData)
+	{
+		CloseHandle(m_hMapping) ;
+		m_hMapping = NULL ;
+		return false ;
+	}
+
+	m_Size = (size_t)size.QuadPart ;
+	m_bOpen = true ;
+	return true ;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData) ;
+	}
+	if (m_hMapping)
+	{
+		CloseHandle(m_hMapping) ;
+	}
+
+	m_pData = NULL ;
+	m_hMapping = NULL ;
+	m_Size = 0 ;
+	m_bOpen = false ;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close() ;
+
+	int fd = open(path, O_RDONLY) ;
+	if (fd < 0)
+	{
+		return false ;
+	}
+
+	struct stat info ;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd) ;
+		return false ;
+	}
+
+	if (info.st_size > 0)
+	{
+		// The mapping stays valid after the descriptor is closed
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) ;
+		if (data == MAP_FAILED)
+		{
+			close(fd) ;
+			return false ;
+		}
+		m_pData = (const unsigned char*)data ;
+		m_Size = (size_t)info.st_size ;
+	}
+
+	close(fd) ;
+	m_bOpen = true ;
+	return true ;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+	{
+		munmap((void*)m_pData, m_Size) ;
+	}
+
+	m_pData = NULL ;
+	m_Size = 0 ;
+	m_bOpen = false ;
+}
+
+#endif
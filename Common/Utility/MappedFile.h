@@ -0,0 +1,51 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <stddef.h>
+
+/*
+Read-only memory mapping of a whole file.
+
+Loading through a mapping costs one system call for the file instead of a seek and a
+read per field, and the data is paged in by the OS when it is touched, so parsers can
+hand out pointers into the file instead of copying it. The pointers are valid until the
+file is closed.
+*/
+class MappedFile
+{
+public:
+	MappedFile(void);
+	~MappedFile(void);
+
+	// Map the file, any file mapped before is closed first. Empty files open with no data.
+	bool Open(const char* path) ;
+#ifdef _WIN32
+	bool Open(const wchar_t* path) ;
+#endif
+
+	void Close() ;
+
+	bool IsOpen() const { return m_bOpen ; }
+
+	const unsigned char* Data() const { return m_pData ; }
+
+	size_t Size() const { return m_Size ; }
+
+private:
+#ifdef _WIN32
+	bool Map(void* file) ;
+#endif
+
+	const unsigned char* m_pData ;
+	size_t m_Size ;
+	bool m_bOpen ;
+
+#ifdef _WIN32
+	void* m_hMapping ;
+#endif
+
+	MappedFile(const MappedFile&) ;
+	MappedFile& operator=(const MappedFile&) ;
+};
+
+#endif // end __MAPPED_FILE_H__
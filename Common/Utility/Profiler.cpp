@@ -0,0 +1,341 @@
+#include "Profiler.h"
+#include "Timer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+static const char* FRAME_STAGE = "frame" ;
+
+static std::atomic<unsigned int> s_NextProfilerId(1) ;
+
+// The buffer of the calling thread in the profiler it was last used with
+static PROFILER_THREAD_LOCAL unsigned int t_ProfilerId = 0 ;
+static PROFILER_THREAD_LOCAL void* t_pThreadBuffer = NULL ;
+
+Profiler::Profiler(int historyFrames, int eventsPerThread)
+	: m_Id(s_NextProfilerId++),
+	  m_HistoryFrames(historyFrames > 0 ? historyFrames : 1),
+	  m_EventsPerThread(eventsPerThread > 0 ? eventsPerThread : 1),
+	  m_MaxTraceEvents(0),
+	  m_bTracing(false),
+	  m_StartTicks(TimerTicks()),
+	  m_LastFrameTicks(0),
+	  m_FrameCount(0)
+{
+}
+
+Profiler::~Profiler(void)
+{
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+	{
+		delete m_Threads[i] ;
+	}
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	if (t_ProfilerId == m_Id)
+	{
+		return (ThreadBuffer*)t_pThreadBuffer ;
+	}
+
+	// First event of this thread, or the thread was used with another profiler in between
+	std::lock_guard<std::mutex> lock(m_Mutex) ;
+	std::thread::id id = std::this_thread::get_id() ;
+	ThreadBuffer* pBuffer = NULL ;
+	for (size_t i = 0; i < m_Threads.size() && !pBuffer; ++i)
+	{
+		if (m_Threads[i]->id == id)
+		{
+			pBuffer = m_Threads[i] ;
+		}
+	}
+
+	if (!pBuffer)
+	{
+		pBuffer = new ThreadBuffer ;
+		pBuffer->id = id ;
+		pBuffer->index = (int)m_Threads.size() ;
+		pBuffer->events.resize(m_EventsPerThread) ;
+		pBuffer->head = 0 ;
+		pBuffer->tail = 0 ;
+		pBuffer->dropped = 0 ;
+		m_Threads.push_back(pBuffer) ;
+	}
+
+	t_ProfilerId = m_Id ;
+	t_pThreadBuffer = pBuffer ;
+	return pBuffer ;
+}
+
+void Profiler::Record(const char* name, long long startTicks, long long endTicks)
+{
+	ThreadBuffer* pBuffer = GetThreadBuffer() ;
+	unsigned int head = pBuffer->head.load(std::memory_order_relaxed) ;
+	unsigned int tail = pBuffer->tail.load(std::memory_order_acquire) ;
+	if (head - tail >= (unsigned int)m_EventsPerThread)
+	{
+		pBuffer->dropped.fetch_add(1, std::memory_order_relaxed) ;
+		return ;
+	}
+
+	Event& event = pBuffer->events[head % m_EventsPerThread] ;
+	event.name = name ;
+	event.start = startTicks ;
+	event.end = endTicks ;
+	pBuffer->head.store(head + 1, std::memory_order_release) ;
+}
+
+int Profiler::FindStage(const char* name)
+{
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].key == name)
+		{
+			return (int)i ;
+		}
+	}
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].name == name)
+		{
+			m_Stages[i].key = name ;
+			return (int)i ;
+		}
+	}
+
+	Stage stage ;
+	stage.name = name ;
+	stage.key = name ;
+	stage.times.resize(m_HistoryFrames) ;
+	stage.next = 0 ;
+	stage.count = 0 ;
+	stage.frameMs = 0.0 ;
+	stage.seen = false ;
+	m_Stages.push_back(stage) ;
+	return (int)m_Stages.size() - 1 ;
+}
+
+void Profiler::AddTime(int stage, double ms)
+{
+	m_Stages[stage].frameMs += ms ;
+	m_Stages[stage].seen = true ;
+}
+
+void Profiler::EndFrame()
+{
+	long long now = TimerTicks() ;
+	if (m_LastFrameTicks)
+	{
+		AddTime(FindStage(FRAME_STAGE), TicksToMs(now - m_LastFrameTicks)) ;
+	}
+	m_LastFrameTicks = now ;
+
+	std::vector<ThreadBuffer*> threads ;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		threads = m_Threads ;
+	}
+
+	for (size_t t = 0; t < threads.size(); ++t)
+	{
+		ThreadBuffer* pBuffer = threads[t] ;
+		unsigned int head = pBuffer->head.load(std::memory_order_acquire) ;
+		unsigned int tail = pBuffer->tail.load(std::memory_order_relaxed) ;
+		for (; tail != head; ++tail)
+		{
+			const Event& event = pBuffer->events[tail % m_EventsPerThread] ;
+			int stage = FindStage(event.name) ;
+			AddTime(stage, TicksToMs(event.end - event.start)) ;
+
+			if (m_bTracing && m_Trace.size() < m_MaxTraceEvents)
+			{
+				TraceEvent trace = { stage, pBuffer->index, event.start, event.end } ;
+				m_Trace.push_back(trace) ;
+			}
+		}
+		pBuffer->tail.store(tail, std::memory_order_release) ;
+	}
+
+	// A sample per stage seen in this frame
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		Stage& stage = m_Stages[i] ;
+		if (stage.seen)
+		{
+			stage.times[stage.next] = (float)stage.frameMs ;
+			stage.next = (stage.next + 1) % m_HistoryFrames ;
+			stage.count = stage.count < m_HistoryFrames ? stage.count + 1 : m_HistoryFrames ;
+			stage.frameMs = 0.0 ;
+			stage.seen = false ;
+		}
+	}
+
+	++m_FrameCount ;
+}
+
+void Profiler::Reset()
+{
+	m_Stages.clear() ;
+	m_Trace.clear() ;
+	m_FrameCount = 0 ;
+	m_LastFrameTicks = 0 ;
+}
+
+unsigned int Profiler::DroppedEvents() const
+{
+	std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(m_Mutex)) ;
+	unsigned int dropped = 0 ;
+	for (size_t i = 0; i < m_Threads.size(); ++i)
+	{
+		dropped += m_Threads[i]->dropped.load() ;
+	}
+	return dropped ;
+}
+
+bool Profiler::Summary(const char* name, ProfileSummary& summary) const
+{
+	for (size_t i = 0; i < m_Stages.size(); ++i)
+	{
+		if (m_Stages[i].name == name)
+		{
+			Summary((int)i, summary) ;
+			return true ;
+		}
+	}
+	memset(&summary, 0, sizeof(summary)) ;
+	return false ;
+}
+
+void Profiler::Summary(int stage, ProfileSummary& summary) const
+{
+	const Stage& s = m_Stages[stage] ;
+	memset(&summary, 0, sizeof(summary)) ;
+	summary.count = s.count ;
+	if (s.count == 0)
+	{
+		return ;
+	}
+
+	std::vector<float> sorted(s.times.begin(), s.times.begin() + s.count) ;
+	std::sort(sorted.begin(), sorted.end()) ;
+
+	double total = 0.0 ;
+	for (int i = 0; i < s.count; ++i)
+	{
+		total += sorted[i] ;
+	}
+
+	// Nearest rank, the smallest sample with at least p of the samples at or below it
+	int p50 = (s.count * 50 + 99) / 100 - 1 ;
+	int p99 = (s.count * 99 + 99) / 100 - 1 ;
+
+	summary.minMs = sorted[0] ;
+	summary.meanMs = total / s.count ;
+	summary.p50Ms = sorted[p50 > 0 ? p50 : 0] ;
+	summary.p99Ms = sorted[p99 > 0 ? p99 : 0] ;
+	summary.maxMs = sorted[s.count - 1] ;
+}
+
+std::string Profiler::Report() const
+{
+	std::string report ;
+	char line[256] ;
+
+	ProfileSummary frame ;
+	if (Summary(FRAME_STAGE, frame) && frame.meanMs > 0.0)
+	{
+		sprintf(line, "%.1f fps over %d frames\n", 1000.0 / frame.meanMs, frame.count) ;
+		report += line ;
+	}
+
+	sprintf(line, "%-12s %8s %8s %8s %8s %8s\n", "stage ms", "min", "mean", "p50", "p99", "max") ;
+	report += line ;
+	for (int i = 0; i < (int)m_Stages.size(); ++i)
+	{
+		ProfileSummary summary ;
+		Summary(i, summary) ;
+		sprintf(line, "%-12.12s %8.3f %8.3f %8.3f %8.3f %8.3f\n", m_Stages[i].name.c_str(),
+				summary.minMs, summary.meanMs, summary.p50Ms, summary.p99Ms, summary.maxMs) ;
+		report += line ;
+	}
+	return report ;
+}
+
+void Profiler::StartTrace(size_t maxEvents)
+{
+	m_Trace.clear() ;
+	m_MaxTraceEvents = maxEvents ;
+	m_bTracing = true ;
+}
+
+// Write text as a JSON string
+static void WriteJsonString(FILE* file, const char* text)
+{
+	fputc('"', file) ;
+	for (; *text; ++text)
+	{
+		unsigned char c = (unsigned char)*text ;
+		if (c == '"' || c == '\\')
+		{
+			fputc('\\', file) ;
+			fputc(c, file) ;
+		}
+		else if (c < 0x20)
+		{
+			fprintf(file, "\\u%04x", c) ;
+		}
+		else
+		{
+			fputc(c, file) ;
+		}
+	}
+	fputc('"', file) ;
+}
+
+bool Profiler::WriteChromeTrace(const char* path) const
+{
+	FILE* file = NULL ;
+#ifdef _MSC_VER
+	fopen_s(&file, path, "wb") ;
+#else
+	file = fopen(path, "wb") ;
+#endif
+	if (!file)
+	{
+		return false ;
+	}
+
+	// Complete events, "X", with the start and duration in microseconds
+	fprintf(file, "{\"traceEvents\":[") ;
+	for (size_t i = 0; i < m_Trace.size(); ++i)
+	{
+		const TraceEvent& event = m_Trace[i] ;
+		fprintf(file, i ? ",\n{\"name\":" : "\n{\"name\":") ;
+		WriteJsonString(file, m_Stages[event.stage].name.c_str()) ;
+		fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.thread,
+				TicksToMs(event.start - m_StartTicks) * 1000.0, TicksToMs(event.end - event.start) * 1000.0) ;
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n") ;
+
+	return fclose(file) == 0 ;
+}
+
+ProfileScope::ProfileScope(Profiler& profiler, const char* name)
+	: m_Profiler(profiler),
+	  m_Name(name),
+	  m_Start(TimerTicks())
+{
+}
+
+ProfileScope::~ProfileScope(void)
+{
+	m_Profiler.Record(m_Name, m_Start, TimerTicks()) ;
+}
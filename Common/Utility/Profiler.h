@@ -0,0 +1,159 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+
+/*
+Frame time profiler with named stages.
+
+A ProfileScope measures the block it lives in with the ticks of Timer.h and hands the
+event to the thread's own buffer, a ring with one writer and one reader that needs no
+lock; the lock is taken once per thread, when it records its first event. EndFrame is
+called once per frame on one thread. It takes the events out of every buffer, adds up
+the time of each stage in the frame, and keeps the last frames of every stage, so a
+Summary gives min, mean, median, 99th percentile and max in milliseconds. The time
+between two EndFrame calls is the stage "frame".
+
+Report formats the summaries as a text table for an overlay or the console, and while
+tracing is on the events are also kept for WriteChromeTrace, which writes the JSON that
+chrome://tracing and Perfetto open. Nothing here needs Windows beyond Timer.h, so the
+headless benchmarks can use it too.
+
+A buffer that is full when a frame ends drops the new events and counts them.
+*/
+
+struct ProfileSummary
+{
+	int count ;			// frames the stage was seen in
+	double minMs ;
+	double meanMs ;
+	double p50Ms ;
+	double p99Ms ;
+	double maxMs ;
+};
+
+class Profiler
+{
+public:
+	// Keep the times of the last historyFrames frames, eventsPerThread is the buffer size
+	explicit Profiler(int historyFrames = 240, int eventsPerThread = 4096);
+	~Profiler(void);
+
+	// Add an event of the calling thread, ProfileScope calls this
+	void Record(const char* name, long long startTicks, long long endTicks) ;
+
+	// Collect the events recorded since the last call into the stages
+	void EndFrame() ;
+
+	// Forget the stages and their times
+	void Reset() ;
+
+	unsigned int FrameCount() const { return m_FrameCount ; }
+
+	// Events lost because a thread's buffer was full
+	unsigned int DroppedEvents() const ;
+
+	int StageCount() const { return (int)m_Stages.size() ; }
+
+	const char* StageName(int stage) const { return m_Stages[stage].name.c_str() ; }
+
+	// Summary of a stage over the frames kept, false if it was never recorded
+	bool Summary(const char* name, ProfileSummary& summary) const ;
+	void Summary(int stage, ProfileSummary& summary) const ;
+
+	// A line per stage with its summary, the frame rate first
+	std::string Report() const ;
+
+	// Keep the events of the following frames for WriteChromeTrace, up to maxEvents
+	void StartTrace(size_t maxEvents = 1 << 20) ;
+	void StopTrace() { m_bTracing = false ; }
+
+	bool WriteChromeTrace(const char* path) const ;
+
+private:
+	struct Event
+	{
+		const char* name ;
+		long long start ;
+		long long end ;
+	};
+
+	// The buffer of a thread, written by the thread and read by EndFrame
+	struct ThreadBuffer
+	{
+		std::thread::id id ;
+		int index ;
+		std::vector<Event> events ;
+		std::atomic<unsigned int> head ;	// next event to write
+		std::atomic<unsigned int> tail ;	// next event to read
+		std::atomic<unsigned int> dropped ;
+	};
+
+	struct Stage
+	{
+		std::string name ;
+		const char* key ;				// the pointer last recorded, compared before the text
+		std::vector<float> times ;		// ms per frame, a ring of the last frames
+		int next ;
+		int count ;
+		double frameMs ;				// time of the current frame so far
+		bool seen ;						// recorded in the current frame
+	};
+
+	struct TraceEvent
+	{
+		int stage ;
+		int thread ;
+		long long start ;
+		long long end ;
+	};
+
+	ThreadBuffer* GetThreadBuffer() ;
+	int FindStage(const char* name) ;
+	void AddTime(int stage, double ms) ;
+
+	unsigned int m_Id ;						// tells the thread caches of two profilers apart
+	int m_HistoryFrames ;
+	int m_EventsPerThread ;
+	std::mutex m_Mutex ;					// guards m_Threads
+	std::vector<ThreadBuffer*> m_Threads ;
+	std::vector<Stage> m_Stages ;
+	std::vector<TraceEvent> m_Trace ;
+	size_t m_MaxTraceEvents ;
+	bool m_bTracing ;
+	long long m_StartTicks ;				// time 0 of the trace
+	long long m_LastFrameTicks ;
+	unsigned int m_FrameCount ;
+
+	Profiler(const Profiler&) ;
+	Profiler& operator=(const Profiler&) ;
+};
+
+// Time the enclosing block as the stage name, which must outlive the next EndFrame
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler& profiler, const char* name) ;
+	~ProfileScope(void) ;
+
+private:
+	Profiler& m_Profiler ;
+	const char* m_Name ;
+	long long m_Start ;
+
+	ProfileScope(const ProfileScope&) ;
+	ProfileScope& operator=(const ProfileScope&) ;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+// PROFILE_SCOPE(profiler, "draw") ; times the rest of the block
+#define PROFILE_SCOPE(profiler, name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(profiler, name)
+
+#endif // end __PROFILER_H__
@@ -0,0 +1,27 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+/*
+Pick the instruction set for the vectorised code paths at compile time.
+
+SIMD_SSE2 is on for every x86/x64 build (all the CPUs the demos run on have SSE2),
+SIMD_AVX2 only when the compiler was told to target it (/arch:AVX2 or -mavx2),
+SIMD_NEON for ARM builds. Code must always keep a scalar path for the case none is set.
+*/
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#endif // end __SIMD_H__
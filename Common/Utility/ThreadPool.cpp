@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threadCount)
+	: m_pTask(NULL),
+	  m_Count(0),
+	  m_Next(0),
+	  m_Active(0),
+	  m_Generation(0),
+	  m_bQuit(false)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency() ;
+		if (threadCount <= 0)
+		{
+			threadCount = 1 ;
+		}
+	}
+
+	// The calling thread is the first one
+	for (int i = 1; i < threadCount; ++i)
+	{
+		m_Workers.push_back(std::thread(&ThreadPool::WorkerLoop, this)) ;
+	}
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex) ;
+		m_bQuit = true ;
+	}
+	m_WorkReady.notify_all() ;
+
+	for (size_t i = 0; i < m_Workers.size(); ++i)
+	{
+		m_Workers[i].join() ;
+	}
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void (int)>& task)
+{
+	if (count <= 0)
+	{
+		return ;
+	}
+
+	if (m_Workers.empty() || count == 1)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			task(i) ;
+		}
+		return ;
+	}
+
+	{
+		// A worker that woke up late for the previous loop may still be counted as active,
+		// it must be gone before the loop state is reset.
+		std::unique_lock<std::mutex> lock(m_Mutex) ;
+		m_WorkDone.wait(lock, [this]() { return m_Active == 0 ; }) ;
+
+		m_pTask = &task ;
+		m_Count = count ;
+		m_Next = 0 ;
+		++m_Generation ;
+	}
+	m_WorkReady.notify_all() ;
+
+	// Help with the work
+	for (int i = m_Next++; i < count; i = m_Next++)
+	{
+		task(i) ;
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex) ;
+	m_WorkDone.wait(lock, [this]() { return m_Active == 0 ; }) ;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	unsigned int seen = 0 ;
+
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex) ;
+		m_WorkReady.wait(lock, [&]() { return m_bQuit || m_Generation != seen ; }) ;
+		if (m_bQuit)
+		{
+			return ;
+		}
+
+		seen = m_Generation ;
+		const std::function<void (int)>* task = m_pTask ;
+		int count = m_Count ;
+		++m_Active ;
+		lock.unlock() ;
+
+		for (int i = m_Next++; i < count; i = m_Next++)
+		{
+			(*task)(i) ;
+		}
+
+		lock.lock() ;
+		if (--m_Active == 0)
+		{
+			m_WorkDone.notify_all() ;
+		}
+	}
+}
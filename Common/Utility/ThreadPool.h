@@ -0,0 +1,50 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+/*
+A fixed set of worker threads for data-parallel loops.
+
+ParallelFor hands out the indices of a loop to the workers and to the calling thread,
+and returns when every index was processed. Threads are created once, so the pool can
+be used for every frame without paying for thread creation.
+*/
+class ThreadPool
+{
+public:
+	// threadCount is the total number of threads working on a loop, calling thread included.
+	// 0 means one per hardware thread.
+	explicit ThreadPool(int threadCount = 0);
+	~ThreadPool(void);
+
+	int ThreadCount() const { return (int)m_Workers.size() + 1 ; }
+
+	// Call task(i) for every i in [0, count), in any order and on any thread
+	void ParallelFor(int count, const std::function<void (int)>& task) ;
+
+private:
+	void WorkerLoop() ;
+
+	std::vector<std::thread> m_Workers ;
+	std::mutex m_Mutex ;
+	std::condition_variable m_WorkReady ;
+	std::condition_variable m_WorkDone ;
+
+	const std::function<void (int)>* m_pTask ;	// current loop body
+	int m_Count ;								// current loop size
+	std::atomic<int> m_Next ;					// next index to hand out
+	int m_Active ;								// workers inside the current loop
+	unsigned int m_Generation ;					// incremented for every loop
+	bool m_bQuit ;
+
+	ThreadPool(const ThreadPool&) ;
+	ThreadPool& operator=(const ThreadPool&) ;
+};
+
+#endif // end __THREAD_POOL_H__
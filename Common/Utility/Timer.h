@@ -0,0 +1,67 @@
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+/*
+Monotonic high resolution clock.
+QueryPerformanceCounter on Windows (std::chrono in VS2012 is only ms accurate),
+clock_gettime(CLOCK_MONOTONIC) elsewhere so the benchmarks also run on Linux.
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Current time in ticks
+inline long long TimerTicks()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter ;
+	QueryPerformanceCounter(&counter) ;
+	return counter.QuadPart ;
+#else
+	timespec ts ;
+	clock_gettime(CLOCK_MONOTONIC, &ts) ;
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec ;
+#endif
+}
+
+// Number of ticks per second
+inline long long TimerFrequency()
+{
+#ifdef _WIN32
+	static long long frequency = 0 ;
+	if (frequency == 0)
+	{
+		LARGE_INTEGER f ;
+		QueryPerformanceFrequency(&f) ;
+		frequency = f.QuadPart ;
+	}
+	return frequency ;
+#else
+	return 1000000000LL ;
+#endif
+}
+
+// Convert a tick count to milliseconds
+inline double TicksToMs(long long ticks)
+{
+	return (double)ticks * 1000.0 / (double)TimerFrequency() ;
+}
+
+// Measure elapsed time from construction or the last Restart
+class Timer
+{
+public:
+	Timer() : m_Start(TimerTicks()) {}
+
+	void Restart() { m_Start = TimerTicks() ; }
+
+	double ElapsedMs() const { return TicksToMs(TimerTicks() - m_Start) ; }
+
+private:
+	long long m_Start ;
+};
+
+#endif // end __TIMER_H__
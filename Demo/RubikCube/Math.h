@@ -2,6 +2,7 @@
 #define __MATH_H__
 
 #include <d3dx9.h>
+#include "Geometry.h"
 
 const float float_epsilon = 0.00001f;
 
@@ -14,7 +15,7 @@ struct Box
 
 	Box(){}; 
 
-	Box(D3DXVECTOR3 min_point, D3DXVECTOR3 max_point)
+	Box(const D3DXVECTOR3& min_point, const D3DXVECTOR3& max_point)
 	{
 		this->min_point = min_point;
 		this->max_point = max_point;
@@ -41,7 +42,7 @@ struct Triangle
 	D3DXVECTOR3 v2 ;
 	D3DXVECTOR3 v3 ;
 
-	Triangle(D3DXVECTOR3 v1, D3DXVECTOR3 v2, D3DXVECTOR3 v3)
+	Triangle(const D3DXVECTOR3& v1, const D3DXVECTOR3& v2, const D3DXVECTOR3& v3)
 	{
 		this->v1 = v1 ;
 		this->v2 = v2 ;
@@ -59,7 +60,7 @@ struct Rect
 
 	Rect(){};
 
-	Rect(D3DXVECTOR3 v1, D3DXVECTOR3 v2, D3DXVECTOR3 v3, D3DXVECTOR3 v4)
+	Rect(const D3DXVECTOR3& v1, const D3DXVECTOR3& v2, const D3DXVECTOR3& v3, const D3DXVECTOR3& v4)
 	{
 		this->v1 = v1 ;
 		this->v2 = v2 ;
@@ -76,138 +77,66 @@ struct Ray
 
 	Ray(){}
 
-	Ray(D3DXVECTOR3 origin, D3DXVECTOR3 direction)
+	Ray(const D3DXVECTOR3& origin, const D3DXVECTOR3& direction)
 	{
 		this->origin    = origin;
 		this->direction = direction;
 	}
 };
 
-// Calculate the square distance of two points
-inline float SquareDistance(D3DXVECTOR3 v1, D3DXVECTOR3 v2)
+// D3DXVECTOR3, D3DXPLANE and Ray have the layouts of Vec3, Plane3 and Ray3, the
+// library functions take them without a copy
+inline const Vec3& AsVec3(const D3DXVECTOR3& v)
 {
-	return (v1.x - v2.x) * (v1.x - v2.x) +
-		   (v1.y - v2.y) * (v1.y - v2.y) +
-		   (v1.z - v2.z) * (v1.z - v2.z);
+	return reinterpret_cast<const Vec3&>(v);
 }
 
-// Determine whether a ray intersect with a triangle
-// Parameters
-// orig: origin of the ray
-// dir: direction of the ray
-// v0, v1, v2: vertices of triangle
-// t(out): weight of the intersection for the ray
-// u(out), v(out): barycentric coordinate of intersection
-inline bool RayTriangleIntersection(Ray* ray, Triangle* triangle, D3DXVECTOR3* hit_point)
+inline const Ray3& AsRay3(const Ray& ray)
 {
-	D3DXVECTOR3 orig = ray->origin;
-	D3DXVECTOR3 dir  = ray->direction;
-
-	D3DXVECTOR3 v0 = triangle->v1;
-	D3DXVECTOR3 v1 = triangle->v2;
-	D3DXVECTOR3 v2 = triangle->v3;
-
-	// E1
-	D3DXVECTOR3 E1 = v1 - v0;
-
-	// E2
-	D3DXVECTOR3 E2 = v2 - v0;
-
-	// P
-	D3DXVECTOR3 P;
-	D3DXVec3Cross(&P, &dir, &E2);
-
-	// determinant
-	//float det = E1.Dot(P);
-	float det = D3DXVec3Dot(&E1, &P);
-
-	// keep det > 0, modify T accordingly
-	D3DXVECTOR3 T;
-	if( det >0 )
-	{
-		T = orig - v0;
-	}
-	else
-	{
-		T = v0 - orig;
-		det = -det;
-	}
-
-	// If determinant is near zero, ray lies in plane of triangle
-	if( det < 0.0001f )
-		return false;
+	return reinterpret_cast<const Ray3&>(ray);
+}
 
-	// Calculate u and make sure u <= 1
-	float u = D3DXVec3Dot(&T, &P);
-	if( u < 0.0f || u > det )
-		return false;
+inline const Plane3& AsPlane3(const D3DXPLANE& plane)
+{
+	return reinterpret_cast<const Plane3&>(plane);
+}
 
-	// Q
-	D3DXVECTOR3 Q;
-	D3DXVec3Cross(&Q, &T, &E1);
+// Calculate the square distance of two points
+inline float SquareDistance(const D3DXVECTOR3& v1, const D3DXVECTOR3& v2)
+{
+	return Vec3DistanceSq(AsVec3(v1), AsVec3(v2));
+}
 
-	// Calculate v and make sure u + v <= 1
-	float v = D3DXVec3Dot(&dir, &Q);
-	if( v < 0.0f || u + v > det )
+// Determine whether a ray intersect with a triangle, both sides of the triangle count
+// hit_point(out): the intersection, in front of the ray origin
+inline bool RayTriangleIntersection(const Ray& ray, const Triangle& triangle, D3DXVECTOR3& hit_point)
+{
+	float t, u, v;
+	if (!RayTriangle(AsRay3(ray), AsVec3(triangle.v1), AsVec3(triangle.v2), AsVec3(triangle.v3), t, u, v))
 		return false;
 
-	// Calculate t, scale parameters, ray intersects triangle
-	float t = D3DXVec3Dot(&E2, &Q);
-
-	float fInvDet = 1.0f / det;
-	t *= fInvDet;
-	u *= fInvDet;
-	v *= fInvDet;
-
-	// Intersection point can be calculate by the following two ways
-	// 1. O + Dt
-	// 2. (1 - u - v) * v0 + u * v1 + v * v2
-	// I use the first way.
-	*hit_point = orig + (t * dir);
-
+	hit_point = ray.origin + t * ray.direction;
 	return true;
 }
 
 // Determine Whether a ray intersect with a rectangle
-// Divide the rectangle into two triangles and if the ray intersect with any of them
-inline bool RayRectIntersection(Ray& ray, Rect& rect, D3DXVECTOR3& hit_point)
+// Test the two triangles of the rectangle on its corners, without building Triangles
+inline bool RayRectIntersection(const Ray& ray, const Rect& rect, D3DXVECTOR3& hit_point)
 {
-	// Divide the rectangle into two triangles
-	Triangle t1(rect.v1, rect.v2, rect.v3);
-	Triangle t2(rect.v1, rect.v3, rect.v4) ;
+	float t;
+	if (!RayQuad(AsRay3(ray), AsVec3(rect.v1), AsVec3(rect.v2), AsVec3(rect.v3), AsVec3(rect.v4), t))
+		return false;
 
-	return RayTriangleIntersection(&ray, &t1, &hit_point) || RayTriangleIntersection(&ray, &t2, &hit_point);
+	hit_point = ray.origin + t * ray.direction;
+	return true;
 }
 
 // Determine whether a plane was intersect with a box
-// If all the 8 points of the box exists on the same side of the plane, they are not intersect.
-// else they are intersect.
+// They intersect unless the whole box is on one side of the plane, only the two corners
+// farthest along and against the plane normal need to be tested for that.
 inline bool PlaneBoxIntersection(const D3DXPLANE& plane, const Box& box)
 {
-	// Normalize the plane
-	D3DXPLANE normalized_plane;
-	D3DXPlaneNormalize(&normalized_plane, &plane);
-
-	// Use a variable side_count to count the points
-	// If the point on the positive side, increase the side_count, else decrease the side_count
-	// After all 8 points were tested, if side_count == 8, then all points on the positive side
-	// on the other hand, if side_count == -8, all points exists on the negative side, only return true for 
-	// these two conditions.
-	int side_count = 0;
-	for (int i = 0; i < 8; ++i)
-	{
-		if (D3DXPlaneDotCoord(&normalized_plane, &box.points[i]) > 0.0f)
-		{
-			++side_count;
-		}
-		else
-		{
-			--side_count;
-		}
-	}
-
-	//return (side_count != 8 || side_count != -8);
-	return (side_count > -8 && side_count < 8);
+	return PlaneAabbSide(AsPlane3(plane), Aabb3(AsVec3(box.min_point), AsVec3(box.max_point))) == 0;
 }
 
 #endif //end __MATH_H__
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define __MATH_H__
 
 #include <D3DX10.h>
+#include "Geometry.h"
 
 const float float_epsilon = 0.00001f;
 
@@ -83,98 +84,44 @@ struct Ray
 	}
 };
 
-// Calculate the square distance of two points
-inline float SquareDistance(XMVECTOR v1, XMVECTOR v2)
+// XMVECTOR is four floats in a register, the library works on three in memory
+inline Vec3 ToVec3(FXMVECTOR v)
 {
-	return (XMVectorGetX(v1) - XMVectorGetX(v2)) * (XMVectorGetX(v1) - XMVectorGetX(v2)) +
-		   (XMVectorGetY(v1) - XMVectorGetY(v2)) * (XMVectorGetY(v1) - XMVectorGetY(v2)) +
-		   (XMVectorGetZ(v1) - XMVectorGetZ(v2)) * (XMVectorGetZ(v1) - XMVectorGetZ(v2));
+	XMFLOAT3 f;
+	XMStoreFloat3(&f, v);
+	return Vec3(f.x, f.y, f.z);
 }
 
-// Determine whether a ray intersect with a triangle
-// Parameters
-// orig: origin of the ray
-// dir: direction of the ray
-// v0, v1, v2: vertices of triangle
-// t(out): weight of the intersection for the ray
-// u(out), v(out): barycentric coordinate of intersection
-inline bool RayTriangleIntersection(Ray* ray, Triangle* triangle, XMVECTOR* hit_point)
+// Calculate the square distance of two points
+inline float SquareDistance(FXMVECTOR v1, FXMVECTOR v2)
 {
-	XMVECTOR orig = ray->origin;
-	XMVECTOR dir  = ray->direction;
-
-	XMVECTOR v0 = triangle->v1;
-	XMVECTOR v1 = triangle->v2;
-	XMVECTOR v2 = triangle->v3;
-
-	// E1
-	XMVECTOR E1 = v1 - v0;
-
-	// E2
-	XMVECTOR E2 = v2 - v0;
-
-	// P
-	XMVECTOR P = XMVector3Cross(dir, E2);
-
-	// determinant
-	//float det = E1.Dot(P);
-	float det = XMVectorGetX(XMVector3Dot(E1, P));
-
-	// keep det > 0, modify T accordingly
-	XMVECTOR T;
-	if( det >0 )
-	{
-		T = orig - v0;
-	}
-	else
-	{
-		T = v0 - orig;
-		det = -det;
-	}
-
-	// If determinant is near zero, ray lies in plane of triangle
-	if( det < 0.0001f )
-		return false;
-
-	// Calculate u and make sure u <= 1
-	float u = XMVectorGetX(XMVector3Dot(T, P));
-	if( u < 0.0f || u > det )
-		return false;
-
-	// Q
-	XMVECTOR Q = XMVector3Cross(T, E1);
+	return XMVectorGetX(XMVector3LengthSq(v1 - v2));
+}
 
-	// Calculate v and make sure u + v <= 1
-	float v = XMVectorGetX(XMVector3Dot(dir, Q));
-	if( v < 0.0f || u + v > det )
+// Determine whether a ray intersect with a triangle, both sides of the triangle count
+// hit_point(out): the intersection, in front of the ray origin
+inline bool RayTriangleIntersection(const Ray& ray, const Triangle& triangle, XMVECTOR& hit_point)
+{
+	float t, u, v;
+	Ray3 picking(ToVec3(ray.origin), ToVec3(ray.direction));
+	if (!RayTriangle(picking, ToVec3(triangle.v1), ToVec3(triangle.v2), ToVec3(triangle.v3), t, u, v))
 		return false;
 
-	// Calculate t, scale parameters, ray intersects triangle
-	float t = XMVectorGetX(XMVector3Dot(E2, Q));
-
-	float fInvDet = 1.0f / det;
-	t *= fInvDet;
-	u *= fInvDet;
-	v *= fInvDet;
-
-	// Intersection point can be calculate by the following two ways
-	// 1. O + Dt
-	// 2. (1 - u - v) * v0 + u * v1 + v * v2
-	// I use the first way.
-	*hit_point = orig + (t * dir);
-
+	hit_point = ray.origin + t * ray.direction;
 	return true;
 }
 
 // Determine Whether a ray intersect with a rectangle
-// Divide the rectangle into two triangles and if the ray intersect with any of them
-inline bool RayRectIntersection(Ray& ray, Rect& rect, XMVECTOR& hit_point)
+// Test the two triangles of the rectangle on its corners, without building Triangles
+inline bool RayRectIntersection(const Ray& ray, const Rect& rect, XMVECTOR& hit_point)
 {
-	// Divide the rectangle into two triangles
-	Triangle t1(rect.v1, rect.v2, rect.v3);
-	Triangle t2(rect.v1, rect.v3, rect.v4) ;
+	float t;
+	Ray3 picking(ToVec3(ray.origin), ToVec3(ray.direction));
+	if (!RayQuad(picking, ToVec3(rect.v1), ToVec3(rect.v2), ToVec3(rect.v3), ToVec3(rect.v4), t))
+		return false;
 
-	return RayTriangleIntersection(&ray, &t1, &hit_point) || RayTriangleIntersection(&ray, &t2, &hit_point);
+	hit_point = ray.origin + t * ray.direction;
+	return true;
 }
 
 // Determine whether a plane was intersect with a box
@@ -1,11 +1,13 @@
 /*
 This Demo show you how to load a bitmap from application's resource or from a file
-D2D does not provide bitmap load function, so we use WIC to work with it
+D2D does not provide bitmap load function, so we decode the file with the image library in
+Common/Image and create the bitmap from the decoded pixels
 */
 
 #include <windows.h>
-#include <wincodec.h>
 #include <D2D1.h> // header for Direct2D
+#include "D2DImageCache.h"
+#include "../../Common/Utility/MappedFile.h"
 
 #define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
 #ifndef HINST_THISCOMPONENT
@@ -18,14 +20,13 @@ ID2D1HwndRenderTarget*	pRenderTarget	= NULL;		// Render target
 ID2D1SolidColorBrush*	pBlackBrush		= NULL ;	// A black brush, reflect the line color
 ID2D1SolidColorBrush*	pRedBrush		= NULL ;
 ID2D1Bitmap*			pBitmap			= NULL ;
-IWICImagingFactory*		pWICFactory		= NULL ;
+ImageLoader				imageLoader ;				// Decodes and scales image files
 
 RECT rc ;		// Render area
 HWND g_Hwnd ;	// Window handle
 
 HRESULT LoadResourceBitmap(
 	ID2D1RenderTarget* pRendertarget,
-	IWICImagingFactory* pIWICFactory,
 	PCSTR resourceName,
 	PCSTR resourceType,
 	UINT destinationWidth,
@@ -35,7 +36,6 @@ HRESULT LoadResourceBitmap(
 
 HRESULT LoadBitmapFromFile(
 	ID2D1RenderTarget *pRenderTarget,
-	IWICImagingFactory *pIWICFactory,
 	PCWSTR uri,
 	UINT destinationWidth,
 	UINT destinationHeight,
@@ -56,15 +56,6 @@ VOID CreateD2DResource(HWND hWnd)
 			return ;
 		}
 
-		// Create WIC factory
-		hr = CoCreateInstance(
-			CLSID_WICImagingFactory1,
-			NULL,
-			CLSCTX_INPROC_SERVER,
-			IID_IWICImagingFactory,
-			reinterpret_cast<void **>(&pWICFactory)
-			) ;
-
 		// Obtain the size of the drawing area
 		GetClientRect(hWnd, &rc) ;
 
@@ -107,7 +98,6 @@ VOID CreateD2DResource(HWND hWnd)
 
 		hr = LoadBitmapFromFile(
 			pRenderTarget,
-			pWICFactory,
 			L"sampleImage.jpg",
 			0,
 			0,
@@ -122,10 +112,32 @@ VOID CreateD2DResource(HWND hWnd)
 	}
 }
 
+// Decode an image file in memory and create a bitmap of it. If only one of destinationWidth
+// and destinationHeight is 0 the image keeps its aspect ratio, both 0 keep its size.
+HRESULT LoadBitmapFromMemory(
+							 ID2D1RenderTarget* pRenderTarget,
+							 const unsigned char* pImageFile,
+							 size_t imageFileSize,
+							 UINT destinationWidth,
+							 UINT destinationHeight,
+							 ID2D1Bitmap** ppBitmap
+							 )
+{
+	// The pixels come out as 32bppPBGRA
+	// (DXGI_FORMAT_B8G8R8A8_UNORM + D2D1_ALPHA_MODE_PREMULTIPLIED), scaled if a size was given
+	DecodedImage image ;
+	if (!imageLoader.DecodeData(pImageFile, imageFileSize, destinationWidth, destinationHeight, PIXEL_PBGRA, image))
+	{
+		return E_FAIL ;
+	}
+
+	// Create an ID2D1Bitmap object, that can be drawn by a render target and used with other Direct2D objects
+	return CreateD2DBitmap(pRenderTarget, image, ppBitmap) ;
+}
+
 // Load bitmap from app's resource
 HRESULT LoadResourceBitmap(
 						   ID2D1RenderTarget* pRendertarget,
-						   IWICImagingFactory* pIWICFactory,
 						   PCSTR resourceName,
 						   PCSTR resourceType,
 						   UINT destinationWidth,
@@ -135,12 +147,6 @@ HRESULT LoadResourceBitmap(
 {
 	HRESULT hr = S_OK ;
 
-	IWICBitmapDecoder* pDecoder = NULL ;
-	IWICBitmapFrameDecode* pSource = NULL ;
-	IWICStream* pStream = NULL ;
-	IWICFormatConverter* pConverter = NULL ;
-	IWICBitmapScaler* pScaler = NULL ;
-
 	HRSRC imageResHandle = NULL ;
 	HGLOBAL imageResDataHandle = NULL ;
 	void* pImageFile = NULL ;
@@ -172,126 +178,19 @@ HRESULT LoadResourceBitmap(
 		hr = imageFileSize ? S_OK : E_FAIL ;
 	}
 
-	// Create an IWICStream object
-	if (SUCCEEDED(hr))
-	{
-		// Create a WIC stream to map onto the memory
-		hr = pIWICFactory->CreateStream(&pStream) ;
-	}
-
-	if (SUCCEEDED(hr))
-	{
-		// Initialize the stream with the memory pointer and size
-		hr = pStream->InitializeFromMemory(
-			reinterpret_cast<BYTE*>(pImageFile),
-			imageFileSize
-			) ;
-	}
-
-	// Create IWICBitmapDecoder
-	if (SUCCEEDED(hr))
-	{
-		// Create a decoder for the stream
-		hr = pIWICFactory->CreateDecoderFromStream(
-			pStream,
-			NULL,
-			WICDecodeMetadataCacheOnLoad,
-			&pDecoder
-			) ;
-	}
-
-	// Retrieve a frame from the image and store it in an IWICBitmapFrameDecode object
-	if (SUCCEEDED(hr))
-	{
-		// Create the initial frame
-		hr = pDecoder->GetFrame(0, &pSource) ;
-	}
-
-	// Before Direct2D can use the image, it must be converted to the 32bppPBGRA pixel format.
-	// To convert the image format, use the IWICImagingFactory::CreateFormatConverter method to create an IWICFormatConverter object, then use the IWICFormatConverter object's Initialize method to perform the conversion.
-	if (SUCCEEDED(hr))
-	{
-		// Convert the image format to 32bppPBGRA
-		// (DXGI_FORMAT_B8G8R8A8_UNORM + D2D1_ALPHA_MODE_PREMULTIPLIED).
-		hr = pIWICFactory->CreateFormatConverter(&pConverter) ;
-	}
-
+	// The resource is the file content, decode it in place
 	if (SUCCEEDED(hr))
 	{
-		// If a new width or height was specified, create and
-		// IWICBitmapScaler and use it to resize the image.
-		if (destinationWidth != 0 || destinationHeight != 0)
-		{
-			UINT originalWidth ;
-			UINT originalHeight ;
-			hr = pSource->GetSize(&originalWidth, &originalHeight) ;
-			if (SUCCEEDED(hr))
-			{
-				if (destinationWidth == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationHeight) / static_cast<FLOAT>(originalHeight);
-					destinationWidth = static_cast<UINT>(scalar * static_cast<FLOAT>(originalWidth)) ;
-				}
-				else if (destinationHeight == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationWidth) / static_cast<FLOAT>(originalWidth);
-					destinationHeight = static_cast<UINT>(scalar * static_cast<FLOAT>(originalHeight));
-				}
-
-				hr = pIWICFactory->CreateBitmapScaler(&pScaler) ;
-				if (SUCCEEDED(hr))
-				{
-					hr = pScaler->Initialize(
-						pSource,
-						destinationWidth,
-						destinationHeight,
-						WICBitmapInterpolationModeCubic
-						) ;
-					if (SUCCEEDED(hr))
-					{
-						hr = pConverter->Initialize(
-							pScaler,
-							GUID_WICPixelFormat32bppPBGRA,
-							WICBitmapDitherTypeNone,
-							NULL,
-							0.f,
-							WICBitmapPaletteTypeMedianCut
-							) ;
-					}
-				}
-			}
-		}
-
-		else // use default width and height
-		{
-			hr = pConverter->Initialize(
-				pSource,
-				GUID_WICPixelFormat32bppPBGRA,
-				WICBitmapDitherTypeNone,
-				NULL,
-				0.f,
-				WICBitmapPaletteTypeMedianCut
-				) ;
-		}
-	}
-
-	// Finally, Create an ID2D1Bitmap object, that can be drawn by a render target and used with other Direct2D objects
-	if (SUCCEEDED(hr))
-	{
-		// Create a Direct2D bitmap from the WIC bitmap
-		hr = pRendertarget->CreateBitmapFromWicBitmap(
-			pConverter,
-			NULL,
+		hr = LoadBitmapFromMemory(
+			pRendertarget,
+			static_cast<const unsigned char*>(pImageFile),
+			imageFileSize,
+			destinationWidth,
+			destinationHeight,
 			ppBitmap
 			) ;
 	}
 
-	SAFE_RELEASE(pDecoder) ;
-	SAFE_RELEASE(pSource) ;
-	SAFE_RELEASE(pStream) ;
-	SAFE_RELEASE(pConverter) ;
-	SAFE_RELEASE(pScaler) ;
-
 	return hr ;
 }
 	
@@ -301,114 +200,27 @@ HRESULT LoadResourceBitmap(
 //
 HRESULT LoadBitmapFromFile(
 						   ID2D1RenderTarget *pRenderTarget,
-						   IWICImagingFactory *pIWICFactory,
 						   PCWSTR uri,
 						   UINT destinationWidth,
 						   UINT destinationHeight,
 						   ID2D1Bitmap **ppBitmap
 						   )
 {
-	HRESULT hr = S_OK;
-
-	IWICBitmapDecoder *pDecoder = NULL;
-	IWICBitmapFrameDecode *pSource = NULL;
-	IWICStream *pStream = NULL;
-	IWICFormatConverter *pConverter = NULL;
-	IWICBitmapScaler *pScaler = NULL;
-
-	hr = pIWICFactory->CreateDecoderFromFilename(
-		uri,
-		NULL,
-		GENERIC_READ,
-		WICDecodeMetadataCacheOnLoad,
-		&pDecoder
-		);
-	if (SUCCEEDED(hr))
-	{
-
-		// Create the initial frame.
-		hr = pDecoder->GetFrame(0, &pSource);
-	}
-
-	if (SUCCEEDED(hr))
+	// Map the file and decode it from memory like a resource
+	MappedFile file ;
+	if (!file.Open(uri) || file.Size() == 0)
 	{
-		// Convert the image format to 32bppPBGRA
-		// (DXGI_FORMAT_B8G8R8A8_UNORM + D2D1_ALPHA_MODE_PREMULTIPLIED).
-		hr = pIWICFactory->CreateFormatConverter(&pConverter);
+		return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) ;
 	}
-	if (SUCCEEDED(hr))
-	{
-		// If a new width or height was specified, create an
-		// IWICBitmapScaler and use it to resize the image.
-		if (destinationWidth != 0 || destinationHeight != 0)
-		{
-			UINT originalWidth, originalHeight;
-			hr = pSource->GetSize(&originalWidth, &originalHeight);
-			if (SUCCEEDED(hr))
-			{
-				if (destinationWidth == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationHeight) / static_cast<FLOAT>(originalHeight);
-					destinationWidth = static_cast<UINT>(scalar * static_cast<FLOAT>(originalWidth));
-				}
-				else if (destinationHeight == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationWidth) / static_cast<FLOAT>(originalWidth);
-					destinationHeight = static_cast<UINT>(scalar * static_cast<FLOAT>(originalHeight));
-				}
-
-				hr = pIWICFactory->CreateBitmapScaler(&pScaler);
-				if (SUCCEEDED(hr))
-				{
-					hr = pScaler->Initialize(
-						pSource,
-						destinationWidth,
-						destinationHeight,
-						WICBitmapInterpolationModeCubic
-						);
-				}
-				if (SUCCEEDED(hr))
-				{
-					hr = pConverter->Initialize(
-						pScaler,
-						GUID_WICPixelFormat32bppPBGRA,
-						WICBitmapDitherTypeNone,
-						NULL,
-						0.f,
-						WICBitmapPaletteTypeMedianCut
-						);
-				}
-			}
-		}
-		else // Don't scale the image.
-		{
-			hr = pConverter->Initialize(
-				pSource,
-				GUID_WICPixelFormat32bppPBGRA,
-				WICBitmapDitherTypeNone,
-				NULL,
-				0.f,
-				WICBitmapPaletteTypeMedianCut
-				);
-		}
-	}
-	if (SUCCEEDED(hr))
-	{
-		// Create a Direct2D bitmap from the WIC bitmap.
-		hr = pRenderTarget->CreateBitmapFromWicBitmap(
-			pConverter,
-			NULL,
-			ppBitmap
-			);
-	}
-
-	SAFE_RELEASE(pDecoder);
-	SAFE_RELEASE(pSource);
-	SAFE_RELEASE(pStream);
-	SAFE_RELEASE(pConverter);
-	SAFE_RELEASE(pScaler);
 
-	return hr;
+	return LoadBitmapFromMemory(
+		pRenderTarget,
+		file.Data(),
+		file.Size(),
+		destinationWidth,
+		destinationHeight,
+		ppBitmap
+		) ;
 }
 
 VOID DrawRectangle()
@@ -477,6 +289,7 @@ void DrawBitmap()
 
 VOID Cleanup()
 {
+	SAFE_RELEASE(pBitmap) ;
 	SAFE_RELEASE(pRenderTarget) ;
 	SAFE_RELEASE(pBlackBrush) ;
 	SAFE_RELEASE(pRedBrush) ;
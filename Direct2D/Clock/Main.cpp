@@ -1,5 +1,6 @@
 #include <windows.h>
 #include <D2D1.h> // header for Direct2D
+#include "D2DScene.h"
 
 #define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
 
@@ -32,6 +33,13 @@ D2D1_POINT_2F g_MinuteHandP1 = D2D1::Point2F(0, 0) ;
 D2D1_POINT_2F g_HourHandP0 = D2D1::Point2F(0, 0) ;
 D2D1_POINT_2F g_HourHandP1 = D2D1::Point2F(0, 0) ;
 
+// The face and the hands as scene items, a tick draws where the hands were and are
+RetainedScene g_Scene ;
+int g_FaceItem = -1 ;
+int g_SecondHandItem = -1 ;
+int g_MinuteHandItem = -1 ;
+int g_HourHandItem = -1 ;
+
 VOID CreateD2DResource(HWND hWnd)
 {
 	// This function was called in the DrawRectangle function which in turn called to response the
@@ -55,7 +63,8 @@ VOID CreateD2DResource(HWND hWnd)
 			D2D1::RenderTargetProperties(),
 			D2D1::HwndRenderTargetProperties(
 			hWnd, 
-			D2D1::SizeU(rc.right - rc.left,rc.bottom - rc.top)
+			D2D1::SizeU(rc.right - rc.left,rc.bottom - rc.top),
+			D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS	// keep the face where the hands did not move
 			), 
 			&g_pRenderTarget
 			) ;
@@ -65,6 +74,9 @@ VOID CreateD2DResource(HWND hWnd)
 			return ;
 		}
 
+		// A new target has nothing on it
+		g_Scene.InvalidateAll() ;
+
 		// Create a black brush
 		hr = g_pRenderTarget->CreateSolidColorBrush(
 			D2D1::ColorF(D2D1::ColorF::Black),
@@ -203,6 +215,27 @@ void SetTime()
 	g_HourHandP1 = rotateMatrix.TransformPoint(g_HourHandP1) ;
 }
 
+// The pixels a hand covers, with half the stroke around the line and one more for antialiasing
+SceneRect HandBounds(D2D1_POINT_2F p0, D2D1_POINT_2F p1, float strokeWidth)
+{
+	float margin = strokeWidth / 2 + 1.f ;
+	SceneRect bounds = {
+		(p0.x < p1.x ? p0.x : p1.x) - margin,
+		(p0.y < p1.y ? p0.y : p1.y) - margin,
+		(p0.x > p1.x ? p0.x : p1.x) + margin,
+		(p0.y > p1.y ? p0.y : p1.y) + margin
+	} ;
+	return bounds ;
+}
+
+// Move the hand items to the hands, what they covered and cover now is drawn in the next frame
+void UpdateScene()
+{
+	g_Scene.MoveItem(g_SecondHandItem, HandBounds(g_SecondHandP0, g_SecondHandP1, 5.f)) ;
+	g_Scene.MoveItem(g_MinuteHandItem, HandBounds(g_MinuteHandP0, g_MinuteHandP1, 10.f)) ;
+	g_Scene.MoveItem(g_HourHandItem, HandBounds(g_HourHandP0, g_HourHandP1, 15.f)) ;
+}
+
 void Initialize(HWND hWnd)
 {
 	// Get the client area of main window
@@ -221,6 +254,14 @@ void Initialize(HWND hWnd)
 	//InitializeClockHands() ;
 
 	SetTime() ;
+
+	// The face covers the client area, the hands move on it
+	SceneRect face = { (float)g_ClientRect.left, (float)g_ClientRect.top, (float)g_ClientRect.right, (float)g_ClientRect.bottom } ;
+	g_Scene.Reset(g_ClientRect.right - g_ClientRect.left, g_ClientRect.bottom - g_ClientRect.top) ;
+	g_FaceItem = g_Scene.AddItem(face) ;
+	g_SecondHandItem = g_Scene.AddItem(HandBounds(g_SecondHandP0, g_SecondHandP1, 5.f)) ;
+	g_MinuteHandItem = g_Scene.AddItem(HandBounds(g_MinuteHandP0, g_MinuteHandP1, 10.f)) ;
+	g_HourHandItem = g_Scene.AddItem(HandBounds(g_HourHandP0, g_HourHandP1, 15.f)) ;
 }
 
 void DrawClockOutline()
@@ -344,8 +385,6 @@ void DrawClock()
 	DrawClockDots() ;
 	
 	DrawClockHands() ;
-	
-	InvalidateRect(g_Hwnd, NULL, FALSE) ;
 }
 
 void UpdateClockHand()
@@ -386,20 +425,36 @@ VOID Draw()
 {
 	CreateD2DResource(g_Hwnd) ;
 
+	if (!g_Scene.NeedsDraw())
+	{
+		return ;
+	}
+
 	g_pRenderTarget->BeginDraw() ;
 
-	// Clear background color to dark cyan
-	g_pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
+	// Draw the clock again in the parts that changed only
+	const DirtyRegion& dirty = g_Scene.Dirty() ;
+	for (int i = 0; i < dirty.Count(); ++i)
+	{
+		PushDirtyClip(g_pRenderTarget, dirty.Rect(i)) ;
+
+		// Clear background color to white
+		g_pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
 
-	DrawClock() ;
+		DrawClock() ;
+
+		g_pRenderTarget->PopAxisAlignedClip() ;
+	}
 
 	HRESULT hr = g_pRenderTarget->EndDraw() ;
+	g_Scene.EndFrame() ;
 	if (FAILED(hr))
 	{
 		MessageBox(NULL, "Draw failed!", "Error", 0) ;
+		return ;
 	}
 
-	InvalidateRect(g_Hwnd, NULL, FALSE) ;
+	ShowDrawnPixels(g_Hwnd, "Clock", g_Scene) ;
 }
 
 VOID Cleanup()
@@ -417,6 +472,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 	switch (message)    
 	{
 	case   WM_PAINT:
+		AddUpdateRegion(hwnd, g_Scene) ;
 		Draw() ;
 		ValidateRect(g_Hwnd, NULL) ;
 		return 0 ;
@@ -425,13 +481,16 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		if (wParam == 1) // rotate clock hands
 		{
 			UpdateClockHand() ;
-			InvalidateRect(g_Hwnd, NULL, FALSE) ;
+			UpdateScene() ;
+			InvalidateDirtyRegion(g_Hwnd, g_Scene) ;
 			UpdateWindow(g_Hwnd) ;
 			break ;
 		}
 		if (wParam == 2) // synchronization
 		{
 			SetTime() ;
+			UpdateScene() ;
+			InvalidateDirtyRegion(g_Hwnd, g_Scene) ;
 			break ;
 		}
 		
@@ -1,58 +1,88 @@
 #include <windows.h>
-#include <wincodec.h>
 #include <time.h> // for random number
 #include <D2D1.h> 
+#include "AssetPack.h"
+#include "D2DImageCache.h"
+#include "D2DSpriteBatch.h"
+#include "PuzzleBoard.h"
+#include "D2DScene.h"
+#include <vector>
 
 #define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
 
 ID2D1Factory*				g_pD2DFactory = NULL ;	// Direct2D factory
 ID2D1HwndRenderTarget*		g_pRenderTarget = NULL;	// Render target
 ID2D1SolidColorBrush*		g_pBlackBrush = NULL ;	// A black brush, reflect the line color
-ID2D1Bitmap*				g_pBitmap = NULL ;		// The Entire bitmap, will be split to small parts
-IWICImagingFactory*			g_pWICFactory = NULL ;
+ID2D1Bitmap*				g_pBitmap = NULL ;		// The Entire bitmap, the pieces are drawn from it, owned by g_Images
+AssetPack					g_Assets ;				// Media of the demo, the picture is loaded from the loose file if there is no pack
+D2DImageCache				g_Images ;				// Decoded pictures and their bitmaps
 
 HWND g_Hwnd ;	// Window handle
 D2D1_RECT_U g_PictureRect ;	// The rectangle to hold the picture
-const int g_NumColumns = 4;	// Number of columns
-const int g_NumRows = 4;	// Number of rows
-const int g_NumCells = g_NumColumns * g_NumRows ;
+const int g_MinGrid = 2 ;	// Fewest rows and columns
+const int g_MaxGrid = 50 ;	// Most rows and columns, '+' and '-' change the grid at runtime
+int g_NumColumns = 4;		// Number of columns
+int g_NumRows = 4;			// Number of rows
+int g_NumCells = g_NumColumns * g_NumRows ;
 
-int srcPieceWidth = -1 ; 
-int srcPieceHeight = -1 ;
 int destPieceWidth = -1 ;
 int destPieceHeight = -1 ;
 
-ID2D1Bitmap* g_pBitmapPiece[g_NumCells] = {NULL} ; 
+// The pieces are regions of g_pBitmap, so a grid of any size needs no bitmap of its own
+SpriteAtlas g_Atlas ;
+SpriteBatch g_Batch ;
+int g_FirstRegion = 0 ;	// region of the top left piece
+
+RetainedScene g_Scene ;	// An item per cell, a frame draws only the cells that changed
 
 int g_ClickCount = -1 ;
 int g_Points[2] ;
 
 struct Piece
 {
-	int id ;
-	ID2D1Bitmap* bitmap ;
-	Piece(int i, ID2D1Bitmap* p):id(i), bitmap(p){}
+	int id ;		// cell the piece is drawn in
+	int region ;	// region of g_Atlas the piece shows
+	Piece(int i, int r):id(i), region(r){}
 };
 
-Piece* g_pPieces[g_NumCells] ;
+std::vector<Piece> g_Pieces ;
 
 bool g_bShowHint = false ;
 
-// Disorder the image grid by disorder it's id in g_pPieces 
+// The cell of every piece, the board the puzzle functions work on
+std::vector<int> GetBoard()
+{
+	std::vector<int> board(g_NumCells) ;
+	for (int i = 0; i < g_NumCells; ++i)
+		board[i] = g_Pieces[i].id ;
+
+	return board ;
+}
+
+// Disorder the image grid by disorder it's id in g_pPieces, never leave it solved
 void Disorder()
 {
-	srand((unsigned int)time(0)) ;
+	std::vector<int> board(g_NumCells) ;
+	ShuffleSwapBoard(&board[0], g_NumCells, (unsigned int)time(0)) ;
 
 	for (int i = 0; i < g_NumCells; ++i)
+		g_Pieces[i].id = board[i] ;
+}
+
+// Swap two pieces so that one more is in place, on the way of the fewest swaps
+void SolveStep()
+{
+	std::vector<int> board = GetBoard() ;
+	int a = -1 ;
+	int b = -1 ;
+	if (NextSwap(&board[0], g_NumCells, a, b))
 	{
-		int a = rand() % g_NumCells ;
-		int b = rand() % g_NumCells ;
-		if (a != b)
-		{
-			int temp = g_pPieces[a]->id ;
-			g_pPieces[a]->id = g_pPieces[b]->id ;
-			g_pPieces[b]->id = temp ;
-		}
+		int temp = g_Pieces[a].id ;
+		g_Pieces[a].id = g_Pieces[b].id ;
+		g_Pieces[b].id = temp ;
+
+		g_Scene.InvalidateItem(g_Pieces[a].id) ;
+		g_Scene.InvalidateItem(g_Pieces[b].id) ;
 	}
 }
 
@@ -60,139 +90,79 @@ void Disorder()
 void Restore()
 {
 	for (int i = 0; i < g_NumCells; ++i)
-		g_pPieces[i]->id = i ;
+		g_Pieces[i].id = i ;
 }
 
 // Determine whether the picture was resolved
 bool IsDone()
 {
+	std::vector<int> board = GetBoard() ;
+	return IsSolved(&board[0], g_NumCells) ;
+}
+
+// A scene item for every cell, the whole window is drawn in the next frame
+void ResetScene(HWND hWnd)
+{
+	RECT rc ;
+	GetClientRect(hWnd, &rc) ;
+	g_Scene.Reset(rc.right - rc.left, rc.bottom - rc.top) ;
+
 	for (int i = 0; i < g_NumCells; ++i)
 	{
-		if(g_pPieces[i]->id != i)
-			return false ;
+		SceneRect cell = {
+			(float)((i % g_NumColumns) * destPieceWidth),
+			(float)((i / g_NumColumns) * destPieceHeight),
+			(float)((i % g_NumColumns + 1) * destPieceWidth),
+			(float)((i / g_NumColumns + 1) * destPieceHeight)
+		} ;
+		g_Scene.AddItem(cell) ;
 	}
+}
 
-	return true ;
+// Draw the dirty part of the scene now
+void Repaint(HWND hWnd)
+{
+	InvalidateDirtyRegion(hWnd, g_Scene) ;
+	UpdateWindow(hWnd) ;
 }
 
-HRESULT LoadBitmapFromFile(
-						   ID2D1RenderTarget *pRenderTarget,
-						   IWICImagingFactory *pIWICFactory,
-						   PCWSTR uri,
-						   UINT destinationWidth,
-						   UINT destinationHeight,
-						   ID2D1Bitmap **ppBitmap
-						   )
+// The regions of the grid on the current g_pBitmap, the pieces keep their places
+void BuildAtlas()
 {
-	HRESULT hr = S_OK;
-
-	IWICBitmapDecoder *pDecoder = NULL;
-	IWICBitmapFrameDecode *pSource = NULL;
-	IWICStream *pStream = NULL;
-	IWICFormatConverter *pConverter = NULL;
-	IWICBitmapScaler *pScaler = NULL;
-
-	hr = pIWICFactory->CreateDecoderFromFilename(
-		uri,
-		NULL,
-		GENERIC_READ,
-		WICDecodeMetadataCacheOnLoad,
-		&pDecoder
-		);
-	if (SUCCEEDED(hr))
-	{
+	D2D1_SIZE_U bitmapSize = g_pBitmap->GetPixelSize() ;
+	g_Atlas.Reset(bitmapSize.width, bitmapSize.height) ;
+	g_FirstRegion = g_Atlas.AddGrid(g_NumColumns, g_NumRows) ;
+}
 
-		// Create the initial frame.
-		hr = pDecoder->GetFrame(0, &pSource);
-	}
+// Cut the picture into columns x rows pieces and disorder them, the bitmap stays as it is
+void SetGrid(HWND hWnd, int columns, int rows)
+{
+	g_NumColumns = columns < g_MinGrid ? g_MinGrid : (columns > g_MaxGrid ? g_MaxGrid : columns) ;
+	g_NumRows = rows < g_MinGrid ? g_MinGrid : (rows > g_MaxGrid ? g_MaxGrid : rows) ;
+	g_NumCells = g_NumColumns * g_NumRows ;
 
-	if (SUCCEEDED(hr))
-	{
-		// Convert the image format to 32bppPBGRA
-		// (DXGI_FORMAT_B8G8R8A8_UNORM + D2D1_ALPHA_MODE_PREMULTIPLIED).
-		hr = pIWICFactory->CreateFormatConverter(&pConverter);
-	}
-	if (SUCCEEDED(hr))
-	{
-		// If a new width or height was specified, create an
-		// IWICBitmapScaler and use it to resize the image.
-		if (destinationWidth != 0 || destinationHeight != 0)
-		{
-			UINT originalWidth, originalHeight;
-			hr = pSource->GetSize(&originalWidth, &originalHeight);
-			if (SUCCEEDED(hr))
-			{
-				if (destinationWidth == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationHeight) / static_cast<FLOAT>(originalHeight);
-					destinationWidth = static_cast<UINT>(scalar * static_cast<FLOAT>(originalWidth));
-				}
-				else if (destinationHeight == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationWidth) / static_cast<FLOAT>(originalWidth);
-					destinationHeight = static_cast<UINT>(scalar * static_cast<FLOAT>(originalHeight));
-				}
+	RECT rc ;
+	GetClientRect(hWnd, &rc) ;
+	destPieceWidth = (rc.right - rc.left) / g_NumColumns ;
+	destPieceHeight = (rc.bottom - rc.top) / g_NumRows ;
 
-				hr = pIWICFactory->CreateBitmapScaler(&pScaler);
-				if (SUCCEEDED(hr))
-				{
-					hr = pScaler->Initialize(
-						pSource,
-						destinationWidth,
-						destinationHeight,
-						WICBitmapInterpolationModeCubic
-						);
-				}
-				if (SUCCEEDED(hr))
-				{
-					hr = pConverter->Initialize(
-						pScaler,
-						GUID_WICPixelFormat32bppPBGRA,
-						WICBitmapDitherTypeNone,
-						NULL,
-						0.f,
-						WICBitmapPaletteTypeMedianCut
-						);
-				}
-			}
-		}
-		else // Don't scale the image.
-		{
-			hr = pConverter->Initialize(
-				pSource,
-				GUID_WICPixelFormat32bppPBGRA,
-				WICBitmapDitherTypeNone,
-				NULL,
-				0.f,
-				WICBitmapPaletteTypeMedianCut
-				);
-		}
-	}
-	if (SUCCEEDED(hr))
+	BuildAtlas() ;
+
+	g_Pieces.clear() ;
+	for (int i = 0; i < g_NumCells; ++i)
 	{
-		// Create a Direct2D bitmap from the WIC bitmap.
-		hr = pRenderTarget->CreateBitmapFromWicBitmap(
-			pConverter,
-			NULL,
-			ppBitmap
-			);
+		g_Pieces.push_back(Piece(i, g_FirstRegion + i)) ;
 	}
 
-	SAFE_RELEASE(pDecoder);
-	SAFE_RELEASE(pSource);
-	SAFE_RELEASE(pStream);
-	SAFE_RELEASE(pConverter);
-	SAFE_RELEASE(pScaler);
-
-	return hr;
+	g_ClickCount = -1 ;
+	Disorder() ;
+	ResetScene(hWnd) ;
 }
 
 VOID CreateD2DResource(HWND hWnd)
 {
-	// This function was called in the DrawRectangle function which in turn called to response the
-	// WM_PAINT Message, to avoid creating resource every time, we test the pointer to g_pRenderTarget
-	// If the resource already create, skip the function
-	if (!g_pRenderTarget)
+	// The factory and the pack are made once, they outlive a lost device
+	if (!g_pD2DFactory)
 	{
 		HRESULT hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &g_pD2DFactory) ;
 		if (FAILED(hr))
@@ -201,19 +171,18 @@ VOID CreateD2DResource(HWND hWnd)
 			return ;
 		}
 
-		// Create WIC factory
-		hr = CoCreateInstance(
-			CLSID_WICImagingFactory1,
-			NULL,
-			CLSCTX_INPROC_SERVER,
-			IID_IWICImagingFactory,
-			reinterpret_cast<void **>(&g_pWICFactory)
-			) ;
-		if (FAILED(hr))
-		{
-			MessageBox(hWnd, "Create WIC factory failed!", "Error", 0) ;
-			return ;
-		}
+		// Load the picture from the pack, or from the file if the pack is not there
+		g_Assets.Open("PuzzlePanel.pack") ;
+		g_Images.SetAssets(&g_Assets) ;
+	}
+
+	// This function was called in the DrawRectangle function which in turn called to response the
+	// WM_PAINT Message, to avoid creating resource every time, we test the pointer to g_pRenderTarget
+	// If the resource already create, skip the function. DiscardD2DResource clears it when the
+	// target is lost, so the next frame makes them again.
+	if (!g_pRenderTarget)
+	{
+		HRESULT hr ;
 
 		// Obtain the size of the drawing area
 		RECT rc ;		
@@ -232,7 +201,8 @@ VOID CreateD2DResource(HWND hWnd)
 			D2D1::RenderTargetProperties(),
 			D2D1::HwndRenderTargetProperties(
 			hWnd, 
-			D2D1::SizeU(rc.right - rc.left,rc.bottom - rc.top)
+			D2D1::SizeU(rc.right - rc.left,rc.bottom - rc.top),
+			D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS	// keep the cells that are not drawn again
 			), 
 			&g_pRenderTarget
 			) ;
@@ -242,6 +212,9 @@ VOID CreateD2DResource(HWND hWnd)
 			return ;
 		}
 
+		// A new target has nothing on it
+		ResetScene(hWnd) ;
+
 		// Create a brush
 		hr = g_pRenderTarget->CreateSolidColorBrush(
 			D2D1::ColorF(D2D1::ColorF::Black),
@@ -253,135 +226,132 @@ VOID CreateD2DResource(HWND hWnd)
 			return ;
 		}
 
-		// Load bitmap from file
-		hr = LoadBitmapFromFile(
-			g_pRenderTarget,
-			g_pWICFactory,
-			L"picture.jpg",
-			0,
-			0,
-			&g_pBitmap
-			) ;
-
-		if (FAILED(hr))
+		// The cache keeps the decoded picture over a lost device, only the bitmap is made again
+		g_Images.SetRenderTarget(g_pRenderTarget) ;
+		g_pBitmap = g_Images.Get(ImageKey("picture.jpg", 0, 0, PIXEL_PBGRA)) ;
+		if (!g_pBitmap)
 		{
 			MessageBox(hWnd, "Create bitmap failed!", "Error", 0) ;
 			return ;
 		}
 
-		D2D1_SIZE_U bitmapSize = g_pBitmap->GetPixelSize() ;
-		srcPieceWidth = bitmapSize.width / g_NumColumns ;
-		srcPieceHeight = bitmapSize.height / g_NumRows ;
-
-		const D2D1_POINT_2U topleft = D2D1::Point2U(0, 0) ;
-
-		// Initialize pieces
-		for (int i = 0; i < g_NumCells; ++i)
+		// Cut the picture into pieces and disorder them, or after a lost device cut the new
+		// bitmap the same way and keep the pieces where they were
+		if (g_Pieces.empty())
 		{
-			// Create the bitmap piece
-			const D2D1_BITMAP_PROPERTIES bitmapProp = D2D1::BitmapProperties(g_pBitmap->GetPixelFormat()) ;
-			HRESULT hr = g_pRenderTarget->CreateBitmap(
-				D2D1::SizeU(srcPieceWidth, srcPieceHeight),
-				bitmapProp,
-				&g_pBitmapPiece[i]
-				) ;
-			if (FAILED(hr))
-			{
-				MessageBox(NULL, "Create bitmap failed!", "Error", 0) ;
-			}
-
-			g_pPieces[i] = new Piece(i, g_pBitmapPiece[i]) ;
-
-			const D2D1_RECT_U srcRect = D2D1::RectU(
-				(i % g_NumColumns) * srcPieceWidth, 
-				(i / g_NumColumns) * srcPieceHeight, 
-				(i % g_NumColumns + 1) * srcPieceWidth, 
-				(i / g_NumColumns + 1) * srcPieceHeight
-				) ;
-
-			// Copy the content from the big bitmap
-			g_pPieces[i]->id = i ;
-			g_pPieces[i]->bitmap->CopyFromBitmap(
-				&topleft,
-				g_pBitmap,
-				&srcRect
-				) ;
+			SetGrid(hWnd, g_NumColumns, g_NumRows) ;
+		}
+		else
+		{
+			BuildAtlas() ;
 		}
-
-		// Disorder pieces
-		Disorder() ;
 	}
 }
 
-VOID DrawBitmap()
+// Release what belongs to the render target when EndDraw reports it lost
+VOID DiscardD2DResource()
 {
-	CreateD2DResource(g_Hwnd) ;
+	// The bitmaps of the cache go with the target, the decoded pixels stay
+	g_Images.DeviceLost() ;
+	g_pBitmap = NULL ;
 
-	g_pRenderTarget->BeginDraw() ;
+	SAFE_RELEASE(g_pBlackBrush) ;
+	SAFE_RELEASE(g_pRenderTarget) ;
+}
 
-	// Clear background color to dark cyan
-	g_pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
+VOID DrawBitmap()
+{
+	CreateD2DResource(g_Hwnd) ;
+	if (!g_pRenderTarget || !g_pBitmap)
+	{
+		return ;
+	}
 
-	if (g_bShowHint)
+	if (!g_Scene.NeedsDraw())
 	{
-		D2D1_RECT_F rect = D2D1::RectF(
-			g_PictureRect.left, 
-			g_PictureRect.top,
-			g_PictureRect.right,
-			g_PictureRect.bottom
-			) ;
+		return ;
+	}
 
-		g_pRenderTarget->DrawBitmap(
-			g_pBitmap, 
-			&rect
-			) ;
+	// The pieces in the cells that changed, all from the one bitmap in a single batch
+	g_Batch.Begin() ;
+	for (int i = 0; i < g_NumCells && !g_bShowHint; ++i)
+	{
+		int id = g_Pieces[i].id ;
+		if (g_Scene.IsItemDirty(id))
+		{
+			g_Batch.Add(
+				g_Atlas.Region(g_Pieces[i].region),
+				(float)((id % g_NumColumns) * destPieceWidth), 
+				(float)((id / g_NumColumns) * destPieceHeight),
+				(float)((id % g_NumColumns + 1) * destPieceWidth), 
+				(float)((id / g_NumColumns + 1) * destPieceHeight)
+				) ;
+		}
 	}
-	else
+
+	g_pRenderTarget->BeginDraw() ;
+
+	const DirtyRegion& dirty = g_Scene.Dirty() ;
+	for (int i = 0; i < dirty.Count(); ++i)
 	{
-		// Draw pieces
-		for (int i = 0; i < g_NumCells; ++i)
+		PushDirtyClip(g_pRenderTarget, dirty.Rect(i)) ;
+
+		// Clear background color to white
+		g_pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
+
+		if (g_bShowHint)
 		{
-			int id = g_pPieces[i]->id ;
-			D2D1_RECT_F destRect = D2D1::RectF(
-				(id % g_NumColumns) * destPieceWidth, 
-				(id / g_NumColumns) * destPieceHeight,
-				(id % g_NumColumns + 1) * destPieceWidth, 
-				(id / g_NumColumns + 1) * destPieceHeight
+			D2D1_RECT_F rect = D2D1::RectF(
+				g_PictureRect.left, 
+				g_PictureRect.top,
+				g_PictureRect.right,
+				g_PictureRect.bottom
 				) ;
 
 			g_pRenderTarget->DrawBitmap(
-				g_pPieces[i]->bitmap,
-				&destRect
+				g_pBitmap, 
+				&rect
 				) ;
 		}
+		else
+		{
+			DrawSpriteBatch(g_pRenderTarget, g_pBitmap, g_Batch) ;
+		}
+
+		g_pRenderTarget->PopAxisAlignedClip() ;
 	}
 
 	HRESULT hr = g_pRenderTarget->EndDraw() ;
+	g_Scene.EndFrame() ;
+	if (hr == D2DERR_RECREATE_TARGET)
+	{
+		// Make the target and the bitmap again and draw the whole window with them
+		DiscardD2DResource() ;
+		InvalidateRect(g_Hwnd, NULL, FALSE) ;
+		return ;
+	}
 	if (FAILED(hr))
 	{
 		MessageBox(NULL, "Draw failed!", "Error", 0) ;
 		return ;
 	}
+
+	ShowDrawnPixels(g_Hwnd, "PuzzlePanel", g_Scene) ;
 }
 
 VOID Cleanup()
 {
-	for (int i = 0; i < g_NumCells; ++i)
-	{
-		SAFE_RELEASE(g_pPieces[i]->bitmap) ;
-	}
+	g_Pieces.clear() ;
 
-	for (int i = 0; i < g_NumCells; ++i)
-	{
-		delete g_pPieces[i] ;
-		g_pPieces[i] = NULL ;
-	}
+	// The picture belongs to the cache, release it before its render target
+	g_Images.Clear() ;
+	g_pBitmap = NULL ;
 
 	SAFE_RELEASE(g_pRenderTarget) ;
 	SAFE_RELEASE(g_pBlackBrush) ;
-	SAFE_RELEASE(g_pBitmap) ;
-	SAFE_RELEASE(g_pWICFactory) ;
 	SAFE_RELEASE(g_pD2DFactory) ;
+
+	g_Assets.Close() ;
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)   
@@ -402,6 +372,11 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		// Compute the grid id via mouse position
 		mousePosX = LOWORD(lParam) ;
 		mousePosY = HIWORD(lParam) ;
+		if (destPieceWidth <= 0 || destPieceHeight <= 0 ||
+			mousePosX >= g_NumColumns * destPieceWidth || mousePosY >= g_NumRows * destPieceHeight)
+		{
+			break ;	// outside the grid, in the pixels left over by the division
+		}
 		curId = mousePosY / destPieceHeight * g_NumColumns + mousePosX / destPieceWidth ;
 
 		++g_ClickCount ;
@@ -418,21 +393,22 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 				for (int i = 0; i < g_NumCells; ++i)
 				{
-					if (g_pPieces[i]->id == g_Points[0])
+					if (g_Pieces[i].id == g_Points[0])
 					{
 						m = i ;
 					}
-					if (g_pPieces[i]->id == g_Points[1])
+					if (g_Pieces[i].id == g_Points[1])
 					{
 						n = i ;
 					}
 				}
 
-				g_pPieces[m]->id = g_Points[1] ;
-				g_pPieces[n]->id = g_Points[0] ;
+				g_Pieces[m].id = g_Points[1] ;
+				g_Pieces[n].id = g_Points[0] ;
 
-				InvalidateRect(hwnd, NULL, FALSE) ;
-				UpdateWindow(hwnd) ;
+				g_Scene.InvalidateItem(g_Points[0]) ;
+				g_Scene.InvalidateItem(g_Points[1]) ;
+				Repaint(hwnd) ;
 
 				if (IsDone())
 				{
@@ -454,13 +430,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			g_pRenderTarget->Resize(newRenderTargetSize) ;
 			destPieceWidth = (rc.right - rc.left) / g_NumColumns ;
 			destPieceHeight = (rc.bottom - rc.top) / g_NumRows ;
-			InvalidateRect(hwnd, NULL, FALSE) ;
-			UpdateWindow(hwnd) ;
+			ResetScene(hwnd) ;
+			Repaint(hwnd) ;
 		}
 		
 		break ;
 
 	case WM_PAINT:
+		AddUpdateRegion(hwnd, g_Scene) ;
 		DrawBitmap() ;
 		ValidateRect(g_Hwnd, NULL) ;
 		return 0 ;
@@ -471,20 +448,40 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			{ 
 			case 'D': // disorder the image
 				Disorder() ;
-				InvalidateRect(hwnd, NULL, FALSE) ;
-				UpdateWindow(hwnd) ;
+				g_Scene.InvalidateAll() ;
+				Repaint(hwnd) ;
 				break ;
 
 			case 'R':
 				Restore() ;
-				InvalidateRect(hwnd, NULL, FALSE) ;
-				UpdateWindow(hwnd) ;
+				g_Scene.InvalidateAll() ;
+				Repaint(hwnd) ;
+				break ;
+
+			case 'S': // one swap towards the solution
+				if (!IsDone())
+				{
+					SolveStep() ;
+					Repaint(hwnd) ;
+				}
+				break ;
+
+			case VK_ADD: // more and smaller pieces
+			case VK_OEM_PLUS:
+			case VK_SUBTRACT: // fewer and larger pieces
+			case VK_OEM_MINUS:
+				if (g_pBitmap)
+				{
+					int step = wParam == VK_ADD || wParam == VK_OEM_PLUS ? 1 : -1 ;
+					SetGrid(hwnd, g_NumColumns + step, g_NumRows + step) ;
+					Repaint(hwnd) ;
+				}
 				break ;
 
 			case VK_CONTROL:
 				g_bShowHint = true ;
-				InvalidateRect(hwnd, NULL, FALSE) ;
-				UpdateWindow(hwnd) ;
+				g_Scene.InvalidateAll() ;
+				Repaint(hwnd) ;
 				break ;
 
 			case VK_ESCAPE: 
@@ -503,8 +500,8 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			{
 			case VK_CONTROL:
 				g_bShowHint = false ;
-				InvalidateRect(hwnd, NULL, FALSE) ;
-				UpdateWindow(hwnd) ;
+				g_Scene.InvalidateAll() ;
+				Repaint(hwnd) ;
 				break ;
 			}
 		}
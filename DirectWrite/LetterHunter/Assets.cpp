@@ -0,0 +1,189 @@
+#include "Assets.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Font data of one pack entry, handed to DirectWrite by pointer
+class PackFontStream : public IDWriteFontFileStream
+{
+public:
+	PackFontStream(const unsigned char* data, UINT64 size)
+		: refCount_(1), data_(data), size_(size)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object)
+	{
+		if (iid == __uuidof(IUnknown) || iid == __uuidof(IDWriteFontFileStream))
+		{
+			*object = this;
+			AddRef();
+			return S_OK;
+		}
+		*object = NULL;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef()
+	{
+		return InterlockedIncrement(&refCount_);
+	}
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		ULONG count = InterlockedDecrement(&refCount_);
+		if (count == 0)
+		{
+			delete this;
+		}
+		return count;
+	}
+
+	HRESULT STDMETHODCALLTYPE ReadFileFragment(const void** fragmentStart, UINT64 fileOffset, UINT64 fragmentSize, void** fragmentContext)
+	{
+		*fragmentContext = NULL;
+		if (fileOffset > size_ || fragmentSize > size_ - fileOffset)
+		{
+			*fragmentStart = NULL;
+			return E_FAIL;
+		}
+
+		// The whole font is in memory, fragments are pointers into it
+		*fragmentStart = data_ + fileOffset;
+		return S_OK;
+	}
+
+	void STDMETHODCALLTYPE ReleaseFileFragment(void* fragmentContext)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE GetFileSize(UINT64* fileSize)
+	{
+		*fileSize = size_;
+		return S_OK;
+	}
+
+	HRESULT STDMETHODCALLTYPE GetLastWriteTime(UINT64* lastWriteTime)
+	{
+		*lastWriteTime = 0;
+		return E_NOTIMPL;
+	}
+
+private:
+	LONG				refCount_;
+	const unsigned char* data_;
+	UINT64				size_;
+};
+
+// Creates streams for the fonts loaded from the pack, the key is the index into fonts_
+class PackFontLoader : public IDWriteFontFileLoader
+{
+public:
+	PackFontLoader()
+		: factory_(NULL)
+	{
+	}
+
+	// Lives as long as the program, so reference counting does nothing
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** object)
+	{
+		if (iid == __uuidof(IUnknown) || iid == __uuidof(IDWriteFontFileLoader))
+		{
+			*object = this;
+			return S_OK;
+		}
+		*object = NULL;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() { return 1; }
+	ULONG STDMETHODCALLTYPE Release() { return 1; }
+
+	HRESULT STDMETHODCALLTYPE CreateStreamFromKey(const void* key, UINT32 keySize, IDWriteFontFileStream** stream)
+	{
+		*stream = NULL;
+
+		int index = -1;
+		if (keySize != sizeof(index))
+		{
+			return E_INVALIDARG;
+		}
+		memcpy(&index, key, sizeof(index));
+		if (index < 0 || index >= (int)fonts_.size())
+		{
+			return E_INVALIDARG;
+		}
+
+		*stream = new PackFontStream(fonts_[index]->Data(), fonts_[index]->Size());
+		return S_OK;
+	}
+
+	HRESULT createFontFile(IDWriteFactory* factory, const char* fontName, IDWriteFontFile** fontFile)
+	{
+		// Every letter creates its own font file, load each font from the pack only once
+		int index = -1;
+		for (size_t i = 0; i < names_.size(); ++i)
+		{
+			if (names_[i] == fontName)
+			{
+				index = (int)i;
+			}
+		}
+
+		if (index < 0)
+		{
+			Asset* font = new Asset();
+			if (!gameAssets().Load(fontName, *font))
+			{
+				delete font;
+				return E_FAIL;
+			}
+
+			index = (int)fonts_.size();
+			fonts_.push_back(font);
+			names_.push_back(fontName);
+		}
+
+		if (factory_ != factory)
+		{
+			HRESULT hr = factory->RegisterFontFileLoader(this);
+			if (FAILED(hr))
+			{
+				return hr;
+			}
+			factory_ = factory;
+		}
+
+		return factory->CreateCustomFontFileReference(&index, sizeof(index), this, fontFile);
+	}
+
+private:
+	IDWriteFactory*				factory_;	// the factory the loader is registered with
+	std::vector<Asset*>			fonts_;
+	std::vector<std::string>	names_;
+};
+
+AssetPack& gameAssets()
+{
+	static AssetPack assets;
+	static bool isOpened = false;
+	if (!isOpened)
+	{
+		assets.Open("LetterHunter.pack");
+		isOpened = true;
+	}
+
+	return assets;
+}
+
+HRESULT createFontFile(IDWriteFactory* factory, const char* fontName, const wchar_t* fallbackPath, IDWriteFontFile** fontFile)
+{
+	// Fonts that are not packed come from the system font folder as before
+	if (gameAssets().Find(fontName) < 0)
+	{
+		return factory->CreateFontFileReference(fallbackPath, NULL, fontFile);
+	}
+
+	static PackFontLoader loader;
+	return loader.createFontFile(factory, fontName, fontFile);
+}
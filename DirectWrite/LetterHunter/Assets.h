@@ -0,0 +1,15 @@
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <dwrite.h>
+#include "AssetPack.h"
+
+// The media of the game. Opens LetterHunter.pack on first use, every asset that is not in the
+// pack is loaded from its loose file, so the game also runs without a pack.
+AssetPack& gameAssets();
+
+// Font file for DirectWrite, from the pack entry fontName when the pack has it, else from fallbackPath on disk.
+// Font data from the pack stays loaded until the game exits, font faces may keep pointers into it.
+HRESULT createFontFile(IDWriteFactory* factory, const char* fontName, const wchar_t* fallbackPath, IDWriteFontFile** fontFile);
+
+#endif // end __ASSETS_H__
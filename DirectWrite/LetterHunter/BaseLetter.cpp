@@ -1,4 +1,5 @@
 ﻿#include "BaseLetter.h"
+#include "Assets.h"
 
 #define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
 
@@ -40,11 +41,12 @@ BaseLetter::BaseLetter(
 	velocity_.x = 0;
 	velocity_.y = 0;
 
-	// Create font file reference
+	// Create font file reference, from LetterHunter.pack if the font was packed
 	const WCHAR* filePath = L"C:/Windows/Fonts/timesbd.ttf";
-	HRESULT hr = pDWriteFactory->CreateFontFileReference(
+	HRESULT hr = createFontFile(
+		pDWriteFactory,
+		"Media/Font/timesbd.ttf",
 		filePath,
-		NULL,
 		&pFontFile
 		);
 	if(FAILED(hr))
@@ -1,17 +1,28 @@
 #include "D2D.h"
 #include "Utilities.h"
+#include "Assets.h"
 
 D2D::D2D(void)
 	:D2DFactory_(NULL),
 	D2DHwndRenderTarget_(NULL),
 	DWriteFactory_(NULL)
 {
+	imageCache_.SetAssets(&gameAssets());
 }
 
 
 D2D::~D2D(void)
 {
 	discardDeviceResources();
+
+	const ImageCacheStats& stats = imageCache_.Stats();
+	wchar_t text[256];
+	swprintf_s(text, L"Image cache: %d hits, %d misses, %d failed, %d uploads, decode %.1f ms, upload %.1f ms\n",
+		stats.hits, stats.misses, stats.failed, stats.uploads, stats.decodeMs, stats.uploadMs);
+	OutputDebugString(text);
+
+	SAFE_RELEASE(DWriteFactory_);
+	SAFE_RELEASE(D2DFactory_);
 }
 
 void D2D::createDeviceIndependentResources()
@@ -62,14 +73,19 @@ void D2D::createDeviceResources(HWND Hwnd)
 			MessageBox(Hwnd, L"Create render target failed!", L"Error", 0);
 			return;
 		}
+
+		imageCache_.SetRenderTarget(D2DHwndRenderTarget_);
 	}
 }
 
+// Release the render target, e.g. when EndDraw returns D2DERR_RECREATE_TARGET, the next
+// createDeviceResources makes a new one. The factories stay.
 void D2D::discardDeviceResources()
 {
-	SAFE_RELEASE(DWriteFactory_);
+	// The bitmaps belong to the render target, the decoded pixels stay for the next one
+	imageCache_.DeviceLost();
+
 	SAFE_RELEASE(D2DHwndRenderTarget_);
-	SAFE_RELEASE(D2DFactory_);
 }
 
 void D2D::onResize(UINT32 width, UINT32 height)
@@ -96,114 +112,7 @@ IDWriteFactory* D2D::getDWriteFactory() const
 	return DWriteFactory_;
 }
 
-HRESULT D2D::LoadBitmapFromFile(
-						   ID2D1RenderTarget *pRenderTarget,
-						   IWICImagingFactory *pIWICFactory,
-						   PCWSTR uri,
-						   UINT destinationWidth,
-						   UINT destinationHeight,
-						   ID2D1Bitmap **ppBitmap
-						   )
+D2DImageCache& D2D::getImageCache()
 {
-	HRESULT hr = S_OK;
-
-	IWICBitmapDecoder *pDecoder = NULL;
-	IWICBitmapFrameDecode *pSource = NULL;
-	IWICStream *pStream = NULL;
-	IWICFormatConverter *pConverter = NULL;
-	IWICBitmapScaler *pScaler = NULL;
-
-	hr = pIWICFactory->CreateDecoderFromFilename(
-		uri,
-		NULL,
-		GENERIC_READ,
-		WICDecodeMetadataCacheOnLoad,
-		&pDecoder
-		);
-	if (SUCCEEDED(hr))
-	{
-
-		// Create the initial frame.
-		hr = pDecoder->GetFrame(0, &pSource);
-	}
-
-	if (SUCCEEDED(hr))
-	{
-		// Convert the image format to 32bppPBGRA
-		// (DXGI_FORMAT_B8G8R8A8_UNORM + D2D1_ALPHA_MODE_PREMULTIPLIED).
-		hr = pIWICFactory->CreateFormatConverter(&pConverter);
-	}
-	if (SUCCEEDED(hr))
-	{
-		// If a new width or height was specified, create an
-		// IWICBitmapScaler and use it to resize the image.
-		if (destinationWidth != 0 || destinationHeight != 0)
-		{
-			UINT originalWidth, originalHeight;
-			hr = pSource->GetSize(&originalWidth, &originalHeight);
-			if (SUCCEEDED(hr))
-			{
-				if (destinationWidth == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationHeight) / static_cast<FLOAT>(originalHeight);
-					destinationWidth = static_cast<UINT>(scalar * static_cast<FLOAT>(originalWidth));
-				}
-				else if (destinationHeight == 0)
-				{
-					FLOAT scalar = static_cast<FLOAT>(destinationWidth) / static_cast<FLOAT>(originalWidth);
-					destinationHeight = static_cast<UINT>(scalar * static_cast<FLOAT>(originalHeight));
-				}
-
-				hr = pIWICFactory->CreateBitmapScaler(&pScaler);
-				if (SUCCEEDED(hr))
-				{
-					hr = pScaler->Initialize(
-						pSource,
-						destinationWidth,
-						destinationHeight,
-						WICBitmapInterpolationModeCubic
-						);
-				}
-				if (SUCCEEDED(hr))
-				{
-					hr = pConverter->Initialize(
-						pScaler,
-						GUID_WICPixelFormat32bppPBGRA,
-						WICBitmapDitherTypeNone,
-						NULL,
-						0.f,
-						WICBitmapPaletteTypeMedianCut
-						);
-				}
-			}
-		}
-		else // Don't scale the image.
-		{
-			hr = pConverter->Initialize(
-				pSource,
-				GUID_WICPixelFormat32bppPBGRA,
-				WICBitmapDitherTypeNone,
-				NULL,
-				0.f,
-				WICBitmapPaletteTypeMedianCut
-				);
-		}
-	}
-	if (SUCCEEDED(hr))
-	{
-		// Create a Direct2D bitmap from the WIC bitmap.
-		hr = pRenderTarget->CreateBitmapFromWicBitmap(
-			pConverter,
-			NULL,
-			ppBitmap
-			);
-	}
-
-	SAFE_RELEASE(pDecoder);
-	SAFE_RELEASE(pSource);
-	SAFE_RELEASE(pStream);
-	SAFE_RELEASE(pConverter);
-	SAFE_RELEASE(pScaler);
-
-	return hr;
+	return imageCache_;
 }
\ No newline at end of file
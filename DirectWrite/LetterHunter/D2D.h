@@ -3,7 +3,7 @@
 
 #include <d2d1.h>
 #include <dwrite.h>
-#include <wincodec.h>
+#include "D2DImageCache.h"
 
 class D2D
 {
@@ -22,19 +22,14 @@ public:
 	ID2D1HwndRenderTarget*	getD2DHwndRenderTarget() const;
 	IDWriteFactory*			getDWriteFactory() const;
 
-	HRESULT	LoadBitmapFromFile(
-		ID2D1RenderTarget *pRenderTarget,
-		IWICImagingFactory *pIWICFactory,
-		PCWSTR uri,
-		UINT destinationWidth,
-		UINT destinationHeight,
-		ID2D1Bitmap **ppBitmap
-		);
+	// Pictures decoded once and kept as bitmaps of the render target
+	D2DImageCache&			getImageCache();
 
 private:
 	ID2D1Factory*			D2DFactory_;
 	ID2D1HwndRenderTarget*	D2DHwndRenderTarget_;
 	IDWriteFactory*			DWriteFactory_;
+	D2DImageCache			imageCache_;
 };
 
 #endif // end __D2D_H_
@@ -4,7 +4,8 @@
 DInput::DInput(void)
 {
 	m_pDIObject = NULL ;
-	ZeroMemory(m_KeyBuffer, sizeof(m_KeyBuffer));
+	m_pDIKeyboardDevice = NULL ;
+	m_pDIMouseDevice = NULL ;
 	Init() ;
 }
 
@@ -83,6 +84,14 @@ bool DInput::InitKeyboard()
 		return false ;
 	}
 
+	// Keep every key change until update reads it, so fast typing between two frames is not lost
+	hr = EnableBufferedInput(m_pDIKeyboardDevice) ;
+	if(FAILED(hr))
+	{
+		MessageBox(NULL, L"Set keyboard buffer size failed", L"Error", 0);
+		return false ;
+	}
+
 	// Set keyboard cooperate level
 	hr = m_pDIKeyboardDevice->SetCooperativeLevel(GetForegroundWindow(), DISCL_BACKGROUND | DISCL_NONEXCLUSIVE) ;
 	if (FAILED(hr))
@@ -122,6 +131,14 @@ bool DInput::InitMouse()
 		return false ;
 	}
 
+	// Keep the mouse changes too
+	hr = EnableBufferedInput(m_pDIMouseDevice) ;
+	if(FAILED(hr))
+	{
+		MessageBox(NULL, L"Set mouse buffer size failed", L"Error", 0);
+		return false ;
+	}
+
 	// Set mouse cooperate level
 	hr = m_pDIMouseDevice->SetCooperativeLevel(GetForegroundWindow(),DISCL_BACKGROUND | DISCL_NONEXCLUSIVE) ;
 	if(FAILED(hr))
@@ -141,34 +158,28 @@ bool DInput::InitMouse()
 	return true ;
 }
 
-// Update keyboard state
+// Apply the key and mouse changes buffered since the last update
 void DInput::update()
 {
-	// Update keyboard
-	if (FAILED(m_pDIKeyboardDevice->GetDeviceState(sizeof(m_KeyBuffer), (LPVOID)&m_KeyBuffer)))
+	if (m_pDIKeyboardDevice)
 	{
-		// Keyboard lost, zero out keyboard data structure.
-		ZeroMemory(m_KeyBuffer, sizeof(m_KeyBuffer));
-
-		// Try to acquire for next time we poll.
-		m_pDIKeyboardDevice->Acquire() ;
+		ReadKeyboardEvents(m_pDIKeyboardDevice, m_Queue) ;
 	}
 
-	// Update mouse
-	if(DIERR_INPUTLOST == m_pDIMouseDevice->GetDeviceState(sizeof(m_MouseState),(LPVOID)&m_MouseState))
+	if (m_pDIMouseDevice)
 	{
-		ZeroMemory(&m_MouseState, sizeof(m_MouseState)) ;
-		m_pDIMouseDevice->Acquire();
+		ReadMouseEvents(m_pDIMouseDevice, m_Queue) ;
 	}
+
+	m_State.BeginStep(m_Queue) ;
 }
 
-// Determine whether a key was pressed
-BOOL DInput::keyDown(int key) const
+int DInput::keyCount() const
 {
-	return (m_KeyBuffer[key] & 0x80);
+	return m_State.PressedCount() ;
 }
 
-const char DInput::getKey() const
+const char DInput::getKey(int index) const
 {
 	const int numKeys = 37;
 	const int keys[numKeys] = 
@@ -182,9 +193,10 @@ const char DInput::getKey() const
 
 	const char letters[numKeys + 1] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ "; // The last one is space
 
+	int key = m_State.PressedKey(index);
 	for(int i = 0; i < numKeys; ++i)
 	{
-		if(keyDown(keys[i]))
+		if(keys[i] == key)
 			return letters[i];
 	}
 
@@ -193,15 +205,15 @@ const char DInput::getKey() const
 
 bool DInput::ButtonDown(int button)
 {
-	return (m_MouseState.rgbButtons[button] & 0x80) != 0;
+	return m_State.ButtonDown(button);
 }
 
 float DInput::MouseDX() const
 {
-	return (float)m_MouseState.lX;
+	return (float)m_State.MouseDX();
 }
 
 float DInput::MouseDY() const
 {
-	return (float)m_MouseState.lY;
+	return (float)m_State.MouseDY();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 //#include <d3dx9.h>
 #include <dinput.h>
+#include "InputSource.h"
 //#include <DxErr.h>
 
 // This Macro wraps the Trace function to show error box
@@ -19,15 +20,15 @@ public:
 	DInput(void);
 	~DInput(void);
 
-	void		update() ;					// Update keyboard
-	const char	getKey() const;				// Get the key pressed, we only process numbers(0 - 9) and letters(A - Z)
+	void		update() ;					// Apply the input buffered since the last update
+	int			keyCount() const;			// Number of keys pressed since the last update, in order
+	const char	getKey(int index) const;	// A key pressed, we only process numbers(0 - 9), letters(A - Z) and space, '-' for others
 	bool		ButtonDown(int button) ;	// Is a mouse button down?
 	float		MouseDX() const;
 	float		MouseDY() const;
 
 private:
 	bool Init() ;					// Initialize Direct Input
-	BOOL keyDown(int key) const;	// Is a keyboard key pressed?
 	bool InitKeyboard() ;			// Initialize keyboard
 	bool InitMouse() ;				// Initialize mouse
 	void Release() ;
@@ -36,8 +37,8 @@ private:
 	LPDIRECTINPUT8			m_pDIObject ;
 	LPDIRECTINPUTDEVICE8	m_pDIKeyboardDevice ;	// Keyboard device
 	LPDIRECTINPUTDEVICE8	m_pDIMouseDevice ;		// Mouse device
-	char					m_KeyBuffer[256] ;		// Buffer for keys
-	DIMOUSESTATE2			m_MouseState ;			// Mouse state
+	InputQueue				m_Queue ;				// Changes read from the devices, not applied yet
+	InputState				m_State ;				// Keys and mouse since the last update
 };
 
 #endif // end __DINPUT_H__
@@ -14,7 +14,10 @@ LetterHunter::LetterHunter(HWND hwnd, int maxTextCount)
 	soundManager_(NULL),
 	score_(NULL),
 	textBuffer_(NULL),
-	currentTextObject_(NULL)
+	currentTextObject_(NULL),
+	backgroundImage_("./Media/Picture/Fairy_of_the_Water.jpg", 0, 0, PIXEL_BGRX),
+	gameScore_(0),
+	deviceLost_(false)
 {
 	// Initialize Direct2D
 	d2d_ = new D2D();
@@ -43,6 +46,7 @@ void LetterHunter::release()
 {
 	SAFE_DELETE(d2d_);
 	SAFE_DELETE(dinput_);
+	SAFE_DELETE(soundManager_);
 	SAFE_DELETE(score_);
 
 	for(vector<TextObject*>::iterator itor = textBuffer_.begin(); itor != textBuffer_.end(); ++itor)
@@ -67,35 +71,25 @@ void LetterHunter::update(float timeDelta)
 {
 	dinput_->update();
 
-	// Get the key pressed
-	char hitLetterObject = '-';
-	static bool keyUp = false;
-	if(dinput_->getKey() != '-')
+	// Every key pressed since the last update, the buffered input keeps taps shorter than a step
+	for(int i = 0; i < dinput_->keyCount(); ++i)
 	{
-		if(!keyUp)
+		char hitLetterObject = dinput_->getKey(i);
+
+		// 0-9 was magic words
+		if(hitLetterObject == '9')	// pause
 		{
-			keyUp = true;
-			hitLetterObject = dinput_->getKey();
+			setTextSpeedFactor(0);
 		}
-	}
-	else
-	{
-		keyUp = false;
-	}
 
-	// 0-9 was magic words
-	if(hitLetterObject == '9')	// pause
-	{
-		setTextSpeedFactor(0);
-	}
+		if(hitLetterObject == ' ')
+		{
+			hitAll();
+		}
 
-	if(hitLetterObject == ' ')
-	{
-		hitAll();
+		shootCheck(hitLetterObject);
 	}
 
-	shootCheck(hitLetterObject);
-
 	// Update text obejcts
 	for(unsigned int i = 0; i < textBuffer_.size(); ++i)
 	{
@@ -146,16 +140,22 @@ void LetterHunter::update(float timeDelta)
 	}
 }
 
-void LetterHunter::render(float timeDelta)
+void LetterHunter::render()
 {
-	// Create device dependent resources
+	// Create device dependent resources, again after the device was lost
 	d2d_->createDeviceResources(hwnd_);
 
 	// Get Hwnd render target
 	ID2D1HwndRenderTarget* rendertarget = d2d_->getD2DHwndRenderTarget();
+	if(!rendertarget)
+	{
+		return;
+	}
 
-	// Update text object before rendering
-	update(timeDelta);
+	if(deviceLost_)
+	{
+		restoreDeviceObjects();
+	}
 
 	rendertarget->BeginDraw();
 
@@ -163,8 +163,7 @@ void LetterHunter::render(float timeDelta)
 	rendertarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
 
 	// render background image
-	wchar_t*	imageFile = L"./Media/Picture/Fairy_of_the_Water.jpg";
-	drawBackgroundImage(imageFile);
+	drawBackgroundImage(backgroundImage_);
 
 	// render text objects
 	for(unsigned int i = 0; i < textBuffer_.size(); ++i)
@@ -187,7 +186,45 @@ void LetterHunter::render(float timeDelta)
 	// render score
 	score_->draw();
 
-	rendertarget->EndDraw();
+	// The target is gone with the device, e.g. after a driver update or a remote session
+	HRESULT hr = rendertarget->EndDraw();
+	if(hr == D2DERR_RECREATE_TARGET)
+	{
+		onDeviceLost();
+	}
+}
+
+void LetterHunter::onDeviceLost()
+{
+	currentTextObject_ = NULL;
+	for(unsigned int i = 0; i < textBuffer_.size(); ++i)
+	{
+		SAFE_DELETE(textBuffer_[i]);
+	}
+	textBuffer_.clear();
+
+	for(unsigned int i = 0; i < bulletBuffer_.size(); ++i)
+	{
+		SAFE_DELETE(bulletBuffer_[i]);
+	}
+	bulletBuffer_.clear();
+
+	SAFE_DELETE(score_);
+
+	// Drops the bitmaps of the cache and the render target, render makes a new target
+	d2d_->discardDeviceResources();
+	deviceLost_ = true;
+}
+
+void LetterHunter::restoreDeviceObjects()
+{
+	score_ = new Score(d2d_->getD2DHwndRenderTarget(), d2d_->getDWriteFactory(), hwnd_);
+	score_->setColor(D2D1::ColorF(D2D1::ColorF::Red));
+	score_->add(gameScore_);
+
+	initializeText();
+	initializeBullet();
+	deviceLost_ = false;
 }
 
 void LetterHunter::resize(int width, int height)
@@ -200,12 +237,6 @@ void LetterHunter::resize(int width, int height)
 	setWindowHeight(height);
 }
 
-void LetterHunter::run(float timeDelta)
-{
-	update(timeDelta);
-	render(timeDelta);
-}
-
 int LetterHunter::getwindowWidth() const
 {
 	return windowWidth;
@@ -384,6 +415,7 @@ void LetterHunter::hitDetect(Bullet* bullet, TextObject* textObject)
 	{
 		// Update score
 		score_->add(1);
+		++gameScore_;
 
 		textObject->onHit();
 		if(!textObject->isLive())
@@ -452,41 +484,21 @@ void LetterHunter::setTextSpeedFactor(float speedFactor)
 	}
 }
 
-void LetterHunter::drawBackgroundImage(wchar_t* imageFile)
+void LetterHunter::drawBackgroundImage(const ImageKey& image)
 {
-	static ID2D1Bitmap* pBitmap = NULL;
 	ID2D1RenderTarget*	renderTarget = d2d_->getD2DHwndRenderTarget();
 
-	static bool isImageLoad = false;
-	if(!isImageLoad)
+	// Decoded on the first frame only, later frames get the same bitmap from the cache.
+	// The picture keeps its own size, the render target scales it, so resizing the window decodes nothing.
+	ID2D1Bitmap* pBitmap = d2d_->getImageCache().Get(image);
+	if(!pBitmap)
 	{
-		// Create WIC factory
-		IWICImagingFactory*	pWICFactory	= NULL ;
-
-		HRESULT hr = CoCreateInstance(
-			CLSID_WICImagingFactory1,
-			NULL,
-			CLSCTX_INPROC_SERVER,
-			IID_IWICImagingFactory,
-			reinterpret_cast<void **>(&pWICFactory)
-			) ;
-
-		d2d_->LoadBitmapFromFile(
-			renderTarget,
-			pWICFactory,
-			imageFile,
-			0,
-			0,
-			&pBitmap
-			);
-
-		isImageLoad = true;
+		return;
 	}
 
-	RECT rect;
-	GetWindowRect(hwnd_, &rect);
+	D2D1_SIZE_F size = renderTarget->GetSize();
 	renderTarget->DrawBitmap(
 		pBitmap,
-		D2D1::Rect(rect.left, rect.top, rect.right, rect.bottom)
+		D2D1::RectF(0, 0, size.width, size.height)
 		);
 }
\ No newline at end of file
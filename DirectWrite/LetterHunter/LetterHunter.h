@@ -22,13 +22,12 @@ public:
 	void initialize();
 	void release();
 	void update(float timeDelta);
-	void render(float timeDelta);
+	void render();
 	void resize(int width, int height);
-	void run(float timeDelta);
 	void pause();
 	void quit();
 
-	void drawBackgroundImage(wchar_t* imageFile);
+	void drawBackgroundImage(const ImageKey& image);
 
 private:
 	HWND hwnd_;
@@ -50,6 +49,7 @@ private:
 	static const int BULLETCOUNT = 10;
 
 	D2D*			d2d_;
+	ImageKey		backgroundImage_;	// drawn stretched over the window every frame
 	DInput*			dinput_;
 	SoundManager*	soundManager_;
 	Score*			score_;
@@ -61,6 +61,9 @@ private:
 	// the total score of current user, level will increase when score match a given value(1000 for instance).
 	int gameScore_;
 
+	// The render target was lost, the objects that draw on it are made again on the next frame
+	bool deviceLost_;
+
 private:
 	int		getwindowWidth() const;
 	void	setWindowWidth(int width);
@@ -70,6 +73,11 @@ private:
 
 	void	initializeText();
 	void	initializeBullet();
+
+	// Release the objects holding brushes of the render target when it is lost, and make them
+	// again on the new one. The letters start over, the score is kept.
+	void	onDeviceLost();
+	void	restoreDeviceObjects();
 	void	setBulletObject(BaseLetter* letter);
 	void	resetTextObject(TextObject* textObject);	// This function does not work yet
 	
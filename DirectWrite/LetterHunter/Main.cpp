@@ -9,14 +9,15 @@ Key steps:
 */
 
 #include <Windows.h>
-#include <MMSystem.h>
 #include "LetterHunter.h"
 #include "Utilities.h"
+#include "GameLoop.h"
 
 int windowWidth	 = 1000;
 int windowHeight = 1000;
 
 LetterHunter* g_pletterHunter = NULL;
+GameLoop g_loop(60.0, 60.0);	// 60 updates and at most 60 frames per second
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)   
 {
@@ -24,17 +25,16 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
 	case   WM_PAINT:
 		{
-			static DWORD lastTime = timeGetTime();
-			DWORD currentTime = timeGetTime();
-			float timeDelta = (currentTime - lastTime) * 0.001f;
-
-			g_pletterHunter->run(timeDelta);
-
-			lastTime = currentTime;
-
+			// The game loop draws the frames, this only repaints after the window was covered
+			g_pletterHunter->render();
+			ValidateRect(hwnd, NULL);
 			return 0 ;
 		}
 
+	case WM_ACTIVATE:
+		g_loop.SetActive(LOWORD(wParam) != WA_INACTIVE);
+		break;
+
 	case WM_SIZE:
 		{
 			UINT width = LOWORD(lParam);
@@ -105,14 +105,7 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine
 	ShowWindow (hwnd, iCmdShow) ;
 	UpdateWindow (hwnd) ;
 
-	MSG    msg ;  
-	ZeroMemory(&msg, sizeof(msg)) ;
-
-	while (GetMessage (&msg, NULL, 0, 0))  
-	{
-		TranslateMessage (&msg) ;
-		DispatchMessage (&msg) ;
-	}
-
-	return msg.wParam ;
+	// Update the game at a fixed rate and draw it at a paced frame rate
+	return g_loop.Run([](double stepSeconds) { g_pletterHunter->update((float)stepSeconds); },
+					  [](double) { g_pletterHunter->render(); });
 }
\ No newline at end of file
@@ -2,19 +2,12 @@
 #define __SOUND_H__
 
 #include <Windows.h>
-
-// Use the one in DirectX SDK folder for Win7, use the one in Windows SDK folder for Win8
-#include "XAudio2.h"
+#include "AudioBackend.h"
+#include "WaveFile.h"
+#include "AssetPack.h"
 #include "Utilities.h"
 
-// Little-Endian for Windows, XBOX use big-endian
-#define fourccRIFF 'FFIR'
-#define fourccDATA 'atad'
-#define fourccFMT ' tmf'
-#define fourccWAVE 'EVAW'
-#define fourccXWMA 'AMWX'
-#define fourccDPDS 'sdpd'
-
+// A wave file from LetterHunter.pack or mapped from disk, played by the voice pool in SoundManager
 class Sound
 {
 public:
@@ -22,20 +15,15 @@ public:
 	~Sound(void);
 
 public:
-	void initialize(wchar_t* audioFile);
-	void play();
-
-private:
-	HRESULT findChunk(HANDLE hFile, DWORD fourcc, DWORD& dwChunkSize, DWORD& dwChunkDataPosition);
-	void readChunkData(HANDLE hFile, void * buffer, DWORD buffersize, DWORD bufferoffset);
+	bool initialize(wchar_t* audioFile);
 
-	IXAudio2*				XAudio2_;
-	IXAudio2MasteringVoice* masterVoice_;	
-	IXAudio2SourceVoice*	sourceVoice_;
-
-	XAUDIO2_BUFFER buffer_;
+	// Sample data and format, valid until the sound is destroyed
+	const AudioClip& clip() const { return clip_; }
 
+private:
+	Asset		asset_;
+	WaveFile	file_;
+	AudioClip	clip_;
 };
 
 #endif // end __SOUND_H__
-
@@ -1,12 +1,12 @@
 #include "SoundManager.h"
 
 
-SoundManager::SoundManager(void):sound_(NULL)
+SoundManager::SoundManager(void):backend_(NULL), voicePool_(NULL)
 {
-	sound_ = new Sound*[NUM_SOUND];
 	for(int i = 0; i < NUM_SOUND; ++i)
 	{
 		sound_[i] = new Sound();
+		soundId_[i] = -1;
 	}
 
 	initialize();
@@ -14,7 +14,14 @@ SoundManager::SoundManager(void):sound_(NULL)
 
 SoundManager::~SoundManager(void)
 {
-	SAFE_DELETE_ARRAY(sound_);
+	// Voices must be destroyed before the engine, and the sound data must outlive the voices
+	SAFE_DELETE(voicePool_);
+	SAFE_DELETE(backend_);
+
+	for(int i = 0; i < NUM_SOUND; ++i)
+	{
+		SAFE_DELETE(sound_[i]);
+	}
 }
 
 void SoundManager::onHit()
@@ -42,13 +49,47 @@ void SoundManager::initialize()
 		L"Media/Sound/send_bullet.wav"
 	};
 
+	// Shortest time between two triggers of the same sound, and how many copies may overlap.
+	// Keyboard auto-repeat fires about every 30ms, the bullet sound is throttled just below that.
+	const double minInterval[NUM_SOUND]  = { 20.0, 250.0, 25.0 };
+	const int    maxInstances[NUM_SOUND] = { 4,    1,     4    };
+
+	backend_ = new XAudio2Backend();
+	if (!backend_->Initialize())
+	{
+		MessageBox(NULL, L"Failed to create XAudio2 engine instance", L"Error", 0);
+		return;
+	}
+
+	voicePool_ = new VoicePool(backend_);
+
 	for(int i = 0; i < NUM_SOUND; ++i)
 	{
-		sound_[i]->initialize(audioFile[i]);
+		if (!sound_[i]->initialize(audioFile[i]))
+		{
+			continue;
+		}
+
+		// Create the voices the first time a format shows up
+		const AudioClip& clip = sound_[i]->clip();
+		soundId_[i] = voicePool_->AddSound(clip, 1.0f, minInterval[i], maxInstances[i]);
+		if (soundId_[i] < 0)
+		{
+			if (!voicePool_->AddFormat(clip.format, NUM_VOICE_PER_FORMAT))
+			{
+				MessageBox(NULL, L"Create source voice failed", L"Error", 0);
+				continue;
+			}
+			soundId_[i] = voicePool_->AddSound(clip, 1.0f, minInterval[i], maxInstances[i]);
+		}
 	}
 }
 
 void SoundManager::playSound(SOUND_TYPE soundType)
 {
-	sound_[soundType]->play();
-}
\ No newline at end of file
+	// A dropped trigger is expected when a key is held down, so the result is not checked
+	if (voicePool_)
+	{
+		voicePool_->Play(soundId_[soundType]);
+	}
+}
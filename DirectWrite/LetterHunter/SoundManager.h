@@ -2,7 +2,14 @@
 #define __SOUND_MANAGER_H__
 
 #include "Sound.h"
-
+#include "VoicePool.h"
+#include "XAudio2Backend.h"
+
+/*
+All sounds of the game play through one XAudio2 engine and a fixed pool of voices.
+A sound triggered again while it is still playing gets another voice, so holding a key
+down overlaps the sound instead of queueing buffers on a single voice.
+*/
 class SoundManager
 {
 	enum SOUND_TYPE
@@ -29,9 +36,15 @@ private:
 	void initialize();
 	void playSound(SOUND_TYPE soundType);
 
-	Sound**	sound_;
 	static const int NUM_SOUND = 3;
+
+	// Voices created for each sample format of the sound files
+	static const int NUM_VOICE_PER_FORMAT = 8;
+
+	XAudio2Backend*	backend_;
+	VoicePool*		voicePool_;
+	Sound*			sound_[NUM_SOUND];
+	int				soundId_[NUM_SOUND];
 };
 
 #endif // end __SOUND_MANAGER_H__
-
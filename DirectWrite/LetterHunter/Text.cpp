@@ -1,4 +1,5 @@
 #include "Text.h"
+#include "Assets.h"
 
 #define SAFE_RELEASE(P) if(P){P->Release() ; P = NULL ;}
 
@@ -32,11 +33,12 @@ Text::Text(
 	this->outlineColor = outlineColor;
 	velocity = D2D1::Point2F(0, 0);
 
-	// Create font file reference
+	// Create font file reference, from LetterHunter.pack if the font was packed
 	const WCHAR* filePath = L"C:/Windows/Fonts/ariblk.TTF";
-	HRESULT hr = pDWriteFactory->CreateFontFileReference(
+	HRESULT hr = createFontFile(
+		pDWriteFactory,
+		"Media/Font/ariblk.ttf",
 		filePath,
-		NULL,
 		&pFontFile
 		);
 	if(FAILED(hr))
@@ -33,6 +33,7 @@ void Balls::Update(float timeDelta)
 	{
 		if (citor->isLive) // Only update live particles
 		{
+			citor->lastPosition = citor->position ;
 			citor->position += timeDelta * citor->velocity * 20.0f;
 			citor->age += timeDelta ;
 			if (citor->age > citor->lifeTime)
@@ -53,6 +54,7 @@ void Balls::Update(float timeDelta, D3DXVECTOR3* pos)
 	{
 		if (citor->isLive) // Only update live particles
 		{
+			citor->lastPosition = citor->position ;
 			citor->position += timeDelta * citor->velocity * 30.0f;
 			citor->age += timeDelta ;
 			if (citor->age > citor->lifeTime)
@@ -73,6 +75,7 @@ void Balls::Update(float timeDelta, D3DXVECTOR3* pos, D3DXVECTOR3* velocity)
 	{
 		if (citor->isLive) // Only update live particles
 		{
+			citor->lastPosition = citor->position ;
 			citor->position += timeDelta * citor->velocity * 4.0f;
 			citor->age += timeDelta ;
 			if (citor->age > citor->lifeTime)
@@ -88,6 +91,12 @@ void Balls::Update(float timeDelta, D3DXVECTOR3* pos, D3DXVECTOR3* velocity)
 }
 
 void Balls::Render()
+{
+	Render(1.0f) ;
+}
+
+// Draw the particles alpha of the way from their last to their current position
+void Balls::Render(float alpha)
 {
 	for (vector<Particle>::iterator citor = buffer.begin(); citor != buffer.end(); ++citor)
 	{
@@ -95,9 +104,11 @@ void Balls::Render()
 		{
 			D3DXMATRIX word ;
 			D3DXMatrixIdentity(&word) ;
-			word._41 = citor->position.x ;
-			word._42 = citor->position.y ;
-			word._43 = citor->position.z ;
+			D3DXVECTOR3 position ;
+			D3DXVec3Lerp(&position, &citor->lastPosition, &citor->position, alpha) ;
+			word._41 = position.x ;
+			word._42 = position.y ;
+			word._43 = position.z ;
 			device->SetTransform(D3DTS_WORLD, &word) ;
 			mesh->DrawSubset(0) ;
 		}
@@ -110,6 +121,7 @@ void Balls::ResetParticle(Particle *particle)
 	particle->age = 0.0f ;
 	particle->lifeTime = GetRandomFloat(0.1f, 2.0f) ;
 	particle->position = D3DXVECTOR3(0, 0, 20) ;
+	particle->lastPosition = particle->position ;
 
 	D3DXVECTOR3 min = D3DXVECTOR3(-1.0f, -1.0f, -1.0f);
 	D3DXVECTOR3 max = D3DXVECTOR3( 1.0f,  1.0f,  1.0f);
@@ -125,6 +137,7 @@ void Balls::ResetParticle(Particle* particle, D3DXVECTOR3* pos)
 	particle->age = 0.0f ;
 	particle->lifeTime = 1.0f ; /*GetRandomFloat(0.1f, 1.0f) ;*/
 	particle->position = *pos ;
+	particle->lastPosition = particle->position ;
 
 	D3DXVECTOR3 min = D3DXVECTOR3(-1.0f, -1.0f, -1.0f);
 	D3DXVECTOR3 max = D3DXVECTOR3( 1.0f,  1.0f,  1.0f);
@@ -140,6 +153,7 @@ void Balls::ResetParticle(Particle* particle, D3DXVECTOR3* pos, D3DXVECTOR3* vel
 	particle->age = 0.0f ;
 	particle->lifeTime = GetRandomFloat(0.1f, 1.0f) ;
 	particle->position = *pos ;
+	particle->lastPosition = particle->position ;
 
 	particle->velocity = *velocity ;
 
@@ -21,6 +21,7 @@ public:
 	void Update(float timeDelta, D3DXVECTOR3* pos) ;
 	void Update(float timeDelta, D3DXVECTOR3* pos, D3DXVECTOR3* velocity) ;
 	void Render() ;
+	void Render(float alpha) ;
 	void ResetParticle(Particle* particle) ;
 	void ResetParticle(Particle* particle, D3DXVECTOR3* pos) ;
 	void ResetParticle(Particle* particle, D3DXVECTOR3* pos, D3DXVECTOR3* velocity) ;
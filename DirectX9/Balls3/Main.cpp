@@ -1,7 +1,7 @@
 #include <d3dx9.h>
-#include <MMSystem.h>
 
 #include "Balls3.h"
+#include "GameLoop.h"
 
 LPDIRECT3D9             g_pD3D				= NULL ; // Used to create the D3DDevice
 LPDIRECT3DDEVICE9       g_pd3dDevice		= NULL ; // Our rendering device
@@ -12,6 +12,7 @@ D3DXVECTOR3				g_EmitPos1 ;
 D3DXVECTOR3				g_EmitPos2 ;
 float					g_totalTime			= 0.0f ;
 D3DXMATRIX				g_rotMatrix ;
+GameLoop				g_Loop(60.0, 60.0) ;	// 60 updates and at most 60 frames per second
 
 #define SAFE_RELEASE(P) if(P){ P->Release(); P = NULL;}
 
@@ -94,10 +95,9 @@ void SetupMatrix()
 	g_pd3dDevice->SetTransform(D3DTS_PROJECTION, &proj) ;
 }
 
-VOID Render(float timeDelta)
+// Advance the simulation by one fixed step
+VOID Update(float timeDelta)
 {
-	SetupMatrix() ;
-	
 	// Build up rotation matrix
 	D3DXMatrixRotationZ(&g_rotMatrix, timeDelta * 10.0f) ;
 	D3DXVec3TransformNormal(&g_EmitPos1, &g_EmitPos1, &g_rotMatrix) ;
@@ -105,6 +105,12 @@ VOID Render(float timeDelta)
 
 	g_Balls1->Update(timeDelta, &g_EmitPos1, &g_EmitPos1) ;
 	g_Balls2->Update(timeDelta, &g_EmitPos2, &g_EmitPos2) ;
+}
+
+// Draw the balls alpha of a step after the last update
+VOID Render(float alpha)
+{
+	SetupMatrix() ;
 
 	// Clear the back-buffer to a RED color
 	g_pd3dDevice->Clear( 0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0,0,0), 1.0f, 0 );
@@ -112,8 +118,8 @@ VOID Render(float timeDelta)
 	// Begin the scene
 	if( SUCCEEDED( g_pd3dDevice->BeginScene() ) )
 	{
-		g_Balls1->Render() ;
-		g_Balls2->Render() ;
+		g_Balls1->Render(alpha) ;
+		g_Balls2->Render(alpha) ;
 
 		// End the scene
 		g_pd3dDevice->EndScene();
@@ -140,6 +146,10 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 		}
 		break ;
 
+	case WM_ACTIVATE:
+		g_Loop.SetActive(LOWORD(wParam) != WA_INACTIVE) ;
+		break ;
+
 	case WM_SYSCOMMAND:							
 		{
 			switch (wParam)						
@@ -207,36 +217,9 @@ INT WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR szCmdLi
 		ShowWindow( hWnd, SW_SHOWDEFAULT );
 		UpdateWindow( hWnd );
 
-		// Enter the message loop
-		MSG    msg ; 
-		ZeroMemory( &msg, sizeof(msg) );
-		PeekMessage( &msg, NULL, 0U, 0U, PM_NOREMOVE );
-
-		// Get last time
-		static DWORD lastTime = timeGetTime();
-
-		while (msg.message != WM_QUIT)  
-		{
-			if( PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE) != 0)
-			{
-				TranslateMessage (&msg) ;
-				DispatchMessage (&msg) ;
-			}
-			else // Render the game if there is no message to process
-			{
-				// Get current time
-				DWORD currTime  = timeGetTime();
-
-				// Calculate time elapsed
-				float timeDelta = (currTime - lastTime) * 0.001f;
-
-				// Render
-				Render(timeDelta) ;
-
-				// Update last time to current time for next loop
-				lastTime = currTime;
-			}
-		}
+		// Enter the message loop, fixed updates and a paced frame rate
+		g_Loop.Run([](double stepSeconds) { Update((float)stepSeconds) ; },
+				   [](double alpha) { Render((float)alpha) ; }) ;
 	}
 
 	UnregisterClass(winClass.lpszClassName, hInstance) ;
@@ -15,6 +15,7 @@ public:
 	float age ;					// Time since the particle was born, if age > lifeTime, particle was dead
 
 	D3DXVECTOR3 position ;		// Current position 
+	D3DXVECTOR3 lastPosition ;	// Position before the last update, drawn in between to hide the update steps
 	D3DXVECTOR3 velocity ;		// Current velocity
 	D3DXVECTOR3 gravity;		// g = 9.8
 	D3DXVECTOR3 initVelocity;	// Initial velocity
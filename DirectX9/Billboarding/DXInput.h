@@ -3,6 +3,7 @@
 
 #include <d3dx9.h>
 #include <dinput.h>
+#include "InputSource.h"
 #include <DxErr.h>
 
 #define SAFE_RELEASE(p) { if (p) { (p)->Release(); (p) = NULL; } }
@@ -20,12 +21,18 @@ class DXInput
 public:
 	DXInput(void);
 	~DXInput(void);
-	void Update() ;					// Update keyboard
+	void Update() ;					// Start a step with the input buffered since the last one
 	bool KeyDown(int key) ;			// Is a keyboard key pressed?
+	bool KeyPressed(int key) ;		// Did the key go down in this step, even if it went up again?
+	bool KeyReleased(int key) ;		// Did the key go up in this step?
 	bool ButtonDown(int button) ;	// Is a mouse button down?
+	bool ButtonPressed(int button) ;	// Did a mouse button go down in this step?
 	float MouseDX() const;
 	float MouseDY() const;
 
+	InputQueue& Queue() { return m_Queue ; }	// Push events here to inject input
+	InputState& State() { return m_State ; }	// Set a recorder here to record input
+
 private:
 	bool Init() ;			// Initialize Direct Input
 	bool InitKeyboard() ;	// Initialize keyboard
@@ -36,8 +43,8 @@ private:
 	LPDIRECTINPUT8			m_pDIObject ;
 	LPDIRECTINPUTDEVICE8	m_pDIKeyboardDevice ;	// Keyboard device
 	LPDIRECTINPUTDEVICE8	m_pDIMouseDevice ;		// Mouse device
-	char					m_KeyBuffer[256] ;		// Buffer for keys
-	DIMOUSESTATE2			m_MouseState ;			// Mouse state
+	InputQueue				m_Queue ;				// Changes read from the devices, not applied yet
+	InputState				m_State ;				// Keys and mouse of the current step
 };
 
 #endif // DXINPUT_H
@@ -1,14 +1,14 @@
 #include "FPS.h"
 
+#include <string.h>
+
+// Update the text twice a second
+static const double REFRESH_MS = 500.0 ;
+
 FPS::FPS(void)
 {
 	m_Font = NULL ;
-
-	m_Buffer = new WCHAR[10] ;
-	memset(m_Buffer, 0, sizeof(m_Buffer) * 4) ;
-
-	m_FrameCount = 0 ;
-	m_timeCount = 0 ;
+	m_Text[0] = '\0' ;
 }
 
 FPS::~FPS(void)
@@ -18,53 +18,44 @@ FPS::~FPS(void)
 
 bool FPS::Init( LPDIRECT3DDEVICE9 pd3dDevice)
 {
-	// Create font
+	// Create font, fixed pitch so the columns of the report line up
 	if( S_OK != D3DXCreateFont(pd3dDevice,
-		20,
-		10,
-		5,
+		16,
+		0,
+		FW_NORMAL,
 		1,
 		FALSE,
 		DEFAULT_CHARSET,
 		OUT_DEFAULT_PRECIS, 
 		DEFAULT_QUALITY, 
-		DEFAULT_PITCH | FF_DONTCARE,
-		"Arial", 
+		FIXED_PITCH | FF_MODERN,
+		"Courier New", 
 		&m_Font ))
-		return E_FAIL ;
+		return false ;
 
-	return S_OK ;
+	return true ;
 }
 
 void FPS::Release()
 {
-	delete []m_Buffer ;
-	m_Buffer = NULL ;
-
 	SAFE_RELEASE(m_Font) ;
 }
 
-void FPS::Show(POINT position, float timeDelta)
+void FPS::Show(POINT position, const Profiler& profiler)
 {
-	++m_FrameCount ;
-	m_timeCount += timeDelta ;
-
-	if (m_timeCount >= 1.0f)
+	if (m_Text[0] == '\0' || m_Refresh.ElapsedMs() >= REFRESH_MS)
 	{
-		errno_t result = _itow_s( m_FrameCount, m_Buffer, sizeof(m_Buffer), 10 ) ; 
-		if( result ) // if _itow_s is successful, the return value is zero.
-			throw "Convert integer to string failed!" ;
-
-		m_FrameCount = 0 ;
-		m_timeCount = 0 ;
+		std::string report = profiler.Report() ;
+		strncpy_s(m_Text, sizeof(m_Text), report.c_str(), _TRUNCATE) ;
+		m_Refresh.Restart() ;
 	}
 
 	LONG left	= position.x ;
 	LONG top	= position.y ;
-	LONG right	= position.x + 200 ;
-	LONG bottom	= position.y + 50 ;
+	LONG right	= position.x + 600 ;
+	LONG bottom	= position.y + 200 ;
 
 	RECT rc = { left, top, right, bottom } ;
 
-	m_Font->DrawTextW(NULL, m_Buffer, -1, &rc, DT_TOP|DT_LEFT|DT_SINGLELINE, 0xffff0000) ;
-}
\ No newline at end of file
+	m_Font->DrawTextA(NULL, m_Text, -1, &rc, DT_TOP|DT_LEFT, 0xffff0000) ;
+}
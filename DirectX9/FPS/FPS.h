@@ -2,9 +2,12 @@
 #define FPS_H
 
 #include <d3dx9.h>
+#include "Profiler.h"
+#include "Timer.h"
 
 #define SAFE_RELEASE(P) if(P){ P->Release(); P = NULL;}
 
+// Text overlay of a Profiler, the frame rate and the stage times of the last frames
 class FPS
 {
 public:
@@ -12,15 +15,13 @@ public:
 	~FPS(void);
 
 	bool Init(LPDIRECT3DDEVICE9 pd3dDevice) ;
-	void Show(POINT position, float timeDelta) ;
+	void Show(POINT position, const Profiler& profiler) ;
 	void Release() ;
 
 private:
-	ID3DXFont* m_Font ;	// font
-	WCHAR* m_Buffer ;	// buffer to hold the FPS text
-	int m_FrameCount ;	// frame counter
-	float m_timeCount ;	// timer for current round
+	ID3DXFont* m_Font ;		// font
+	char m_Text[1024] ;		// the report shown
+	Timer m_Refresh ;		// time since the text was updated, it changes too fast to read every frame
 };
 
 #endif
-
@@ -1,19 +1,22 @@
 /*
-This Demo shows how to count frames per second
+This Demo shows how to measure frame times
 Usage:
-Create an instance of FPS
+Create a Profiler and an instance of FPS
 Call Init() in Initialize function
-Call Show() in Render function
+Time the stages of a frame with PROFILE_SCOPE and call EndFrame() once per frame
+Call Show() in Render function to draw the report
+Press T to write the frames since the last T to trace.json, open it in chrome://tracing
 */
 
 #include <d3dx9.h>
-#include <MMSystem.h>
 #include "FPS.h"
 
 LPDIRECT3D9             g_pD3D				= NULL ; // Used to create the D3DDevice
 LPDIRECT3DDEVICE9       g_pd3dDevice		= NULL ; // Our rendering device
 ID3DXMesh*				g_pTeapotMesh				= NULL ; // Hold the teapot
 FPS*					g_FPS				= NULL ;
+Profiler				g_Profiler ;		 // Frame and stage times
+bool					g_bTracing			= false ;
 
 HRESULT InitD3D( HWND hWnd )
 {
@@ -83,28 +86,61 @@ void SetupMatrix()
 	g_pd3dDevice->SetTransform(D3DTS_PROJECTION, &proj) ;
 }
 
-VOID Render(float timeDelta)
+VOID Render()
 {
-	SetupMatrix() ;
+	{
+		PROFILE_SCOPE(g_Profiler, "update") ;
+		SetupMatrix() ;
+	}
+
+	{
+		PROFILE_SCOPE(g_Profiler, "draw") ;
+
+		// Clear the back-buffer to a RED color
+		g_pd3dDevice->Clear( 0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0,0,0), 1.0f, 0 );
 
-	// Clear the back-buffer to a RED color
-	g_pd3dDevice->Clear( 0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0,0,0), 1.0f, 0 );
+		// Begin the scene
+		if( SUCCEEDED( g_pd3dDevice->BeginScene() ) )
+		{
+			POINT point = {10, 10} ;
+			g_FPS->Show(point, g_Profiler) ;
+
+			// Draw teapot 
+			g_pTeapotMesh->DrawSubset(0) ;
+
+			// End the scene
+			g_pd3dDevice->EndScene();
+		}
+	}
 
-	// Begin the scene
-	if( SUCCEEDED( g_pd3dDevice->BeginScene() ) )
 	{
-		POINT point = {10, 10} ;
-		g_FPS->Show(point, timeDelta) ;
+		PROFILE_SCOPE(g_Profiler, "present") ;
+
+		// Present the back-buffer contents to the display
+		g_pd3dDevice->Present( NULL, NULL, NULL, NULL );
+	}
 
-		// Draw teapot 
-		g_pTeapotMesh->DrawSubset(0) ;
+	g_Profiler.EndFrame() ;
+}
 
-		// End the scene
-		g_pd3dDevice->EndScene();
+// Start a trace, or write the one running to trace.json
+void ToggleTrace(HWND hWnd)
+{
+	if (!g_bTracing)
+	{
+		g_Profiler.StartTrace() ;
+		g_bTracing = true ;
+		SetWindowTextA(hWnd, "FPS - tracing, press T to save") ;
+		return ;
 	}
 
-	// Present the back-buffer contents to the display
-	g_pd3dDevice->Present( NULL, NULL, NULL, NULL );
+	g_Profiler.StopTrace() ;
+	g_bTracing = false ;
+	if (!g_Profiler.WriteChromeTrace("trace.json"))
+	{
+		MessageBoxA(hWnd, "Write trace.json failed!", "Error", 0) ;
+	}
+	SetWindowTextA(hWnd, "FPS") ;
 }
 
 LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
@@ -118,6 +154,9 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 			case VK_ESCAPE:
 				SendMessage( hWnd, WM_CLOSE, 0, 0 );
 				break ;
+			case 'T':
+				ToggleTrace(hWnd) ;
+				break ;
 			default:
 				break ;
 			}
@@ -196,9 +235,6 @@ INT WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR szCmdLi
 		ZeroMemory( &msg, sizeof(msg) );
 		PeekMessage( &msg, NULL, 0U, 0U, PM_NOREMOVE );
 
-		// Get last time
-		static DWORD lastTime = timeGetTime();
-
 		while (msg.message != WM_QUIT)  
 		{
 			if( PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE) != 0)
@@ -208,17 +244,7 @@ INT WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR szCmdLi
 			}
 			else // Render the game if there is no message to process
 			{
-				// Get current time
-				DWORD currTime  = timeGetTime();
-
-				// Calculate time elapsed
-				float timeDelta = (currTime - lastTime) * 0.001f;
-
-				// Render
-				Render(timeDelta) ;
-
-				// Update last time to current time for next loop
-				lastTime = currTime;
+				Render() ;
 			}
 		}
 	}
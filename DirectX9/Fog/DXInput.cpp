@@ -3,6 +3,8 @@
 DXInput::DXInput(void)
 {
 	m_pDIObject = NULL ;
+	m_pDIKeyboardDevice = NULL ;
+	m_pDIMouseDevice = NULL ;
 	Init() ;
 }
 
@@ -88,6 +90,14 @@ bool DXInput::InitKeyboard()
 		return false ;
 	}
 
+	// Keep every key change until Update reads it, so short taps between two frames are not lost
+	hr = EnableBufferedInput(m_pDIKeyboardDevice) ;
+	if(FAILED(hr))
+	{
+		DXTRACE_ERR_MSGBOX(DXGetErrorString(hr), hr) ;
+		return false ;
+	}
+
 	// Set keyboard cooperate level
 	hr = m_pDIKeyboardDevice->SetCooperativeLevel(GetForegroundWindow(), DISCL_BACKGROUND | DISCL_NONEXCLUSIVE) ;
 	if (FAILED(hr))
@@ -127,6 +137,14 @@ bool DXInput::InitMouse()
 		return false ;
 	}
 
+	// Keep the mouse changes too, clicks shorter than a frame were missed
+	hr = EnableBufferedInput(m_pDIMouseDevice) ;
+	if(FAILED(hr))
+	{
+		DXTRACE_ERR_MSGBOX(DXGetErrorString(hr), hr) ;
+		return false ;
+	}
+
 	// Set mouse cooperate level
 	hr = m_pDIMouseDevice->SetCooperativeLevel(GetForegroundWindow(),DISCL_BACKGROUND | DISCL_NONEXCLUSIVE) ;
 	if(FAILED(hr))
@@ -146,49 +164,54 @@ bool DXInput::InitMouse()
 	return true ;
 }
 
-// Update keyboard state
+// Apply the key and mouse changes buffered since the last call, call once per simulation step
 void DXInput::Update()
 {
-	// Update keyboard
-	if (FAILED(m_pDIKeyboardDevice->GetDeviceState(sizeof(m_KeyBuffer), (LPVOID)&m_KeyBuffer)))
+	if (m_pDIKeyboardDevice)
 	{
-		// Keyboard lost, zero out keyboard data structure.
-		ZeroMemory(m_KeyBuffer, sizeof(m_KeyBuffer));
-
-		// Try to acquire for next time we poll.
-		m_pDIKeyboardDevice->Acquire() ;
-		
+		ReadKeyboardEvents(m_pDIKeyboardDevice, m_Queue) ;
 	}
 
-	// Update mouse
-	if(DIERR_INPUTLOST == m_pDIMouseDevice->GetDeviceState(sizeof(m_MouseState),(LPVOID)&m_MouseState))
+	if (m_pDIMouseDevice)
 	{
-		ZeroMemory(&m_MouseState, sizeof(m_MouseState)) ;
-		m_pDIMouseDevice->Acquire();
+		ReadMouseEvents(m_pDIMouseDevice, m_Queue) ;
 	}
+
+	m_State.BeginStep(m_Queue) ;
 }
 
 // Determine whether a key was pressed
 bool DXInput::KeyDown(int key)
 {
-	if (m_KeyBuffer[key] & 0x80)
-	{
-		return true ;
-	}
-	return false ;
+	return m_State.KeyDown(key) ;
+}
+
+bool DXInput::KeyPressed(int key)
+{
+	return m_State.KeyPressed(key) ;
+}
+
+bool DXInput::KeyReleased(int key)
+{
+	return m_State.KeyReleased(key) ;
 }
 
 bool DXInput::ButtonDown(int button)
 {
-	return (m_MouseState.rgbButtons[button] & 0x80) != 0;
+	return m_State.ButtonDown(button) ;
+}
+
+bool DXInput::ButtonPressed(int button)
+{
+	return m_State.ButtonPressed(button) ;
 }
 
 float DXInput::MouseDX() const
 {
-	return (float)m_MouseState.lX;
+	return (float)m_State.MouseDX() ;
 }
 
 float DXInput::MouseDY() const
 {
-	return (float)m_MouseState.lY;
+	return (float)m_State.MouseDY() ;
 }
\ No newline at end of file
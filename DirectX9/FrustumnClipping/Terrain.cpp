@@ -1,4 +1,9 @@
 #include "Terrain.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+
+// The grid is generated once and loaded from this file on later runs
+static const char* TERRAIN_MESH_FILE = "Terrain.mesh" ;
 
 Terrain::Terrain(void)
 {
@@ -108,15 +113,55 @@ void Terrain::BuildGridsBuffer(LPDIRECT3DDEVICE9 pd3dDevice)
 {
 	InitAllVertexDeclarations(pd3dDevice) ;
 
-	std::vector<D3DXVECTOR3> verts;
-	std::vector<DWORD> indices;
-
-	GenerateGrids(100, 100, 1.0f, 1.0f, D3DXVECTOR3(0.0f, 0.0f, 0.0f), verts, indices);
-
 	// Save vertex count and triangle count for DrawIndexedPrimitive arguments.
 	mNumVertices  = 100 * 100;
 	mNumTriangles = 99 * 99 * 2;
 
+	// The mesh file is keyed by the GenerateGrids arguments, so changing them makes a new one.
+	// The last number is the version of the triangle order below.
+	float gridParameters[] = { 100.0f, 100.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 2.0f };
+	unsigned long long key = MeshFileKey(gridParameters, sizeof(gridParameters));
+
+	std::vector<D3DXVECTOR3> verts;
+	std::vector<WORD> indices;
+	const void* vertexData = NULL;
+	const void* indexData = NULL;
+
+	MeshFile file;
+	if (file.Open(TERRAIN_MESH_FILE, key) && file.Header().vertexCount == mNumVertices &&
+		file.Header().vertexStride == sizeof(VertexPos) && file.Header().indexSize == sizeof(WORD) &&
+		file.Header().indexCount == mNumTriangles * 3)
+	{
+		vertexData = file.Vertices();
+		indexData = file.Indices();
+	}
+	else
+	{
+		std::vector<DWORD> gridIndices;
+		GenerateGrids(100, 100, 1.0f, 1.0f, D3DXVECTOR3(0.0f, 0.0f, 0.0f), verts, gridIndices);
+
+		// Order the triangles for the vertex cache, the file keeps that order so it costs
+		// nothing on later runs
+		std::vector<unsigned int> ordered(gridIndices.begin(), gridIndices.end());
+		OptimizeVertexCacheTipsify(&ordered[0], &ordered[0], ordered.size(), verts.size());
+		indices.assign(ordered.begin(), ordered.end());
+
+		// Not being able to write the file only costs the next start the generation
+		MeshFileSource source;
+		source.vertices = &verts[0];
+		source.vertexStride = sizeof(VertexPos);
+		source.vertexCount = mNumVertices;
+		source.vertexFormat = D3DFVF_XYZ;
+		source.indices = &indices[0];
+		source.indexSize = sizeof(WORD);
+		source.indexCount = mNumTriangles * 3;
+		source.sourceKey = key;
+		WriteMeshFile(TERRAIN_MESH_FILE, source);
+
+		vertexData = &verts[0];
+		indexData = &indices[0];
+	}
+
 	// Obtain a pointer to a new vertex buffer.
 	pd3dDevice->CreateVertexBuffer(mNumVertices * sizeof(VertexPos), 
 		D3DUSAGE_WRITEONLY,	0, D3DPOOL_MANAGED, &mVB, 0);
@@ -125,10 +170,7 @@ void Terrain::BuildGridsBuffer(LPDIRECT3DDEVICE9 pd3dDevice)
 	// grid's vertex data.
 	VertexPos* v = 0;
 	mVB->Lock(0, 0, (void**)&v, 0);
-
-	for(DWORD i = 0; i < mNumVertices; ++i)
-		v[i] = verts[i];
-
+	memcpy(v, vertexData, mNumVertices * sizeof(VertexPos));
 	mVB->Unlock();
 
 
@@ -141,10 +183,7 @@ void Terrain::BuildGridsBuffer(LPDIRECT3DDEVICE9 pd3dDevice)
 
 	WORD* k = 0;
 	mIB->Lock(0, 0, (void**)&k, 0);
-
-	for(DWORD i = 0; i < mNumTriangles*3; ++i)
-		k[i] = (WORD)indices[i];
-
+	memcpy(k, indexData, mNumTriangles * 3 * sizeof(WORD));
 	mIB->Unlock();
 }
 
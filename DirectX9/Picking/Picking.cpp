@@ -1,4 +1,6 @@
 #include <d3dx9.h>   
+#include "MeshBvh.h"
+#include "MeshFile.h"
 #pragma warning( disable : 4996 ) // disable deprecated warning    
 #pragma warning( default : 4996 )    
   
@@ -6,6 +8,10 @@
 LPDIRECT3D9             g_pD3D       = NULL;    
 LPDIRECT3DDEVICE9       g_pd3dDevice = NULL; // Our rendering device   
 ID3DXMesh* g_mesh = 0; // mesh for sphere
+ID3DXMesh* g_teapot = 0; // mesh for teapot
+bool g_showTeapot = false ; // space key switches between the sphere and the teapot
+MeshBvh g_sphereBvh ; // triangles of the sphere, for picking
+MeshBvh g_teapotBvh ; // triangles of the teapot, for picking
 
 // forward declaration
 
@@ -22,6 +28,22 @@ Ray CalcPickingRay(LPDIRECT3DDEVICE9 Device, int x, int y) ;
 // transform the picking ray from view space to world space
 void TransformRay(Ray* ray, D3DXMATRIX* T) ;
 
+// build the tree over the triangles of a mesh to test the picking ray against
+void BuildMeshBvh(ID3DXMesh* mesh, MeshBvh& bvh) ;
+
+// load a D3DX shape from its mesh file, or create it and write the file for the next run
+ID3DXMesh* LoadShape(const char* path, const char* shape, HRESULT (*create)(ID3DXMesh** mesh)) ;
+
+HRESULT CreateSphere(ID3DXMesh** mesh)
+{
+	return D3DXCreateSphere(g_pd3dDevice, 1.0f, 10, 10, mesh, NULL) ;
+}
+
+HRESULT CreateTeapot(ID3DXMesh** mesh)
+{
+	return D3DXCreateTeapot(g_pd3dDevice, mesh, NULL) ;
+}
+
 HRESULT InitD3D( HWND hWnd )   
 {   
     // Create the D3D object.   
@@ -51,7 +73,16 @@ HRESULT InitD3D( HWND hWnd )
     g_pd3dDevice->SetRenderState( D3DRS_LIGHTING , FALSE );   
   
 	// Create a sphere
-	D3DXCreateSphere(g_pd3dDevice, 1.0f, 10, 10, &g_mesh, NULL) ;
+	g_mesh = LoadShape("Sphere.mesh", "D3DXCreateSphere 1 10 10", CreateSphere) ;
+	if (g_mesh == NULL)
+		return E_FAIL ;
+	BuildMeshBvh(g_mesh, g_sphereBvh) ;
+
+	// And a teapot
+	g_teapot = LoadShape("Teapot.mesh", "D3DXCreateTeapot", CreateTeapot) ;
+	if (g_teapot == NULL)
+		return E_FAIL ;
+	BuildMeshBvh(g_teapot, g_teapotBvh) ;
 
     return S_OK;   
 }   
@@ -66,6 +97,9 @@ VOID Cleanup()
 
 	if(g_mesh != NULL)
 		g_mesh->Release();
+
+	if(g_teapot != NULL)
+		g_teapot->Release();
 }   
   
 VOID SetupMatrix()   
@@ -101,8 +135,11 @@ VOID Render()
     {   
         SetupMatrix() ;   
   
-		// Draw the sphere
-		g_mesh->DrawSubset(0) ;
+		// Draw the sphere or the teapot
+		if(g_showTeapot)
+			g_teapot->DrawSubset(0) ;
+		else
+			g_mesh->DrawSubset(0) ;
 
         g_pd3dDevice->EndScene();   
     }   
@@ -126,8 +163,13 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
                 case VK_ESCAPE:   
                     PostQuitMessage(0);   
                     break ;   
+
+				case VK_SPACE:
+					g_showTeapot = !g_showTeapot ;
+					break ;
             }   
         } 
+		return 0 ;
 
 		// User click on screen
 		case WM_LBUTTONDOWN:
@@ -151,9 +193,12 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 			// apply on the ray
 			TransformRay(&ray, &viewInverse) ;
 
-			// collision detection
-			D3DXVECTOR3 v(0.0f, 0.0f, 0.0f);
-			if(D3DXSphereBoundProbe(&v, 1.0f, &ray._origin, &ray._direction))
+			// collision detection against the triangles, the world matrix is the identity
+			// so the world space ray is also in the space of the mesh
+			Ray3 worldRay(Vec3((const float*)ray._origin), Vec3((const float*)ray._direction)) ;
+			const MeshBvh& bvh = g_showTeapot ? g_teapotBvh : g_sphereBvh ;
+			RayHit hit ;
+			if(bvh.Intersect(worldRay, hit))
 			{
 				g_pd3dDevice->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
 			}
@@ -269,4 +314,109 @@ void TransformRay(Ray* ray, D3DXMATRIX* invertViewMatrix)
 
 	// normalize the direction
 	D3DXVec3Normalize(&ray->_direction, &ray->_direction);
-}
\ No newline at end of file
+}
+
+// build the tree over the triangles of a mesh to test the picking ray against
+void BuildMeshBvh(ID3DXMesh* mesh, MeshBvh& bvh)
+{
+	bvh.Clear() ;
+
+	void* vertices = NULL ;
+	if (FAILED(mesh->LockVertexBuffer(D3DLOCK_READONLY, &vertices)))
+		return ;
+
+	void* indices = NULL ;
+	if (SUCCEEDED(mesh->LockIndexBuffer(D3DLOCK_READONLY, &indices)))
+	{
+		// the position is the first element of the vertex
+		DWORD stride = mesh->GetNumBytesPerVertex() ;
+		if (mesh->GetOptions() & D3DXMESH_32BIT)
+			bvh.Build(vertices, stride, (const unsigned int*)indices, mesh->GetNumFaces()) ;
+		else
+			bvh.Build(vertices, stride, (const unsigned short*)indices, mesh->GetNumFaces()) ;
+		mesh->UnlockIndexBuffer() ;
+	}
+
+	mesh->UnlockVertexBuffer() ;
+}
+
+// copy the streams of the file into a mesh created with its counts and format
+bool FillMesh(ID3DXMesh* mesh, const MeshFile& file)
+{
+	if (mesh->GetNumBytesPerVertex() != file.Header().vertexStride)
+		return false ;
+
+	void* vertices = NULL ;
+	if (FAILED(mesh->LockVertexBuffer(0, &vertices)))
+		return false ;
+	memcpy(vertices, file.Vertices(), file.VertexBytes()) ;
+	mesh->UnlockVertexBuffer() ;
+
+	void* indices = NULL ;
+	if (FAILED(mesh->LockIndexBuffer(0, &indices)))
+		return false ;
+	memcpy(indices, file.Indices(), file.IndexBytes()) ;
+	mesh->UnlockIndexBuffer() ;
+
+	// one subset, as D3DX makes its shapes
+	DWORD* attributes = NULL ;
+	if (FAILED(mesh->LockAttributeBuffer(0, &attributes)))
+		return false ;
+	memset(attributes, 0, mesh->GetNumFaces() * sizeof(DWORD)) ;
+	mesh->UnlockAttributeBuffer() ;
+
+	return true ;
+}
+
+void SaveMesh(const char* path, unsigned long long key, ID3DXMesh* mesh)
+{
+	void* vertices = NULL ;
+	if (FAILED(mesh->LockVertexBuffer(D3DLOCK_READONLY, &vertices)))
+		return ;
+
+	void* indices = NULL ;
+	if (SUCCEEDED(mesh->LockIndexBuffer(D3DLOCK_READONLY, &indices)))
+	{
+		MeshFileSource source ;
+		source.vertices = vertices ;
+		source.vertexStride = mesh->GetNumBytesPerVertex() ;
+		source.vertexCount = mesh->GetNumVertices() ;
+		source.vertexFormat = mesh->GetFVF() ;
+		source.indices = indices ;
+		source.indexSize = (mesh->GetOptions() & D3DXMESH_32BIT) ? 4 : 2 ;
+		source.indexCount = mesh->GetNumFaces() * 3 ;
+		source.sourceKey = key ;
+
+		// a file that cannot be written only means creating the shape again next time
+		WriteMeshFile(path, source) ;
+		mesh->UnlockIndexBuffer() ;
+	}
+
+	mesh->UnlockVertexBuffer() ;
+}
+
+ID3DXMesh* LoadShape(const char* path, const char* shape, HRESULT (*create)(ID3DXMesh** mesh))
+{
+	// the key is the call that makes the shape, so a different call does not load a stale file
+	unsigned long long key = MeshFileKey(shape, strlen(shape)) ;
+	ID3DXMesh* mesh = NULL ;
+
+	MeshFile file ;
+	if (file.Open(path, key))
+	{
+		const MeshFileHeader& header = file.Header() ;
+		DWORD options = D3DXMESH_MANAGED | (header.indexSize == 4 ? D3DXMESH_32BIT : 0) ;
+		if (SUCCEEDED(D3DXCreateMeshFVF(header.indexCount / 3, header.vertexCount, options, header.vertexFormat, g_pd3dDevice, &mesh)))
+		{
+			if (FillMesh(mesh, file))
+				return mesh ;
+			mesh->Release() ;
+			mesh = NULL ;
+		}
+	}
+
+	if (FAILED(create(&mesh)))
+		return NULL ;
+	SaveMesh(path, key, mesh) ;
+	return mesh ;
+}
@@ -1,5 +1,6 @@
 #include "QuadTree.h"
 #include "stdio.h"
+#include "MeshOptimizer.h"
 
 int TreeNode::NODEID = 0;
 QuadTree::QuadTree(void):mdx(1.0f), mdz(1.0f), mdrawCount(0)
@@ -84,7 +85,7 @@ bool QuadTree::createTree(TreeNode* root, float centerX, float centerZ, float ra
 		}
 
 		// Create index array
-		DWORD* indices = new DWORD[triangleCount * 3];
+		unsigned int* indices = new unsigned int[triangleCount * 3];
 		
 		// index array index
 		k = 0;
@@ -114,6 +115,9 @@ bool QuadTree::createTree(TreeNode* root, float centerX, float centerZ, float ra
 			}
 		}
 
+		// Row order misses the vertex cache on every new row, reorder the triangles for it
+		OptimizeVertexCacheTipsify(indices, indices, indexCount, vertexCount);
+
 		#define VERTEX_FVF  D3DFVF_XYZ
 
 		// Create mesh
@@ -331,7 +335,7 @@ bool QuadTree::createTree1( TreeNode* root, float centerX, float centerZ, float
 		}
 
 		// Create index array
-		DWORD* indices = new DWORD[triangleCount * 3];
+		unsigned int* indices = new unsigned int[triangleCount * 3];
 
 		// index array index
 		k = 0;
@@ -362,6 +366,9 @@ bool QuadTree::createTree1( TreeNode* root, float centerX, float centerZ, float
 			}
 		}
 
+		// Row order misses the vertex cache on every new row, reorder the triangles for it
+		OptimizeVertexCacheTipsify(indices, indices, indexCount, vertexCount);
+
 		// Create vertex buffer
 #define D3D_FVF  D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX2
 		if( FAILED( device->CreateVertexBuffer( vertexCount * sizeof(Vertex),
@@ -7,6 +7,8 @@ and synchronize the content of the left screen to it
 #include <d3dx9.h> 
 #include <DxErr.h>
 #include <dxdiag.h>
+#include <vector>
+#include "TileDiff.h"
 
 LPDIRECT3D9             g_pD3D			= NULL ; // Used to create the D3DDevice 
 LPDIRECT3DDEVICE9       g_pd3dDevice	= NULL ; // Our rendering device 
@@ -19,6 +21,11 @@ D3DPRESENT_PARAMETERS d3dpp ;
 int ScreenWidth = -1;
 int ScreenHeight = -1 ;
 
+// Finds the 64x64 tiles that changed since last frame, only those are sent to the back buffer
+TileDiff g_TileDiff ;
+std::vector<TileRect> g_DirtyTiles ;
+std::vector<TileRect> g_DirtyRects ;
+
 #define SAFE_RELEASE(p) if (p){p->Release() ; p = NULL ;}
 
 HRESULT InitD3D( HWND hWnd ) 
@@ -43,7 +50,7 @@ HRESULT InitD3D( HWND hWnd )
 	d3dpp.BackBufferCount = 1 ;
 	d3dpp.BackBufferWidth = ddm.Width ;
 	d3dpp.BackBufferHeight = ddm.Height ;
-	d3dpp.SwapEffect = D3DSWAPEFFECT_DISCARD; 
+	d3dpp.SwapEffect = D3DSWAPEFFECT_COPY;	// back buffer must keep its content, only dirty tiles are updated
 	d3dpp.BackBufferFormat = D3DFMT_A8R8G8B8; 
 
 	// Create device 
@@ -65,6 +72,8 @@ HRESULT InitD3D( HWND hWnd )
 		return hr;
 	}
 
+	g_TileDiff.Reset(d3dpp.BackBufferWidth, d3dpp.BackBufferHeight) ;
+
 	return S_OK; 
 } 
 
@@ -83,28 +92,44 @@ VOID Cleanup()
 	SAFE_RELEASE(g_pBackBuffer) ;
 } 
 
-BOOL ScreenShot()
+HRESULT ScreenShot()
 {
 	HRESULT hr;
 	if (FAILED(hr = g_pd3dDevice->GetFrontBufferData(0, g_pSourceSurface))) 
 	{
 		return hr ;
 	}
-	
-	// area to capture
-	RECT rect ;
-	rect.left = 0 ;
-	rect.right =  ScreenWidth / 2;
-	rect.top = 0 ;
-	rect.bottom = ScreenHeight ;
-
-	hr = D3DXLoadSurfaceFromSurface(g_pBackBuffer, NULL, NULL, g_pSourceSurface, NULL, NULL, D3DX_DEFAULT, NULL) ;
-	//hr = g_pd3dDevice->UpdateSurface(g_pSourceSurface, &rect, g_pBackBuffer, NULL) ;
-	if (FAILED(hr)) 
+
+	// Find the tiles that changed since last frame
+	D3DLOCKED_RECT lockedRect ;
+	if (FAILED(hr = g_pSourceSurface->LockRect(&lockedRect, NULL, D3DLOCK_READONLY)))
 	{
 		return hr ;
 	}
 
+	FrameView frame((unsigned char*)lockedRect.pBits, d3dpp.BackBufferWidth, d3dpp.BackBufferHeight, lockedRect.Pitch) ;
+	g_TileDiff.Diff(frame, g_DirtyTiles) ;
+	g_pSourceSurface->UnlockRect() ;
+
+	// Copy dirty tiles to back buffer, one UpdateSurface call per run of tiles
+	TileDiff::MergeRows(g_DirtyTiles, g_DirtyRects) ;
+	for (size_t i = 0; i < g_DirtyRects.size(); ++i)
+	{
+		const TileRect& tile = g_DirtyRects[i] ;
+
+		RECT rect ;
+		rect.left = tile.left ;
+		rect.top = tile.top ;
+		rect.right = tile.right ;
+		rect.bottom = tile.bottom ;
+
+		POINT destPoint = { tile.left, tile.top } ;
+		if (FAILED(hr = g_pd3dDevice->UpdateSurface(g_pSourceSurface, &rect, g_pBackBuffer, &destPoint)))
+		{
+			return hr ;
+		}
+	}
+
 	return hr ;
 }
 
@@ -120,6 +145,12 @@ VOID Render(FLOAT timeElapse)
 
 	ScreenShot() ;
 
+	// Nothing changed on the desktop, no need to present
+	if (g_DirtyRects.empty())
+	{
+		return ;
+	}
+
 	// Present the back-buffer contents to the display 
 	g_pd3dDevice->Present( NULL, NULL, NULL, NULL ); 
 } 
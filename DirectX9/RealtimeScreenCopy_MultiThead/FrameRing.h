@@ -0,0 +1,97 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+
+// Size of a cache line on x86/x64, used to keep the producer and consumer indices apart
+#define FRAME_RING_CACHE_LINE 64
+
+/*
+Lock-free single-producer/single-consumer ring of frame slots.
+
+The producer calls BeginWrite to get a free slot, fills it, then calls EndWrite to publish it.
+The consumer calls BeginRead to get the newest published slot, uses it, then calls EndRead.
+When the consumer falls behind, BeginRead skips the older frames (latest frame wins) and hands
+them back to the producer straight away, so capture never waits on a slow presenter for long.
+
+head_ is only written by the consumer and tail_ only by the producer, both are free-running
+counters, so Capacity must be a power of two.
+*/
+template <typename T, unsigned int Capacity>
+class FrameRing
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two") ;
+
+public:
+	FrameRing() : head_(0), tail_(0) {}
+
+	// Slot storage, the caller creates the resources held by each slot up front
+	T& Slot(unsigned int i) { return slots_[i] ; }
+
+	// Number of published frames not yet consumed
+	unsigned int Depth() const
+	{
+		return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) ;
+	}
+
+	// Producer side, return NULL if all slots are in use
+	T* BeginWrite()
+	{
+		unsigned int tail = tail_.load(std::memory_order_relaxed) ;
+		unsigned int head = head_.load(std::memory_order_acquire) ;
+		if (tail - head >= Capacity)
+		{
+			return NULL ;
+		}
+
+		return &slots_[tail & (Capacity - 1)] ;
+	}
+
+	void EndWrite()
+	{
+		tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release) ;
+	}
+
+	// Consumer side, return the newest frame or NULL if the ring is empty.
+	// skipped receives the number of older frames that were dropped.
+	T* BeginRead(unsigned int* skipped)
+	{
+		unsigned int head = head_.load(std::memory_order_relaxed) ;
+		unsigned int tail = tail_.load(std::memory_order_acquire) ;
+		if (head == tail)
+		{
+			if (skipped) *skipped = 0 ;
+			return NULL ;
+		}
+
+		// Release the stale frames before reading, so the producer can reuse them
+		unsigned int newest = tail - 1 ;
+		if (skipped) *skipped = newest - head ;
+		if (newest != head)
+		{
+			head_.store(newest, std::memory_order_release) ;
+		}
+
+		return &slots_[newest & (Capacity - 1)] ;
+	}
+
+	void EndRead()
+	{
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release) ;
+	}
+
+private:
+	T slots_[Capacity] ;
+
+	char pad0_[FRAME_RING_CACHE_LINE] ;
+	std::atomic<unsigned int> head_ ;	// next slot to read, written by consumer only
+	char pad1_[FRAME_RING_CACHE_LINE - sizeof(std::atomic<unsigned int>)] ;
+	std::atomic<unsigned int> tail_ ;	// next slot to write, written by producer only
+	char pad2_[FRAME_RING_CACHE_LINE - sizeof(std::atomic<unsigned int>)] ;
+
+	// Not copyable
+	FrameRing(const FrameRing&) ;
+	FrameRing& operator=(const FrameRing&) ;
+};
+
+#endif // end FRAME_RING_H
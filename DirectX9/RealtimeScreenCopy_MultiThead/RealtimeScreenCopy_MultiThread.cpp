@@ -1,4 +1,6 @@
 #include <d3dx9.h>
+#include <stdio.h>
+#include "FrameRing.h"
 
 LPDIRECT3D9             g_pD3D			= NULL ;  
 LPDIRECT3DDEVICE9       g_pd3dDevice	= NULL ; 
@@ -10,21 +12,57 @@ D3DPRESENT_PARAMETERS d3dpp ;
 int screenWidth ;
 int screenHeight ;
 RECT rect ;	// area to copy to back buffer
-bool g_bEndRender = FALSE ;
+volatile bool g_bEndRender = FALSE ;
+HWND g_hWnd = NULL ;
 
-const int g_PoolSize = 10 ;
-IDirect3DSurface9* g_SurfPool[g_PoolSize] ;
+// Posted by a worker thread that failed, lParam is the message to show. The workers never
+// open a message box themselves, the UI thread may be waiting for them to exit.
+#define WM_CAPTURE_ERROR (WM_APP + 1)
 
-// Mutex variable
-HANDLE g_hMutex;
-HANDLE g_hFullSemaphore;
-HANDLE g_hEmptySemaphore;
+// How long WM_DESTROY waits for the workers before it gives up on releasing the device
+const DWORD g_StopTimeout = 2000 ;
 
-const int g_ProducerCount = 1 ; // Number of producer thread
-const int g_ConsumerCount = 1 ; // Number of consumer thread
-
-int in = 0 ;	// input index
-int out = 0 ;	// output index
+// One captured desktop image and the time it was taken
+struct FrameSlot
+{
+	IDirect3DSurface9* pSurface ;
+	LONGLONG captureTime ;		// QueryPerformanceCounter ticks when GetFrontBufferData returned
+};
+
+// Producer and consumer exchange frames through a lock-free ring instead of taking turns
+// on a mutex around the copy. Both threads still call into the one device, created with
+// D3DCREATE_MULTITHREADED, and D3D9 holds the device lock for the whole call, so
+// GetFrontBufferData and UpdateSurface/Present still run one after the other. What
+// overlaps is the rest of each loop, the wait for a free or a filled slot. Overlapping the
+// calls themselves would take a second device for capture, and a CPU copy between the
+// devices' surfaces since UpdateSurface only takes surfaces of its own device.
+const int g_PoolSize = 8 ;
+FrameRing<FrameSlot, g_PoolSize> g_FrameRing ;
+
+// Signaled by producer when a new frame was published, consumer sleeps on it when the ring is empty
+HANDLE g_hFrameReady = NULL ;
+
+HANDLE g_hProducerThread = NULL ;
+HANDLE g_hConsumerThread = NULL ;
+
+// Capture statistics, written by consumer thread only and reported once per second
+struct CaptureStats
+{
+	LONGLONG frequency ;		// QueryPerformanceFrequency
+	LONGLONG lastReport ;		// time of last report
+	DWORD framesCaptured ;		// frames published by producer
+	DWORD framesPresented ;		// frames copied to back buffer and presented
+	DWORD framesDropped ;		// frames skipped because consumer was behind
+	DWORD producerStalls ;		// times the producer found the ring full
+	DWORD depthSum ;			// sum of queue depth seen by consumer
+	DWORD depthMax ;
+	LONGLONG latencySum ;		// capture to present latency, in ticks
+	LONGLONG latencyMax ;
+};
+
+CaptureStats g_Stats ;
+volatile LONG g_FramesCaptured = 0 ;
+volatile LONG g_ProducerStalls = 0 ;
 
 DWORD WINAPI Producer(LPVOID);	// Get desktop image
 DWORD WINAPI Consumer(LPVOID);	// Write desktop image to back buffer
@@ -60,19 +98,18 @@ HRESULT InitD3D( HWND hWnd )
 	d3dpp.SwapEffect = D3DSWAPEFFECT_FLIP; 
 	d3dpp.BackBufferFormat = D3DFMT_A8R8G8B8; 
 
-	// Create device 
+	// Create device, producer and consumer call into it from different threads, which the
+	// device serializes, see g_FrameRing
 	if( FAILED( g_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, hWnd, 
-		D3DCREATE_SOFTWARE_VERTEXPROCESSING, 
+		D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_MULTITHREADED, 
 		&d3dpp, &g_pd3dDevice ) ) ) 
 	{ 
 		MessageBoxA(NULL, "Create D3D9 device failed!", "Error", 0) ; 
 		return E_FAIL; 
 	} 
 
-	// Create Semaphore variable
-	g_hMutex = CreateMutex(NULL,FALSE,NULL);
-	g_hFullSemaphore = CreateSemaphore(NULL, g_PoolSize - 1, g_PoolSize - 1, NULL);
-	g_hEmptySemaphore = CreateSemaphore(NULL, 0, g_PoolSize - 1, NULL);
+	// Auto-reset event to wake up the consumer
+	g_hFrameReady = CreateEvent(NULL, FALSE, FALSE, NULL);
 
 	// Get back buffer
 	g_pd3dDevice->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &g_pBackBuffer) ;
@@ -80,40 +117,75 @@ HRESULT InitD3D( HWND hWnd )
 	// Create surface
 	for (int i = 0; i < g_PoolSize; ++i)
 	{
-		g_SurfPool[i] = NULL ;
+		FrameSlot& slot = g_FrameRing.Slot(i) ;
+		slot.pSurface = NULL ;
+		slot.captureTime = 0 ;
 		if (FAILED(hr = g_pd3dDevice->CreateOffscreenPlainSurface(d3dpp.BackBufferWidth, 
-			d3dpp.BackBufferHeight, d3dpp.BackBufferFormat, D3DPOOL_SYSTEMMEM, &g_SurfPool[i], NULL)))
+			d3dpp.BackBufferHeight, d3dpp.BackBufferFormat, D3DPOOL_SYSTEMMEM, &slot.pSurface, NULL)))
 		{
 			return hr;
 		}
 	}
 
+	ZeroMemory(&g_Stats, sizeof(g_Stats)) ;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&g_Stats.frequency) ;
+	QueryPerformanceCounter((LARGE_INTEGER*)&g_Stats.lastReport) ;
+
 	return S_OK; 
 } 
 
 VOID Cleanup() 
 { 
-	SAFE_RELEASE(g_pD3D) ; 
-	SAFE_RELEASE(g_pd3dDevice) ; 
 	SAFE_RELEASE(g_pBackBuffer) ;
 
 	for (int i = 0; i < g_PoolSize; ++i)
 	{
-		SAFE_RELEASE(g_SurfPool[i]) ;
+		SAFE_RELEASE(g_FrameRing.Slot(i).pSurface) ;
+	}
+
+	SAFE_RELEASE(g_pd3dDevice) ; 
+	SAFE_RELEASE(g_pD3D) ; 
+
+	if (g_hFrameReady)
+	{
+		CloseHandle(g_hFrameReady) ;
+		g_hFrameReady = NULL ;
 	}
 } 
 
+// Stop both workers and let the UI thread show the error, unless it is already shutting down
+VOID ReportError(const char* message)
+{
+	if (!g_bEndRender)
+	{
+		g_bEndRender = TRUE ;
+		PostMessage(g_hWnd, WM_CAPTURE_ERROR, 0, (LPARAM)message) ;
+	}
+}
+
 VOID Produce()
 {
+	// Ring full means the consumer still holds every slot, wait a little and try again
+	FrameSlot* slot = g_FrameRing.BeginWrite() ;
+	if (slot == NULL)
+	{
+		InterlockedIncrement(&g_ProducerStalls) ;
+		Sleep(1) ;
+		return ;
+	}
+
 	HRESULT hr ;
-	hr = g_pd3dDevice->GetFrontBufferData(0, g_SurfPool[in]) ;
+	hr = g_pd3dDevice->GetFrontBufferData(0, slot->pSurface) ;
 	if (FAILED(hr))
 	{
-		MessageBox(NULL, "Get desktop image failed!", "Error", 0) ;
+		ReportError("Get desktop image failed!") ;
 	}
 	else
 	{
-		in = (in + 1) % g_PoolSize ;
+		QueryPerformanceCounter((LARGE_INTEGER*)&slot->captureTime) ;
+		g_FrameRing.EndWrite() ;
+		InterlockedIncrement(&g_FramesCaptured) ;
+		SetEvent(g_hFrameReady) ;
 	}
 }
 
@@ -121,40 +193,90 @@ DWORD WINAPI Producer(LPVOID lpParam)
 {
 	while (!g_bEndRender)
 	{
-		WaitForSingleObject(g_hFullSemaphore, INFINITE);
-		WaitForSingleObject(g_hMutex, INFINITE);
 		Produce();
-		ReleaseMutex(g_hMutex);
-		ReleaseSemaphore(g_hEmptySemaphore, 1, NULL);
 	}
 
 	return 0 ;
 }
 
+// Print capture statistics to the debugger output once per second
+VOID ReportStats(LONGLONG now)
+{
+	if (now - g_Stats.lastReport < g_Stats.frequency)
+	{
+		return ;
+	}
+
+	g_Stats.framesCaptured = (DWORD)InterlockedExchange(&g_FramesCaptured, 0) ;
+	g_Stats.producerStalls = (DWORD)InterlockedExchange(&g_ProducerStalls, 0) ;
+
+	double msPerTick = 1000.0 / (double)g_Stats.frequency ;
+	double avgLatency = 0 ;
+	double avgDepth = 0 ;
+	if (g_Stats.framesPresented > 0)
+	{
+		avgLatency = g_Stats.latencySum * msPerTick / g_Stats.framesPresented ;
+		avgDepth = (double)g_Stats.depthSum / g_Stats.framesPresented ;
+	}
+
+	char buffer[256] ;
+	sprintf_s(buffer, sizeof(buffer), 
+		"captured %u, presented %u, dropped %u, stalls %u, latency avg %.2f ms max %.2f ms, depth avg %.2f max %u\n",
+		g_Stats.framesCaptured, g_Stats.framesPresented, g_Stats.framesDropped, g_Stats.producerStalls,
+		avgLatency, g_Stats.latencyMax * msPerTick, avgDepth, g_Stats.depthMax) ;
+	OutputDebugStringA(buffer) ;
+
+	LONGLONG frequency = g_Stats.frequency ;
+	ZeroMemory(&g_Stats, sizeof(g_Stats)) ;
+	g_Stats.frequency = frequency ;
+	g_Stats.lastReport = now ;
+}
+
 VOID Consume()
 {
-	// Update back buffer
-	HRESULT hr;
-	hr = g_pd3dDevice->UpdateSurface(g_SurfPool[out], &rect, g_pBackBuffer, NULL) ;
-	if (FAILED(hr))
+	DWORD depth = g_FrameRing.Depth() ;
+
+	unsigned int skipped = 0 ;
+	FrameSlot* slot = g_FrameRing.BeginRead(&skipped) ;
+	if (slot == NULL)
 	{
-		MessageBox(NULL, "Update back buffer failed!", "Error", 0) ;
+		WaitForSingleObject(g_hFrameReady, 100) ;
+		return ;
 	}
-	else
+
+	// Update back buffer and show it
+	HRESULT hr;
+	hr = g_pd3dDevice->UpdateSurface(slot->pSurface, &rect, g_pBackBuffer, NULL) ;
+	LONGLONG captureTime = slot->captureTime ;
+	g_FrameRing.EndRead() ;
+
+	if (FAILED(hr))
 	{
-		out = (out + 1) % g_PoolSize ;
+		ReportError("Update back buffer failed!") ;
+		return ;
 	}
+
+	g_pd3dDevice->Present( NULL, NULL, NULL, NULL );
+
+	LONGLONG now ;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now) ;
+
+	LONGLONG latency = now - captureTime ;
+	g_Stats.framesPresented++ ;
+	g_Stats.framesDropped += skipped ;
+	g_Stats.depthSum += depth ;
+	g_Stats.latencySum += latency ;
+	if (depth > g_Stats.depthMax) g_Stats.depthMax = depth ;
+	if (latency > g_Stats.latencyMax) g_Stats.latencyMax = latency ;
+
+	ReportStats(now) ;
 }
 
 DWORD WINAPI Consumer(LPVOID lpParam)
 {
 	while (!g_bEndRender)
 	{
-		WaitForSingleObject(g_hEmptySemaphore, INFINITE);
-		WaitForSingleObject(g_hMutex, INFINITE);
 		Consume();
-		ReleaseMutex(g_hMutex);
-		ReleaseSemaphore(g_hFullSemaphore, 1, NULL);
 	}
 
 	return 0 ;
@@ -162,50 +284,64 @@ DWORD WINAPI Consumer(LPVOID lpParam)
 
 VOID CreateProducerThread()
 {
-	for (int i = 0; i < g_ProducerCount; ++i)
+	DWORD dwThreadID = 0 ;
+	g_hProducerThread = CreateThread(	NULL,
+		0,
+		Producer,
+		NULL,
+		CREATE_SUSPENDED,
+		&dwThreadID ) ;
+
+	if (g_hProducerThread)
 	{
-		DWORD dwThreadID = 0 ;
-		HANDLE hBackgroundThread = NULL ;
-		hBackgroundThread = CreateThread(	NULL,
-			0,
-			Producer,
-			NULL,
-			CREATE_SUSPENDED,
-			&dwThreadID ) ;
-
-		if (hBackgroundThread)
-		{
-			ResumeThread(hBackgroundThread) ;
-		}
+		ResumeThread(g_hProducerThread) ;
 	}
 }
 
 VOID CreateConsumerThread()
 {
-	for (int i = 0; i < g_ConsumerCount; ++i)
+	DWORD dwThreadID = 0 ;
+	g_hConsumerThread = CreateThread(	NULL,
+		0,
+		Consumer,
+		NULL,
+		CREATE_SUSPENDED,
+		&dwThreadID ) ;
+
+	if (g_hConsumerThread)
 	{
-		DWORD dwThreadID = 0 ;
-		HANDLE hBackgroundThread = NULL ;
-		hBackgroundThread = CreateThread(	NULL,
-			0,
-			Consumer,
-			NULL,
-			CREATE_SUSPENDED,
-			&dwThreadID ) ;
-
-		if (hBackgroundThread)
-		{
-			ResumeThread(hBackgroundThread) ;
-		}
+		ResumeThread(g_hConsumerThread) ;
 	}
 }
 
-VOID Render() 
-{ 
-	g_pd3dDevice->Clear(0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0,0,0), 1.0f, 0); 
+// Stop both threads before the surfaces they use are released. Returns false if they did
+// not exit in time, the device must then be left alone as they may still be in a call.
+bool StopThreads()
+{
+	g_bEndRender = TRUE ;
+	if (g_hFrameReady)
+	{
+		SetEvent(g_hFrameReady) ;
+	}
 
-	g_pd3dDevice->Present( NULL, NULL, NULL, NULL );
-} 
+	HANDLE threads[2] ;
+	DWORD count = 0 ;
+	if (g_hProducerThread) threads[count++] = g_hProducerThread ;
+	if (g_hConsumerThread) threads[count++] = g_hConsumerThread ;
+	bool stopped = true ;
+	if (count > 0)
+	{
+		stopped = WaitForMultipleObjects(count, threads, TRUE, g_StopTimeout) != WAIT_TIMEOUT ;
+	}
+
+	for (DWORD i = 0; i < count; ++i)
+	{
+		CloseHandle(threads[i]) ;
+	}
+	g_hProducerThread = NULL ;
+	g_hConsumerThread = NULL ;
+	return stopped ;
+}
 
 LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam ) 
 { 
@@ -224,9 +360,17 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 		} 
 		break ; 
 
+	case WM_CAPTURE_ERROR:
+		MessageBox(hWnd, (const char*)lParam, "Error", 0) ;
+		SendMessage( hWnd, WM_CLOSE, 0, 0 );
+		return 0 ;
+
 	case WM_DESTROY: 
-		g_bEndRender = TRUE ;
-		Cleanup(); 
+		// A worker stuck in the device keeps it, the process is exiting anyway
+		if (StopThreads())
+		{
+			Cleanup(); 
+		}
 		PostQuitMessage( 0 ); 
 		return 0; 
 	} 
@@ -281,6 +425,8 @@ INT WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR szCmdLi
 		return -1 ; 
 	} 
 
+	g_hWnd = hWnd ;
+
 	// Initialize Direct3D 
 	if( SUCCEEDED(InitD3D(hWnd))) 
 	{  
@@ -291,22 +437,14 @@ INT WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR szCmdLi
 		ShowWindow( hWnd, SW_SHOWDEFAULT ); 
 		UpdateWindow( hWnd ); 
 
-		// Enter the message loop 
+		// Enter the message loop, the consumer thread presents the frames
 		MSG    msg ;  
 		ZeroMemory( &msg, sizeof(msg) ); 
-		PeekMessage( &msg, NULL, 0U, 0U, PM_NOREMOVE ); 
 
-		while (msg.message != WM_QUIT)   
+		while (GetMessage(&msg, NULL, 0U, 0U) > 0)   
 		{ 
-			if( PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE) != 0) 
-			{ 
-				TranslateMessage (&msg) ; 
-				DispatchMessage (&msg) ; 
-			} 
-			else // Render the game if there is no message to process 
-			{ 
-				Render() ; 
-			} 
+			TranslateMessage (&msg) ; 
+			DispatchMessage (&msg) ; 
 		} 
 	} 
 
@@ -1,55 +1,282 @@
 #include <windows.h>
+#include <stdio.h>
+#include <vector>
+#include "ScreenCodec.h"
+#include "FrameScaler.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+/*
+Screen share loopback: the desktop is captured, diffed and encoded into a byte stream
+that goes through a pipe, a viewer thread decodes the stream and this window shows
+what the viewer rebuilt, so everything a remote viewer would see passes through the codec.
+*/
 
 int ScreenWidth = -1 ;
 int ScreenHeight = -1;
 
-void CopyScreen(HWND hWnd)
+// Last captured desktop image, a top-down 32 bit DIB so its pixels can be read directly
+HDC		g_hCaptureDC = NULL ;
+HBITMAP g_hCaptureBitmap = NULL ;
+HBITMAP g_hOldBitmap = NULL ;
+FrameView g_CaptureFrame ;
+
+// Sender side
+ScreenEncoder g_Encoder ;
+std::vector<unsigned char> g_Packet ;
+PipeStream g_PipeWriter ;
+
+// Viewer side, g_ViewerLock guards the decoded frame between viewer thread and WM_PAINT
+PipeStream g_PipeReader ;
+ScreenDecoder g_Decoder ;
+CRITICAL_SECTION g_ViewerLock ;
+HANDLE g_hViewerThread = NULL ;
+HWND g_hViewerWnd = NULL ;
+
+// Statistics, reported once per second
+DWORD g_LastReport = 0 ;
+int g_FrameCount = 0 ;
+int g_PacketCount = 0 ;
+size_t g_BytesSent = 0 ;
+double g_EncodeMs = 0 ;
+volatile LONG g_DecodedCount = 0 ;
+volatile LONG g_LatencySumUs = 0 ;		// capture to display latency of decoded frames
+double g_ScaleMs = 0 ;
+int g_ScaleCount = 0 ;
+
+// Preview scaling, the decoded frame is resampled to the client area when g_bStretch is set.
+// S toggles stretching, F cycles the filters.
+ThreadPool* g_pScalePool = NULL ;
+FrameScaler g_Scaler ;
+FrameBuffer g_Preview ;
+SCALE_FILTER g_ScaleFilter = SCALE_BILINEAR ;
+volatile bool g_bStretch = true ;
+
+// Create the DIB section that holds the captured area
+BOOL InitScreenCapture(int width, int height)
 {
-	// Get program window DC, this DC is the drawing destination
-	HDC hDC = GetDC(hWnd) ;
-	
-	// Get the desktop DC, this DC is the drawing content
-	HWND hDesktopHwnd = GetDesktopWindow() ;
-	HDC hDesktopDC = GetDC(hDesktopHwnd);
+	BITMAPINFO bmi ;
+	ZeroMemory(&bmi, sizeof(bmi)) ;
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER) ;
+	bmi.bmiHeader.biWidth = width ;
+	bmi.bmiHeader.biHeight = -height ;	// negative height means top-down rows
+	bmi.bmiHeader.biPlanes = 1 ;
+	bmi.bmiHeader.biBitCount = 32 ;
+	bmi.bmiHeader.biCompression = BI_RGB ;
 
-	// Copy desktop content to window
-	BitBlt(hDC, 0, 0, ScreenWidth / 2, ScreenHeight, hDesktopDC, 0, 0, SRCCOPY); 
+	void* pBits = NULL ;
+	g_hCaptureBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0) ;
+	if (!g_hCaptureBitmap)
+	{
+		return FALSE ;
+	}
 
-	ReleaseDC(hDesktopHwnd,hDesktopDC);
-	DeleteDC(hDC);
+	g_hCaptureDC = CreateCompatibleDC(NULL) ;
+	g_hOldBitmap = (HBITMAP)SelectObject(g_hCaptureDC, g_hCaptureBitmap) ;
+
+	// DIB rows are DWORD aligned, always true for 32 bit pixels
+	g_CaptureFrame = FrameView((unsigned char*)pBits, width, height, width * 4) ;
+
+	InitializeCriticalSection(&g_ViewerLock) ;
+	g_pScalePool = new ThreadPool() ;
+	if (!PipeStream::CreatePair(g_PipeReader, g_PipeWriter))
+	{
+		return FALSE ;
+	}
+
+	return g_Encoder.Reset(width, height) ;
+}
+
+void ReleaseScreenCapture()
+{
+	// Closing the write end ends the stream, the viewer thread then exits
+	g_PipeWriter.Close() ;
+	if (g_hViewerThread)
+	{
+		WaitForSingleObject(g_hViewerThread, INFINITE) ;
+		CloseHandle(g_hViewerThread) ;
+		g_hViewerThread = NULL ;
+	}
+	g_PipeReader.Close() ;
+	DeleteCriticalSection(&g_ViewerLock) ;
+
+	delete g_pScalePool ;
+	g_pScalePool = NULL ;
+
+	if (g_hCaptureDC)
+	{
+		SelectObject(g_hCaptureDC, g_hOldBitmap) ;
+		DeleteDC(g_hCaptureDC) ;
+		g_hCaptureDC = NULL ;
+	}
+
+	if (g_hCaptureBitmap)
+	{
+		DeleteObject(g_hCaptureBitmap) ;
+		g_hCaptureBitmap = NULL ;
+	}
+}
+
+// Viewer: read packets from the pipe, rebuild the frame and repaint the tiles that changed
+DWORD WINAPI Viewer(LPVOID lpParam)
+{
+	std::vector<unsigned char> packet ;
+	std::vector<TileRect> tiles ;
+	std::vector<TileRect> rects ;
+
+	while (ReadPacket(g_PipeReader, packet))
+	{
+		EnterCriticalSection(&g_ViewerLock) ;
+		bool decoded = g_Decoder.Decode(&packet[0], packet.size(), &tiles) ;
+		long long captureTime = g_Decoder.LastHeader().captureTime ;
+		LeaveCriticalSection(&g_ViewerLock) ;
+
+		if (!decoded)
+		{
+			OutputDebugStringA("Viewer: malformed packet\n") ;
+			continue ;
+		}
+
+		// A stretched preview is scaled as a whole, tiles do not map to whole pixels
+		if (g_bStretch)
+		{
+			InvalidateRect(g_hViewerWnd, NULL, FALSE) ;
+			tiles.clear() ;
+		}
+
+		TileDiff::MergeRows(tiles, rects) ;
+		for (size_t i = 0; i < rects.size(); ++i)
+		{
+			RECT rect = { rects[i].left, rects[i].top, rects[i].right, rects[i].bottom } ;
+			InvalidateRect(g_hViewerWnd, &rect, FALSE) ;
+		}
+
+		InterlockedIncrement(&g_DecodedCount) ;
+		InterlockedExchangeAdd(&g_LatencySumUs, (LONG)(CaptureTimeNow() - captureTime)) ;
+	}
+
+	return 0 ;
+}
+
+// Show a frame with SetDIBitsToDevice
+void DrawFrame(HDC hdc, const FrameView& frame)
+{
+	BITMAPINFO bmi ;
+	ZeroMemory(&bmi, sizeof(bmi)) ;
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER) ;
+	bmi.bmiHeader.biWidth = frame.pitch / 4 ;	// rows may be padded, describe the padding as extra pixels
+	bmi.bmiHeader.biHeight = -frame.height ;
+	bmi.bmiHeader.biPlanes = 1 ;
+	bmi.bmiHeader.biBitCount = 32 ;
+	bmi.bmiHeader.biCompression = BI_RGB ;
+
+	SetDIBitsToDevice(hdc, 0, 0, frame.width, frame.height, 0, 0, 0, frame.height,
+		frame.pixels, &bmi, DIB_RGB_COLORS) ;
 }
 
-// This was not finished yet!
-void StretchScreentoWindow(HWND hWnd)
+// Scale the frame to the client area of the window on the CPU, the rows are split across g_pScalePool
+void StretchScreentoWindow(HWND hWnd, HDC hdc, const FrameView& frame)
 {
-	// Get program window DC, this DC is the drawing destination
-	HDC hDC = GetDC(hWnd) ;
+	RECT client ;
+	GetClientRect(hWnd, &client) ;
+	int width = client.right - client.left ;
+	int height = client.bottom - client.top ;
+	if (width <= 0 || height <= 0)
+	{
+		return ;
+	}
+
+	if (g_Preview.Width() != width || g_Preview.Height() != height)
+	{
+		if (!g_Preview.Create(width, height))
+		{
+			return ;
+		}
+	}
+
+	if (!g_Scaler.Setup(frame.width, frame.height, width, height, g_ScaleFilter))
+	{
+		return ;
+	}
+
+	Timer timer ;
+	g_Scaler.Scale(frame, g_Preview.View(), g_pScalePool) ;
+	g_ScaleMs += timer.ElapsedMs() ;
+	++g_ScaleCount ;
+
+	DrawFrame(hdc, g_Preview.View()) ;
+}
+
+// Paint the frame rebuilt by the viewer
+void PaintViewer(HWND hWnd, HDC hdc)
+{
+	EnterCriticalSection(&g_ViewerLock) ;
+
+	FrameView frame = g_Decoder.Frame() ;
+	if (frame.pixels)
+	{
+		if (g_bStretch)
+		{
+			StretchScreentoWindow(hWnd, hdc, frame) ;
+		}
+		else
+		{
+			DrawFrame(hdc, frame) ;
+		}
+	}
+
+	LeaveCriticalSection(&g_ViewerLock) ;
+}
 
+// Grab the left half of the desktop, encode what changed and send it to the viewer
+void CopyScreen(HWND hWnd)
+{
 	// Get the desktop DC, this DC is the drawing content
 	HWND hDesktopHwnd = GetDesktopWindow() ;
 	HDC hDesktopDC = GetDC(hDesktopHwnd);
-	
-	// Create compatible DC for desktop DC
-	HDC hDesktoMemDC = CreateCompatibleDC(hDesktopDC) ;
 
-	// Create compatible bitmap for desktop DC
-	HBITMAP hBitmap = CreateCompatibleBitmap(hDesktopDC, ScreenWidth, ScreenHeight) ;
+	// Copy desktop content to the capture bitmap
+	BitBlt(g_hCaptureDC, 0, 0, g_CaptureFrame.width, g_CaptureFrame.height, hDesktopDC, 0, 0, SRCCOPY); 
+	ReleaseDC(hDesktopHwnd,hDesktopDC);
 
-	// Select into memory DC
-	SelectObject(hDesktoMemDC, hBitmap) ;
+	// Make sure GDI has finished writing the DIB before reading its pixels
+	GdiFlush() ;
 
-	// Stretch desktop content to window
-	BOOL res = StretchBlt(hDC, 0, 0, 400, 400, hDesktoMemDC, 0, 0, ScreenWidth, ScreenHeight, SRCCOPY) ;
-	if (!res)
+	long long captureTime = CaptureTimeNow() ;
+	if (g_Encoder.Encode(g_CaptureFrame, captureTime, g_Packet))
 	{
-		MessageBox(NULL, L"Stretch failed!", L"Error!", 0) ;
+		WritePacket(g_PipeWriter, g_Packet) ;
+		++g_PacketCount ;
+		g_BytesSent += g_Packet.size() ;
 	}
-	//BitBlt(hDC,0,0,ScreenWidth / 2,ScreenHeight,hDesktopDC,0,0,SRCCOPY); 
 
-	ReleaseDC(hDesktopHwnd,hDesktopDC);
-	DeleteDC(hDC);
-	DeleteDC(hDesktoMemDC) ;
-	DeleteObject(hBitmap) ;
+	++g_FrameCount ;
+	g_EncodeMs += g_Encoder.LastStats().diffMs + g_Encoder.LastStats().encodeMs ;
+
+	DWORD now = GetTickCount() ;
+	if (now - g_LastReport >= 1000)
+	{
+		LONG decoded = InterlockedExchange(&g_DecodedCount, 0) ;
+		LONG latencyUs = InterlockedExchange(&g_LatencySumUs, 0) ;
+
+		static const wchar_t* filterNames[SCALE_FILTER_COUNT] = { L"box", L"bilinear", L"lanczos3" } ;
+
+		wchar_t title[256] ;
+		swprintf_s(title, 256, L"Screen share: %d fps, %d packets, %.1f KB/s, encode %.2f ms, latency %.2f ms, scale %s %.2f ms",
+			g_FrameCount, g_PacketCount, g_BytesSent / 1024.0,
+			g_FrameCount ? g_EncodeMs / g_FrameCount : 0.0,
+			decoded ? latencyUs / 1000.0 / decoded : 0.0,
+			g_bStretch ? filterNames[g_ScaleFilter] : L"off",
+			g_ScaleCount ? g_ScaleMs / g_ScaleCount : 0.0) ;
+		SetWindowText(hWnd, title) ;
+
+		g_LastReport = now ;
+		g_FrameCount = g_PacketCount = 0 ;
+		g_BytesSent = 0 ;
+		g_EncodeMs = 0 ;
+		g_ScaleMs = 0 ;
+		g_ScaleCount = 0 ;
+	}
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)   
@@ -61,9 +288,10 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 	switch (message)    
 	{
 	case   WM_PAINT:
-		//hdc = BeginPaint (hwnd, &ps) ;
-		CopyScreen(hwnd) ;
-		//EndPaint (hwnd, &ps) ;
+		// The viewer invalidates the tiles it updated, painting is clipped to them
+		hdc = BeginPaint (hwnd, &ps) ;
+		PaintViewer(hwnd, hdc) ;
+		EndPaint (hwnd, &ps) ;
 		return 0 ;
 
 	case WM_KEYDOWN: 
@@ -73,6 +301,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			case VK_ESCAPE: 
 				SendMessage( hwnd, WM_CLOSE, 0, 0 ); 
 				break ; 
+			case 'S':
+				g_bStretch = !g_bStretch ;
+				InvalidateRect(hwnd, NULL, TRUE) ;
+				break ;
+			case 'F':
+				g_ScaleFilter = (SCALE_FILTER)((g_ScaleFilter + 1) % SCALE_FILTER_COUNT) ;
+				InvalidateRect(hwnd, NULL, FALSE) ;
+				break ;
 			default: 
 				break ; 
 			} 
@@ -80,6 +316,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		break ; 
 
 	case   WM_DESTROY:
+		ReleaseScreenCapture() ;
 		PostQuitMessage (0) ;
 		return 0 ;    
 	}
@@ -115,6 +352,12 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine
 	ScreenWidth = GetSystemMetrics(SM_CXSCREEN);
 	ScreenHeight = GetSystemMetrics(SM_CYSCREEN);
 
+	if (!InitScreenCapture(ScreenWidth / 2, ScreenHeight))
+	{
+		MessageBox ( NULL, L"Create capture bitmap failed!", L"error", MB_ICONERROR) ;
+		return 0 ;
+	}
+
 	HWND   hwnd ; 
 	hwnd = CreateWindowEx(NULL,  
 		L"MY_WINDOWS_CLASS",        // window class name
@@ -129,6 +372,11 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine
 		hInstance,					// program instance handle
 		NULL) ;						// creation parameters
 
+	// Start the viewer
+	g_hViewerWnd = hwnd ;
+	DWORD dwThreadID = 0 ;
+	g_hViewerThread = CreateThread(NULL, 0, Viewer, NULL, 0, &dwThreadID) ;
+
 	ShowWindow (hwnd, iCmdShow) ;
 	UpdateWindow (hwnd) ;
 
@@ -143,10 +391,10 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR szCmdLine
 			TranslateMessage (&msg) ; 
 			DispatchMessage (&msg) ; 
 		} 
-		/*else
+		else
 		{
 			CopyScreen(hwnd) ;
-		}*/
+		}
 	}
 
 	return msg.wParam ;
@@ -1,5 +1,7 @@
 #include "Cube.h"
 
+#include <string.h>
+
 Cube::Cube(void)
 {
 	D3DXMatrixIdentity(&m_matWorld);
@@ -9,9 +11,41 @@ Cube::~Cube(void)
 {
 }
 
-void Cube::LoadMesh(LPDIRECT3DDEVICE9 pDevice, WCHAR* fileName)
+void Cube::LoadMesh(LPDIRECT3DDEVICE9 pDevice, AssetPack& assets, WCHAR* fileName)
 {
-	m_mesh.LoadFromXFile(pDevice, fileName) ;
+	// The .x file comes from the pack, or is mapped on its own when the pack does not have it
+	Asset asset ;
+	if (!assets.Load(fileName, asset))
+	{
+		MessageBox(NULL, L"Load mesh from x file failed!", L"error", 0) ;
+		return ;
+	}
+
+	// Parse it ourselves, through a cache next to the .x such as 0.xmesh, and leave only
+	// the files the parser does not take to D3DX
+	unsigned long long hash = XFileHash(asset.Data(), asset.Size()) ;
+	char cachePath[MAX_PATH] ;
+	bool hasCachePath = WideCharToMultiByte(CP_ACP, 0, fileName, -1, cachePath, MAX_PATH - 4, NULL, NULL) > 0 ;
+	if (hasCachePath)
+	{
+		strcat_s(cachePath, "mesh") ;
+	}
+
+	XMesh mesh ;
+	bool parsed = hasCachePath && ReadXMeshCache(cachePath, hash, mesh) ;
+	if (!parsed && ParseXFile(asset.Data(), asset.Size(), mesh) == XFILE_OK)
+	{
+		parsed = true ;
+		if (hasCachePath)
+		{
+			WriteXMeshCache(cachePath, mesh, hash) ;
+		}
+	}
+
+	if (!parsed || !m_mesh.LoadFromXMesh(pDevice, mesh))
+	{
+		m_mesh.LoadFromXMemory(pDevice, asset.Data(), (DWORD)asset.Size()) ;
+	}
 }
 
 void Cube::Rotate(D3DXMATRIX* rotMatrix)
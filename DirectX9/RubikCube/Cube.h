@@ -2,13 +2,14 @@
 #define __CUBE_H__
 
 #include "Mesh.h"
+#include "AssetPack.h"
 
 class Cube
 {
 public:
 	Cube(void);
 	~Cube(void);
-	void LoadMesh(LPDIRECT3DDEVICE9 pDevice, WCHAR* fileName);
+	void LoadMesh(LPDIRECT3DDEVICE9 pDevice, AssetPack& assets, WCHAR* fileName);
 	void Rotate(D3DXMATRIX* rotMatrix) ;
 	void Draw(LPDIRECT3DDEVICE9 pDevice) ;
 private:
@@ -5,6 +5,7 @@
 #include "Camera.h"
 #include "Cube.h"
 #include "Math.h"
+#include "GameLoop.h"
 
 #pragma warning(disable: 4244)
 
@@ -14,6 +15,8 @@ D3DPRESENT_PARAMETERS d3dpp;					// D3D present parameters
 LPDIRECT3D9			g_pD3D			= NULL ;	// Used to create the D3DDevice
 LPDIRECT3DDEVICE9	g_pd3dDevice	= NULL ;	// Our rendering device
 Camera				g_Camera ;					// Model view camera
+AssetPack			g_Assets ;					// The 27 meshes in one file, see Common/Tools/PackTool
+GameLoop			g_Loop ;					// Paces the frames, fewer while the window is inactive
 
 int OldWindowWidth = 0 ;
 int OldWindowHeight = 0 ;
@@ -24,7 +27,7 @@ int WindowHeight = 800 ;
 WINDOWPLACEMENT wp ;			// window placement, used for full-screen -> window
 
 bool OneRotateFinish = true;	// A rotate action is not allowed if the previous rotation was in process
-bool Inactive = false ;			// window is inactive, if true, stop rendering and yield time 50ms to other app
+bool Inactive = false ;			// window is inactive or minimized, g_Loop draws fewer frames
 bool HitCube = false ;			// true if ray intersection with Rubik cube when left button down
 bool MouseDrag = false ;		// WM-MOUSEMOVE is not processed if mouse was not dragged
 bool AlreadyGetLayer = false ;	// 
@@ -60,6 +63,7 @@ Rect BottomFace(G, H, D, C) ;
 
 const int FaceNum = 6 ;
 Rect Faces[FaceNum] = {FrontFace, BackFace, LeftFace, RightFace, TopFace, BottomFace} ;
+TriangleBatch FaceTriangles ;	// the faces as triangles for picking, the id is the index in Faces
 
 // Random distort Rubik cube
 void Shuffle() ;
@@ -748,24 +752,14 @@ void OnLeftButtonDown(int x, int y)
 	// Calculate the picking ray
 	Ray ray = CalcPickingRay(x, y) ;
 
-	D3DXVECTOR3 currentHitPoint;	// hit point on the face
 	float distance ;		// distance from the origin of the ray and to the hit point
-	float maxDist = 100000.0f ;
+	unsigned int face ;
 
-	// Loop the six faces of the cube and select the one nearest to the camera
-	for(int i = 0; i < FaceNum; i++)
+	// Select the face nearest to the camera, all six are tested together
+	if(ray.Intersection(FaceTriangles, HitPoint, distance, face))
 	{
-		if(ray.Intersection(&Faces[i], &currentHitPoint, &distance))
-		{
-			HitCube = true ;
-
-			if(distance < maxDist)
-			{
-				maxDist = distance ;
-				HitPoint = currentHitPoint ;
-				HitFace = i ;
-			}
-		}
+		HitCube = true ;
+		HitFace = (int)face ;
 	}
 
 	// no action if there is no intersection
@@ -885,6 +879,7 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 			Inactive = false ;
 		if(wParam == WA_INACTIVE)
 			Inactive = true ;
+		g_Loop.SetActive(!Inactive) ;
 		break ;
 
 	case WM_LBUTTONDOWN:
@@ -948,10 +943,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 		{
 			// inactive the app when window is minimized
 			if(SIZE_MINIMIZED == wParam)
+			{
 				Inactive = true ;
+				g_Loop.SetActive(false) ;
+			}
 			else
 			{
 				Inactive = false;
+				g_Loop.SetActive(true) ;
 
 				// Get window width and height after resize
 				int currentWindowWidth = ( short )LOWORD( lParam );
@@ -1185,10 +1184,21 @@ void InitD3D(HWND hWnd)
 	float aspectRatio = (float)d3dpp.BackBufferWidth / (float)d3dpp.BackBufferHeight ;
 	g_Camera.SetProjParams(D3DX_PI / 4, aspectRatio, 1.0f, 1000.0f) ;
 
-	// Load all the meshes from .x files
+	// Load all the meshes from .x files, one file open for all of them when RubikCube.pack exists
+	g_Assets.Open("RubikCube.pack") ;
 	for(int i = 0; i < 27; i++)
 	{
-		Cubes[i].LoadMesh(g_pd3dDevice, xFileName[i]);
+		Cubes[i].LoadMesh(g_pd3dDevice, g_Assets, xFileName[i]);
+	}
+
+	// D3DX copied the meshes, the pack is not needed any more
+	g_Assets.Close() ;
+
+	// Triangles of the six faces for picking
+	FaceTriangles.Clear() ;
+	for(int i = 0; i < FaceNum; i++)
+	{
+		AddRect(FaceTriangles, Faces[i], i) ;
 	}
 }
 
@@ -1245,10 +1255,6 @@ void FrameMove()
 // Render the game
 void Render()
 {
-	// if window is minimized or inactive stop rendering... yields 50ms to other program
-	if(Inactive)
-		Sleep(50) ;
-
 	// Update frame
 	FrameMove() ;
 
@@ -1311,27 +1317,11 @@ void Render()
 	}
 }
 
-// Main message loop
+// Main message loop, renders a frame whenever g_Loop says one is due and sleeps in between.
+// The cube only moves on input, so there is nothing to update at a fixed rate.
 HRESULT MainMessageLoop()
 {
-	MSG    msg ; 
-	ZeroMemory( &msg, sizeof(msg) );
-	PeekMessage( &msg, NULL, 0U, 0U, PM_NOREMOVE );
-
-	while (msg.message != WM_QUIT)  
-	{
-		if( PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE) != 0)
-		{
-			TranslateMessage (&msg) ;
-			DispatchMessage (&msg) ;
-		}
-		else // Render the game if no message to process
-		{
-			Render() ;
-		}
-	}
-
-	return msg.wParam ;
+	return g_Loop.Run([](double) {}, [](double) { Render() ; }) ;
 }
 
 // Main entry point of program
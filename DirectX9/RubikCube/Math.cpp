@@ -1,26 +1,52 @@
 #include "Math.h"
 
 // Determine Whether a ray intersect with a rectangle
-// Divide the rectangle into two triangles and if the ray intersect with any of them
-BOOL Ray::Intersection(Rect *rect, D3DXVECTOR3 *hitPoint, float *dist)
+// The two triangles of the rectangle are tested on its corners, nothing is copied
+BOOL Ray::Intersection(const Rect& rect, D3DXVECTOR3& hitPoint, float& dist) const
 {
-	// Divide the rectangle into two triangles
-	Triangle t1(rect->_v1, rect->_v2, rect->_v3);
-	Triangle t2(rect->_v1, rect->_v3, rect->_v4) ;
-
-	return Intersection(&t1, hitPoint, dist) || Intersection(&t2, hitPoint, dist);
+	Ray3 ray(AsVec3(_origin), AsVec3(_direction)) ;
+	if(RayQuad(ray, AsVec3(rect._v1), AsVec3(rect._v2), AsVec3(rect._v3), AsVec3(rect._v4), dist))
+	{
+		hitPoint = _origin + dist * _direction ;
+		return TRUE ;
+	}
+	else
+		return FALSE ;
 }
 
 // Determine whether the ray intersect with a triangle
-BOOL Ray::Intersection(Triangle *triangle, D3DXVECTOR3 *hitPoint, float *dist)
+BOOL Ray::Intersection(const Triangle& triangle, D3DXVECTOR3& hitPoint, float& dist) const
 {
+	Ray3 ray(AsVec3(_origin), AsVec3(_direction)) ;
 	float u = 0.0f ;
 	float v = 0.0f ;
-	if(D3DXIntersectTri(&triangle->_v1, &triangle->_v2, &triangle->_v3, &_origin, &_direction, &u, &v, dist))
+	if(RayTriangle(ray, AsVec3(triangle._v1), AsVec3(triangle._v2), AsVec3(triangle._v3), dist, u, v))
 	{
-		*hitPoint = u * triangle->_v2 + v * triangle->_v3 + (1 - u - v) * triangle->_v1 ;
+		hitPoint = _origin + dist * _direction ;
 		return TRUE ;
 	}
 	else
 		return FALSE ;
+}
+
+// Determine the nearest triangle the ray intersect with
+BOOL Ray::Intersection(const TriangleBatch& triangles, D3DXVECTOR3& hitPoint, float& dist, unsigned int& id) const
+{
+	RayHit hit ;
+	if(triangles.Intersect(Ray3(AsVec3(_origin), AsVec3(_direction)), hit))
+	{
+		dist = hit.t ;
+		id = hit.id ;
+		hitPoint = _origin + dist * _direction ;
+		return TRUE ;
+	}
+	else
+		return FALSE ;
+}
+
+// The same split as RayQuad
+void AddRect(TriangleBatch& triangles, const Rect& rect, unsigned int id)
+{
+	triangles.Add(AsVec3(rect._v1), AsVec3(rect._v2), AsVec3(rect._v3), id) ;
+	triangles.Add(AsVec3(rect._v1), AsVec3(rect._v3), AsVec3(rect._v4), id) ;
 }
\ No newline at end of file
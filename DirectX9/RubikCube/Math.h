@@ -2,6 +2,7 @@
 #define __MATH_H__
 
 #include <d3dx9.h>
+#include "TriangleBatch.h"
 
 // Triangle
 struct Triangle
@@ -39,12 +40,24 @@ struct Rect
 class Ray
 {
 public:
-	BOOL Intersection(Rect *rect, D3DXVECTOR3 *hitPoint, float *dist) ;
-	BOOL Ray::Intersection(Triangle *triangle, D3DXVECTOR3 *hitPoint, float *dist) ;
+	BOOL Intersection(const Rect& rect, D3DXVECTOR3& hitPoint, float& dist) const ;
+	BOOL Intersection(const Triangle& triangle, D3DXVECTOR3& hitPoint, float& dist) const ;
+
+	// The nearest of the triangles, id is the one the triangle was added with
+	BOOL Intersection(const TriangleBatch& triangles, D3DXVECTOR3& hitPoint, float& dist, unsigned int& id) const ;
 
 public:
 	D3DXVECTOR3 _origin;
 	D3DXVECTOR3 _direction;
 };
 
+// Add the two triangles of the rectangle to the batch
+void AddRect(TriangleBatch& triangles, const Rect& rect, unsigned int id) ;
+
+// D3DXVECTOR3 has the layout of Vec3, the library functions take it without a copy
+inline const Vec3& AsVec3(const D3DXVECTOR3& v)
+{
+	return reinterpret_cast<const Vec3&>(v) ;
+}
+
 #endif //end __MATH_H__
\ No newline at end of file
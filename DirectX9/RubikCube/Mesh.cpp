@@ -31,6 +31,95 @@ void Mesh::LoadFromXFile(LPDIRECT3DDEVICE9 pDevice, LPCTSTR fileName)
 	if(FAILED(hr))
 		MessageBox(NULL, L"Load mesh from x file failed!", L"error", 0) ;
 
+	LoadMaterials() ;
+}
+
+void Mesh::LoadFromXMemory(LPDIRECT3DDEVICE9 pDevice, const void* data, DWORD size)
+{
+	// D3DX parses the buffer the same way as a file, without opening anything
+	HRESULT hr = D3DXLoadMeshFromXInMemory(data, size, D3DXMESH_MANAGED, pDevice, &m_pAdjBuffer, &m_pMtrlBuffer, 0, &m_iNumMtrls, &m_mesh) ;
+
+	if(FAILED(hr))
+	{
+		MessageBox(NULL, L"Load mesh from x file failed!", L"error", 0) ;
+		return ;
+	}
+
+	LoadMaterials() ;
+}
+
+bool Mesh::LoadFromXMesh(LPDIRECT3DDEVICE9 pDevice, const XMesh& mesh)
+{
+	// The vertices already have the D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1 layout
+	bool bigIndices = mesh.vertices.size() > 0xffff ;
+	DWORD options = D3DXMESH_MANAGED | (bigIndices ? D3DXMESH_32BIT : 0) ;
+	DWORD faceCount = (DWORD)mesh.indices.size() / 3 ;
+	HRESULT hr = D3DXCreateMeshFVF(faceCount, (DWORD)mesh.vertices.size(), options, D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1, pDevice, &m_mesh) ;
+	if(FAILED(hr))
+		return false ;
+
+	void* vertices = NULL ;
+	void* indices = NULL ;
+	DWORD* attributes = NULL ;
+	if(FAILED(m_mesh->LockVertexBuffer(0, &vertices)) ||
+	   FAILED(m_mesh->LockIndexBuffer(0, &indices)) ||
+	   FAILED(m_mesh->LockAttributeBuffer(0, &attributes)))
+	{
+		m_mesh->Release() ;
+		m_mesh = NULL ;
+		return false ;
+	}
+
+	memcpy(vertices, &mesh.vertices[0], mesh.vertices.size() * sizeof(XVertex)) ;
+	if (bigIndices)
+	{
+		memcpy(indices, &mesh.indices[0], mesh.indices.size() * sizeof(DWORD)) ;
+	}
+	else
+	{
+		WORD* words = (WORD*)indices ;
+		for (size_t i = 0; i < mesh.indices.size(); ++i)
+			words[i] = (WORD)mesh.indices[i] ;
+	}
+
+	// The triangles are sorted by material, so the attribute table is the subset list
+	vector<D3DXATTRIBUTERANGE> ranges(mesh.subsets.size()) ;
+	for (size_t i = 0; i < mesh.subsets.size(); ++i)
+	{
+		const XSubset& subset = mesh.subsets[i] ;
+		for (DWORD face = subset.firstIndex / 3; face < (subset.firstIndex + subset.indexCount) / 3; ++face)
+			attributes[face] = subset.material ;
+
+		ranges[i].AttribId = subset.material ;
+		ranges[i].FaceStart = subset.firstIndex / 3 ;
+		ranges[i].FaceCount = subset.indexCount / 3 ;
+		ranges[i].VertexStart = subset.firstVertex ;
+		ranges[i].VertexCount = subset.vertexCount ;
+	}
+
+	m_mesh->UnlockAttributeBuffer() ;
+	m_mesh->UnlockIndexBuffer() ;
+	m_mesh->UnlockVertexBuffer() ;
+	m_mesh->SetAttributeTable(&ranges[0], (DWORD)ranges.size()) ;
+
+	m_iNumMtrls = (DWORD)mesh.materials.size() ;
+	for (DWORD i = 0; i < m_iNumMtrls; i++)
+	{
+		const XMaterial& material = mesh.materials[i] ;
+		D3DMATERIAL9 mtrl ;
+		mtrl.Diffuse = D3DXCOLOR(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.diffuse[3]) ;
+		mtrl.Ambient = mtrl.Diffuse ;
+		mtrl.Specular = D3DXCOLOR(material.specular[0], material.specular[1], material.specular[2], 1.0f) ;
+		mtrl.Emissive = D3DXCOLOR(material.emissive[0], material.emissive[1], material.emissive[2], 1.0f) ;
+		mtrl.Power = material.power ;
+		m_vMtrls.push_back(mtrl) ;
+	}
+
+	return true ;
+}
+
+void Mesh::LoadMaterials()
+{
 	// Load materials
 	D3DXMATERIAL* mtrls = (D3DXMATERIAL*)m_pMtrlBuffer->GetBufferPointer();
 	for (DWORD i = 0; i < m_iNumMtrls; i++)
@@ -4,6 +4,8 @@
 #include <vector>
 #include <d3dx9.h>
 
+#include "XFile.h"
+
 using namespace std ;
 
 // this mesh is a wrapper of D3D mesh
@@ -16,9 +18,17 @@ public:
 	// Load mesh from .x file
 	void LoadFromXFile(LPDIRECT3DDEVICE9 pDevice, LPCTSTR fileName);
 
+	// Load mesh from the content of a .x file, e.g. an entry of an asset pack
+	void LoadFromXMemory(LPDIRECT3DDEVICE9 pDevice, const void* data, DWORD size);
+
+	// Load mesh parsed by ParseXFile or read from its cache, one subset per material
+	bool LoadFromXMesh(LPDIRECT3DDEVICE9 pDevice, const XMesh& mesh);
+
 	// draw current mesh
 	void Draw(LPDIRECT3DDEVICE9 pDevice) ; 
 private:
+	void LoadMaterials() ;
+
 	ID3DXMesh*		m_mesh ;
 	ID3DXBuffer*	m_pAdjBuffer  ;
 	ID3DXBuffer*	m_pMtrlBuffer ;
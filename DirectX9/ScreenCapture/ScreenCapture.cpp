@@ -1,22 +1,23 @@
 /*
 
 Capture screen and save to file
-Usage: Press left button to capture, the image file was save under current program folder named "aaa.bmp"
-ScreenShot(g_pd3dDevice, NULL, L"aaa.bmp") ;
+Usage:
+	Drag with the left button to capture that area of the screen, a click captures the full screen
+	S captures the window
+	B captures the next 60 frames, one shot per rendered frame
+	F switches the file format between BMP, PNG and QOI
+Files are saved under the current program folder as Screenshot_0000.png, Screenshot_0001.png...
 
-if you want to capture a window only, pass the window handle to function ScreenShot, like the code below
-ScreenShot(g_pd3dDevice, hWnd, L"aaa.bmp") ;
-
-if you want to capture the full screen, just pass NULL
-ScreenShot(g_pd3dDevice, NULL, L"aaa.bmp") ;
-
-if you want to capture part of the screen, just pass the rect to the last parameter of the function D3DXSaveSurfaceToFile, like below
-D3DXSaveSurfaceToFile(fileName, D3DXIFF_BMP, surf, NULL, &rect);
+ScreenShot copies the front buffer into a staging buffer of g_ScreenshotWriter and returns,
+encoding and writing the file happen on the writer's threads so rendering does not stall.
+When all staging buffers are queued ScreenShot waits for one, a burst never loses a shot.
 
 */
 
 #include <d3dx9.h>
 #include <DxErr.h>
+#include <stdio.h>
+#include "ScreenshotWriter.h"
 
 LPDIRECT3D9             g_pD3D			= NULL ; // Used to create the D3DDevice
 LPDIRECT3DDEVICE9       g_pd3dDevice	= NULL ; // Our rendering device
@@ -28,6 +29,15 @@ int top = 0 ;
 int bottom = 0 ;
 RECT rect ;
 
+// Screenshots
+ScreenshotWriter		g_ScreenshotWriter ;
+LPDIRECT3DSURFACE9		g_pCaptureSurface = NULL ;	// system memory copy of the front buffer, reused for every shot
+UINT					g_CaptureWidth = 0 ;
+UINT					g_CaptureHeight = 0 ;
+IMAGE_FORMAT			g_ShotFormat = IMAGE_PNG ;
+int						g_ShotIndex = 0 ;
+int						g_BurstRemaining = 0 ;		// shots left in the current burst
+
 HRESULT InitD3D( HWND hWnd )
 {
 	// Create the D3D object, which is needed to create the D3DDevice.
@@ -62,11 +72,23 @@ HRESULT InitD3D( HWND hWnd )
 
 	D3DXCreateTeapot(g_pd3dDevice, &g_pTeapotMesh, NULL) ;
 
+	// 8 staging buffers, 2 threads encoding
+	g_ScreenshotWriter.Start(8, 2) ;
+
 	return S_OK;
 }
 
 VOID Cleanup()
 {
+	// Write the shots still queued
+	g_ScreenshotWriter.Stop() ;
+
+	if (g_pCaptureSurface != NULL)
+	{
+		g_pCaptureSurface->Release() ;
+		g_pCaptureSurface = NULL ;
+	}
+
 	if( g_pd3dDevice != NULL) 
 		g_pd3dDevice->Release() ;
 
@@ -119,7 +141,10 @@ VOID Render()
 	g_pd3dDevice->Present( NULL, NULL, NULL, NULL );
 }
 
-BOOL ScreenShot(LPDIRECT3DDEVICE9 lpDevice, HWND hWnd, TCHAR* fileName)
+
+// Capture the screen, the window hWnd or the screen area pArea (screen coordinates), whichever
+// is given first, and queue it to be saved as fileName
+HRESULT ScreenShot(LPDIRECT3DDEVICE9 lpDevice, HWND hWnd, const RECT* pArea, const char* fileName, IMAGE_FORMAT format)
 {
 	HRESULT hr;
 	
@@ -128,39 +153,115 @@ BOOL ScreenShot(LPDIRECT3DDEVICE9 lpDevice, HWND hWnd, TCHAR* fileName)
 	if (FAILED(hr = lpDevice->GetDisplayMode(0, &mode)))
 		return hr;
 
-	// Create the surface to hold the screen image data
-	LPDIRECT3DSURFACE9 surf;
-	if (FAILED(hr = lpDevice->CreateOffscreenPlainSurface(mode.Width, 
-		mode.Height, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &surf, NULL))) //עĸD3DPOOL_DEFAULT
+	// Create the surface to hold the screen image data, only when the display mode changed
+	if (g_pCaptureSurface == NULL || g_CaptureWidth != mode.Width || g_CaptureHeight != mode.Height)
 	{
-		return hr;
+		if (g_pCaptureSurface != NULL)
+		{
+			g_pCaptureSurface->Release() ;
+			g_pCaptureSurface = NULL ;
+		}
+
+		if (FAILED(hr = lpDevice->CreateOffscreenPlainSurface(mode.Width, 
+			mode.Height, D3DFMT_A8R8G8B8, D3DPOOL_SYSTEMMEM, &g_pCaptureSurface, NULL)))
+		{
+			return hr;
+		}
+
+		g_CaptureWidth = mode.Width ;
+		g_CaptureHeight = mode.Height ;
 	}
 
 	// Get the screen data
-	if (FAILED(hr = lpDevice->GetFrontBufferData(0, surf))) 
+	if (FAILED(hr = lpDevice->GetFrontBufferData(0, g_pCaptureSurface))) 
 	{
-		surf->Release() ;
 		return hr ;
 	}
 
 	// area to capture
-	RECT *rect = NULL ;
-
-	WINDOWINFO windowInfo ;
-	windowInfo.cbSize = sizeof(WINDOWINFO) ;
+	RECT area = { 0, 0, (LONG)mode.Width, (LONG)mode.Height } ;
 
 	if(hWnd) // capture window
 	{
+		WINDOWINFO windowInfo ;
+		windowInfo.cbSize = sizeof(WINDOWINFO) ;
 		GetWindowInfo(hWnd, &windowInfo) ;
-		rect = &windowInfo.rcWindow ;
+		IntersectRect(&area, &area, &windowInfo.rcWindow) ;
+	}
+	else if (pArea) // capture part of the screen
+	{
+		IntersectRect(&area, &area, pArea) ;
+	}
+
+	if (IsRectEmpty(&area))
+	{
+		return E_INVALIDARG ;
+	}
+
+	int width = area.right - area.left ;
+	int height = area.bottom - area.top ;
+
+	// Wait for a free staging buffer if the encoder is behind
+	FrameBuffer* pBuffer = g_ScreenshotWriter.Acquire(width, height) ;
+	if (pBuffer == NULL)
+	{
+		return E_FAIL ;
 	}
 
-	// Save the screen date to file
-	hr = D3DXSaveSurfaceToFile(fileName, D3DXIFF_BMP, surf, NULL, rect);
+	D3DLOCKED_RECT lockedRect ;
+	if (FAILED(hr = g_pCaptureSurface->LockRect(&lockedRect, &area, D3DLOCK_READONLY)))
+	{
+		g_ScreenshotWriter.Cancel(pBuffer) ;
+		return hr ;
+	}
+
+	// A8R8G8B8 is B, G, R, A in memory, the layout the writer expects
+	FrameView source((unsigned char*)lockedRect.pBits, width, height, lockedRect.Pitch) ;
+	CopyFrameRect(pBuffer->View(), 0, 0, source, 0, 0, width, height) ;
+	g_pCaptureSurface->UnlockRect() ;
 
-	surf->Release() ;
+	// Encoding and saving happen on the writer's threads
+	g_ScreenshotWriter.Submit(pBuffer, fileName, format) ;
+
+	return S_OK ;
+}
+
+// Show the format and the writer's counters in the window title
+void UpdateTitle(HWND hWnd)
+{
+	ScreenshotStats stats = g_ScreenshotWriter.Stats() ;
+
+	char title[256] ;
+	sprintf_s(title, 256, "Screen capture: %s, %d written, %d pending, %d stalls, %.1f ms encode",
+		ImageFormatExtension(g_ShotFormat), stats.written, stats.pending, stats.stalls,
+		stats.written ? stats.encodeMs / stats.written : 0.0) ;
+	SetWindowTextA(hWnd, title) ;
+}
+
+// Take a numbered screenshot in the current format
+void TakeScreenShot(HWND hWnd, HWND hCaptureWnd, const RECT* pArea)
+{
+	char fileName[MAX_PATH] ;
+	sprintf_s(fileName, MAX_PATH, "Screenshot_%04d.%s", g_ShotIndex++, ImageFormatExtension(g_ShotFormat)) ;
+
+	if (FAILED(ScreenShot(g_pd3dDevice, hCaptureWnd, pArea, fileName, g_ShotFormat)))
+	{
+		OutputDebugStringA("Screenshot failed\n") ;
+	}
 
-	return hr ;
+	UpdateTitle(hWnd) ;
+}
+
+// Render one frame and capture it if a burst is running
+VOID RenderFrame(HWND hWnd)
+{
+	Render() ;
+
+	if (g_BurstRemaining > 0)
+	{
+		--g_BurstRemaining ;
+		TakeScreenShot(hWnd, hWnd, NULL) ;
+	}
 }
 
 BOOL ScreenShot1(LPDIRECT3DDEVICE9 lpDevice, HWND hWnd, TCHAR* fileName)
@@ -264,7 +365,16 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 				break ;
 
 			case 'S':
-				//ScreenShot(g_pd3dDevice, hWnd, L"Screenshot.bmp");
+				TakeScreenShot(hWnd, hWnd, NULL) ;
+				break ;
+
+			case 'B':
+				g_BurstRemaining = 60 ;
+				break ;
+
+			case 'F':
+				g_ShotFormat = (IMAGE_FORMAT)((g_ShotFormat + 1) % IMAGE_FORMAT_COUNT) ;
+				UpdateTitle(hWnd) ;
 				break ;
 
 			default:
@@ -287,8 +397,18 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 		rect.bottom = max(top, bottom) ;
 		// ýͼ
 
-		//rect = {left, right, top, bottom} ;
-		ScreenShot(g_pd3dDevice, NULL, L"aaa.jpg") ;
+		if (IsRectEmpty(&rect)) // a click, capture the full screen
+		{
+			TakeScreenShot(hWnd, NULL, NULL) ;
+		}
+		else
+		{
+			// The front buffer holds the whole desktop, convert the area to screen coordinates
+			RECT area = rect ;
+			ClientToScreen(hWnd, (POINT*)&area.left) ;
+			ClientToScreen(hWnd, (POINT*)&area.right) ;
+			TakeScreenShot(hWnd, NULL, &area) ;
+		}
 		break ;
 
 	case WM_DESTROY:
@@ -335,7 +455,7 @@ INT WINAPI wWinMain( HINSTANCE hInst, HINSTANCE, LPWSTR, INT )
 			}
 			else // Render the game if no message to process
 			{
-				Render() ;
+				RenderFrame(hWnd) ;
 			}
 		}
 	}
@@ -4,93 +4,57 @@ Do you know the history of it?
 Please see this wiki page http://www.sjbaker.org/wiki/index.php?title=The_History_of_The_Teapot
 
 This demo show you how to draw a teapot manually, without using any sdk functions.
-The index and vertex data are all from the wiki page above.
+The control points are from the wiki page above. The 32 Bezier patches are tessellated
+on the CPU by Common/Math/Teapot.cpp, with the level picked so the triangles stay
+within half a pixel of the surface at the distance of the camera, and lit with the
+exact normals of the surface.
 
+Press + and - to double or halve the level, W to switch between solid and wire frame.
 */
 #include <d3dx9.h>
 #include <MMSystem.h>
+#include <algorithm>
+#include <vector>
+#include "Teapot.h"
+#include "ThreadPool.h"
 
 LPDIRECT3D9             g_pD3D				= NULL ; // Used to create the D3DDevice
 LPDIRECT3DDEVICE9       g_pd3dDevice		= NULL ; // Our rendering device
 IDirect3DVertexBuffer9*	g_pVB				= NULL ; // vertex buffer pointer
 IDirect3DIndexBuffer9*	g_pIB				= NULL ; // index buffer pointer
+ThreadPool*				g_pPool				= NULL ; // tessellates the patches in parallel
+
+int						g_Level				= 0 ;	 // cells along each side of a patch
+UINT					g_VertexCount		= 0 ;
+UINT					g_TriangleCount		= 0 ;
+bool					g_bWireframe		= false ;
 
 bool					g_bActive			= true ; // Is window active?
 
 #define SAFE_RELEASE(P) if(P){ P->Release(); P = NULL;}
-#define VERTEX_FVF D3DFVF_XYZ // vertex format
+#define VERTEX_FVF (D3DFVF_XYZ | D3DFVF_NORMAL) // vertex format, a TeapotVertex
 
-HRESULT InitVB()
+// Tessellate the teapot at the given level and replace the vertex and index buffers,
+// the old buffers stay in use if the new ones cannot be made
+HRESULT InitBuffers(int level)
 {
-	D3DXVECTOR3 vertex [] = {
-		D3DXVECTOR3(  0.2000,  0.0000, 2.70000 ), D3DXVECTOR3(  0.2000, -0.1120, 2.70000 ),
-		D3DXVECTOR3(  0.1120, -0.2000, 2.70000 ), D3DXVECTOR3(  0.0000, -0.2000, 2.70000 ),
-		D3DXVECTOR3(  1.3375,  0.0000, 2.53125 ), D3DXVECTOR3(  1.3375, -0.7490, 2.53125 ),
-		D3DXVECTOR3(  0.7490, -1.3375, 2.53125 ), D3DXVECTOR3(  0.0000, -1.3375, 2.53125 ),
-		D3DXVECTOR3(  1.4375,  0.0000, 2.53125 ), D3DXVECTOR3(  1.4375, -0.8050, 2.53125 ),
-		D3DXVECTOR3(  0.8050, -1.4375, 2.53125 ), D3DXVECTOR3(  0.0000, -1.4375, 2.53125 ),
-		D3DXVECTOR3(  1.5000,  0.0000, 2.40000 ), D3DXVECTOR3(  1.5000, -0.8400, 2.40000 ),
-		D3DXVECTOR3(  0.8400, -1.5000, 2.40000 ), D3DXVECTOR3(  0.0000, -1.5000, 2.40000 ),
-		D3DXVECTOR3(  1.7500,  0.0000, 1.87500 ), D3DXVECTOR3(  1.7500, -0.9800, 1.87500 ),
-		D3DXVECTOR3(  0.9800, -1.7500, 1.87500 ), D3DXVECTOR3(  0.0000, -1.7500, 1.87500 ),
-		D3DXVECTOR3(  2.0000,  0.0000, 1.35000 ), D3DXVECTOR3(  2.0000, -1.1200, 1.35000 ),
-		D3DXVECTOR3(  1.1200, -2.0000, 1.35000 ), D3DXVECTOR3(  0.0000, -2.0000, 1.35000 ),
-		D3DXVECTOR3(  2.0000,  0.0000, 0.90000 ), D3DXVECTOR3(  2.0000, -1.1200, 0.90000 ),
-		D3DXVECTOR3(  1.1200, -2.0000, 0.90000 ), D3DXVECTOR3(  0.0000, -2.0000, 0.90000 ),
-		D3DXVECTOR3( -2.0000,  0.0000, 0.90000 ), D3DXVECTOR3(  2.0000,  0.0000, 0.45000 ),
-		D3DXVECTOR3(  2.0000, -1.1200, 0.45000 ), D3DXVECTOR3(  1.1200, -2.0000, 0.45000 ),
-		D3DXVECTOR3(  0.0000, -2.0000, 0.45000 ), D3DXVECTOR3(  1.5000,  0.0000, 0.22500 ),
-		D3DXVECTOR3(  1.5000, -0.8400, 0.22500 ), D3DXVECTOR3(  0.8400, -1.5000, 0.22500 ),
-		D3DXVECTOR3(  0.0000, -1.5000, 0.22500 ), D3DXVECTOR3(  1.5000,  0.0000, 0.15000 ),
-		D3DXVECTOR3(  1.5000, -0.8400, 0.15000 ), D3DXVECTOR3(  0.8400, -1.5000, 0.15000 ),
-		D3DXVECTOR3(  0.0000, -1.5000, 0.15000 ), D3DXVECTOR3( -1.6000,  0.0000, 2.02500 ),
-		D3DXVECTOR3( -1.6000, -0.3000, 2.02500 ), D3DXVECTOR3( -1.5000, -0.3000, 2.25000 ),
-		D3DXVECTOR3( -1.5000,  0.0000, 2.25000 ), D3DXVECTOR3( -2.3000,  0.0000, 2.02500 ),
-		D3DXVECTOR3( -2.3000, -0.3000, 2.02500 ), D3DXVECTOR3( -2.5000, -0.3000, 2.25000 ),
-		D3DXVECTOR3( -2.5000,  0.0000, 2.25000 ), D3DXVECTOR3( -2.7000,  0.0000, 2.02500 ),
-		D3DXVECTOR3( -2.7000, -0.3000, 2.02500 ), D3DXVECTOR3( -3.0000, -0.3000, 2.25000 ),
-		D3DXVECTOR3( -3.0000,  0.0000, 2.25000 ), D3DXVECTOR3( -2.7000,  0.0000, 1.80000 ),
-		D3DXVECTOR3( -2.7000, -0.3000, 1.80000 ), D3DXVECTOR3( -3.0000, -0.3000, 1.80000 ),
-		D3DXVECTOR3( -3.0000,  0.0000, 1.80000 ), D3DXVECTOR3( -2.7000,  0.0000, 1.57500 ),
-		D3DXVECTOR3( -2.7000, -0.3000, 1.57500 ), D3DXVECTOR3( -3.0000, -0.3000, 1.35000 ),
-		D3DXVECTOR3( -3.0000,  0.0000, 1.35000 ), D3DXVECTOR3( -2.5000,  0.0000, 1.12500 ),
-		D3DXVECTOR3( -2.5000, -0.3000, 1.12500 ), D3DXVECTOR3( -2.6500, -0.3000, 0.93750 ),
-		D3DXVECTOR3( -2.6500,  0.0000, 0.93750 ), D3DXVECTOR3( -2.0000, -0.3000, 0.90000 ),
-		D3DXVECTOR3( -1.9000, -0.3000, 0.60000 ), D3DXVECTOR3( -1.9000,  0.0000, 0.60000 ),
-		D3DXVECTOR3(  1.7000,  0.0000, 1.42500 ), D3DXVECTOR3(  1.7000, -0.6600, 1.42500 ),
-		D3DXVECTOR3(  1.7000, -0.6600, 0.60000 ), D3DXVECTOR3(  1.7000,  0.0000, 0.60000 ),
-		D3DXVECTOR3(  2.6000,  0.0000, 1.42500 ), D3DXVECTOR3(  2.6000, -0.6600, 1.42500 ),
-		D3DXVECTOR3(  3.1000, -0.6600, 0.82500 ), D3DXVECTOR3(  3.1000,  0.0000, 0.82500 ),
-		D3DXVECTOR3(  2.3000,  0.0000, 2.10000 ), D3DXVECTOR3(  2.3000, -0.2500, 2.10000 ),
-		D3DXVECTOR3(  2.4000, -0.2500, 2.02500 ), D3DXVECTOR3(  2.4000,  0.0000, 2.02500 ),
-		D3DXVECTOR3(  2.7000,  0.0000, 2.40000 ), D3DXVECTOR3(  2.7000, -0.2500, 2.40000 ),
-		D3DXVECTOR3(  3.3000, -0.2500, 2.40000 ), D3DXVECTOR3(  3.3000,  0.0000, 2.40000 ),
-		D3DXVECTOR3(  2.8000,  0.0000, 2.47500 ), D3DXVECTOR3(  2.8000, -0.2500, 2.47500 ),
-		D3DXVECTOR3(  3.5250, -0.2500, 2.49375 ), D3DXVECTOR3(  3.5250,  0.0000, 2.49375 ),
-		D3DXVECTOR3(  2.9000,  0.0000, 2.47500 ), D3DXVECTOR3(  2.9000, -0.1500, 2.47500 ),
-		D3DXVECTOR3(  3.4500, -0.1500, 2.51250 ), D3DXVECTOR3(  3.4500,  0.0000, 2.51250 ),
-		D3DXVECTOR3(  2.8000,  0.0000, 2.40000 ), D3DXVECTOR3(  2.8000, -0.1500, 2.40000 ),
-		D3DXVECTOR3(  3.2000, -0.1500, 2.40000 ), D3DXVECTOR3(  3.2000,  0.0000, 2.40000 ),
-		D3DXVECTOR3(  0.0000,  0.0000, 3.15000 ), D3DXVECTOR3(  0.8000,  0.0000, 3.15000 ),
-		D3DXVECTOR3(  0.8000, -0.4500, 3.15000 ), D3DXVECTOR3(  0.4500, -0.8000, 3.15000 ),
-		D3DXVECTOR3(  0.0000, -0.8000, 3.15000 ), D3DXVECTOR3(  0.0000,  0.0000, 2.85000 ),
-		D3DXVECTOR3(  1.4000,  0.0000, 2.40000 ), D3DXVECTOR3(  1.4000, -0.7840, 2.40000 ),
-		D3DXVECTOR3(  0.7840, -1.4000, 2.40000 ), D3DXVECTOR3(  0.0000, -1.4000, 2.40000 ),
-		D3DXVECTOR3(  0.4000,  0.0000, 2.55000 ), D3DXVECTOR3(  0.4000, -0.2240, 2.55000 ),
-		D3DXVECTOR3(  0.2240, -0.4000, 2.55000 ), D3DXVECTOR3(  0.0000, -0.4000, 2.55000 ),
-		D3DXVECTOR3(  1.3000,  0.0000, 2.55000 ), D3DXVECTOR3(  1.3000, -0.7280, 2.55000 ),
-		D3DXVECTOR3(  0.7280, -1.3000, 2.55000 ), D3DXVECTOR3(  0.0000, -1.3000, 2.55000 ),
-		D3DXVECTOR3(  1.3000,  0.0000, 2.40000 ), D3DXVECTOR3(  1.3000, -0.7280, 2.40000 ),
-		D3DXVECTOR3(  0.7280, -1.3000, 2.40000 ), D3DXVECTOR3(  0.0000, -1.3000, 2.40000 ),
-	} ;
+	// Parenthesized, windows.h defines min and max as macros
+	level = (std::max)(1, (std::min)(level, BEZIER_MAX_LEVEL)) ;
+
+	std::vector<TeapotVertex> vertices ;
+	std::vector<unsigned int> indices ;
+	TessellateTeapot(level, vertices, indices, g_pPool) ;
+
+	IDirect3DVertexBuffer9* pVB = NULL ;
+	IDirect3DIndexBuffer9* pIB = NULL ;
 
 	// Create vertex buffer
 	HRESULT hr = g_pd3dDevice->CreateVertexBuffer(
-	sizeof(vertex),
+	vertices.size() * sizeof(TeapotVertex),
 	D3DUSAGE_WRITEONLY,
 	VERTEX_FVF,
 	D3DPOOL_MANAGED,
-	&g_pVB,
+	&pVB,
 	NULL);
 	if (FAILED(hr))
 	{
@@ -99,65 +63,69 @@ HRESULT InitVB()
 
 	// Lock vertex buffer and copy data
 	void* pVertices = NULL;
-	g_pVB->Lock(0, 0, &pVertices, 0);
-	memcpy(pVertices, vertex, sizeof(vertex));
-	g_pVB->Unlock();
-}
-
-HRESULT InitIB()
-{
-	DWORD index[] = {
-		// Rim:
-		  102, 103, 104, 105,   4,   5,   6,   7,
-		    8,   9,  10,  11,  12,  13,  14,  15,
-
-		// Body:
-		   12,  13,  14,  15,  16,  17,  18,  19,
-		   20,  21,  22,  23,  24,  25,  26,  27,
-		   24,  25,  26,  27,  29,  30,  31,  32,
-		   33,  34,  35,  36,  37,  38,  39,  40,
-
-		// Lid:
-		   96,  96,  96,  96,  97,  98,  99, 100,
-		  101, 101, 101, 101,   0,   1,   2,   3,
-		    0,   1,   2,   3, 106, 107, 108, 109,
-		  110, 111, 112, 113, 114, 115, 116, 117,
-
-		// Handle:
-		   41,  42,  43,  44,  45,  46,  47,  48,
-		   49,  50,  51,  52,  53,  54,  55,  56,
-		   53,  54,  55,  56,  57,  58,  59,  60,
-		   61,  62,  63,  64,  28,  65,  66,  67,
-
-		// Spout:
-		   68,  69,  70,  71,  72,  73,  74,  75,
-		   76,  77,  78,  79,  80,  81,  82,  83,
-		   80,  81,  82,  83,  84,  85,  86,  87,
-		   88,  89,  90,  91,  92,  93,  94,  95 
-	} ;
+	hr = pVB->Lock(0, 0, &pVertices, 0);
+	if (FAILED(hr))
+	{
+		SAFE_RELEASE(pVB);
+		return E_FAIL;
+	}
+	memcpy(pVertices, &vertices[0], vertices.size() * sizeof(TeapotVertex));
+	pVB->Unlock();
 
 	// Create index buffer
-	HRESULT hr = g_pd3dDevice->CreateIndexBuffer(
-		sizeof(index),
+	hr = g_pd3dDevice->CreateIndexBuffer(
+		indices.size() * sizeof(DWORD),
 		D3DUSAGE_WRITEONLY,
 		D3DFMT_INDEX32,
 		D3DPOOL_MANAGED,
-		&g_pIB,
+		&pIB,
 		0);
 	if (FAILED(hr))
 	{
+		SAFE_RELEASE(pVB);
 		return E_FAIL;
 	}
 
 	// Lock index buffer and copy data
 	DWORD* pIndices = NULL;
-	hr = g_pIB->Lock(0, 0, (void**)&pIndices, 0);
+	hr = pIB->Lock(0, 0, (void**)&pIndices, 0);
 	if (FAILED(hr))
 	{
+		SAFE_RELEASE(pIB);
+		SAFE_RELEASE(pVB);
 		return E_FAIL;
 	}
-	memcpy(pIndices, index, sizeof(index));
-	g_pIB->Unlock();
+	memcpy(pIndices, &indices[0], indices.size() * sizeof(DWORD));
+	pIB->Unlock();
+
+	// Both buffers are filled, swap them in
+	SAFE_RELEASE(g_pVB);
+	SAFE_RELEASE(g_pIB);
+	g_pVB = pVB ;
+	g_pIB = pIB ;
+
+	g_Level = level ;
+	g_VertexCount = (UINT)vertices.size() ;
+	g_TriangleCount = (UINT)indices.size() / 3 ;
+	return S_OK;
+}
+
+void SetupLight()
+{
+	D3DLIGHT9 light ;
+	ZeroMemory(&light, sizeof(light)) ;
+	light.Type = D3DLIGHT_DIRECTIONAL ;
+	light.Diffuse = D3DXCOLOR(1.0f, 1.0f, 1.0f, 1.0f) ;
+	light.Direction = D3DXVECTOR3(1.0f, -1.0f, 1.0f) ;
+	g_pd3dDevice->SetLight(0, &light) ;
+	g_pd3dDevice->LightEnable(0, TRUE) ;
+
+	D3DMATERIAL9 material ;
+	ZeroMemory(&material, sizeof(material)) ;
+	material.Diffuse = D3DXCOLOR(0.9f, 0.9f, 0.9f, 1.0f) ;
+	material.Ambient = D3DXCOLOR(0.9f, 0.9f, 0.9f, 1.0f) ;
+	g_pd3dDevice->SetMaterial(&material) ;
+	g_pd3dDevice->SetRenderState(D3DRS_AMBIENT, D3DCOLOR_XRGB(40, 40, 40)) ;
 }
 
 HRESULT InitD3D( HWND hWnd )
@@ -175,6 +143,8 @@ HRESULT InitD3D( HWND hWnd )
 	d3dpp.Windowed = TRUE; // use window mode, not full screen
 	d3dpp.SwapEffect = D3DSWAPEFFECT_DISCARD;
 	d3dpp.BackBufferFormat = D3DFMT_UNKNOWN;
+	d3dpp.EnableAutoDepthStencil = TRUE;
+	d3dpp.AutoDepthStencilFormat = D3DFMT_D16;
 
 	// Create device
 	if( FAILED( g_pD3D->CreateDevice( D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, hWnd,
@@ -185,17 +155,18 @@ HRESULT InitD3D( HWND hWnd )
 		return E_FAIL;
 	}
 
-	// Disable lighting, since we didn't specify color for vertex
-	g_pd3dDevice->SetRenderState( D3DRS_LIGHTING , FALSE );   
-
-	// Wire frame mode
-	g_pd3dDevice->SetRenderState(D3DRS_FILLMODE, D3DFILL_WIREFRAME);
+	// Light the teapot with the normals of the patches
+	SetupLight() ;
 
-	// Inti vertex buffer
-	InitVB();
+	g_pPool = new ThreadPool() ;
 
-	// Init index buffer
-	InitIB();
+	// Half a pixel of the 600 pixels high window, at the distance of the camera
+	int level = TeapotLevel(ScreenTolerance(0.5f, 10.0f, D3DX_PI / 4, 600)) ;
+	if (FAILED(InitBuffers(level)))
+	{
+		MessageBoxA(NULL, "Create vertex and index buffer failed!", "Error", 0) ;
+		return E_FAIL;
+	}
 
 	return S_OK;
 }
@@ -205,14 +176,18 @@ VOID Cleanup()
 	SAFE_RELEASE(g_pVB);
 	SAFE_RELEASE(g_pIB);
 	SAFE_RELEASE(g_pd3dDevice) ;
+	delete g_pPool ;
+	g_pPool = NULL ;
 	SAFE_RELEASE(g_pD3D) ;
 }
 
 void SetupMatrix()
 {
-	// translate model to origin
-	D3DXMATRIX world ;
-	D3DXMatrixTranslation(&world, 0.0f, 0.0f, 0.0f) ;
+	// stand the teapot up, its z axis is up, and move its middle to the origin
+	D3DXMATRIX rotation, translation ;
+	D3DXMatrixRotationX(&rotation, -D3DX_PI / 2) ;
+	D3DXMatrixTranslation(&translation, 0.0f, -1.575f, 0.0f) ;
+	D3DXMATRIX world = rotation * translation ;
 	g_pd3dDevice->SetTransform(D3DTS_WORLD, &world) ;
 
 	// set view
@@ -240,15 +215,16 @@ void Render(float timeDelta)
 	SetupMatrix() ;
 
 	// Clear the back-buffer to a RED color
-	g_pd3dDevice->Clear( 0, NULL, D3DCLEAR_TARGET, D3DCOLOR_XRGB(0,0,0), 1.0f, 0 );
+	g_pd3dDevice->Clear( 0, NULL, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER, D3DCOLOR_XRGB(0,0,0), 1.0f, 0 );
 
 	// Begin the scene
 	if( SUCCEEDED( g_pd3dDevice->BeginScene() ) )
 	{
-		g_pd3dDevice->SetStreamSource(0, g_pVB, 0, sizeof(D3DXVECTOR3));
+		g_pd3dDevice->SetRenderState(D3DRS_FILLMODE, g_bWireframe ? D3DFILL_WIREFRAME : D3DFILL_SOLID);
+		g_pd3dDevice->SetStreamSource(0, g_pVB, 0, sizeof(TeapotVertex));
 		g_pd3dDevice->SetIndices(g_pIB);
 		g_pd3dDevice->SetFVF(VERTEX_FVF);
-		g_pd3dDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, 118, 0, 48);
+		g_pd3dDevice->DrawIndexedPrimitive(D3DPT_TRIANGLELIST, 0, 0, g_VertexCount, 0, g_TriangleCount);
 		// End the scene
 		g_pd3dDevice->EndScene();
 	}
@@ -268,6 +244,19 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
 			case VK_ESCAPE:
 				SendMessage( hWnd, WM_CLOSE, 0, 0 );
 				break ;
+			case VK_ADD:
+			case VK_OEM_PLUS:
+				if (g_Level < BEZIER_MAX_LEVEL)
+					InitBuffers(g_Level * 2) ;
+				break ;
+			case VK_SUBTRACT:
+			case VK_OEM_MINUS:
+				if (g_Level > 1)
+					InitBuffers(g_Level / 2) ;
+				break ;
+			case 'W':
+				g_bWireframe = !g_bWireframe ;
+				break ;
 			default:
 				break ;
 			}
@@ -1,131 +1,33 @@
 #include <C:\Program Files\Microsoft DirectX SDK (June 2010)\Include\XAudio2.h>
 #include <Windows.h>
 #include <iostream>
+#include <conio.h>
+#include "WaveFile.h"
+#include "AudioStream.h"
+#include "XAudio2Stream.h"
 
-// Little-Endian for Windows, XBOX use big-endian
-#define fourccRIFF 'FFIR'
-#define fourccDATA 'atad'
-#define fourccFMT ' tmf'
-#define fourccWAVE 'EVAW'
-#define fourccXWMA 'AMWX'
-#define fourccDPDS 'sdpd'
+// Streaming reads the file in pieces of this size, only this many are in memory at once
+const int STREAM_BUFFER_COUNT = 4;
+const int STREAM_BUFFER_BYTES = 64 * 1024;
 
-HRESULT FindChunk(HANDLE hFile, DWORD fourcc, DWORD& dwChunkSize, DWORD& dwChunkDataPosition)
+void PlayAudioFile(const WaveFile& wave)
 {
-    HRESULT hr = S_OK;
-    if( INVALID_SET_FILE_POINTER == SetFilePointer( hFile, 0, NULL, FILE_BEGIN ) )
-        return HRESULT_FROM_WIN32( GetLastError() );
-
-    DWORD dwChunkType;
-    DWORD dwChunkDataSize;
-    DWORD dwRIFFDataSize = 0;
-    DWORD dwFileType;
-    DWORD bytesRead = 0;
-    DWORD dwOffset = 0;
-
-    while (hr == S_OK)
-    {
-        DWORD dwRead;
-
-		// Get chunk type
-        if( 0 == ReadFile( hFile, &dwChunkType, sizeof(DWORD), &dwRead, NULL ) )
-            hr = HRESULT_FROM_WIN32( GetLastError() );
-
-		// Get chunk data type
-        if( 0 == ReadFile( hFile, &dwChunkDataSize, sizeof(DWORD), &dwRead, NULL ) )
-            hr = HRESULT_FROM_WIN32( GetLastError() );
-
-        switch (dwChunkType)
-        {
-        case fourccRIFF:
-            dwRIFFDataSize = dwChunkDataSize;
-            dwChunkDataSize = 4;
-            if( 0 == ReadFile( hFile, &dwFileType, sizeof(DWORD), &dwRead, NULL ) )
-                hr = HRESULT_FROM_WIN32( GetLastError() );
-            break;
-
-        default:
-            if( INVALID_SET_FILE_POINTER == SetFilePointer( hFile, dwChunkDataSize, NULL, FILE_CURRENT ) )
-            return HRESULT_FROM_WIN32( GetLastError() );            
-        }
-
-        dwOffset += sizeof(DWORD) * 2;
-        
-        if (dwChunkType == fourcc)
-        {
-            dwChunkSize = dwChunkDataSize;
-            dwChunkDataPosition = dwOffset;
-            return S_OK;
-        }
-
-        dwOffset += dwChunkDataSize;
-        
-        if (bytesRead >= dwRIFFDataSize) return S_FALSE;
-
-    }
-
-    return S_OK;
-}
-
-void ReadChunkData(HANDLE hFile, void * buffer, DWORD buffersize, DWORD bufferoffset)
-{
-    HRESULT hr = S_OK;
-    hr = SetFilePointer( hFile, bufferoffset, NULL, FILE_BEGIN );
-	if(FAILED(hr))
-	{
-		MessageBox(NULL, "Failed to set file pointer", "Error", 0);
-	}
-
-    DWORD dwRead;
-    hr = ReadFile( hFile, buffer, buffersize, &dwRead, NULL );
-	if(FAILED(hr))
-	{
-		MessageBox(NULL, "Failed to read file", "Error", 0);
-	}
-}
-
-void PlayAudioFile(char* audioFile)
-{
-	// Open the file
-	HANDLE hFile = CreateFile(
-		audioFile,
-		GENERIC_READ,
-		FILE_SHARE_READ,
-		NULL,
-		OPEN_EXISTING,
-		0,
-		NULL );
-
-
-	// Set file pointer to the begining of file
-	SetFilePointer( hFile, 0, NULL, FILE_BEGIN );
-
-	DWORD dwChunkSize;
-	DWORD dwChunkPosition;
-
-	//check the file type, should be fourccWAVE or 'XWMA'
-	FindChunk(hFile,fourccRIFF,dwChunkSize, dwChunkPosition );
-	DWORD filetype;
-	ReadChunkData(hFile,&filetype,sizeof(DWORD),dwChunkPosition);
-	if (filetype != fourccWAVE)
-	{
-		MessageBox(NULL, "File type was not WAVE", "Error", 0);
-	}
+	const WaveData& data = wave.Data();
 
+	// The fmt chunk may be shorter than WAVEFORMATEXTENSIBLE, XAudio2 reads cbSize and beyond
 	WAVEFORMATEXTENSIBLE wfx = {0};
-	FindChunk(hFile,fourccFMT, dwChunkSize, dwChunkPosition );
-	ReadChunkData(hFile, &wfx, dwChunkSize, dwChunkPosition );
-
-	//fill out the audio data buffer with the contents of the fourccDATA chunk
-	FindChunk(hFile,fourccDATA,dwChunkSize, dwChunkPosition );
-	BYTE * pDataBuffer = new BYTE[dwChunkSize];
-	ReadChunkData(hFile, pDataBuffer, dwChunkSize, dwChunkPosition);
+	memcpy(&wfx, data.format, min(data.formatSize, (unsigned int)sizeof(wfx)));
 
 	XAUDIO2_BUFFER buffer = {0};
-	buffer.AudioBytes = dwChunkSize;  //size of the audio buffer in bytes
-	buffer.pAudioData = pDataBuffer;  //buffer containing audio data
+	buffer.AudioBytes = data.sampleBytes;  //size of the audio buffer in bytes
+	buffer.pAudioData = data.samples;  //points into the mapped file, no copy
 	buffer.Flags = XAUDIO2_END_OF_STREAM; // tell the source voice not to expect any data after this buffer
 
+	// xWMA files need the seek table from the dpds chunk
+	XAUDIO2_BUFFER_WMA wmaBuffer = {0};
+	wmaBuffer.pDecodedPacketCumulativeBytes = (const UINT32*)data.seekTable;
+	wmaBuffer.PacketCount = data.seekTableSize / sizeof(UINT32);
+
 	// This line is needed for OS oldder Windows 8
 	CoInitializeEx(NULL, COINIT_MULTITHREADED);
 
@@ -154,7 +56,7 @@ void PlayAudioFile(char* audioFile)
 	}
 
 	// Sub mit source buffer
-	hr = pSourceVoice->SubmitSourceBuffer(&buffer);
+	hr = pSourceVoice->SubmitSourceBuffer(&buffer, data.xwma ? &wmaBuffer : NULL);
 	if(FAILED(hr))
 	{
 		MessageBox(NULL, "Submit to source buffer failed", "Error", 0);
@@ -168,10 +70,94 @@ void PlayAudioFile(char* audioFile)
 	}
 }
 
-int main(void)
+// Play the file from disk through a few small buffers, for music that is too long to load
+void StreamAudioFile(const char* audioFile)
+{
+	AudioStream stream;
+	if (!stream.Open(audioFile, STREAM_BUFFER_COUNT, STREAM_BUFFER_BYTES))
+	{
+		MessageBox(NULL, "Failed to open the file for streaming, only PCM wave files can be streamed", "Error", 0);
+		return;
+	}
+
+	// This line is needed for OS oldder Windows 8
+	CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+	IXAudio2* pXAudio2 = NULL;
+	HRESULT hr = XAudio2Create(&pXAudio2, 0, XAUDIO2_DEFAULT_PROCESSOR);
+	if (FAILED(hr))
+	{
+		MessageBox(NULL, "Failed to create XAudio2 engine instance", "Error", 0);
+		return;
+	}
+
+	IXAudio2MasteringVoice* pMasterVoice = NULL;
+	hr = pXAudio2->CreateMasteringVoice(&pMasterVoice);
+	if (FAILED(hr))
+	{
+		MessageBox(NULL, "Failed to create mastering voice", "Error", 0);
+		pXAudio2->Release();
+		return;
+	}
+
+	XAudio2StreamVoice voice;
+	if (!voice.Create(pXAudio2, &stream) || !voice.Start())
+	{
+		MessageBox(NULL, "Create source voice failed", "Error", 0);
+	}
+	else
+	{
+		printf("Streaming %s, %d KB of buffers for %u KB of samples, press a key to stop\n",
+			audioFile, (int)(stream.MemoryBytes() / 1024), stream.Wave().sampleBytes / 1024);
+
+		// Refill the voice each time it finishes a buffer
+		while (!voice.Finished() && !_kbhit())
+		{
+			WaitForSingleObject(voice.BufferEvent(), 100);
+			voice.Pump();
+		}
+	}
+	voice.Destroy();
+
+	AudioStreamStats stats = stream.Stats();
+	printf("%d buffers read, %d played, %d late, %d under-runs, slowest read %.2f ms\n",
+		stats.buffersRead, stats.buffersPlayed, stats.late, stats.underruns, stats.maxReadMs);
+
+	pMasterVoice->DestroyVoice();
+	pXAudio2->Release();
+}
+
+// PlaySoundFile [file.wav] [-stream]
+int main(int argc, char* argv[])
 {
 	char * audioFile = "inmysong.wav";
-	PlayAudioFile(audioFile);
+	bool streaming = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (_stricmp(argv[i], "-stream") == 0)
+		{
+			streaming = true;
+		}
+		else
+		{
+			audioFile = argv[i];
+		}
+	}
+
+	if (streaming)
+	{
+		StreamAudioFile(audioFile);
+		return 0;
+	}
+
+	// The samples are played from the mapping, so the file stays open until the program ends
+	WaveFile wave;
+	if (!wave.Open(audioFile))
+	{
+		MessageBox(NULL, wave.ErrorText(), "Failed to load sound file", 0);
+		return 1;
+	}
+	PlayAudioFile(wave);
 
 	getchar();
 	return 0;